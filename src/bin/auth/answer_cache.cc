@@ -0,0 +1,204 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/answer_cache.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/edns.h>
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/name_internal.h>
+#include <dns/question.h>
+
+#include <cstring>
+
+using namespace bundy::dns;
+using bundy::util::OutputBuffer;
+using bundy::util::thread::Mutex;
+
+namespace bundy {
+namespace auth {
+
+namespace {
+// The size of the DNS header, which is followed by the question name.
+const size_t HEADER_LEN = 12;
+
+// Header flags copied from the query to the cached response.
+const uint16_t QUERY_FLAGS = Message::HEADERFLAG_RD | Message::HEADERFLAG_CD;
+
+// Bits of the last byte of a key representing the EDNS state of the query.
+const uint8_t KEY_EDNS = 0x01;
+const uint8_t KEY_DO = 0x02;
+
+size_t
+getMask(size_t size) {
+    if (size == 0) {
+        bundy_throw(InvalidParameter, "answer cache size must not be 0");
+    }
+    size_t mask = 0;
+    while (mask < size - 1) {
+        mask = (mask << 1) | 1;
+    }
+    return (mask);
+}
+}
+
+// The key of a cached response: the query name in lower case, the query
+// type and class, and the EDNS state of the query.
+class AnswerCache::CacheKey {
+public:
+    CacheKey(const Message& query) {
+        const Question& question = **query.beginQuestion();
+        const ConstEDNSPtr edns = query.getEDNS();
+        init(LabelSequence(question.getName()), question.getType().getCode(),
+             question.getClass().getCode(), !edns ? 0 :
+             (KEY_EDNS | (edns->getDNSSECAwareness() ? KEY_DO : 0)));
+    }
+
+    CacheKey(const QueryView& query) {
+        init(query.getQName(), query.getQType().getCode(),
+             query.getQClass().getCode(), !query.hasEDNS() ? 0 :
+             (KEY_EDNS | (query.getDNSSECAwareness() ? KEY_DO : 0)));
+    }
+
+    // FNV-1a
+    size_t getHash() const {
+        uint32_t hash = 2166136261U;
+        for (size_t i = 0; i < len_; ++i) {
+            hash = (hash ^ data_[i]) * 16777619U;
+        }
+        return (hash);
+    }
+
+    bool matches(const std::vector<uint8_t>& key) const {
+        return (key.size() == len_ && std::memcmp(&key[0], data_, len_) == 0);
+    }
+
+    void copyTo(std::vector<uint8_t>& key) const {
+        key.assign(data_, data_ + len_);
+    }
+
+    // The query name in its original case
+    const uint8_t* qname_data_;
+    size_t qname_len_;
+
+private:
+    void init(const LabelSequence& qname, uint16_t qtype, uint16_t qclass,
+              uint8_t edns_state)
+    {
+        size_t qname_len;
+        const uint8_t* qname_data = qname.getData(&qname_len);
+        for (size_t i = 0; i < qname_len; ++i) {
+            data_[i] = name::internal::maptolower[qname_data[i]];
+        }
+        len_ = qname_len;
+        data_[len_++] = qtype >> 8;
+        data_[len_++] = qtype & 0xff;
+        data_[len_++] = qclass >> 8;
+        data_[len_++] = qclass & 0xff;
+        data_[len_++] = edns_state;
+        qname_data_ = qname_data;
+        qname_len_ = qname_len;
+    }
+
+    uint8_t data_[Name::MAX_WIRE + 5];
+    size_t len_;
+};
+
+const size_t AnswerCache::LOCK_COUNT;
+
+AnswerCache::AnswerCache(size_t size) :
+    mask_(getMask(size)),
+    slots_(new Slot[mask_ + 1]),
+    locks_(new Mutex[LOCK_COUNT])
+{}
+
+bool
+AnswerCache::lookup(const Message& query, uint64_t generation,
+                    size_t max_length, OutputBuffer& buffer)
+{
+    uint16_t query_flags = 0;
+    if (query.getHeaderFlag(Message::HEADERFLAG_RD)) {
+        query_flags |= Message::HEADERFLAG_RD;
+    }
+    if (query.getHeaderFlag(Message::HEADERFLAG_CD)) {
+        query_flags |= Message::HEADERFLAG_CD;
+    }
+    return (lookup(CacheKey(query), query.getQid(), query_flags, generation,
+                   max_length, buffer));
+}
+
+bool
+AnswerCache::lookup(const QueryView& query, uint64_t generation,
+                    size_t max_length, OutputBuffer& buffer)
+{
+    uint16_t query_flags = 0;
+    if (query.getHeaderFlag(Message::HEADERFLAG_RD)) {
+        query_flags |= Message::HEADERFLAG_RD;
+    }
+    if (query.getHeaderFlag(Message::HEADERFLAG_CD)) {
+        query_flags |= Message::HEADERFLAG_CD;
+    }
+    return (lookup(CacheKey(query), query.getQid(), query_flags, generation,
+                   max_length, buffer));
+}
+
+bool
+AnswerCache::lookup(const CacheKey& key, qid_t qid, uint16_t query_flags,
+                    uint64_t generation, size_t max_length,
+                    OutputBuffer& buffer)
+{
+    const size_t index = key.getHash() & mask_;
+    Mutex::Locker locker(getLock(index));
+    const Slot& slot = slots_[index];
+    if (slot.generation_ != generation || !key.matches(slot.key_) ||
+        slot.response_.size() > max_length) {
+        return (false);
+    }
+
+    // The response begins with the header and the question name in the
+    // case of the query it was built for; replace them with those for
+    // this query.
+    const uint8_t* const response = &slot.response_[0];
+    const uint16_t flags = (response[2] << 8) | response[3];
+    buffer.writeUint16(qid);
+    buffer.writeUint16((flags & ~QUERY_FLAGS) | query_flags);
+    buffer.writeData(response + 4, HEADER_LEN - 4);
+    buffer.writeData(key.qname_data_, key.qname_len_);
+    const size_t rest = HEADER_LEN + key.qname_len_;
+    buffer.writeData(response + rest, slot.response_.size() - rest);
+    return (true);
+}
+
+void
+AnswerCache::add(const Message& query, uint64_t generation,
+                 const void* response, size_t length)
+{
+    const CacheKey key(query);
+    if (length < HEADER_LEN + key.qname_len_) {
+        bundy_throw(InvalidParameter, "too short response for answer cache: "
+                    << length << " bytes");
+    }
+    const size_t index = key.getHash() & mask_;
+    const uint8_t* const data = static_cast<const uint8_t*>(response);
+    Mutex::Locker locker(getLock(index));
+    Slot& slot = slots_[index];
+    key.copyTo(slot.key_);
+    slot.response_.assign(data, data + length);
+    slot.generation_ = generation;
+}
+
+} // namespace auth
+} // namespace bundy
@@ -0,0 +1,149 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef AUTH_ANSWER_CACHE_H
+#define AUTH_ANSWER_CACHE_H 1
+
+#include <dns/message.h>
+#include <dns/query_view.h>
+#include <util/buffer.h>
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace auth {
+
+/// \brief A cache of fully rendered responses to normal queries.
+///
+/// Responses to queries for zones served from memory only depend on the
+/// question, the EDNS state of the query (whether it has EDNS and whether
+/// the DO bit is set) and the zone data.  For such queries this class keeps
+/// the rendered response in wire format, so the same query can later be
+/// answered by copying the data and patching the ID, the RD and CD flags
+/// and the case of the query name, without looking up the zone or rendering
+/// the RRsets again.
+///
+/// Each response is stored with the "generation" of the data source data
+/// it was built from (see \c DataSrcClientsMgrBase::Holder::getGeneration()),
+/// and is only used for lookups with the same generation.  As the generation
+/// changes whenever any zone is installed in memory or the data sources are
+/// reconfigured, stale responses are never returned; they are simply
+/// overridden by newer ones.
+///
+/// The cache has a fixed number of slots, and each question is mapped to
+/// one of them by its hash value.  A new response replaces any older one in
+/// the same slot, so frequently queried names tend to stay in the cache.
+///
+/// The cache can be shared by multiple query processing threads; slots are
+/// protected by a fixed number of locks so lookups in different slots
+/// rarely block each other.
+///
+/// It's the caller's responsibility to use the cache only for queries and
+/// responses for which it's valid: the query must be a normal query
+/// (with opcode QUERY) not signed by TSIG, the response must not be
+/// truncated or signed, and it must be built only from zone data in memory.
+class AnswerCache : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param size The number of responses that can be cached.  It's
+    ///     rounded up to a power of 2.
+    ///
+    /// \throw bundy::InvalidParameter size is 0.
+    explicit AnswerCache(size_t size);
+
+    /// \brief Return the number of responses that can be cached.
+    size_t getSize() const { return (mask_ + 1); }
+
+    /// \brief Render a cached response to a query.
+    ///
+    /// If there's a cached response to the same question with the same
+    /// EDNS state of query, built from the data of the given generation,
+    /// and it fits in \c max_length bytes, it's written to \c buffer with
+    /// the ID, the RD and CD flags, and the query name copied from
+    /// \c query.  \c buffer is expected to be empty.
+    ///
+    /// \param query The query message (it must contain a question).
+    /// \param generation The current generation of the data sources.
+    /// \param max_length The maximum size of the response.
+    /// \param buffer The buffer to write the response to.
+    /// \return true if a response is written to buffer; false otherwise.
+    bool lookup(const dns::Message& query, uint64_t generation,
+                size_t max_length, util::OutputBuffer& buffer);
+
+    /// \brief Render a cached response to a query given as a \c QueryView.
+    ///
+    /// This is the same as the other version, but doesn't require the
+    /// query to be parsed into a \c Message.
+    ///
+    /// \param query The successfully parsed query.
+    /// \param generation The current generation of the data sources.
+    /// \param max_length The maximum size of the response.
+    /// \param buffer The buffer to write the response to.
+    /// \return true if a response is written to buffer; false otherwise.
+    bool lookup(const dns::QueryView& query, uint64_t generation,
+                size_t max_length, util::OutputBuffer& buffer);
+
+    /// \brief Add a response to the cache.
+    ///
+    /// It replaces any response in the slot for the question of \c query.
+    ///
+    /// \param query The query message (it must contain a question).
+    /// \param generation The generation of the data sources the response
+    ///     is built from.
+    /// \param response The rendered response.
+    /// \param length The size of the response.
+    void add(const dns::Message& query, uint64_t generation,
+             const void* response, size_t length);
+
+private:
+    struct Slot {
+        Slot() : generation_(0) {}
+        std::vector<uint8_t> key_;
+        std::vector<uint8_t> response_;
+        uint64_t generation_;
+    };
+
+    class CacheKey;
+
+    bool lookup(const CacheKey& key, dns::qid_t qid, uint16_t query_flags,
+                uint64_t generation, size_t max_length,
+                util::OutputBuffer& buffer);
+
+    // The number of locks protecting the slots.
+    static const size_t LOCK_COUNT = 64;
+
+    util::thread::Mutex& getLock(size_t index) {
+        return (locks_[index % LOCK_COUNT]);
+    }
+
+    const size_t mask_;
+    boost::scoped_array<Slot> slots_;
+    boost::scoped_array<util::thread::Mutex> locks_;
+};
+
+} // namespace auth
+} // namespace bundy
+
+#endif // AUTH_ANSWER_CACHE_H
+
+// Local Variables:
+// mode: c++
+// End:
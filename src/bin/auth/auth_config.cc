@@ -137,6 +137,69 @@ private:
     size_t timeout_;
 };
 
+/// \brief Configuration for the number of query worker threads
+class WorkerThreadsConfig : public AuthConfigParser {
+public:
+    WorkerThreadsConfig(AuthSrv& server) : server_(server), count_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 0) {
+            count_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError, "worker_threads must be 0 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.setWorkerThreads(count_);
+    }
+private:
+    AuthSrv& server_;
+    size_t count_;
+};
+
+/// \brief Configuration for batched processing of UDP queries
+class UDPBatchingConfig : public AuthConfigParser {
+public:
+    UDPBatchingConfig(AuthSrv& server) : server_(server), batching_(false)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        batching_ = config->boolValue();
+    }
+
+    virtual void commit() {
+        server_.setUDPBatching(batching_);
+    }
+private:
+    AuthSrv& server_;
+    bool batching_;
+};
+
+/// \brief Configuration for the size of the cache of rendered responses
+class AnswerCacheSizeConfig : public AuthConfigParser {
+public:
+    AnswerCacheSizeConfig(AuthSrv& server) : server_(server), size_(0)
+    {}
+
+    virtual void build(ConstElementPtr config) {
+        if (config->intValue() >= 0) {
+            size_ = config->intValue();
+        } else {
+            bundy_throw(AuthConfigError,
+                        "answer_cache_size must be 0 or higher");
+        }
+    }
+
+    virtual void commit() {
+        server_.setAnswerCacheSize(size_);
+    }
+private:
+    AuthSrv& server_;
+    size_t size_;
+};
+
 } // end of unnamed namespace
 
 AuthConfigParser*
@@ -170,6 +233,12 @@ createAuthConfigParser(AuthSrv& server, const std::string& config_id) {
         return (new VersionConfig());
     } else if (config_id == "tcp_recv_timeout") {
         return (new TCPRecvTimeoutConfig(server));
+    } else if (config_id == "worker_threads") {
+        return (new WorkerThreadsConfig(server));
+    } else if (config_id == "udp_batching") {
+        return (new UDPBatchingConfig(server));
+    } else if (config_id == "answer_cache_size") {
+        return (new AnswerCacheSizeConfig(server));
     } else {
         bundy_throw(AuthConfigError, "Unknown configuration identifier: " <<
                     config_id);
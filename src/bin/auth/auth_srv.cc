@@ -18,6 +18,9 @@
 
 #include <asiolink/asiolink.h>
 #include <asiolink/io_endpoint.h>
+#include <asiolink/local_socket.h>
+
+#include <asio.hpp>
 
 #include <config/ccsession.h>
 
@@ -26,6 +29,7 @@
 
 #include <exceptions/exceptions.h>
 
+#include <util/arena.h>
 #include <util/buffer.h>
 
 #include <dns/edns.h>
@@ -33,6 +37,7 @@
 #include <dns/messagerenderer.h>
 #include <dns/name.h>
 #include <dns/question.h>
+#include <dns/query_view.h>
 #include <dns/opcode.h>
 #include <dns/rcode.h>
 #include <dns/rrset.h>
@@ -42,9 +47,15 @@
 
 #include <asiodns/dns_service.h>
 
+#include <server_common/socket_request.h>
+
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
 #include <datasrc/exceptions.h>
 #include <datasrc/client_list.h>
 
+#include <auth/answer_cache.h>
 #include <auth/common.h>
 #include <auth/auth_config.h>
 #include <auth/auth_srv.h>
@@ -54,17 +65,26 @@
 #include <auth/datasrc_clients_mgr.h>
 
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <list>
 #include <vector>
 #include <memory>
 
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -74,6 +94,7 @@ using namespace bundy::datasrc;
 using namespace bundy::dns;
 using namespace bundy::util;
 using namespace bundy::util::io;
+using namespace bundy::util::thread;
 using namespace bundy::auth;
 using namespace bundy::dns::rdata;
 using namespace bundy::data;
@@ -82,6 +103,8 @@ using namespace bundy::xfr;
 using namespace bundy::asiolink;
 using namespace bundy::asiodns;
 using namespace bundy::server_common::portconfig;
+using bundy::server_common::SocketRequestor;
+using bundy::server_common::socketRequestor;
 using bundy::auth::statistics::Counters;
 using bundy::auth::statistics::MessageAttributes;
 
@@ -117,6 +140,21 @@ private:
     MessageAttributes& stats_attrs_;
 };
 
+// Set up the response message and the statistics attributes for a response
+// rendered from the answer cache, so they can be handled in the same way as
+// other responses.  The message has no RRs, so we take the flags and rcode
+// from the rendered data, and tell statistics about the answer RRs
+// separately.
+void
+setCachedResponse(Message& message, const OutputBuffer& buffer,
+                  MessageAttributes& stats_attrs)
+{
+    message.setHeaderFlag(Message::HEADERFLAG_AA,
+                          (buffer[2] & (Message::HEADERFLAG_AA >> 8)) != 0);
+    message.setRcode(Rcode(buffer[3] & 0x0f));
+    stats_attrs.setResponseCachedAnswer(buffer[6] != 0 || buffer[7] != 0);
+}
+
 // Similar to Renderer holder, this is a very basic RAII-style class
 // that calls clear(Message::PARSE) on the given Message upon destruction
 class MessageHolder {
@@ -231,6 +269,49 @@ private:
 };
 }
 
+namespace {
+// Per-thread resources used to process a request and render the response.
+//
+// The main thread uses one for the requests it receives itself, and each
+// query worker thread owns another, so the query processing path never
+// shares a mutable object between threads.
+struct QueryContext : boost::noncopyable {
+    QueryContext() :
+        response_edns_(new EDNS), arena_(Arena::create()),
+        datasrc_in_memory_(false)
+    {}
+    ~QueryContext() { Arena::destroy(arena_); }
+    MessageRenderer renderer_;
+    auth::Query query_;
+    // Used to answer queries from the answer cache without building the
+    // query and the EDNS of the response in the message.
+    QueryView query_view_;
+    EDNSPtr response_edns_;
+    // Short-lived objects created by data sources for a query, such as
+    // RRsets and zone finders, are placed here.
+    Arena* const arena_;
+    // Whether all the data sources were served from memory the last time
+    // they were checked (only used by the query worker threads).
+    bool datasrc_in_memory_;
+};
+
+// Thrown by AuthSrvImpl::processNormalQuery() in a query worker thread
+// if the query can't be answered from memory.  The request is then passed
+// to the main thread.
+class NotInMemory : public bundy::Exception {
+public:
+    NotInMemory(const char* file, size_t line, const char* what) :
+        bundy::Exception(file, line, what)
+    {}
+};
+
+class QueryWorker;
+typedef boost::shared_ptr<QueryWorker> QueryWorkerPtr;
+class DeferredRequest;
+typedef boost::shared_ptr<DeferredRequest> DeferredRequestPtr;
+class DeferredQueue;
+}
+
 class AuthSrvImpl {
 private:
     // prohibit copy
@@ -240,24 +321,75 @@ public:
     AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
                 BaseSocketSessionForwarder& ddns_forwarder);
 
-    bool processNormalQuery(const IOMessage& io_message,
+    /// \brief Process a request using the given per-thread context.
+    ///
+    /// \c worker is the query worker thread calling this method, or NULL
+    /// if it's called in the main thread.  Requests that need resources
+    /// owned by the main thread are passed to it when called by a worker.
+    void processMessage(QueryContext& context, const IOMessage& io_message,
+                        Message& message, OutputBuffer& buffer,
+                        DNSServer* server, QueryWorker* worker);
+    bool processCachedQuery(QueryContext& context,
+                            const IOMessage& io_message, Message& message,
+                            OutputBuffer& buffer,
+                            MessageAttributes& stats_attrs);
+    bool processNormalQuery(QueryContext& context,
+                            const IOMessage& io_message,
                             ConstEDNSPtr remote_edns, Message& message,
                             OutputBuffer& buffer,
                             unique_ptr<TSIGContext> tsig_context,
-                            MessageAttributes& stats_attrs);
-    bool processXfrQuery(const IOMessage& io_message, Message& message,
-                         OutputBuffer& buffer,
+                            MessageAttributes& stats_attrs,
+                            QueryWorker* worker);
+    bool processXfrQuery(QueryContext& context, const IOMessage& io_message,
+                         Message& message, OutputBuffer& buffer,
                          unique_ptr<TSIGContext> tsig_context,
                          MessageAttributes& stats_attrs);
-    bool processNotify(const IOMessage& io_message, Message& message,
-                       OutputBuffer& buffer,
+    bool processNotify(QueryContext& context, const IOMessage& io_message,
+                       Message& message, OutputBuffer& buffer,
                        unique_ptr<TSIGContext> tsig_context,
                        MessageAttributes& stats_attrs);
     bool processUpdate(const IOMessage& io_message);
 
+    /// \brief Pass a request received by a query worker thread to the
+    /// main thread.
+    ///
+    /// This is called in the worker thread; the request is copied and
+    /// later handled by \c processDeferred() in the main thread.
+    /// \c deferred_queue_ must have been created.
+    void deferToMain(const IOMessage& io_message);
+
+    /// \brief Process a request passed from a query worker thread.
+    ///
+    /// This is called in the main thread.
+    void processDeferred(DeferredRequestPtr request);
+
+    /// \brief Check whether a query worker thread may use the data sources.
+    ///
+    /// Only the in-memory data source clients can be used from multiple
+    /// threads, so the workers only answer queries while all the data is
+    /// served from memory; the main thread answers the others.  The result
+    /// of the last check is kept in the context of the worker, and the
+    /// data sources are checked again only if they weren't in memory then.
+    /// If they change in the meantime, \c processNormalQuery() notices it.
+    bool isInMemory(QueryContext& context);
+
+    /// \brief Release the sockets of the query worker threads.
+    ///
+    /// These are the additional UDP sockets requested for the workers
+    /// (see \c WorkerDNSService); this must be called after the workers
+    /// closed them.
+    void releaseWorkerSockets();
+
+    /// \brief (Re)start all query worker threads.
+    void startWorkers();
+
+    /// \brief Stop all query worker threads.
+    void stopWorkers();
+
     IOService io_service_;
 
-    MessageRenderer renderer_;
+    /// Context for requests received in the main thread.
+    QueryContext main_context_;
     /// Currently non-configurable, but will be.
     static const uint16_t DEFAULT_LOCAL_UDPSIZE = 4096;
 
@@ -271,6 +403,12 @@ public:
     /// Addresses we listen on
     AddressList listen_addresses_;
 
+    /// Options for the UDP servers on the listen addresses
+    DNSService::ServerFlag udp_server_options_;
+
+    /// Cache of rendered responses; NULL if disabled
+    boost::scoped_ptr<AnswerCache> answer_cache_;
+
     /// The TSIG keyring
     const boost::shared_ptr<TSIGKeyRing>* keyring_;
 
@@ -307,8 +445,18 @@ public:
 
     /// Are we currently subscribed to the SegmentReader group?
     bool readers_group_subscribed_;
-private:
-    auth::Query query_;
+
+    /// Requests passed from the query worker threads to the main thread.
+    /// Created when workers are first used, and kept until the end.
+    boost::scoped_ptr<DeferredQueue> deferred_queue_;
+
+    /// Tokens of the additional UDP sockets of the query worker threads
+    std::vector<std::string> worker_socket_tokens_;
+
+    /// Query worker threads.  If empty, all requests are processed in the
+    /// main thread.  This must be placed last so that the workers are
+    /// stopped before anything they refer to is destroyed.
+    std::vector<QueryWorkerPtr> workers_;
 };
 
 AuthSrvImpl::AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
@@ -316,6 +464,7 @@ AuthSrvImpl::AuthSrvImpl(BaseSocketSessionForwarder& xfrout_forwarder,
     config_session_(NULL),
     xfrin_session_(NULL),
     counters_(),
+    udp_server_options_(DNSService::SERVER_SYNC_OK),
     keyring_(NULL),
     datasrc_clients_mgr_(io_service_),
     xfrout_forwarder_(new SocketSessionForwarderHolder("xfrout",
@@ -364,6 +513,410 @@ public:
     {}
 };
 
+namespace {
+// A query worker thread.
+//
+// Each worker runs its own event loop on its own UDP sockets, and processes
+// the queries received on them with its own QueryContext.  The data sources
+// (and, in particular, in-memory zone data) are shared with other threads
+// for reading.
+class QueryWorker : boost::noncopyable {
+public:
+    QueryWorker(AuthSrvImpl& impl) :
+        impl_(impl), lookup_(impl, *this), answer_(NULL),
+        dns_service_(io_service_, &lookup_, &answer_)
+    {}
+
+    ~QueryWorker() {
+        stop();
+    }
+
+    DNSService& getDNSService() { return (dns_service_); }
+
+    // Start the thread running the event loop.  The worker must not
+    // be running.
+    void start() {
+        assert(!thread_);
+        io_service_.get_io_service().reset();
+        thread_.reset(new Thread(boost::bind(&QueryWorker::run, this)));
+    }
+
+    // Stop the event loop and wait for the thread to terminate.  After
+    // this, the worker's servers can be safely modified from other threads.
+    void stop() {
+        if (thread_) {
+            io_service_.stop();
+            thread_->wait();
+            thread_.reset();
+        }
+    }
+
+private:
+    // The DNSLookup given to the worker's DNS service.  Same as
+    // MessageLookup, but uses the worker's context.
+    class WorkerLookup : public DNSLookup {
+    public:
+        WorkerLookup(AuthSrvImpl& impl, QueryWorker& worker) :
+            impl_(impl), worker_(worker)
+        {}
+        virtual void operator()(const IOMessage& io_message,
+                                MessagePtr message, MessagePtr,
+                                OutputBufferPtr buffer,
+                                DNSServer* server) const
+        {
+            MessageHolder message_holder(*message);
+            impl_.processMessage(worker_.context_, io_message, *message,
+                                 *buffer, server, &worker_);
+        }
+    private:
+        AuthSrvImpl& impl_;
+        QueryWorker& worker_;
+    };
+
+    void run() {
+        try {
+            io_service_.run();
+        } catch (const std::exception& ex) {
+            LOG_ERROR(auth_logger, AUTH_WORKER_FAILED).arg(ex.what());
+        }
+    }
+
+    AuthSrvImpl& impl_;
+    QueryContext context_;
+    IOService io_service_;
+    WorkerLookup lookup_;
+    MessageAnswer answer_;
+    DNSService dns_service_;
+    boost::scoped_ptr<Thread> thread_;
+};
+
+// Get the local address and port of a socket, for requesting other sockets
+// bound to them.  Returns false on failure.
+bool
+getSocketAddress(const int fd, std::string& address, uint16_t& port) {
+    struct sockaddr_storage ss;
+    socklen_t ss_len = sizeof(ss);
+    if (getsockname(fd, reinterpret_cast<struct sockaddr*>(&ss),
+                    &ss_len) == -1) {
+        return (false);
+    }
+    char buf[INET6_ADDRSTRLEN];
+    const void* addr;
+    if (ss.ss_family == AF_INET) {
+        const struct sockaddr_in* sin =
+            reinterpret_cast<const struct sockaddr_in*>(&ss);
+        addr = &sin->sin_addr;
+        port = ntohs(sin->sin_port);
+    } else if (ss.ss_family == AF_INET6) {
+        const struct sockaddr_in6* sin6 =
+            reinterpret_cast<const struct sockaddr_in6*>(&ss);
+        addr = &sin6->sin6_addr;
+        port = ntohs(sin6->sin6_port);
+    } else {
+        errno = EAFNOSUPPORT;
+        return (false);
+    }
+    if (inet_ntop(ss.ss_family, addr, buf, sizeof(buf)) == NULL) {
+        return (false);
+    }
+    address = buf;
+    return (true);
+}
+
+// A DNSServiceBase used for installing the listening sockets when query
+// worker threads are enabled.  TCP servers are added to the main DNS
+// service.  Each UDP socket is served by all workers: the original socket
+// by the first one, and another instance of it (see
+// SocketRequestor::requestSocket()) by each of the others.  These are
+// created by the socket creator, with its privileges, and bound to the same
+// address with SO_REUSEPORT so the kernel distributes the queries among
+// them.  If such a socket can't be obtained, a duplicate of the original
+// descriptor is used instead; all workers will then receive from the same
+// socket.
+//
+// The additional sockets are released on clearServers().  Workers are
+// stopped there too; the caller is responsible for starting them again
+// once the sockets are installed.
+class WorkerDNSService : public DNSServiceBase {
+public:
+    WorkerDNSService(DNSServiceBase& main_service, AuthSrvImpl& impl) :
+        main_service_(main_service), impl_(impl), workers_(impl.workers_)
+    {}
+
+    virtual void addServerTCPFromFD(int fd, int af) {
+        main_service_.addServerTCPFromFD(fd, af);
+    }
+
+    virtual void addServerUDPFromFD(int fd, int af, ServerFlag options) {
+        std::string address;
+        uint16_t port = 0;
+        const bool have_address = workers_.size() > 1 &&
+            getSocketAddress(fd, address, port);
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            int worker_fd = fd;
+            if (i > 0) {
+                worker_fd = requestUDPSocket(fd, have_address, address, port,
+                                             i);
+            }
+            try {
+                workers_[i]->getDNSService().addServerUDPFromFD(worker_fd, af,
+                                                                options);
+            } catch (...) {
+                if (worker_fd != fd) {
+                    close(worker_fd);
+                }
+                throw;
+            }
+        }
+    }
+
+    virtual void clearServers() {
+        main_service_.clearServers();
+        BOOST_FOREACH(const QueryWorkerPtr& worker, workers_) {
+            worker->stop();
+            worker->getDNSService().clearServers();
+        }
+        impl_.releaseWorkerSockets();
+    }
+
+    virtual void setTCPRecvTimeout(size_t timeout) {
+        main_service_.setTCPRecvTimeout(timeout);
+    }
+
+    virtual IOService& getIOService() {
+        return (main_service_.getIOService());
+    }
+
+private:
+    // Get the socket of the given instance for a worker, or a duplicate of
+    // the original one if it's not available.
+    int requestUDPSocket(const int fd, const bool have_address,
+                         const std::string& address, const uint16_t port,
+                         const unsigned int instance)
+    {
+        if (have_address) {
+            try {
+                const SocketRequestor::SocketID socket =
+                    socketRequestor().requestSocket(SocketRequestor::UDP,
+                                                    address, port,
+                                                    SocketRequestor::SHARE_SAME,
+                                                    "", instance);
+                impl_.worker_socket_tokens_.push_back(socket.second);
+                return (socket.first);
+            } catch (const SocketRequestor::NonFatalSocketError& ex) {
+                LOG_WARN(auth_logger, AUTH_WORKER_SOCKET_SHARED).
+                    arg(ex.what());
+            }
+        } else {
+            LOG_WARN(auth_logger, AUTH_WORKER_SOCKET_SHARED).
+                arg(strerror(errno));
+        }
+        const int worker_fd = dup(fd);
+        if (worker_fd == -1) {
+            bundy_throw(bundy::Unexpected,
+                        "failed to duplicate UDP socket: " <<
+                        strerror(errno));
+        }
+        return (worker_fd);
+    }
+
+    DNSServiceBase& main_service_;
+    AuthSrvImpl& impl_;
+    const std::vector<QueryWorkerPtr>& workers_;
+};
+
+// A UDP socket of a query worker referred to from the main thread.  It owns
+// a duplicate of the worker's descriptor so it remains valid even if the
+// worker closes its own before the main thread uses it.
+class DeferredSocket : public IOSocket {
+public:
+    DeferredSocket(const int fd) : fd_(dup(fd)) {
+        if (fd_ == -1) {
+            bundy_throw(bundy::Unexpected, "failed to duplicate socket: " <<
+                        strerror(errno));
+        }
+    }
+    virtual ~DeferredSocket() {
+        close(fd_);
+    }
+    virtual int getNative() const { return (fd_); }
+    virtual int getProtocol() const { return (IPPROTO_UDP); }
+private:
+    const int fd_;
+};
+
+// A request received by a query worker that has to be processed in the
+// main thread (see AuthSrvImpl::processMessage()).  It keeps copies of
+// everything needed to process the request and send the response.
+class DeferredRequest : boost::noncopyable {
+public:
+    DeferredRequest(const IOMessage& io_message) :
+        data_(static_cast<const uint8_t*>(io_message.getData()),
+              static_cast<const uint8_t*>(io_message.getData()) +
+              io_message.getDataSize()),
+        socket_(io_message.getSocket().getNative()),
+        endpoint_(IOEndpoint::create(
+                      IPPROTO_UDP,
+                      io_message.getRemoteEndpoint().getAddress(),
+                      io_message.getRemoteEndpoint().getPort())),
+        io_message_(&data_[0], data_.size(), socket_, *endpoint_)
+    {}
+
+    const IOMessage& getIOMessage() const { return (io_message_); }
+
+    // Send the response to the original sender over the worker's socket.
+    void sendResponse(const OutputBuffer& buffer) const {
+        const socklen_t sa_len = (endpoint_->getFamily() == AF_INET6) ?
+            sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        if (sendto(socket_.getNative(), buffer.getData(), buffer.getLength(),
+                   0, &endpoint_->getSockAddr(), sa_len) == -1) {
+            LOG_ERROR(auth_logger, AUTH_WORKER_SEND_FAIL).
+                arg(*endpoint_).arg(strerror(errno));
+        }
+    }
+
+private:
+    const std::vector<uint8_t> data_;
+    const DeferredSocket socket_;
+    const boost::scoped_ptr<const IOEndpoint> endpoint_;
+    const IOMessage io_message_;
+};
+
+// The DNSServer given to processMessage() for deferred requests.  It only
+// remembers whether the processing produced a response.
+class DeferredServer : public DNSServer {
+public:
+    DeferredServer() : done_(false) {}
+    virtual void operator()(asio::error_code, size_t) {}
+    virtual void stop() {}
+    virtual void resume(const bool done) { done_ = done; }
+    virtual DNSServer* clone() {
+        bundy_throw(bundy::Unexpected, "DeferredServer can't be cloned");
+    }
+    bool hasAnswer() const { return (done_); }
+private:
+    bool done_;
+};
+
+// The queue of requests passed from the query worker threads to the main
+// thread.  The ASIO library is built without thread support, so the workers
+// can't simply post() to the main IOService; like DataSrcClientsMgr, the
+// requests are pushed to a list protected by a mutex, and the main thread
+// is woken up via a socket pair.
+class DeferredQueue : boost::noncopyable {
+public:
+    typedef boost::function<void(DeferredRequestPtr)> Handler;
+
+    DeferredQueue(IOService& io_service, const Handler& handler) :
+        handler_(handler), read_fd_(-1), write_fd_(-1)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            bundy_throw(bundy::Unexpected, "Can't create socket pair: " <<
+                        strerror(errno));
+        }
+        read_fd_ = fds[0];
+        write_fd_ = fds[1];
+        wakeup_socket_.reset(new LocalSocket(io_service, read_fd_));
+        wakeup_socket_->asyncRead(
+            boost::bind(&DeferredQueue::processRequests, this, _1),
+            buffer_, 1);
+    }
+
+    ~DeferredQueue() {
+        wakeup_socket_.reset();
+        close(read_fd_);
+        close(write_fd_);
+    }
+
+    // Called from a worker thread.
+    void push(const DeferredRequestPtr& request) {
+        {
+            Mutex::Locker locker(mutex_);
+            requests_.push_back(request);
+        }
+        // If this fails because the socket buffer is full, the main thread
+        // will wake up for the previous data anyway.
+        static_cast<void>(send(write_fd_, "w", 1, MSG_DONTWAIT));
+    }
+
+private:
+    // Called in the main thread when woken up.
+    void processRequests(const std::string& error) {
+        wakeup_socket_->asyncRead(
+            boost::bind(&DeferredQueue::processRequests, this, _1),
+            buffer_, 1);
+        if (!error.empty()) {
+            bundy_throw(bundy::Unexpected, error);
+        }
+
+        std::list<DeferredRequestPtr> requests;
+        {
+            Mutex::Locker locker(mutex_);
+            requests.swap(requests_);
+        }
+        BOOST_FOREACH(const DeferredRequestPtr& request, requests) {
+            handler_(request);
+        }
+    }
+
+    const Handler handler_;
+    Mutex mutex_;
+    std::list<DeferredRequestPtr> requests_;
+    int read_fd_, write_fd_;
+    boost::scoped_ptr<LocalSocket> wakeup_socket_;
+    char buffer_[1];
+};
+}
+
+void
+AuthSrvImpl::deferToMain(const IOMessage& io_message) {
+    deferred_queue_->push(DeferredRequestPtr(new DeferredRequest(io_message)));
+}
+
+void
+AuthSrvImpl::processDeferred(DeferredRequestPtr request) {
+    Message message(Message::PARSE);
+    OutputBuffer buffer(0);
+    DeferredServer server;
+    processMessage(main_context_, request->getIOMessage(), message, buffer,
+                   &server, NULL);
+    if (server.hasAnswer()) {
+        request->sendResponse(buffer);
+    }
+}
+
+bool
+AuthSrvImpl::isInMemory(QueryContext& context) {
+    if (!context.datasrc_in_memory_) {
+        const auth::DataSrcClientsMgr::Holder holder(datasrc_clients_mgr_);
+        context.datasrc_in_memory_ = holder.isInMemory();
+    }
+    return (context.datasrc_in_memory_);
+}
+
+void
+AuthSrvImpl::releaseWorkerSockets() {
+    BOOST_FOREACH(const std::string& token, worker_socket_tokens_) {
+        socketRequestor().releaseSocket(token);
+    }
+    worker_socket_tokens_.clear();
+}
+
+void
+AuthSrvImpl::startWorkers() {
+    BOOST_FOREACH(const QueryWorkerPtr& worker, workers_) {
+        worker->start();
+    }
+}
+
+void
+AuthSrvImpl::stopWorkers() {
+    BOOST_FOREACH(const QueryWorkerPtr& worker, workers_) {
+        worker->stop();
+    }
+}
+
 AuthSrv::AuthSrv(bundy::util::io::BaseSocketSessionForwarder& xfrout_forwarder,
                  bundy::util::io::BaseSocketSessionForwarder& ddns_forwarder) :
     dnss_(NULL)
@@ -467,15 +1020,35 @@ AuthSrv::getConfigSession() const {
 void
 AuthSrv::processMessage(const IOMessage& io_message, Message& message,
                         OutputBuffer& buffer, DNSServer* server)
+{
+    impl_->processMessage(impl_->main_context_, io_message, message, buffer,
+                          server, NULL);
+}
+
+void
+AuthSrvImpl::processMessage(QueryContext& context,
+                            const IOMessage& io_message, Message& message,
+                            OutputBuffer& buffer, DNSServer* server,
+                            QueryWorker* worker)
 {
     InputBuffer request_buffer(io_message.getData(), io_message.getDataSize());
     MessageAttributes stats_attrs;
 
+    stats_attrs.setRequestTime(bundy::statistics::getMicroseconds());
     stats_attrs.setRequestIPVersion(
         io_message.getRemoteEndpoint().getFamily());
     stats_attrs.setRequestTransportProtocol(
         io_message.getRemoteEndpoint().getProtocol());
 
+    // Most queries can be answered from the answer cache if it's enabled,
+    // which doesn't need the query to be fully parsed.
+    if (answer_cache_ &&
+        processCachedQuery(context, io_message, message, buffer,
+                           stats_attrs)) {
+        resumeServer(server, message, stats_attrs, true);
+        return;
+    }
+
     // First, check the header part.  If we fail even for the base header,
     // just drop the message.
     try {
@@ -484,13 +1057,13 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
         // Ignore all responses.
         if (message.getHeaderFlag(Message::HEADERFLAG_QR)) {
             LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_RECEIVED);
-            impl_->resumeServer(server, message, stats_attrs, false);
+            resumeServer(server, message, stats_attrs, false);
             return;
         }
     } catch (const bundy::Exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_HEADER_PARSE_FAIL)
                   .arg(ex.what());
-        impl_->resumeServer(server, message, stats_attrs, false);
+        resumeServer(server, message, stats_attrs, false);
         return;
     }
 
@@ -507,22 +1080,36 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
     } catch (const DNSProtocolError& error) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_PACKET_PROTOCOL_FAILURE)
                   .arg(error.getRcode().toText()).arg(error.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, error.getRcode(),
+        makeErrorMessage(context.renderer_, message, buffer, error.getRcode(),
                          stats_attrs);
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, message, stats_attrs, true);
         return;
     } catch (const bundy::Exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_PACKET_PARSE_FAILED)
                   .arg(ex.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
-                         stats_attrs);
-        impl_->resumeServer(server, message, stats_attrs, true);
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::SERVFAIL(), stats_attrs);
+        resumeServer(server, message, stats_attrs, true);
         return;
     } // other exceptions will be handled at a higher layer.
 
     LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_PACKET_RECEIVED)
               .arg(message);
 
+    // Query worker threads only handle plain queries by themselves.
+    // NOTIFY and UPDATE need the sessions and forwarders, and TSIG needs
+    // the keyring, all of which are owned by the main thread, so such
+    // requests are passed to it, as well as all requests if the data
+    // sources aren't all in memory.  Note that they are counted in
+    // statistics when the main thread processes them.
+    if (worker != NULL &&
+        (opcode == Opcode::NOTIFY() || opcode == Opcode::UPDATE() ||
+         message.getTSIGRecord() != NULL || !isInMemory(context))) {
+        deferToMain(io_message);
+        server->resume(false);
+        return;
+    }
+
     // Perform further protocol-level validation.
     // TSIG first
     // If this is set to something, we know we need to answer with TSIG as well
@@ -532,20 +1119,20 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
 
     // Do we do TSIG?
     // The keyring can be null if we're in test
-    if (impl_->keyring_ != NULL && tsig_record != NULL) {
+    if (keyring_ != NULL && tsig_record != NULL) {
         tsig_context.reset(new TSIGContext(tsig_record->getName(),
                                            tsig_record->getRdata().
                                                 getAlgorithm(),
-                                           **impl_->keyring_));
+                                           **keyring_));
         tsig_error = tsig_context->verify(tsig_record, io_message.getData(),
                                           io_message.getDataSize());
         stats_attrs.setRequestTSIG(true, tsig_error != TSIGError::NOERROR());
     }
 
     if (tsig_error != TSIGError::NOERROR()) {
-        makeErrorMessage(impl_->renderer_, message, buffer,
+        makeErrorMessage(context.renderer_, message, buffer,
                          tsig_error.toRcode(), stats_attrs, move(tsig_context));
-        impl_->resumeServer(server, message, stats_attrs, true);
+        resumeServer(server, message, stats_attrs, true);
         return;
     }
 
@@ -560,61 +1147,125 @@ AuthSrv::processMessage(const IOMessage& io_message, Message& message,
 
         // note: This can only be reliable after TSIG check succeeds.
         if (opcode == Opcode::NOTIFY()) {
-            send_answer = impl_->processNotify(io_message, message, buffer,
-                                               move(tsig_context), stats_attrs);
+            send_answer = processNotify(context, io_message, message, buffer,
+                                        move(tsig_context), stats_attrs);
         } else if (opcode == Opcode::UPDATE()) {
-            if (impl_->ddns_forwarder_) {
-                send_answer = impl_->processUpdate(io_message);
+            if (ddns_forwarder_) {
+                send_answer = processUpdate(io_message);
             } else {
-                makeErrorMessage(impl_->renderer_, message, buffer,
-                                 Rcode::NOTIMP(), stats_attrs, move(tsig_context));
+                makeErrorMessage(context.renderer_, message, buffer,
+                                 Rcode::NOTIMP(), stats_attrs,
+                                 move(tsig_context));
             }
         } else if (opcode != Opcode::QUERY()) {
             const IOEndpoint& remote_ep = io_message.getRemoteEndpoint();
             LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_UNSUPPORTED_OPCODE)
                 .arg(message.getOpcode().toText()).arg(remote_ep);
-            makeErrorMessage(impl_->renderer_, message, buffer,
+            makeErrorMessage(context.renderer_, message, buffer,
                              Rcode::NOTIMP(), stats_attrs, move(tsig_context));
         } else if (message.getRRCount(Message::SECTION_QUESTION) != 1) {
-            makeErrorMessage(impl_->renderer_, message, buffer,
+            makeErrorMessage(context.renderer_, message, buffer,
                              Rcode::FORMERR(), stats_attrs, move(tsig_context));
         } else {
             ConstQuestionPtr question = *message.beginQuestion();
             const RRType& qtype = question->getType();
             if (qtype == RRType::AXFR()) {
-                send_answer = impl_->processXfrQuery(io_message, message,
-                                                     buffer, move(tsig_context),
-                                                     stats_attrs);
+                send_answer = processXfrQuery(context, io_message, message,
+                                              buffer, move(tsig_context),
+                                              stats_attrs);
             } else if (qtype == RRType::IXFR()) {
-                send_answer = impl_->processXfrQuery(io_message, message,
-                                                     buffer, move(tsig_context),
-                                                     stats_attrs);
+                send_answer = processXfrQuery(context, io_message, message,
+                                              buffer, move(tsig_context),
+                                              stats_attrs);
             } else {
-                send_answer = impl_->processNormalQuery(io_message, edns,
-                                                        message, buffer,
-                                                        move(tsig_context),
-                                                        stats_attrs);
+                send_answer = processNormalQuery(context, io_message, edns,
+                                                 message, buffer,
+                                                 move(tsig_context),
+                                                 stats_attrs, worker);
             }
         }
+    } catch (const NotInMemory&) {
+        // The data sources changed since the worker checked them
+        deferToMain(io_message);
+        server->resume(false);
+        return;
     } catch (const std::exception& ex) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_FAILURE)
                   .arg(ex.what());
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
-                         stats_attrs);
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::SERVFAIL(), stats_attrs);
     } catch (...) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RESPONSE_FAILURE_UNKNOWN);
-        makeErrorMessage(impl_->renderer_, message, buffer, Rcode::SERVFAIL(),
-                         stats_attrs);
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::SERVFAIL(), stats_attrs);
     }
-    impl_->resumeServer(server, message, stats_attrs, send_answer);
+    resumeServer(server, message, stats_attrs, send_answer);
 }
 
+// Try to answer the query from the answer cache.  The query is only
+// examined with a QueryView, so if it's found, we can answer it without
+// any memory allocation.  This handles only plain queries without TSIG
+// (which are all that can be cached), and returns false for anything else
+// including malformed ones, which are then handled in the normal path.
 bool
-AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
+AuthSrvImpl::processCachedQuery(QueryContext& context,
+                                const IOMessage& io_message,
+                                Message& message, OutputBuffer& buffer,
+                                MessageAttributes& stats_attrs)
+{
+    QueryView& query = context.query_view_;
+    if (!query.fromWire(io_message.getData(), io_message.getDataSize()) ||
+        query.getOpcode() != Opcode::QUERY() ||
+        query.getQType() == RRType::AXFR() ||
+        query.getQType() == RRType::IXFR()) {
+        return (false);
+    }
+
+    const bool udp_buffer =
+        (io_message.getSocket().getProtocol() == IPPROTO_UDP);
+    const size_t length_limit = !udp_buffer ? 65535 :
+        (query.hasEDNS() ? query.getUDPSize() : Message::DEFAULT_MAX_UDPSIZE);
+    {
+        auth::DataSrcClientsMgr::Holder datasrc_holder(datasrc_clients_mgr_);
+        if (!answer_cache_->lookup(query, datasrc_holder.getGeneration(),
+                                   length_limit, buffer)) {
+            return (false);
+        }
+    }
+
+    // Set up the statistics attributes and the message as if they were
+    // done in processMessage() and processNormalQuery().
+    const bool rd = query.getHeaderFlag(Message::HEADERFLAG_RD);
+    stats_attrs.setRequestRD(rd);
+    stats_attrs.setRequestOpCode(Opcode::QUERY());
+    message.clear(Message::RENDER);
+    message.setQid(query.getQid());
+    message.setOpcode(Opcode::QUERY());
+    message.setHeaderFlag(Message::HEADERFLAG_QR);
+    message.setHeaderFlag(Message::HEADERFLAG_RD, rd);
+    if (query.hasEDNS()) {
+        stats_attrs.setRequestEDNS0(true);
+        stats_attrs.setRequestDO(query.getDNSSECAwareness());
+        context.response_edns_->setDNSSECAwareness(
+            query.getDNSSECAwareness());
+        context.response_edns_->setUDPSize(
+            AuthSrvImpl::DEFAULT_LOCAL_UDPSIZE);
+        message.setEDNS(context.response_edns_);
+    }
+    setCachedResponse(message, buffer, stats_attrs);
+    LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_SEND_CACHED_RESPONSE)
+        .arg(buffer.getLength()).arg(query);
+    return (true);
+}
+
+bool
+AuthSrvImpl::processNormalQuery(QueryContext& context,
+                                const IOMessage& io_message,
                                 ConstEDNSPtr remote_edns, Message& message,
                                 OutputBuffer& buffer,
                                 unique_ptr<TSIGContext> tsig_context,
-                                MessageAttributes& stats_attrs)
+                                MessageAttributes& stats_attrs,
+                                QueryWorker* worker)
 {
     const bool dnssec_ok = remote_edns && remote_edns->getDNSSECAwareness();
     const uint16_t remote_bufsize = remote_edns ? remote_edns->getUDPSize() :
@@ -635,6 +1286,35 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
     // the holder until the processing and rendering is done to avoid
     // race with any other thread(s) such as the background loader.
     auth::DataSrcClientsMgr::Holder datasrc_holder(datasrc_clients_mgr_);
+    const uint64_t generation = datasrc_holder.getGeneration();
+    if (worker != NULL && !datasrc_holder.isInMemory()) {
+        context.datasrc_in_memory_ = false;
+        bundy_throw(NotInMemory, "data sources not in memory");
+    }
+
+    const bool udp_buffer =
+        (io_message.getSocket().getProtocol() == IPPROTO_UDP);
+    const size_t length_limit = udp_buffer ? remote_bufsize : 65535;
+
+    // A TSIG-signed response is specific to the request, so the answer
+    // cache is only used for unsigned ones.  Note that the response has
+    // the same ID, RD and CD flags, question and EDNS state as the query
+    // at this point, so it can be used in place of the query.
+    AnswerCache* const answer_cache =
+        tsig_context ? NULL : answer_cache_.get();
+    if (answer_cache != NULL &&
+        answer_cache->lookup(message, generation, length_limit, buffer)) {
+        setCachedResponse(message, buffer, stats_attrs);
+        LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_SEND_CACHED_RESPONSE)
+            .arg(buffer.getLength()).arg(**message.beginQuestion());
+        return (true);
+    }
+
+    // The objects in the arena for the previous query should have been
+    // released with the previous response message by now, in which case
+    // the memory is reused (otherwise the arena simply grows).
+    context.arena_->reset();
+    const Arena::Scope arena_scope(context.arena_);
 
     try {
         const ConstQuestionPtr question = *message.beginQuestion();
@@ -643,28 +1323,38 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
         if (list) {
             const RRType& qtype = question->getType();
             const Name& qname = question->getName();
-            query_.process(*list, qname, qtype, message, dnssec_ok);
+            context.query_.process(*list, qname, qtype, message, dnssec_ok);
         } else {
-            makeErrorMessage(renderer_, message, buffer, Rcode::REFUSED(),
-                             stats_attrs);
+            makeErrorMessage(context.renderer_, message, buffer,
+                             Rcode::REFUSED(), stats_attrs);
             return (true);
         }
     } catch (const bundy::Exception& ex) {
         LOG_ERROR(auth_logger, AUTH_PROCESS_FAIL).arg(ex.what());
-        makeErrorMessage(renderer_, message, buffer, Rcode::SERVFAIL(),
-                         stats_attrs);
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::SERVFAIL(), stats_attrs);
         return (true);
     }
 
-    RendererHolder holder(renderer_, &buffer, stats_attrs);
-    const bool udp_buffer =
-        (io_message.getSocket().getProtocol() == IPPROTO_UDP);
-    renderer_.setLengthLimit(udp_buffer ? remote_bufsize : 65535);
-    message.toWire(renderer_, tsig_context.get());
+    RendererHolder holder(context.renderer_, &buffer, stats_attrs);
+    context.renderer_.setLengthLimit(length_limit);
+    message.toWire(context.renderer_, tsig_context.get());
     stats_attrs.setResponseTSIG(tsig_context.get() != NULL);
 
+    // Responses from zones in memory don't change until the generation of
+    // the data changes, so keep them for subsequent queries.  Truncated
+    // ones depend on the size limit, and errors other than NXDOMAIN are
+    // not worth caching.
+    if (answer_cache != NULL && context.query_.isInMemoryAnswer() &&
+        !context.renderer_.isTruncated() &&
+        (message.getRcode() == Rcode::NOERROR() ||
+         message.getRcode() == Rcode::NXDOMAIN())) {
+        answer_cache->add(message, generation, buffer.getData(),
+                          buffer.getLength());
+    }
+
     LOG_DEBUG(auth_logger, DBG_AUTH_MESSAGES, AUTH_SEND_NORMAL_RESPONSE)
-              .arg(renderer_.getLength()).arg(message);
+              .arg(context.renderer_.getLength()).arg(message);
     return (true);
     // The message can contain some data from the locked resource. But outside
     // this method, we touch only the RCode of it, so it should be safe.
@@ -674,15 +1364,16 @@ AuthSrvImpl::processNormalQuery(const IOMessage& io_message,
 }
 
 bool
-AuthSrvImpl::processXfrQuery(const IOMessage& io_message, Message& message,
+AuthSrvImpl::processXfrQuery(QueryContext& context,
+                             const IOMessage& io_message, Message& message,
                              OutputBuffer& buffer,
                              unique_ptr<TSIGContext> tsig_context,
                              MessageAttributes& stats_attrs)
 {
     if (io_message.getSocket().getProtocol() == IPPROTO_UDP) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_AXFR_UDP);
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
-                         stats_attrs, move(tsig_context));
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::FORMERR(), stats_attrs, move(tsig_context));
         return (true);
     }
 
@@ -691,7 +1382,8 @@ AuthSrvImpl::processXfrQuery(const IOMessage& io_message, Message& message,
 }
 
 bool
-AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
+AuthSrvImpl::processNotify(QueryContext& context,
+                           const IOMessage& io_message, Message& message,
                            OutputBuffer& buffer,
                            std::unique_ptr<TSIGContext> tsig_context,
                            MessageAttributes& stats_attrs)
@@ -703,16 +1395,16 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     if (message.getRRCount(Message::SECTION_QUESTION) != 1) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_NOTIFY_QUESTIONS)
                   .arg(message.getRRCount(Message::SECTION_QUESTION));
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
-                         stats_attrs, move(tsig_context));
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::FORMERR(), stats_attrs, move(tsig_context));
         return (true);
     }
     ConstQuestionPtr question = *message.beginQuestion();
     if (question->getType() != RRType::SOA()) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_NOTIFY_RRTYPE)
                   .arg(question->getType().toText());
-        makeErrorMessage(renderer_, message, buffer, Rcode::FORMERR(),
-                         stats_attrs, move(tsig_context));
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::FORMERR(), stats_attrs, move(tsig_context));
         return (true);
     }
 
@@ -733,8 +1425,8 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     if (!is_auth) {
         LOG_DEBUG(auth_logger, DBG_AUTH_DETAIL, AUTH_RECEIVED_NOTIFY_NOTAUTH)
             .arg(question->getName()).arg(question->getClass()).arg(remote_ep);
-        makeErrorMessage(renderer_, message, buffer, Rcode::NOTAUTH(),
-                         stats_attrs, move(tsig_context));
+        makeErrorMessage(context.renderer_, message, buffer,
+                         Rcode::NOTAUTH(), stats_attrs, move(tsig_context));
         return (true);
     }
 
@@ -793,8 +1485,8 @@ AuthSrvImpl::processNotify(const IOMessage& io_message, Message& message,
     message.setHeaderFlag(Message::HEADERFLAG_AA);
     message.setRcode(Rcode::NOERROR());
 
-    RendererHolder holder(renderer_, &buffer, stats_attrs);
-    message.toWire(renderer_, tsig_context.get());
+    RendererHolder holder(context.renderer_, &buffer, stats_attrs);
+    message.toWire(context.renderer_, tsig_context.get());
     stats_attrs.setResponseTSIG(tsig_context.get() != NULL);
     return (true);
 }
@@ -843,10 +1535,101 @@ AuthSrv::getListenAddresses() const {
 
 void
 AuthSrv::setListenAddresses(const AddressList& addresses) {
-    // For UDP servers we specify the "SYNC_OK" option because in our usage
-    // it can act in the synchronous mode.
-    installListenAddresses(addresses, impl_->listen_addresses_, *dnss_,
-                           DNSService::SERVER_SYNC_OK);
+    // For UDP servers we specify the "SYNC_OK" option (or "BATCH", which
+    // implies it) because in our usage it can act in the synchronous mode.
+    if (impl_->workers_.empty()) {
+        installListenAddresses(addresses, impl_->listen_addresses_, *dnss_,
+                               impl_->udp_server_options_);
+        return;
+    }
+
+    // With query worker threads, the UDP sockets are distributed over the
+    // workers.  The workers are stopped while the sockets are replaced,
+    // and restarted even on failure (in which case the previous sockets
+    // have been restored).
+    WorkerDNSService service(*dnss_, *impl_);
+    try {
+        installListenAddresses(addresses, impl_->listen_addresses_, service,
+                               impl_->udp_server_options_);
+    } catch (...) {
+        impl_->startWorkers();
+        throw;
+    }
+    impl_->startWorkers();
+}
+
+void
+AuthSrv::setWorkerThreads(size_t worker_count) {
+    if (worker_count == impl_->workers_.size()) {
+        return;
+    }
+    LOG_INFO(auth_logger, AUTH_WORKER_THREADS).arg(worker_count);
+
+    // Stopping and discarding the current workers closes their sockets.
+    // The listening sockets are then installed again so that they are
+    // distributed over the new workers (or served by the main thread if
+    // there's no worker).
+    impl_->stopWorkers();
+    impl_->workers_.clear();
+    impl_->releaseWorkerSockets();
+    if (worker_count > 0 && !impl_->deferred_queue_) {
+        impl_->deferred_queue_.reset(
+            new DeferredQueue(impl_->io_service_,
+                              boost::bind(&AuthSrvImpl::processDeferred,
+                                          impl_, _1)));
+    }
+    for (size_t i = 0; i < worker_count; ++i) {
+        impl_->workers_.push_back(QueryWorkerPtr(new QueryWorker(*impl_)));
+    }
+    if (dnss_ != NULL) {
+        const AddressList addresses(impl_->listen_addresses_);
+        setListenAddresses(addresses);
+    }
+}
+
+size_t
+AuthSrv::getWorkerThreads() const {
+    return (impl_->workers_.size());
+}
+
+void
+AuthSrv::setUDPBatching(bool batching) {
+    const DNSService::ServerFlag options = batching ?
+        DNSService::SERVER_BATCH : DNSService::SERVER_SYNC_OK;
+    if (options == impl_->udp_server_options_) {
+        return;
+    }
+    impl_->udp_server_options_ = options;
+
+    // Re-install the listening sockets so the new type of server is used.
+    if (dnss_ != NULL) {
+        const AddressList addresses(impl_->listen_addresses_);
+        setListenAddresses(addresses);
+    }
+}
+
+void
+AuthSrv::setAnswerCacheSize(size_t size) {
+    if (size == getAnswerCacheSize()) {
+        return;
+    }
+    LOG_INFO(auth_logger, AUTH_ANSWER_CACHE_SIZE).arg(size);
+
+    // The cache is used by the query worker threads, so stop them while
+    // replacing it.
+    impl_->stopWorkers();
+    impl_->answer_cache_.reset(size > 0 ? new AnswerCache(size) : NULL);
+    impl_->startWorkers();
+}
+
+size_t
+AuthSrv::getAnswerCacheSize() const {
+    return (impl_->answer_cache_ ? impl_->answer_cache_->getSize() : 0);
+}
+
+bool
+AuthSrv::getUDPBatching() const {
+    return (impl_->udp_server_options_ == DNSService::SERVER_BATCH);
 }
 
 void
@@ -270,6 +270,55 @@ public:
     /// open forever.
     void setTCPRecvTimeout(size_t timeout);
 
+    /// \brief Set the number of query worker threads.
+    ///
+    /// If it's non 0, UDP queries are received and processed by the given
+    /// number of threads, each with its own socket(s) sharing the listen
+    /// addresses, instead of the main thread.  TCP queries and requests that
+    /// need to update the server state (such as NOTIFY, UPDATE, or
+    /// TSIG-signed ones) are still handled in the main thread.
+    ///
+    /// If the listen addresses have already been set, the sockets are
+    /// re-installed so that they are distributed over the new workers.
+    ///
+    /// \param worker_count The number of worker threads; 0 to process all
+    /// queries in the main thread.
+    void setWorkerThreads(size_t worker_count);
+
+    /// \brief Return the number of query worker threads.
+    size_t getWorkerThreads() const;
+
+    /// \brief Enable or disable batched processing of UDP queries.
+    ///
+    /// If enabled, the UDP servers receive and answer multiple queries at a
+    /// time where possible (see \c bundy::asiodns::BatchUDPServer), which
+    /// reduces the number of system calls per query under heavy load.
+    ///
+    /// If the listen addresses have already been set, the sockets are
+    /// re-installed so that the new setting takes effect.
+    void setUDPBatching(bool batching);
+
+    /// \brief Return whether batched processing of UDP queries is enabled.
+    bool getUDPBatching() const;
+
+    /// \brief Set the size of the cache of rendered responses.
+    ///
+    /// If it's non 0, responses to normal queries that are built from zones
+    /// in memory are kept in wire format (see \c AnswerCache), up to the
+    /// given number, and the same queries are answered from the cache
+    /// until any zone is loaded again or the data sources are reconfigured.
+    /// The current content of the cache is discarded.
+    ///
+    /// \param size The maximum number of cached responses (rounded up to a
+    /// power of 2); 0 to disable the cache.
+    void setAnswerCacheSize(size_t size);
+
+    /// \brief Return the size of the cache of rendered responses.
+    ///
+    /// \return The maximum number of cached responses; 0 if the cache is
+    /// disabled.
+    size_t getAnswerCacheSize() const;
+
     /// \brief Notify the authoritative server that the client lists were
     ///     reconfigured.
     ///
@@ -156,9 +156,12 @@ struct Command {
 /// This class is templated only so that we can test the class without
 /// involving actual threads or mutex.  Normal applications will only
 /// need one specific specialization that has a typedef of
-/// \c DataSrcClientsMgr.
+/// \c DataSrcClientsMgr.  \c MapMutexType is the type of the lock
+/// protecting the client lists; it must provide a shared \c ReadLocker
+/// (used by \c Holder) in addition to the exclusive \c Locker, so that
+/// multiple query processing threads can look up the lists concurrently.
 template <typename ThreadType, typename BuilderType, typename MutexType,
-          typename CondVarType>
+          typename CondVarType, typename MapMutexType = MutexType>
 class DataSrcClientsMgrBase : boost::noncopyable {
 private:
     typedef std::map<dns::RRClass,
@@ -191,6 +194,9 @@ public:
     /// It ensures the result of \c getClientList() can be used without
     /// causing a race condition with other threads that can possibly use
     /// the same manager throughout the lifetime of the holder object.
+    /// The lock it holds is a shared one, so holders in different query
+    /// processing threads don't block each other; only updates of the
+    /// lists by the builder thread are excluded.
     ///
     /// This also means the holder object is expected to have a short lifetime.
     /// The application shouldn't try to keep it unnecessarily long.
@@ -247,9 +253,45 @@ public:
             }
             return (result);
         }
+
+        /// \brief Return the current generation of the data.
+        ///
+        /// The returned value is changed whenever the data that can be
+        /// found via the client lists may have changed, i.e., when the
+        /// lists are replaced, a zone is loaded into memory, or a memory
+        /// segment is reset.  It doesn't change while the holder exists,
+        /// so it can be used to tell whether some result built from the
+        /// data in the past is still valid; note, however, that changes
+        /// made to the underlying data sources directly (such as updates
+        /// to a database) are not detected by this value.
+        uint64_t getGeneration() const {
+            return (mgr_.data_generation_);
+        }
+
+        /// \brief Return whether all the data is served from memory.
+        ///
+        /// This is true if every data source of every client list has its
+        /// data cached in memory, so the lists only use the in-memory
+        /// clients to find zones.  These are the only clients that can be
+        /// used from multiple threads at the same time; the others (such
+        /// as the database based ones) must be used from a single thread.
+        bool isInMemory() const {
+            for (ClientListsMap::const_iterator it =
+                 mgr_.clients_map_->begin(); it != mgr_.clients_map_->end();
+                 ++it) {
+                BOOST_FOREACH(const datasrc::ConfigurableClientList::
+                              DataSourceInfo& info,
+                              it->second->getDataSources()) {
+                    if (!info.cache_) {
+                        return (false);
+                    }
+                }
+            }
+            return (true);
+        }
     private:
         DataSrcClientsMgrBase& mgr_;
-        typename MutexType::Locker locker_;
+        typename MapMutexType::ReadLocker locker_;
     };
 
     /// \brief Constructor.
@@ -268,8 +310,9 @@ public:
         clients_map_(new ClientListsMap),
         fd_guard_(new FDGuard(this)),
         read_fd_(-1), write_fd_(-1),
+        data_generation_(0),
         builder_(&command_queue_, &callback_queue_, &cond_, &queue_mutex_,
-                 &clients_map_, &map_mutex_, createFds()),
+                 &clients_map_, &map_mutex_, &data_generation_, createFds()),
         builder_thread_(boost::bind(&BuilderType::run, &builder_)),
         wakeup_socket_(service, read_fd_)
     {
@@ -352,8 +395,9 @@ public:
     /// cleaner way to use faked data source clients.  Non test code or
     /// newer tests must not use this.
     void setDataSrcClientLists(datasrc::ClientListMapPtr new_lists) {
-        typename MutexType::Locker locker(map_mutex_);
+        typename MapMutexType::Locker locker(map_mutex_);
         clients_map_ = new_lists;
+        ++data_generation_;
     }
 
     /// \brief Instruct internal thread to (re)load a zone
@@ -567,7 +611,9 @@ private:
                                 // map of actual data source client objects
     boost::scoped_ptr<FDGuard> fd_guard_; // A guard to close the fds.
     int read_fd_, write_fd_;    // Descriptors for wakeup
-    MutexType map_mutex_;       // mutex to protect the clients map
+    MapMutexType map_mutex_;    // lock to protect the clients map
+    uint64_t data_generation_;  // see Holder::getGeneration(), protected
+                                // by map_mutex_
 
     BuilderType builder_;
     ThreadType builder_thread_; // for safety this should be placed last
@@ -593,7 +639,8 @@ namespace datasrc_clientmgr_internal {
 ///
 /// This class is templated so that we can test it without involving actual
 /// threads or locks.
-template <typename MutexType, typename CondVarType>
+template <typename MutexType, typename CondVarType,
+          typename MapMutexType = MutexType>
 class DataSrcClientsBuilderBase : boost::noncopyable {
 private:
     typedef std::map<dns::RRClass,
@@ -621,12 +668,14 @@ public:
                               std::list<FinishedCallbackPair>* callback_queue,
                               CondVarType* cond, MutexType* queue_mutex,
                               datasrc::ClientListMapPtr* clients_map,
-                              MutexType* map_mutex,
+                              MapMutexType* map_mutex,
+                              uint64_t* data_generation,
                               int wake_fd
         ) :
         command_queue_(command_queue), callback_queue_(callback_queue),
         cond_(cond), queue_mutex_(queue_mutex),
-        clients_map_(clients_map), map_mutex_(map_mutex), wake_fd_(wake_fd),
+        clients_map_(clients_map), map_mutex_(map_mutex),
+        data_generation_(data_generation), wake_fd_(wake_fd),
         gen_id_(-1)
     {}
 
@@ -686,8 +735,9 @@ private:
         // this way, after the swap, the lock is guaranteed to be released
         // before the old data is destroyed, minimizing the lock duration.
         {
-            typename MutexType::Locker locker(*map_mutex_);
+            typename MapMutexType::Locker locker(*map_mutex_);
             pending_map_->clients_map_.swap(*clients_map_);
+            ++*data_generation_;
         } // lock is released by leaving scope
           // old clients_map_ data is released by leaving scope
 
@@ -807,7 +857,7 @@ private:
             }
         }
 
-        typename MutexType::Locker locker(*map_mutex_);
+        typename MapMutexType::Locker locker(*map_mutex_);
         if (!list->resetMemorySegment(
                 dsrc_name, bundy::datasrc::memory::ZoneTableSegment::READ_ONLY,
                 segment_params)) {
@@ -816,6 +866,7 @@ private:
                 .arg(rrclass).arg(dsrc_name);
             std::terminate();
         }
+        ++*data_generation_;
     }
 
     void doSegmentUpdate(const bundy::data::ConstElementPtr& arg) {
@@ -887,7 +938,8 @@ private:
     CondVarType* cond_;
     MutexType* queue_mutex_;
     datasrc::ClientListMapPtr* clients_map_;
-    MutexType* map_mutex_;
+    MapMutexType* map_mutex_;
+    uint64_t* data_generation_;
     int wake_fd_;
 
     // These are local to the builder thread:
@@ -913,12 +965,13 @@ private:
 };
 
 // Shortcut typedef for normal use
-typedef DataSrcClientsBuilderBase<util::thread::Mutex, util::thread::CondVar>
+typedef DataSrcClientsBuilderBase<util::thread::Mutex, util::thread::CondVar,
+                                  util::thread::RWMutex>
 DataSrcClientsBuilder;
 
-template <typename MutexType, typename CondVarType>
+template <typename MutexType, typename CondVarType, typename MapMutexType>
 void
-DataSrcClientsBuilderBase<MutexType, CondVarType>::run() {
+DataSrcClientsBuilderBase<MutexType, CondVarType, MapMutexType>::run() {
     LOG_INFO(auth_logger, AUTH_DATASRC_CLIENTS_BUILDER_STARTED);
 
     try {
@@ -985,9 +1038,9 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::run() {
     }
 }
 
-template <typename MutexType, typename CondVarType>
+template <typename MutexType, typename CondVarType, typename MapMutexType>
 bool
-DataSrcClientsBuilderBase<MutexType, CondVarType>::handleCommand(
+DataSrcClientsBuilderBase<MutexType, CondVarType, MapMutexType>::handleCommand(
     const Command& command)
 {
     const CommandID cid = command.id;
@@ -1036,9 +1089,9 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::handleCommand(
     return (keep_running);
 }
 
-template <typename MutexType, typename CondVarType>
+template <typename MutexType, typename CondVarType, typename MapMutexType>
 void
-DataSrcClientsBuilderBase<MutexType, CondVarType>::doUpdateZone(
+DataSrcClientsBuilderBase<MutexType, CondVarType, MapMutexType>::doUpdateZone(
     datasrc_clientmgr_internal::CommandID command,
     const bundy::data::ConstElementPtr& arg)
 {
@@ -1085,8 +1138,9 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::doUpdateZone(
 
         zwriter->load(); // this can take time but doesn't cause a race
         {   // install() can cause a race and must be in a critical section
-            typename MutexType::Locker locker(*map_mutex_);
+            typename MapMutexType::Locker locker(*map_mutex_);
             zwriter->install();
+            ++*data_generation_;
         }
         LOG_DEBUG(auth_logger, DBG_AUTH_OPS,
                   AUTH_DATASRC_CLIENTS_BUILDER_LOAD_ZONE)
@@ -1109,9 +1163,9 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::doUpdateZone(
 
 // A dedicated subroutine of doUpdateZone().  Separated just for keeping the
 // main method concise.
-template <typename MutexType, typename CondVarType>
+template <typename MutexType, typename CondVarType, typename MapMutexType>
 boost::shared_ptr<datasrc::memory::ZoneWriter>
-DataSrcClientsBuilderBase<MutexType, CondVarType>::getZoneWriter(
+DataSrcClientsBuilderBase<MutexType, CondVarType, MapMutexType>::getZoneWriter(
     datasrc_clientmgr_internal::CommandID command,
     datasrc::ConfigurableClientList& client_list,
     const std::string& datasrc_name, const dns::RRClass& rrclass,
@@ -1122,7 +1176,7 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::getZoneWriter(
     // source for lookup.  So we need to protect the access here.
     datasrc::ConfigurableClientList::ZoneWriterPair writerpair;
     {
-        typename MutexType::Locker locker(*map_mutex_);
+        typename MapMutexType::Locker locker(*map_mutex_);
         writerpair = client_list.getCachedZoneWriter(origin, false,
                                                      datasrc_name);
     }
@@ -1163,9 +1217,9 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::getZoneWriter(
     return (boost::shared_ptr<datasrc::memory::ZoneWriter>());
 }
 
-template <typename MutexType, typename CondVarType>
+template <typename MutexType, typename CondVarType, typename MapMutexType>
 FinishedCallback
-DataSrcClientsBuilderBase<MutexType, CondVarType>::doReleaseSegments(
+DataSrcClientsBuilderBase<MutexType, CondVarType, MapMutexType>::doReleaseSegments(
     const Command& command)
 {
     try {
@@ -1206,7 +1260,8 @@ DataSrcClientsBuilderBase<MutexType, CondVarType>::doReleaseSegments(
 typedef DataSrcClientsMgrBase<
     util::thread::Thread,
     datasrc_clientmgr_internal::DataSrcClientsBuilder,
-    util::thread::Mutex, util::thread::CondVar> DataSrcClientsMgr;
+    util::thread::Mutex, util::thread::CondVar,
+    util::thread::RWMutex> DataSrcClientsMgr;
 } // namespace auth
 } // namespace bundy
 
@@ -20,6 +20,7 @@
 
 #include <datasrc/client.h>
 #include <datasrc/client_list.h>
+#include <datasrc/memory/memory_client.h>
 
 #include <auth/query.h>
 
@@ -338,6 +339,13 @@ findZone(const ClientList& list, const Name& qname, RRType qtype) {
     }
     return (list.find(qname.split(1)));
 }
+
+// Whether the zone found in a client list is served from memory.
+bool
+isInMemory(const ClientList::FindResult& result) {
+    return (dynamic_cast<const datasrc::memory::InMemoryClient*>(
+                result.dsrc_client_) != NULL);
+}
 }
 
 void
@@ -355,6 +363,7 @@ Query::process(datasrc::ClientList& client_list,
     // Found a zone which is the nearest ancestor to QNAME
     const ClientList::FindResult result = findZone(*client_list_, *qname_,
                                                    *qtype_);
+    in_memory_ = isInMemory(result);
 
     // If we have no matching authoritative zone for the query name, return
     // REFUSED.  In short, this is to be compatible with BIND 9, but the
@@ -554,6 +563,7 @@ Query::initialize(datasrc::ClientList& client_list,
     dnssec_ = dnssec;
     dnssec_opt_ = (dnssec ? bundy::datasrc::ZoneFinder::FIND_DNSSEC :
                    bundy::datasrc::ZoneFinder::FIND_DEFAULT);
+    in_memory_ = false;
 }
 
 void
@@ -575,6 +585,7 @@ Query::processDSAtChild() {
     if (zresult.dsrc_client_ == NULL) {
         return (false);
     }
+    in_memory_ = isInMemory(zresult);
 
     // We are receiving a DS query at the child side of the owner name,
     // where the DS isn't supposed to belong.  We should return a "no data"
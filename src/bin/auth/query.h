@@ -281,7 +281,7 @@ public:
     Query() :
         client_list_(NULL), qname_(NULL), qtype_(NULL),
         dnssec_(false), dnssec_opt_(bundy::datasrc::ZoneFinder::FIND_DEFAULT),
-        response_(NULL)
+        response_(NULL), in_memory_(false)
     {
         answers_.reserve(RESERVE_RRSETS);
         authorities_.reserve(RESERVE_RRSETS);
@@ -330,6 +330,15 @@ public:
                  const bundy::dns::Name& qname, const bundy::dns::RRType& qtype,
                  bundy::dns::Message& response, bool dnssec = false);
 
+    /// \brief Return whether the last response was built from data in
+    /// memory.
+    ///
+    /// This returns true iff the zone used for the last call to
+    /// \c process() is served from the in-memory cache of its data source.
+    /// The response to the same query can then only change when the zone
+    /// is loaded into memory again.
+    bool isInMemoryAnswer() const { return (in_memory_); }
+
     /// \short Bad zone data encountered.
     ///
     /// This is thrown when a process encounters a misconfigured zone in a
@@ -492,6 +501,10 @@ private:
     std::vector<bundy::dns::ConstRRsetPtr> authorities_;
     std::vector<bundy::dns::ConstRRsetPtr> additionals_;
 
+    // See isInMemoryAnswer().  Unlike the others, this isn't cleared on
+    // reset(), so it's available after process() returns.
+    bool in_memory_;
+
 private:
     /// \brief Returns a reference to a pre-initialized vector (see the
     /// \c Query constructor).
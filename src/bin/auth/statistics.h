@@ -21,6 +21,7 @@
 #include <dns/opcode.h>
 
 #include <statistics/counter.h>
+#include <statistics/histogram.h>
 
 #include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
@@ -63,6 +64,7 @@ private:
     int req_address_family_;        // IP version
     int req_transport_protocol_;    // Transport layer protocol
     boost::optional<bundy::dns::Opcode> req_opcode_;  // OpCode
+    uint64_t req_time_;             // When the request was received
     enum BitAttributes {
         REQ_WITH_EDNS_0,            // request with EDNS ver.0
         REQ_WITH_DNSSEC_OK,         // DNSSEC OK (DO) bit is set in request
@@ -72,6 +74,8 @@ private:
         REQ_BADSIG,                 // request is signed but bad signature
         RES_IS_TRUNCATED,           // response is truncated
         RES_TSIG_SIGNED,            // response is signed with TSIG
+        RES_CACHED_ANSWER,          // response is a cached one and has
+                                    // RRs in the answer section
         BIT_ATTRIBUTES_TYPES
     };
     std::bitset<BIT_ATTRIBUTES_TYPES> bit_attributes_;
@@ -79,9 +83,31 @@ public:
     /// \brief The constructor.
     ///
     /// \throw None
-    MessageAttributes() : req_address_family_(0), req_transport_protocol_(0)
+    MessageAttributes() :
+        req_address_family_(0), req_transport_protocol_(0), req_time_(0)
     {}
 
+    /// \brief Return the time the request was received.
+    ///
+    /// \return the time in microseconds, as returned by
+    ///         \c bundy::statistics::getMicroseconds(); 0 if it hasn't
+    ///         been set.
+    /// \throw None
+    uint64_t getRequestTime() const {
+        return (req_time_);
+    }
+
+    /// \brief Set the time the request was received.
+    ///
+    /// The latency of the response is measured from this time.
+    ///
+    /// \param req_time the time in microseconds, as returned by
+    ///                 \c bundy::statistics::getMicroseconds()
+    /// \throw None
+    void setRequestTime(const uint64_t req_time) {
+        req_time_ = req_time;
+    }
+
     /// \brief Return opcode of the request.
     ///
     /// \return opcode of the request wrapped with boost::optional; it's
@@ -251,6 +277,30 @@ public:
     void setResponseTSIG(const bool signed_tsig) {
         bit_attributes_[RES_TSIG_SIGNED] = signed_tsig;
     }
+
+    /// \brief Return whether the response is a cached one that has RRs
+    /// in the answer section.
+    ///
+    /// \return true if the response is answered from the cache of rendered
+    ///         responses and its answer section is not empty
+    /// \throw None
+    bool responseHasCachedAnswer() const {
+        return (bit_attributes_[RES_CACHED_ANSWER]);
+    }
+
+    /// \brief Set whether the response is a cached one that has RRs in the
+    /// answer section.
+    ///
+    /// When a response is answered from the cache of rendered responses,
+    /// the response message object doesn't contain the RRsets, so the
+    /// existence of answer RRs is given via this attribute instead.
+    ///
+    /// \param cached_answer true if the response is a cached one and its
+    ///                      answer section is not empty
+    /// \throw None
+    void setResponseCachedAnswer(const bool cached_answer) {
+        bit_attributes_[RES_CACHED_ANSWER] = cached_answer;
+    }
 };
 
 /// \brief Set of DNS message counters.
@@ -263,6 +313,10 @@ public:
 /// Call \c inc() to increment a counter for the message.
 /// Call \c get() to get a set of DNS message counters.
 ///
+/// Besides the counters, it keeps a histogram of the latencies of the
+/// responses (the time from receiving the request to sending the response),
+/// reported as percentiles.
+///
 /// We may eventually want to change the structure to hold values that are
 /// not counters (such as concurrent TCP connections), or seperate generic
 /// part to src/lib to share with the other modules.
@@ -275,6 +329,8 @@ class Counters : boost::noncopyable {
 private:
     // counter for DNS message attributes
     bundy::statistics::Counter server_msg_counter_;
+    // latencies of the responses, in microseconds
+    bundy::statistics::Histogram latency_;
     void incRequest(const MessageAttributes& msgattrs);
     void incResponse(const MessageAttributes& msgattrs,
                      const bundy::dns::Message& response);
@@ -282,14 +338,21 @@ public:
     /// \brief A type of statistics item tree in bundy::data::MapElement.
     /// \verbatim
     ///        {
-    ///          zone_name => {
-    ///                         item_name => item_value,
-    ///                         item_name => item_value, ...
-    ///                       },
-    ///          ...
+    ///          "zones" => {
+    ///            zone_name => {
+    ///                           item_name => item_value,
+    ///                           item_name => item_value, ...
+    ///                         },
+    ///            ...
+    ///          },
+    ///          "latency" => {
+    ///            "count" => count, "p50" => p50, "p90" => p90,
+    ///            "p99" => p99, "p999" => p999
+    ///          }
     ///        }
     ///        item_name is a string seperated by '.'.
     ///        item_value is an integer.
+    ///        The latency percentiles are in microseconds.
     /// \endverbatim
     typedef bundy::data::ConstElementPtr ConstItemTreePtr;
 
@@ -301,6 +364,9 @@ public:
 
     /// \brief Increment counters according to the parameters.
     ///
+    /// If the response was sent and the time of the request is set in
+    /// \c msgattrs, this also records the latency of the response.
+    ///
     /// \param msgattrs DNS message attributes.
     /// \param response DNS response message.
     /// \param done DNS response was sent to the client.
@@ -0,0 +1,254 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <auth/answer_cache.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/edns.h>
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/query_view.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+#include <dns/rdataclass.h>
+
+#include <util/buffer.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace bundy::dns;
+using namespace bundy::auth;
+using bundy::util::OutputBuffer;
+
+namespace {
+
+class AnswerCacheTest : public ::testing::Test {
+protected:
+    AnswerCacheTest() :
+        cache_(16), query_(Message::RENDER), response_(0), buffer_(0)
+    {
+        setQuery(query_, 0x1234, Name("www.example.com"), RRType::A());
+        createResponse(query_, response_);
+    }
+
+    // Set up a query message.
+    void setQuery(Message& query, qid_t qid, const Name& qname,
+                  const RRType& qtype)
+    {
+        query.clear(Message::RENDER);
+        query.setQid(qid);
+        query.setOpcode(Opcode::QUERY());
+        query.setRcode(Rcode::NOERROR());
+        query.setHeaderFlag(Message::HEADERFLAG_RD);
+        query.addQuestion(Question(qname, RRClass::IN(), qtype));
+    }
+
+    // Render a response to the query.
+    void createResponse(const Message& query, OutputBuffer& response) {
+        Message message(Message::RENDER);
+        message.setQid(query.getQid());
+        message.setOpcode(Opcode::QUERY());
+        message.setRcode(Rcode::NOERROR());
+        message.setHeaderFlag(Message::HEADERFLAG_QR);
+        message.setHeaderFlag(Message::HEADERFLAG_AA);
+        message.setHeaderFlag(Message::HEADERFLAG_RD,
+                              query.getHeaderFlag(Message::HEADERFLAG_RD));
+        const Question& question = **query.beginQuestion();
+        message.addQuestion(question);
+        RRsetPtr rrset(new RRset(question.getName(), RRClass::IN(),
+                                 RRType::A(), RRTTL(3600)));
+        rrset->addRdata(rdata::in::A("192.0.2.1"));
+        message.addRRset(Message::SECTION_ANSWER, rrset);
+        if (query.getEDNS()) {
+            EDNSPtr edns(new EDNS());
+            edns->setDNSSECAwareness(query.getEDNS()->getDNSSECAwareness());
+            message.setEDNS(edns);
+        }
+        MessageRenderer renderer;
+        renderer.setBuffer(&response);
+        message.toWire(renderer);
+        renderer.setBuffer(NULL);
+    }
+
+    void addResponse(uint64_t generation) {
+        cache_.add(query_, generation, response_.getData(),
+                   response_.getLength());
+    }
+
+    AnswerCache cache_;
+    Message query_;
+    OutputBuffer response_;
+    OutputBuffer buffer_;
+};
+
+TEST_F(AnswerCacheTest, size) {
+    EXPECT_EQ(16, cache_.getSize());
+    EXPECT_EQ(1, AnswerCache(1).getSize());
+    EXPECT_EQ(1024, AnswerCache(1000).getSize());
+    EXPECT_THROW(AnswerCache(0), bundy::InvalidParameter);
+}
+
+TEST_F(AnswerCacheTest, lookup) {
+    // Nothing is cached initially.
+    EXPECT_FALSE(cache_.lookup(query_, 1, 65535, buffer_));
+    EXPECT_EQ(0, buffer_.getLength());
+
+    // Once added, the response is returned as it is for the same query.
+    addResponse(1);
+    EXPECT_TRUE(cache_.lookup(query_, 1, 65535, buffer_));
+    ASSERT_EQ(response_.getLength(), buffer_.getLength());
+    EXPECT_EQ(0, memcmp(response_.getData(), buffer_.getData(),
+                        buffer_.getLength()));
+}
+
+TEST_F(AnswerCacheTest, patchQuery) {
+    addResponse(1);
+
+    // A query for the same question with a different ID, flags and case of
+    // the name.  The cached response should be adjusted to it, so it's
+    // the same as one that would be rendered for this query.
+    Message query(Message::RENDER);
+    setQuery(query, 0xabcd, Name("WWW.Example.COM"), RRType::A());
+    query.setHeaderFlag(Message::HEADERFLAG_RD, false);
+    query.setHeaderFlag(Message::HEADERFLAG_CD);
+    EXPECT_TRUE(cache_.lookup(query, 1, 65535, buffer_));
+
+    OutputBuffer expected(0);
+    createResponse(query, expected);
+    // (createResponse() doesn't copy CD)
+    expected.writeUint8At(expected[3] | (Message::HEADERFLAG_CD & 0xff), 3);
+    ASSERT_EQ(expected.getLength(), buffer_.getLength());
+    EXPECT_EQ(0, memcmp(expected.getData(), buffer_.getData(),
+                        buffer_.getLength()));
+
+    Message parsed(Message::PARSE);
+    bundy::util::InputBuffer ibuffer(buffer_.getData(), buffer_.getLength());
+    parsed.fromWire(ibuffer);
+    EXPECT_EQ(0xabcd, parsed.getQid());
+    EXPECT_FALSE(parsed.getHeaderFlag(Message::HEADERFLAG_RD));
+    EXPECT_TRUE(parsed.getHeaderFlag(Message::HEADERFLAG_CD));
+    EXPECT_TRUE(parsed.getHeaderFlag(Message::HEADERFLAG_AA));
+    EXPECT_EQ("WWW.Example.COM.",
+              (*parsed.beginQuestion())->getName().toText());
+}
+
+TEST_F(AnswerCacheTest, lookupQueryView) {
+    addResponse(1);
+
+    // A query given as a QueryView works the same way as a Message.
+    Message query(Message::RENDER);
+    setQuery(query, 0xabcd, Name("WWW.Example.COM"), RRType::A());
+    query.setHeaderFlag(Message::HEADERFLAG_CD);
+    EXPECT_TRUE(cache_.lookup(query, 1, 65535, buffer_));
+
+    MessageRenderer renderer;
+    query.toWire(renderer);
+    QueryView view;
+    ASSERT_TRUE(view.fromWire(renderer.getData(), renderer.getLength()));
+    OutputBuffer buffer(0);
+    EXPECT_TRUE(cache_.lookup(view, 1, 65535, buffer));
+    ASSERT_EQ(buffer_.getLength(), buffer.getLength());
+    EXPECT_EQ(0, memcmp(buffer_.getData(), buffer.getData(),
+                        buffer.getLength()));
+
+    // The EDNS state of the query is part of the key.
+    EDNSPtr edns(new EDNS());
+    query.setEDNS(edns);
+    renderer.clear();
+    query.toWire(renderer);
+    ASSERT_TRUE(view.fromWire(renderer.getData(), renderer.getLength()));
+    buffer.clear();
+    EXPECT_FALSE(cache_.lookup(view, 1, 65535, buffer));
+    EXPECT_EQ(0, buffer.getLength());
+}
+
+TEST_F(AnswerCacheTest, generation) {
+    // A response built from data of another generation can't be used.
+    addResponse(1);
+    EXPECT_FALSE(cache_.lookup(query_, 2, 65535, buffer_));
+    EXPECT_EQ(0, buffer_.getLength());
+
+    // It can be replaced with one for the new generation.
+    addResponse(2);
+    EXPECT_TRUE(cache_.lookup(query_, 2, 65535, buffer_));
+    buffer_.clear();
+    EXPECT_FALSE(cache_.lookup(query_, 1, 65535, buffer_));
+}
+
+TEST_F(AnswerCacheTest, tooLong) {
+    addResponse(1);
+    EXPECT_FALSE(cache_.lookup(query_, 1, response_.getLength() - 1,
+                               buffer_));
+    EXPECT_TRUE(cache_.lookup(query_, 1, response_.getLength(), buffer_));
+}
+
+TEST_F(AnswerCacheTest, differentQuestion) {
+    addResponse(1);
+
+    Message query(Message::RENDER);
+    setQuery(query, 0x1234, Name("www.example.com"), RRType::AAAA());
+    EXPECT_FALSE(cache_.lookup(query, 1, 65535, buffer_));
+    setQuery(query, 0x1234, Name("www2.example.com"), RRType::A());
+    EXPECT_FALSE(cache_.lookup(query, 1, 65535, buffer_));
+    query.clear(Message::RENDER);
+    query.addQuestion(Question(Name("www.example.com"), RRClass::CH(),
+                               RRType::A()));
+    EXPECT_FALSE(cache_.lookup(query, 1, 65535, buffer_));
+}
+
+TEST_F(AnswerCacheTest, edns) {
+    // Responses are cached separately depending on the existence of EDNS
+    // and the DO bit.
+    Message query_edns(Message::RENDER);
+    setQuery(query_edns, 0x1234, Name("www.example.com"), RRType::A());
+    query_edns.setEDNS(EDNSPtr(new EDNS()));
+    Message query_do(Message::RENDER);
+    setQuery(query_do, 0x1234, Name("www.example.com"), RRType::A());
+    EDNSPtr edns_do(new EDNS());
+    edns_do->setDNSSECAwareness(true);
+    query_do.setEDNS(edns_do);
+
+    addResponse(1);
+    EXPECT_FALSE(cache_.lookup(query_edns, 1, 65535, buffer_));
+    EXPECT_FALSE(cache_.lookup(query_do, 1, 65535, buffer_));
+
+    OutputBuffer response_do(0);
+    createResponse(query_do, response_do);
+    // Use a larger cache so the responses don't override each other.
+    AnswerCache cache(1024);
+    cache.add(query_, 1, response_.getData(), response_.getLength());
+    cache.add(query_do, 1, response_do.getData(), response_do.getLength());
+    EXPECT_FALSE(cache.lookup(query_edns, 1, 65535, buffer_));
+    EXPECT_TRUE(cache.lookup(query_do, 1, 65535, buffer_));
+    EXPECT_EQ(response_do.getLength(), buffer_.getLength());
+    buffer_.clear();
+    EXPECT_TRUE(cache.lookup(query_, 1, 65535, buffer_));
+    EXPECT_EQ(response_.getLength(), buffer_.getLength());
+}
+
+TEST_F(AnswerCacheTest, shortResponse) {
+    EXPECT_THROW(cache_.add(query_, 1, response_.getData(), 12),
+                 bundy::InvalidParameter);
+}
+
+}
@@ -1292,6 +1292,53 @@ TEST_F(AuthSrvTest, chQueryWithInMemoryClient) {
                 opcode.getCode(), QR_FLAG | AA_FLAG, 1, 1, 1, 0);
 }
 
+TEST_F(AuthSrvTest, queryWithAnswerCache) {
+    server.setAnswerCacheSize(16);
+    updateInMemory(server, "example.", CONFIG_INMEMORY_EXAMPLE);
+
+    // The first response is built from the zone and cached.
+    UnitTestUtil::createRequestMessage(request_message, Opcode::QUERY(),
+                                       default_qid, Name("ai.example"),
+                                       RRClass::IN(), RRType::A());
+    createRequestPacket(request_message, IPPROTO_UDP);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    EXPECT_EQ(Rcode::NOERROR(), parse_message->getRcode());
+    EXPECT_EQ(1, parse_message->getRRCount(Message::SECTION_ANSWER));
+    const vector<uint8_t> first_response(
+        static_cast<const uint8_t*>(response_obuffer->getData()),
+        static_cast<const uint8_t*>(response_obuffer->getData()) +
+        response_obuffer->getLength());
+
+    // The same query is answered from the cache without being parsed into
+    // the message, so it only has the header.  The response data should
+    // be the same.
+    response_obuffer->clear();
+    parse_message->clear(Message::PARSE);
+    server.processMessage(*io_message, *parse_message, *response_obuffer,
+                          &dnsserv);
+    EXPECT_TRUE(dnsserv.hasAnswer());
+    headerCheck(*parse_message, default_qid, Rcode::NOERROR(),
+                opcode.getCode(), QR_FLAG | AA_FLAG, 0, 0, 0, 0);
+    ASSERT_EQ(first_response.size(), response_obuffer->getLength());
+    EXPECT_EQ(0, memcmp(&first_response[0], response_obuffer->getData(),
+                        first_response.size()));
+
+    // Both are counted in the same way.
+    ConstElementPtr stats_after = server.getStatistics()->
+        get("zones")->get("_SERVER_");
+    std::map<std::string, int> expect;
+    expect["request.v4"] = 2;
+    expect["request.udp"] = 2;
+    expect["opcode.query"] = 2;
+    expect["responses"] = 2;
+    expect["qrysuccess"] = 2;
+    expect["qryauthans"] = 2;
+    expect["rcode.noerror"] = 2;
+    checkStatisticsCounters(stats_after, expect);
+}
+
 #ifdef USE_STATIC_LINK
 TEST_F(AuthSrvTest, DISABLED_queryCounterTruncTest) {
 #else
@@ -157,4 +157,59 @@ TEST_F(AuthConfigTest, tcpRecvTimeoutConfig) {
                  AuthConfigError);
 }
 
+// Try enabling batched UDP servers through config
+TEST_F(AuthConfigTest, udpBatchingConfig) {
+    EXPECT_FALSE(server.getUDPBatching());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"udp_batching\": true }"));
+    EXPECT_TRUE(server.getUDPBatching());
+
+    // UDP servers for the listen addresses should now be created with the
+    // "BATCH" option.
+    bundy::testutils::portconfig::listenAddressConfig(server);
+    ASSERT_EQ(2, dnss_.getUDPFdParams().size());
+    EXPECT_EQ(DNSService::SERVER_BATCH, dnss_.getUDPFdParams().at(0).options);
+    EXPECT_EQ(DNSService::SERVER_BATCH, dnss_.getUDPFdParams().at(1).options);
+
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"udp_batching\": false }"));
+    EXPECT_FALSE(server.getUDPBatching());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"udp_batching\": 1 }")),
+                 AuthConfigError);
+}
+
+// Try setting the size of the answer cache through config
+TEST_F(AuthConfigTest, answerCacheSizeConfig) {
+    EXPECT_EQ(0, server.getAnswerCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"answer_cache_size\": 1024 }"));
+    EXPECT_EQ(1024, server.getAnswerCacheSize());
+    // The size is rounded up to a power of 2.
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"answer_cache_size\": 1000 }"));
+    EXPECT_EQ(1024, server.getAnswerCacheSize());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"answer_cache_size\": 0 }"));
+    EXPECT_EQ(0, server.getAnswerCacheSize());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"answer_cache_size\": -1 }")),
+                 AuthConfigError);
+}
+
+// Try setting the number of query worker threads through config
+TEST_F(AuthConfigTest, workerThreadsConfig) {
+    EXPECT_EQ(0, server.getWorkerThreads());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_threads\": 2 }"));
+    EXPECT_EQ(2, server.getWorkerThreads());
+    configureAuthServer(server, Element::fromJSON(
+    "{ \"worker_threads\": 0 }"));
+    EXPECT_EQ(0, server.getWorkerThreads());
+    EXPECT_THROW(configureAuthServer(server, Element::fromJSON(
+                    "{ \"worker_threads\": -1 }")),
+                 AuthConfigError);
+    EXPECT_EQ(0, server.getWorkerThreads());
+}
+
 }
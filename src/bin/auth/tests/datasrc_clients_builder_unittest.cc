@@ -59,9 +59,9 @@ protected:
     DataSrcClientsBuilderTest() :
         clients_map(new std::map<RRClass,
                     boost::shared_ptr<ConfigurableClientList> >),
-        write_end(-1), read_end(-1),
+        write_end(-1), read_end(-1), data_generation(0),
         builder(&command_queue, &callback_queue, &cond, &queue_mutex,
-                &clients_map, &map_mutex, generateSockets()),
+                &clients_map, &map_mutex, &data_generation, generateSockets()),
         cond(command_queue, delayed_command_queue), rrclass(RRClass::IN()),
         shutdown_cmd(SHUTDOWN, ConstElementPtr(), FinishedCallback()),
         noop_cmd(NOOP, ConstElementPtr(), FinishedCallback())
@@ -84,6 +84,7 @@ protected:
     std::list<Command> delayed_command_queue; // commands available after wait
     std::list<FinishedCallbackPair> callback_queue; // Callbacks from commands
     int write_end, read_end;
+    uint64_t data_generation;
     TestDataSrcClientsBuilder builder;
     TestCondVar cond;
     TestMutex queue_mutex;
@@ -316,6 +317,10 @@ TEST_F(DataSrcClientsBuilderTest, reconfigure) {
 
     // Also check if it has been cleanly unlocked every time
     EXPECT_EQ(3, map_mutex.unlock_count);
+
+    // The generation of the data has changed on each successful
+    // reconfiguration, and only then.
+    EXPECT_EQ(3, data_generation);
 }
 
 TEST_F(DataSrcClientsBuilderTest, shutdown) {
@@ -420,6 +425,9 @@ TEST_F(DataSrcClientsBuilderTest, loadZone) {
     EXPECT_EQ(2, map_mutex.lock_count);
     EXPECT_EQ(2, map_mutex.unlock_count);
 
+    // Installing the new zone data changes the generation of the data.
+    EXPECT_EQ(1, data_generation);
+
     newZoneChecks(clients_map, rrclass);
 }
 
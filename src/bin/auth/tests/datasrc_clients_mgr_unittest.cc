@@ -201,6 +201,56 @@ TEST(DataSrcClientsMgrTest, holder) {
     EXPECT_THROW(TestDataSrcClientsMgr::Holder holder2(mgr), bundy::Unexpected);
 }
 
+TEST(DataSrcClientsMgrTest, generation) {
+    TestDataSrcClientsMgr mgr;
+    {
+        TestDataSrcClientsMgr::Holder holder(mgr);
+        EXPECT_EQ(0, holder.getGeneration());
+    }
+
+    // Replacing the lists changes the generation.
+    mgr.setDataSrcClientLists(configureDataSource(Element::fromJSON(
+        "{\"IN\": [{\"type\": \"MasterFiles\", \"params\": {},"
+        "           \"cache-enable\": true}]}")));
+    {
+        TestDataSrcClientsMgr::Holder holder(mgr);
+        EXPECT_EQ(1, holder.getGeneration());
+    }
+}
+
+TEST(DataSrcClientsMgrTest, inMemory) {
+    TestDataSrcClientsMgr mgr;
+    {
+        // Nothing is configured, so nothing is outside the memory
+        TestDataSrcClientsMgr::Holder holder(mgr);
+        EXPECT_TRUE(holder.isInMemory());
+    }
+
+    mgr.setDataSrcClientLists(configureDataSource(Element::fromJSON(
+        "{\"IN\": [{\"type\": \"MasterFiles\", \"params\": {},"
+        "           \"cache-enable\": true}],"
+        " \"CH\": [{\"type\": \"MasterFiles\", \"params\": {},"
+        "           \"cache-enable\": true}]}")));
+    {
+        TestDataSrcClientsMgr::Holder holder(mgr);
+        EXPECT_TRUE(holder.isInMemory());
+    }
+
+    // A database without cache in one of the lists
+    mgr.setDataSrcClientLists(configureDataSource(Element::fromJSON(
+        "{\"IN\": [{\"type\": \"MasterFiles\", \"params\": {},"
+        "           \"cache-enable\": true},"
+        "          {\"type\": \"sqlite3\","
+        "           \"params\": {\"database_file\": \""
+        TEST_DATA_DIR "/example.sqlite3\"}}],"
+        " \"CH\": [{\"type\": \"MasterFiles\", \"params\": {},"
+        "           \"cache-enable\": true}]}")));
+    {
+        TestDataSrcClientsMgr::Holder holder(mgr);
+        EXPECT_FALSE(holder.isInMemory());
+    }
+}
+
 namespace {
 /* wrapper for hiding the optional argument for loadZone(). */
 void loadZoneWrapper(TestDataSrcClientsMgr* mgr, const ConstElementPtr& args) {
@@ -37,6 +37,7 @@ TestMutex* FakeDataSrcClientsBuilder::queue_mutex = NULL;
 bundy::datasrc::ClientListMapPtr*
     FakeDataSrcClientsBuilder::clients_map = NULL;
 TestMutex* FakeDataSrcClientsBuilder::map_mutex = NULL;
+uint64_t* FakeDataSrcClientsBuilder::data_generation = NULL;
 TestMutex FakeDataSrcClientsBuilder::queue_mutex_copy;
 bool FakeDataSrcClientsBuilder::thread_waited = false;
 FakeDataSrcClientsBuilder::ExceptionFromWait
@@ -71,6 +71,8 @@ public:
     private:
         TestMutex& mutex_;
     };
+    // Shared locks are counted just like exclusive ones.
+    typedef Locker ReadLocker;
     size_t lock_count; // number of lock acquisitions; tests can check this
     size_t unlock_count; // number of lock releases; tests can check this
     size_t noop_count;          // allow doNoop() to modify this
@@ -133,7 +135,7 @@ public:
     // true iff a builder has started.
     static bool started;
 
-    // These five correspond to the resource shared with the manager.
+    // These correspond to the resource shared with the manager.
     // xxx_copy will be set in the manager's destructor to record the
     // final state of the manager.
     static std::list<Command>* command_queue;
@@ -143,6 +145,7 @@ public:
     static int wakeup_fd;
     static bundy::datasrc::ClientListMapPtr* clients_map;
     static TestMutex* map_mutex;
+    static uint64_t* data_generation;
     static std::list<Command> command_queue_copy;
     static std::list<FinishedCallbackPair> callback_queue_copy;
     static TestCondVar cond_copy;
@@ -162,7 +165,7 @@ public:
         TestCondVar* cond,
         TestMutex* queue_mutex,
         bundy::datasrc::ClientListMapPtr* clients_map,
-        TestMutex* map_mutex, int wakeup_fd)
+        TestMutex* map_mutex, uint64_t* data_generation, int wakeup_fd)
     {
         FakeDataSrcClientsBuilder::started = false;
         FakeDataSrcClientsBuilder::command_queue = command_queue;
@@ -172,6 +175,7 @@ public:
         FakeDataSrcClientsBuilder::wakeup_fd = wakeup_fd;
         FakeDataSrcClientsBuilder::clients_map = clients_map;
         FakeDataSrcClientsBuilder::map_mutex = map_mutex;
+        FakeDataSrcClientsBuilder::data_generation = data_generation;
         FakeDataSrcClientsBuilder::thread_waited = false;
         FakeDataSrcClientsBuilder::thread_throw_on_wait = NOTHROW;
     }
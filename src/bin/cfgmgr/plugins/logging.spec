@@ -68,6 +68,11 @@
                         "item_type": "integer",
                         "item_optional": false,
                         "item_default": 0
+                      },
+                      { "item_name": "async",
+                        "item_type": "boolean",
+                        "item_optional": false,
+                        "item_default": false
                       }
                       ]
                     }
@@ -18,6 +18,7 @@
 #include <dhcp/option_definition.h>
 #include <dhcpsrv/cfgmgr.h>
 #include <dhcp4/config_parser.h>
+#include <dhcp4/dhcp4_srv.h>
 #include <dhcpsrv/dbaccess_parser.h>
 #include <dhcpsrv/dhcp_parsers.h>
 #include <dhcpsrv/option_space_container.h>
@@ -360,6 +361,8 @@ public:
             subnet->commit();
         }
 
+        // Index them now, so the subnet selection has nothing to build.
+        CfgMgr::instance().commitSubnets4();
     }
 
     /// @brief Returns Subnet4ListConfigParser object
@@ -392,7 +395,8 @@ DhcpConfigParser* createGlobalDhcp4ConfigParser(const std::string& config_id) {
     DhcpConfigParser* parser = NULL;
     if ((config_id.compare("valid-lifetime") == 0)  ||
         (config_id.compare("renew-timer") == 0)  ||
-        (config_id.compare("rebind-timer") == 0))  {
+        (config_id.compare("rebind-timer") == 0) ||
+        (config_id.compare("worker-threads") == 0))  {
         parser = new Uint32Parser(config_id,
                                  globalContext()->uint32_values_);
     } else if (config_id.compare("interfaces") == 0) {
@@ -443,7 +447,7 @@ void commitGlobalOptions() {
 }
 
 bundy::data::ConstElementPtr
-configureDhcp4Server(Dhcpv4Srv&, bundy::data::ConstElementPtr config_set) {
+configureDhcp4Server(Dhcpv4Srv& server, bundy::data::ConstElementPtr config_set) {
     if (!config_set) {
         ConstElementPtr answer = bundy::config::createAnswer(1,
                                  string("Can't parse NULL config"));
@@ -587,6 +591,16 @@ configureDhcp4Server(Dhcpv4Srv&, bundy::data::ConstElementPtr config_set) {
             if (hooks_parser) {
                 hooks_parser->commit();
             }
+
+            // The worker threads are only used if no hooks library is
+            // loaded, so they are set after these.  Without the parameter
+            // the packets are processed by the receiving thread.
+            uint32_t worker_threads = 0;
+            if (config_set->contains("worker-threads")) {
+                worker_threads = globalContext()->uint32_values_->
+                    getParam("worker-threads");
+            }
+            server.setWorkerThreads(worker_threads);
         }
         catch (const bundy::Exception& ex) {
             LOG_ERROR(dhcp4_logger, DHCP4_PARSER_COMMIT_FAIL).arg(ex.what());
@@ -170,6 +170,27 @@ ControlledDhcpv4Srv::dhcp4CommandHandler(const string& command, ConstElementPtr
         ConstElementPtr answer = bundy::config::createAnswer(0,
                                  "Hooks libraries successfully reloaded.");
         return (answer);
+
+    } else if (command == "getstats") {
+        if (!ControlledDhcpv4Srv::server_) {
+            ConstElementPtr answer = bundy::config::createAnswer(1,
+                                     "Server is not running.");
+            return (answer);
+        }
+        const bundy::statistics::Histogram::Summary summary =
+            ControlledDhcpv4Srv::server_->getLatency().getSummary();
+        ElementPtr latency = Element::createMap();
+        latency->set("count", Element::create(static_cast<int64_t>(
+                                                  summary.count)));
+        latency->set("p50", Element::create(static_cast<int64_t>(summary.p50)));
+        latency->set("p90", Element::create(static_cast<int64_t>(summary.p90)));
+        latency->set("p99", Element::create(static_cast<int64_t>(summary.p99)));
+        latency->set("p999", Element::create(static_cast<int64_t>(
+                                                 summary.p999)));
+        ElementPtr statistics = Element::createMap();
+        statistics->set("latency", latency);
+        ConstElementPtr answer = bundy::config::createAnswer(0, statistics);
+        return (answer);
     }
 
     ConstElementPtr answer = bundy::config::createAnswer(1,
@@ -182,6 +203,9 @@ void ControlledDhcpv4Srv::sessionReader(void) {
     // Process one asio event. If there are more events, iface_mgr will call
     // this callback more than once.
     if (server_) {
+        // The commands and the configuration changes must not be handled
+        // while the worker threads use the configuration.
+        server_->drainWorkers();
         server_->io_service_.run_one();
     }
 }
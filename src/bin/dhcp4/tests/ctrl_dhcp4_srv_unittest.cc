@@ -102,6 +102,13 @@ TEST_F(CtrlDhcpv4SrvTest, commands) {
     result = ControlledDhcpv4Srv::execDhcpv4ServerCommand("shutdown", params);
     comment = parseAnswer(rcode, result);
     EXPECT_EQ(0, rcode); // expect success
+
+    // Case 4: send getstats command; nothing was processed yet
+    result = ControlledDhcpv4Srv::execDhcpv4ServerCommand("getstats", params);
+    comment = parseAnswer(rcode, result);
+    EXPECT_EQ(0, rcode); // expect success
+    ASSERT_TRUE(comment && comment->contains("latency"));
+    EXPECT_EQ(0, comment->get("latency")->get("count")->intValue());
 }
 
 // Check that the "libreload" command will reload libraries
@@ -46,6 +46,7 @@
 #include <boost/scoped_ptr.hpp>
 
 #include <iostream>
+#include <set>
 
 #include <arpa/inet.h>
 
@@ -1347,6 +1348,9 @@ TEST_F(Dhcpv4SrvTest, relayAgentInfoEcho) {
     // Check that the server did send a reposonse
     ASSERT_EQ(1, srv.fake_sent_.size());
 
+    // The response is included in the latency statistics
+    EXPECT_EQ(1, srv.getLatency().getSummary().count);
+
     // Make sure that we received a response
     Pkt4Ptr offer = srv.fake_sent_.front();
     ASSERT_TRUE(offer);
@@ -1362,6 +1366,112 @@ TEST_F(Dhcpv4SrvTest, relayAgentInfoEcho) {
     EXPECT_TRUE(rai_response->equal(rai_query));
 }
 
+// Checks that the worker threads process the packets of many clients and
+// give them distinct addresses.
+TEST_F(Dhcpv4SrvTest, workerThreads) {
+    IfaceMgrTestConfig test_config(true);
+    IfaceMgr::instance().openSockets4();
+
+    NakedDhcpv4Srv srv(0);
+    EXPECT_EQ(0, srv.getWorkerThreads());
+
+    string config = "{ \"interfaces\": [ \"*\" ],"
+        "\"rebind-timer\": 2000, "
+        "\"renew-timer\": 1000, "
+        "\"subnet4\": [ { "
+        "    \"pool\": [ \"192.0.2.1 - 192.0.2.100\" ],"
+        "    \"subnet\": \"192.0.2.0/24\" "
+        " } ],"
+        "\"valid-lifetime\": 4000,"
+        "\"worker-threads\": 4 }";
+
+    ElementPtr json = Element::fromJSON(config);
+    ConstElementPtr status;
+    EXPECT_NO_THROW(status = configureDhcp4Server(srv, json));
+    ASSERT_TRUE(status);
+    comment_ = config::parseAnswer(rcode_, status);
+    ASSERT_EQ(0, rcode_);
+    EXPECT_EQ(4, srv.getWorkerThreads());
+
+    // Relayed DISCOVERs from 50 clients, as received from the wire
+    const int clients = 50;
+    for (int i = 0; i < clients; ++i) {
+        Pkt4Ptr dis(new Pkt4(DHCPDISCOVER, 1000 + i));
+        dis->setHops(1);
+        dis->setGiaddr(IOAddress("192.0.2.254"));
+        std::vector<uint8_t> mac(6, 0);
+        mac[5] = i;
+        dis->setHWAddr(HTYPE_ETHER, mac.size(), mac);
+        ASSERT_NO_THROW(dis->pack());
+
+        Pkt4Ptr received(new Pkt4(static_cast<const uint8_t*>
+                                  (dis->getBuffer().getData()),
+                                  dis->getBuffer().getLength()));
+        captureSetDefaultFields(received);
+        srv.fakeReceive(received);
+    }
+
+    // The packets queued are all processed when run() returns.
+    srv.run();
+    ASSERT_EQ(clients, srv.fake_sent_.size());
+
+    std::set<uint32_t> transids;
+    std::set<IOAddress> addresses;
+    for (std::list<Pkt4Ptr>::const_iterator offer = srv.fake_sent_.begin();
+         offer != srv.fake_sent_.end(); ++offer) {
+        EXPECT_EQ(DHCPOFFER, (*offer)->getType());
+        transids.insert((*offer)->getTransid());
+        addresses.insert((*offer)->getYiaddr());
+    }
+    EXPECT_EQ(clients, transids.size());
+    EXPECT_EQ(clients, addresses.size());
+
+    // Back to the processing by the receiving thread
+    srv.setWorkerThreads(0);
+    EXPECT_EQ(0, srv.getWorkerThreads());
+}
+
+/// @brief Returns a packet as received from the wire
+///
+/// @param type The message type
+/// @param mac The last byte of the hardware address of the client
+/// @param clientid The client identifier option (or none)
+Pkt4Ptr
+receivedPacket(uint8_t type, uint8_t mac, const OptionPtr& clientid) {
+    Pkt4Ptr pkt(new Pkt4(type, 1234));
+    std::vector<uint8_t> hwaddr(6, 0);
+    hwaddr[5] = mac;
+    pkt->setHWAddr(HTYPE_ETHER, hwaddr.size(), hwaddr);
+    if (clientid) {
+        pkt->addOption(clientid);
+    }
+    pkt->pack();
+    return (Pkt4Ptr(new Pkt4(static_cast<const uint8_t*>
+                             (pkt->getBuffer().getData()),
+                             pkt->getBuffer().getLength())));
+}
+
+// Checks that the packets of a client go to the same worker thread, whether
+// they include the client identifier or not.
+TEST_F(Dhcpv4SrvTest, getClientKey) {
+    const OptionPtr clientid = generateClientId();
+    const size_t key = NakedDhcpv4Srv::getClientKey(
+        receivedPacket(DHCPDISCOVER, 1, clientid));
+    EXPECT_EQ(key, NakedDhcpv4Srv::getClientKey(
+                  receivedPacket(DHCPRELEASE, 1, OptionPtr())));
+    EXPECT_NE(key, NakedDhcpv4Srv::getClientKey(
+                  receivedPacket(DHCPDISCOVER, 2, clientid)));
+
+    // The packets built by the tests have the same key.
+    Pkt4Ptr pkt(new Pkt4(DHCPREQUEST, 1234));
+    pkt->setHWAddr(HTYPE_ETHER, 6, std::vector<uint8_t>(6, 0));
+    EXPECT_NE(key, NakedDhcpv4Srv::getClientKey(pkt));
+    std::vector<uint8_t> hwaddr(6, 0);
+    hwaddr[5] = 1;
+    pkt->setHWAddr(HTYPE_ETHER, hwaddr.size(), hwaddr);
+    EXPECT_EQ(key, NakedDhcpv4Srv::getClientKey(pkt));
+}
+
 /// @todo move vendor options tests to a separate file.
 /// @todo Add more extensive vendor options tests, including multiple
 ///       vendor options
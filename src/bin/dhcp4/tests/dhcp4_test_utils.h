@@ -30,6 +30,7 @@
 #include <dhcp4/dhcp4_srv.h>
 #include <asiolink/io_address.h>
 #include <config/ccsession.h>
+#include <util/threads/sync.h>
 #include <list>
 
 #include <boost/shared_ptr.hpp>
@@ -154,8 +155,10 @@ public:
     /// @brief fake packet sending
     ///
     /// Pretend to send a packet, but instead just store it in fake_send_ list
-    /// where test can later inspect server's response.
+    /// where test can later inspect server's response. It may be called by
+    /// the worker threads.
     virtual void sendPacket(const Pkt4Ptr& pkt) {
+        bundy::util::thread::Mutex::Locker locker(sent_mutex_);
         fake_sent_.push_back(pkt);
     }
 
@@ -182,6 +185,10 @@ public:
 
     std::list<Pkt4Ptr> fake_sent_;
 
+    /// @brief Protects fake_sent_ when the packets are processed by the
+    /// worker threads
+    bundy::util::thread::Mutex sent_mutex_;
+
     using Dhcpv4Srv::adjustIfaceData;
     using Dhcpv4Srv::appendServerID;
     using Dhcpv4Srv::processDiscover;
@@ -200,6 +207,7 @@ public:
     using Dhcpv4Srv::accept;
     using Dhcpv4Srv::acceptMessageType;
     using Dhcpv4Srv::selectSubnet;
+    using Dhcpv4Srv::getClientKey;
     using Dhcpv4Srv::VENDOR_CLASS_PREFIX;
 };
 
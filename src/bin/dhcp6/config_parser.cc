@@ -18,6 +18,7 @@
 #include <dhcp/libdhcp++.h>
 #include <dhcp6/config_parser.h>
 #include <dhcp6/dhcp6_log.h>
+#include <dhcp6/dhcp6_srv.h>
 #include <dhcp/iface_mgr.h>
 #include <dhcpsrv/cfgmgr.h>
 #include <dhcpsrv/dbaccess_parser.h>
@@ -592,6 +593,8 @@ public:
             subnet->commit();
         }
 
+        // Index them now, so the subnet selection has nothing to build.
+        bundy::dhcp::CfgMgr::instance().commitSubnets6();
     }
 
     /// @brief Returns Subnet6ListConfigParser object
@@ -624,7 +627,8 @@ DhcpConfigParser* createGlobal6DhcpConfigParser(const std::string& config_id) {
     if ((config_id.compare("preferred-lifetime") == 0)  ||
         (config_id.compare("valid-lifetime") == 0)  ||
         (config_id.compare("renew-timer") == 0)  ||
-        (config_id.compare("rebind-timer") == 0))  {
+        (config_id.compare("rebind-timer") == 0) ||
+        (config_id.compare("worker-threads") == 0))  {
         parser = new Uint32Parser(config_id,
                                  globalContext()->uint32_values_);
     } else if (config_id.compare("interfaces") == 0) {
@@ -658,7 +662,7 @@ DhcpConfigParser* createGlobal6DhcpConfigParser(const std::string& config_id) {
 }
 
 bundy::data::ConstElementPtr
-configureDhcp6Server(Dhcpv6Srv&, bundy::data::ConstElementPtr config_set) {
+configureDhcp6Server(Dhcpv6Srv& server, bundy::data::ConstElementPtr config_set) {
     if (!config_set) {
         ConstElementPtr answer = bundy::config::createAnswer(1,
                                  string("Can't parse NULL config"));
@@ -799,6 +803,16 @@ configureDhcp6Server(Dhcpv6Srv&, bundy::data::ConstElementPtr config_set) {
             if (hooks_parser) {
                 hooks_parser->commit();
             }
+
+            // The worker threads are only used if no hooks library is
+            // loaded, so they are set after these.  Without the parameter
+            // the packets are processed by the receiving thread.
+            uint32_t worker_threads = 0;
+            if (config_set->contains("worker-threads")) {
+                worker_threads = globalContext()->uint32_values_->
+                    getParam("worker-threads");
+            }
+            server.setWorkerThreads(worker_threads);
         }
         catch (const bundy::Exception& ex) {
             LOG_ERROR(dhcp6_logger, DHCP6_PARSER_COMMIT_FAIL).arg(ex.what());
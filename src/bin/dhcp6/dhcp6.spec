@@ -54,6 +54,12 @@
         "item_default": 4000
       },
 
+      { "item_name": "worker-threads",
+        "item_type": "integer",
+        "item_optional": true,
+        "item_default": 0
+      },
+
       { "item_name": "option-def",
         "item_type": "list",
         "item_optional": false,
@@ -191,6 +197,24 @@
                 "item_type": "boolean",
                 "item_optional": true,
                 "item_default": true
+            },
+            {
+                "item_name": "durability",
+                "item_type": "string",
+                "item_optional": true,
+                "item_default": "write"
+            },
+            {
+                "item_name": "commit-interval",
+                "item_type": "integer",
+                "item_optional": true,
+                "item_default": 1
+            },
+            {
+                "item_name": "lfc-interval",
+                "item_type": "integer",
+                "item_optional": true,
+                "item_default": 0
             }
         ]
       },
@@ -470,6 +494,56 @@
             "command_name": "libreload",
             "command_description": "Reloads the current hooks libraries.",
             "command_args": []
+        },
+
+        {
+            "command_name": "getstats",
+            "command_description": "Returns the latency statistics of the server.",
+            "command_args": []
+        }
+    ],
+    "statistics": [
+        {
+            "item_name": "latency",
+            "item_type": "map",
+            "item_optional": false,
+            "item_default": {
+                "count": 0, "p50": 0, "p90": 0, "p99": 0, "p999": 0
+            },
+            "item_title": "Response latency",
+            "item_description": "Percentiles of the time from receiving a packet to sending the response, in microseconds. Each is the upper bound of a histogram bucket, within 25% of the actual value.",
+            "map_item_spec": [
+                {
+                    "item_name": "count", "item_type": "integer",
+                    "item_optional": false, "item_default": 0,
+                    "item_title": "latency.count",
+                    "item_description": "Number of responses measured"
+                },
+                {
+                    "item_name": "p50", "item_type": "integer",
+                    "item_optional": false, "item_default": 0,
+                    "item_title": "latency.p50",
+                    "item_description": "Median latency in microseconds"
+                },
+                {
+                    "item_name": "p90", "item_type": "integer",
+                    "item_optional": false, "item_default": 0,
+                    "item_title": "latency.p90",
+                    "item_description": "90th percentile latency in microseconds"
+                },
+                {
+                    "item_name": "p99", "item_type": "integer",
+                    "item_optional": false, "item_default": 0,
+                    "item_title": "latency.p99",
+                    "item_description": "99th percentile latency in microseconds"
+                },
+                {
+                    "item_name": "p999", "item_type": "integer",
+                    "item_optional": false, "item_default": 0,
+                    "item_title": "latency.p999",
+                    "item_description": "99.9th percentile latency in microseconds"
+                }
+            ]
         }
     ]
   }
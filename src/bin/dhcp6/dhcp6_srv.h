@@ -26,7 +26,9 @@
 #include <dhcpsrv/alloc_engine.h>
 #include <dhcpsrv/d2_client_mgr.h>
 #include <dhcpsrv/subnet.h>
+#include <dhcpsrv/worker_pool.h>
 #include <hooks/callout_handle.h>
+#include <statistics/histogram.h>
 
 #include <boost/noncopyable.hpp>
 
@@ -93,10 +95,45 @@ public:
     /// their correctness, generates appropriate answer (if needed) and
     /// transmits responses.
     ///
+    /// If worker threads are set (see @c setWorkerThreads), this loop only
+    /// receives the packets and hands them over to the worker threads,
+    /// which process them (see @c processPacket). Before returning, it
+    /// waits until the packets received are processed.
+    ///
     /// @return true, if being shut down gracefully, fail if experienced
     ///         critical error.
     bool run();
 
+    /// @brief Sets the number of worker threads processing the packets.
+    ///
+    /// With 0 (the default), the packets are processed one at a time by
+    /// the thread receiving them. Otherwise, they are processed in parallel
+    /// by this number of worker threads, except that the packets of a
+    /// client (identified by its DUID) are processed in the order they
+    /// were received, by the same thread.
+    ///
+    /// The hooks libraries may not be thread safe, so the worker threads
+    /// are not used if any is loaded.
+    ///
+    /// This must be called by the thread running @c run (e.g. while
+    /// handling a configuration change), or before it is called.
+    ///
+    /// @param threads The number of worker threads.
+    void setWorkerThreads(size_t threads);
+
+    /// @brief Returns the number of worker threads (0 if none).
+    size_t getWorkerThreads() const {
+        return (workers_ ? workers_->getSize() : 0);
+    }
+
+    /// @brief Waits until the worker threads have processed the packets
+    /// handed over to them.
+    ///
+    /// The configuration must not be changed while the worker threads use
+    /// it, so this is called before handling a command or a configuration
+    /// change.
+    void drainWorkers();
+
     /// @brief Instructs the server to shut down.
     void shutdown();
 
@@ -116,6 +153,15 @@ public:
         return (port_);
     }
 
+    /// @brief Return the histogram of the packet processing latencies.
+    ///
+    /// It holds the time, in microseconds, from receiving each packet to
+    /// sending the response to it.  Packets without a response (including
+    /// the dropped ones) are not included.
+    const bundy::statistics::Histogram& getLatency() const {
+        return (latency_);
+    }
+
     /// @brief Open sockets which are marked as active in @c CfgMgr.
     ///
     /// This function reopens sockets according to the current settings in the
@@ -567,8 +613,18 @@ protected:
     ///
     /// This method is useful for testing purposes, where its replacement
     /// simulates transmission of a packet. For that purpose it is protected.
+    /// It may be called by several worker threads at once.
     virtual void sendPacket(const Pkt6Ptr& pkt);
 
+    /// @brief Processes a received packet and sends the response.
+    ///
+    /// This is called by the worker threads, if any, otherwise by @c run.
+    ///
+    /// @param query The packet, as received.
+    /// @param received The time of its reception, in microseconds (see
+    ///        @c bundy::statistics::getMicroseconds).
+    void processPacket(Pkt6Ptr query, uint64_t received);
+
     /// @brief Implements a callback function to parse options in the message.
     ///
     /// @param buf a A buffer holding options in on-wire format.
@@ -617,6 +673,21 @@ private:
     /// @param errmsg An error message containing a cause of the failure.
     static void ifaceMgrSocket6ErrorHandler(const std::string& errmsg);
 
+    /// @brief Returns the key selecting the worker thread of a packet.
+    ///
+    /// It is a hash of the client's DUID, read from the wire data of the
+    /// packet (within the relay messages, if relayed), which is parsed by
+    /// the worker thread. Without DUID, it is a hash of the source address.
+    ///
+    /// @param query The packet, as received.
+    static size_t getClientKey(const Pkt6Ptr& query);
+
+    /// @brief Maximum number of packets waiting for a worker thread.
+    ///
+    /// The packets received while the queue of the worker thread is full
+    /// are dropped, as the client will retransmit them anyway.
+    static const size_t MAX_QUEUED_PACKETS = 1024;
+
     /// @brief Generate FQDN to be sent to a client if none exists.
     ///
     /// This function is meant to be called by the functions which process
@@ -671,6 +742,12 @@ private:
     /// UDP port number on which server listens.
     uint16_t port_;
 
+    /// Latencies of the responses, in microseconds
+    bundy::statistics::Histogram latency_;
+
+    /// The worker threads processing the packets (null if none)
+    WorkerPoolPtr workers_;
+
 protected:
 
     /// Indicates if shutdown is in progress. Setting it to true will
@@ -531,6 +531,38 @@ TEST_F(Dhcp6ParserTest, emptySubnet) {
     EXPECT_EQ(0, rcode_);
 }
 
+// Checks that the worker threads are set by the configuration, and that
+// without the parameter the packets are processed by the receiving thread.
+TEST_F(Dhcp6ParserTest, workerThreads) {
+
+    ConstElementPtr status;
+
+    EXPECT_NO_THROW(status = configureDhcp6Server(srv_,
+                    Element::fromJSON("{ \"interfaces\": [ \"*\" ],"
+                                      "\"preferred-lifetime\": 3000,"
+                                      "\"rebind-timer\": 2000, "
+                                      "\"renew-timer\": 1000, "
+                                      "\"subnet6\": [  ], "
+                                      "\"valid-lifetime\": 4000,"
+                                      "\"worker-threads\": 2 }")));
+    ASSERT_TRUE(status);
+    comment_ = parseAnswer(rcode_, status);
+    EXPECT_EQ(0, rcode_);
+    EXPECT_EQ(2, srv_.getWorkerThreads());
+
+    EXPECT_NO_THROW(status = configureDhcp6Server(srv_,
+                    Element::fromJSON("{ \"interfaces\": [ \"*\" ],"
+                                      "\"preferred-lifetime\": 3000,"
+                                      "\"rebind-timer\": 2000, "
+                                      "\"renew-timer\": 1000, "
+                                      "\"subnet6\": [  ], "
+                                      "\"valid-lifetime\": 4000 }")));
+    ASSERT_TRUE(status);
+    comment_ = parseAnswer(rcode_, status);
+    EXPECT_EQ(0, rcode_);
+    EXPECT_EQ(0, srv_.getWorkerThreads());
+}
+
 /// The goal of this test is to verify if defined subnet uses global
 /// parameter timer definitions.
 TEST_F(Dhcp6ParserTest, subnetGlobalDefaults) {
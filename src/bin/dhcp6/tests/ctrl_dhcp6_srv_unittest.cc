@@ -102,6 +102,13 @@ TEST_F(CtrlDhcpv6SrvTest, commands) {
     result = ControlledDhcpv6Srv::execDhcpv6ServerCommand("shutdown", params);
     comment = parseAnswer(rcode, result);
     EXPECT_EQ(0, rcode); // Expect success
+
+    // Case 4: send getstats command; nothing was processed yet
+    result = ControlledDhcpv6Srv::execDhcpv6ServerCommand("getstats", params);
+    comment = parseAnswer(rcode, result);
+    EXPECT_EQ(0, rcode); // Expect success
+    ASSERT_TRUE(comment && comment->contains("latency"));
+    EXPECT_EQ(0, comment->get("latency")->get("count")->intValue());
 }
 
 // Check that the "libreload" command will reload libraries
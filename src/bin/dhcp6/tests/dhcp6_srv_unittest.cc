@@ -45,6 +45,7 @@
 #include <unistd.h>
 #include <fstream>
 #include <iostream>
+#include <set>
 #include <sstream>
 
 using namespace bundy;
@@ -1444,6 +1445,62 @@ TEST_F(Dhcpv6SrvTest, portsDirectTraffic) {
 
     // This is sent back to client directly, should be port 546
     EXPECT_EQ(DHCP6_CLIENT_PORT, adv->getRemotePort());
+
+    // The response is included in the latency statistics
+    EXPECT_EQ(1, srv.getLatency().getSummary().count);
+}
+
+// Checks that the worker threads process the Requests of many clients and
+// delegate them distinct prefixes.
+TEST_F(Dhcpv6SrvTest, workerThreads) {
+    NakedDhcpv6Srv srv(0);
+    srv.setWorkerThreads(4);
+    ASSERT_EQ(4, srv.getWorkerThreads());
+
+    // Requests for a prefix from 50 clients, as received from the wire
+    const int clients = 50;
+    for (int i = 0; i < clients; ++i) {
+        Pkt6Ptr req(new Pkt6(DHCPV6_REQUEST, 1000 + i));
+        OptionBuffer duid(8, 1);
+        duid[7] = i;
+        req->addOption(OptionPtr(new Option(Option::V6, D6O_CLIENTID, duid)));
+        req->addOption(srv.getServerID());
+        req->addOption(generateIA(D6O_IA_PD, 234, 1500, 3000));
+        ASSERT_NO_THROW(req->pack());
+
+        Pkt6Ptr received(new Pkt6(static_cast<const uint8_t*>
+                                  (req->getBuffer().getData()),
+                                  req->getBuffer().getLength()));
+        received->setRemoteAddr(IOAddress("fe80::abcd"));
+        received->setLocalAddr(IOAddress("ff02::1:2"));
+        received->setIface("eth0");
+        srv.fakeReceive(received);
+    }
+
+    // The packets queued are all processed when run() returns.
+    srv.run();
+    ASSERT_EQ(clients, srv.fake_sent_.size());
+
+    std::set<uint32_t> transids;
+    std::set<IOAddress> prefixes;
+    for (std::list<Pkt6Ptr>::const_iterator reply = srv.fake_sent_.begin();
+         reply != srv.fake_sent_.end(); ++reply) {
+        EXPECT_EQ(DHCPV6_REPLY, (*reply)->getType());
+        transids.insert((*reply)->getTransid());
+        boost::shared_ptr<Option6IAPrefix> prefix =
+            checkIA_PD(*reply, 234, subnet_->getT1(), subnet_->getT2());
+        ASSERT_TRUE(prefix);
+        prefixes.insert(prefix->getAddress());
+    }
+    EXPECT_EQ(clients, transids.size());
+    EXPECT_EQ(clients, prefixes.size());
+
+    // They are all in the lease database.
+    for (std::set<IOAddress>::const_iterator prefix = prefixes.begin();
+         prefix != prefixes.end(); ++prefix) {
+        EXPECT_TRUE(LeaseMgrFactory::instance().getLease6(Lease::TYPE_PD,
+                                                          *prefix));
+    }
 }
 
 // Checks if server responses are sent to the proper port.
@@ -34,6 +34,7 @@
 #include <dhcp6/dhcp6_srv.h>
 #include <hooks/hooks_manager.h>
 #include <config/ccsession.h>
+#include <util/threads/sync.h>
 
 #include <list>
 
@@ -77,8 +78,10 @@ public:
     ///
     /// Pretend to send a packet, but instead just store
     /// it in fake_send_ list where test can later inspect
-    /// server's response.
+    /// server's response. It may be called by the worker
+    /// threads.
     virtual void sendPacket(const bundy::dhcp::Pkt6Ptr& pkt) {
+        bundy::util::thread::Mutex::Locker locker(sent_mutex_);
         fake_sent_.push_back(pkt);
     }
 
@@ -124,6 +127,10 @@ public:
     std::list<bundy::dhcp::Pkt6Ptr> fake_received_;
 
     std::list<bundy::dhcp::Pkt6Ptr> fake_sent_;
+
+    /// @brief Protects fake_sent_ when the packets are processed by
+    /// the worker threads
+    bundy::util::thread::Mutex sent_mutex_;
 };
 
 static const char* DUID_FILE = "server-id-test.txt";
@@ -35,6 +35,7 @@ TESTDATA_WRITE_PATH = os.environ['TESTDATA_WRITE_PATH'] + os.sep
 WRITE_ZONE_DB_FILE = TESTDATA_WRITE_PATH + "rwtest.sqlite3.copied"
 TEST_ZONE_NAME = Name('example.org')
 DATASRC_CONFIG = '{"database_file": "' + WRITE_ZONE_DB_FILE + '"}'
+SNAPSHOT_FILE = TESTDATA_WRITE_PATH + "zones.snapshot"
 
 # before/after SOAs: different in mname and serial
 ORIG_SOA_TXT = 'example.org. 3600 IN SOA ns1.example.org. ' +\
@@ -78,6 +79,15 @@ class TestLoadZoneRunner(unittest.TestCase):
         self.assertEqual(NEW_ZONE_TXT_FILE, self.__runner._zone_file)
         self.assertEqual(DATASRC_CONFIG, self.__runner._datasrc_config)
         self.assertEqual('sqlite3', self.__runner._datasrc_type) # default
+        self.assertIsNone(self.__runner._snapshot_file) # default
+
+    def test_parse_args_snapshot(self):
+        runner = LoadZoneRunner(['-s', SNAPSHOT_FILE, 'example.org',
+                                 NEW_ZONE_TXT_FILE])
+        runner._parse_args()
+        self.assertEqual(SNAPSHOT_FILE, runner._snapshot_file)
+        # data source config isn't needed (the default isn't used)
+        self.assertIsNone(runner._datasrc_config)
         self.assertEqual(10000, self.__runner._report_interval) # default
         self.assertEqual(RRClass.IN, self.__runner._zone_class) # default
         self.assertEqual('INFO', self.__runner._log_severity) # default
@@ -104,6 +114,10 @@ class TestLoadZoneRunner(unittest.TestCase):
                 ['-e', 'example', 'example.zone'])._parse_args)
         self.assertRaises(BadArgument, LoadZoneRunner(['-e'])._parse_args)
 
+        # An empty zone cannot be made in a snapshot
+        self.assertRaises(BadArgument, LoadZoneRunner(
+                ['-s', SNAPSHOT_FILE, '-e', 'example'])._parse_args)
+
         # Bad zone name
         args = ['example.org', 'example.zone'] # otherwise valid args
         self.assertRaises(BadArgument,
@@ -294,6 +308,49 @@ class TestLoadZoneRunner(unittest.TestCase):
         self.__runner._do_load()
         self.__check_zone_soa('empty')
 
+    def __check_snapshot(self, zone_name, soa_txt):
+        '''Check the zone in the snapshot as auth would use it.'''
+        clist = ConfigurableClientList(RRClass.IN)
+        clist.configure('[{"type": "MasterFiles", "params": {},' +
+                        ' "cache-enable": true, "cache-type": "mapped",' +
+                        ' "cache-snapshot": "' + SNAPSHOT_FILE + '"}]', True)
+        _, finder, exact = clist.find(zone_name)
+        self.assertTrue(exact)
+        result, rrset, _ = finder.find(zone_name, RRType.SOA)
+        self.assertEqual(finder.SUCCESS, result)
+        self.assertEqual(soa_txt, rrset.to_text())
+
+    @unittest.skipIf(os.environ['HAVE_SHARED_MEMORY'] != 'yes',
+                     'shared memory is not available')
+    def test_build_snapshot(self):
+        if os.path.exists(SNAPSHOT_FILE):
+            os.unlink(SNAPSHOT_FILE)
+        try:
+            runner = LoadZoneRunner(['-s', SNAPSHOT_FILE, 'example.org',
+                                     NEW_ZONE_TXT_FILE])
+            runner._parse_args()
+            runner._do_load()
+            self.__check_snapshot(TEST_ZONE_NAME, NEW_SOA_TXT)
+
+            # Another zone can be added to the snapshot.
+            runner = LoadZoneRunner(['-s', SNAPSHOT_FILE, 'example.com',
+                                     ALT_NEW_ZONE_TXT_FILE])
+            runner._parse_args()
+            runner._do_load()
+            self.__check_snapshot(TEST_ZONE_NAME, NEW_SOA_TXT)
+            self.__check_snapshot(Name('example.com'), ALT_NEW_SOA_TXT)
+
+            # Loading a broken zone fails, but the snapshot is still valid.
+            runner = LoadZoneRunner(['-s', SNAPSHOT_FILE, 'example.org',
+                                     LOCAL_TESTDATA_PATH +
+                                     'broken-example.org.zone'])
+            runner._parse_args()
+            self.assertRaises(LoadFailure, runner._do_load)
+            self.__check_snapshot(TEST_ZONE_NAME, NEW_SOA_TXT)
+        finally:
+            if os.path.exists(SNAPSHOT_FILE):
+                os.unlink(SNAPSHOT_FILE)
+
     def __common_post_load_setup(self, zone_file):
         '''Common setup procedure for post load tests which should fail.'''
         # replace the LoadZoneRunner's original _post_load_warning() for
@@ -0,0 +1,319 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <resolver/bench/fake_hierarchy.h>
+
+#include <exceptions/exceptions.h>
+#include <util/buffer.h>
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/opcode.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rdata.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <asio.hpp>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <map>
+#include <string>
+
+using namespace bundy::dns;
+using boost::lexical_cast;
+using std::string;
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+namespace {
+
+const size_t MAX_CHILDREN = 250;
+
+RRsetPtr
+createRRset(const Name& name, const RRType& type, uint32_t ttl,
+            const string& rdata)
+{
+    RRsetPtr rrset(new RRset(name, RRClass::IN(), type, RRTTL(ttl)));
+    rrset->addRdata(rdata::createRdata(type, RRClass::IN(), rdata));
+    return (rrset);
+}
+
+string
+getServerAddress(size_t tld, size_t zone) {
+    // The root is (0, 0), a TLD is (tld + 1, 0) and a zone below is
+    // (tld + 1, zone + 1).
+    if (tld == 0) {
+        return ("127.53.0.1");
+    } else if (zone == 0) {
+        return ("127.53.1." + lexical_cast<string>(tld));
+    } else {
+        return ("127.53." + lexical_cast<string>(tld + 1) + "." +
+                lexical_cast<string>(zone));
+    }
+}
+
+// The name of the (only) nameserver of a zone
+Name
+createNSName(const Name& origin) {
+    if (origin == Name::ROOT_NAME()) {
+        return (Name("ns.root"));
+    }
+    return (Name("ns").concatenate(origin));
+}
+
+}
+
+/// \brief Authoritative server of one zone in the fake hierarchy.
+class FakeServer : boost::noncopyable {
+public:
+    FakeServer(asiolink::IOService& service, const string& address,
+               uint16_t port, const Name& origin) :
+        socket_(service.get_io_service(),
+                asio::ip::udp::endpoint(
+                    asio::ip::address::from_string(address), port)),
+        origin_(origin),
+        ns_name_(createNSName(origin)),
+        query_(Message::PARSE),
+        response_(Message::RENDER),
+        query_count_(0)
+    {
+        addData(createRRset(origin_, RRType::NS(), 86400,
+                            ns_name_.toText()));
+        addData(createRRset(origin_, RRType::SOA(), 86400,
+                            ns_name_.toText() + " " +
+                            Name("hostmaster").concatenate(origin_).toText() +
+                            " 1 3600 900 604800 300"));
+        addData(createRRset(ns_name_, RRType::A(), 86400, address));
+        startReceive();
+    }
+
+    ~FakeServer() {
+        asio::error_code ec;
+        socket_.close(ec);
+    }
+
+    // Add authoritative data
+    void addData(const RRsetPtr& rrset) {
+        data_[rrset->getName()].push_back(rrset);
+    }
+
+    // Delegate a child zone to the given server
+    void addDelegation(const Name& child, const Name& ns_name,
+                       const string& ns_address)
+    {
+        std::vector<RRsetPtr>& rrsets(delegations_[child]);
+        rrsets.push_back(createRRset(child, RRType::NS(), 86400,
+                                     ns_name.toText()));
+        rrsets.push_back(createRRset(ns_name, RRType::A(), 86400,
+                                     ns_address));
+    }
+
+    const Name& getNSName() const {
+        return (ns_name_);
+    }
+
+    size_t getQueryCount() const {
+        return (query_count_);
+    }
+
+private:
+    void startReceive() {
+        socket_.async_receive_from(asio::buffer(buffer_, sizeof(buffer_)),
+                                   sender_,
+                                   boost::bind(&FakeServer::received, this,
+                                               _1, _2));
+    }
+
+    void received(const asio::error_code& ec, size_t length) {
+        if (ec == asio::error::operation_aborted || !socket_.is_open()) {
+            return;
+        }
+        if (!ec) {
+            ++query_count_;
+            try {
+                util::InputBuffer input(buffer_, length);
+                query_.clear(Message::PARSE);
+                query_.fromWire(input);
+                if (query_.getRRCount(Message::SECTION_QUESTION) == 1) {
+                    respond(**query_.beginQuestion());
+                    asio::error_code send_ec;
+                    socket_.send_to(asio::buffer(renderer_.getData(),
+                                                 renderer_.getLength()),
+                                    sender_, 0, send_ec);
+                }
+            } catch (const bundy::Exception&) {
+                // Garbage is dropped
+            }
+        }
+        startReceive();
+    }
+
+    void respond(const Question& question) {
+        response_.clear(Message::RENDER);
+        response_.setQid(query_.getQid());
+        response_.setOpcode(Opcode::QUERY());
+        response_.setHeaderFlag(Message::HEADERFLAG_QR);
+        response_.setRcode(Rcode::NOERROR());
+        response_.addQuestion(question);
+        render(question.getName(), question.getType());
+        renderer_.clear();
+        response_.toWire(renderer_);
+    }
+
+    void render(const Name& qname, const RRType& qtype) {
+        const NameComparisonResult::NameRelation relation =
+            qname.compare(origin_).getRelation();
+        if (relation != NameComparisonResult::EQUAL &&
+            relation != NameComparisonResult::SUBDOMAIN) {
+            response_.setRcode(Rcode::REFUSED());
+            return;
+        }
+
+        // A referral, if the name is at or below a delegation
+        for (Name name = qname;
+             name.getLabelCount() > origin_.getLabelCount();
+             name = name.split(1)) {
+            const std::map<Name, std::vector<RRsetPtr> >::const_iterator it =
+                delegations_.find(name);
+            if (it != delegations_.end()) {
+                response_.addRRset(Message::SECTION_AUTHORITY, it->second[0]);
+                response_.addRRset(Message::SECTION_ADDITIONAL,
+                                   it->second[1]);
+                return;
+            }
+        }
+
+        response_.setHeaderFlag(Message::HEADERFLAG_AA);
+        const std::map<Name, std::vector<RRsetPtr> >::const_iterator it =
+            data_.find(qname);
+        if (it != data_.end()) {
+            for (std::vector<RRsetPtr>::const_iterator rit =
+                     it->second.begin(); rit != it->second.end(); ++rit) {
+                if ((*rit)->getType() == qtype) {
+                    response_.addRRset(Message::SECTION_ANSWER, *rit);
+                    return;
+                }
+            }
+        } else {
+            response_.setRcode(Rcode::NXDOMAIN());
+        }
+        // NODATA or NXDOMAIN
+        response_.addRRset(Message::SECTION_AUTHORITY,
+                           data_.find(origin_)->second[1]);
+    }
+
+    asio::ip::udp::socket socket_;
+    asio::ip::udp::endpoint sender_;
+    uint8_t buffer_[512];
+    const Name origin_;
+    const Name ns_name_;
+    std::map<Name, std::vector<RRsetPtr> > data_;
+    std::map<Name, std::vector<RRsetPtr> > delegations_;
+    Message query_;
+    Message response_;
+    MessageRenderer renderer_;
+    size_t query_count_;
+};
+
+FakeHierarchy::FakeHierarchy(asiolink::IOService& service, uint16_t port,
+                             size_t tlds, size_t zones, size_t names)
+{
+    if (tlds == 0 || tlds > MAX_CHILDREN || zones == 0 ||
+        zones > MAX_CHILDREN || names == 0) {
+        bundy_throw(BadValue, "Invalid size of the fake hierarchy: " <<
+                    tlds << " TLDs, " << zones << " zones, " << names <<
+                    " names");
+    }
+
+    const boost::shared_ptr<FakeServer> root(
+        new FakeServer(service, getServerAddress(0, 0), port,
+                       Name::ROOT_NAME()));
+    servers_.push_back(root);
+    for (size_t i = 0; i < tlds; ++i) {
+        const Name tld_name("tld" + lexical_cast<string>(i));
+        const boost::shared_ptr<FakeServer> tld(
+            new FakeServer(service, getServerAddress(i + 1, 0), port,
+                           tld_name));
+        servers_.push_back(tld);
+        root->addDelegation(tld_name, tld->getNSName(),
+                            getServerAddress(i + 1, 0));
+
+        for (size_t j = 0; j < zones; ++j) {
+            const Name zone_name = Name("zone" + lexical_cast<string>(j)).
+                concatenate(tld_name);
+            const boost::shared_ptr<FakeServer> zone(
+                new FakeServer(service, getServerAddress(i + 1, j + 1), port,
+                               zone_name));
+            servers_.push_back(zone);
+            tld->addDelegation(zone_name, zone->getNSName(),
+                               getServerAddress(i + 1, j + 1));
+
+            for (size_t k = 0; k < names; ++k) {
+                zone->addData(createRRset(getHostName(i, j, k), RRType::A(),
+                                          3600,
+                                          "192.0.2." +
+                                          lexical_cast<string>(k % 254 + 1)));
+            }
+        }
+    }
+}
+
+FakeHierarchy::~FakeHierarchy() {
+}
+
+void
+FakeHierarchy::primeCache(cache::ResolverCache& cache) const {
+    const Name ns_name = createNSName(Name::ROOT_NAME());
+    const RRsetPtr ns_rrset(createRRset(Name::ROOT_NAME(), RRType::NS(),
+                                        86400, ns_name.toText()));
+    const RRsetPtr a_rrset(createRRset(ns_name, RRType::A(), 86400,
+                                       getServerAddress(0, 0)));
+    Message priming_result(Message::RENDER);
+    priming_result.setRcode(Rcode::NOERROR());
+    priming_result.addQuestion(Question(Name::ROOT_NAME(), RRClass::IN(),
+                                        RRType::NS()));
+    priming_result.addRRset(Message::SECTION_ANSWER, ns_rrset);
+    priming_result.addRRset(Message::SECTION_ADDITIONAL, a_rrset);
+    cache.update(priming_result);
+    cache.update(ns_rrset);
+    cache.update(a_rrset);
+}
+
+Name
+FakeHierarchy::getHostName(size_t tld, size_t zone, size_t name) {
+    return (Name("www" + lexical_cast<string>(name) + ".zone" +
+                 lexical_cast<string>(zone) + ".tld" +
+                 lexical_cast<string>(tld)));
+}
+
+size_t
+FakeHierarchy::getQueryCount() const {
+    size_t count = 0;
+    for (std::vector<boost::shared_ptr<FakeServer> >::const_iterator it =
+             servers_.begin(); it != servers_.end(); ++it) {
+        count += (*it)->getQueryCount();
+    }
+    return (count);
+}
+
+}
+}
+}
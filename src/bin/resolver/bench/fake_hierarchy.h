@@ -0,0 +1,98 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef RESOLVER_BENCH_FAKE_HIERARCHY_H
+#define RESOLVER_BENCH_FAKE_HIERARCHY_H
+
+#include <asiolink/io_service.h>
+#include <cache/resolver_cache.h>
+#include <dns/name.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+class FakeServer;
+
+/// \brief A fake DNS hierarchy of authoritative servers.
+///
+/// This builds a small, regular tree of zones and serves it from UDP sockets
+/// on loopback addresses of the local host, in the same process (driven by
+/// the same \c IOService as the resolver being measured).  So the real
+/// resolver components can be benchmarked offline and reproducibly.
+///
+/// The hierarchy consists of:
+/// - The root zone, served by ns.root. at 127.53.0.1.
+/// - \c tlds top level domains tldI., each served by ns.tldI. at
+///   127.53.1.(I+1).  The root delegates to them with glue.
+/// - \c zones zones zoneJ.tldI. in each of them, served by ns.zoneJ.tldI.
+///   at 127.53.(I+2).(J+1).  Again, delegated with glue.
+/// - \c names A records wwwK.zoneJ.tldI. in each of those.  Any other name
+///   in the zone results in NXDOMAIN, any other type in NODATA.
+///
+/// All the servers listen on the same (non-standard) port, so the resolver
+/// must be told to use it (see \c RecursiveQuery::setNameserverPort()).
+/// On Linux the whole 127/8 network is local; on systems where it isn't,
+/// the extra loopback addresses need to be configured first.
+///
+/// The servers don't implement TCP, EDNS or DNSSEC; the responses are small
+/// and never truncated.
+class FakeHierarchy : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// Builds the zones and opens the sockets.  The servers start answering
+    /// as soon as the \c IOService runs.
+    ///
+    /// \throw bundy::BadValue if the parameters are out of range (there can
+    ///     be at most 250 TLDs and 250 zones in each).
+    /// \throw asio::system_error if a socket can't be opened.
+    FakeHierarchy(asiolink::IOService& service, uint16_t port, size_t tlds,
+                  size_t zones, size_t names);
+
+    /// \brief Destructor.
+    ~FakeHierarchy();
+
+    /// \brief Put the root hints into the cache.
+    ///
+    /// This is what the resolver's main does for the real root servers.
+    void primeCache(cache::ResolverCache& cache) const;
+
+    /// \brief Return the name of a host in the hierarchy.
+    ///
+    /// The name exists if each index is less than the corresponding
+    /// constructor parameter; otherwise it's a nonexistent name (but still
+    /// in the hierarchy if \c tld and \c zone are in range).
+    ///
+    /// \param tld, zone, name The indices of the name.
+    static dns::Name getHostName(size_t tld, size_t zone, size_t name);
+
+    /// \brief Return the number of queries the servers have received.
+    size_t getQueryCount() const;
+
+private:
+    std::vector<boost::shared_ptr<FakeServer> > servers_;
+};
+
+}
+}
+}
+
+#endif
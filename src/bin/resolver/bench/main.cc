@@ -13,15 +13,251 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <resolver/bench/naive_resolver.h>
+#include <resolver/bench/recursive_bench.h>
+#include <resolver/bench/fake_hierarchy.h>
 
 #include <bench/benchmark.h>
+#include <bench/benchmark_util.h>
 
-const size_t count = 1000; // TODO: We may want to read this from argv.
+#include <dns/message.h>
+#include <dns/question.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+#include <util/buffer.h>
 
-int main(int, const char**) {
-    // Run the naive implementation
-    bundy::resolver::bench::NaiveResolver naive_resolver(count);
-    bundy::bench::BenchMark<bundy::resolver::bench::NaiveResolver>
-        (1, naive_resolver, true);
-    return 0;
+#include <log/logger_support.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::dns;
+using namespace bundy::bench;
+using bundy::resolver::bench::FakeHierarchy;
+using bundy::resolver::bench::NaiveResolver;
+using bundy::resolver::bench::RecursiveBench;
+
+namespace bundy {
+namespace bench {
+template<>
+void
+BenchMark<RecursiveBench>::printResult() const {
+    cout.precision(6);
+    cout << "Processed " << getIteration() << " queries in "
+         << fixed << getDuration() << "s";
+    cout.precision(2);
+    cout << " (" << fixed << getIterationPerSecond() << "qps)" << endl;
+}
+}
+}
+
+namespace {
+
+const size_t NAIVE_COUNT = 1000;
+const int ITERATION_DEFAULT = 1;
+const size_t QUERY_COUNT_DEFAULT = 10000;
+const size_t CONCURRENCY_DEFAULT = 10;
+const uint16_t PORT_DEFAULT = 5300;
+const size_t TLDS_DEFAULT = 4;
+const size_t ZONES_DEFAULT = 50;
+const size_t NAMES_DEFAULT = 100;
+const unsigned int NXDOMAIN_DEFAULT = 5;
+const unsigned int SEED_DEFAULT = 1;
+
+void
+usage() {
+    cerr <<
+        "Usage: resolver-bench [-d] [-m naive|recursive] [-n iterations]\n"
+        "         [-c concurrency] [-p port] [-t tlds] [-z zones] [-w names]\n"
+        "         [-q queries] [-x nxdomain_percent] [-s seed]"
+        " [query_datafile]\n"
+        "  -d Enable debug logging to stdout\n"
+        "  -m Benchmark to run (default: recursive)\n"
+        "  -n Number of times the queries are replayed (default: "
+         << ITERATION_DEFAULT << ")\n"
+        "  -c Maximum number of outstanding queries (default: "
+         << CONCURRENCY_DEFAULT << ")\n"
+        "  -p Port of the fake authoritative servers (default: "
+         << PORT_DEFAULT << ")\n"
+        "  -t, -z, -w Number of TLDs, zones in each of them and names in\n"
+        "     each zone of the fake hierarchy (default: " << TLDS_DEFAULT <<
+        ", " << ZONES_DEFAULT << ", " << NAMES_DEFAULT << ")\n"
+        "  -q Number of queries to generate (default: "
+         << QUERY_COUNT_DEFAULT << ")\n"
+        "  -x Percentage of generated queries for nonexistent names"
+        " (default: " << NXDOMAIN_DEFAULT << ")\n"
+        "  -s Seed of the query generator (default: " << SEED_DEFAULT <<
+        ")\n"
+        "  query_datafile: queryperf style input data to replay instead of\n"
+        "     the generated queries; the names should be in the hierarchy,\n"
+        "     e.g. www0.zone0.tld0"
+         << endl;
+    exit (1);
+}
+
+// Generate the queries for the fake hierarchy.  The popularity of the names
+// follows Zipf's law (as in real traffic), with the popular ones spread
+// over the zones.
+void
+generateQueries(vector<QuestionPtr>& queries, size_t count, size_t tlds,
+                size_t zones, size_t names, unsigned int nxdomain_percent,
+                unsigned int seed)
+{
+    srandom(seed);
+    const size_t total = tlds * zones * names;
+    vector<double> cumulative(total);
+    double sum = 0;
+    for (size_t i = 0; i < total; ++i) {
+        sum += 1.0 / (i + 1);
+        cumulative[i] = sum;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const double pick = sum * random() / RAND_MAX;
+        const size_t rank = min(static_cast<size_t>(
+                                    lower_bound(cumulative.begin(),
+                                                cumulative.end(), pick) -
+                                    cumulative.begin()),
+                                total - 1);
+        size_t name = rank / (tlds * zones);
+        if (static_cast<unsigned int>(random() % 100) < nxdomain_percent) {
+            name += names;
+        }
+        queries.push_back(QuestionPtr(new Question(
+            FakeHierarchy::getHostName(rank % tlds, (rank / tlds) % zones,
+                                       name),
+            RRClass::IN(), RRType::A())));
+    }
+}
+
+// Load the queries from a file
+void
+loadQueries(vector<QuestionPtr>& queries, const char* query_data_file) {
+    BenchQueries wire_queries;
+    loadQueryData(query_data_file, wire_queries, RRClass::IN());
+    Message message(Message::PARSE);
+    for (BenchQueries::const_iterator it = wire_queries.begin();
+         it != wire_queries.end(); ++it) {
+        bundy::util::InputBuffer buffer(&(*it)[0], it->size());
+        message.clear(Message::PARSE);
+        message.fromWire(buffer);
+        queries.push_back(QuestionPtr(new Question(
+            **message.beginQuestion())));
+    }
+}
+
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    const char* mode = "recursive";
+    int iteration = ITERATION_DEFAULT;
+    size_t query_count = QUERY_COUNT_DEFAULT;
+    size_t concurrency = CONCURRENCY_DEFAULT;
+    uint16_t port = PORT_DEFAULT;
+    size_t tlds = TLDS_DEFAULT;
+    size_t zones = ZONES_DEFAULT;
+    size_t names = NAMES_DEFAULT;
+    unsigned int nxdomain_percent = NXDOMAIN_DEFAULT;
+    unsigned int seed = SEED_DEFAULT;
+    bool debug_log = false;
+    while ((ch = getopt(argc, argv, "dm:n:c:p:t:z:w:q:x:s:")) != -1) {
+        switch (ch) {
+        case 'd':
+            debug_log = true;
+            break;
+        case 'm':
+            mode = optarg;
+            break;
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case 'c':
+            concurrency = atoi(optarg);
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 't':
+            tlds = atoi(optarg);
+            break;
+        case 'z':
+            zones = atoi(optarg);
+            break;
+        case 'w':
+            names = atoi(optarg);
+            break;
+        case 'q':
+            query_count = atoi(optarg);
+            break;
+        case 'x':
+            nxdomain_percent = atoi(optarg);
+            break;
+        case 's':
+            seed = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc > 1) {
+        usage();
+    }
+
+    if (strcmp(mode, "naive") == 0) {
+        // Run the naive implementation
+        NaiveResolver naive_resolver(NAIVE_COUNT);
+        BenchMark<NaiveResolver>(1, naive_resolver, true);
+        return (0);
+    } else if (strcmp(mode, "recursive") != 0) {
+        cerr << "Unknown benchmark: " << mode << endl;
+        return (1);
+    }
+
+    // By default disable logging to avoid unwanted noise.
+    bundy::log::initLogger("resolver-bench",
+                           debug_log ? bundy::log::DEBUG : bundy::log::NONE,
+                           bundy::log::MAX_DEBUG_LEVEL, NULL);
+
+    try {
+        vector<QuestionPtr> queries;
+        if (argc == 1) {
+            loadQueries(queries, argv[0]);
+        } else {
+            generateQueries(queries, query_count, tlds, zones, names,
+                            nxdomain_percent, seed);
+        }
+
+        cout << "Parameters:" << endl;
+        cout << "  Iterations: " << iteration << endl;
+        cout << "  Concurrency: " << concurrency << endl;
+        cout << "  Hierarchy: " << tlds << " TLDs, " << zones <<
+            " zones each, " << names << " names each, port " << port << endl;
+        if (argc == 1) {
+            cout << "  Query data: file=" << argv[0] << " (" <<
+                queries.size() << " queries)" << endl << endl;
+        } else {
+            cout << "  Query data: " << queries.size() << " generated, " <<
+                nxdomain_percent << "% nonexistent, seed " << seed << endl <<
+                endl;
+        }
+
+        RecursiveBench recursive_bench(queries, concurrency, port, tlds,
+                                       zones, names);
+        BenchMark<RecursiveBench>(iteration, recursive_bench, true);
+        recursive_bench.printStatistics(cout);
+    } catch (const std::exception& ex) {
+        cout << "Test unexpectedly failed: " << ex.what() << endl;
+        return (1);
+    }
+
+    return (0);
 }
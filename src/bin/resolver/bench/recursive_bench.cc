@@ -0,0 +1,257 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <resolver/bench/recursive_bench.h>
+#include <resolver/bench/fake_hierarchy.h>
+
+#include <exceptions/exceptions.h>
+#include <asiolink/io_service.h>
+#include <asiodns/dns_service.h>
+#include <cache/resolver_cache.h>
+#include <nsas/nameserver_address_store.h>
+#include <resolve/recursive_query.h>
+#include <resolve/resolver_interface.h>
+#include <dns/message.h>
+#include <dns/rcode.h>
+
+#include <asio.hpp>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <iomanip>
+
+#include <sys/time.h>
+
+using namespace bundy::dns;
+using bundy::asiodns::RecursiveQuery;
+using bundy::resolve::ResolverInterface;
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+namespace {
+
+// The timeouts of the RecursiveQuery, in milliseconds.  The servers are
+// local, so nothing should time out unless the benchmark overloads them.
+const int QUERY_TIMEOUT = 2000;
+const int CLIENT_TIMEOUT = 4000;
+const int LOOKUP_TIMEOUT = 30000;
+const unsigned int RETRIES = 3;
+
+// What the NSAS uses to look up the addresses of the nameservers; like the
+// resolver, it passes the questions to the RecursiveQuery.
+class NSASResolver : public ResolverInterface {
+public:
+    NSASResolver() : query_(NULL) {}
+    void setQuery(RecursiveQuery* query) {
+        query_ = query;
+    }
+    virtual void resolve(const QuestionPtr& question,
+                         const CallbackPtr& callback)
+    {
+        query_->resolve(question, callback);
+    }
+private:
+    RecursiveQuery* query_;
+};
+
+uint64_t
+getMicroseconds() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (static_cast<uint64_t>(tv.tv_sec) * 1000000 + tv.tv_usec);
+}
+
+}
+
+class RecursiveBenchImpl {
+public:
+    RecursiveBenchImpl(const std::vector<QuestionPtr>& queries,
+                       size_t concurrency, uint16_t port, size_t tlds,
+                       size_t zones, size_t names) :
+        queries_(queries),
+        concurrency_(std::max(concurrency, static_cast<size_t>(1))),
+        dns_service_(service_, NULL, NULL),
+        hierarchy_(service_, port, tlds, zones, names),
+        nsas_resolver_(new NSASResolver),
+        nsas_(nsas_resolver_),
+        next_(0), outstanding_(0), in_resolve_(false),
+        client_queries_(0), cache_hits_(0), failures_(0),
+        upstream_queries_(0)
+    {
+        hierarchy_.primeCache(cache_);
+        query_.reset(new RecursiveQuery(
+                         dns_service_, nsas_, cache_,
+                         std::vector<std::pair<std::string, uint16_t> >(),
+                         std::vector<std::pair<std::string, uint16_t> >(),
+                         QUERY_TIMEOUT, CLIENT_TIMEOUT, LOOKUP_TIMEOUT,
+                         RETRIES));
+        query_->setNameserverPort(port);
+        nsas_resolver_->setQuery(query_.get());
+    }
+
+    size_t run();
+    void queryDone(uint64_t start, bool success);
+    void printStatistics(std::ostream& os) const;
+
+private:
+    void startQuery();
+
+    const std::vector<QuestionPtr> queries_;
+    const size_t concurrency_;
+
+    // The order matters: the components are destroyed in the reverse order.
+    asiolink::IOService service_;
+    asiodns::DNSService dns_service_;
+    FakeHierarchy hierarchy_;
+    boost::shared_ptr<NSASResolver> nsas_resolver_;
+    nsas::NameserverAddressStore nsas_;
+    cache::ResolverCache cache_;
+    boost::scoped_ptr<RecursiveQuery> query_;
+
+    // State of the current run
+    size_t next_;
+    size_t outstanding_;
+    bool in_resolve_;
+
+    // Statistics over all the runs
+    size_t client_queries_;
+    size_t cache_hits_;
+    size_t failures_;
+    size_t upstream_queries_;
+    std::vector<uint64_t> latencies_; // in microseconds
+};
+
+namespace {
+
+// Reports the result of a query to the benchmark.
+class BenchCallback : public ResolverInterface::Callback {
+public:
+    BenchCallback(RecursiveBenchImpl& bench, uint64_t start) :
+        bench_(bench), start_(start)
+    {}
+    virtual void success(const MessagePtr response) {
+        bench_.queryDone(start_, response->getRcode() != Rcode::SERVFAIL());
+    }
+    virtual void failure() {
+        bench_.queryDone(start_, false);
+    }
+private:
+    RecursiveBenchImpl& bench_;
+    const uint64_t start_;
+};
+
+}
+
+void
+RecursiveBenchImpl::startQuery() {
+    const ResolverInterface::CallbackPtr callback(
+        new BenchCallback(*this, getMicroseconds()));
+    ++outstanding_;
+    in_resolve_ = true;
+    query_->resolve(queries_[next_++], callback);
+    in_resolve_ = false;
+}
+
+void
+RecursiveBenchImpl::queryDone(uint64_t start, bool success) {
+    latencies_.push_back(getMicroseconds() - start);
+    ++client_queries_;
+    if (in_resolve_) {
+        // Answered right away, from the cache
+        ++cache_hits_;
+    }
+    if (!success) {
+        ++failures_;
+    }
+    --outstanding_;
+}
+
+size_t
+RecursiveBenchImpl::run() {
+    const size_t upstream_start = hierarchy_.getQueryCount();
+    next_ = 0;
+    // New queries are started from here rather than from the callbacks, so
+    // a long sequence of cache hits doesn't recurse.
+    while (next_ < queries_.size() || outstanding_ > 0) {
+        while (outstanding_ < concurrency_ && next_ < queries_.size()) {
+            startQuery();
+        }
+        if (outstanding_ > 0) {
+            if (service_.get_io_service().run_one() == 0) {
+                bundy_throw(Unexpected, "resolver benchmark stalled with " <<
+                            outstanding_ << " outstanding queries");
+            }
+        }
+    }
+    upstream_queries_ += hierarchy_.getQueryCount() - upstream_start;
+    return (queries_.size());
+}
+
+void
+RecursiveBenchImpl::printStatistics(std::ostream& os) const {
+    if (client_queries_ == 0) {
+        return;
+    }
+    std::vector<uint64_t> latencies(latencies_);
+    std::sort(latencies.begin(), latencies.end());
+    const double count = client_queries_;
+
+    os << std::fixed << std::setprecision(2);
+    os << "Client queries: " << client_queries_ << " (" << failures_ <<
+        " failed)" << std::endl;
+    os << "Cache hit ratio: " << 100.0 * cache_hits_ / count << "%" <<
+        std::endl;
+    os << "Upstream queries per client query: " <<
+        upstream_queries_ / count << std::endl;
+    os << std::setprecision(3) << "Latency (ms):";
+    static const struct {
+        const char* label;
+        double percentile;
+    } percentiles[] = {
+        { "50%", 50 }, { "90%", 90 }, { "99%", 99 }, { "99.9%", 99.9 }
+    };
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]);
+         ++i) {
+        const size_t pos = std::min(
+            static_cast<size_t>(percentiles[i].percentile *
+                                latencies.size() / 100),
+            latencies.size() - 1);
+        os << " " << percentiles[i].label << "=" << latencies[pos] / 1000.0;
+    }
+    os << " max=" << latencies.back() / 1000.0 << std::endl;
+}
+
+RecursiveBench::RecursiveBench(const std::vector<QuestionPtr>& queries,
+                               size_t concurrency, uint16_t port,
+                               size_t tlds, size_t zones, size_t names) :
+    impl_(new RecursiveBenchImpl(queries, concurrency, port, tlds, zones,
+                                 names))
+{}
+
+size_t
+RecursiveBench::run() {
+    return (impl_->run());
+}
+
+void
+RecursiveBench::printStatistics(std::ostream& os) const {
+    impl_->printStatistics(os);
+}
+
+}
+}
+}
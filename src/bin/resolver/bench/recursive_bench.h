@@ -0,0 +1,79 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef RESOLVER_BENCH_RECURSIVE_H
+#define RESOLVER_BENCH_RECURSIVE_H
+
+#include <dns/question.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <ostream>
+#include <vector>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace resolver {
+namespace bench {
+
+class RecursiveBenchImpl;
+
+/// \brief Benchmark of the real resolver components.
+///
+/// Unlike \c NaiveResolver, which only models the work, this replays a
+/// sequence of queries against a real \c RecursiveQuery, with a real
+/// \c ResolverCache and \c NameserverAddressStore, resolving them from
+/// a \c FakeHierarchy of authoritative servers in the same process.
+///
+/// The queries are sent to the \c RecursiveQuery the way the resolver does
+/// it for the NSAS, with up to a given number of them outstanding at a time.
+/// The cache and the NSAS are kept between the runs, so the first run starts
+/// cold and the next ones measure a warm resolver.
+///
+/// Besides the time (measured by \c bundy::bench::BenchMark), this collects
+/// the cache hit ratio (queries answered before \c resolve() returned), the
+/// number of queries to the authoritative servers per client query, and
+/// the latency percentiles.
+class RecursiveBench {
+public:
+    /// \brief Constructor.
+    ///
+    /// \param queries The queries to replay on each run.
+    /// \param concurrency The maximum number of outstanding queries.
+    /// \param port The port of the fake authoritative servers.
+    /// \param tlds, zones, names The size of the fake hierarchy (see
+    ///     \c FakeHierarchy).
+    RecursiveBench(const std::vector<dns::QuestionPtr>& queries,
+                   size_t concurrency, uint16_t port, size_t tlds,
+                   size_t zones, size_t names);
+
+    /// \brief Replay all the queries once.
+    ///
+    /// \return The number of queries.
+    size_t run();
+
+    /// \brief Print the statistics collected over all the runs.
+    void printStatistics(std::ostream& os) const;
+
+private:
+    // The resolver components, kept out of this header.
+    boost::shared_ptr<RecursiveBenchImpl> impl_;
+};
+
+}
+}
+}
+
+#endif
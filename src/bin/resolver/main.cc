@@ -88,6 +88,8 @@ my_command_handler(const string& command, ConstElementPtr args) {
             LOG_INFO(resolver_logger, RESOLVER_PRINT_COMMAND).arg(args);
             /* let's add that message to our answer as well */
             answer = createAnswer(0, args);
+        } else if (command == "getstats") {
+            answer = createAnswer(0, resolver->getStatistics());
         } else if (command == "shutdown") {
             // Is the pid argument provided?
             if (args && args->contains("pid")) {
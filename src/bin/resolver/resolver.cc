@@ -82,6 +82,8 @@ public:
         client_timeout_(4000),
         lookup_timeout_(30000),
         retries_(3),
+        prefetch_threshold_(0),
+        serve_stale_window_(0),
         // we apply "reject all" (implicit default of the loader) ACL by
         // default:
         query_acl_(acl::dns::getRequestLoader().load(Element::fromJSON("[]"))),
@@ -106,6 +108,8 @@ public:
                                         client_timeout_,
                                         lookup_timeout_,
                                         retries_);
+        rec_query_->setPrefetchThreshold(prefetch_threshold_);
+        rec_query_->setServeStaleWindow(serve_stale_window_);
     }
 
     void queryShutdown() {
@@ -166,6 +170,15 @@ public:
         return (*query_acl_);
     }
 
+    bundy::statistics::Histogram::Summary getLatencySummary() const {
+        if (rec_query_ == NULL) {
+            const bundy::statistics::Histogram::Summary empty =
+                { 0, 0, 0, 0, 0 };
+            return (empty);
+        }
+        return (rec_query_->getLatency().getSummary());
+    }
+
     void setQueryACL(boost::shared_ptr<const RequestACL> new_acl) {
         query_acl_ = new_acl;
     }
@@ -192,6 +205,11 @@ public:
     /// Number of retries after timeout
     unsigned retries_;
 
+    /// Prefetch threshold in percent of TTL (0 means disabled)
+    unsigned int prefetch_threshold_;
+    /// Serve-stale window in seconds (0 means disabled)
+    uint32_t serve_stale_window_;
+
 private:
     /// ACL on incoming queries
     boost::shared_ptr<const RequestACL> query_acl_;
@@ -643,6 +661,30 @@ Resolver::updateConfig(ConstElementPtr config, bool startup) {
             retries = retriesE->intValue();
             set_timeouts = true;
         }
+        bool set_cache_refresh(false);
+        unsigned int prefetch_threshold = impl_->prefetch_threshold_;
+        uint32_t stale_window = impl_->serve_stale_window_;
+        ConstElementPtr prefetchE(config->get("prefetch_threshold")),
+                        staleE(config->get("serve_stale_window"));
+        if (prefetchE) {
+            if (prefetchE->intValue() < 0 || prefetchE->intValue() > 100) {
+                LOG_ERROR(resolver_logger,
+                          RESOLVER_PREFETCH_THRESHOLD_INVALID)
+                          .arg(prefetchE->intValue());
+                bundy_throw(BadValue, "Prefetch threshold out of range");
+            }
+            prefetch_threshold = prefetchE->intValue();
+            set_cache_refresh = true;
+        }
+        if (staleE) {
+            if (staleE->intValue() < 0) {
+                LOG_ERROR(resolver_logger, RESOLVER_NEGATIVE_STALE_WINDOW)
+                          .arg(staleE->intValue());
+                bundy_throw(BadValue, "Negative serve-stale window");
+            }
+            stale_window = staleE->intValue();
+            set_cache_refresh = true;
+        }
         // Everything OK, so commit the changes
         // listenAddresses can fail to bind, so try them first
         bool need_query_restart = false;
@@ -663,6 +705,10 @@ Resolver::updateConfig(ConstElementPtr config, bool startup) {
             setTimeouts(qtimeout, ctimeout, ltimeout, retries);
             need_query_restart = true;
         }
+        if (set_cache_refresh) {
+            setCacheRefresh(prefetch_threshold, stale_window);
+            need_query_restart = true;
+        }
         if (query_acl) {
             setQueryACL(query_acl);
         }
@@ -750,6 +796,44 @@ Resolver::getRetries() const {
     return impl_->retries_;
 }
 
+void
+Resolver::setCacheRefresh(unsigned int prefetch_threshold,
+                          uint32_t serve_stale_window)
+{
+    LOG_DEBUG(resolver_logger, RESOLVER_DBG_CONFIG, RESOLVER_SET_CACHE_PARAMS)
+              .arg(prefetch_threshold).arg(serve_stale_window);
+
+    impl_->prefetch_threshold_ = prefetch_threshold;
+    impl_->serve_stale_window_ = serve_stale_window;
+}
+
+unsigned int
+Resolver::getPrefetchThreshold() const {
+    return (impl_->prefetch_threshold_);
+}
+
+uint32_t
+Resolver::getServeStaleWindow() const {
+    return (impl_->serve_stale_window_);
+}
+
+ConstElementPtr
+Resolver::getStatistics() const {
+    const bundy::statistics::Histogram::Summary summary =
+        impl_->getLatencySummary();
+    ElementPtr latency = Element::createMap();
+    latency->set("count", Element::create(static_cast<int64_t>(
+                                              summary.count)));
+    latency->set("p50", Element::create(static_cast<int64_t>(summary.p50)));
+    latency->set("p90", Element::create(static_cast<int64_t>(summary.p90)));
+    latency->set("p99", Element::create(static_cast<int64_t>(summary.p99)));
+    latency->set("p999", Element::create(static_cast<int64_t>(
+                                             summary.p999)));
+    ElementPtr statistics = Element::createMap();
+    statistics->set("latency", latency);
+    return (statistics);
+}
+
 AddressList
 Resolver::getListenAddresses() const {
     return (impl_->listen_);
@@ -234,6 +234,42 @@ public:
      */
     int getRetries() const;
 
+    /**
+     * \short Set options related to refreshing and serving cached data.
+     *
+     * \param prefetch_threshold When an answer found in the cache has
+     *     this percentage of its original TTL or less remaining, it's
+     *     refreshed in the background (0 means disabled).  It must not be
+     *     larger than 100.
+     * \param serve_stale_window If upstream servers fail to answer, the
+     *     cached data that expired no longer than this number of seconds
+     *     ago is returned instead of SERVFAIL (0 means disabled).
+     */
+    void setCacheRefresh(unsigned int prefetch_threshold = 0,
+                         uint32_t serve_stale_window = 0);
+
+    /**
+     * \brief Get the prefetch threshold (see \c setCacheRefresh())
+     */
+    unsigned int getPrefetchThreshold() const;
+
+    /**
+     * \brief Get the serve-stale window (see \c setCacheRefresh())
+     */
+    uint32_t getServeStaleWindow() const;
+
+    /**
+     * \brief Get the statistics data
+     *
+     * It's returned by the "getstats" command.  For now it's the latency
+     * of the answers to the queries (see
+     * \c bundy::asiodns::RecursiveQuery::getLatency()), as a map of
+     * "count", "p50", "p90", "p99" and "p999", the percentiles in
+     * microseconds.  The values are reset when the recursive query
+     * component is set up again, e.g., on reconfiguration.
+     */
+    bundy::data::ConstElementPtr getStatistics() const;
+
     /// Get the query ACL.
     ///
     /// \exception None
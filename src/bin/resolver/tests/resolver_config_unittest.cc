@@ -410,6 +410,46 @@ TEST_F(ResolverConfig, invalidTimeoutsConfig) {
         "}", "Negative number of retries");
 }
 
+TEST_F(ResolverConfig, cacheRefresh) {
+    EXPECT_EQ(0, server.getPrefetchThreshold());
+    EXPECT_EQ(0, server.getServeStaleWindow());
+    server.setCacheRefresh(10, 3600);
+    EXPECT_EQ(10, server.getPrefetchThreshold());
+    EXPECT_EQ(3600, server.getServeStaleWindow());
+    server.setCacheRefresh();
+    EXPECT_EQ(0, server.getPrefetchThreshold());
+    EXPECT_EQ(0, server.getServeStaleWindow());
+}
+
+TEST_F(ResolverConfig, cacheRefreshConfig) {
+    ConstElementPtr config = Element::fromJSON("{"
+                                               "\"prefetch_threshold\": 10,"
+                                               "\"serve_stale_window\": 3600"
+                                               "}");
+    ConstElementPtr result(server.updateConfig(config));
+    EXPECT_EQ(result->toWire(), bundy::config::createAnswer()->toWire());
+    EXPECT_EQ(10, server.getPrefetchThreshold());
+    EXPECT_EQ(3600, server.getServeStaleWindow());
+}
+
+TEST_F(ResolverConfig, invalidCacheRefreshConfig) {
+    invalidTest("{"
+        "\"prefetch_threshold\": \"error\""
+        "}", "Wrong prefetch threshold element type");
+    invalidTest("{"
+        "\"prefetch_threshold\": -1"
+        "}", "Negative prefetch threshold");
+    invalidTest("{"
+        "\"prefetch_threshold\": 101"
+        "}", "Too large prefetch threshold");
+    invalidTest("{"
+        "\"serve_stale_window\": \"error\""
+        "}", "Wrong serve-stale window element type");
+    invalidTest("{"
+        "\"serve_stale_window\": -1"
+        "}", "Negative serve-stale window");
+}
+
 TEST_F(ResolverConfig, defaultQueryACL) {
     // If no configuration is loaded, the default ACL should reject everything.
     EXPECT_EQ(REJECT, server.getQueryACL().execute(createRequest("192.0.2.1")));
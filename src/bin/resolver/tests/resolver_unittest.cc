@@ -193,5 +193,18 @@ TEST_F(ResolverTest, queryACL) {
     EXPECT_FALSE(dnsserv.hasAnswer());
 }
 
+// The statistics are there even before the resolver is set up (with
+// nothing measured, of course).
+TEST_F(ResolverTest, getStatistics) {
+    const ConstElementPtr stats = server.getStatistics();
+    ASSERT_TRUE(stats);
+    const ConstElementPtr latency = stats->get("latency");
+    ASSERT_TRUE(latency);
+    EXPECT_EQ(0, latency->get("count")->intValue());
+    EXPECT_EQ(0, latency->get("p50")->intValue());
+    EXPECT_EQ(0, latency->get("p90")->intValue());
+    EXPECT_EQ(0, latency->get("p99")->intValue());
+    EXPECT_EQ(0, latency->get("p999")->intValue());
+}
 
 }
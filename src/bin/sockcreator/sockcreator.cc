@@ -255,6 +255,18 @@ getSock(const int type, struct sockaddr* bind_addr, const socklen_t addr_len,
         // This is part of the binding process, so it's a bind error
         return (maybeClose(-2, sock, close_fun));
     }
+#ifdef SO_REUSEPORT
+    // Allow us to create multiple sockets on the same address and port
+    // (the instances requested from bundy-init), so that the query
+    // processing threads of a server each get their own socket and the
+    // kernel distributes packets among them.  Only processes with the same
+    // effective UID as ours can bind another one, so it doesn't open the
+    // port to others.
+    if (type == SOCK_DGRAM &&
+        setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+        return (maybeClose(-2, sock, close_fun));
+    }
+#endif
     if (bind(sock, bind_addr, addr_len) == -1) {
         return (maybeClose(-2, sock, close_fun));
     }
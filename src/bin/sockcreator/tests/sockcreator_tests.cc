@@ -179,6 +179,15 @@ void testAnyCreate(int socket_type, socket_check_t socket_check) {
     socklen_t len = sizeof(options);
     EXPECT_EQ(0, getsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &options, &len));
     EXPECT_NE(0, options);
+#ifdef SO_REUSEPORT
+    // UDP sockets can be shared by multiple receiving sockets.
+    EXPECT_EQ(0, getsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &options, &len));
+    if (socket_type == SOCK_DGRAM) {
+        EXPECT_NE(0, options);
+    } else {
+        EXPECT_EQ(0, options);
+    }
+#endif
 
     // ...and the address-family specific tests.
     addressFamilySpecificCheck(&addr, socket, socket_type);
@@ -0,0 +1,313 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asio.hpp>
+#include <asio/error.hpp>
+
+#include "batch_udp_server.h"
+#include "logger.h"
+
+#include <asiolink/dummy_io_cb.h>
+#include <asiolink/udp_endpoint.h>
+#include <asiolink/udp_socket.h>
+
+#include <boost/bind.hpp>
+
+#include <cassert>
+#include <cstring>
+
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>             // for some IPC/network system calls
+#include <errno.h>
+
+using namespace std;
+using namespace bundy::asiolink;
+
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+#define USE_MMSG 1
+#endif
+
+namespace bundy {
+namespace asiodns {
+
+// Message headers for recvmmsg()/sendmmsg().  If they are not available
+// we don't need anything.
+struct BatchUDPServer::MessageHeaders {
+#ifdef USE_MMSG
+    MessageHeaders(size_t batch_size) :
+        recv_iovs_(new struct iovec[batch_size]),
+        recv_msgs_(new struct mmsghdr[batch_size]),
+        send_iovs_(new struct iovec[batch_size]),
+        send_msgs_(new struct mmsghdr[batch_size])
+    {}
+    boost::scoped_array<struct iovec> recv_iovs_;
+    boost::scoped_array<struct mmsghdr> recv_msgs_;
+    boost::scoped_array<struct iovec> send_iovs_;
+    boost::scoped_array<struct mmsghdr> send_msgs_;
+#else
+    MessageHeaders(size_t) {}
+#endif
+};
+
+const size_t BatchUDPServer::DEFAULT_BATCH_SIZE;
+
+BatchUDPServerPtr
+BatchUDPServer::create(asio::io_service& io_service, const int fd,
+                       const int af, DNSLookup* lookup, size_t batch_size)
+{
+    return (BatchUDPServerPtr(new BatchUDPServer(io_service, fd, af, lookup,
+                                                 batch_size)));
+}
+
+BatchUDPServer::BatchUDPServer(asio::io_service& io_service, const int fd,
+                               const int af, DNSLookup* lookup,
+                               size_t batch_size) :
+    batch_size_(batch_size),
+    query_(new bundy::dns::Message(bundy::dns::Message::PARSE)),
+    lookup_callback_(lookup),
+    resume_called_(false), done_(false), stopped_(false)
+{
+    if (af != AF_INET && af != AF_INET6) {
+        bundy_throw(InvalidParameter, "Address family must be either AF_INET "
+                  "or AF_INET6, not " << af);
+    }
+    if (!lookup) {
+        bundy_throw(InvalidParameter, "null lookup callback given to "
+                  "BatchUDPServer");
+    }
+    if (batch_size == 0) {
+        bundy_throw(InvalidParameter, "batch size of BatchUDPServer must not "
+                  "be 0");
+    }
+    slots_.reset(new Slot[batch_size]);
+    answers_.reset(new size_t[batch_size]);
+    headers_.reset(new MessageHeaders(batch_size));
+
+    LOG_DEBUG(logger, DBGLVL_TRACE_BASIC, ASIODNS_FD_ADD_UDP).arg(fd);
+    try {
+        socket_.reset(new asio::ip::udp::socket(io_service));
+        socket_->assign(af == AF_INET6 ? asio::ip::udp::v6() :
+                        asio::ip::udp::v4(), fd);
+    } catch (const std::exception& exception) {
+        // Whatever the thing throws, it is something from ASIO and we
+        // convert it
+        bundy_throw(IOError, exception.what());
+    }
+    udp_socket_.reset(new UDPSocket<DummyIOCallback>(*socket_));
+}
+
+BatchUDPServer::~BatchUDPServer() {
+}
+
+void
+BatchUDPServer::scheduleRead() {
+    // We only wait for the socket to become readable; the data are read
+    // in handleRead() directly with the system calls.
+    socket_->async_receive(
+        asio::null_buffers(),
+        boost::bind(&BatchUDPServer::handleRead, shared_from_this(), _1));
+}
+
+size_t
+BatchUDPServer::receiveBatch() {
+    const int fd = socket_->native();
+    size_t n_received = 0;
+#ifdef USE_MMSG
+    struct iovec* const iovs = headers_->recv_iovs_.get();
+    struct mmsghdr* const msgs = headers_->recv_msgs_.get();
+    for (size_t i = 0; i < batch_size_; ++i) {
+        Slot& slot = slots_[i];
+        iovs[i].iov_base = slot.data_;
+        iovs[i].iov_len = MAX_LENGTH;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = slot.sender_.data();
+        msgs[i].msg_hdr.msg_namelen = slot.sender_.capacity();
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    const int result = recvmmsg(fd, msgs, batch_size_, MSG_DONTWAIT, NULL);
+    if (result > 0) {
+        n_received = result;
+        for (size_t i = 0; i < n_received; ++i) {
+            slots_[i].sender_.resize(msgs[i].msg_hdr.msg_namelen);
+            slots_[i].length_ = msgs[i].msg_len;
+        }
+    }
+#else
+    int result = 0;
+    while (n_received < batch_size_) {
+        Slot& slot = slots_[n_received];
+        socklen_t namelen = slot.sender_.capacity();
+        result = recvfrom(fd, slot.data_, MAX_LENGTH, MSG_DONTWAIT,
+                          slot.sender_.data(), &namelen);
+        if (result < 0) {
+            break;
+        }
+        slot.sender_.resize(namelen);
+        slot.length_ = result;
+        ++n_received;
+    }
+#endif
+    // Some error (other than the expected ones when there's no more data)
+    // happened before receiving anything.  Log it, and we'll try again.
+    if (result < 0 && n_received == 0 && errno != EAGAIN &&
+        errno != EWOULDBLOCK && errno != EINTR) {
+        LOG_ERROR(logger, ASIODNS_UDP_BATCH_RECEIVE_FAIL).arg(strerror(errno));
+    }
+    return (n_received);
+}
+
+void
+BatchUDPServer::sendBatch(size_t n_answers) {
+    const int fd = socket_->native();
+#ifdef USE_MMSG
+    struct iovec* const iovs = headers_->send_iovs_.get();
+    struct mmsghdr* const msgs = headers_->send_msgs_.get();
+    for (size_t i = 0; i < n_answers; ++i) {
+        Slot& slot = slots_[answers_[i]];
+        iovs[i].iov_base = const_cast<void*>(slot.output_buffer_->getData());
+        iovs[i].iov_len = slot.output_buffer_->getLength();
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = slot.sender_.data();
+        msgs[i].msg_hdr.msg_namelen = slot.sender_.size();
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    size_t n_sent = 0;
+    while (n_sent < n_answers) {
+        const int result = sendmmsg(fd, &msgs[n_sent], n_answers - n_sent, 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The first of the remaining answers couldn't be sent.  Skip it
+            // and try the rest.
+            LOG_ERROR(logger, ASIODNS_UDP_BATCH_SEND_FAIL).
+                arg(slots_[answers_[n_sent]].sender_.address().to_string()).
+                arg(strerror(errno));
+            ++n_sent;
+        } else {
+            n_sent += result;
+        }
+    }
+#else
+    for (size_t i = 0; i < n_answers; ++i) {
+        Slot& slot = slots_[answers_[i]];
+        if (sendto(fd, slot.output_buffer_->getData(),
+                   slot.output_buffer_->getLength(), 0, slot.sender_.data(),
+                   slot.sender_.size()) < 0) {
+            LOG_ERROR(logger, ASIODNS_UDP_BATCH_SEND_FAIL).
+                arg(slot.sender_.address().to_string()).arg(strerror(errno));
+        }
+    }
+#endif
+}
+
+void
+BatchUDPServer::handleRead(const asio::error_code& ec) {
+    if (stopped_) {
+        // See SyncUDPServer::handleRead().
+        assert(socket_ && !socket_->is_open());
+        return;
+    }
+    if (ec) {
+        using namespace asio::error;
+        const asio::error_code::value_type err_val = ec.value();
+
+        // See TCPServer::operator() for details on error handling.
+        if (err_val == operation_aborted || err_val == bad_descriptor) {
+            return;
+        }
+        if (err_val != would_block && err_val != try_again &&
+            err_val != interrupted) {
+            LOG_ERROR(logger, ASIODNS_UDP_BATCH_RECEIVE_FAIL).
+                arg(ec.message());
+        }
+        scheduleRead();
+        return;
+    }
+
+    const size_t n_received = receiveBatch();
+    size_t n_answers = 0;
+    for (size_t i = 0; i < n_received; ++i) {
+        Slot& slot = slots_[i];
+        if (slot.length_ == 0) {
+            continue;
+        }
+
+        // See SyncUDPServer::handleRead() about buffer management.
+        slot.output_buffer_->clear();
+        done_ = false;
+        resume_called_ = false;
+
+        const IOMessage message(slot.data_, slot.length_, *udp_socket_,
+                                slot.udp_endpoint_);
+        (*lookup_callback_)(message, query_, answer_, slot.output_buffer_,
+                            this);
+
+        if (!resume_called_) {
+            bundy_throw(bundy::Unexpected,
+                      "No resume called from the lookup callback");
+        }
+        if (stopped_) {
+            // The server was stopped in the callback; the socket is closed
+            // so we can't send anything.
+            return;
+        }
+        if (done_) {
+            answers_[n_answers++] = i;
+        }
+    }
+    if (n_answers > 0) {
+        sendBatch(n_answers);
+    }
+
+    scheduleRead();
+}
+
+void
+BatchUDPServer::operator()(asio::error_code, size_t) {
+    // To start the server, we just schedule reading of data when they
+    // arrive.
+    scheduleRead();
+}
+
+void
+BatchUDPServer::stop() {
+    // See SyncUDPServer::stop() about why we close the socket here.
+    socket_->close(ec_);
+    stopped_ = true;
+    if (ec_) {
+        LOG_ERROR(logger, ASIODNS_BATCH_UDP_CLOSE_FAIL).arg(ec_.message());
+    }
+}
+
+void
+BatchUDPServer::resume(const bool done) {
+    resume_called_ = true;
+    done_ = done;
+}
+
+bool
+BatchUDPServer::hasAnswer() {
+    return (done_);
+}
+
+} // namespace asiodns
+} // namespace bundy
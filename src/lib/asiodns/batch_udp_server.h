@@ -0,0 +1,216 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef BATCH_UDP_SERVER_H
+#define BATCH_UDP_SERVER_H 1
+
+#ifndef ASIO_HPP
+#error "asio.hpp must be included before including this, see asiolink.h as to why"
+#endif
+
+#include "dns_lookup.h"
+#include "dns_server.h"
+
+#include <dns/message.h>
+#include <asiolink/dummy_io_cb.h>
+#include <asiolink/udp_endpoint.h>
+#include <asiolink/udp_socket.h>
+#include <util/buffer.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace asiodns {
+
+class BatchUDPServer;
+typedef boost::shared_ptr<BatchUDPServer> BatchUDPServerPtr;
+
+/// \brief A synchronous UDP server that handles multiple queries at a time.
+///
+/// This is a variant of \c SyncUDPServer.  It has the same restriction on
+/// the lookup callback (it must complete the answer before returning and
+/// must call \c resume() from within the callback), but instead of receiving
+/// and sending one packet per system call, it reads all queries that are
+/// available on the socket, up to the batch size given on construction,
+/// passes them to the lookup callback one by one, and then sends all
+/// resulting answers together.  Where the system supports it, receiving and
+/// sending are done with a single \c recvmmsg() and \c sendmmsg() call,
+/// respectively, which significantly reduces the number of system calls per
+/// query under heavy load.  Otherwise it falls back to a sequence of
+/// \c recvfrom() and \c sendto() calls, which still saves the overhead of
+/// going through the event loop for each query.
+///
+/// Under light load this server behaves the same as \c SyncUDPServer:
+/// it waits until the socket becomes readable, and then typically receives
+/// only a single query.
+///
+/// As with \c SyncUDPServer, objects of this class must be created via the
+/// \c create() factory and are managed by \c boost::shared_ptr.
+class BatchUDPServer : public DNSServer,
+                       public boost::enable_shared_from_this<BatchUDPServer>,
+                       boost::noncopyable
+{
+public:
+    /// \brief The default maximum number of queries handled at a time.
+    static const size_t DEFAULT_BATCH_SIZE = 32;
+
+private:
+    /// \brief Constructor.
+    ///
+    /// This is hidden as private (see the class description).
+    BatchUDPServer(asio::io_service& io_service, const int fd, const int af,
+                   DNSLookup* lookup, size_t batch_size);
+
+public:
+    /// \brief Factory of BatchUDPServer object in the form of shared_ptr.
+    ///
+    /// The parameters other than \c batch_size are the same as those for
+    /// \c SyncUDPServer::create().
+    ///
+    /// \param io_service the asio::io_service to work with
+    /// \param fd the file descriptor of opened UDP socket
+    /// \param af address family, either AF_INET or AF_INET6
+    /// \param lookup the callbackprovider for DNS lookup events (must not be
+    ///        NULL)
+    /// \param batch_size the maximum number of queries received and answered
+    ///        at a time (must not be 0)
+    ///
+    /// \throw bundy::InvalidParameter if af is neither AF_INET nor AF_INET6
+    /// \throw bundy::InvalidParameter lookup is NULL or batch_size is 0
+    /// \throw bundy::asiolink::IOError when a low-level error happens, like the
+    ///     fd is not a valid descriptor.
+    static BatchUDPServerPtr create(asio::io_service& io_service,
+                                    const int fd, const int af,
+                                    DNSLookup* lookup,
+                                    size_t batch_size = DEFAULT_BATCH_SIZE);
+
+    /// \brief Destructor.
+    virtual ~BatchUDPServer();
+
+    /// \brief Start the BatchUDPServer.
+    ///
+    /// See \c SyncUDPServer::operator().
+    virtual void operator()(asio::error_code ec = asio::error_code(),
+                            size_t length = 0);
+
+    /// \brief Calls the lookup callback
+    virtual void asyncLookup() {
+        bundy_throw(Unexpected,
+                  "BatchUDPServer doesn't support asyncLookup by design, use "
+                  "UDPServer if you need it.");
+    }
+
+    /// \brief Stop the running server
+    ///
+    /// If this is called from the lookup callback, the remaining queries
+    /// of the current batch are dropped and no answer is sent.
+    ///
+    /// \note once the server stopped, it can't restart
+    virtual void stop();
+
+    /// \brief Resume operation
+    ///
+    /// As with \c SyncUDPServer::resume(), this must be called directly from
+    /// the lookup callback; otherwise an Unexpected exception is thrown.
+    ///
+    /// \param done Set this to true if the lookup action is done and
+    ///        we have an answer
+    virtual void resume(const bool done);
+
+    /// \brief Check if we have an answer to the query being processed
+    ///
+    /// \return true if we have an answer
+    virtual bool hasAnswer();
+
+    /// \brief Clones the object
+    ///
+    /// See \c SyncUDPServer::clone(); this always throws Unexpected.
+    virtual DNSServer* clone() {
+        bundy_throw(Unexpected, "BatchUDPServer can't be cloned.");
+    }
+
+    /// \brief Return the maximum number of queries handled at a time.
+    size_t getBatchSize() const { return (batch_size_); }
+
+private:
+    // Maximum size of incoming UDP packet
+    static const size_t MAX_LENGTH = 4096;
+
+    // Resources for a single query (and its answer) in a batch.
+    struct Slot {
+        Slot() : output_buffer_(new bundy::util::OutputBuffer(0)),
+                 udp_endpoint_(sender_), length_(0)
+        {}
+        // Buffer for incoming data
+        uint8_t data_[MAX_LENGTH];
+        // The buffer to render the answer to.  It's kept until the answers
+        // of the whole batch are sent.
+        const bundy::util::OutputBufferPtr output_buffer_;
+        // The sender of the query (and destination of the answer), and its
+        // IOEndpoint wrapper referring to it.
+        asio::ip::udp::endpoint sender_;
+        asiolink::UDPEndpoint udp_endpoint_;
+        // The size of received data
+        size_t length_;
+    };
+
+    // The maximum number of queries handled at a time
+    const size_t batch_size_;
+    // batch_size_ slots; the first ones are used for the current batch
+    boost::scoped_array<Slot> slots_;
+    // Indices of the slots that have an answer to be sent in the current
+    // batch
+    boost::scoped_array<size_t> answers_;
+    // System dependent message headers for the batched system calls
+    struct MessageHeaders;
+    boost::scoped_ptr<MessageHeaders> headers_;
+    // Objects to hold the query message and the answer (placeholders, see
+    // SyncUDPServer)
+    bundy::dns::MessagePtr query_, answer_;
+    // The socket used for the communication and its IOSocket wrapper
+    boost::scoped_ptr<asio::ip::udp::socket> socket_;
+    boost::scoped_ptr<asiolink::UDPSocket<asiolink::DummyIOCallback> >
+    udp_socket_;
+    // Callback
+    const DNSLookup* lookup_callback_;
+    // Answers from the lookup callback (signalled through resume())
+    bool resume_called_, done_;
+    // This turns true when the server stops.
+    bool stopped_;
+    // Placeholder for error code object.
+    asio::error_code ec_;
+
+    // Schedule the next wait for readability of the socket.
+    void scheduleRead();
+    // Callback from the socket when it becomes readable (or on error).
+    void handleRead(const asio::error_code& ec);
+    // Read available queries into the slots, and return the number of them.
+    size_t receiveBatch();
+    // Send the answers in the slots listed in answers_.
+    void sendBatch(size_t n_answers);
+};
+
+} // namespace asiodns
+} // namespace bundy
+#endif // BATCH_UDP_SERVER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -24,6 +24,7 @@
 #include <tcp_server.h>
 #include <udp_server.h>
 #include <sync_udp_server.h>
+#include <batch_udp_server.h>
 
 #include <boost/foreach.hpp>
 
@@ -69,6 +70,14 @@ public:
         startServer(server);
     }
 
+    // Likewise, for BatchUDPServer.
+    void addBatchUDPServerFromFD(int fd, int af) {
+        BatchUDPServerPtr server(BatchUDPServer::create(
+                                     io_service_.get_io_service(), fd, af,
+                                     lookup_));
+        startServer(server);
+    }
+
     void setTCPRecvTimeout(size_t timeout) {
         // Store it for future tcp connections
         tcp_recv_timeout_ = timeout;
@@ -107,7 +116,9 @@ void DNSService::addServerUDPFromFD(int fd, int af, ServerFlag options) {
         bundy_throw(bundy::InvalidParameter, "Invalid DNS/UDP server option: "
                   << options);
     }
-    if ((options & SERVER_SYNC_OK) != 0) {
+    if ((options & SERVER_BATCH) != 0) {
+        impl_->addBatchUDPServerFromFD(fd, af);
+    } else if ((options & SERVER_SYNC_OK) != 0) {
         impl_->addSyncUDPServerFromFD(fd, af);
     } else {
         impl_->addServerFromFD<DNSServiceImpl::UDPServerPtr, UDPServer>(
@@ -60,19 +60,24 @@ public:
     /// class.
     enum ServerFlag {
         SERVER_DEFAULT = 0, ///< The default flag (no particular property)
-        SERVER_SYNC_OK = 1 ///< The server can act in the "synchronous" mode.
-                           ///< In this mode, the client ensures that the
-                           ///< lookup provider always completes the query
-                           ///< process and it immediately releases the
-                           ///< ownership of the given buffer.  This allows
-                           ///< the server implementation to introduce some
-                           ///< optimization such as omitting unnecessary
-                           ///< operation or reusing internal resources.
-                           ///< Note that in functionality the non
-                           ///< "synchronous" mode is compatible with the
-                           ///< synchronous mode; it's up to the server
-                           ///< implementation whether it exploits the
-                           ///< information given by the client.
+        SERVER_SYNC_OK = 1, ///< The server can act in the "synchronous" mode.
+                            ///< In this mode, the client ensures that the
+                            ///< lookup provider always completes the query
+                            ///< process and it immediately releases the
+                            ///< ownership of the given buffer.  This allows
+                            ///< the server implementation to introduce some
+                            ///< optimization such as omitting unnecessary
+                            ///< operation or reusing internal resources.
+                            ///< Note that in functionality the non
+                            ///< "synchronous" mode is compatible with the
+                            ///< synchronous mode; it's up to the server
+                            ///< implementation whether it exploits the
+                            ///< information given by the client.
+        SERVER_BATCH = 2    ///< The server receives and answers multiple
+                            ///< queries at a time where possible, reducing
+                            ///< the number of system calls under load.
+                            ///< This requires the same condition on the
+                            ///< client as \c SERVER_SYNC_OK, and implies it.
     };
 
 public:
@@ -124,7 +129,7 @@ private:
     // Bit or'ed all defined \c ServerFlag values.  Used internally for
     // compatibility check.  Note that this doesn't have to be used by
     // applications, and doesn't have to be defined in the "base" class.
-    static const unsigned int SERVER_DEFINED_FLAGS = 1;
+    static const unsigned int SERVER_DEFINED_FLAGS = 3;
 
 public:
     /// \brief The constructor without any servers.
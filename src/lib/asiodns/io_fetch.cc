@@ -40,6 +40,7 @@
 #include <dns/rcode.h>
 
 #include <asiodns/io_fetch.h>
+#include <asiodns/upstream_socket_pool.h>
 
 #include <util/buffer.h>
 #include <util/random/qid_gen.h>
@@ -101,6 +102,8 @@ struct IOFetchData {
     uint8_t                     staging[IOFetch::STAGING_LENGTH];
                                             ///< Temporary array for received data
     bundy::dns::qid_t             qid;         ///< The QID set in the query
+    boost::shared_ptr<UpstreamSocketPool> pool; ///< Socket pool to use
+    UpstreamSocketPool::QueryID pool_query;  ///< The query in the pool
 
     /// \brief Constructor
     ///
@@ -150,7 +153,8 @@ struct IOFetchData {
         packet(false),
         origin(ASIODNS_UNKNOWN_ORIGIN),
         staging(),
-        qid(QidGenerator::getInstance().generateQid())
+        qid(QidGenerator::getInstance().generateQid()),
+        pool_query(0)
     {}
 
     // Checks if the response we received was ok;
@@ -239,6 +243,11 @@ IOFetch::getProtocol() const {
     return (data_->protocol);
 }
 
+void
+IOFetch::setSocketPool(const boost::shared_ptr<UpstreamSocketPool>& pool) {
+    data_->pool = pool;
+}
+
 /// The function operator is implemented with the "stackless coroutine"
 /// pattern; see internal/coroutine.h for details.
 
@@ -275,6 +284,13 @@ IOFetch::operator()(asio::error_code ec, size_t length) {
                 TIME_OUT));
         }
 
+        // If there's a socket pool, send the query through it.  We resume
+        // here only if that fails, and then use a socket of our own.
+        if (data_->pool) {
+            CORO_YIELD sendThroughPool();
+            data_->pool.reset();
+        }
+
         // Open a connection to the target system.  For speed, if the operation
         // is synchronous (i.e. UDP operation) we bypass the yield.
         data_->origin = ASIODNS_OPEN_SOCKET;
@@ -334,6 +350,41 @@ IOFetch::operator()(asio::error_code ec, size_t length) {
     }
 }
 
+// Called (as part of a coroutine step) to hand the query over to the socket
+// pool.  The coroutine is resumed right away if the pool can't take it.
+
+void
+IOFetch::sendThroughPool() {
+    data_->pool_query = data_->pool->send(
+        data_->protocol == TCP, data_->remote_snd->getAddress(),
+        data_->remote_snd->getPort(), *data_->msgbuf,
+        boost::bind(&IOFetch::poolCompleted, *this, _1, _2, _3));
+    if (data_->pool_query == 0) {
+        data_->timer.get_io_service().post(*this);
+    }
+}
+
+void
+IOFetch::poolCompleted(bool ok, const uint8_t* data, size_t length) {
+    if (data_->stopped) {
+        return;
+    }
+    data_->pool_query = 0;
+    if (!ok) {
+        LOG_DEBUG(logger, DBG_COMMON, ASIODNS_POOL_FETCH_FAIL).
+            arg(data_->remote_snd->getAddress().toText()).
+            arg(data_->remote_snd->getPort());
+        (*this)();
+        return;
+    }
+
+    // The pool matched the QID and the server address already
+    data_->received->clear();
+    data_->received->writeData(data, length);
+    data_->cumulative = length;
+    stop(SUCCESS);
+}
+
 // Function that stops the coroutine sequence.  It is called either when the
 // query finishes or when the timer times out.  Either way, it sets the
 // "stopped_" flag and cancels anything that is in progress.
@@ -388,6 +439,10 @@ IOFetch::stop(Result result) {
 
         // Stop requested, cancel and I/O's on the socket and shut it down,
         // and cancel the timer.
+        if (data_->pool_query != 0) {
+            data_->pool->cancel(data_->pool_query);
+            data_->pool_query = 0;
+        }
         data_->socket->cancel();
         data_->socket->close();
 
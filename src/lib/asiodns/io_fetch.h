@@ -36,6 +36,7 @@ namespace asiodns {
 
 // Forward declarations
 struct IOFetchData;
+class UpstreamSocketPool;
 
 /// \brief Upstream Fetch Processing
 ///
@@ -184,6 +185,17 @@ public:
     /// \return Protocol associated with this IOFetch object.
     Protocol getProtocol() const;
 
+    /// \brief Use a pool of sockets for the fetch
+    ///
+    /// If set (before the fetch starts), the query is sent through the
+    /// given pool (see \c UpstreamSocketPool) instead of a socket opened
+    /// for this fetch.  If the pool can't take the query, or the pooled
+    /// socket fails before the response arrives, the fetch falls back to a
+    /// socket of its own.
+    ///
+    /// \param pool The pool.  It's kept until the fetch completes.
+    void setSocketPool(const boost::shared_ptr<UpstreamSocketPool>& pool);
+
     /// \brief Coroutine entry point
     ///
     /// The operator() method is the method in which the coroutine code enters
@@ -212,6 +224,15 @@ private:
             bundy::util::OutputBufferPtr& buff, Callback* cb, int wait,
             bool edns = true);
 
+    /// \brief Send the query through the socket pool
+    ///
+    /// Continues the coroutine with a socket of its own if the pool can't
+    /// take the query.
+    void sendThroughPool();
+
+    /// \brief Handler of the response (or failure) from the socket pool
+    void poolCompleted(bool ok, const uint8_t* data, size_t length);
+
     /// \brief Log I/O Failure
     ///
     /// Records an I/O failure to the log file
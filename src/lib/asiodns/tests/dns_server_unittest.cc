@@ -20,6 +20,7 @@
 #include <asiolink/io_error.h>
 #include <asiodns/udp_server.h>
 #include <asiodns/sync_udp_server.h>
+#include <asiodns/batch_udp_server.h>
 #include <asiodns/tcp_server.h>
 #include <asiodns/dns_answer.h>
 #include <asiodns/dns_lookup.h>
@@ -140,7 +141,7 @@ class SimpleAnswer : public DNSAnswer, public ServerStopper {
 };
 
 /// \brief Mixture of DummyLookup and SimpleAnswer: build the answer in the
-/// lookup callback.  Used with SyncUDPServer.
+/// lookup callback.  Used with SyncUDPServer and BatchUDPServer.
 class SyncDummyLookup : public DummyLookup {
 public:
     virtual void operator()(const IOMessage& io_message,
@@ -374,7 +375,8 @@ class TCPClient : public SimpleClient {
 // This is only the active part of the test. We run the test case four times, once
 // for each type of initialization (once when giving it the address and port,
 // once when giving the file descriptor) multiplied by once for each type of UDP
-// server (UDPServer and SyncUDPServer), to ensure it works exactly the same.
+// server (UDPServer, SyncUDPServer and BatchUDPServer), to ensure it works
+// exactly the same.
 template<class UDPServerClass>
 class DNSServerTestBase : public::testing::Test {
     protected:
@@ -538,20 +540,31 @@ FdInit<SyncUDPServer>::createServer(int fd, int af) {
     return (SyncUDPServer::create(this->service, fd, af, this->lookup_));
 }
 
+// Likewise, for BatchUDPServer.
+template<>
+boost::shared_ptr<BatchUDPServer>
+FdInit<BatchUDPServer>::createServer(int fd, int af) {
+    delete this->lookup_;
+    this->lookup_ = new SyncDummyLookup;
+    return (BatchUDPServer::create(this->service, fd, af, this->lookup_));
+}
+
 // This makes it the template as gtest wants it.
 template<class Parent>
 class DNSServerTest : public Parent { };
 
-typedef ::testing::Types<FdInit<UDPServer>, FdInit<SyncUDPServer> >
-    ServerTypes;
+typedef ::testing::Types<FdInit<UDPServer>, FdInit<SyncUDPServer>,
+                         FdInit<BatchUDPServer> > ServerTypes;
 TYPED_TEST_CASE(DNSServerTest, ServerTypes);
 
-// Some tests work only for SyncUDPServer, some others work only for
-// (non Sync)UDPServer.  We specialize these tests.
+// Some tests work only for SyncUDPServer (or BatchUDPServer), some others
+// work only for (non Sync)UDPServer.  We specialize these tests.
 typedef FdInit<UDPServer> AsyncServerTest;
 typedef FdInit<SyncUDPServer> SyncServerTest;
+typedef FdInit<BatchUDPServer> BatchServerTest;
 
-typedef ::testing::Types<UDPServer, SyncUDPServer> UDPServerTypes;
+typedef ::testing::Types<UDPServer, SyncUDPServer, BatchUDPServer>
+    UDPServerTypes;
 TYPED_TEST_CASE(DNSServerTestBase, UDPServerTypes);
 
 template<class UDPServerClass>
@@ -778,4 +791,63 @@ TEST_F(SyncServerTest, resetUDPServerBeforeEvent) {
     EXPECT_FALSE(io_service_is_time_out);
 }
 
+// Same checks as SyncServerTest for BatchUDPServer
+TEST_F(BatchServerTest, unsupportedOps) {
+    EXPECT_THROW(udp_server_->clone(), bundy::Unexpected);
+    EXPECT_THROW(udp_server_->asyncLookup(), bundy::Unexpected);
+}
+
+TEST_F(BatchServerTest, mustResume) {
+    lookup_->allow_resume_ = false;
+    ASSERT_THROW(testStopServerByStopper(*udp_server_, udp_client_, lookup_),
+                 bundy::Unexpected);
+}
+
+TEST_F(BatchServerTest, badParameters) {
+    EXPECT_THROW(BatchUDPServer::create(service, 0, AF_INET, NULL),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(BatchUDPServer::create(service, 0, AF_INET, lookup_, 0),
+                 bundy::InvalidParameter);
+    EXPECT_EQ(BatchUDPServer::DEFAULT_BATCH_SIZE,
+              udp_server_->getBatchSize());
+}
+
+// Queries that are available on the socket at the same time are received
+// and answered in a single event.
+TEST_F(BatchServerTest, multipleQueries) {
+    const char* const queries[] = { "query1", "query2", "query3" };
+    const size_t n_queries = sizeof(queries) / sizeof(queries[0]);
+
+    ip::udp::socket client(service, ip::udp::v6());
+    const ip::udp::endpoint server_ep(server_address_, server_port);
+    for (size_t i = 0; i < n_queries; ++i) {
+        client.send_to(buffer(queries[i], std::strlen(queries[i]) + 1),
+                       server_ep);
+    }
+
+    // Handle exactly one event (readability of the server socket).  It
+    // should answer all queries.  The alarm is a safeguard in case the
+    // event doesn't come for some reason.
+    (*udp_server_)();
+    void (*prev_handler)(int) = std::signal(SIGALRM, stopIOService);
+    current_service = &service;
+    alarm(5);
+    service.run_one();
+    alarm(0);
+    std::signal(SIGALRM, prev_handler);
+    ASSERT_FALSE(io_service_is_time_out);
+
+    socket_base::non_blocking_io command(true);
+    client.io_control(command);
+    for (size_t i = 0; i < n_queries; ++i) {
+        char data[SimpleClient::MAX_DATA_LEN];
+        ip::udp::endpoint sender;
+        asio::error_code ec;
+        const size_t len = client.receive_from(buffer(data, sizeof(data)),
+                                               sender, 0, ec);
+        ASSERT_FALSE(ec) << ec.message();
+        EXPECT_EQ(std::string(queries[i]), std::string(data, len - 1));
+    }
+}
+
 }
@@ -221,11 +221,24 @@ TEST_F(UDPDNSServiceTest, syncUDPServerFromFD) {
     EXPECT_EQ(first_buffer_, second_buffer_);
 }
 
+TEST_F(UDPDNSServiceTest, batchUDPServerFromFD) {
+    // If "BATCH" option is specified, a batched server should be created.
+    // The two packets are sent before the server starts, so they are
+    // received in the same batch and passed with different output buffers.
+    // (The synchronous server would have used the same buffer).
+    dns_service.addServerUDPFromFD(getSocketFD(AF_INET6, TEST_IPV6_ADDR,
+                                               TEST_SERVER_PORT),
+                                   AF_INET6, DNSService::SERVER_BATCH);
+    runService();
+    EXPECT_TRUE(serverStopSucceed());
+    EXPECT_NE(first_buffer_, second_buffer_);
+}
+
 TEST_F(UDPDNSServiceTest, addUDPServerFromFDWithUnknownOption) {
     // Use of undefined/incompatible options should result in an exception.
     EXPECT_THROW(dns_service.addServerUDPFromFD(
                      getSocketFD(AF_INET6, TEST_IPV6_ADDR, TEST_SERVER_PORT),
-                     AF_INET6, static_cast<DNSService::ServerFlag>(2)),
+                     AF_INET6, static_cast<DNSService::ServerFlag>(4)),
                  bundy::InvalidParameter);
 }
 
@@ -40,6 +40,7 @@
 #include <asiolink/io_endpoint.h>
 #include <asiolink/io_service.h>
 #include <asiodns/io_fetch.h>
+#include <asiodns/upstream_socket_pool.h>
 
 using namespace asio;
 using namespace bundy::dns;
@@ -656,6 +657,31 @@ TEST_F(IOFetchTest, UdpSendReceiveBadQidResend) {
     EXPECT_TRUE(run_);;
 }
 
+// The same, with the query sent through a socket pool.
+TEST_F(IOFetchTest, UdpSendReceivePooled) {
+    expected_ = IOFetch::SUCCESS;
+    udp_fetch_.setSocketPool(boost::shared_ptr<UpstreamSocketPool>(
+                                 new UpstreamSocketPool(service_)));
+
+    udpSendReturnTest(false, false);
+
+    EXPECT_TRUE(run_);
+}
+
+// The pool drops a response with a wrong QID, and the query times out.
+TEST_F(IOFetchTest, UdpSendReceiveBadQidPooled) {
+    expected_ = IOFetch::TIME_OUT;
+    const boost::shared_ptr<UpstreamSocketPool> pool(
+        new UpstreamSocketPool(service_));
+    udp_fetch_.setSocketPool(pool);
+
+    udpSendReturnTest(true, false);
+
+    EXPECT_TRUE(run_);
+    // The timed out query is no longer waited for.
+    EXPECT_EQ(0, pool->getQueryCount());
+}
+
 // Do the same tests for TCP transport
 
 TEST_F(IOFetchTest, TcpStop) {
@@ -0,0 +1,304 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <asiodns/upstream_socket_pool.h>
+
+#include <asiolink/io_address.h>
+#include <asiolink/io_service.h>
+#include <util/buffer.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <asio.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::asiodns;
+using namespace bundy::asiolink;
+using bundy::util::OutputBuffer;
+
+namespace {
+
+const char* const TEST_HOST = "127.0.0.1";
+
+// A query (or rather, something with a QID and a bit of data; the pool
+// doesn't look further) with the given QID.
+void
+buildQuery(OutputBuffer& buffer, uint16_t qid, const std::string& data) {
+    buffer.clear();
+    buffer.writeUint16(qid);
+    buffer.writeData(data.c_str(), data.size());
+}
+
+class UpstreamSocketPoolTest : public ::testing::Test {
+protected:
+    UpstreamSocketPoolTest() :
+        udp_server_(service_.get_io_service(),
+                    asio::ip::udp::endpoint(
+                        asio::ip::address::from_string(TEST_HOST), 0)),
+        acceptor_(service_.get_io_service(),
+                  asio::ip::tcp::endpoint(
+                      asio::ip::address::from_string(TEST_HOST), 0)),
+        tcp_server_(service_.get_io_service()),
+        timer_(service_.get_io_service()),
+        accepted_(0), pending_(0)
+    {}
+
+    // The UDP server echoes every datagram back
+    void startUDPServer() {
+        udp_server_.async_receive_from(
+            asio::buffer(udp_buffer_, sizeof(udp_buffer_)), udp_sender_,
+            boost::bind(&UpstreamSocketPoolTest::udpReceived, this, _1, _2));
+    }
+    void udpReceived(const asio::error_code& ec, size_t length) {
+        if (!ec) {
+            udp_server_.send_to(asio::buffer(udp_buffer_, length),
+                                udp_sender_);
+            startUDPServer();
+        }
+    }
+
+    // The TCP server accepts a single connection, reads the given number
+    // of messages and then sends them back in the reverse order.
+    void startTCPServer(size_t count) {
+        tcp_expected_ = count;
+        acceptor_.async_accept(
+            tcp_server_,
+            boost::bind(&UpstreamSocketPoolTest::tcpAccepted, this, _1));
+    }
+    void tcpAccepted(const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        ++accepted_;
+        readTCPMessage();
+    }
+    void readTCPMessage() {
+        asio::async_read(tcp_server_, asio::buffer(tcp_length_, 2),
+                         boost::bind(&UpstreamSocketPoolTest::tcpLengthRead,
+                                     this, _1));
+    }
+    void tcpLengthRead(const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        tcp_messages_.push_back(
+            std::vector<uint8_t>(2 + (tcp_length_[0] << 8) + tcp_length_[1]));
+        std::copy(tcp_length_, tcp_length_ + 2,
+                  tcp_messages_.back().begin());
+        asio::async_read(tcp_server_,
+                         asio::buffer(&tcp_messages_.back()[2],
+                                      tcp_messages_.back().size() - 2),
+                         boost::bind(&UpstreamSocketPoolTest::tcpBodyRead,
+                                     this, _1));
+    }
+    void tcpBodyRead(const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        if (tcp_messages_.size() < tcp_expected_) {
+            readTCPMessage();
+            return;
+        }
+        for (std::vector<std::vector<uint8_t> >::reverse_iterator it =
+                 tcp_messages_.rbegin(); it != tcp_messages_.rend(); ++it) {
+            asio::write(tcp_server_, asio::buffer(*it));
+        }
+    }
+
+    // The handler of the queries; it records the result, and stops the
+    // service once all the expected ones have arrived.
+    void handler(bool ok, const uint8_t* data, size_t length) {
+        results_.push_back(ok);
+        responses_.push_back(ok ? std::string(data, data + length) : "");
+        if (--pending_ == 0) {
+            service_.stop();
+        }
+    }
+    UpstreamSocketPool::Handler getHandler() {
+        ++pending_;
+        return (boost::bind(&UpstreamSocketPoolTest::handler, this, _1, _2,
+                            _3));
+    }
+
+    // Run the service until all the handlers were called or the time
+    // runs out.
+    void run(int msec = 2000) {
+        timer_.expires_from_now(boost::posix_time::milliseconds(msec));
+        timer_.async_wait(boost::bind(&IOService::stop, &service_));
+        service_.run();
+        service_.get_io_service().reset();
+        timer_.cancel();
+    }
+
+    uint16_t udpPort() const {
+        return (udp_server_.local_endpoint().port());
+    }
+    uint16_t tcpPort() const {
+        return (acceptor_.local_endpoint().port());
+    }
+
+    IOService service_;
+    asio::ip::udp::socket udp_server_;
+    asio::ip::udp::endpoint udp_sender_;
+    uint8_t udp_buffer_[512];
+    asio::ip::tcp::acceptor acceptor_;
+    asio::ip::tcp::socket tcp_server_;
+    uint8_t tcp_length_[2];
+    std::vector<std::vector<uint8_t> > tcp_messages_;
+    size_t tcp_expected_;
+    asio::deadline_timer timer_;
+    size_t accepted_;
+    size_t pending_;
+    std::vector<bool> results_;
+    std::vector<std::string> responses_;
+};
+
+TEST_F(UpstreamSocketPoolTest, udp) {
+    UpstreamSocketPool pool(service_, 2);
+    startUDPServer();
+    OutputBuffer query1(0), query2(0);
+    buildQuery(query1, 0x1234, "first");
+    buildQuery(query2, 0x4321, "second");
+    EXPECT_NE(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query1,
+                           getHandler()));
+    EXPECT_NE(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query2,
+                           getHandler()));
+    EXPECT_EQ(2, pool.getQueryCount());
+    // The handlers are never called from within send()
+    EXPECT_TRUE(results_.empty());
+
+    run();
+    ASSERT_EQ(2, results_.size());
+    EXPECT_TRUE(results_[0]);
+    EXPECT_TRUE(results_[1]);
+    // The responses may come in any order
+    EXPECT_TRUE((responses_[0] == std::string("\x12\x34" "first") &&
+                 responses_[1] == std::string("\x43\x21" "second")) ||
+                (responses_[1] == std::string("\x12\x34" "first") &&
+                 responses_[0] == std::string("\x43\x21" "second")));
+    EXPECT_EQ(0, pool.getQueryCount());
+    EXPECT_EQ(0, pool.getConnectionCount());
+}
+
+TEST_F(UpstreamSocketPoolTest, udpSameQID) {
+    // Queries with the same QID to the same server go through different
+    // sockets, and there are only two of them.
+    UpstreamSocketPool pool(service_, 2);
+    OutputBuffer query(0);
+    buildQuery(query, 0x1234, "data");
+    EXPECT_NE(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query,
+                           getHandler()));
+    EXPECT_NE(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query,
+                           getHandler()));
+    EXPECT_EQ(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query,
+                           getHandler()));
+    // The same QID to another server is fine.
+    EXPECT_NE(0, pool.send(false, IOAddress(TEST_HOST), udpPort() + 1,
+                           query, getHandler()));
+    EXPECT_EQ(3, pool.getQueryCount());
+}
+
+TEST_F(UpstreamSocketPoolTest, udpRotate) {
+    // A socket used once is replaced by a new one, but it still receives
+    // the response to the query sent through it.
+    UpstreamSocketPool pool(service_, 1, 1);
+    startUDPServer();
+    OutputBuffer query(0);
+    buildQuery(query, 0x1234, "data");
+    EXPECT_NE(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query,
+                           getHandler()));
+    EXPECT_NE(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query,
+                           getHandler()));
+    run();
+    ASSERT_EQ(2, results_.size());
+    EXPECT_TRUE(results_[0]);
+    EXPECT_TRUE(results_[1]);
+    EXPECT_EQ(0, pool.getQueryCount());
+}
+
+TEST_F(UpstreamSocketPoolTest, cancel) {
+    UpstreamSocketPool pool(service_);
+    startUDPServer();
+    OutputBuffer query(0);
+    buildQuery(query, 0x1234, "data");
+    const UpstreamSocketPool::QueryID id =
+        pool.send(false, IOAddress(TEST_HOST), udpPort(), query,
+                  getHandler());
+    EXPECT_NE(0, id);
+    pool.cancel(id);
+    EXPECT_EQ(0, pool.getQueryCount());
+    // Cancelling it again, or an unknown query, is harmless.
+    pool.cancel(id);
+    pool.cancel(id + 100);
+
+    // The response is dropped.
+    run(200);
+    EXPECT_TRUE(results_.empty());
+}
+
+TEST_F(UpstreamSocketPoolTest, tcpPipelined) {
+    UpstreamSocketPool pool(service_);
+    startTCPServer(2);
+    OutputBuffer query1(0), query2(0);
+    buildQuery(query1, 0x1234, "first");
+    buildQuery(query2, 0x4321, "second");
+    EXPECT_NE(0, pool.send(true, IOAddress(TEST_HOST), tcpPort(), query1,
+                           getHandler()));
+    EXPECT_NE(0, pool.send(true, IOAddress(TEST_HOST), tcpPort(), query2,
+                           getHandler()));
+    // A QID can't be used twice on a connection.
+    EXPECT_EQ(0, pool.send(true, IOAddress(TEST_HOST), tcpPort(), query1,
+                           UpstreamSocketPool::Handler()));
+    EXPECT_EQ(1, pool.getConnectionCount());
+
+    // Both were sent over a single connection before any response, and
+    // the responses (in the reverse order) were matched to them.
+    run();
+    EXPECT_EQ(1, accepted_);
+    ASSERT_EQ(2, results_.size());
+    EXPECT_TRUE(results_[0]);
+    EXPECT_TRUE(results_[1]);
+    EXPECT_EQ(std::string("\x43\x21" "second"), responses_[0]);
+    EXPECT_EQ(std::string("\x12\x34" "first"), responses_[1]);
+    EXPECT_EQ(0, pool.getQueryCount());
+
+    // The connection is kept open for the next query.
+    EXPECT_EQ(1, pool.getConnectionCount());
+}
+
+TEST_F(UpstreamSocketPoolTest, tcpFail) {
+    UpstreamSocketPool pool(service_);
+    // Nobody is listening there
+    const uint16_t port = tcpPort();
+    acceptor_.close();
+    OutputBuffer query(0);
+    buildQuery(query, 0x1234, "data");
+    EXPECT_NE(0, pool.send(true, IOAddress(TEST_HOST), port, query,
+                           getHandler()));
+    run();
+    ASSERT_EQ(1, results_.size());
+    EXPECT_FALSE(results_[0]);
+    EXPECT_EQ(0, pool.getQueryCount());
+    EXPECT_EQ(0, pool.getConnectionCount());
+}
+
+TEST_F(UpstreamSocketPoolTest, badQuery) {
+    // Too short to have a QID
+    UpstreamSocketPool pool(service_);
+    OutputBuffer query(0);
+    query.writeUint8(0);
+    EXPECT_EQ(0, pool.send(false, IOAddress(TEST_HOST), udpPort(), query,
+                           UpstreamSocketPool::Handler()));
+}
+
+}
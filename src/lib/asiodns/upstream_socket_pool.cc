@@ -0,0 +1,579 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asio.hpp>
+
+#include <asiodns/upstream_socket_pool.h>
+#include <asiodns/logger.h>
+
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace bundy::asiolink;
+using bundy::util::OutputBuffer;
+
+namespace bundy {
+namespace asiodns {
+
+namespace {
+
+const int DBG_POOL = DBGLVL_TRACE_DETAIL;
+
+// The QID of a query or response in wire format
+uint16_t
+getQID(const uint8_t* data) {
+    return ((data[0] << 8) | data[1]);
+}
+
+// A UDP socket shared by queries to any server
+struct UDPChannel : boost::noncopyable {
+    typedef std::pair<uint16_t, asio::ip::udp::endpoint> Key;
+
+    UDPChannel(asio::io_service& io) :
+        socket(io), uses(0), retired(false), buffer(65536), spare(65536)
+    {}
+
+    asio::ip::udp::socket socket;
+    std::map<Key, UpstreamSocketPool::QueryID> waiting;
+    size_t uses;                // Number of queries sent from the socket
+    bool retired;               // Replaced, to be closed when idle
+    asio::ip::udp::endpoint sender;
+    std::vector<uint8_t> buffer;  // The receive in progress
+    std::vector<uint8_t> spare;   // The response being handled
+};
+typedef boost::shared_ptr<UDPChannel> UDPChannelPtr;
+
+// A TCP connection to a server
+struct TCPChannel : boost::noncopyable {
+    TCPChannel(asio::io_service& io, const asio::ip::tcp::endpoint& ep) :
+        socket(io), remote(ep), connected(false), closed(false),
+        writing(false)
+    {}
+
+    asio::ip::tcp::socket socket;
+    const asio::ip::tcp::endpoint remote;
+    std::map<uint16_t, UpstreamSocketPool::QueryID> waiting;
+    bool connected;
+    bool closed;
+    bool writing;               // A write is in progress
+    std::deque<boost::shared_ptr<std::vector<uint8_t> > > write_queue;
+    uint8_t length[2];
+    std::vector<uint8_t> body;
+};
+typedef boost::shared_ptr<TCPChannel> TCPChannelPtr;
+
+} // unnamed namespace
+
+// The implementation is shared with the handlers of the asynchronous
+// operations, so it lives until they complete even if the pool has been
+// destroyed; they do nothing once it's closed.
+struct UpstreamSocketPoolImpl :
+        public boost::enable_shared_from_this<UpstreamSocketPoolImpl>
+{
+    typedef UpstreamSocketPool::QueryID QueryID;
+    typedef UpstreamSocketPool::Handler Handler;
+
+    struct Query {
+        Handler handler;
+        UDPChannelPtr udp;
+        TCPChannelPtr tcp;
+        UDPChannel::Key key;    // For UDP; for TCP, only the QID is used
+    };
+
+    UpstreamSocketPoolImpl(asio::io_service& io, size_t udp_sockets,
+                           size_t udp_socket_uses) :
+        io_(io), udp_socket_uses_(std::max(udp_socket_uses, size_t(1))),
+        last_id_(0), closed_(false)
+    {
+        for (size_t i = 0; i < 2; ++i) {
+            udp_[i].resize(std::max(udp_sockets, size_t(1)));
+            next_udp_[i] = 0;
+        }
+    }
+
+    QueryID sendUDP(const asio::ip::udp::endpoint& remote,
+                    const OutputBuffer& query, const Handler& handler);
+    QueryID sendTCP(const asio::ip::tcp::endpoint& remote,
+                    const OutputBuffer& query, const Handler& handler);
+    void cancel(QueryID id);
+    void close();
+
+    // Take the query out of the table and return its handler
+    Handler complete(QueryID id);
+
+    UDPChannelPtr openUDP(bool v6);
+    void retireUDP(const UDPChannelPtr& channel);
+    void startUDPReceive(const UDPChannelPtr& channel);
+    void udpReceived(const UDPChannelPtr& channel, const asio::error_code& ec,
+                     size_t length);
+    void failUDPQuery(QueryID id);
+
+    void tcpConnected(const TCPChannelPtr& channel,
+                      const asio::error_code& ec);
+    void startTCPWrite(const TCPChannelPtr& channel);
+    void tcpWritten(const TCPChannelPtr& channel, const asio::error_code& ec);
+    void startTCPRead(const TCPChannelPtr& channel);
+    void tcpLengthRead(const TCPChannelPtr& channel,
+                       const asio::error_code& ec);
+    void tcpBodyRead(const TCPChannelPtr& channel, const asio::error_code& ec);
+    void failTCP(const TCPChannelPtr& channel, const asio::error_code& ec);
+
+    asio::io_service& io_;
+    const size_t udp_socket_uses_;
+    QueryID last_id_;
+    bool closed_;
+    std::map<QueryID, Query> queries_;
+    std::vector<UDPChannelPtr> udp_[2];     // IPv4 and IPv6 sockets
+    size_t next_udp_[2];
+    std::map<asio::ip::tcp::endpoint, TCPChannelPtr> tcp_;
+};
+
+UpstreamSocketPoolImpl::Handler
+UpstreamSocketPoolImpl::complete(QueryID id) {
+    Handler handler;
+    const std::map<QueryID, Query>::iterator it = queries_.find(id);
+    if (it != queries_.end()) {
+        handler.swap(it->second.handler);
+        queries_.erase(it);
+    }
+    return (handler);
+}
+
+UDPChannelPtr
+UpstreamSocketPoolImpl::openUDP(bool v6) {
+    UDPChannelPtr channel(new UDPChannel(io_));
+    // Bound to port 0, the system chooses a (random) port
+    const asio::ip::udp::endpoint local(v6 ? asio::ip::udp::v6() :
+                                        asio::ip::udp::v4(), 0);
+    channel->socket.open(local.protocol());
+    if (v6) {
+        channel->socket.set_option(asio::ip::v6_only(true));
+    }
+    channel->socket.bind(local);
+    asio::socket_base::non_blocking_io command(true);
+    channel->socket.io_control(command);
+    startUDPReceive(channel);
+    return (channel);
+}
+
+void
+UpstreamSocketPoolImpl::retireUDP(const UDPChannelPtr& channel) {
+    channel->retired = true;
+    if (channel->waiting.empty()) {
+        asio::error_code ec;
+        channel->socket.close(ec);
+    }
+}
+
+void
+UpstreamSocketPoolImpl::startUDPReceive(const UDPChannelPtr& channel) {
+    channel->socket.async_receive_from(
+        asio::buffer(channel->buffer),
+        channel->sender,
+        boost::bind(&UpstreamSocketPoolImpl::udpReceived, shared_from_this(),
+                    channel, _1, _2));
+}
+
+UpstreamSocketPoolImpl::QueryID
+UpstreamSocketPoolImpl::sendUDP(const asio::ip::udp::endpoint& remote,
+                                const OutputBuffer& query,
+                                const Handler& handler)
+{
+    const int family = remote.address().is_v6() ? 1 : 0;
+    std::vector<UDPChannelPtr>& sockets(udp_[family]);
+    const UDPChannel::Key key(getQID(static_cast<const uint8_t*>(
+                                         query.getData())), remote);
+
+    // Use the sockets in turn, skipping the ones which already have a query
+    // with the same QID to the same server.
+    UDPChannelPtr channel;
+    for (size_t i = 0; i < sockets.size() && !channel; ++i) {
+        const size_t pos = (next_udp_[family] + i) % sockets.size();
+        if (!sockets[pos] || sockets[pos]->uses >= udp_socket_uses_) {
+            if (sockets[pos]) {
+                retireUDP(sockets[pos]);
+                sockets[pos].reset();
+            }
+            try {
+                sockets[pos] = openUDP(family == 1);
+            } catch (const asio::system_error& ex) {
+                LOG_DEBUG(logger, DBG_POOL, ASIODNS_POOL_OPEN_FAIL).
+                    arg("UDP").arg(ex.what());
+                return (0);
+            }
+        }
+        if (sockets[pos]->waiting.find(key) == sockets[pos]->waiting.end()) {
+            channel = sockets[pos];
+            next_udp_[family] = (pos + 1) % sockets.size();
+        }
+    }
+    if (!channel) {
+        return (0);
+    }
+
+    const QueryID id = ++last_id_;
+    Query& entry(queries_[id]);
+    entry.handler = handler;
+    entry.udp = channel;
+    entry.key = key;
+    channel->waiting[key] = id;
+    ++channel->uses;
+
+    asio::error_code ec;
+    channel->socket.send_to(asio::buffer(query.getData(), query.getLength()),
+                            remote, 0, ec);
+    if (ec) {
+        // The handler mustn't be called from within send(), so it's
+        // deferred.
+        LOG_DEBUG(logger, DBG_POOL, ASIODNS_POOL_SEND_FAIL).
+            arg(remote.address().to_string()).arg(remote.port()).
+            arg(ec.message());
+        io_.post(boost::bind(&UpstreamSocketPoolImpl::failUDPQuery,
+                             shared_from_this(), id));
+    }
+    return (id);
+}
+
+void
+UpstreamSocketPoolImpl::failUDPQuery(QueryID id) {
+    if (closed_) {
+        return;
+    }
+    const std::map<QueryID, Query>::iterator it = queries_.find(id);
+    if (it == queries_.end()) {
+        return;
+    }
+    const UDPChannelPtr channel = it->second.udp;
+    channel->waiting.erase(it->second.key);
+    const Handler handler = complete(id);
+    if (channel->retired && channel->waiting.empty()) {
+        retireUDP(channel);
+    }
+    handler(false, NULL, 0);
+}
+
+void
+UpstreamSocketPoolImpl::udpReceived(const UDPChannelPtr& channel,
+                                    const asio::error_code& ec, size_t length)
+{
+    if (closed_ || ec == asio::error::operation_aborted ||
+        !channel->socket.is_open()) {
+        return;
+    }
+
+    Handler handler;
+    if (!ec && length >= 2) {
+        const UDPChannel::Key key(getQID(&channel->buffer[0]), channel->sender);
+        const std::map<UDPChannel::Key, QueryID>::iterator it =
+            channel->waiting.find(key);
+        if (it != channel->waiting.end()) {
+            handler = complete(it->second);
+            channel->waiting.erase(it);
+            // The next receive may write to the buffer as soon as it's
+            // started, so the response is kept in the other one.
+            channel->buffer.swap(channel->spare);
+        }
+        // Anything else is a late response to a cancelled query, or
+        // garbage; it's dropped.
+    }
+
+    // Keep receiving, unless the socket has been replaced and it's no longer
+    // needed.
+    if (channel->retired && channel->waiting.empty()) {
+        retireUDP(channel);
+    } else {
+        startUDPReceive(channel);
+    }
+    if (handler) {
+        handler(true, &channel->spare[0], length);
+    }
+}
+
+UpstreamSocketPoolImpl::QueryID
+UpstreamSocketPoolImpl::sendTCP(const asio::ip::tcp::endpoint& remote,
+                                const OutputBuffer& query,
+                                const Handler& handler)
+{
+    const uint16_t qid = getQID(static_cast<const uint8_t*>(query.getData()));
+    TCPChannelPtr& channel(tcp_[remote]);
+    if (!channel) {
+        channel.reset(new TCPChannel(io_, remote));
+        channel->socket.async_connect(
+            remote, boost::bind(&UpstreamSocketPoolImpl::tcpConnected,
+                                shared_from_this(), channel, _1));
+    } else if (channel->waiting.find(qid) != channel->waiting.end()) {
+        return (0);
+    }
+
+    const QueryID id = ++last_id_;
+    Query& entry(queries_[id]);
+    entry.handler = handler;
+    entry.tcp = channel;
+    entry.key.first = qid;
+    channel->waiting[qid] = id;
+
+    // The message is prefixed by its length
+    boost::shared_ptr<std::vector<uint8_t> > data(
+        new std::vector<uint8_t>(2 + query.getLength()));
+    (*data)[0] = query.getLength() >> 8;
+    (*data)[1] = query.getLength() & 0xff;
+    std::copy(static_cast<const uint8_t*>(query.getData()),
+              static_cast<const uint8_t*>(query.getData()) + query.getLength(),
+              data->begin() + 2);
+    channel->write_queue.push_back(data);
+    if (channel->connected && !channel->writing) {
+        startTCPWrite(channel);
+    }
+    return (id);
+}
+
+void
+UpstreamSocketPoolImpl::tcpConnected(const TCPChannelPtr& channel,
+                                     const asio::error_code& ec)
+{
+    if (closed_ || channel->closed) {
+        return;
+    }
+    if (ec) {
+        failTCP(channel, ec);
+        return;
+    }
+    channel->connected = true;
+    if (!channel->write_queue.empty()) {
+        startTCPWrite(channel);
+    }
+    startTCPRead(channel);
+}
+
+void
+UpstreamSocketPoolImpl::startTCPWrite(const TCPChannelPtr& channel) {
+    channel->writing = true;
+    asio::async_write(channel->socket,
+                      asio::buffer(*channel->write_queue.front()),
+                      boost::bind(&UpstreamSocketPoolImpl::tcpWritten,
+                                  shared_from_this(), channel, _1));
+}
+
+void
+UpstreamSocketPoolImpl::tcpWritten(const TCPChannelPtr& channel,
+                                   const asio::error_code& ec)
+{
+    if (closed_ || channel->closed) {
+        return;
+    }
+    channel->writing = false;
+    if (ec) {
+        failTCP(channel, ec);
+        return;
+    }
+    channel->write_queue.pop_front();
+    if (!channel->write_queue.empty()) {
+        startTCPWrite(channel);
+    }
+}
+
+void
+UpstreamSocketPoolImpl::startTCPRead(const TCPChannelPtr& channel) {
+    asio::async_read(channel->socket,
+                     asio::buffer(channel->length, sizeof(channel->length)),
+                     boost::bind(&UpstreamSocketPoolImpl::tcpLengthRead,
+                                 shared_from_this(), channel, _1));
+}
+
+void
+UpstreamSocketPoolImpl::tcpLengthRead(const TCPChannelPtr& channel,
+                                      const asio::error_code& ec)
+{
+    if (closed_ || channel->closed) {
+        return;
+    }
+    if (ec) {
+        failTCP(channel, ec);
+        return;
+    }
+    channel->body.resize((channel->length[0] << 8) | channel->length[1]);
+    asio::async_read(channel->socket, asio::buffer(channel->body),
+                     boost::bind(&UpstreamSocketPoolImpl::tcpBodyRead,
+                                 shared_from_this(), channel, _1));
+}
+
+void
+UpstreamSocketPoolImpl::tcpBodyRead(const TCPChannelPtr& channel,
+                                    const asio::error_code& ec)
+{
+    if (closed_ || channel->closed) {
+        return;
+    }
+    if (ec) {
+        failTCP(channel, ec);
+        return;
+    }
+
+    Handler handler;
+    if (channel->body.size() >= 2) {
+        const std::map<uint16_t, QueryID>::iterator it =
+            channel->waiting.find(getQID(&channel->body[0]));
+        if (it != channel->waiting.end()) {
+            handler = complete(it->second);
+            channel->waiting.erase(it);
+        }
+    }
+
+    // The response is moved out of the channel, as the handler may send
+    // more queries through it.
+    std::vector<uint8_t> response;
+    response.swap(channel->body);
+    startTCPRead(channel);
+    if (handler) {
+        handler(true, &response[0], response.size());
+    }
+}
+
+void
+UpstreamSocketPoolImpl::failTCP(const TCPChannelPtr& channel,
+                                const asio::error_code& ec)
+{
+    // The connection is dropped, and the queries still waiting for a
+    // response fail.  It's normal for the server to close an idle one.
+    if (!channel->waiting.empty() || ec != asio::error::eof) {
+        LOG_DEBUG(logger, DBG_POOL, ASIODNS_POOL_TCP_FAIL).
+            arg(channel->remote.address().to_string()).
+            arg(channel->remote.port()).arg(ec.message()).
+            arg(channel->waiting.size());
+    }
+    channel->closed = true;
+    asio::error_code close_ec;
+    channel->socket.close(close_ec);
+    const std::map<asio::ip::tcp::endpoint, TCPChannelPtr>::iterator it =
+        tcp_.find(channel->remote);
+    if (it != tcp_.end() && it->second == channel) {
+        tcp_.erase(it);
+    }
+
+    std::vector<Handler> handlers;
+    for (std::map<uint16_t, QueryID>::const_iterator it =
+             channel->waiting.begin(); it != channel->waiting.end(); ++it) {
+        handlers.push_back(complete(it->second));
+    }
+    channel->waiting.clear();
+    channel->write_queue.clear();
+    for (std::vector<Handler>::const_iterator it = handlers.begin();
+         it != handlers.end(); ++it) {
+        (*it)(false, NULL, 0);
+    }
+}
+
+void
+UpstreamSocketPoolImpl::cancel(QueryID id) {
+    const std::map<QueryID, Query>::iterator it = queries_.find(id);
+    if (it == queries_.end()) {
+        return;
+    }
+    const Query& entry(it->second);
+    if (entry.udp) {
+        entry.udp->waiting.erase(entry.key);
+        if (entry.udp->retired && entry.udp->waiting.empty()) {
+            retireUDP(entry.udp);
+        }
+    } else {
+        // The query may have been sent already, so the connection is kept,
+        // and a late response is dropped.
+        entry.tcp->waiting.erase(entry.key.first);
+    }
+    queries_.erase(it);
+}
+
+void
+UpstreamSocketPoolImpl::close() {
+    closed_ = true;
+    asio::error_code ec;
+    for (size_t i = 0; i < 2; ++i) {
+        for (std::vector<UDPChannelPtr>::iterator it = udp_[i].begin();
+             it != udp_[i].end(); ++it) {
+            if (*it) {
+                (*it)->socket.close(ec);
+            }
+        }
+        udp_[i].clear();
+    }
+    for (std::map<QueryID, Query>::iterator it = queries_.begin();
+         it != queries_.end(); ++it) {
+        // Retired UDP sockets and the TCP connections
+        if (it->second.udp) {
+            it->second.udp->socket.close(ec);
+        }
+    }
+    for (std::map<asio::ip::tcp::endpoint, TCPChannelPtr>::iterator it =
+             tcp_.begin(); it != tcp_.end(); ++it) {
+        it->second->closed = true;
+        it->second->socket.close(ec);
+    }
+    tcp_.clear();
+    queries_.clear();
+}
+
+UpstreamSocketPool::UpstreamSocketPool(IOService& service,
+                                       size_t udp_sockets,
+                                       size_t udp_socket_uses) :
+    impl_(new UpstreamSocketPoolImpl(service.get_io_service(), udp_sockets,
+                                     udp_socket_uses))
+{}
+
+UpstreamSocketPool::~UpstreamSocketPool() {
+    impl_->close();
+}
+
+UpstreamSocketPool::QueryID
+UpstreamSocketPool::send(bool tcp, const IOAddress& address, uint16_t port,
+                         const OutputBuffer& query, const Handler& handler)
+{
+    if (query.getLength() < 2 || query.getLength() > 0xffff) {
+        return (0);
+    }
+    const asio::ip::address remote =
+        asio::ip::address::from_string(address.toText());
+    if (tcp) {
+        return (impl_->sendTCP(asio::ip::tcp::endpoint(remote, port), query,
+                               handler));
+    } else {
+        return (impl_->sendUDP(asio::ip::udp::endpoint(remote, port), query,
+                               handler));
+    }
+}
+
+void
+UpstreamSocketPool::cancel(QueryID id) {
+    impl_->cancel(id);
+}
+
+size_t
+UpstreamSocketPool::getQueryCount() const {
+    return (impl_->queries_.size());
+}
+
+size_t
+UpstreamSocketPool::getConnectionCount() const {
+    return (impl_->tcp_.size());
+}
+
+} // namespace asiodns
+} // namespace bundy
@@ -0,0 +1,141 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef UPSTREAM_SOCKET_POOL_H
+#define UPSTREAM_SOCKET_POOL_H 1
+
+#include <asiolink/io_address.h>
+#include <asiolink/io_service.h>
+#include <util/buffer.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace asiodns {
+
+// Forward declaration
+struct UpstreamSocketPoolImpl;
+
+/// \brief Pool of sockets for upstream queries
+///
+/// By default, \c IOFetch opens a socket for each query and closes it when
+/// the query completes.  This class keeps sockets open so they can be
+/// shared by many queries, which saves file descriptors and system calls,
+/// and for TCP the connection setup for each query.
+///
+/// - For UDP, a small number of sockets per address family is used, each
+///   bound to a port chosen by the system.  Queries to any server are sent
+///   from one of them (in turn), and the responses are matched to the
+///   queries by the QID and the address of the server.  To keep the source
+///   port unpredictable, a socket is replaced with a new one after it has
+///   been used for a number of queries (the old one is closed once the
+///   responses to its queries have arrived or the queries were cancelled).
+/// - For TCP, a connection to each server is kept open and used for all the
+///   queries to that server.  Queries are pipelined: they are sent as they
+///   come without waiting for the responses to the previous ones, and the
+///   responses (which may come in any order) are matched by the QID.  The
+///   connection is dropped when the server closes it or on an error.
+///
+/// A query whose QID is already in use for the same server on all the
+/// sockets (which is very unlikely) can't be sent through the pool; \c send()
+/// returns 0 then, and the caller should use a socket of its own.
+///
+/// The pool doesn't handle timeouts; the caller is expected to \c cancel()
+/// a query it's no longer interested in.
+///
+/// The pool is not thread safe: it must be used only in the thread running
+/// the \c IOService.  The sockets are closed when the pool is destroyed;
+/// the handlers of the outstanding queries are not called then.
+class UpstreamSocketPool : boost::noncopyable {
+public:
+    /// \brief Handler of a query response
+    ///
+    /// Called with true and the response (in wire format, without the TCP
+    /// length prefix) when it arrives, or with false (and a NULL pointer)
+    /// when the query can't be completed because of an I/O error.
+    typedef boost::function<void(bool, const uint8_t*, size_t)> Handler;
+
+    /// \brief Identifier of a query sent through the pool
+    typedef uint64_t QueryID;
+
+    /// \brief The default number of UDP sockets per address family
+    static const size_t DEFAULT_UDP_SOCKETS = 4;
+
+    /// \brief The default number of queries a UDP socket is used for
+    static const size_t DEFAULT_UDP_SOCKET_USES = 100;
+
+    /// \brief Constructor
+    ///
+    /// \param service The I/O service the sockets are used with.
+    /// \param udp_sockets The number of UDP sockets per address family (at
+    ///        least 1 is used).
+    /// \param udp_socket_uses The number of queries after which a UDP socket
+    ///        is replaced (at least 1 is used).
+    explicit UpstreamSocketPool(
+        bundy::asiolink::IOService& service,
+        size_t udp_sockets = DEFAULT_UDP_SOCKETS,
+        size_t udp_socket_uses = DEFAULT_UDP_SOCKET_USES);
+
+    /// \brief Destructor
+    ///
+    /// Closes all the sockets.
+    ~UpstreamSocketPool();
+
+    /// \brief Send a query
+    ///
+    /// \param tcp Whether to send the query over TCP (otherwise over UDP).
+    /// \param address The address of the server.
+    /// \param port The port of the server.
+    /// \param query The query in wire format (without the TCP length prefix).
+    ///        The QID in its first two bytes is used to match the response.
+    ///        The data is copied.
+    /// \param handler Called when the response arrives or the query fails.
+    ///        It's never called from within \c send().
+    /// \return An identifier of the query for \c cancel(), or 0 if the query
+    ///         can't be sent through the pool.
+    QueryID send(bool tcp, const bundy::asiolink::IOAddress& address,
+                 uint16_t port, const bundy::util::OutputBuffer& query,
+                 const Handler& handler);
+
+    /// \brief Cancel a query
+    ///
+    /// The handler of the query won't be called, and a response to the
+    /// query that arrives later is dropped.  Nothing happens if the query
+    /// has already completed.
+    ///
+    /// \param id The identifier returned by \c send().
+    void cancel(QueryID id);
+
+    /// \brief Return the number of outstanding queries
+    size_t getQueryCount() const;
+
+    /// \brief Return the number of open TCP connections
+    size_t getConnectionCount() const;
+
+private:
+    boost::shared_ptr<UpstreamSocketPoolImpl> impl_;
+};
+
+} // namespace asiodns
+} // namespace bundy
+
+#endif // UPSTREAM_SOCKET_POOL_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,328 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include "cached_rrset.h"
+
+#include <datasrc/memory/rdata_serialization.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/labelsequence.h>
+#include <dns/rdata.h>
+
+#include <boost/bind.hpp>
+
+#include <cassert>
+#include <vector>
+
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using bundy::datasrc::memory::RdataNameAttributes;
+using bundy::datasrc::memory::RdataReader;
+using bundy::datasrc::memory::NAMEATTR_COMPRESSIBLE;
+
+namespace bundy {
+namespace cache {
+
+const Name&
+CachedRRset::getName() const {
+    if (name_ == NULL) {
+        size_t data_len;
+        const uint8_t* data = entry_->getOwnerLabels().getData(&data_len);
+        util::InputBuffer buffer(data, data_len);
+        name_ = new Name(buffer);
+    }
+    return (*name_);
+}
+
+void
+CachedRRset::setTTL(const RRTTL&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+std::string
+CachedRRset::toText() const {
+    std::string ret;
+    RRsetPtr tmp_rrset;
+    for (RdataIteratorPtr rit = getRdataIterator(); !rit->isLast();
+         rit->next())
+    {
+        if (!tmp_rrset) {
+            tmp_rrset = RRsetPtr(new RRset(getName(), getClass(), getType(),
+                                           getTTL()));
+        }
+        tmp_rrset->addRdata(rit->getCurrent());
+    }
+    if (tmp_rrset) {
+        ret = tmp_rrset->toText();
+    }
+
+    tmp_rrset = getRRsig();
+    if (tmp_rrset) {
+        ret += tmp_rrset->toText();
+    }
+
+    return (ret);
+}
+
+namespace {
+void
+sizeupName(const LabelSequence& name_labels, RdataNameAttributes,
+           size_t* length)
+{
+    *length += name_labels.getDataLength();
+}
+
+void
+sizeupData(const void*, size_t data_len, size_t* length) {
+    *length += data_len;
+}
+
+void
+renderName(const LabelSequence& name_labels, RdataNameAttributes attr,
+           AbstractMessageRenderer* renderer)
+{
+    renderer->writeName(name_labels, (attr & NAMEATTR_COMPRESSIBLE) != 0);
+}
+
+void
+renderData(const void* data, size_t data_len,
+           AbstractMessageRenderer* renderer)
+{
+    renderer->writeData(data, data_len);
+}
+
+// Common code logic for rendering the main or RRSIG RRs.  The TTL is
+// the adjusted one, so it's written as a number rather than copied from
+// the stored data as TreeNodeRRset does.
+size_t
+writeRRs(AbstractMessageRenderer& renderer, size_t rr_count,
+         const LabelSequence& name_labels, const RRType& rrtype,
+         const RRClass& rrclass, uint32_t ttl,
+         RdataReader& reader, bool (RdataReader::* rdata_iterate_fn)())
+{
+    for (size_t i = 0; i < rr_count; ++i) {
+        const size_t pos0 = renderer.getLength();
+
+        // Name, type, class, TTL
+        renderer.writeName(name_labels, true);
+        rrtype.toWire(renderer);
+        rrclass.toWire(renderer);
+        renderer.writeUint32(ttl);
+
+        // RDLEN and RDATA
+        const size_t pos = renderer.getLength();
+        renderer.skip(sizeof(uint16_t)); // leave the space for RDLENGTH
+        const bool rendered = (reader.*rdata_iterate_fn)();
+        assert(rendered == true);
+        renderer.writeUint16At(renderer.getLength() - pos - sizeof(uint16_t),
+                               pos);
+
+        // Check if truncation would happen
+        if (renderer.getLength() > renderer.getLengthLimit()) {
+            renderer.trim(renderer.getLength() - pos0);
+            renderer.setTruncated();
+            return (i);
+        }
+    }
+    return (rr_count);
+}
+}
+
+uint16_t
+CachedRRset::getLength() const {
+    size_t rlength = 0;
+    RdataReader reader(getClass(), getType(), entry_->getDataBuf(),
+                       entry_->getRdataCount(), entry_->getSigRdataCount(),
+                       boost::bind(sizeupName, _1, _2, &rlength),
+                       boost::bind(sizeupData, _1, _2, &rlength));
+    reader.iterate();
+    reader.iterateAllSigs();
+
+    // Each RR has the owner name, TYPE, CLASS, TTL and RDLENGTH fields
+    // in addition to the RDATA.
+    const size_t rr_count = entry_->getRdataCount() +
+        entry_->getSigRdataCount();
+    const size_t length = rlength + rr_count *
+        (entry_->getOwnerLabels().getDataLength() + 2 + 2 + 4 + 2);
+    assert(length < 65536);
+    return (length);
+}
+
+unsigned int
+CachedRRset::toWire(AbstractMessageRenderer& renderer) const {
+    RdataReader reader(getClass(), getType(), entry_->getDataBuf(),
+                       entry_->getRdataCount(), entry_->getSigRdataCount(),
+                       boost::bind(renderName, _1, _2, &renderer),
+                       boost::bind(renderData, _1, _2, &renderer));
+    const LabelSequence name_labels = entry_->getOwnerLabels();
+    const uint32_t ttl = ttl_.getValue();
+
+    // Render the main (non RRSIG) RRs.  There's none for an RRSIG RRset.
+    const size_t rendered_rdata_count =
+        writeRRs(renderer, entry_->getRdataCount(), name_labels, getType(),
+                 getClass(), ttl, reader, &RdataReader::iterateRdata);
+    if (renderer.isTruncated()) {
+        return (rendered_rdata_count);
+    }
+    const bool rendered = reader.iterateRdata();
+    assert(rendered == false); // we should've reached the end
+
+    // Render the RRSIGs
+    const size_t rendered_rrsig_count =
+        writeRRs(renderer, entry_->getSigRdataCount(), name_labels,
+                 RRType::RRSIG(), getClass(), ttl, reader,
+                 &RdataReader::iterateSingleSig);
+
+    return (rendered_rdata_count + rendered_rrsig_count);
+}
+
+unsigned int
+CachedRRset::toWire(bundy::util::OutputBuffer&) const {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::addRdata(rdata::ConstRdataPtr) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::addRdata(const rdata::Rdata&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::addRdata(const std::string&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+namespace {
+// A simple RdataIterator over a vector of Rdata objects built on
+// construction, like the one for TreeNodeRRset.
+class CachedRdataIterator : public RdataIterator {
+public:
+    CachedRdataIterator(const std::vector<ConstRdataPtr>& rdata_list) :
+        rdata_list_(rdata_list), rdata_it_(rdata_list_.begin())
+    {}
+    virtual void first() { rdata_it_ = rdata_list_.begin(); }
+    virtual void next() {
+        ++rdata_it_;
+    }
+    virtual const rdata::Rdata& getCurrent() const {
+        return (**rdata_it_);
+    }
+    virtual bool isLast() const { return (rdata_it_ == rdata_list_.end()); }
+private:
+    const std::vector<ConstRdataPtr> rdata_list_;
+    std::vector<ConstRdataPtr>::const_iterator rdata_it_;
+};
+
+void
+renderNameToBuffer(const LabelSequence& name_labels, RdataNameAttributes,
+                   util::OutputBuffer* buffer)
+{
+    size_t data_len;
+    const uint8_t* data = name_labels.getData(&data_len);
+    buffer->writeData(data, data_len);
+}
+
+void
+renderDataToBuffer(const void* data, size_t data_len,
+                   util::OutputBuffer* buffer)
+{
+    buffer->writeData(data, data_len);
+}
+}
+
+RdataIteratorPtr
+CachedRRset::getRdataIteratorInternal(bool is_rrsig) const {
+    util::OutputBuffer buffer(0);
+    RdataReader reader(getClass(), getType(), entry_->getDataBuf(),
+                       entry_->getRdataCount(), entry_->getSigRdataCount(),
+                       boost::bind(renderNameToBuffer, _1, _2, &buffer),
+                       boost::bind(renderDataToBuffer, _1, _2, &buffer));
+
+    std::vector<ConstRdataPtr> rdata_list;
+    const size_t count = is_rrsig ? entry_->getSigRdataCount() :
+        entry_->getRdataCount();
+    for (size_t i = 0; i < count; ++i) {
+        buffer.clear();
+        const bool rendered = is_rrsig ? reader.iterateSingleSig() :
+            reader.iterateRdata();
+        assert(rendered == true);
+        util::InputBuffer ib(buffer.getData(), buffer.getLength());
+        rdata_list.push_back(
+            createRdata(is_rrsig ? RRType::RRSIG() : getType(), getClass(),
+                        ib, ib.getLength()));
+    }
+    return (RdataIteratorPtr(new CachedRdataIterator(rdata_list)));
+}
+
+RdataIteratorPtr
+CachedRRset::getRdataIterator() const {
+    return (getRdataIteratorInternal(isRRSIG()));
+}
+
+RRsetPtr
+CachedRRset::getRRsig() const {
+    if (getRRsigDataCount() == 0) {
+        return (RRsetPtr());
+    }
+
+    RRsetPtr tmp_rrset(new RRset(getName(), getClass(), RRType::RRSIG(),
+                                 getTTL()));
+    for (RdataIteratorPtr rit = getRdataIteratorInternal(true);
+         !rit->isLast();
+         rit->next())
+    {
+        tmp_rrset->addRdata(rit->getCurrent());
+    }
+    return (tmp_rrset);
+}
+
+void
+CachedRRset::addRRsig(const rdata::ConstRdataPtr&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::addRRsig(const rdata::RdataPtr&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::addRRsig(const AbstractRRset&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::addRRsig(const ConstRRsetPtr&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::addRRsig(const RRsetPtr&) {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+void
+CachedRRset::removeRRsig() {
+    bundy_throw(Unexpected, "unexpected method called on CachedRRset");
+}
+
+} // namespace cache
+} // namespace bundy
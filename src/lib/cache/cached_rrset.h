@@ -0,0 +1,171 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef CACHED_RRSET_H
+#define CACHED_RRSET_H
+
+#include <cache/rrset_entry.h>
+
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+#include <util/buffer.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <ctime>
+#include <string>
+
+namespace bundy {
+namespace cache {
+
+/// \brief An RRset backed by a cached \c RRsetEntry.
+///
+/// This is a special derived class of \c dns::AbstractRRset, which provides
+/// an RRset view of the data stored in an \c RRsetEntry without building
+/// the \c Rdata objects.  It's intended to be added to a response message
+/// for a cache hit: its \c toWire() renders the stored data directly into
+/// the \c MessageRenderer, with the TTL adjusted to the remaining lifetime
+/// of the entry at the time the object is constructed.  Any RRSIGs stored
+/// with the entry are rendered, too.
+///
+/// This is similar to \c datasrc::memory::TreeNodeRRset, and has the same
+/// limitations: the object is read-only, so methods that would modify it
+/// (such as \c setTTL() or \c addRdata()) throw \c bundy::Unexpected.
+/// Methods that require \c Rdata objects (e.g., \c getRdataIterator()) are
+/// supported, but they are not efficient as they build the objects on
+/// each call.
+///
+/// The object holds a reference to the entry, so it remains valid even
+/// if the entry is removed from the cache.
+class CachedRRset : boost::noncopyable, public dns::AbstractRRset {
+public:
+    /// \brief Constructor.
+    ///
+    /// \throw None
+    ///
+    /// \param entry The cached RRset.  Must not be null.
+    /// \param now The current time, used to determine the TTL.
+    CachedRRset(const RRsetEntryPtr& entry, time_t now) :
+        entry_(entry), ttl_(entry->getTTL(now)), name_(NULL)
+    {}
+
+    /// \brief Constructor with an explicit TTL.
+    ///
+    /// This is for the case where the TTL isn't derived from the entry,
+    /// such as when serving expired (stale) data.
+    ///
+    /// \throw None
+    ///
+    /// \param entry The cached RRset.  Must not be null.
+    /// \param ttl The TTL of the RRset (and its RRSIGs).
+    CachedRRset(const RRsetEntryPtr& entry, const dns::RRTTL& ttl) :
+        entry_(entry), ttl_(ttl), name_(NULL)
+    {}
+
+    virtual ~CachedRRset() {
+        delete name_;
+    }
+
+    virtual unsigned int getRdataCount() const {
+        // An RRSIG RRset is stored as the RRSIGs of an empty set.
+        return (isRRSIG() ? entry_->getSigRdataCount() :
+                entry_->getRdataCount());
+    }
+
+    virtual uint16_t getLength() const;
+
+    virtual const dns::Name& getName() const;
+
+    virtual const dns::RRClass& getClass() const {
+        return (entry_->getClass());
+    }
+
+    virtual const dns::RRType& getType() const {
+        return (entry_->getType());
+    }
+
+    virtual const dns::RRTTL& getTTL() const {
+        return (ttl_);
+    }
+
+    /// \brief Specialized version of \c setTTL() for \c CachedRRset.
+    ///
+    /// \throw bundy::Unexpected always.
+    virtual void setTTL(const dns::RRTTL& ttl);
+
+    virtual std::string toText() const;
+
+    /// \brief Render the RRset directly from the cached data.
+    virtual unsigned int toWire(dns::AbstractMessageRenderer& renderer) const;
+
+    /// \brief Specialized version of \c toWire(buffer) for \c CachedRRset.
+    ///
+    /// \throw bundy::Unexpected always.
+    virtual unsigned int toWire(util::OutputBuffer& buffer) const;
+
+    /// \brief Specialized versions of \c addRdata() for \c CachedRRset.
+    ///
+    /// \throw bundy::Unexpected always.
+    //@{
+    virtual void addRdata(dns::rdata::ConstRdataPtr rdata);
+    virtual void addRdata(const dns::rdata::Rdata& rdata);
+    virtual void addRdata(const std::string& rdata_str);
+    //@}
+
+    virtual dns::RdataIteratorPtr getRdataIterator() const;
+
+    virtual dns::RRsetPtr getRRsig() const;
+
+    virtual unsigned int getRRsigDataCount() const {
+        return (isRRSIG() ? 0 : entry_->getSigRdataCount());
+    }
+
+    /// \brief Specialized versions of \c addRRsig() and \c removeRRsig()
+    /// for \c CachedRRset.
+    ///
+    /// \throw bundy::Unexpected always.
+    //@{
+    virtual void addRRsig(const dns::rdata::ConstRdataPtr& rdata);
+    virtual void addRRsig(const dns::rdata::RdataPtr& rdata);
+    virtual void addRRsig(const dns::AbstractRRset& sigs);
+    virtual void addRRsig(const dns::ConstRRsetPtr& sigs);
+    virtual void addRRsig(const dns::RRsetPtr& sigs);
+    virtual void removeRRsig();
+    //@}
+
+private:
+    bool isRRSIG() const {
+        return (entry_->getType() == dns::RRType::RRSIG());
+    }
+
+    // Build Rdata objects for the main RDATA or the RRSIGs.
+    dns::RdataIteratorPtr getRdataIteratorInternal(bool is_rrsig) const;
+
+    const RRsetEntryPtr entry_;
+    const dns::RRTTL ttl_;
+    mutable dns::Name* name_;
+};
+
+} // namespace cache
+} // namespace bundy
+
+#endif // CACHED_RRSET_H
+
+// Local Variables:
+// mode: c++
+// End:
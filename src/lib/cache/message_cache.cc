@@ -15,9 +15,6 @@
 
 #include <config.h>
 
-#include <nsas/nsas_entry_compare.h>
-#include <nsas/hash_table.h>
-#include <nsas/hash_deleter.h>
 #include "message_cache.h"
 #include "message_utility.h"
 #include "cache_entry_key.h"
@@ -26,7 +23,6 @@
 namespace bundy {
 namespace cache {
 
-using namespace bundy::nsas;
 using namespace bundy::dns;
 using namespace std;
 using namespace MessageUtility;
@@ -37,17 +33,13 @@ MessageCache::MessageCache(const RRsetCachePtr& rrset_cache,
     message_class_(message_class),
     rrset_cache_(rrset_cache),
     negative_soa_cache_(negative_soa_cache),
-    message_table_(new NsasEntryCompare<MessageEntry>, cache_size),
-    message_lru_((3 * cache_size),
-                  new HashDeleter<MessageEntry>(message_table_))
+    message_table_(3 * cache_size)
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_MESSAGES_INIT).arg(cache_size).
         arg(RRClass(message_class));
 }
 
 MessageCache::~MessageCache() {
-    // Destroy all the message entries in the cache.
-    message_lru_.clear();
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_MESSAGES_DEINIT);
 }
 
@@ -57,21 +49,18 @@ MessageCache::lookup(const bundy::dns::Name& qname,
                      bundy::dns::Message& response)
 {
     std::string entry_name = genCacheEntryName(qname, qtype);
-    HashKey entry_key = HashKey(entry_name, RRClass(message_class_));
-    MessageEntryPtr msg_entry = message_table_.get(entry_key);
+    MessageEntryPtr msg_entry = message_table_.get(entry_name);
     if(msg_entry) {
         // Check whether the message entry has expired.
        if (msg_entry->getExpireTime() > time(NULL)) {
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_FOUND).
                 arg(entry_name);
-            message_lru_.touch(msg_entry);
             return (msg_entry->genMessage(time(NULL), response));
         } else {
-            // message entry expires, remove it from hash table and lru list.
+            // message entry expires, remove it from the cache.
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_EXPIRED).
                 arg(entry_name);
-            message_table_.remove(entry_key);
-            message_lru_.remove(msg_entry);
+            message_table_.remove(entry_name, msg_entry);
             return (false);
        }
     }
@@ -96,25 +85,18 @@ MessageCache::update(const Message& msg) {
         arg((*iter)->getClass());
     std::string entry_name = genCacheEntryName((*iter)->getName(),
                                                (*iter)->getType());
-    HashKey entry_key = HashKey(entry_name, RRClass(message_class_));
 
-    // The simplest way to update is removing the old message entry directly.
-    // We have find the existed message entry, since we need to delete it
-    // from lru list too.
-    // TODO, but there should be a better way, since we here have to remove and
-    // add the message entry, maybe there is one way to touch it once.
-    MessageEntryPtr old_msg_entry = message_table_.get(entry_key);
-    if (old_msg_entry) {
+    // An existing entry for the same question is simply replaced in place.
+    if (message_table_.get(entry_name)) {
         LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_MESSAGES_REMOVE).
             arg((*iter)->getName()).arg((*iter)->getType()).
             arg((*iter)->getClass());
-        message_lru_.remove(old_msg_entry);
     }
 
     MessageEntryPtr msg_entry(new MessageEntry(msg, rrset_cache_,
                                                negative_soa_cache_));
-    message_lru_.add(msg_entry);
-    return (message_table_.add(msg_entry, entry_key, true));
+    message_table_.add(entry_name, msg_entry);
+    return (true);
 }
 
 } // namespace cache
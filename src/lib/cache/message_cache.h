@@ -19,9 +19,8 @@
 #include <boost/shared_ptr.hpp>
 #include <dns/message.h>
 #include "message_entry.h"
-#include <nsas/hash_table.h>
-#include <util/lru_list.h>
 #include "rrset_cache.h"
+#include "sharded_cache.h"
 
 namespace bundy {
 namespace cache {
@@ -30,6 +29,8 @@ namespace cache {
 /// The object of MessageCache represents the cache for class-specific
 /// messages.
 ///
+/// Like \c RRsetCache, the entries are kept in a \c ShardedCache.
+///
 /// \todo The message cache class should provide the interfaces for
 ///       loading, dumping and resizing.
 class MessageCache {
@@ -68,21 +69,13 @@ public:
     /// If the message doesn't exist in the cache, it will be added
     /// directly.
     bool update(const bundy::dns::Message& msg);
-protected:
-    /// \brief Get the hash key for the message entry in the cache.
-    /// \param name query name of the message.
-    /// \param type query type of the message.
-    /// \return return the hash key.
-    bundy::nsas::HashKey getEntryHashKey(const bundy::dns::Name& name,
-                                       const bundy::dns::RRType& type) const;
 
     // Make these variants be protected for easy unittest.
 protected:
     uint16_t message_class_; // The class of the message cache.
     RRsetCachePtr rrset_cache_;
     RRsetCachePtr negative_soa_cache_;
-    bundy::nsas::HashTable<MessageEntry> message_table_;
-    bundy::util::LruList<MessageEntry> message_lru_;
+    ShardedCache<MessageEntry> message_table_;
 };
 
 typedef boost::shared_ptr<MessageCache> MessageCachePtr;
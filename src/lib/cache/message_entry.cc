@@ -19,6 +19,7 @@
 #include <nsas/nsas_entry.h>
 #include "message_entry.h"
 #include "message_utility.h"
+#include "cached_rrset.h"
 #include "rrset_cache.h"
 #include "logger.h"
 
@@ -111,7 +112,8 @@ MessageEntry::getRRsetEntries(vector<RRsetEntryPtr>& rrset_entry_vec,
 void
 MessageEntry::addRRset(bundy::dns::Message& message,
                        const vector<RRsetEntryPtr>& rrset_entry_vec,
-                       const bundy::dns::Message::Section& section)
+                       const bundy::dns::Message::Section& section,
+                       const time_t time_now)
 {
     uint16_t start_index = 0;
     uint16_t end_index = answer_count_;
@@ -125,8 +127,12 @@ MessageEntry::addRRset(bundy::dns::Message& message,
         end_index = start_index + additional_count_;
     }
 
+    // The RRsets are rendered directly from the cached data, with the TTL
+    // adjusted for time_now.
     for (uint16_t index = start_index; index < end_index; ++index) {
-        message.addRRset(section, rrset_entry_vec[index]->getRRset());
+        message.addRRset(section,
+                         RRsetPtr(new CachedRRset(rrset_entry_vec[index],
+                                                  time_now)));
     }
 }
 
@@ -155,9 +161,9 @@ MessageEntry::genMessage(const time_t& time_now,
         msg.setHeaderFlag(Message::HEADERFLAG_AA, false);
         msg.setHeaderFlag(Message::HEADERFLAG_TC, headerflag_tc_);
 
-        addRRset(msg, rrset_entry_vec, Message::SECTION_ANSWER);
-        addRRset(msg, rrset_entry_vec, Message::SECTION_AUTHORITY);
-        addRRset(msg, rrset_entry_vec, Message::SECTION_ADDITIONAL);
+        addRRset(msg, rrset_entry_vec, Message::SECTION_ANSWER, time_now);
+        addRRset(msg, rrset_entry_vec, Message::SECTION_AUTHORITY, time_now);
+        addRRset(msg, rrset_entry_vec, Message::SECTION_ADDITIONAL, time_now);
 
         return (true);
     }
@@ -79,6 +79,10 @@ public:
     /// \brief generate one dns message according
     ///        the rrsets information of the message.
     ///
+    /// The rrsets are added as \c CachedRRset objects, so when the
+    /// message is rendered they are written directly from the cached
+    /// data.
+    ///
     /// \param time_now set the ttl of each rrset in the message
     ///        as "expire_time - time_now" (expire_time is the
     ///        expiration time of the rrset).
@@ -152,9 +156,11 @@ protected:
     /// \param rrset_entry_vec vector for rrset entries in
     ///        different sections.
     /// \param section The section to add to
+    /// \param time_now The time of now, to determine the TTL of the rrsets.
     void addRRset(bundy::dns::Message& message,
                   const std::vector<RRsetEntryPtr>& rrset_entry_vec,
-                  const bundy::dns::Message::Section& section);
+                  const bundy::dns::Message::Section& section,
+                  const time_t time_now);
 
     /// \brief Get the all the rrset entries for the message entry.
     ///
@@ -15,6 +15,7 @@
 #include <config.h>
 
 #include "resolver_cache.h"
+#include "cached_rrset.h"
 #include "dns/message.h"
 #include "rrset_cache.h"
 #include "logger.h"
@@ -120,6 +121,35 @@ ResolverClassCache::lookup(const bundy::dns::Name& qname,
     }
 }
 
+bundy::dns::RRsetPtr
+ResolverClassCache::lookupStale(const bundy::dns::Name& qname,
+                                const bundy::dns::RRType& qtype) const
+{
+    RRsetEntryPtr rrset_entry = rrsets_cache_->lookupStale(qname, qtype);
+    if (!rrset_entry) {
+        return (RRsetPtr());
+    }
+    const time_t now = time(NULL);
+    if (rrset_entry->getExpireTime() > now) {
+        return (RRsetPtr(new CachedRRset(rrset_entry, now)));
+    }
+    return (RRsetPtr(new CachedRRset(rrset_entry, RRTTL(STALE_RRSET_TTL))));
+}
+
+bool
+ResolverClassCache::isRefreshDue(const bundy::dns::Name& qname,
+                                 const bundy::dns::RRType& qtype,
+                                 unsigned int percent) const
+{
+    RRsetEntryPtr rrset_entry = rrsets_cache_->lookup(qname, qtype);
+    return (rrset_entry && rrset_entry->isRefreshDue(time(NULL), percent));
+}
+
+void
+ResolverClassCache::setStaleWindow(uint32_t seconds) {
+    rrsets_cache_->setStaleWindow(seconds);
+}
+
 bool
 ResolverClassCache::update(const bundy::dns::Message& msg) {
     LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RESOLVER_UPDATE_MSG).
@@ -234,6 +264,36 @@ ResolverCache::lookupDeepestNS(const bundy::dns::Name& qname,
     return (RRsetPtr());
 }
 
+bundy::dns::RRsetPtr
+ResolverCache::lookupStale(const bundy::dns::Name& qname,
+                           const bundy::dns::RRType& qtype,
+                           const bundy::dns::RRClass& qclass) const
+{
+    ResolverClassCache* cc = getClassCache(qclass);
+    if (cc) {
+        return (cc->lookupStale(qname, qtype));
+    }
+    return (RRsetPtr());
+}
+
+bool
+ResolverCache::isRefreshDue(const bundy::dns::Name& qname,
+                            const bundy::dns::RRType& qtype,
+                            const bundy::dns::RRClass& qclass,
+                            unsigned int percent) const
+{
+    ResolverClassCache* cc = getClassCache(qclass);
+    return (cc && cc->isRefreshDue(qname, qtype, percent));
+}
+
+void
+ResolverCache::setStaleWindow(uint32_t seconds) {
+    for (std::vector<ResolverClassCache*>::size_type i = 0;
+         i < class_caches_.size(); ++i) {
+        class_caches_[i]->setStaleWindow(seconds);
+    }
+}
+
 bool
 ResolverCache::update(const bundy::dns::Message& msg) {
     QuestionIterator iter = msg.beginQuestion();
@@ -34,6 +34,9 @@ class RRsetCache;
 #define RRSET_CACHE_DEFAULT_SIZE   20000
 #define NEGATIVE_RRSET_CACHE_DEFAULT_SIZE   10000
 
+/// The TTL of stale RRsets in responses (RFC 8767 recommends 30 seconds).
+#define STALE_RRSET_TTL 30
+
 /// \brief Cache Size Information.
 ///
 /// Used to initialize the size of class-specific rrset/message cache.
@@ -126,6 +129,22 @@ public:
     bundy::dns::RRsetPtr lookup(const bundy::dns::Name& qname,
                               const bundy::dns::RRType& qtype) const;
 
+    /// \brief Look up rrset in cache, including a stale one.
+    ///
+    /// See \c ResolverCache::lookupStale().
+    bundy::dns::RRsetPtr lookupStale(const bundy::dns::Name& qname,
+                                     const bundy::dns::RRType& qtype) const;
+
+    /// \brief Check whether the cached rrset should be refreshed.
+    ///
+    /// See \c ResolverCache::isRefreshDue().
+    bool isRefreshDue(const bundy::dns::Name& qname,
+                      const bundy::dns::RRType& qtype,
+                      unsigned int percent) const;
+
+    /// \brief Set the window for serving stale rrsets, in seconds.
+    void setStaleWindow(uint32_t seconds);
+
     /// \brief Update the message in the cache with the new one.
     ///
     /// \param msg The message to update
@@ -275,8 +294,54 @@ public:
     /// is used frequently? Exact or closest enclosing ns looking up.
     bundy::dns::RRsetPtr lookupDeepestNS(const bundy::dns::Name& qname,
                               const bundy::dns::RRClass& qclass) const;
+
+    /// \brief Look up rrset in cache for serving stale data.
+    ///
+    /// This is intended to be used when the resolver fails to get an
+    /// answer from the authoritative servers.  In addition to the rrsets
+    /// \c lookup() would return, it returns an expired rrset if it expired
+    /// no longer than the stale window (see \c setStaleWindow()) ago; its
+    /// TTL is \c STALE_RRSET_TTL.  Local zone data isn't searched.
+    ///
+    /// \param qname The query name to look up
+    /// \param qtype The query type to look up
+    /// \param qclass The query class to look up
+    ///
+    /// \return return the shared_ptr of rrset if it can be found,
+    ///         or else, return NULL.
+    bundy::dns::RRsetPtr lookupStale(const bundy::dns::Name& qname,
+                                     const bundy::dns::RRType& qtype,
+                                     const bundy::dns::RRClass& qclass) const;
+
+    /// \brief Check whether the cached rrset should be refreshed.
+    ///
+    /// This is for prefetching: the resolver can refresh an rrset found
+    /// in the cache in the background before it expires, so the clients
+    /// querying it later don't have to wait for a full resolution.
+    ///
+    /// \param qname The query name to look up
+    /// \param qtype The query type to look up
+    /// \param qclass The query class to look up
+    /// \param percent The threshold, in percent of the original TTL.
+    ///
+    /// \return true if the rrset is in the cache and the remaining TTL
+    ///         is \c percent % of its original TTL or less, or else,
+    ///         return false.
+    bool isRefreshDue(const bundy::dns::Name& qname,
+                      const bundy::dns::RRType& qtype,
+                      const bundy::dns::RRClass& qclass,
+                      unsigned int percent) const;
     //@}
 
+    /// \brief Set the window for serving stale rrsets.
+    ///
+    /// Expired rrsets are kept in the cache for this many seconds after
+    /// they expire, so they can be returned by \c lookupStale().  If it's
+    /// 0 (the default), stale rrsets are not served.
+    ///
+    /// \param seconds The stale window in seconds.
+    void setStaleWindow(uint32_t seconds);
+
     /// \brief Update the message in the cache with the new one.
     ///
     /// \param msg The message to update
@@ -17,11 +17,7 @@
 #include "rrset_cache.h"
 #include "logger.h"
 #include <string>
-#include <nsas/nsas_entry_compare.h>
-#include <nsas/hash_table.h>
-#include <nsas/hash_deleter.h>
 
-using namespace bundy::nsas;
 using namespace bundy::dns;
 using namespace std;
 
@@ -31,9 +27,8 @@ namespace cache {
 RRsetCache::RRsetCache(uint32_t cache_size,
                        uint16_t rrset_class):
     class_(rrset_class),
-    rrset_table_(new NsasEntryCompare<RRsetEntry>, cache_size),
-    rrset_lru_((3 * cache_size),
-                  new HashDeleter<RRsetEntry>(rrset_table_))
+    stale_window_(0),
+    rrset_table_(3 * cache_size)
 {
     LOG_DEBUG(logger, DBG_TRACE_BASIC, CACHE_RRSET_INIT).arg(cache_size).
         arg(RRClass(rrset_class));
@@ -47,20 +42,20 @@ RRsetCache::lookup(const bundy::dns::Name& qname,
         arg(qtype).arg(RRClass(class_));
     const string entry_name = genCacheEntryName(qname, qtype);
 
-    RRsetEntryPtr entry_ptr = rrset_table_.get(HashKey(entry_name,
-                                                       RRClass(class_)));
+    RRsetEntryPtr entry_ptr = rrset_table_.get(entry_name);
     if (entry_ptr) {
-        if (entry_ptr->getExpireTime() > time(NULL)) {
-            // Only touch the non-expired rrset entries
-            rrset_lru_.touch(entry_ptr);
+        const time_t now = time(NULL);
+        if (entry_ptr->getExpireTime() > now) {
             return (entry_ptr);
         } else {
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RRSET_EXPIRED).arg(qname).
                 arg(qtype).arg(RRClass(class_));
-            // the rrset entry has expired, so just remove it from
-            // hash table and lru list.
-            rrset_table_.remove(entry_ptr->hashKey());
-            rrset_lru_.remove(entry_ptr);
+            // the rrset entry has expired, so just remove it (unless
+            // someone has replaced it in the meantime), unless it may
+            // still be served as stale data.
+            if (entry_ptr->getExpireTime() + stale_window_ <= now) {
+                rrset_table_.remove(entry_name, entry_ptr);
+            }
         }
     }
 
@@ -69,6 +64,21 @@ RRsetCache::lookup(const bundy::dns::Name& qname,
     return (RRsetEntryPtr());
 }
 
+RRsetEntryPtr
+RRsetCache::lookupStale(const bundy::dns::Name& qname,
+                        const bundy::dns::RRType& qtype)
+{
+    RRsetEntryPtr entry_ptr = rrset_table_.get(genCacheEntryName(qname,
+                                                                 qtype));
+    if (entry_ptr &&
+        entry_ptr->getExpireTime() + stale_window_ > time(NULL)) {
+        LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RRSET_STALE).arg(qname).
+            arg(qtype).arg(RRClass(class_));
+        return (entry_ptr);
+    }
+    return (RRsetEntryPtr());
+}
+
 RRsetEntryPtr
 RRsetCache::update(const bundy::dns::AbstractRRset& rrset,
                    const RRsetTrustLevel& level)
@@ -89,14 +99,13 @@ RRsetCache::update(const bundy::dns::AbstractRRset& rrset,
             LOG_DEBUG(logger, DBG_TRACE_DATA, CACHE_RRSET_REMOVE_OLD).
                 arg(rrset.getName()).arg(rrset.getType()).
                 arg(rrset.getClass());
-            // Remove the old rrset entry from the lru list.
-            rrset_lru_.remove(entry_ptr);
+            // The old rrset entry will be replaced below.
         }
     }
 
     entry_ptr.reset(new RRsetEntry(rrset, level));
-    rrset_table_.add(entry_ptr, entry_ptr->hashKey(), true);
-    rrset_lru_.add(entry_ptr);
+    rrset_table_.add(genCacheEntryName(rrset.getName(), rrset.getType()),
+                     entry_ptr);
     return (entry_ptr);
 }
 
@@ -16,9 +16,7 @@
 #define RRSET_CACHE_H
 
 #include <cache/rrset_entry.h>
-#include <nsas/hash_table.h>
-
-#include <util/lru_list.h>
+#include <cache/sharded_cache.h>
 
 namespace bundy {
 namespace cache {
@@ -29,6 +27,10 @@ class RRsetEntry;
 /// The object of RRsetCache represented the cache for class-specific
 /// RRsets.
 ///
+/// The entries are kept in a \c ShardedCache, so the cache can be shared
+/// by multiple threads and lookups in different threads don't block each
+/// other.
+///
 /// \todo The rrset cache class should provide the interfaces for
 ///       loading, dumping and resizing.
 class RRsetCache{
@@ -47,9 +49,7 @@ public:
     /// \param cache_size the size of rrset cache.
     /// \param rrset_class the class of rrset cache.
     RRsetCache(uint32_t cache_size, uint16_t rrset_class);
-    virtual ~RRsetCache() {
-        rrset_lru_.clear(); // Clear the rrset entries in the list.
-    }
+    virtual ~RRsetCache() {}
     //@}
 
     /// \brief Look up rrset in cache.
@@ -61,6 +61,38 @@ public:
     RRsetEntryPtr lookup(const bundy::dns::Name& qname,
                          const bundy::dns::RRType& qtype);
 
+    /// \brief Look up rrset in cache, including a stale one.
+    ///
+    /// This is the same as \c lookup(), except that it also returns an
+    /// expired rrset entry if it expired no more than the stale window
+    /// (see \c setStaleWindow()) ago.  It's intended to be used as a last
+    /// resort when the data can't be refreshed from the authoritative
+    /// servers (RFC 8767).
+    ///
+    /// \param qname The query name to look up
+    /// \param qtype The query type
+    /// \return return the shared_ptr of rrset entry if it can be
+    /// found in the cache, or else, return NULL.
+    RRsetEntryPtr lookupStale(const bundy::dns::Name& qname,
+                              const bundy::dns::RRType& qtype);
+
+    /// \brief Set the stale window.
+    ///
+    /// Expired rrsets are kept in the cache (until they are evicted or
+    /// replaced) for this many seconds after their expiration so that
+    /// \c lookupStale() can find them.  If it's 0 (the default), expired
+    /// rrsets are removed when they are found by a lookup.
+    ///
+    /// \param seconds The stale window in seconds.
+    void setStaleWindow(uint32_t seconds) {
+        stale_window_ = seconds;
+    }
+
+    /// \brief Return the stale window in seconds.
+    uint32_t getStaleWindow() const {
+        return (stale_window_);
+    }
+
     /// \brief Update RRset Cache
     /// Update the rrset entry in the cache with the new one.
     /// If the rrset has expired or doesn't exist in the cache,
@@ -77,8 +109,8 @@ public:
     /// \short Protected memebers, so they can be accessed by tests.
 protected:
     uint16_t class_; // The class of the rrset cache.
-    bundy::nsas::HashTable<RRsetEntry> rrset_table_;
-    bundy::util::LruList<RRsetEntry> rrset_lru_;
+    uint32_t stale_window_; // How long expired rrsets are kept, in seconds.
+    ShardedCache<RRsetEntry> rrset_table_; // Keyed by genCacheEntryName().
 };
 
 typedef boost::shared_ptr<RRsetCache> RRsetCachePtr;
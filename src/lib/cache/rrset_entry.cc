@@ -14,33 +14,142 @@
 
 #include <config.h>
 
-#include <dns/message.h>
-#include <nsas/nsas_entry.h>
-#include <nsas/fetchable.h>
 #include "rrset_entry.h"
-#include "rrset_copy.h"
+
+#include <datasrc/memory/rdata_serialization.h>
+
+#include <dns/labelsequence.h>
+#include <dns/rdata.h>
+#include <dns/rrttl.h>
+#include <util/buffer.h>
+
+#include <boost/bind.hpp>
+
+#include <cassert>
 
 using namespace bundy::dns;
-using namespace bundy::nsas;
+using namespace bundy::dns::rdata;
+using bundy::datasrc::memory::RdataEncoder;
+using bundy::datasrc::memory::RdataNameAttributes;
+using bundy::datasrc::memory::RdataReader;
 
 namespace bundy {
 namespace cache {
 
 RRsetEntry::RRsetEntry(const bundy::dns::AbstractRRset& rrset,
                        const RRsetTrustLevel& level):
-    entry_name_(genCacheEntryName(rrset.getName(), rrset.getType())),
     expire_time_(time(NULL) + rrset.getTTL().getValue()),
+    ttl_(rrset.getTTL().getValue()),
     trust_level_(level),
-    rrset_(new RRset(rrset.getName(), rrset.getClass(), rrset.getType(), rrset.getTTL())),
-    hash_key_(HashKey(entry_name_, rrset_->getClass()))
+    rrclass_(rrset.getClass()),
+    rrtype_(rrset.getType())
+{
+    // The encoder ignores duplicate RDATA, so only count the added ones.
+    RdataEncoder encoder;
+    rdata_count_ = 0;
+    sig_count_ = 0;
+    if (rrtype_ == RRType::RRSIG()) {
+        // The encoder doesn't accept RRSIG as the main type; store them as
+        // the RRSIGs of an empty set.  As there's no main RDATA, the type
+        // given to the encoder doesn't matter, and for reading the data
+        // the generic (opaque) spec for RRSIG is used.
+        encoder.start(rrclass_, RRType::ANY());
+        for (RdataIteratorPtr it = rrset.getRdataIterator(); !it->isLast();
+             it->next()) {
+            if (encoder.addSIGRdata(it->getCurrent())) {
+                ++sig_count_;
+            }
+        }
+    } else {
+        encoder.start(rrclass_, rrtype_);
+        for (RdataIteratorPtr it = rrset.getRdataIterator(); !it->isLast();
+             it->next()) {
+            if (encoder.addRdata(it->getCurrent())) {
+                ++rdata_count_;
+            }
+        }
+        const ConstRRsetPtr rrsig = rrset.getRRsig();
+        if (rrsig) {
+            for (RdataIteratorPtr it = rrsig->getRdataIterator();
+                 !it->isLast(); it->next()) {
+                if (encoder.addSIGRdata(it->getCurrent())) {
+                    ++sig_count_;
+                }
+            }
+        }
+    }
+
+    const LabelSequence owner_labels(rrset.getName());
+    rdata_offset_ = owner_labels.getSerializedLength();
+    const size_t data_len = rdata_offset_ + encoder.getStorageLength();
+    data_.reset(new uint8_t[data_len]);
+    owner_labels.serialize(data_.get(), rdata_offset_);
+    encoder.encode(data_.get() + rdata_offset_, data_len - rdata_offset_);
+}
+
+namespace {
+void
+renderNameToBuffer(const LabelSequence& name_labels, RdataNameAttributes,
+                   util::OutputBuffer* buffer)
+{
+    size_t data_len;
+    const uint8_t* data = name_labels.getData(&data_len);
+    buffer->writeData(data, data_len);
+}
+
+void
+renderDataToBuffer(const void* data, size_t data_len,
+                   util::OutputBuffer* buffer)
 {
-    rrsetCopy(rrset, *(rrset_.get()));
+    buffer->writeData(data, data_len);
+}
 }
 
 bundy::dns::RRsetPtr
-RRsetEntry::getRRset() {
-    updateTTL();
-    return (rrset_);
+RRsetEntry::getRRset() const {
+    util::OutputBuffer buffer(0);
+    RdataReader reader(rrclass_, rrtype_, getDataBuf(), rdata_count_,
+                       sig_count_,
+                       boost::bind(renderNameToBuffer, _1, _2, &buffer),
+                       boost::bind(renderDataToBuffer, _1, _2, &buffer));
+
+    size_t name_len;
+    const uint8_t* name_data = getOwnerLabels().getData(&name_len);
+    util::InputBuffer name_buffer(name_data, name_len);
+    const Name name(name_buffer);
+    const RRTTL ttl(getTTL());
+
+    RRsetPtr rrset(new RRset(name, rrclass_, rrtype_, ttl));
+    for (size_t i = 0; i < rdata_count_; ++i) {
+        buffer.clear();
+        const bool rendered = reader.iterateRdata();
+        assert(rendered);
+        util::InputBuffer ib(buffer.getData(), buffer.getLength());
+        rrset->addRdata(createRdata(rrtype_, rrclass_, ib, ib.getLength()));
+    }
+    reader.iterateRdata();      // move to the RRSIGs
+    RRsetPtr sig_rrset;
+    for (size_t i = 0; i < sig_count_; ++i) {
+        buffer.clear();
+        const bool rendered = reader.iterateSingleSig();
+        assert(rendered);
+        util::InputBuffer ib(buffer.getData(), buffer.getLength());
+        const ConstRdataPtr rdata = createRdata(RRType::RRSIG(), rrclass_, ib,
+                                                ib.getLength());
+        if (rrtype_ == RRType::RRSIG()) {
+            rrset->addRdata(rdata);
+        } else {
+            if (!sig_rrset) {
+                sig_rrset.reset(new RRset(name, rrclass_, RRType::RRSIG(),
+                                          ttl));
+            }
+            sig_rrset->addRdata(rdata);
+        }
+    }
+    if (sig_rrset) {
+        rrset->addRRsig(sig_rrset);
+    }
+    return (rrset);
 }
 
 time_t
@@ -48,21 +157,22 @@ RRsetEntry::getExpireTime() const {
     return (expire_time_);
 }
 
-void
-RRsetEntry::updateTTL(){
-    uint32_t oldTTL = rrset_->getTTL().getValue();
-    if(oldTTL == 0) {
-        return;
+uint32_t
+RRsetEntry::getTTL(time_t now) const {
+    if (ttl_ == 0) {
+        return (0);
     }
+    return (now < expire_time_ ? (expire_time_ - now) : 0);
+}
 
-    uint32_t now = time(NULL);
-    uint32_t newTTL = now < expire_time_ ? (expire_time_ - now) : 0;
-
-    RRTTL ttl(newTTL);
-    rrset_->setTTL(ttl);
+bool
+RRsetEntry::isRefreshDue(time_t now, unsigned int percent) const {
+    if (ttl_ == 0 || now >= expire_time_) {
+        return (false);
+    }
+    return (static_cast<uint64_t>(expire_time_ - now) * 100 <=
+            static_cast<uint64_t>(ttl_) * percent);
 }
 
 } // namespace cache
 } // namespace bundy
-
-
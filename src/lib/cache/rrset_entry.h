@@ -15,13 +15,18 @@
 #ifndef RRSET_ENTRY_H
 #define RRSET_ENTRY_H
 
+#include <dns/labelsequence.h>
+#include <dns/rrclass.h>
 #include <dns/rrset.h>
-#include <dns/message.h>
 #include <dns/rrttl.h>
-#include <nsas/nsas_entry.h>
-#include <nsas/fetchable.h>
+#include <dns/rrtype.h>
 #include "cache_entry_key.h"
 
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ctime>
+
 namespace bundy {
 namespace cache {
 
@@ -58,7 +63,16 @@ enum RRsetTrustLevel {
 /// The object of RRsetEntry represents one cached RRset.
 /// Each RRset entry may be refered using shared_ptr by several message
 /// entries.
-class RRsetEntry : public bundy::nsas::NsasEntry<RRsetEntry>
+///
+/// The RRset is not stored as an \c RRset object, but in a compact
+/// wire-like form in a single memory region: the owner name as a serialized
+/// \c LabelSequence, followed by the RDATA (and RRSIG RDATA, if any) encoded
+/// by \c datasrc::memory::RdataEncoder, the same form the in-memory data
+/// source uses.  A \c CachedRRset renders it directly into a DNS message.
+///
+/// Once constructed the entry is never modified, so it can be shared by
+/// multiple threads.
+class RRsetEntry
 {
     ///
     /// \name Constructors and Destructor
@@ -71,6 +85,13 @@ private:
     RRsetEntry& operator=(const RRsetEntry&);
 public:
     /// \brief Constructor
+    ///
+    /// If \c rrset is of type RRSIG, its RDATA are stored as the RRSIGs
+    /// of an empty RRset.  Otherwise any RRSIGs attached to \c rrset are
+    /// stored with it.
+    ///
+    /// \throw datasrc::memory::RdataEncodingError an RDATA is too large.
+    ///
     /// \param rrset The RRset used to initialize the RRset entry.
     /// \param level trustworthiness of the RRset.
     RRsetEntry(const bundy::dns::AbstractRRset& rrset,
@@ -82,8 +103,13 @@ public:
 
     /// \brief Return a pointer to a generated RRset
     ///
+    /// A new \c RRset (with its RRSIGs, if any) is built from the stored
+    /// data on each call, with the TTL adjusted to the remaining lifetime.
+    /// This is relatively expensive; for rendering the RRset in a response
+    /// \c CachedRRset should be used instead.
+    ///
     /// \return Pointer to the generated RRset
-    bundy::dns::RRsetPtr getRRset();
+    bundy::dns::RRsetPtr getRRset() const;
 
     /// \brief Get the expiration time of the RRset.
     ///
@@ -95,17 +121,27 @@ public:
     /// \brief Get the ttl of the RRset.
     ///
     /// \return The TTL of the RRset
-    uint32_t getTTL() {
-        updateTTL();
-        return (rrset_->getTTL().getValue());
+    uint32_t getTTL() const {
+        return (getTTL(time(NULL)));
     }
 
-    /// \brief Get the hash key
+    /// \brief Get the ttl of the RRset at the given time.
     ///
-    /// \return return hash key
-    bundy::nsas::HashKey hashKey() const {
-        return (hash_key_);
-    }
+    /// It's the remaining lifetime of the RRset at \c now (0 if it has
+    /// expired).  If the RRset had a TTL of 0 from the beginning, it's
+    /// always 0.
+    uint32_t getTTL(time_t now) const;
+
+    /// \brief Return whether the RRset should be refreshed in advance.
+    ///
+    /// This is for prefetching popular RRsets before they expire.
+    ///
+    /// \param now The current time.
+    /// \param percent The threshold, in percent of the original TTL.
+    /// \return true if the RRset hasn't expired at \c now, but the
+    /// remaining lifetime is \c percent % of the original TTL or less.
+    /// Always false if the original TTL is 0.
+    bool isRefreshDue(time_t now, unsigned int percent) const;
 
     /// \brief get RRset trustworthiness
     ///
@@ -113,16 +149,45 @@ public:
     RRsetTrustLevel getTrustLevel() const {
         return (trust_level_);
     }
-private:
-    /// \brief Update TTL according to expiration time
-    void updateTTL();
+
+    /// \name Accessors to the stored data.
+    ///
+    /// These are mainly for \c CachedRRset.
+    //@{
+    /// \brief Return the RR class of the RRset.
+    const bundy::dns::RRClass& getClass() const { return (rrclass_); }
+
+    /// \brief Return the RR type of the RRset.
+    const bundy::dns::RRType& getType() const { return (rrtype_); }
+
+    /// \brief Return the number of (non RRSIG) RDATA.
+    size_t getRdataCount() const { return (rdata_count_); }
+
+    /// \brief Return the number of RRSIG RDATA.
+    size_t getSigRdataCount() const { return (sig_count_); }
+
+    /// \brief Return the owner name as a \c LabelSequence.
+    bundy::dns::LabelSequence getOwnerLabels() const {
+        return (bundy::dns::LabelSequence(data_.get()));
+    }
+
+    /// \brief Return the encoded RDATA for \c datasrc::memory::RdataReader.
+    ///
+    /// The RR type for the reader is \c getType(), and the number of RDATA
+    /// and RRSIGs are \c getRdataCount() and \c getSigRdataCount().
+    const void* getDataBuf() const { return (data_.get() + rdata_offset_); }
+    //@}
 
 private:
-    std::string entry_name_; // The entry name for this rrset entry.
-    time_t expire_time_;     // Expiration time of rrset.
-    RRsetTrustLevel trust_level_; // RRset trustworthiness.
-    boost::shared_ptr<bundy::dns::RRset> rrset_;
-    bundy::nsas::HashKey hash_key_; // RRsetEntry hash key
+    const time_t expire_time_; // Expiration time of rrset.
+    const uint32_t ttl_;     // Original TTL of rrset.
+    const RRsetTrustLevel trust_level_; // RRset trustworthiness.
+    const bundy::dns::RRClass rrclass_;
+    const bundy::dns::RRType rrtype_;
+    uint16_t rdata_count_;
+    uint16_t sig_count_;
+    uint16_t rdata_offset_;  // Where the encoded RDATA begins in data_
+    boost::scoped_array<uint8_t> data_; // Owner name and encoded RDATA
 };
 
 typedef boost::shared_ptr<RRsetEntry> RRsetEntryPtr;
@@ -0,0 +1,307 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SHARDED_CACHE_H
+#define SHARDED_CACHE_H
+
+#include <util/threads/sync.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace cache {
+
+/// \brief Sharded cache with CLOCK eviction
+///
+/// A fixed-capacity map from string keys to shared pointers of \c T,
+/// intended to be shared by multiple threads.  The entries are spread over
+/// a number of "shards" by the hash of the key, and each shard has its own
+/// hash table, its own lock and its own eviction state, so operations on
+/// different shards never contend with each other.
+///
+/// Lookups (\c get()) only take a shared (reader) lock of the shard, so
+/// concurrent lookups don't serialize even within the same shard.  Instead of
+/// moving the entry in an LRU list on each hit, a lookup only sets the
+/// "referenced" flag of the slot holding the entry.  When a shard is full,
+/// inserting a new entry runs the CLOCK (second chance) algorithm: the
+/// shard's "hand" sweeps the slots, clearing the referenced flags, and the
+/// first entry found not referenced since the previous sweep is evicted.
+/// This approximates LRU closely enough for a cache, and it makes the hit
+/// path read-only except for the flag.
+///
+/// The flag is set without an exclusive lock, so it's atomic (with relaxed
+/// ordering, as it isn't used to publish anything); concurrent lookups may
+/// store it at the same time, but they only ever store \c true, and it's
+/// only cleared by the sweep under the exclusive lock.  It's also only
+/// stored if it's not set yet, so frequently looked up entries don't keep
+/// dirtying the cache line.
+///
+/// The capacity is divided evenly among the shards, so the eviction is
+/// per shard: an entry can be evicted while some other shard still has
+/// room.  For small capacities fewer shards are used (down to one), so the
+/// behavior of a small cache is the same as that of a single CLOCK ring.
+template <typename T>
+class ShardedCache : boost::noncopyable {
+public:
+    /// \brief The default (maximum) number of shards.
+    static const size_t DEFAULT_SHARD_COUNT = 16;
+
+    /// \brief The minimum number of entries per shard when the number of
+    /// shards is chosen automatically.
+    static const size_t MIN_SHARD_CAPACITY = 64;
+
+    /// \brief Constructor.
+    ///
+    /// \param capacity The maximum number of entries (at least 1 is used).
+    /// \param shard_count The number of shards.  If 0, the number is
+    /// chosen from the capacity: \c DEFAULT_SHARD_COUNT, or fewer so each
+    /// shard can hold at least \c MIN_SHARD_CAPACITY entries.
+    explicit ShardedCache(size_t capacity, size_t shard_count = 0) :
+        shard_count_(getShardCount(capacity, shard_count)),
+        shards_(new Shard[shard_count_])
+    {
+        if (capacity == 0) {
+            capacity = 1;
+        }
+        const size_t shard_capacity =
+            (capacity + shard_count_ - 1) / shard_count_;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            shards_[i].init(shard_capacity);
+        }
+    }
+
+    /// \brief Return the entry for the given key.
+    ///
+    /// This also marks the entry as referenced for the eviction.
+    ///
+    /// \return The entry, or a null pointer if there's no entry for the key.
+    boost::shared_ptr<T> get(const std::string& key) {
+        Shard& shard = getShard(key);
+        util::thread::RWMutex::ReadLocker locker(shard.mutex_);
+        const typename Shard::Index::const_iterator it =
+            shard.index_.find(key);
+        if (it == shard.index_.end()) {
+            return (boost::shared_ptr<T>());
+        }
+        Slot& slot = shard.slots_[it->second];
+        if (!slot.referenced_.load(std::memory_order_relaxed)) {
+            slot.referenced_.store(true, std::memory_order_relaxed);
+        }
+        return (slot.entry_);
+    }
+
+    /// \brief Add an entry.
+    ///
+    /// If there's already an entry for the key, it's replaced in place (and
+    /// keeps its referenced state).  Otherwise, if the shard for the key is
+    /// full, another entry in the shard is evicted.
+    ///
+    /// \param key The key of the entry.
+    /// \param entry The entry.
+    void add(const std::string& key, const boost::shared_ptr<T>& entry) {
+        Shard& shard = getShard(key);
+        // The replaced or evicted entry is released outside of the lock.
+        boost::shared_ptr<T> old_entry;
+        util::thread::RWMutex::Locker locker(shard.mutex_);
+        const typename Shard::Index::iterator it = shard.index_.find(key);
+        if (it != shard.index_.end()) {
+            old_entry.swap(shard.slots_[it->second].entry_);
+            shard.slots_[it->second].entry_ = entry;
+            return;
+        }
+        size_t pos;
+        if (!shard.free_.empty()) {
+            pos = shard.free_.back();
+            shard.free_.pop_back();
+        } else {
+            pos = shard.evict();
+            shard.index_.erase(shard.slots_[pos].key_);
+            old_entry.swap(shard.slots_[pos].entry_);
+        }
+        Slot& slot = shard.slots_[pos];
+        slot.key_ = key;
+        slot.entry_ = entry;
+        slot.referenced_.store(false, std::memory_order_relaxed);
+        shard.index_.insert(std::make_pair(key, pos));
+    }
+
+    /// \brief Remove the entry for the given key.
+    ///
+    /// \return true if an entry was removed; false if there was none.
+    bool remove(const std::string& key) {
+        return (removeInternal(key, NULL));
+    }
+
+    /// \brief Remove the entry for the given key if it's the given one.
+    ///
+    /// This is for removing an entry found (e.g., expired) by a previous
+    /// \c get() without accidentally removing a newer entry that some other
+    /// thread added in the meantime.
+    ///
+    /// \return true if the entry was removed; false otherwise.
+    bool remove(const std::string& key, const boost::shared_ptr<T>& entry) {
+        return (removeInternal(key, entry.get()));
+    }
+
+    /// \brief Remove all entries.
+    void clear() {
+        for (size_t i = 0; i < shard_count_; ++i) {
+            Shard& shard = shards_[i];
+            std::vector<boost::shared_ptr<T> > entries;
+            util::thread::RWMutex::Locker locker(shard.mutex_);
+            for (typename Shard::Index::const_iterator it =
+                     shard.index_.begin(); it != shard.index_.end(); ++it) {
+                Slot& slot = shard.slots_[it->second];
+                entries.push_back(slot.entry_);
+                slot.entry_.reset();
+                slot.key_.clear();
+                shard.free_.push_back(it->second);
+            }
+            shard.index_.clear();
+        }
+    }
+
+    /// \brief Return the number of entries in the cache.
+    ///
+    /// The shards are examined one by one, so if the cache is being updated
+    /// by other threads the result is only approximate.
+    size_t size() const {
+        size_t count = 0;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            util::thread::RWMutex::ReadLocker locker(shards_[i].mutex_);
+            count += shards_[i].index_.size();
+        }
+        return (count);
+    }
+
+    /// \brief Return the number of shards.
+    size_t getShardCount() const {
+        return (shard_count_);
+    }
+
+private:
+    struct Slot {
+        Slot() : referenced_(false) {}
+        // Only for std::vector, while the shard is initialized.
+        Slot(const Slot& other) :
+            key_(other.key_), entry_(other.entry_),
+            referenced_(other.referenced_.load(std::memory_order_relaxed))
+        {}
+        std::string key_;
+        boost::shared_ptr<T> entry_;
+        std::atomic<bool> referenced_;
+    };
+
+    struct Shard : boost::noncopyable {
+        typedef boost::unordered_map<std::string, size_t> Index;
+
+        Shard() : hand_(0) {}
+
+        void init(size_t capacity) {
+            slots_.resize(capacity);
+            free_.reserve(capacity);
+            for (size_t i = capacity; i > 0; --i) {
+                free_.push_back(i - 1);
+            }
+        }
+
+        // Advance the hand until it finds a slot that hasn't been
+        // referenced since the last sweep, and return its position.  It's
+        // only called when all slots are used, and it terminates within two
+        // rounds.
+        size_t evict() {
+            while (true) {
+                const size_t pos = hand_;
+                hand_ = (hand_ + 1) % slots_.size();
+                if (!slots_[pos].referenced_.load(
+                        std::memory_order_relaxed)) {
+                    return (pos);
+                }
+                slots_[pos].referenced_.store(false,
+                                              std::memory_order_relaxed);
+            }
+        }
+
+        mutable util::thread::RWMutex mutex_;
+        Index index_;
+        std::vector<Slot> slots_;
+        std::vector<size_t> free_;
+        size_t hand_;
+    };
+
+    static size_t getShardCount(size_t capacity, size_t shard_count) {
+        if (shard_count != 0) {
+            return (shard_count);
+        }
+        shard_count = DEFAULT_SHARD_COUNT;
+        while (shard_count > 1 &&
+               capacity / shard_count < MIN_SHARD_CAPACITY) {
+            shard_count /= 2;
+        }
+        return (shard_count);
+    }
+
+    Shard& getShard(const std::string& key) {
+        // The hash tables of the shards use the same hash function, so the
+        // shard is chosen by the higher bits to keep the distribution within
+        // each shard even.
+        const size_t hash = boost::hash<std::string>()(key);
+        return (shards_[(hash >> 16) % shard_count_]);
+    }
+
+    bool removeInternal(const std::string& key, const T* entry) {
+        Shard& shard = getShard(key);
+        boost::shared_ptr<T> removed;
+        util::thread::RWMutex::Locker locker(shard.mutex_);
+        const typename Shard::Index::iterator it = shard.index_.find(key);
+        if (it == shard.index_.end()) {
+            return (false);
+        }
+        Slot& slot = shard.slots_[it->second];
+        if (entry != NULL && slot.entry_.get() != entry) {
+            return (false);
+        }
+        removed.swap(slot.entry_);
+        slot.key_.clear();
+        shard.free_.push_back(it->second);
+        shard.index_.erase(it);
+        return (true);
+    }
+
+    const size_t shard_count_;
+    boost::scoped_array<Shard> shards_;
+};
+
+template <typename T>
+const size_t ShardedCache<T>::DEFAULT_SHARD_COUNT;
+
+template <typename T>
+const size_t ShardedCache<T>::MIN_SHARD_CAPACITY;
+
+} // namespace cache
+} // namespace bundy
+
+#endif // SHARDED_CACHE_H
+
+// Local Variables:
+// mode: c++
+// End:
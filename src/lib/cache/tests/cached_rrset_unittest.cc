@@ -0,0 +1,201 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <cache/cached_rrset.h>
+#include <cache/rrset_entry.h>
+
+#include <exceptions/exceptions.h>
+
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+#include <dns/rrttl.h>
+#include <dns/rrtype.h>
+
+#include <util/unittests/wiredata.h>
+
+#include <gtest/gtest.h>
+
+#include <ctime>
+
+using namespace bundy::cache;
+using namespace bundy::dns;
+using namespace bundy::dns::rdata;
+using bundy::util::OutputBuffer;
+using bundy::util::unittests::matchWireData;
+
+namespace {
+
+const char* const SIG_TEXT =
+    "A 5 3 3600 20000101000000 20000201000000 12345 example.com. FAKEFAKE";
+
+class CachedRRsetTest : public ::testing::Test {
+protected:
+    CachedRRsetTest() :
+        now_(time(NULL)),
+        name_("www.example.com"),
+        rrset_(new RRset(name_, RRClass::IN(), RRType::MX(), RRTTL(3600))),
+        sig_rrset_(new RRset(name_, RRClass::IN(), RRType::RRSIG(),
+                             RRTTL(3600)))
+    {
+        // MX has a compressible name field, which is a good test case for
+        // rendering.
+        rrset_->addRdata(createRdata(RRType::MX(), RRClass::IN(),
+                                     "10 mail.example.com."));
+        rrset_->addRdata(createRdata(RRType::MX(), RRClass::IN(),
+                                     "20 mail2.example.com."));
+        sig_rrset_->addRdata(createRdata(RRType::RRSIG(), RRClass::IN(),
+                                         SIG_TEXT));
+    }
+
+    // Render the given RRset in a fresh renderer, after the question name
+    // so the name compression takes place.
+    void render(const AbstractRRset& rrset, MessageRenderer& renderer) {
+        renderer.writeName(name_);
+        rrset.toWire(renderer);
+    }
+
+    void checkRendering(const AbstractRRset& expected,
+                        const AbstractRRset& actual)
+    {
+        MessageRenderer expected_renderer;
+        render(expected, expected_renderer);
+        MessageRenderer actual_renderer;
+        render(actual, actual_renderer);
+        matchWireData(expected_renderer.getData(),
+                      expected_renderer.getLength(),
+                      actual_renderer.getData(), actual_renderer.getLength());
+    }
+
+    const time_t now_;
+    const Name name_;
+    RRsetPtr rrset_;
+    RRsetPtr sig_rrset_;
+};
+
+TEST_F(CachedRRsetTest, basic) {
+    const RRsetEntryPtr entry(new RRsetEntry(*rrset_,
+                                             RRSET_TRUST_ANSWER_AA));
+    const CachedRRset cached(entry, now_);
+    EXPECT_EQ(name_, cached.getName());
+    EXPECT_EQ(RRClass::IN(), cached.getClass());
+    EXPECT_EQ(RRType::MX(), cached.getType());
+    EXPECT_EQ(RRTTL(3600), cached.getTTL());
+    EXPECT_EQ(2, cached.getRdataCount());
+    EXPECT_EQ(0, cached.getRRsigDataCount());
+    EXPECT_FALSE(cached.getRRsig());
+    EXPECT_EQ(rrset_->toText(), cached.toText());
+    EXPECT_EQ(rrset_->getLength(), cached.getLength());
+    checkRendering(*rrset_, cached);
+
+    // The TTL is the remaining one at the given time.
+    const CachedRRset cached_later(entry, now_ + 600);
+    EXPECT_EQ(RRTTL(3000), cached_later.getTTL());
+    rrset_->setTTL(RRTTL(3000));
+    checkRendering(*rrset_, cached_later);
+
+    // Expired one has TTL of 0.
+    EXPECT_EQ(RRTTL(0), CachedRRset(entry, now_ + 7200).getTTL());
+}
+
+TEST_F(CachedRRsetTest, withRRSIG) {
+    rrset_->addRRsig(sig_rrset_);
+    const RRsetEntryPtr entry(new RRsetEntry(*rrset_,
+                                             RRSET_TRUST_ANSWER_AA));
+    const CachedRRset cached(entry, now_);
+    EXPECT_EQ(2, cached.getRdataCount());
+    EXPECT_EQ(1, cached.getRRsigDataCount());
+    ASSERT_TRUE(cached.getRRsig());
+    EXPECT_EQ(sig_rrset_->toText(), cached.getRRsig()->toText());
+    EXPECT_EQ(rrset_->toText(), cached.toText());
+    EXPECT_EQ(rrset_->getLength(), cached.getLength());
+    checkRendering(*rrset_, cached);
+}
+
+TEST_F(CachedRRsetTest, RRSIGRRset) {
+    // A standalone RRSIG RRset (as it's parsed in a message)
+    const RRsetEntryPtr entry(new RRsetEntry(*sig_rrset_,
+                                             RRSET_TRUST_ANSWER_AA));
+    const CachedRRset cached(entry, now_);
+    EXPECT_EQ(RRType::RRSIG(), cached.getType());
+    EXPECT_EQ(1, cached.getRdataCount());
+    EXPECT_EQ(0, cached.getRRsigDataCount());
+    EXPECT_FALSE(cached.getRRsig());
+    EXPECT_EQ(sig_rrset_->toText(), cached.toText());
+    checkRendering(*sig_rrset_, cached);
+
+    // The entry rebuilds the same RRset.
+    EXPECT_EQ(sig_rrset_->toText(), entry->getRRset()->toText());
+}
+
+TEST_F(CachedRRsetTest, truncation) {
+    const RRsetEntryPtr entry(new RRsetEntry(*rrset_,
+                                             RRSET_TRUST_ANSWER_AA));
+    const CachedRRset cached(entry, now_);
+
+    // The expected result of rendering only the first RR, which is
+    // (partly) compressed.
+    RRset first_rrset(name_, RRClass::IN(), RRType::MX(), RRTTL(3600));
+    first_rrset.addRdata(rrset_->getRdataIterator()->getCurrent());
+    MessageRenderer expected_renderer;
+    render(first_rrset, expected_renderer);
+
+    // Only room for the first RR.
+    MessageRenderer renderer;
+    renderer.setLengthLimit(expected_renderer.getLength() + 5);
+    renderer.writeName(name_);
+    EXPECT_EQ(1, cached.toWire(renderer));
+    EXPECT_TRUE(renderer.isTruncated());
+    matchWireData(expected_renderer.getData(), expected_renderer.getLength(),
+                  renderer.getData(), renderer.getLength());
+}
+
+TEST_F(CachedRRsetTest, getRRset) {
+    rrset_->addRRsig(sig_rrset_);
+    const RRsetEntry entry(*rrset_, RRSET_TRUST_ANSWER_AA);
+    const RRsetPtr rrset = entry.getRRset();
+    EXPECT_EQ(rrset_->toText(), rrset->toText());
+    ASSERT_TRUE(rrset->getRRsig());
+    EXPECT_EQ(sig_rrset_->toText(), rrset->getRRsig()->toText());
+}
+
+TEST_F(CachedRRsetTest, duplicateRdata) {
+    // Duplicate RDATA are stored only once.
+    rrset_->addRdata(createRdata(RRType::MX(), RRClass::IN(),
+                                 "10 mail.example.com."));
+    const RRsetEntryPtr entry(new RRsetEntry(*rrset_,
+                                             RRSET_TRUST_ANSWER_AA));
+    EXPECT_EQ(2, entry->getRdataCount());
+    EXPECT_EQ(2, CachedRRset(entry, now_).getRdataCount());
+}
+
+TEST_F(CachedRRsetTest, unsupported) {
+    const RRsetEntryPtr entry(new RRsetEntry(*rrset_,
+                                             RRSET_TRUST_ANSWER_AA));
+    CachedRRset cached(entry, now_);
+    OutputBuffer buffer(0);
+    EXPECT_THROW(cached.setTTL(RRTTL(0)), bundy::Unexpected);
+    EXPECT_THROW(cached.toWire(buffer), bundy::Unexpected);
+    EXPECT_THROW(cached.addRdata(createRdata(RRType::MX(), RRClass::IN(),
+                                             "30 mail3.example.com.")),
+                 bundy::Unexpected);
+    EXPECT_THROW(cached.addRRsig(sig_rrset_), bundy::Unexpected);
+    EXPECT_THROW(cached.removeRRsig(), bundy::Unexpected);
+}
+
+}
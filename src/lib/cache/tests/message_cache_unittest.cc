@@ -42,7 +42,7 @@ public:
     {}
 
     uint16_t messages_count() {
-        return message_lru_.size();
+        return message_table_.size();
     }
 };
 
@@ -56,13 +56,7 @@ public:
 
     /// \brief Remove one rrset entry from rrset cache.
     void removeRRsetEntry(Name& name, const RRType& type) {
-        const string entry_name = genCacheEntryName(name, type);
-        HashKey entry_key = HashKey(entry_name, RRClass(class_));
-        RRsetEntryPtr rrset_entry = rrset_table_.get(entry_key);
-        if (rrset_entry) {
-            rrset_lru_.remove(rrset_entry);
-            rrset_table_.remove(entry_key);
-        }
+        rrset_table_.remove(genCacheEntryName(name, type));
     }
 };
 
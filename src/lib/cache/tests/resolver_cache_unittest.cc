@@ -15,6 +15,7 @@
 #include <config.h>
 #include <string>
 #include <gtest/gtest.h>
+#include <dns/rdata.h>
 #include <dns/rrset.h>
 #include "resolver_cache.h"
 #include "cache_test_messagefromfile.h"
@@ -106,6 +107,49 @@ TEST_F(ResolverCacheTest, testLookupUnsupportedClass) {
     EXPECT_FALSE(cache->lookup(qname, RRType::SOA(), RRClass::CH()));
 }
 
+TEST_F(ResolverCacheTest, testLookupStale) {
+    const Name qname("www.example.com.");
+    RRsetPtr rrset(new RRset(qname, RRClass::IN(), RRType::A(), RRTTL(0)));
+    rrset->addRdata(rdata::createRdata(RRType::A(), RRClass::IN(),
+                                       "192.0.2.1"));
+    cache->update(rrset);
+
+    // No stale window by default
+    EXPECT_FALSE(cache->lookupStale(qname, RRType::A(), RRClass::IN()));
+
+    // The expired rrset is served with the stale TTL.
+    cache->setStaleWindow(60);
+    cache->update(rrset);
+    const RRsetPtr stale_rrset = cache->lookupStale(qname, RRType::A(),
+                                                    RRClass::IN());
+    ASSERT_TRUE(stale_rrset);
+    EXPECT_EQ(RRTTL(STALE_RRSET_TTL), stale_rrset->getTTL());
+    EXPECT_EQ(1, stale_rrset->getRdataCount());
+
+    // A valid one is returned as is.
+    rrset->setTTL(RRTTL(3600));
+    cache->update(rrset);
+    EXPECT_EQ(RRTTL(3600), cache->lookupStale(qname, RRType::A(),
+                                              RRClass::IN())->getTTL());
+
+    // Unsupported class
+    EXPECT_FALSE(cache->lookupStale(qname, RRType::A(), RRClass::CH()));
+}
+
+TEST_F(ResolverCacheTest, testIsRefreshDue) {
+    const Name qname("www.example.com.");
+    RRsetPtr rrset(new RRset(qname, RRClass::IN(), RRType::A(),
+                             RRTTL(3600)));
+    rrset->addRdata(rdata::createRdata(RRType::A(), RRClass::IN(),
+                                       "192.0.2.1"));
+    EXPECT_FALSE(cache->isRefreshDue(qname, RRType::A(), RRClass::IN(), 100));
+
+    cache->update(rrset);
+    EXPECT_FALSE(cache->isRefreshDue(qname, RRType::A(), RRClass::IN(), 10));
+    EXPECT_TRUE(cache->isRefreshDue(qname, RRType::A(), RRClass::IN(), 100));
+    EXPECT_FALSE(cache->isRefreshDue(qname, RRType::A(), RRClass::CH(), 100));
+}
+
 TEST_F(ResolverCacheTest, testLookupClosestRRset) {
     Message msg(Message::PARSE);
     messageFromFile(msg, "message_fromWire3");
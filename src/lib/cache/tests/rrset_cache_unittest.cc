@@ -95,6 +95,35 @@ TEST_F(RRsetCacheTest, update) {
     EXPECT_EQ(rrset_entry_ptr->getTrustLevel(), rrset_entry2_.getTrustLevel());
 }
 
+TEST_F(RRsetCacheTest, lookupStale) {
+    const RRType& type = RRType::A();
+    EXPECT_EQ(0, cache_.getStaleWindow());
+
+    // A valid one can be found in both ways.
+    cache_.update(rrset1_, rrset_entry1_.getTrustLevel());
+    EXPECT_TRUE(cache_.lookup(name_, type));
+    EXPECT_TRUE(cache_.lookupStale(name_, type));
+
+    // An expired one isn't found by lookupStale() without a stale window.
+    Name name_test("test.example.com.");
+    updateRRsetCache(cache_, name_test, 0);
+    EXPECT_FALSE(cache_.lookupStale(name_test, RRType::A()));
+
+    // With the stale window it's kept in the cache and can be found by
+    // lookupStale(), but not by lookup().
+    cache_.setStaleWindow(60);
+    EXPECT_EQ(60, cache_.getStaleWindow());
+    updateRRsetCache(cache_, name_test, 0);
+    EXPECT_FALSE(cache_.lookup(name_test, RRType::A()));
+    const RRsetEntryPtr entry = cache_.lookupStale(name_test, RRType::A());
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(0, entry->getTTL());
+
+    // A new rrset replaces the stale one.
+    updateRRsetCache(cache_, name_test, 20);
+    EXPECT_TRUE(cache_.lookup(name_test, RRType::A()));
+}
+
 // Test whether the lru list in rrset cache works as expected.
 TEST_F(RRsetCacheTest, cacheLruBehavior) {
     Name name1("1.example.com.");
@@ -99,5 +99,25 @@ TEST_F(RRsetEntryTest, getExpireTime){
     EXPECT_EQ(exp_time, rrset_entry.getExpireTime());
 }
 
+TEST_F(RRsetEntryTest, isRefreshDue) {
+    const time_t exp_time = rrset_entry.getExpireTime();
+    // Within the last 10% of the TTL
+    EXPECT_FALSE(rrset_entry.isRefreshDue(exp_time - TEST_TTL, 10));
+    EXPECT_FALSE(rrset_entry.isRefreshDue(exp_time - 11, 10));
+    EXPECT_TRUE(rrset_entry.isRefreshDue(exp_time - 10, 10));
+    EXPECT_TRUE(rrset_entry.isRefreshDue(exp_time - 1, 10));
+    // Expired ones are not refreshed in advance
+    EXPECT_FALSE(rrset_entry.isRefreshDue(exp_time, 10));
+    // 0% and 100% thresholds
+    EXPECT_FALSE(rrset_entry.isRefreshDue(exp_time - 1, 0));
+    EXPECT_TRUE(rrset_entry.isRefreshDue(exp_time - TEST_TTL, 100));
+
+    // An RRset with TTL of 0 is never refreshed in advance
+    RRset zero_rrset(name, RRClass::IN(), RRType::A(), RRTTL(0));
+    RRsetEntry zero_entry(zero_rrset, RRSET_TRUST_ANSWER_AA);
+    EXPECT_FALSE(zero_entry.isRefreshDue(zero_entry.getExpireTime() - 1,
+                                         100));
+}
+
 }   // namespace
 
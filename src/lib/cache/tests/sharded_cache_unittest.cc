@@ -0,0 +1,184 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <cache/sharded_cache.h>
+#include <util/threads/thread.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+
+using namespace bundy::cache;
+using bundy::util::thread::Thread;
+using boost::lexical_cast;
+using std::string;
+
+namespace {
+
+typedef boost::shared_ptr<int> IntPtr;
+
+IntPtr
+makeEntry(int value) {
+    return (IntPtr(new int(value)));
+}
+
+TEST(ShardedCacheTest, shardCount) {
+    // Small caches use a single shard, large ones the default number.
+    EXPECT_EQ(1, ShardedCache<int>(3).getShardCount());
+    EXPECT_EQ(1, ShardedCache<int>(0).getShardCount());
+    EXPECT_EQ(2, ShardedCache<int>(
+                  2 * ShardedCache<int>::MIN_SHARD_CAPACITY).getShardCount());
+    EXPECT_EQ(ShardedCache<int>::DEFAULT_SHARD_COUNT,
+              ShardedCache<int>(100000).getShardCount());
+    // Explicitly specified.
+    EXPECT_EQ(4, ShardedCache<int>(3, 4).getShardCount());
+}
+
+TEST(ShardedCacheTest, addGetRemove) {
+    ShardedCache<int> cache(100);
+    EXPECT_FALSE(cache.get("a"));
+
+    const IntPtr a = makeEntry(1);
+    cache.add("a", a);
+    EXPECT_EQ(a, cache.get("a"));
+    EXPECT_EQ(1, cache.size());
+
+    // Replace it.
+    const IntPtr a2 = makeEntry(2);
+    cache.add("a", a2);
+    EXPECT_EQ(a2, cache.get("a"));
+    EXPECT_EQ(1, cache.size());
+
+    // Removing with a different entry doesn't remove the current one.
+    EXPECT_FALSE(cache.remove("a", a));
+    EXPECT_EQ(a2, cache.get("a"));
+    EXPECT_TRUE(cache.remove("a", a2));
+    EXPECT_FALSE(cache.get("a"));
+    EXPECT_EQ(0, cache.size());
+
+    cache.add("b", makeEntry(3));
+    EXPECT_TRUE(cache.remove("b"));
+    EXPECT_FALSE(cache.remove("b"));
+    EXPECT_FALSE(cache.get("b"));
+}
+
+TEST(ShardedCacheTest, clockEviction) {
+    ShardedCache<int> cache(3, 1);
+    cache.add("1", makeEntry(1));
+    cache.add("2", makeEntry(2));
+    cache.add("3", makeEntry(3));
+    EXPECT_EQ(3, cache.size());
+
+    // "1" is referenced, so it gets a second chance and "2" is evicted.
+    EXPECT_TRUE(cache.get("1"));
+    cache.add("4", makeEntry(4));
+    EXPECT_EQ(3, cache.size());
+    EXPECT_FALSE(cache.get("2"));
+    EXPECT_TRUE(cache.get("3"));
+    EXPECT_TRUE(cache.get("4"));
+
+    // "3" and "4" are referenced, but "1" hasn't been since its flag was
+    // cleared by the previous sweep.  The hand points to "3", so "3" gets
+    // a second chance and "1" is evicted.
+    cache.add("5", makeEntry(5));
+    EXPECT_FALSE(cache.get("1"));
+    EXPECT_TRUE(cache.get("3"));
+    EXPECT_TRUE(cache.get("4"));
+    EXPECT_TRUE(cache.get("5"));
+
+    // A removed entry frees a slot without evicting anything.
+    EXPECT_TRUE(cache.remove("3"));
+    cache.add("6", makeEntry(6));
+    EXPECT_TRUE(cache.get("4"));
+    EXPECT_TRUE(cache.get("5"));
+    EXPECT_TRUE(cache.get("6"));
+}
+
+TEST(ShardedCacheTest, evictionReleasesEntry) {
+    ShardedCache<int> cache(1, 1);
+    const IntPtr a = makeEntry(1);
+    cache.add("a", a);
+    EXPECT_EQ(2, a.use_count());
+    cache.add("b", makeEntry(2));
+    EXPECT_EQ(1, a.use_count());
+    EXPECT_FALSE(cache.get("a"));
+}
+
+TEST(ShardedCacheTest, clear) {
+    // Use a single shard so the capacity is exactly known.
+    ShardedCache<int> cache(100, 1);
+    const IntPtr entry = makeEntry(0);
+    for (int i = 0; i < 100; ++i) {
+        cache.add(lexical_cast<string>(i), entry);
+    }
+    EXPECT_EQ(100, cache.size());
+    EXPECT_EQ(101, entry.use_count());
+
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+    EXPECT_EQ(1, entry.use_count());
+    EXPECT_FALSE(cache.get("0"));
+
+    // The cache is still usable with its full capacity.
+    for (int i = 100; i < 200; ++i) {
+        cache.add(lexical_cast<string>(i), entry);
+    }
+    EXPECT_EQ(100, cache.size());
+    EXPECT_TRUE(cache.get("100"));
+    EXPECT_TRUE(cache.get("199"));
+}
+
+TEST(ShardedCacheTest, capacity) {
+    // The total number of entries never exceeds the (rounded up) capacity.
+    ShardedCache<int> cache(1000);
+    for (int i = 0; i < 5000; ++i) {
+        cache.add(lexical_cast<string>(i), makeEntry(i));
+    }
+    EXPECT_GE(1000 + cache.getShardCount(), cache.size());
+    // Recently added ones are still there.
+    EXPECT_TRUE(cache.get("4999"));
+}
+
+void
+lookupAndUpdate(ShardedCache<int>* cache, int id) {
+    for (int i = 0; i < 10000; ++i) {
+        const string key = lexical_cast<string>(i % 500);
+        const IntPtr entry = cache->get(key);
+        if (!entry || i % 7 == id) {
+            cache->add(key, makeEntry(i));
+        } else if (i % 13 == id) {
+            cache->remove(key, entry);
+        }
+    }
+}
+
+TEST(ShardedCacheTest, threads) {
+    // Just a smoke test: multiple threads looking up and updating the cache
+    // concurrently shouldn't break it.
+    ShardedCache<int> cache(256);
+    Thread thread1(boost::bind(lookupAndUpdate, &cache, 1));
+    Thread thread2(boost::bind(lookupAndUpdate, &cache, 2));
+    Thread thread3(boost::bind(lookupAndUpdate, &cache, 3));
+    thread1.wait();
+    thread2.wait();
+    thread3.wait();
+    EXPECT_GE(256 + cache.getShardCount(), cache.size());
+}
+
+}
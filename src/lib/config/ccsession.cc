@@ -239,6 +239,9 @@ readOutputOptionConf(bundy::log::OutputOption& output_option,
     output_option.maxver = getValueOrDefault(output_option_el,
                                "maxver", config_data,
                                "loggers/output_options/maxver")->intValue();
+    output_option.async = getValueOrDefault(output_option_el,
+                              "async", config_data,
+                              "loggers/output_options/async")->boolValue();
 }
 
 // Reads a full 'loggers' configuration, and adds the loggers therein
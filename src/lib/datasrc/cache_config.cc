@@ -54,6 +54,32 @@ getSegmentTypeFromConf(const Element& conf) {
     }
     return (conf.get("cache-type")->stringValue());
 }
+
+size_t
+getLoadThreadsFromConf(const Element& conf) {
+    if (!conf.contains("cache-load-threads")) {
+        return (0);
+    }
+    const int64_t threads = conf.get("cache-load-threads")->intValue();
+    if (threads < 0) {
+        bundy_throw(CacheConfigError, "Negative cache-load-threads: " <<
+                    threads);
+    }
+    return (threads);
+}
+
+std::string
+getSnapshotFromConf(const Element& conf, const std::string& segment_type) {
+    if (!conf.contains("cache-snapshot")) {
+        return ("");
+    }
+    const std::string snapshot = conf.get("cache-snapshot")->stringValue();
+    if (!snapshot.empty() && segment_type != "mapped") {
+        bundy_throw(CacheConfigError, "cache-snapshot is specified for "
+                    "non mapped cache type: " << segment_type);
+    }
+    return (snapshot);
+}
 }
 
 CacheConfig::CacheConfig(const std::string& datasrc_type,
@@ -62,7 +88,9 @@ CacheConfig::CacheConfig(const std::string& datasrc_type,
                          bool allowed) :
     enabled_(allowed && getEnabledFromConf(datasrc_conf)),
     segment_type_(getSegmentTypeFromConf(datasrc_conf)),
-    datasrc_client_(datasrc_client)
+    datasrc_client_(datasrc_client),
+    load_threads_(getLoadThreadsFromConf(datasrc_conf)),
+    snapshot_file_(getSnapshotFromConf(datasrc_conf, segment_type_))
 {
     ConstElementPtr params = datasrc_conf.get("params");
     if (!params) {
@@ -133,6 +161,23 @@ createLoaderFromFile(util::MemorySegment& segment, const dns::RRClass& rrclass,
                                        old_data));
 }
 
+// Similar to createLoaderFromFile, but using a master file parser.  If the
+// parser is not started ahead or has already been used (the functor may be
+// called multiple times), a new one is created.
+memory::ZoneDataLoader*
+createLoaderFromParser(util::MemorySegment& segment,
+                       const dns::RRClass& rrclass,
+                       const dns::Name& name, const std::string& filename,
+                       memory::MasterFileParserPtr parser,
+                       memory::ZoneData* old_data)
+{
+    if (!parser || parser->isClaimed()) {
+        parser.reset(new memory::MasterFileParser(filename, name, rrclass));
+    }
+    return (new memory::ZoneDataLoader(segment, rrclass, name, parser,
+                                       old_data));
+}
+
 memory::ZoneDataLoader*
 createLoaderFromDataSource(util::MemorySegment& segment,
                            const dns::RRClass& rrclass,
@@ -148,7 +193,8 @@ createLoaderFromDataSource(util::MemorySegment& segment,
 
 memory::ZoneDataLoaderCreator
 CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
-                              const dns::Name& zone_name) const
+                              const dns::Name& zone_name,
+                              bool load_ahead) const
 {
     // First, check if the specified zone is configured to be cached.
     Zones::const_iterator found = zone_config_.find(zone_name);
@@ -158,8 +204,25 @@ CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
 
     if (!found->second.empty()) {
         // This is "MasterFiles" data source.
-        return (boost::bind(createLoaderFromFile, _1, rrclass, zone_name,
-                            found->second, _2));
+        if (load_threads_ == 0) {
+            return (boost::bind(createLoaderFromFile, _1, rrclass, zone_name,
+                                found->second, _2));
+        }
+        memory::MasterFileParserPtr parser;
+        if (load_ahead) {
+            startParsers(rrclass, found);
+            const Parsers::iterator parser_it = parsers_.find(zone_name);
+            if (parser_it != parsers_.end()) {
+                parser = parser_it->second;
+                parsers_.erase(parser_it);
+            }
+        } else {
+            // Parsers left from an interrupted full load may have read
+            // outdated files; a single zone is always loaded afresh.
+            parsers_.clear();
+        }
+        return (boost::bind(createLoaderFromParser, _1, rrclass, zone_name,
+                            found->second, parser, _2));
     }
 
     // Otherwise there must be a "source" data source (ensured by constructor)
@@ -178,6 +241,24 @@ CacheConfig::getLoaderCreator(const dns::RRClass& rrclass,
                         datasrc_client_, _2));
 }
 
+void
+CacheConfig::startParsers(const dns::RRClass& rrclass,
+                          Zones::const_iterator zone_it) const
+{
+    // Parsers for zones preceding the given one would have been skipped
+    // by the caller; stop them.
+    parsers_.erase(parsers_.begin(), parsers_.lower_bound(zone_it->first));
+
+    for (; zone_it != zone_config_.end() && parsers_.size() < load_threads_;
+         ++zone_it) {
+        if (parsers_.find(zone_it->first) == parsers_.end()) {
+            parsers_[zone_it->first].reset(
+                new memory::MasterFileParser(zone_it->second, zone_it->first,
+                                             rrclass));
+        }
+    }
+}
+
 } // namespace internal
 } // namespace datasrc
 } // namespace bundy
@@ -24,6 +24,7 @@
 #include <datasrc/memory/loader_creator.h>
 #include <datasrc/memory/zone_data.h>
 #include <datasrc/memory/zone_data_loader.h>
+#include <datasrc/memory/master_file_parser.h>
 
 #include <boost/noncopyable.hpp>
 
@@ -109,6 +110,17 @@ public:
     /// used for the cache.  It's given via the "cache-type" configuration
     /// item if defined; otherwise it defaults to "local".
     ///
+    /// The optional "cache-load-threads" configuration item specifies the
+    /// number of master files that can be parsed in separate threads (see
+    /// \c getLoaderCreator()).  It defaults to 0, meaning master files are
+    /// parsed in the loading thread; a negative value is rejected with
+    /// CacheConfigError.
+    ///
+    /// The optional "cache-snapshot" configuration item specifies the file
+    /// name of a zone table snapshot (see \c getSnapshotFile()).  It can
+    /// only be specified for the "mapped" segment type; otherwise
+    /// CacheConfigError is thrown.
+    ///
     /// \throw InvalidParameter Program error at the caller side rather than
     /// in the configuration (see above)
     /// \throw CacheConfigError There is a semantics error in the given
@@ -147,6 +159,21 @@ public:
     /// \throw None
     const std::string& getSegmentType() const { return (segment_type_); }
 
+    /// \brief Return the number of threads used to parse master files.
+    ///
+    /// \throw None
+    size_t getLoadThreads() const { return (load_threads_); }
+
+    /// \brief Return the file name of the zone table snapshot.
+    ///
+    /// If non empty, it's a mapped file built offline (e.g., by
+    /// bundy-loadzone) that can be used as the cache in the read-only mode
+    /// until the cache is reset by other means.  An empty string means no
+    /// snapshot is specified.
+    ///
+    /// \throw None
+    const std::string& getSnapshotFile() const { return (snapshot_file_); }
+
     /// \brief Return a \c LoadAction functor to load zone data into memory.
     ///
     /// This method returns an appropriate \c LoadAction functor that can be
@@ -198,12 +225,34 @@ public:
     /// source.  This shouldn't happen as long as the data source
     /// implementation meets the public API requirement.
     ///
+    /// For "MasterFiles", if the number of load threads is non-0, the
+    /// returned functor loads the zone with a \c memory::MasterFileParser,
+    /// so the master file is parsed in a separate thread, pipelined with
+    /// the insertion into the zone data.  If \c load_ahead is also true,
+    /// parsing of the master files of the zones that follow \c zname in
+    /// the iteration order (up to the number of load threads including
+    /// \c zname) starts immediately, so they are parsed concurrently while
+    /// the caller loads preceding zones one by one.  This is intended for
+    /// loading all configured zones, in which case the caller is expected
+    /// to call this method for each zone in the iteration order.  Only the
+    /// parsing happens concurrently; the zone data are still built in the
+    /// caller's thread, since the memory segment is not thread-safe.  If
+    /// \c load_ahead is false, the parsers started ahead (e.g., by a full
+    /// load that was stopped early) are discarded, and the zone is parsed
+    /// from its master file as it is at the time of the call.
+    ///
+    /// Since it may internally keep the parsers for subsequent zones, this
+    /// method is not thread safe.
+    ///
     /// \param rrclass The RR class of the zone
     /// \param zname The origin name of the zone
+    /// \param load_ahead Whether to start parsing subsequent zones (see
+    /// above).
     /// \return A \c ZoneDataLoaderCreator functor to be used to load zone
     /// data or an empty functor (see above).
     memory::ZoneDataLoaderCreator getLoaderCreator(
-        const dns::RRClass& rrclass, const dns::Name& zname) const;
+        const dns::RRClass& rrclass, const dns::Name& zname,
+        bool load_ahead = false) const;
 
     /// \brief Read only iterator type over configured cached zones.
     ///
@@ -240,6 +289,19 @@ private:
     // others it's an empty string.
     typedef std::map<dns::Name, std::string> Zones;
     Zones zone_config_;
+
+    // The number of master files parsed concurrently.
+    const size_t load_threads_;
+
+    // The file name of the zone table snapshot (empty if not specified).
+    const std::string snapshot_file_;
+
+    // Parsers started ahead of loading their zones, for load_ahead mode of
+    // getLoaderCreator().  Modified in the const method as a cache.
+    typedef std::map<dns::Name, memory::MasterFileParserPtr> Parsers;
+    mutable Parsers parsers_;
+    void startParsers(const dns::RRClass& rrclass,
+                      Zones::const_iterator zone_it) const;
 };
 }
 }
@@ -151,6 +151,24 @@ ConfigurableClientList::configure(const ConstElementPtr& config,
             memory::ZoneTableSegment& zt_segment =
                 *new_data_sources.back().ztable_segment_;
             if (!zt_segment.isWritable()) {
+                // If a snapshot of the zone table is available, we can use
+                // it until the cache is reset by other means.
+                const std::string& snapshot = cache_conf->getSnapshotFile();
+                if (!snapshot.empty()) {
+                    try {
+                        ElementPtr params = Element::createMap();
+                        params->set("mapped-file",
+                                    Element::create(snapshot));
+                        params->set("snapshot", Element::create(true));
+                        zt_segment.reset(ZoneTableSegment::READ_ONLY, params);
+                        LOG_INFO(logger, DATASRC_LIST_CACHE_SNAPSHOT).
+                            arg(datasrc_name).arg(snapshot);
+                        continue;
+                    } catch (const bundy::Exception& ex) {
+                        LOG_ERROR(logger, DATASRC_LIST_CACHE_SNAPSHOT_ERROR).
+                            arg(datasrc_name).arg(snapshot).arg(ex.what());
+                    }
+                }
                 LOG_DEBUG(logger, DBGLVL_TRACE_BASIC,
                           DATASRC_LIST_CACHE_PENDING).arg(datasrc_name);
                 continue;
@@ -165,8 +183,10 @@ ConfigurableClientList::configure(const ConstElementPtr& config,
             {
                 const Name& zname = zone_it->first;
                 try {
+                    // We load all zones in order here, so master files of
+                    // the subsequent zones can be parsed ahead.
                     const memory::ZoneDataLoaderCreator loader_creator =
-                        cache_conf->getLoaderCreator(rrclass_, zname);
+                        cache_conf->getLoaderCreator(rrclass_, zname, true);
                     // in this loop this should be always true
                     assert(loader_creator);
                     // For the initial load, we'll let the writer handle
@@ -370,8 +390,11 @@ ConfigurableClientList::getCachedZoneWriter(const Name& name,
         }
         // Note that getCacheConfig() must return non NULL in this module
         // (only tests could set it to a bogus value).
+        // catch_load_error is set on the initial load of all zones, in
+        // which case the subsequent zones can be parsed ahead.
         const memory::ZoneDataLoaderCreator loader_creator =
-            info.getCacheConfig()->getLoaderCreator(rrclass_, name);
+            info.getCacheConfig()->getLoaderCreator(rrclass_, name,
+                                                    catch_load_error);
         if (!loader_creator) {
             return (ZoneWriterPair(ZONE_NOT_CACHED, ZoneWriterPtr()));
         }
@@ -436,6 +436,12 @@ public:
     /// this method simply returns ZONE_NOT_FOUND in the first element
     /// of the pair.
     ///
+    /// \c catch_load_error is expected to be true only when loading all
+    /// zones of the data source in order (typically at initialization).
+    /// In that case, if master files are parsed in separate threads (see
+    /// \c CacheConfig::getLoaderCreator()), the master files of subsequent
+    /// zones start to be parsed on this call.
+    ///
     /// \param zone The origin of the zone to load.
     /// \param catch_load_errors Whether to make the zone writer catch
     /// load errors (see \c ZoneWriter constructor documentation).
@@ -0,0 +1,233 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/master_file_parser.h>
+#include <datasrc/master_loader_callbacks.h>
+#include <datasrc/exceptions.h>
+
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <dns/master_loader.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrcollator.h>
+
+#include <exceptions/exceptions.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <deque>
+
+using namespace bundy::dns;
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+namespace {
+// Thrown from the RRset callback to unwind the master loader when the
+// parser is stopped.  Intentionally not derived from any exception the
+// loader might catch.
+struct ParserStopped {};
+}
+
+struct MasterFileParser::ParserImpl {
+    ParserImpl(const std::string& zone_file, const Name& zone_name,
+               const RRClass& rrclass, size_t batch_size,
+               size_t queue_size) :
+        zone_file_(zone_file), zone_name_(zone_name), rrclass_(rrclass),
+        batch_size_(batch_size == 0 ? 1 : batch_size),
+        queue_size_(queue_size == 0 ? 1 : queue_size),
+        done_(false), stopped_(false), load_error_(false), load_ok_(true)
+    {
+        current_.reserve(batch_size_);
+    }
+
+    // The main routine of the parser thread.
+    void run();
+
+    // Callback for the RRCollator.
+    void addRRset(const RRsetPtr& rrset) {
+        current_.push_back(rrset);
+        if (current_.size() >= batch_size_) {
+            pushBatch();
+        }
+    }
+
+    // Pass the current batch to the consumer, waiting for room in the queue
+    // if necessary.
+    void pushBatch();
+
+    // Mark the end of the data (possibly with an error), and wake up the
+    // consumer.
+    void finish(const std::string& error, bool load_error);
+
+    const std::string zone_file_;
+    const Name zone_name_;
+    const RRClass rrclass_;
+    const size_t batch_size_;
+    const size_t queue_size_;
+
+    // Only used by the parser thread.
+    RRsetBatch current_;
+
+    // Shared with the consumer; protected by mutex_.
+    Mutex mutex_;
+    CondVar not_empty_;         // consumer waits on this
+    CondVar not_full_;          // parser waits on this
+    std::deque<RRsetBatch> queue_;
+    bool done_;
+    bool stopped_;
+    std::string error_;
+    bool load_error_;           // error_ is a master file error
+
+    bool load_ok_;              // we don't use it; only need a placeholder
+
+    // Created last; the thread starts running immediately.
+    boost::scoped_ptr<Thread> thread_;
+};
+
+void
+MasterFileParser::ParserImpl::run() {
+    try {
+        RRCollator collator(boost::bind(&ParserImpl::addRRset, this, _1));
+        MasterLoader loader(zone_file_.c_str(), zone_name_, rrclass_,
+                            createMasterLoaderCallbacks(zone_name_, rrclass_,
+                                                        &load_ok_),
+                            collator.getCallback());
+        loader.load();
+        collator.flush();
+        if (!current_.empty()) {
+            pushBatch();
+        }
+        finish("", false);
+    } catch (const ParserStopped&) {
+        // The consumer is gone; nothing more to do.
+    } catch (const MasterLoaderError& ex) {
+        finish(ex.what(), true);
+    } catch (const std::exception& ex) {
+        finish(ex.what(), false);
+    } catch (...) {
+        finish("unknown error", false);
+    }
+}
+
+void
+MasterFileParser::ParserImpl::pushBatch() {
+    Mutex::Locker locker(mutex_);
+    while (queue_.size() >= queue_size_ && !stopped_) {
+        not_full_.wait(mutex_);
+    }
+    if (stopped_) {
+        throw ParserStopped();
+    }
+    queue_.push_back(RRsetBatch());
+    queue_.back().swap(current_);
+    current_.reserve(batch_size_);
+    not_empty_.signal();
+}
+
+void
+MasterFileParser::ParserImpl::finish(const std::string& error,
+                                     bool load_error)
+{
+    Mutex::Locker locker(mutex_);
+    done_ = true;
+    error_ = error;
+    load_error_ = load_error;
+    not_empty_.signal();
+}
+
+MasterFileParser::MasterFileParser(const std::string& zone_file,
+                                   const Name& zone_name,
+                                   const RRClass& rrclass,
+                                   size_t batch_size, size_t queue_size) :
+    impl_(new ParserImpl(zone_file, zone_name, rrclass, batch_size,
+                         queue_size)),
+    claimed_(false)
+{
+    try {
+        impl_->thread_.reset(new Thread(boost::bind(&ParserImpl::run,
+                                                    impl_)));
+    } catch (...) {
+        delete impl_;
+        throw;
+    }
+}
+
+MasterFileParser::~MasterFileParser() {
+    {
+        Mutex::Locker locker(impl_->mutex_);
+        impl_->stopped_ = true;
+        impl_->not_full_.signal();
+    }
+    impl_->thread_->wait();
+    delete impl_;
+}
+
+const std::string&
+MasterFileParser::getZoneFile() const {
+    return (impl_->zone_file_);
+}
+
+const Name&
+MasterFileParser::getZoneName() const {
+    return (impl_->zone_name_);
+}
+
+const RRClass&
+MasterFileParser::getClass() const {
+    return (impl_->rrclass_);
+}
+
+bool
+MasterFileParser::claim() {
+    if (claimed_) {
+        return (false);
+    }
+    claimed_ = true;
+    return (true);
+}
+
+bool
+MasterFileParser::getNextBatch(RRsetBatch& batch) {
+    batch.clear();
+    Mutex::Locker locker(impl_->mutex_);
+    while (impl_->queue_.empty() && !impl_->done_) {
+        impl_->not_empty_.wait(impl_->mutex_);
+    }
+    if (!impl_->queue_.empty()) {
+        batch.swap(impl_->queue_.front());
+        impl_->queue_.pop_front();
+        impl_->not_full_.signal();
+        return (true);
+    }
+    if (!impl_->error_.empty()) {
+        if (impl_->load_error_) {
+            bundy_throw(ZoneLoaderException, impl_->error_);
+        }
+        bundy_throw(Unexpected, "failed to parse master file " <<
+                    impl_->zone_file_ << ": " << impl_->error_);
+    }
+    return (false);
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
@@ -0,0 +1,140 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_MASTER_FILE_PARSER_H
+#define DATASRC_MEMORY_MASTER_FILE_PARSER_H 1
+
+#include <dns/dns_fwd.h>
+#include <dns/rrset.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+/// \brief Parse a zone master file in a separate thread.
+///
+/// Lexing the master file and building RRsets from the text is the most
+/// expensive part of loading a zone from a file, and it doesn't involve
+/// the memory segment at all.  This class runs that part in a thread of
+/// its own, from construction, so it proceeds ahead of (and concurrently
+/// with) the insertion of the RRsets into the zone data.  The consumer
+/// (normally a \c ZoneDataLoader) takes the parsed RRsets in batches with
+/// \c getNextBatch().
+///
+/// The parsed RRsets are passed through a bounded queue, so the parser
+/// doesn't consume an unlimited amount of memory if it's much faster than
+/// the consumer (or if nobody consumes the data); it simply waits until
+/// there's room in the queue.  Destructing the object stops the parser
+/// and waits for the thread to terminate.
+///
+/// The RRsets are the same as those the \c MasterFileLoader would pass to
+/// the updater, i.e., collated by \c dns::RRCollator.  A master file error
+/// stops the parsing, and is reported by \c getNextBatch() after all the
+/// RRsets parsed before it.
+///
+/// Apart from the thread internal to the object, an object of this class
+/// is expected to be used by a single thread (e.g., only one thread
+/// should call \c getNextBatch()).
+class MasterFileParser : boost::noncopyable {
+public:
+    /// \brief A sequence of parsed RRsets.
+    typedef std::vector<dns::ConstRRsetPtr> RRsetBatch;
+
+    /// \brief The default maximum number of RRsets in a batch.
+    static const size_t DEFAULT_BATCH_SIZE = 512;
+
+    /// \brief The default maximum number of batches in the queue.
+    static const size_t DEFAULT_QUEUE_SIZE = 16;
+
+    /// \brief Constructor.
+    ///
+    /// This starts the parser thread.
+    ///
+    /// \throw bundy::InvalidOperation Creating the thread fails.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param zone_file The master file of the zone.
+    /// \param zone_name The origin name of the zone.
+    /// \param rrclass The RR class of the zone.
+    /// \param batch_size The maximum number of RRsets in a batch.
+    /// \param queue_size The maximum number of batches parsed ahead.
+    MasterFileParser(const std::string& zone_file,
+                     const dns::Name& zone_name,
+                     const dns::RRClass& rrclass,
+                     size_t batch_size = DEFAULT_BATCH_SIZE,
+                     size_t queue_size = DEFAULT_QUEUE_SIZE);
+
+    /// \brief Destructor.
+    ///
+    /// Stops the parser if it's still running and waits for the thread.
+    ~MasterFileParser();
+
+    /// \brief Return the master file name.
+    const std::string& getZoneFile() const;
+
+    /// \brief Return the origin name of the zone.
+    const dns::Name& getZoneName() const;
+
+    /// \brief Return the RR class of the zone.
+    const dns::RRClass& getClass() const;
+
+    /// \brief Mark the parser as used by a consumer.
+    ///
+    /// The parsed data can be consumed only once.  A consumer calls this
+    /// method first to make sure nobody else has used (or is using) the
+    /// data.
+    ///
+    /// \throw none
+    /// \return true if this is the first call; false otherwise.
+    bool claim();
+
+    /// \brief Return whether \c claim() has been called.
+    bool isClaimed() const { return (claimed_); }
+
+    /// \brief Take the next batch of parsed RRsets.
+    ///
+    /// It waits until the parser has a batch ready (or completes) if
+    /// necessary.  The passed \c batch is replaced with the new one.
+    ///
+    /// \throw ZoneLoaderException The master file has an error.
+    /// \throw bundy::Unexpected The parser failed for other reasons.
+    ///
+    /// \param batch Placeholder for the RRsets.
+    /// \return true if a (non-empty) batch is returned; false if the
+    /// parsing is completed and all RRsets have been taken.
+    bool getNextBatch(RRsetBatch& batch);
+
+private:
+    struct ParserImpl;
+    ParserImpl* impl_;
+    bool claimed_;
+};
+
+typedef boost::shared_ptr<MasterFileParser> MasterFileParserPtr;
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_MASTER_FILE_PARSER_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -30,6 +30,8 @@
 #include <dns/rdataclass.h>
 #include <dns/rrclass.h>
 
+#include <util/arena.h>
+
 #include <utility>
 
 using namespace bundy::dns;
@@ -72,7 +74,10 @@ InMemoryClient::findZone(const bundy::dns::Name& zone_name) const {
 
     ZoneFinderPtr finder;
     if (result.code != result::NOTFOUND && result.zone_data) {
-        finder.reset(new InMemoryZoneFinder(*result.zone_data, getClass()));
+        // A finder is usually created for each query, so it's placed in
+        // the arena of the thread if it's set.
+        finder = util::createShared<InMemoryZoneFinder>(*result.zone_data,
+                                                        getClass());
     }
 
     return (DataSourceClient::FindResult(result.code, finder,
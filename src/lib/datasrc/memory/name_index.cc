@@ -0,0 +1,236 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/name_index.h>
+#include <datasrc/memory/rdataset.h>
+
+#include <dns/rrtype.h>
+
+#include <cassert>
+#include <new>                  // for the placement new
+
+using namespace bundy::dns;
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+namespace {
+uint32_t
+getNameHash(const LabelSequence& name) {
+    return (name.getFullHash(false, 0));
+}
+
+// Whether the node can be returned from the index, i.e., it has data and an
+// exact match search for its name in the tree wouldn't be affected by a
+// zone cut or DNAME.
+bool
+isIndexable(const ZoneNode& node) {
+    if (node.isEmpty()) {
+        return (false);
+    }
+    for (const ZoneNode* upper = node.getUpperNode();
+         upper != NULL;
+         upper = upper->getUpperNode())
+    {
+        // The flag isn't reset when the NS or DNAME is removed, so the
+        // data is checked like the callback of the zone finder does.
+        if (upper->getFlag(ZoneNode::FLAG_CALLBACK) &&
+            (RdataSet::find(upper->getData(), RRType::DNAME()) != NULL ||
+             RdataSet::find(upper->getData(), RRType::NS()) != NULL)) {
+            return (false);
+        }
+    }
+    return (true);
+}
+
+// Check if the (absolute) name is the name of the node.  We compare the
+// labels of the node and its upper nodes with the corresponding part of
+// the name, so we don't have to build the absolute labels of the node.
+bool
+matchNode(const ZoneNode* node, LabelSequence name) {
+    while (true) {
+        const LabelSequence node_labels(node->getLabels());
+        const size_t node_count = node_labels.getLabelCount();
+        const size_t name_count = name.getLabelCount();
+        if (node_count > name_count) {
+            return (false);
+        }
+        LabelSequence name_labels(name);
+        if (node_count < name_count) {
+            name_labels.stripRight(name_count - node_count);
+        }
+        if (!name_labels.equals(node_labels)) {
+            return (false);
+        }
+        node = node->getUpperNode();
+        if (node == NULL || node_count == name_count) {
+            return (node == NULL && node_count == name_count);
+        }
+        name.stripLeft(node_count);
+    }
+}
+
+// The size of the table for the given number of nodes: a power of 2 that
+// keeps the load factor 0.5 or lower.
+uint32_t
+getMask(size_t node_count) {
+    uint32_t mask = 1;
+    while (mask < node_count * 2) {
+        mask = (mask << 1) | 1;
+    }
+    return (mask);
+}
+}
+
+NameIndex::NameIndex(uint32_t mask) :
+    mask_(mask), name_count_(0)
+{
+    Entry* const entries = getEntries();
+    for (uint32_t i = 0; i <= mask_; ++i) {
+        new(&entries[i]) Entry;
+    }
+}
+
+NameIndex*
+NameIndex::create(util::MemorySegment& mem_sgmt, const ZoneTree& tree,
+                  const ZoneNode& origin_node)
+{
+    // Empty nodes and nodes under zone cuts are not stored, so this is an
+    // upper bound of the number of entries.
+    const uint32_t mask = getMask(tree.getNodeCount());
+    void* p = mem_sgmt.allocate(getAllocSize(mask));
+    NameIndex* const index = new(p) NameIndex(mask);
+
+    // Iterate over all nodes of the zone, starting at the origin.
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    ZoneChain chain;
+    const ZoneNode* node = NULL;
+    const ZoneTree::Result result =
+        tree.find<void*>(origin_node.getAbsoluteLabels(labels_buf), &node,
+                         chain, NULL, NULL);
+    assert(result == ZoneTree::EXACTMATCH && node == &origin_node);
+    while (node != NULL) {
+        if (isIndexable(*node)) {
+            index->insert(getNameHash(node->getAbsoluteLabels(labels_buf)),
+                          node);
+        }
+        node = tree.nextNode(chain);
+    }
+    return (index);
+}
+
+void
+NameIndex::destroy(util::MemorySegment& mem_sgmt, NameIndex* index) {
+    const size_t size = getAllocSize(index->mask_);
+    index->~NameIndex();
+    mem_sgmt.deallocate(index, size);
+}
+
+NameIndex*
+NameIndex::createLarger(util::MemorySegment& mem_sgmt, const NameIndex& index)
+{
+    const uint32_t mask = getMask(index.name_count_ * 2 + 1);
+    void* p = mem_sgmt.allocate(getAllocSize(mask));
+    NameIndex* const larger = new(p) NameIndex(mask);
+    const Entry* const entries = index.getEntries();
+    for (uint32_t i = 0; i <= index.mask_; ++i) {
+        if (entries[i].node_) {
+            larger->insert(entries[i].hash_, entries[i].node_.get());
+        }
+    }
+    return (larger);
+}
+
+bool
+NameIndex::add(const ZoneNode& node) {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const uint32_t hash = getNameHash(node.getAbsoluteLabels(labels_buf));
+    const Entry* const entries = getEntries();
+    for (uint32_t i = hash & mask_; entries[i].node_; i = (i + 1) & mask_) {
+        if (entries[i].node_.get() == &node) {
+            return (true);
+        }
+    }
+    // Keep the load factor 0.5 or lower.
+    if ((name_count_ + 1) * 2 > mask_ + 1) {
+        return (false);
+    }
+    insert(hash, &node);
+    return (true);
+}
+
+void
+NameIndex::remove(const ZoneNode& node) {
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    const uint32_t hash = getNameHash(node.getAbsoluteLabels(labels_buf));
+    Entry* const entries = getEntries();
+    uint32_t i = hash & mask_;
+    while (entries[i].node_.get() != &node) {
+        if (!entries[i].node_) {
+            return;
+        }
+        i = (i + 1) & mask_;
+    }
+
+    // Shift back the following entries of the cluster that can't be
+    // reached from their home position any more, so no probe stops at the
+    // hole.
+    for (uint32_t j = (i + 1) & mask_; entries[j].node_;
+         j = (j + 1) & mask_) {
+        const uint32_t home = entries[j].hash_ & mask_;
+        // Whether home is cyclically in (i, j]: the entry stays.
+        const bool reachable = (i <= j) ? (i < home && home <= j) :
+            (i < home || home <= j);
+        if (!reachable) {
+            entries[i] = entries[j];
+            i = j;
+        }
+    }
+    entries[i].hash_ = 0;
+    entries[i].node_ = NULL;
+    --name_count_;
+}
+
+void
+NameIndex::insert(uint32_t hash, const ZoneNode* node) {
+    Entry* const entries = getEntries();
+    uint32_t i = hash & mask_;
+    while (entries[i].node_) {
+        i = (i + 1) & mask_;
+    }
+    entries[i].hash_ = hash;
+    entries[i].node_ = node;
+    ++name_count_;
+}
+
+const ZoneNode*
+NameIndex::find(const LabelSequence& name) const {
+    const uint32_t hash = getNameHash(name);
+    const Entry* const entries = getEntries();
+    // The table always has free entries, so this loop terminates.
+    for (uint32_t i = hash & mask_; entries[i].node_; i = (i + 1) & mask_) {
+        if (entries[i].hash_ == hash &&
+            matchNode(entries[i].node_.get(), name)) {
+            // The node may have changed since it was added.
+            const ZoneNode* const node = entries[i].node_.get();
+            return (isIndexable(*node) ? node : NULL);
+        }
+    }
+    return (NULL);
+}
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
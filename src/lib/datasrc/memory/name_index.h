@@ -0,0 +1,170 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DATASRC_MEMORY_NAME_INDEX_H
+#define DATASRC_MEMORY_NAME_INDEX_H 1
+
+#include <util/memory_segment.h>
+
+#include <dns/labelsequence.h>
+
+#include <datasrc/memory/zone_data.h>
+
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace datasrc {
+namespace memory {
+
+/// \brief Hash index of the owner names of a zone.
+///
+/// This class provides a shortcut for \c ZoneTree::find() when the
+/// searched name exactly matches an existing name of the zone.  It's an
+/// open-addressing hash table (with linear probing) that maps the full
+/// owner names of zone nodes to the nodes, so an exact match can be
+/// identified with a hash calculation and a few comparisons instead of
+/// the label-by-label descent through the tree.
+///
+/// \c find() only returns nodes for which the tree search would return an
+/// exact match without any special handling: those that have some data and
+/// are not under a zone cut or a DNAME (i.e., no upper node has the
+/// \c ZoneNode::FLAG_CALLBACK flag).  For any other name, including
+/// wildcard matches, \c find() simply fails, and the caller is expected to
+/// fall back to the tree search.  These conditions are checked when the
+/// node is found, so the index may hold other nodes too: \c create() only
+/// stores the nodes that meet them at the time, but \c add() stores any.
+///
+/// \c ZoneData keeps its index up to date when its tree is modified, with
+/// \c add() and \c remove(), so an incremental update of the zone doesn't
+/// need to rebuild it.  The loader builds it once the zone is completely
+/// loaded, if the zone data has none.
+///
+/// Like \c ZoneData, an object of this class is allocated in a
+/// \c MemorySegment together with the entries of the table, and node
+/// references are stored as offset pointers so it can be placed in a
+/// shared memory region.
+class NameIndex : boost::noncopyable {
+public:
+    /// \brief Allocate and construct \c NameIndex for a zone tree.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.  Nothing is allocated in that case.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt A \c MemorySegment from which memory for the new
+    /// \c NameIndex is allocated.
+    /// \param tree The zone tree to be indexed.
+    /// \param origin_node The origin node of the zone in \c tree.
+    static NameIndex* create(util::MemorySegment& mem_sgmt,
+                             const ZoneTree& tree,
+                             const ZoneNode& origin_node);
+
+    /// \brief Destruct and deallocate \c NameIndex.
+    ///
+    /// \throw none
+    ///
+    /// \param mem_sgmt The \c MemorySegment that allocated memory for
+    /// \c index.
+    /// \param index A non-NULL pointer to a valid NameIndex object
+    /// that was originally created by the \c create() method.
+    static void destroy(util::MemorySegment& mem_sgmt, NameIndex* index);
+
+    /// \brief Allocate and construct a larger copy of \c NameIndex.
+    ///
+    /// This is used when \c add() fails because the table is full.  The
+    /// copy can hold at least as many names again.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.  Nothing is allocated in that case.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt A \c MemorySegment from which memory for the new
+    /// \c NameIndex is allocated.
+    /// \param index The index to be copied.
+    static NameIndex* createLarger(util::MemorySegment& mem_sgmt,
+                                   const NameIndex& index);
+
+    /// \brief Add a node of the tree.
+    ///
+    /// Nothing is done if the node is already in the index.
+    ///
+    /// \throw none
+    ///
+    /// \param node The node.
+    /// \return false if the table is full, and the node wasn't added;
+    /// true otherwise.
+    bool add(const ZoneNode& node);
+
+    /// \brief Remove a node of the tree.
+    ///
+    /// This must be called before the node is removed from the tree.
+    /// Nothing is done if the node isn't in the index.
+    ///
+    /// \throw none
+    ///
+    /// \param node The node.
+    void remove(const ZoneNode& node);
+
+    /// \brief Find the node of the given name.
+    ///
+    /// \throw none
+    ///
+    /// \param name An absolute label sequence of the name to be found.
+    /// \return The node of the name if it's in the index; NULL otherwise.
+    const ZoneNode* find(const dns::LabelSequence& name) const;
+
+    /// \brief Return the number of names stored in the index.
+    ///
+    /// \throw none
+    size_t getNameCount() const { return (name_count_); }
+
+private:
+    struct Entry {
+        Entry() : hash_(0) {}
+        uint32_t hash_;
+        boost::interprocess::offset_ptr<const ZoneNode> node_;
+    };
+
+    // The constructor is hidden as private; see create().
+    NameIndex(uint32_t mask);
+
+    static size_t getAllocSize(uint32_t mask) {
+        return (sizeof(NameIndex) + sizeof(Entry) * (mask + 1));
+    }
+
+    void insert(uint32_t hash, const ZoneNode* node);
+
+    const Entry* getEntries() const {
+        return (reinterpret_cast<const Entry*>(this + 1));
+    }
+    Entry* getEntries() {
+        return (reinterpret_cast<Entry*>(this + 1));
+    }
+
+    const uint32_t mask_;
+    uint32_t name_count_;
+};
+
+} // namespace memory
+} // namespace datasrc
+} // namespace bundy
+
+#endif // DATASRC_MEMORY_NAME_INDEX_H
+
+// Local Variables:
+// mode: c++
+// End:
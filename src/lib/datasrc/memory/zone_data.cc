@@ -23,6 +23,7 @@
 #include "rdataset.h"
 #include "rdata_serialization.h"
 #include "zone_data.h"
+#include "name_index.h"
 #include "segment_object_holder.h"
 
 #include <boost/bind.hpp>
@@ -186,7 +187,7 @@ setTTLInNetOrder(uint32_t val, uint32_t* result) {
 }
 
 ZoneData::ZoneData(ZoneTree* zone_tree, ZoneNode* origin_node) :
-    zone_tree_(zone_tree), origin_node_(origin_node),
+    zone_tree_(zone_tree), origin_node_(origin_node), name_index_(NULL),
     min_ttl_(0)          // tentatively set to silence static checkers
 {
     setTTLInNetOrder(RRTTL::MAX_TTL().getValue(), &min_ttl_);
@@ -223,6 +224,7 @@ void
 ZoneData::destroy(util::MemorySegment& mem_sgmt, ZoneData* zone_data,
                   RRClass zone_class)
 {
+    zone_data->clearNameIndex(mem_sgmt);
     ZoneTree::destroy(mem_sgmt, zone_data->zone_tree_.get(),
                       boost::bind(rdataSetDeleter, zone_class, &mem_sgmt,
                                   _1));
@@ -241,6 +243,19 @@ ZoneData::insertName(util::MemorySegment& mem_sgmt, const Name& name,
     // This should be ensured by the API:
     assert((result == ZoneTree::SUCCESS ||
             result == ZoneTree::ALREADYEXISTS) && node != NULL);
+
+    // Keep the name index up to date.  The node is usually empty yet, but
+    // the index checks that when it's found.  (An existing node may not be
+    // in the index, so it's added too.)  If the segment grows while the
+    // index is enlarged, the caller retries and the name is found in the
+    // tree this time.
+    if (name_index_ && !name_index_->add(**node)) {
+        NameIndex* const index = NameIndex::createLarger(mem_sgmt,
+                                                         *name_index_);
+        NameIndex::destroy(mem_sgmt, name_index_.get());
+        name_index_ = index;
+        name_index_->add(**node);
+    }
 }
 
 ZoneNode*
@@ -265,6 +280,15 @@ ZoneData::removeNode(util::MemorySegment& mem_sgmt, ZoneNode* node) {
     if (node == getOriginNode()) {
         return;
     }
+    // The tree also removes the empty upper nodes, which must not stay in
+    // the name index either.
+    if (name_index_) {
+        for (const ZoneNode* upper = node;
+             upper != NULL && upper->isEmpty();
+             upper = upper->getUpperNode()) {
+            name_index_->remove(*upper);
+        }
+    }
     zone_tree_->remove(mem_sgmt, node, nullDeleter);
 }
 
@@ -273,6 +297,20 @@ ZoneData::setMinTTL(uint32_t min_ttl_val) {
     setTTLInNetOrder(min_ttl_val, &min_ttl_);
 }
 
+void
+ZoneData::buildNameIndex(util::MemorySegment& mem_sgmt) {
+    clearNameIndex(mem_sgmt);
+    name_index_ = NameIndex::create(mem_sgmt, *zone_tree_, *origin_node_);
+}
+
+void
+ZoneData::clearNameIndex(util::MemorySegment& mem_sgmt) {
+    if (name_index_) {
+        NameIndex::destroy(mem_sgmt, name_index_.get());
+        name_index_ = NULL;
+    }
+}
+
 } // namespace memory
 } // namespace datasrc
 } // datasrc isc
@@ -45,6 +45,8 @@ typedef DomainTree<RdataSet> ZoneTree;
 typedef DomainTreeNode<RdataSet> ZoneNode;
 typedef DomainTreeNodeChain<RdataSet> ZoneChain;
 
+class NameIndex;
+
 /// \brief NSEC3 data for a DNS zone.
 ///
 /// This class encapsulates a set of NSEC3 related data for a zone
@@ -355,6 +357,13 @@ private:
 /// because we won't have to change the application code when we implement
 /// the future separation.
 ///
+/// Another type of meta data is an optional \c NameIndex, which maps
+/// owner names to the nodes of the tree for faster exact match search.
+/// It's built by \c buildNameIndex(), normally when the zone has been
+/// completely loaded, and kept up to date when the tree is modified via
+/// \c insertName() or \c removeNode().  It can be retrieved by
+/// \c getNameIndex().
+///
 /// One last type of meta data is the zone's "minimum" TTL.  It's expected
 /// to be a shortcut copy of the minimum field of the zone's SOA RDATA,
 /// and is expected to be used to create an SOA RR for a negative response,
@@ -548,6 +557,15 @@ public:
     /// \throw none
     const NSEC3Data* getNSEC3Data() const { return (nsec3_data_.get()); }
 
+    /// \brief Return the name index of the zone.
+    ///
+    /// This method returns the \c NameIndex built by the last call to
+    /// \c buildNameIndex() (and updated since), or NULL if it's never been
+    /// called.
+    ///
+    /// \throw none
+    const NameIndex* getNameIndex() const { return (name_index_.get()); }
+
     /// \brief Return a pointer to the zone's minimum TTL data.
     ///
     /// The returned pointer points to a memory region that is valid at least
@@ -575,6 +593,9 @@ public:
     //@{
     /// \brief Insert a name to the zone.
     ///
+    /// This method also adds the node to the name index of the zone, if
+    /// any.
+    ///
     /// It allocates resource for the given name in the internal storage
     /// for zone data, and returns an access point to it in the form of
     /// \c ZoneNode pointer via the given \c node variable.  If the name
@@ -630,6 +651,9 @@ public:
 
     /// \brief Remove the given node from the zone.
     ///
+    /// This method also removes the node from the name index of the zone,
+    /// if any.
+    ///
     /// The caller is responsible for ensuring that the node belong to
     /// the \c ZoneData.  \c node must be empty, i.e, must not have data.
     /// Unless given an invalid parameter, this method is exception free.
@@ -709,12 +733,34 @@ public:
     /// \param min_ttl_val The minimum TTL value as unsigned 32-bit integer
     /// in the host byte order.
     void setMinTTL(uint32_t min_ttl_val);
+
+    /// \brief Build the name index of the zone.
+    ///
+    /// This method creates a \c NameIndex for the current content of the
+    /// tree, replacing any existing one.  It's expected to be called once
+    /// the zone has been completely loaded; later updates keep it up to
+    /// date.
+    ///
+    /// If \c util::MemorySegmentGrown is thrown, the zone data may have been
+    /// relocated, and the zone is left without a name index.  The caller
+    /// can retry with the new address of the zone data.
+    ///
+    /// \throw util::MemorySegmentGrown The memory segment has grown, possibly
+    ///     relocating data.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param mem_sgmt Memory segment in which the zone data was allocated.
+    void buildNameIndex(util::MemorySegment& mem_sgmt);
     //@}
 
 private:
+    // Discard the name index, if any.
+    void clearNameIndex(util::MemorySegment& mem_sgmt);
+
     const boost::interprocess::offset_ptr<ZoneTree> zone_tree_;
     const boost::interprocess::offset_ptr<ZoneNode> origin_node_;
     boost::interprocess::offset_ptr<NSEC3Data> nsec3_data_;
+    boost::interprocess::offset_ptr<NameIndex> name_index_;
     uint32_t min_ttl_;
 };
 
@@ -14,6 +14,7 @@
 
 #include <datasrc/master_loader_callbacks.h>
 #include <datasrc/memory/zone_data_loader.h>
+#include <datasrc/memory/master_file_parser.h>
 #include <datasrc/memory/zone_data_updater.h>
 #include <datasrc/memory/logger.h>
 #include <datasrc/memory/segment_object_holder.h>
@@ -397,6 +398,16 @@ ZoneDataLoader::ZoneDataLoaderImpl::finishUpdate() {
         arg(zone_name_).arg(rrclass_).arg(new_serial->getValue()).
         arg(loaded_data->isSigned() ? " (DNSSEC signed)" : "");
 
+    // Now that the zone is complete, build the name index for faster exact
+    // match lookups, unless the zone data is updated in place and already
+    // has one (it's kept up to date).  If the segment grows the zone data
+    // may be relocated; the holder keeps track of it so we can simply retry.
+    while (data_holder_->get()->getNameIndex() == NULL) {
+        try {
+            data_holder_->get()->buildNameIndex(mem_sgmt_);
+        } catch (const util::MemorySegmentGrown&) {}
+    }
+
     loaded_data_ = data_holder_->release();
 }
 
@@ -486,6 +497,44 @@ private:
     boost::scoped_ptr<dns::MasterLoader> master_loader_;
 };
 
+// Master-file based loader implementation, taking the RRsets parsed by a
+// MasterFileParser in its own thread.  Only the insertion into the zone data
+// happens in the caller's thread, so it's pipelined with the parsing.
+class PipelinedFileLoader : public ZoneDataLoader::ZoneDataLoaderImpl {
+public:
+    PipelinedFileLoader(util::MemorySegment& mem_sgmt,
+                        const dns::RRClass& rrclass,
+                        const dns::Name& zone_name,
+                        const MasterFileParserPtr& parser,
+                        ZoneData* old_data) :
+        ZoneDataLoader::ZoneDataLoaderImpl(mem_sgmt, rrclass, zone_name,
+                                           old_data, NULL),
+        parser_(parser), batch_pos_(0)
+    {}
+    virtual ~PipelinedFileLoader() {}
+    virtual bool isDataReused() const { return (false); }
+
+protected:
+    virtual bool updateRRsets(size_t count_limit) {
+        for (size_t count = 0; count < count_limit; ++count) {
+            if (batch_pos_ == batch_.size()) {
+                batch_pos_ = 0;
+                if (!parser_->getNextBatch(batch_)) {
+                    return (true);
+                }
+            }
+            update_helper_->updateFromLoad(batch_[batch_pos_++],
+                                           ZoneDataUpdaterHelper::ADD);
+        }
+        return (false);
+    }
+
+private:
+    const MasterFileParserPtr parser_;
+    MasterFileParser::RRsetBatch batch_;
+    size_t batch_pos_;          // next RRset to be added in batch_
+};
+
 // Zone iterator (of a data source) based loader implementation.
 class IteratorLoader : public ZoneDataLoader::ZoneDataLoaderImpl {
 public:
@@ -686,6 +735,34 @@ ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                                  old_data);
 }
 
+ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
+                               const dns::RRClass& rrclass,
+                               const dns::Name& zone_name,
+                               const MasterFileParserPtr& parser,
+                               ZoneData* old_data) :
+    impl_(NULL)
+{
+    if (!parser) {
+        bundy_throw(InvalidParameter, "null master file parser is given");
+    }
+    if (parser->getZoneName() != zone_name ||
+        parser->getClass() != rrclass) {
+        bundy_throw(BadValue, "zone data loader is given a master file "
+                    "parser for a different zone: " <<
+                    parser->getZoneName() << "/" << parser->getClass() <<
+                    ", expecting " << zone_name << "/" << rrclass);
+    }
+    if (!parser->claim()) {
+        bundy_throw(InvalidOperation, "master file parser for " <<
+                    zone_name << "/" << rrclass << " is already used");
+    }
+    LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_LOAD_FROM_FILE).
+        arg(zone_name).arg(rrclass).arg(parser->getZoneFile());
+
+    impl_ = new PipelinedFileLoader(mem_sgmt, rrclass, zone_name, parser,
+                                    old_data);
+}
+
 ZoneDataLoader::ZoneDataLoader(util::MemorySegment& mem_sgmt,
                                const dns::RRClass& rrclass,
                                const dns::Name& zone_name,
@@ -17,6 +17,7 @@
 
 #include <datasrc/exceptions.h>
 #include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/master_file_parser.h>
 #include <datasrc/zone_iterator.h>
 #include <dns/dns_fwd.h>
 #include <util/memory_segment.h>
@@ -64,6 +65,29 @@ public:
                    const std::string& zone_file,
                    ZoneData* old_data = NULL);
 
+    /// \brief Constructor for loading from a file parsed in a separate
+    /// thread.
+    ///
+    /// This is similar to the constructor for loading from a file, but the
+    /// master file is parsed by the given \c MasterFileParser, concurrently
+    /// with the insertion of the parsed RRsets into the zone data (see the
+    /// parser class description).  The parser can be created (and start
+    /// parsing) well before the loader, e.g., while another zone is being
+    /// loaded.  The "items" of \c loadIncremental() are the collated
+    /// RRsets in this case.
+    ///
+    /// \throw InvalidParameter \c parser is null.
+    /// \throw BadValue \c parser is for a different zone or class.
+    /// \throw InvalidOperation \c parser has already been used for another
+    /// loader.
+    ///
+    /// \param parser The parser of the master file for \c zone_name.
+    ZoneDataLoader(util::MemorySegment& mem_sgmt,
+                   const dns::RRClass& rrclass,
+                   const dns::Name& zone_name,
+                   const MasterFileParserPtr& parser,
+                   ZoneData* old_data = NULL);
+
     /// \brief Constructor for loading from a given data source.
     ///
     /// Most of the parameters are the same as the other version.
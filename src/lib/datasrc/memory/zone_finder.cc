@@ -16,6 +16,7 @@
 #include <datasrc/memory/domaintree.h>
 #include <datasrc/memory/treenode_rrset.h>
 #include <datasrc/memory/rdata_serialization.h>
+#include <datasrc/memory/name_index.h>
 
 #include <datasrc/zone_finder.h>
 #include <datasrc/exceptions.h>
@@ -28,6 +29,7 @@
 
 #include <datasrc/memory/logger.h>
 
+#include <util/arena.h>
 #include <util/buffer.h>
 
 #include <boost/scoped_ptr.hpp>
@@ -115,17 +117,20 @@ createTreeNodeRRset(const ZoneNode* node,
 {
     const bool dnssec = ((options & ZoneFinder::FIND_DNSSEC) != 0);
     if (node && rdataset) {
+        // These are short-lived objects, so they are placed in the arena
+        // of the thread if it's set.
         if (realname) {
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(*realname, rrclass,
-                                                       node, rdataset,
-                                                       dnssec)));
+            return (util::createShared<TreeNodeRRset>(*realname, rrclass,
+                                                      node, rdataset,
+                                                      dnssec));
         } else if (ttl_data) {
             assert(!realname);  // these two cases should be mixed in our use
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(rrclass, node, rdataset,
-                                                       dnssec, ttl_data)));
+            return (util::createShared<TreeNodeRRset>(rrclass, node,
+                                                      rdataset, dnssec,
+                                                      ttl_data));
         } else {
-            return (TreeNodeRRsetPtr(new TreeNodeRRset(rrclass, node, rdataset,
-                                                       dnssec)));
+            return (util::createShared<TreeNodeRRset>(rrclass, node,
+                                                      rdataset, dnssec));
         }
     } else {
         return (TreeNodeRRsetPtr());
@@ -464,6 +469,11 @@ public:
 // node below the wildcarding node at this stage; that case should have been
 // caught above.
 //
+// The tree search is preceded by a lookup in the name index of the zone
+// (if it has one), which can identify the exact match case quickly for most
+// of the existing names (see NameIndex).  We fall back to the tree for
+// anything else.
+//
 // If none of the above succeeds, we conclude the name doesn't exist in
 // the zone, and throw an OutOfZone exception by default.  If the optional
 // out_of_zone_ok is true, it returns an NXDOMAIN result with NULL data so
@@ -475,6 +485,18 @@ FindNodeResult findNode(const ZoneData& zone_data,
                         ZoneFinder::FindOptions options,
                         bool out_of_zone_ok = false)
 {
+    // If the zone has a name index, try it first.  A non-empty node found
+    // there is an exact match that isn't affected by a zone cut or DNAME,
+    // so it's what the tree search below would find.  Note that we don't
+    // need the node path in this case.
+    const NameIndex* const name_index = zone_data.getNameIndex();
+    if (name_index != NULL) {
+        const ZoneNode* const node = name_index->find(name_labels);
+        if (node != NULL && !node->isEmpty()) {
+            return (FindNodeResult(ZoneFinder::SUCCESS, node, NULL));
+        }
+    }
+
     const ZoneNode* node = NULL;
     FindState state((options & ZoneFinder::FIND_GLUE_OK) != 0);
 
@@ -759,9 +781,9 @@ InMemoryZoneFinder::find(const bundy::dns::Name& name,
                          const bundy::dns::RRType& type,
                          const FindOptions options)
 {
-    return (ZoneFinderContextPtr(new Context(*this, options, rrclass_,
-                                             findInternal(name, type,
-                                                          NULL, options))));
+    return (util::createShared<Context>(*this, options, rrclass_,
+                                        findInternal(name, type, NULL,
+                                                     options)));
 }
 
 boost::shared_ptr<ZoneFinder::Context>
@@ -769,11 +791,9 @@ InMemoryZoneFinder::findAll(const bundy::dns::Name& name,
                             std::vector<bundy::dns::ConstRRsetPtr>& target,
                             const FindOptions options)
 {
-    return (ZoneFinderContextPtr(new Context(*this, options, rrclass_,
-                                             findInternal(name,
-                                                          RRType::ANY(),
-                                                          &target,
-                                                          options))));
+    return (util::createShared<Context>(*this, options, rrclass_,
+                                        findInternal(name, RRType::ANY(),
+                                                     &target, options)));
 }
 
 // The implementation is a special case of the generic findInternal: we know
@@ -797,21 +817,17 @@ InMemoryZoneFinder::findAtOrigin(const bundy::dns::RRType& type,
     if (found != NULL) {
         LOG_DEBUG(logger, DBG_TRACE_DATA, DATASRC_MEMORY_FIND_TYPE_AT_ORIGIN).
             arg(type).arg(getOrigin()).arg(rrclass_);
-        return (ZoneFinderContextPtr(
-                    new Context(*this, options, rrclass_,
-                                createFindResult(rrclass_, zone_data_, SUCCESS,
-                                                 node, found, options, false,
-                                                 NULL, use_minttl))));
+        return (util::createShared<Context>(
+                    *this, options, rrclass_,
+                    createFindResult(rrclass_, zone_data_, SUCCESS, node,
+                                     found, options, false, NULL,
+                                     use_minttl)));
     }
-    return (ZoneFinderContextPtr(
-                    new Context(*this, options, rrclass_,
-                                createFindResult(rrclass_, zone_data_, NXRRSET,
-                                                 node,
-                                                 getNSECForNXRRSET(zone_data_,
-                                                                   options,
-                                                                   node),
-                                                 options, false, NULL,
-                                                 use_minttl))));
+    return (util::createShared<Context>(
+                *this, options, rrclass_,
+                createFindResult(rrclass_, zone_data_, NXRRSET, node,
+                                 getNSECForNXRRSET(zone_data_, options, node),
+                                 options, false, NULL, use_minttl)));
 }
 
 ZoneFinderResultContext
@@ -36,6 +36,22 @@ const char* const ZONE_TABLE_CHECKSUM_NAME = "zone_table_checksum";
 // The name with which the zone table header is associated in the segment.
 const char* const ZONE_TABLE_HEADER_NAME = "zone_table_header";
 
+// The name with which the snapshot information is associated in the
+// segment.
+const char* const ZONE_TABLE_SNAPSHOT_NAME = "zone_table_snapshot";
+
+// The snapshot format version.  This must be incremented whenever the
+// layout of the in-memory zone data changes incompatibly.
+const uint32_t SNAPSHOT_VERSION = 1;
+
+// Snapshot information stored in the segment.  The digest must be the
+// first member, as the segment stores the digest at the named address (see
+// MemorySegmentMapped::setDigestName()).
+struct SnapshotInfo {
+    uint64_t digest;
+    uint32_t version;
+};
+
 } // end of unnamed namespace
 
 ZoneTableSegmentMapped::ZoneTableSegmentMapped(const RRClass& rrclass) :
@@ -51,6 +67,21 @@ ZoneTableSegmentMapped::~ZoneTableSegmentMapped() {
     sync();
 }
 
+void
+ZoneTableSegmentMapped::throwResetError(const std::string& filename,
+                                        const std::string& error_msg) const
+{
+    if (mem_sgmt_) {
+        bundy_throw(ResetFailed,
+                    "Error in resetting zone table segment to use "
+                    << filename << ": " << error_msg);
+    } else {
+        bundy_throw(ResetFailedAndSegmentCleared,
+                    "Error in resetting zone table segment to use "
+                    << filename << ": " << error_msg);
+    }
+}
+
 const std::string&
 ZoneTableSegmentMapped::getImplType() const {
     return (impl_type_);
@@ -70,6 +101,15 @@ ZoneTableSegmentMapped::processChecksum(MemorySegmentMapped& segment,
                  "opened in create mode";
             return (false);
         } else {
+            // A snapshot digest is updated after the checksum on close
+            // (and will be updated again on the next close, if at all), so
+            // it must be cleared for the checksum calculation.
+            const MemorySegment::NamedAddressResult snapshot_result =
+                segment.getNamedAddress(ZONE_TABLE_SNAPSHOT_NAME);
+            if (snapshot_result.first) {
+                static_cast<SnapshotInfo*>(snapshot_result.second)->digest = 0;
+            }
+
             // The segment was already shrunk when it was last
             // closed. Check that its checksum is consistent.
             assert(result.second);
@@ -150,9 +190,45 @@ ZoneTableSegmentMapped::processHeader(MemorySegmentMapped& segment,
     return (true);
 }
 
+bool
+ZoneTableSegmentMapped::processVersion(const MemorySegmentMapped& segment,
+                                       std::string& error_msg)
+{
+    const MemorySegment::NamedAddressResult result =
+        segment.getNamedAddress(ZONE_TABLE_SNAPSHOT_NAME);
+    if (result.first &&
+        static_cast<const SnapshotInfo*>(result.second)->version !=
+        SNAPSHOT_VERSION) {
+        error_msg = "Unsupported snapshot format version";
+        return (false);
+    }
+    return (true);
+}
+
+void
+ZoneTableSegmentMapped::prepareSnapshot(MemorySegmentMapped& segment) {
+    if (!segment.getNamedAddress(ZONE_TABLE_SNAPSHOT_NAME).first) {
+        void* info = NULL;
+        while (!info) {
+            try {
+                info = segment.allocate(sizeof(SnapshotInfo));
+            } catch (const MemorySegmentGrown&) {
+                // Do nothing and try again.
+            }
+        }
+        SnapshotInfo* snapshot_info = static_cast<SnapshotInfo*>(info);
+        snapshot_info->digest = 0;
+        snapshot_info->version = SNAPSHOT_VERSION;
+        segment.setNamedAddress(ZONE_TABLE_SNAPSHOT_NAME, snapshot_info);
+    }
+
+    // The digest is calculated and stored when the segment is closed.
+    segment.setDigestName(ZONE_TABLE_SNAPSHOT_NAME);
+}
+
 MemorySegmentMapped*
 ZoneTableSegmentMapped::openReadWrite(const std::string& filename,
-                                      bool create)
+                                      bool create, bool snapshot)
 {
     const MemorySegmentMapped::OpenMode mode = create ?
          MemorySegmentMapped::CREATE_ONLY :
@@ -167,24 +243,22 @@ ZoneTableSegmentMapped::openReadWrite(const std::string& filename,
     const bool has_allocations = !segment->allMemoryDeallocated();
 
     std::string error_msg;
-    if ((!processChecksum(*segment, create, has_allocations, error_msg)) ||
+    if ((!processVersion(*segment, error_msg)) ||
+        (!processChecksum(*segment, create, has_allocations, error_msg)) ||
         (!processHeader(*segment, create, has_allocations, error_msg))) {
-         if (mem_sgmt_) {
-              bundy_throw(ResetFailed,
-                        "Error in resetting zone table segment to use "
-                        << filename << ": " << error_msg);
-         } else {
-              bundy_throw(ResetFailedAndSegmentCleared,
-                        "Error in resetting zone table segment to use "
-                        << filename << ": " << error_msg);
-         }
+        throwResetError(filename, error_msg);
+    }
+    if (snapshot) {
+        prepareSnapshot(*segment);
     }
 
     return (segment.release());
 }
 
 MemorySegmentMapped*
-ZoneTableSegmentMapped::openReadOnly(const std::string& filename) {
+ZoneTableSegmentMapped::openReadOnly(const std::string& filename,
+                                     bool snapshot)
+{
     // In case the checksum or table header is missing, we throw. We
     // want the segment to be automatically destroyed then.
     std::unique_ptr<MemorySegmentMapped> segment
@@ -193,18 +267,8 @@ ZoneTableSegmentMapped::openReadOnly(const std::string& filename) {
     MemorySegment::NamedAddressResult result =
         segment->getNamedAddress(ZONE_TABLE_CHECKSUM_NAME);
     if (!result.first) {
-         const std::string error_msg =
-             "There is no previously saved checksum in a "
-             "mapped segment opened in read-only mode";
-         if (mem_sgmt_) {
-              bundy_throw(ResetFailed,
-                        "Error in resetting zone table segment to use "
-                        << filename << ": " << error_msg);
-         } else {
-              bundy_throw(ResetFailedAndSegmentCleared,
-                        "Error in resetting zone table segment to use "
-                        << filename << ": " << error_msg);
-         }
+        throwResetError(filename, "There is no previously saved checksum in "
+                        "a mapped segment opened in read-only mode");
     }
 
     // We can't verify the checksum here as we can't set the checksum to
@@ -216,18 +280,32 @@ ZoneTableSegmentMapped::openReadOnly(const std::string& filename) {
     if (result.first) {
         assert(result.second);
     } else {
-         const std::string error_msg =
-             "There is no previously saved ZoneTableHeader in a "
-             "mapped segment opened in read-only mode.";
-         if (mem_sgmt_) {
-              bundy_throw(ResetFailed,
-                        "Error in resetting zone table segment to use "
-                        << filename << ": " << error_msg);
-         } else {
-              bundy_throw(ResetFailedAndSegmentCleared,
-                        "Error in resetting zone table segment to use "
-                        << filename << ": " << error_msg);
-         }
+        throwResetError(filename, "There is no previously saved "
+                        "ZoneTableHeader in a mapped segment opened in "
+                        "read-only mode.");
+    }
+
+    std::string error_msg;
+    if (!processVersion(*segment, error_msg)) {
+        throwResetError(filename, error_msg);
+    }
+
+    // For a snapshot, we verify the entire segment with the digest
+    // instead.  This is expensive for a large segment, but still much
+    // cheaper than loading the zones from the scratch (and it has the
+    // side effect of bringing all pages into memory).
+    if (snapshot) {
+        result = segment->getNamedAddress(ZONE_TABLE_SNAPSHOT_NAME);
+        if (!result.first) {
+            throwResetError(filename, "There is no snapshot information in "
+                            "a mapped segment opened as a snapshot");
+        }
+        const SnapshotInfo* snapshot_info =
+            static_cast<const SnapshotInfo*>(result.second);
+        if (snapshot_info->digest != segment->getDigest(snapshot_info)) {
+            throwResetError(filename, "Snapshot digest doesn't match "
+                            "segment data");
+        }
     }
 
     return (segment.release());
@@ -270,6 +348,11 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
         bundy_throw(bundy::InvalidParameter,
                   "Invalid value of \"mapped-file\": must be string or null");
     }
+    ConstElementPtr snapshot = params->get("snapshot");
+    if (snapshot && snapshot->getType() != Element::boolean) {
+        bundy_throw(bundy::InvalidParameter,
+                  "Invalid value of \"snapshot\": must be boolean");
+    }
     if (mapped_file->getType() == Element::null) {
         LOG_DEBUG(logger, DBG_TRACE_BASIC, DATASRC_MEMORY_MEM_UNMAP_SEGMENT).
             arg(current_filename_.empty() ?
@@ -283,6 +366,7 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
     }
 
     const std::string filename = mapped_file->stringValue();
+    const bool use_snapshot = snapshot && snapshot->boolValue();
 
     if (mem_sgmt_ && (filename == current_filename_)) {
         // This reset() is an attempt to re-open the currently open
@@ -302,15 +386,15 @@ ZoneTableSegmentMapped::reset(MemorySegmentOpenMode mode,
 
     switch (mode) {
     case CREATE:
-        segment.reset(openReadWrite(filename, true));
+        segment.reset(openReadWrite(filename, true, use_snapshot));
         break;
 
     case READ_WRITE:
-        segment.reset(openReadWrite(filename, false));
+        segment.reset(openReadWrite(filename, false, use_snapshot));
         break;
 
     case READ_ONLY:
-        segment.reset(openReadOnly(filename));
+        segment.reset(openReadOnly(filename, use_snapshot));
         break;
 
     default:
@@ -92,6 +92,16 @@ public:
     /// and the zone table segment will become unusable.  In this case,
     /// \c mode will be ignored.
     ///
+    /// \c params can also contain a boolean "snapshot" key.  If it's true,
+    /// the mapped file is handled as a "snapshot" of the zone table: in the
+    /// \c CREATE and \c READ_WRITE modes, format version and a digest of
+    /// the entire file are stored in the file when it's closed; in the
+    /// \c READ_ONLY mode, the version and the digest are verified on
+    /// opening the file, so a snapshot built offline (e.g., by
+    /// bundy-loadzone) can be safely used as the zone table from the
+    /// beginning.  The format version is checked for any mapped file that
+    /// has it, whether or not "snapshot" is specified.
+    ///
     /// Please see the \c ZoneTableSegment API documentation for the
     /// behavior in case of exceptions.
     ///
@@ -123,10 +133,19 @@ private:
                          bool has_allocations, std::string& error_msg);
     bool processHeader(bundy::util::MemorySegmentMapped& segment, bool create,
                        bool has_allocations, std::string& error_msg);
+    bool processVersion(const bundy::util::MemorySegmentMapped& segment,
+                        std::string& error_msg);
+    void prepareSnapshot(bundy::util::MemorySegmentMapped& segment);
 
     bundy::util::MemorySegmentMapped* openReadWrite(const std::string& filename,
-                                                  bool create);
-    bundy::util::MemorySegmentMapped* openReadOnly(const std::string& filename);
+                                                  bool create, bool snapshot);
+    bundy::util::MemorySegmentMapped* openReadOnly(const std::string& filename,
+                                                 bool snapshot);
+
+    // Throw ResetFailed or ResetFailedAndSegmentCleared depending on
+    // whether we have a usable segment.
+    void throwResetError(const std::string& filename,
+                         const std::string& error_msg) const;
 
     template<typename T> T* getHeaderHelper(bool initial) const;
 
@@ -26,6 +26,9 @@
 #include <gtest/gtest.h>
 
 #include <boost/scoped_ptr.hpp>
+
+#include <cstdio>               // for std::rename
+#include <fstream>
 #include <iterator>             // for std::distance
 
 using namespace bundy::datasrc;
@@ -36,6 +39,8 @@ using bundy::datasrc::internal::CacheConfig;
 using bundy::datasrc::internal::CacheConfigError;
 using bundy::datasrc::memory::ZoneDataLoaderCreator;
 using bundy::datasrc::memory::ZoneData;
+using bundy::datasrc::memory::ZoneNode;
+using bundy::datasrc::memory::ZoneTree;
 
 namespace {
 
@@ -178,6 +183,109 @@ TEST_F(CacheConfigTest, getLoaderCreatorWithMasterFiles) {
                                              Name("example.com")));
 }
 
+TEST_F(CacheConfigTest, getLoaderCreatorWithParser) {
+    // Master files are parsed in separate threads with cache-load-threads.
+    // Configure more zones than threads.
+    const ConstElementPtr config(Element::fromJSON(
+                                     "{\"cache-enable\": true,"
+                                     " \"cache-load-threads\": 2,"
+                                     " \"params\": "
+                                     "{\".\": \"" TEST_DATA_DIR "/root.zone\","
+                                     " \"example.org\": \""
+                                     TEST_DATA_DIR "/example.org\","
+                                     " \"example.com\": \""
+                                     TEST_DATA_DIR "/example.com.signed\"}"
+                                     "}"));
+    const CacheConfig cache_conf("MasterFiles", 0, *config, true);
+    EXPECT_EQ(2, cache_conf.getLoadThreads());
+
+    // Load all zones in order, parsing ahead, and then reload one of them
+    // without it.  The functor can also be used multiple times.  In all
+    // cases the zones should be loaded successfully.
+    uint8_t labels_buf[LabelSequence::MAX_SERIALIZED_LENGTH];
+    for (CacheConfig::ConstZoneIterator it = cache_conf.begin();
+         it != cache_conf.end();
+         ++it) {
+        const ZoneDataLoaderCreator creator =
+            cache_conf.getLoaderCreator(RRClass::IN(), it->first, true);
+        for (int i = 0; i < 2; ++i) {
+            boost::scoped_ptr<memory::ZoneDataLoader> loader(
+                creator(msgmt_, NULL));
+            ZoneData* zone_data = loader->load();
+            ASSERT_TRUE(zone_data);
+            EXPECT_EQ(it->first.toText(), zone_data->getOriginNode()->
+                      getAbsoluteLabels(labels_buf).toText());
+            ZoneData::destroy(msgmt_, zone_data, RRClass::IN());
+        }
+    }
+    boost::scoped_ptr<memory::ZoneDataLoader> loader(
+        cache_conf.getLoaderCreator(RRClass::IN(), Name("example.org"))
+        (msgmt_, NULL));
+    ZoneData::destroy(msgmt_, loader->load(), RRClass::IN());
+
+    // Parsers started ahead for zones that aren't loaded are simply
+    // discarded.
+    const CacheConfig cache_conf2("MasterFiles", 0, *config, true);
+    cache_conf2.getLoaderCreator(RRClass::IN(), Name::ROOT_NAME(), true);
+
+    // Bad values of the number of threads.
+    EXPECT_THROW(CacheConfig("MasterFiles", 0,
+                             *Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-load-threads\": -1,"
+                                                " \"params\": {}}"), true),
+                 CacheConfigError);
+    EXPECT_THROW(CacheConfig("MasterFiles", 0,
+                             *Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-load-threads\": \"2\","
+                                                " \"params\": {}}"), true),
+                 bundy::data::TypeError);
+}
+
+// Write a minimal example.org zone with a single host, replacing the file
+// (so a parser that has already opened it still reads the old one).
+void
+replaceZoneFile(const std::string& filename, const std::string& host) {
+    const std::string tmp_filename = filename + ".new.copied";
+    std::ofstream f(tmp_filename.c_str());
+    f << "example.org. 3600 IN SOA ns1.example.org. admin.example.org. "
+         "1 3600 1800 2419200 7200\n"
+      << "example.org. 3600 IN NS ns1.example.org.\n"
+      << host << ".example.org. 3600 IN A 192.0.2.1\n";
+    f.close();
+    ASSERT_EQ(0, std::rename(tmp_filename.c_str(), filename.c_str()));
+}
+
+TEST_F(CacheConfigTest, getLoaderCreatorAfterStoppedLoad) {
+    const std::string zone_file = TEST_DATA_BUILDDIR "/example.org.copied";
+    replaceZoneFile(zone_file, "old");
+    const ConstElementPtr config(Element::fromJSON(
+                                     "{\"cache-enable\": true,"
+                                     " \"cache-load-threads\": 2,"
+                                     " \"params\": "
+                                     "{\".\": \"" TEST_DATA_DIR "/root.zone\","
+                                     " \"example.org\": \"" + zone_file +
+                                     "\"}}"));
+    const CacheConfig cache_conf("MasterFiles", 0, *config, true);
+
+    // A full load starts parsing both zones ahead, but it stops after
+    // getting the loader of the first one.  Then the master file of the
+    // second one changes, and it's loaded alone.  It must not use the
+    // parser started ahead, which has read the old file.
+    cache_conf.getLoaderCreator(RRClass::IN(), Name::ROOT_NAME(), true);
+    replaceZoneFile(zone_file, "new");
+    boost::scoped_ptr<memory::ZoneDataLoader> loader(
+        cache_conf.getLoaderCreator(RRClass::IN(), Name("example.org"))
+        (msgmt_, NULL));
+    ZoneData* zone_data = loader->load();
+    ASSERT_TRUE(zone_data);
+    const ZoneNode* node = NULL;
+    EXPECT_EQ(ZoneTree::EXACTMATCH,
+              zone_data->getZoneTree().find(Name("new.example.org"), &node));
+    EXPECT_NE(ZoneTree::EXACTMATCH,
+              zone_data->getZoneTree().find(Name("old.example.org"), &node));
+    ZoneData::destroy(msgmt_, zone_data, RRClass::IN());
+}
+
 TEST_F(CacheConfigTest, constructWithMock) {
     // Performing equivalent set of tests as constructMasterFiles
 
@@ -295,6 +403,9 @@ TEST_F(CacheConfigTest, getSegmentType) {
     EXPECT_EQ("local",
               CacheConfig("MasterFiles", 0,
                           *master_config_, true).getSegmentType());
+    // By default master files are parsed in the loading thread.
+    EXPECT_EQ(0, CacheConfig("MasterFiles", 0,
+                             *master_config_, true).getLoadThreads());
 
     // If we explicitly configure it, that value should be used.
     ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
@@ -311,4 +422,27 @@ TEST_F(CacheConfigTest, getSegmentType) {
                  bundy::data::TypeError);
 }
 
+TEST_F(CacheConfigTest, getSnapshotFile) {
+    // No snapshot by default
+    EXPECT_EQ("", CacheConfig("MasterFiles", 0,
+                              *master_config_, true).getSnapshotFile());
+
+    // It can be specified for the mapped type.
+    ConstElementPtr config(Element::fromJSON("{\"cache-enable\": true,"
+                                             " \"cache-type\": \"mapped\","
+                                             " \"cache-snapshot\": "
+                                             "   \"/tmp/zones.snapshot\","
+                                             " \"params\": {}}" ));
+    EXPECT_EQ("/tmp/zones.snapshot",
+              CacheConfig("MasterFiles", 0, *config, true).getSnapshotFile());
+
+    // But not for others.
+    ConstElementPtr badconfig(Element::fromJSON("{\"cache-enable\": true,"
+                                                " \"cache-snapshot\": "
+                                                "   \"/tmp/zones.snapshot\","
+                                                " \"params\": {}}"));
+    EXPECT_THROW(CacheConfig("MasterFiles", 0, *badconfig, true),
+                 CacheConfigError);
+}
+
 }
@@ -898,6 +898,65 @@ TEST_P(ListTest,
               doReload(Name("example.org")));
 }
 
+// Using a zone table snapshot built offline.  This relies on the mapped type
+// of cache, too.
+TEST_P(ListTest,
+#ifdef USE_SHARED_MEMORY
+       cacheSnapshot
+#else
+       DISABLED_cacheSnapshot
+#endif
+    )
+{
+    const std::string snapshot_file = getMappedFilename(0);
+    const std::string config_text = "["
+        "{"
+        "   \"type\": \"MasterFiles\","
+        "   \"cache-enable\": true,"
+        "   \"cache-type\": \"mapped\","
+        "   \"cache-snapshot\": \"" + snapshot_file + "\","
+        "   \"params\": {"
+        "       \".\": \"" TEST_DATA_DIR "/root.zone\""
+        "   }"
+        "}]";
+
+    // Build the snapshot, in the way bundy-loadzone does.
+    {
+        ConfigurableClientList builder(rrclass_);
+        builder.configure(Element::fromJSON(config_text), true);
+        EXPECT_TRUE(builder.resetMemorySegment(
+                        "MasterFiles", memory::ZoneTableSegment::CREATE,
+                        Element::fromJSON("{\"mapped-file\": \"" +
+                                          snapshot_file + "\","
+                                          " \"snapshot\": true}")));
+        const ConfigurableClientList::ZoneWriterPair result =
+            builder.getCachedZoneWriter(Name("."), false, "MasterFiles");
+        ASSERT_EQ(ConfigurableClientList::ZONE_SUCCESS, result.first);
+        result.second->load();
+        result.second->install();
+        result.second->cleanup();
+        builder.resetMemorySegment("MasterFiles",
+                                   memory::ZoneTableSegment::CREATE,
+                                   Element::fromJSON("{\"mapped-file\": "
+                                                     "null}"));
+    }
+
+    // The zone is available immediately after configuration, from the
+    // read-only cache.
+    list_->configure(Element::fromJSON(config_text), true);
+    EXPECT_EQ(SEGMENT_INUSE, list_->getStatus()[0].getSegmentState());
+    positiveResult(list_->find(Name(".")), ds_[0], Name("."), true, "root",
+                   true);
+    EXPECT_EQ(ConfigurableClientList::CACHE_NOT_WRITABLE,
+              doReload(Name(".")));
+
+    // An unusable snapshot is ignored, and the cache is pending.
+    boost::interprocess::file_mapping::remove(snapshot_file.c_str());
+    list_.reset(new TestedList(rrclass_));
+    list_->configure(Element::fromJSON(config_text), true);
+    EXPECT_EQ(SEGMENT_WAITING, list_->getStatus()[0].getSegmentState());
+}
+
 TEST_P(ListTest, masterFiles) {
     const ConstElementPtr elem(Element::fromJSON("["
         "{"
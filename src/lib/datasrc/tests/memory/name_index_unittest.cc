@@ -0,0 +1,241 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <datasrc/memory/name_index.h>
+#include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/zone_data_updater.h>
+
+#include <dns/labelsequence.h>
+#include <dns/name.h>
+#include <dns/rrclass.h>
+#include <dns/rrset.h>
+
+#include <testutils/dnsmessage_test.h>
+#include <datasrc/tests/memory/memory_segment_mock.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <sstream>
+#include <string>
+
+using namespace bundy::dns;
+using namespace bundy::datasrc::memory;
+using namespace bundy::datasrc::memory::test;
+using namespace bundy::testutils;
+
+namespace {
+
+class NameIndexTest : public ::testing::Test {
+protected:
+    NameIndexTest() :
+        zname_("example.org"),
+        zone_data_(ZoneData::create(mem_sgmt_, zname_)),
+        updater_(new ZoneDataUpdater(mem_sgmt_, RRClass::IN(), zname_,
+                                     *zone_data_))
+    {
+        const char* const rrs[] = {
+            "example.org. 300 IN NS ns.example.org.",
+            "ns.example.org. 300 IN A 192.0.2.1",
+            "www.example.org. 300 IN A 192.0.2.2",
+            "a.b.c.example.org. 300 IN A 192.0.2.3",
+            "*.wild.example.org. 300 IN A 192.0.2.4",
+            "child.example.org. 300 IN NS ns.child.example.org.",
+            "ns.child.example.org. 300 IN A 192.0.2.5",
+            "dname.example.org. 300 IN DNAME example.com.",
+            NULL
+        };
+        for (int i = 0; rrs[i] != NULL; ++i) {
+            updater_->add(textToRRset(rrs[i]), ConstRRsetPtr());
+        }
+    }
+    void TearDown() {
+        updater_.reset();
+        ZoneData::destroy(mem_sgmt_, zone_data_, RRClass::IN());
+        // detect any memory leak in the test memory segment
+        EXPECT_TRUE(mem_sgmt_.allMemoryDeallocated());
+    }
+
+    // Check the name is (or is not) in the index, and if found, it's the
+    // node for the name in the tree.
+    void checkFind(const NameIndex& index, const char* name, bool expected) {
+        SCOPED_TRACE(name);
+        const ZoneNode* node = index.find(LabelSequence(Name(name)));
+        if (!expected) {
+            EXPECT_EQ(static_cast<const ZoneNode*>(NULL), node);
+            return;
+        }
+        const ZoneNode* tree_node = NULL;
+        EXPECT_EQ(ZoneTree::EXACTMATCH,
+                  zone_data_->getZoneTree().find(Name(name), &tree_node));
+        EXPECT_EQ(tree_node, node);
+    }
+
+    MemorySegmentMock mem_sgmt_;
+    const Name zname_;
+    ZoneData* zone_data_;
+    boost::scoped_ptr<ZoneDataUpdater> updater_;
+};
+
+TEST_F(NameIndexTest, find) {
+    NameIndex* index = NameIndex::create(mem_sgmt_,
+                                         zone_data_->getZoneTree(),
+                                         *zone_data_->getOriginNode());
+    // example.org, ns, www, a.b.c, *.wild, child, dname
+    EXPECT_EQ(7, index->getNameCount());
+
+    checkFind(*index, "example.org", true);
+    checkFind(*index, "ns.example.org", true);
+    checkFind(*index, "www.example.org", true);
+    checkFind(*index, "a.b.c.example.org", true);
+    checkFind(*index, "*.wild.example.org", true);
+    // Case doesn't matter.
+    checkFind(*index, "WWW.Example.ORG", true);
+    // Nodes at zone cuts and DNAME are stored, but not those below them.
+    checkFind(*index, "child.example.org", true);
+    checkFind(*index, "dname.example.org", true);
+    checkFind(*index, "ns.child.example.org", false);
+    // Empty nodes aren't stored.
+    checkFind(*index, "b.c.example.org", false);
+    checkFind(*index, "c.example.org", false);
+    checkFind(*index, "wild.example.org", false);
+    // Nor non-existent names, including wildcard matches and names out of
+    // the zone.
+    checkFind(*index, "nothere.example.org", false);
+    checkFind(*index, "www.wild.example.org", false);
+    checkFind(*index, "www.example.org.example.org", false);
+    checkFind(*index, "org", false);
+    checkFind(*index, "example.com", false);
+    checkFind(*index, "ns.example.com", false);
+
+    NameIndex::destroy(mem_sgmt_, index);
+}
+
+TEST_F(NameIndexTest, manyNames) {
+    // Check a larger zone so the table has collisions.
+    for (int i = 0; i < 1000; ++i) {
+        std::ostringstream oss;
+        oss << "host" << i << ".sub" << (i % 10) << ".example.org. 300 IN A "
+            << "192.0.2.1";
+        updater_->add(textToRRset(oss.str()), ConstRRsetPtr());
+    }
+    NameIndex* index = NameIndex::create(mem_sgmt_,
+                                         zone_data_->getZoneTree(),
+                                         *zone_data_->getOriginNode());
+    EXPECT_EQ(1007, index->getNameCount());
+    for (int i = 0; i < 1000; ++i) {
+        std::ostringstream oss;
+        oss << "host" << i << ".sub" << (i % 10) << ".example.org";
+        checkFind(*index, oss.str().c_str(), true);
+        std::ostringstream oss2;
+        oss2 << "host" << i << ".sub" << ((i + 1) % 10) << ".example.org";
+        checkFind(*index, oss2.str().c_str(), false);
+    }
+    NameIndex::destroy(mem_sgmt_, index);
+}
+
+TEST_F(NameIndexTest, zoneData) {
+    // No index by default.
+    EXPECT_EQ(static_cast<const NameIndex*>(NULL), zone_data_->getNameIndex());
+
+    zone_data_->buildNameIndex(mem_sgmt_);
+    const NameIndex* index = zone_data_->getNameIndex();
+    ASSERT_NE(static_cast<const NameIndex*>(NULL), index);
+    EXPECT_EQ(7, index->getNameCount());
+
+    // It can be rebuilt.
+    zone_data_->buildNameIndex(mem_sgmt_);
+    ASSERT_NE(static_cast<const NameIndex*>(NULL),
+              zone_data_->getNameIndex());
+
+    // Modifying the tree keeps the index.  An empty node isn't found.
+    ZoneNode* node = NULL;
+    zone_data_->insertName(mem_sgmt_, Name("new.example.org"), &node);
+    index = zone_data_->getNameIndex();
+    ASSERT_NE(static_cast<const NameIndex*>(NULL), index);
+    EXPECT_EQ(8, index->getNameCount());
+    checkFind(*index, "new.example.org", false);
+
+    zone_data_->removeNode(mem_sgmt_, node);
+    index = zone_data_->getNameIndex();
+    ASSERT_NE(static_cast<const NameIndex*>(NULL), index);
+    EXPECT_EQ(7, index->getNameCount());
+
+    // Destroying the zone data with an index shouldn't leak (checked in
+    // TearDown()).
+}
+
+TEST_F(NameIndexTest, update) {
+    zone_data_->buildNameIndex(mem_sgmt_);
+
+    // New names are found once they have data.
+    updater_->add(textToRRset("new.example.org. 300 IN A 192.0.2.6"),
+                  ConstRRsetPtr());
+    updater_->add(textToRRset("b.c.example.org. 300 IN A 192.0.2.7"),
+                  ConstRRsetPtr());
+    checkFind(*zone_data_->getNameIndex(), "new.example.org", true);
+    checkFind(*zone_data_->getNameIndex(), "b.c.example.org", true);
+
+    // A new zone cut hides the names below it.
+    updater_->add(textToRRset("c.example.org. 300 IN NS ns.example.org."),
+                  ConstRRsetPtr());
+    checkFind(*zone_data_->getNameIndex(), "c.example.org", true);
+    checkFind(*zone_data_->getNameIndex(), "b.c.example.org", false);
+    checkFind(*zone_data_->getNameIndex(), "a.b.c.example.org", false);
+    updater_->remove(textToRRset("c.example.org. 300 IN NS ns.example.org."),
+                     ConstRRsetPtr());
+    checkFind(*zone_data_->getNameIndex(), "a.b.c.example.org", true);
+
+    // Removed names aren't found any more, and the others still are.
+    updater_->remove(textToRRset("new.example.org. 300 IN A 192.0.2.6"),
+                     ConstRRsetPtr());
+    updater_->remove(textToRRset("a.b.c.example.org. 300 IN A 192.0.2.3"),
+                     ConstRRsetPtr());
+    checkFind(*zone_data_->getNameIndex(), "new.example.org", false);
+    checkFind(*zone_data_->getNameIndex(), "a.b.c.example.org", false);
+    checkFind(*zone_data_->getNameIndex(), "b.c.example.org", true);
+    checkFind(*zone_data_->getNameIndex(), "www.example.org", true);
+
+    // The index grows as needed.
+    for (int i = 0; i < 1000; ++i) {
+        std::ostringstream oss;
+        oss << "host" << i << ".sub" << (i % 10) << ".example.org. 300 IN A "
+            << "192.0.2.1";
+        updater_->add(textToRRset(oss.str()), ConstRRsetPtr());
+    }
+    const NameIndex& index = *zone_data_->getNameIndex();
+    EXPECT_LE(1000, index.getNameCount());
+    for (int i = 0; i < 1000; ++i) {
+        std::ostringstream oss;
+        oss << "host" << i << ".sub" << (i % 10) << ".example.org";
+        checkFind(index, oss.str().c_str(), true);
+    }
+
+    // And shrinks back, leaving no dangling entry (the removal of the
+    // entries is checked with the entries shifted back).
+    for (int i = 0; i < 1000; i += 2) {
+        std::ostringstream oss;
+        oss << "host" << i << ".sub" << (i % 10) << ".example.org. 300 IN A "
+            << "192.0.2.1";
+        updater_->remove(textToRRset(oss.str()), ConstRRsetPtr());
+    }
+    for (int i = 0; i < 1000; ++i) {
+        std::ostringstream oss;
+        oss << "host" << i << ".sub" << (i % 10) << ".example.org";
+        checkFind(*zone_data_->getNameIndex(), oss.str().c_str(), i % 2 == 1);
+    }
+}
+
+}
@@ -15,8 +15,10 @@
 #include <config.h>
 
 #include <datasrc/memory/zone_data_loader.h>
+#include <datasrc/memory/master_file_parser.h>
 #include <datasrc/memory/rdataset.h>
 #include <datasrc/memory/zone_data.h>
+#include <datasrc/memory/name_index.h>
 #include <datasrc/memory/zone_data_updater.h>
 #include <datasrc/memory/segment_object_holder.h>
 #include <datasrc/client.h>
@@ -26,6 +28,7 @@
 
 #include <util/buffer.h>
 
+#include <dns/labelsequence.h>
 #include <dns/name.h>
 #include <dns/rrclass.h>
 #include <dns/rdataclass.h>
@@ -276,6 +279,92 @@ TEST_F(ZoneDataLoaderTest, zoneMinTTL) {
     EXPECT_EQ(RRTTL(1200), RRTTL(b));
 }
 
+TEST_F(ZoneDataLoaderTest, nameIndex) {
+    // The name index should be built for the loaded zone.
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, Name("example.org"),
+                                TEST_DATA_DIR
+                                "/example.org-nsec3-signed.zone").load();
+    const NameIndex* index = zone_data_->getNameIndex();
+    ASSERT_NE(static_cast<const NameIndex*>(NULL), index);
+    EXPECT_EQ(zone_data_->getOriginNode(),
+              index->find(LabelSequence(Name("example.org"))));
+}
+
+TEST_F(ZoneDataLoaderTest, loadWithParser) {
+    // Loading with a master file parser should result in the same zone
+    // data as loading directly from the file.
+    const Name origin("example.org");
+    const char* const zone_file = TEST_DATA_DIR "/example.org-nsec3-signed.zone";
+    ZoneData* expected = ZoneDataLoader(mem_sgmt_, zclass_, origin,
+                                       zone_file).load();
+    for (int i = 0; i < 2; ++i) {
+        // Use tiny batches and queue so the threads will often wait for
+        // each other.
+        const MasterFileParserPtr parser(new MasterFileParser(zone_file,
+                                                              origin, zclass_,
+                                                              2, 1));
+        ZoneDataLoader loader(mem_sgmt_, zclass_, origin, parser);
+        EXPECT_FALSE(loader.isDataReused());
+        zone_data_ = checkLoad(loader, i == 1);
+        ASSERT_TRUE(zone_data_);
+        EXPECT_EQ(expected->getZoneTree().getNodeCount(),
+                  zone_data_->getZoneTree().getNodeCount());
+        EXPECT_EQ(expected->isNSEC3Signed(), zone_data_->isNSEC3Signed());
+        EXPECT_EQ(expected->getNSEC3Data()->getNSEC3Tree().getNodeCount(),
+                  zone_data_->getNSEC3Data()->getNSEC3Tree().getNodeCount());
+        ASSERT_NE(static_cast<const NameIndex*>(NULL),
+                  zone_data_->getNameIndex());
+        ZoneData::destroy(mem_sgmt_, zone_data_, zclass_);
+        zone_data_ = NULL;
+    }
+    ZoneData::destroy(mem_sgmt_, expected, zclass_);
+}
+
+TEST_F(ZoneDataLoaderTest, loadWithBadParser) {
+    const Name origin("example.org");
+    const MasterFileParserPtr parser(
+        new MasterFileParser(TEST_DATA_DIR "/example.org-nsec3-signed.zone",
+                             origin, zclass_));
+    EXPECT_THROW(ZoneDataLoader(mem_sgmt_, zclass_, origin,
+                                MasterFileParserPtr()),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(ZoneDataLoader(mem_sgmt_, zclass_, Name("example.com"),
+                                parser),
+                 bundy::BadValue);
+    EXPECT_THROW(ZoneDataLoader(mem_sgmt_, RRClass::CH(), origin, parser),
+                 bundy::BadValue);
+
+    // A parser can only be used once.
+    zone_data_ = ZoneDataLoader(mem_sgmt_, zclass_, origin, parser).load();
+    EXPECT_THROW(ZoneDataLoader(mem_sgmt_, zclass_, origin, parser),
+                 bundy::InvalidOperation);
+
+    // An error in the master file is reported in the same way as the
+    // normal file loader.
+    const MasterFileParserPtr bad_parser(
+        new MasterFileParser(TEST_DATA_DIR "/example.org-broken1.zone",
+                             origin, zclass_));
+    EXPECT_THROW(ZoneDataLoader(mem_sgmt_, zclass_, origin,
+                                bad_parser).load(),
+                 ZoneLoaderException);
+    const MasterFileParserPtr no_file_parser(
+        new MasterFileParser(TEST_DATA_DIR "/no-such-file.zone",
+                             origin, zclass_));
+    EXPECT_THROW(ZoneDataLoader(mem_sgmt_, zclass_, origin,
+                                no_file_parser).load(),
+                 ZoneLoaderException);
+}
+
+TEST_F(ZoneDataLoaderTest, abandonParser) {
+    // The parser can be destroyed without consuming the data, even if it's
+    // waiting for the consumer.
+    MasterFileParser parser(TEST_DATA_DIR "/example.org-nsec3-signed.zone",
+                            Name("example.org"), zclass_, 1, 1);
+    MasterFileParser::RRsetBatch batch;
+    EXPECT_TRUE(parser.getNextBatch(batch));
+    EXPECT_EQ(1, batch.size());
+}
+
 void
 ZoneDataLoaderTest::loadFromDataSourceCommon(bool incremental) {
     const Name origin("example.com");
@@ -26,12 +26,14 @@
 
 #include <datasrc/memory/zone_finder.h>
 #include <datasrc/memory/zone_data_updater.h>
+#include <datasrc/memory/name_index.h>
 #include <datasrc/memory/rdata_serialization.h>
 #include <datasrc/memory/zone_table_segment.h>
 #include <datasrc/memory/memory_client.h>
 #include <datasrc/exceptions.h>
 #include <datasrc/client.h>
 #include <testutils/dnsmessage_test.h>
+#include <util/arena.h>
 
 #include <boost/foreach.hpp>
 
@@ -680,6 +682,73 @@ TEST_F(InMemoryZoneFinderTest, glue) {
              NULL, ZoneFinder::FIND_GLUE_OK);
 }
 
+TEST_F(InMemoryZoneFinderTest, findWithNameIndex) {
+    // Same kinds of names as some of the above tests, but with the name
+    // index of the zone.  The results shouldn't be affected by the index.
+    addToZoneData(rr_ns_);
+    addToZoneData(rr_a_);
+    addToZoneData(rr_cname_);
+    addToZoneData(rr_dname_);
+    addToZoneData(rr_child_ns_);
+    addToZoneData(rr_child_glue_);
+    addToZoneData(rr_ns_a_);
+    addToZoneData(rr_ns_ns_);
+    zone_data_->buildNameIndex(mem_sgmt_);
+    ASSERT_NE(static_cast<const NameIndex*>(NULL), zone_data_->getNameIndex());
+
+    findTest(origin_, RRType::NS(), ZoneFinder::SUCCESS, true, rr_ns_);
+    findTest(origin_, RRType::TXT(), ZoneFinder::NXRRSET, true);
+    findTest(Name("CNAME.example.ORG"), RRType::A(), ZoneFinder::CNAME, true,
+             rr_cname_);
+    findTest(Name("nothere.example.org"), RRType::A(), ZoneFinder::NXDOMAIN,
+             true);
+    findTest(Name("below.dname.example.org"), RRType::A(), ZoneFinder::DNAME,
+             true, rr_dname_);
+    findTest(Name("child.example.org"), RRType::A(), ZoneFinder::DELEGATION,
+             true, rr_child_ns_);
+    findTest(rr_child_glue_->getName(), RRType::A(), ZoneFinder::DELEGATION,
+             true, rr_child_ns_);
+    findTest(rr_child_glue_->getName(), RRType::A(), ZoneFinder::SUCCESS, true,
+             rr_child_glue_, ZoneFinder::RESULT_DEFAULT, NULL,
+             ZoneFinder::FIND_GLUE_OK);
+    findTest(Name("ns.example.org"), RRType::A(),
+             ZoneFinder::DELEGATION, true, rr_ns_ns_);
+    findTest(Name("ns.example.org"), RRType::A(), ZoneFinder::SUCCESS,
+             true, rr_ns_a_, ZoneFinder::RESULT_DEFAULT,
+             NULL, ZoneFinder::FIND_GLUE_OK);
+
+    // Adding data updates the index; the new data should be found.
+    addToZoneData(rr_dname_a_);
+    EXPECT_NE(static_cast<const NameIndex*>(NULL), zone_data_->getNameIndex());
+    findTest(rr_dname_a_->getName(), RRType::A(), ZoneFinder::SUCCESS, true,
+             rr_dname_a_);
+}
+
+TEST_F(InMemoryZoneFinderTest, findWithArena) {
+    // With an arena set for the thread, the result context and the RRsets
+    // are placed in it.  The results should be the same.
+    addToZoneData(rr_ns_);
+    addToZoneData(rr_a_);
+    bundy::util::Arena* arena = bundy::util::Arena::create();
+    {
+        const bundy::util::Arena::Scope scope(arena);
+        findTest(origin_, RRType::NS(), ZoneFinder::SUCCESS, true, rr_ns_);
+
+        ZoneFinderContextPtr result = zone_finder_.find(rr_a_->getName(),
+                                                        RRType::A());
+        EXPECT_EQ(ZoneFinder::SUCCESS, result->code);
+        rrsetCheck(rr_a_, result->rrset);
+        // The context and the RRset
+        EXPECT_EQ(2, arena->getLiveCount());
+        EXPECT_FALSE(arena->reset());
+        result.reset();
+    }
+    // Once the results are released, the arena can be reset.
+    EXPECT_EQ(0, arena->getLiveCount());
+    EXPECT_TRUE(arena->reset());
+    bundy::util::Arena::destroy(arena);
+}
+
 TEST_F(InMemoryZoneFinderTest, findAtOrigin) {
     // Add origin NS.
     rr_ns_->addRRsig(createRdata(RRType::RRSIG(), RRClass::IN(),
@@ -122,6 +122,16 @@ deleteHeader(MemorySegment& segment) {
     segment.clearNamedAddress("zone_table_header");
 }
 
+// Snapshot version is the 32-bit integer next to the 64-bit digest.
+void
+setSnapshotVersion(MemorySegment& segment, uint32_t version) {
+    const MemorySegment::NamedAddressResult result =
+        segment.getNamedAddress("zone_table_snapshot");
+    ASSERT_TRUE(result.first);
+    *reinterpret_cast<uint32_t*>(static_cast<uint64_t*>(result.second) + 1) =
+        version;
+}
+
 void
 ZoneTableSegmentMappedTest::addData(MemorySegment& segment) {
     // For purposes of this test, we assume that the following
@@ -589,4 +599,94 @@ TEST_F(ZoneTableSegmentMappedTest, resetCreateOverCorruptedFile) {
     EXPECT_FALSE(verifyData(ztable_segment_->getMemorySegment()));
 }
 
+TEST_F(ZoneTableSegmentMappedTest, snapshot) {
+    const ConstElementPtr snapshot_params =
+        Element::fromJSON("{\"mapped-file\": \"" + std::string(mapped_file) +
+                          "\", \"snapshot\": true}");
+
+    // Build a snapshot, and open it in read-only mode.  It's verified
+    // with the digest stored on close.
+    ztable_segment_->reset(ZoneTableSegment::CREATE, snapshot_params);
+    addData(ztable_segment_->getMemorySegment());
+    ztable_segment_->clear();
+    ztable_segment_->reset(ZoneTableSegment::READ_ONLY, snapshot_params);
+    EXPECT_TRUE(ztable_segment_->isUsable());
+    EXPECT_FALSE(ztable_segment_->isWritable());
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+    ztable_segment_->clear();
+
+    // Updating it in read-write mode without the "snapshot" flag
+    // invalidates the snapshot, while it can still be used as a normal
+    // mapped file.
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params_);
+    ztable_segment_->clear();
+    EXPECT_THROW(ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                                        snapshot_params),
+                 ResetFailedAndSegmentCleared);
+    ztable_segment_->reset(ZoneTableSegment::READ_ONLY, config_params_);
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+    ztable_segment_->clear();
+
+    // Updating it with the flag makes it a valid snapshot again.
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, snapshot_params);
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+    ztable_segment_->clear();
+    ztable_segment_->reset(ZoneTableSegment::READ_ONLY, snapshot_params);
+    EXPECT_TRUE(verifyData(ztable_segment_->getMemorySegment()));
+
+    // A non-boolean "snapshot" is rejected.
+    EXPECT_THROW(ztable_segment_->reset(
+                     ZoneTableSegment::READ_ONLY,
+                     Element::fromJSON("{\"mapped-file\": \"" +
+                                       std::string(mapped_file) +
+                                       "\", \"snapshot\": 1}")),
+                 bundy::InvalidParameter);
+}
+
+TEST_F(ZoneTableSegmentMappedTest, resetFailedSnapshot) {
+    const ConstElementPtr snapshot_params =
+        Element::fromJSON("{\"mapped-file\": \"" + std::string(mapped_file2) +
+                          "\", \"snapshot\": true}");
+
+    // A mapped file that isn't built as a snapshot can't be used as a
+    // snapshot.
+    setupMappedFiles();
+    ztable_segment_->reset(ZoneTableSegment::READ_WRITE, config_params_);
+    EXPECT_THROW(ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                                        snapshot_params), ResetFailed);
+    EXPECT_TRUE(ztable_segment_->isWritable());
+
+    // Corrupt a snapshot.  It can still be opened as a normal mapped file
+    // (as its checksum is only weak), but not as a snapshot.
+    ztable_segment_->reset(ZoneTableSegment::CREATE, snapshot_params);
+    addData(ztable_segment_->getMemorySegment());
+    ztable_segment_->clear();
+    scoped_ptr<MemorySegmentMapped> segment
+        (new MemorySegmentMapped(mapped_file2,
+                                 MemorySegmentMapped::OPEN_OR_CREATE));
+    EXPECT_TRUE(verifyData(*segment));
+    ++*static_cast<int*>(
+        segment->getNamedAddress(test_data_[1].first.c_str()).second);
+    segment.reset();
+    EXPECT_THROW(ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                                        snapshot_params),
+                 ResetFailedAndSegmentCleared);
+    EXPECT_NO_THROW(ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                                           config_params2_));
+
+    // A snapshot of an unknown version can't be opened at all.
+    ztable_segment_->reset(ZoneTableSegment::CREATE, snapshot_params);
+    ztable_segment_->clear();
+    segment.reset(new MemorySegmentMapped(mapped_file2,
+                                          MemorySegmentMapped::OPEN_OR_CREATE));
+    setSnapshotVersion(*segment, 0xffff);
+    segment.reset();
+    EXPECT_THROW(ztable_segment_->reset(ZoneTableSegment::READ_ONLY,
+                                        config_params2_),
+                 ResetFailedAndSegmentCleared);
+    EXPECT_THROW(ztable_segment_->reset(ZoneTableSegment::READ_WRITE,
+                                        snapshot_params),
+                 ResetFailedAndSegmentCleared);
+}
+
 } // anonymous namespace
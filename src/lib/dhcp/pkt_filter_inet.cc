@@ -192,8 +192,6 @@ PktFilterInet::receive(const Iface& iface, const SocketInfo& socket_info) {
 int
 PktFilterInet::send(const Iface&, uint16_t sockfd,
                     const Pkt4Ptr& pkt) {
-    memset(&control_buf_[0], 0, control_buf_len_);
-
     // Set the target address we're sending to.
     sockaddr_in to;
     memset(&to, 0, sizeof(to));
@@ -229,8 +227,16 @@ PktFilterInet::send(const Iface&, uint16_t sockfd,
     // define the IPv4 packet information. We could set the
     // source address if we wanted, but we can safely let the
     // kernel decide what that should be.
-    m.msg_control = &control_buf_[0];
-    m.msg_controllen = control_buf_len_;
+    //
+    // The control buffer is on the stack rather than control_buf_, as
+    // the packets may be sent by other threads than the one receiving.
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    m.msg_control = control.buf;
+    m.msg_controllen = sizeof(control.buf);
     struct cmsghdr* cmsg = CMSG_FIRSTHDR(&m);
     cmsg->cmsg_level = IPPROTO_IP;
     cmsg->cmsg_type = IP_PKTINFO;
@@ -201,8 +201,6 @@ PktFilterInet6::receive(const SocketInfo& socket_info) {
 int
 PktFilterInet6::send(const Iface&, uint16_t sockfd, const Pkt6Ptr& pkt) {
 
-    memset(&control_buf_[0], 0, control_buf_len_);
-
     // Set the target address we're sending to.
     sockaddr_in6 to;
     memset(&to, 0, sizeof(to));
@@ -243,8 +241,16 @@ PktFilterInet6::send(const Iface&, uint16_t sockfd, const Pkt6Ptr& pkt) {
     // define the IPv6 packet information. We could set the
     // source address if we wanted, but we can safely let the
     // kernel decide what that should be.
-    m.msg_control = &control_buf_[0];
-    m.msg_controllen = control_buf_len_;
+    //
+    // The control buffer is on the stack rather than control_buf_, as
+    // the packets may be sent by other threads than the one receiving.
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    m.msg_control = control.buf;
+    m.msg_controllen = sizeof(control.buf);
     struct cmsghdr *cmsg = CMSG_FIRSTHDR(&m);
 
     // FIXME: Code below assumes that cmsg is not NULL, but
@@ -19,12 +19,15 @@
 #include <hooks/server_hooks.h>
 #include <hooks/hooks_manager.h>
 
+#include <boost/functional/hash.hpp>
+
 #include <cstring>
 #include <vector>
 #include <string.h>
 
 using namespace bundy::asiolink;
 using namespace bundy::hooks;
+using bundy::util::thread::Mutex;
 
 namespace {
 
@@ -48,6 +51,62 @@ struct AllocEngineHooks {
 // module is called.
 AllocEngineHooks Hooks;
 
+/// @brief Finds the next free address using the pools' free address maps
+///
+/// The search starts after the last allocated address, goes on in the
+/// following pools and wraps around to the first one, so (if nothing is
+/// known to be in use) it proposes the same addresses as the plain
+/// iterative allocation.
+///
+/// @param pools The pools of the subnet
+/// @param last The last allocated address
+/// @param[out] found The free address
+///
+/// @return false if one of the pools has no map, or no address is known
+///         to be free
+bool
+findFreeAddress(const bundy::dhcp::PoolCollection& pools,
+                const IOAddress& last, IOAddress& found) {
+    size_t start = 0;
+    for (size_t i = 0; i < pools.size(); ++i) {
+        if (!pools[i]->getFreeAddressMap()) {
+            return (false);
+        }
+        if (pools[i]->inRange(last)) {
+            start = i;
+        }
+    }
+
+    const time_t now = time(NULL);
+    for (size_t n = 0; n <= pools.size(); ++n) {
+        const bundy::dhcp::FreeAddressMapPtr& map =
+            pools[(start + n) % pools.size()]->getFreeAddressMap();
+        if (n == 0 ? map->findFree(last, now, found) :
+            map->findFree(now, found)) {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+/// @brief Records a lease in the free address map of its pool
+///
+/// @param subnet The subnet of the lease
+/// @param type The type of the lease
+/// @param lease The lease
+void
+setAddressUsed(const bundy::dhcp::SubnetPtr& subnet,
+               bundy::dhcp::Lease::Type type,
+               const bundy::dhcp::Lease& lease) {
+    const bundy::dhcp::PoolPtr pool = subnet->getPool(type, lease.addr_,
+                                                      false);
+    if (pool && pool->getFreeAddressMap()) {
+        pool->getFreeAddressMap()->setUsed(lease.addr_,
+                                           static_cast<int64_t>(lease.cltt_) +
+                                           lease.valid_lft_);
+    }
+}
+
 }; // anonymous namespace
 
 namespace bundy {
@@ -147,6 +206,8 @@ AllocEngine::IterativeAllocator::pickAddress(const SubnetPtr& subnet,
                                              const DuidPtr&,
                                              const IOAddress&) {
 
+    Mutex::Locker locker(mutex_);
+
     // Is this prefix allocation?
     bool prefix = pool_type_ == Lease::TYPE_PD;
 
@@ -182,7 +243,13 @@ AllocEngine::IterativeAllocator::pickAddress(const SubnetPtr& subnet,
 
     // Ok, we have a pool that the last address belonged to, let's use it.
 
+    // Skip the addresses known to be in use, if we can.
     IOAddress next("::");
+    if (findFreeAddress(pools, last, next)) {
+        subnet->setLastAllocated(pool_type_, next);
+        return (next);
+    }
+
     if (!prefix) {
         next = increaseAddress(last); // basically addr++
     } else {
@@ -459,6 +526,9 @@ AllocEngine::allocateLeases6(const Subnet6Ptr& subnet, const DuidPtr& duid,
                     collection.push_back(existing);
                     return (collection);
                 }
+
+                // Don't propose this one again until the lease expires.
+                setAddressUsed(subnet, type, *existing);
             }
 
             // Continue trying allocation until we run out of attempts
@@ -625,6 +695,9 @@ AllocEngine::allocateLease4(const SubnetPtr& subnet, const ClientIdPtr& clientid
                                               hostname, callout_handle,
                                               fake_allocation));
                 }
+
+                // Don't propose this one again until the lease expires.
+                setAddressUsed(subnet, Lease::TYPE_V4, *existing);
             }
 
             // Continue trying allocation until we run out of attempts
@@ -708,8 +781,13 @@ Lease4Ptr AllocEngine::renewLease4(const SubnetPtr& subnet,
     }
 
     if (!fake_allocation && !skip) {
-        // for REQUEST we do update the lease
-        LeaseMgrFactory::instance().updateLease4(lease);
+        // for REQUEST we do update the lease, unless another thread did
+        // in the meantime
+        if (!updateLease4IfUnchanged(lease, old_values)) {
+            *lease = old_values;
+            return (Lease4Ptr());
+        }
+        setAddressUsed(subnet, Lease::TYPE_V4, *lease);
     }
     if (skip) {
         // Rollback changes (really useful only for memfile)
@@ -735,6 +813,9 @@ Lease6Ptr AllocEngine::reuseExpiredLease(Lease6Ptr& expired,
         bundy_throw(BadValue, "Attempt to recycle lease that is still valid");
     }
 
+    // Another client may be reusing it too
+    const Lease6 original(*expired);
+
     if (expired->type_ != Lease::TYPE_PD) {
         prefix_len = 128; // non-PD lease types must be always /128
     }
@@ -791,8 +872,12 @@ Lease6Ptr AllocEngine::reuseExpiredLease(Lease6Ptr& expired,
     }
 
     if (!fake_allocation) {
-        // for REQUEST we do update the lease
-        LeaseMgrFactory::instance().updateLease6(expired);
+        // for REQUEST we do update the lease, unless another client got
+        // it first
+        if (!updateLease6IfUnchanged(expired, original)) {
+            return (Lease6Ptr());
+        }
+        setAddressUsed(subnet, expired->type_, *expired);
     }
 
     // We do nothing for SOLICIT. We'll just update database when
@@ -817,6 +902,9 @@ Lease4Ptr AllocEngine::reuseExpiredLease(Lease4Ptr& expired,
         bundy_throw(BadValue, "Attempt to recycle lease that is still valid");
     }
 
+    // Another client may be reusing it too
+    const Lease4 original(*expired);
+
     // address, lease type and prefixlen (0) stay the same
     expired->client_id_ = clientid;
     expired->hwaddr_ = hwaddr->hwaddr_;
@@ -872,8 +960,12 @@ Lease4Ptr AllocEngine::reuseExpiredLease(Lease4Ptr& expired,
     }
 
     if (!fake_allocation) {
-        // for REQUEST we do update the lease
-        LeaseMgrFactory::instance().updateLease4(expired);
+        // for REQUEST we do update the lease, unless another client got
+        // it first
+        if (!updateLease4IfUnchanged(expired, original)) {
+            return (Lease4Ptr());
+        }
+        setAddressUsed(subnet, Lease::TYPE_V4, *expired);
     }
 
     // We do nothing for SOLICIT. We'll just update database when
@@ -884,6 +976,51 @@ Lease4Ptr AllocEngine::reuseExpiredLease(Lease4Ptr& expired,
     return (expired);
 }
 
+bool
+AllocEngine::updateLease4IfUnchanged(const Lease4Ptr& lease,
+                                     const Lease4& original) {
+    Mutex::Locker locker(getLeaseLock(original.addr_));
+    const Lease4Ptr current =
+        LeaseMgrFactory::instance().getLease4(original.addr_);
+    if (!current || *current != original) {
+        return (false);
+    }
+    // The lease may still be deleted meanwhile: the release doesn't take
+    // the lock.
+    try {
+        LeaseMgrFactory::instance().updateLease4(lease);
+    } catch (const NoSuchLease&) {
+        return (false);
+    }
+    return (true);
+}
+
+bool
+AllocEngine::updateLease6IfUnchanged(const Lease6Ptr& lease,
+                                     const Lease6& original) {
+    Mutex::Locker locker(getLeaseLock(original.addr_));
+    const Lease6Ptr current =
+        LeaseMgrFactory::instance().getLease6(original.type_, original.addr_);
+    if (!current || *current != original) {
+        return (false);
+    }
+    // The lease may still be deleted meanwhile: the release doesn't take
+    // the lock.
+    try {
+        LeaseMgrFactory::instance().updateLease6(lease);
+    } catch (const NoSuchLease&) {
+        return (false);
+    }
+    return (true);
+}
+
+Mutex&
+AllocEngine::getLeaseLock(const IOAddress& addr) {
+    const std::vector<uint8_t> bytes = addr.toBytes();
+    return (lease_locks_[boost::hash_range(bytes.begin(), bytes.end()) %
+                         LEASE_LOCKS]);
+}
+
 Lease6Ptr AllocEngine::createLease6(const Subnet6Ptr& subnet,
                                     const DuidPtr& duid,
                                     const uint32_t iaid,
@@ -946,7 +1083,7 @@ Lease6Ptr AllocEngine::createLease6(const Subnet6Ptr& subnet,
         bool status = LeaseMgrFactory::instance().addLease(lease);
 
         if (status) {
-
+            setAddressUsed(subnet, type, *lease);
             return (lease);
         } else {
             // One of many failures with LeaseMgr (e.g. lost connection to the
@@ -1042,6 +1179,7 @@ Lease4Ptr AllocEngine::createLease4(const SubnetPtr& subnet,
         // That is a real (REQUEST) allocation
         bool status = LeaseMgrFactory::instance().addLease(lease);
         if (status) {
+            setAddressUsed(subnet, Lease::TYPE_V4, *lease);
             return (lease);
         } else {
             // One of many failures with LeaseMgr (e.g. lost connection to the
@@ -21,6 +21,7 @@
 #include <dhcpsrv/subnet.h>
 #include <dhcpsrv/lease_mgr.h>
 #include <hooks/callout_handle.h>
+#include <util/threads/sync.h>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
@@ -50,6 +51,12 @@ public:
 /// for picking subnets, choosing and allocating a lease, extending,
 /// renewing, releasing and possibly expiring leases.
 ///
+/// The engine may be used by several threads at once (the servers' worker
+/// threads). Two clients may then pick the same free or expired address:
+/// the lease manager rejects the second new lease, and an expired lease is
+/// only reused or a lease renewed if it hasn't changed since it was read,
+/// so the client which lost the race gets another address, or none.
+///
 /// @todo: Does not handle out of leases well
 /// @todo: Does not handle out of allocation attempts well
 class AllocEngine : public boost::noncopyable {
@@ -113,6 +120,12 @@ protected:
     /// a pool iteratively, one after another. Once the last address is reached,
     /// it starts allocating from the beginning of the first pool (i.e. it loops
     /// over).
+    ///
+    /// If all the pools have a free address map (see @ref FreeAddressMap),
+    /// the addresses known to be in use are skipped. The configuration
+    /// manager fills the maps with the leases of the lease database, the
+    /// allocation engine records the leases it allocates or finds there,
+    /// and the servers free the addresses of the released leases.
     class IterativeAllocator : public Allocator {
     public:
 
@@ -134,6 +147,10 @@ protected:
                         const bundy::asiolink::IOAddress& hint);
     protected:
 
+        /// @brief Serializes the picks, which update the last allocated
+        /// address of the subnet
+        bundy::util::thread::Mutex mutex_;
+
         /// @brief Returns an address increased by one
         ///
         /// This method works for both IPv4 and IPv6 addresses. For example,
@@ -354,6 +371,19 @@ protected:
                     const bundy::hooks::CalloutHandlePtr& callout_handle,
                     Lease6Collection& old_leases);
 
+    /// @brief Updates an IPv6 lease unless it changed meanwhile
+    ///
+    /// Another thread may have updated (or deleted) the lease since it was
+    /// read, e.g. reused it for another client after it expired. The lease
+    /// is only updated if the lease manager still holds @c original. The
+    /// server uses this when extending the leases of a client.
+    ///
+    /// @param lease The updated lease
+    /// @param original The lease as it was read
+    /// @return true if the lease was updated
+    bool updateLease6IfUnchanged(const Lease6Ptr& lease,
+                                 const Lease6& original);
+
     /// @brief returns allocator for a given pool type
     /// @param type type of pool (V4, IA, TA or PD)
     /// @throw BadValue if allocator for a given type is missing
@@ -496,6 +526,27 @@ private:
                                 const bundy::hooks::CalloutHandlePtr& callout_handle,
                                 bool fake_allocation = false);
 
+    /// @brief Updates an IPv4 lease unless it changed meanwhile
+    ///
+    /// Another thread may have updated (or deleted) the lease since it was
+    /// read. The lease is only updated if the lease manager still holds
+    /// @c original, so two clients can't both get an address. The lease
+    /// isn't updated either if it is deleted (released) meanwhile.
+    ///
+    /// @param lease The updated lease
+    /// @param original The lease as it was read
+    /// @return true if the lease was updated
+    bool updateLease4IfUnchanged(const Lease4Ptr& lease,
+                                 const Lease4& original);
+
+    /// @brief Returns the lock of the leases of an address
+    ///
+    /// An address hashes to one of a fixed set of locks, held while a
+    /// lease is checked and updated.
+    ///
+    /// @param addr The address
+    bundy::util::thread::Mutex& getLeaseLock(const bundy::asiolink::IOAddress& addr);
+
     /// @brief Updates FQDN data for a collection of leases.
     ///
     /// @param leases Collection of leases for which FQDN data should be
@@ -527,6 +578,12 @@ private:
     /// @brief number of attempts before we give up lease allocation (0=unlimited)
     unsigned int attempts_;
 
+    /// @brief Number of the locks of the leases
+    static const size_t LEASE_LOCKS = 64;
+
+    /// @brief The locks of the leases (see @c getLeaseLock)
+    bundy::util::thread::Mutex lease_locks_[LEASE_LOCKS];
+
     // hook name indexes (used in hooks callouts)
     int hook_index_lease4_select_; ///< index for lease4_select hook
     int hook_index_lease6_select_; ///< index for lease6_select hook
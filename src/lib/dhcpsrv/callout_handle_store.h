@@ -27,24 +27,21 @@ namespace dhcp {
 /// bundy::hooks::CalloutHandle object with each request passing through the
 /// server.  For the DHCP servers, the association is provided by this function.
 ///
-/// The DHCP servers process a single request at a time. At points where the
-/// CalloutHandle is required, the pointer to the current request (packet) is
-/// passed to this function.  If the request is a new one, a pointer to
-/// the request is stored, a new CalloutHandle is allocated (and stored) and
-/// a pointer to the latter object returned to the caller.  If the request
-/// matches the one stored, the pointer to the stored CalloutHandle is
-/// returned.
+/// Each thread of the DHCP servers processes a single request at a time. At
+/// points where the CalloutHandle is required, the pointer to the current
+/// request (packet) is passed to this function.  If the request is a new
+/// one, a pointer to the request is stored, a new CalloutHandle is allocated
+/// (and stored) and a pointer to the latter object returned to the caller.
+/// If the request matches the one stored, the pointer to the stored
+/// CalloutHandle is returned.  The pointers are stored per thread, so the
+/// requests processed by the worker threads of a server at the same time
+/// get their own handles.
 ///
 /// A special case is a null pointer being passed.  This has the effect of
 /// clearing the stored pointers to the packet being processed and
 /// CalloutHandle.  As the stored pointers are shared pointers, clearing them
 /// removes one reference that keeps the pointed-to objects in existence.
 ///
-/// @note If the behaviour of the server changes so that multiple packets can
-///       be active at the same time, this simplistic approach will no longer
-///       be adequate and a more complicated structure (such as a map) will
-///       be needed.
-///
 /// @param pktptr Pointer to the packet being processed.  This is typically a
 ///        Pkt4Ptr or Pkt6Ptr object.  An empty pointer is passed to clear
 ///        the stored pointers.
@@ -58,8 +55,9 @@ template <typename T>
 bundy::hooks::CalloutHandlePtr getCalloutHandle(const T& pktptr) {
 
     // Stored data is declared static, so is initialized when first accessed
-    static T stored_pointer;                // Pointer to last packet seen
-    static bundy::hooks::CalloutHandlePtr stored_handle;
+    // (by each thread)
+    static thread_local T stored_pointer;   // Pointer to last packet seen
+    static thread_local bundy::hooks::CalloutHandlePtr stored_handle;
                                             // Pointer to stored handle
 
     if (pktptr) {
@@ -17,10 +17,117 @@
 #include <dhcp/libdhcp++.h>
 #include <dhcpsrv/cfgmgr.h>
 #include <dhcpsrv/dhcpsrv_log.h>
+#include <dhcpsrv/lease_mgr_factory.h>
 #include <string>
 
 using namespace bundy::asiolink;
 using namespace bundy::util;
+using bundy::util::thread::Mutex;
+
+namespace {
+
+/// @brief Returns the current index of the subnets, building it if needed
+///
+/// @param current The index published
+/// @param indexes The owners of the index and of those it replaced
+/// @param subnets The subnets
+/// @param mutex Serializes the builds
+template<typename IndexType, typename SubnetPtrType>
+const IndexType&
+getIndex(std::atomic<const IndexType*>& current,
+         std::vector<boost::shared_ptr<const IndexType> >& indexes,
+         const std::vector<SubnetPtrType>& subnets, Mutex& mutex) {
+    const IndexType* index = current.load(std::memory_order_acquire);
+    if (index && index->isCurrent()) {
+        return (*index);
+    }
+    Mutex::Locker locker(mutex);
+    index = current.load(std::memory_order_relaxed);
+    if (!index || !index->isCurrent()) {
+        indexes.push_back(boost::shared_ptr<const IndexType>(
+                              new IndexType(subnets)));
+        index = indexes.back().get();
+        current.store(index, std::memory_order_release);
+    }
+    return (*index);
+}
+
+/// @brief Returns the type of the pool of an IPv4 lease
+bundy::dhcp::Lease::Type
+getPoolType(const bundy::dhcp::Lease4&) {
+    return (bundy::dhcp::Lease::TYPE_V4);
+}
+
+/// @brief Returns the type of the pool of an IPv6 lease
+bundy::dhcp::Lease::Type
+getPoolType(const bundy::dhcp::Lease6& lease) {
+    return (lease.type_);
+}
+
+/// @brief Returns the free address map of the pool of a lease
+///
+/// The subnet is looked up by identifier and, as the identifiers may
+/// change with the configuration, by address.
+///
+/// @param index The index of the subnets
+/// @param lease The lease
+/// @return The map, or NULL if the lease is in no pool or the pool has none
+template<typename IndexType, typename LeaseType>
+bundy::dhcp::FreeAddressMapPtr
+getFreeAddressMap(const IndexType& index, const LeaseType& lease) {
+    const bundy::dhcp::Lease::Type type = getPoolType(lease);
+    bundy::dhcp::SubnetPtr subnet = index.getById(lease.subnet_id_);
+    bundy::dhcp::PoolPtr pool;
+    if (subnet) {
+        pool = subnet->getPool(type, lease.addr_, false);
+    }
+    if (!pool) {
+        typename IndexType::Positions positions;
+        index.getByAddress(lease.addr_, false, positions);
+        for (size_t i = 0; i < positions.size() && !pool; ++i) {
+            pool = index.getSubnet(positions[i])->getPool(type, lease.addr_,
+                                                          false);
+        }
+    }
+    return (pool ? pool->getFreeAddressMap() :
+            bundy::dhcp::FreeAddressMapPtr());
+}
+
+/// @brief Records the leases in the free address maps of their pools
+///
+/// @param index The index of the subnets
+/// @param leases The leases
+/// @return The number of leases recorded
+template<typename IndexType, typename LeaseCollection>
+size_t
+recordLeases(const IndexType& index, const LeaseCollection& leases) {
+    size_t count = 0;
+    for (typename LeaseCollection::const_iterator lease = leases.begin();
+         lease != leases.end(); ++lease) {
+        const bundy::dhcp::FreeAddressMapPtr map =
+            getFreeAddressMap(index, **lease);
+        if (map) {
+            map->setUsed((*lease)->addr_,
+                         static_cast<int64_t>((*lease)->cltt_) +
+                         (*lease)->valid_lft_);
+            ++count;
+        }
+    }
+    return (count);
+}
+
+/// @brief Discards the indexes of the subnets after they changed
+template<typename IndexType>
+void
+resetIndex(std::atomic<const IndexType*>& current,
+           std::vector<boost::shared_ptr<const IndexType> >& indexes,
+           Mutex& mutex) {
+    Mutex::Locker locker(mutex);
+    current.store(NULL, std::memory_order_release);
+    indexes.clear();
+}
+
+}
 
 namespace bundy {
 namespace dhcp {
@@ -134,20 +241,21 @@ CfgMgr::getSubnet6(const std::string& iface,
     }
 
     // If there is more than one, we need to choose the proper one
-    for (Subnet6Collection::iterator subnet = subnets6_.begin();
-         subnet != subnets6_.end(); ++subnet) {
+    const Subnet6Index& index = getSubnet6Index();
+    const Subnet6Index::Positions& positions = index.getByIface(iface);
+    for (Subnet6Index::Positions::const_iterator pos = positions.begin();
+         pos != positions.end(); ++pos) {
+        const Subnet6Ptr& subnet = index.getSubnet(*pos);
 
         // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
+        if (!subnet->clientSupported(classes)) {
             continue;
         }
 
-        if (iface == (*subnet)->getIface()) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET6_IFACE)
-                .arg((*subnet)->toText()).arg(iface);
-            return (*subnet);
-        }
+        LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                  DHCPSRV_CFGMGR_SUBNET6_IFACE)
+            .arg(subnet->toText()).arg(iface);
+        return (subnet);
     }
     return (Subnet6Ptr());
 }
@@ -157,29 +265,33 @@ CfgMgr::getSubnet6(const bundy::asiolink::IOAddress& hint,
                    const bundy::dhcp::ClientClasses& classes,
                    const bool relay) {
 
-    // If there is more than one, we need to choose the proper one
-    for (Subnet6Collection::iterator subnet = subnets6_.begin();
-         subnet != subnets6_.end(); ++subnet) {
+    // If there is more than one, we need to choose the proper one.  The
+    // index gives the subnets containing the hint (or relayed by it) in
+    // the order of the configuration.
+    const Subnet6Index& index = getSubnet6Index();
+    Subnet6Index::Positions positions;
+    index.getByAddress(hint, relay, positions);
+    for (Subnet6Index::Positions::const_iterator pos = positions.begin();
+         pos != positions.end(); ++pos) {
+        const Subnet6Ptr& subnet = index.getSubnet(*pos);
 
         // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
+        if (!subnet->clientSupported(classes)) {
             continue;
         }
 
         // If the hint is a relay address, and there is relay info specified
         // for this subnet and those two match, then use this subnet.
-        if (relay && ((*subnet)->getRelayInfo().addr_ == hint) ) {
+        if (relay && (subnet->getRelayInfo().addr_ == hint) ) {
             LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
                       DHCPSRV_CFGMGR_SUBNET6_RELAY)
-                .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
+                .arg(subnet->toText()).arg(hint.toText());
+            return (subnet);
         }
 
-        if ((*subnet)->inRange(hint)) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_SUBNET6)
-                      .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
-        }
+        LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_SUBNET6)
+                  .arg(subnet->toText()).arg(hint.toText());
+        return (subnet);
     }
 
     // sorry, we don't support that subnet
@@ -194,23 +306,24 @@ Subnet6Ptr CfgMgr::getSubnet6(OptionPtr iface_id_option,
         return (Subnet6Ptr());
     }
 
-    // Let's iterate over all subnets and for those that have interface-id
-    // defined, check if the interface-id is equal to what we are looking for
-    for (Subnet6Collection::iterator subnet = subnets6_.begin();
-         subnet != subnets6_.end(); ++subnet) {
+    // Let's look at the subnets that have interface-id defined and equal
+    // to what we are looking for
+    const Subnet6Index& index = getSubnet6Index();
+    const Subnet6Index::Positions& positions =
+        index.getByInterfaceId(iface_id_option);
+    for (Subnet6Index::Positions::const_iterator pos = positions.begin();
+         pos != positions.end(); ++pos) {
+        const Subnet6Ptr& subnet = index.getSubnet(*pos);
 
         // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
+        if (!subnet->clientSupported(classes)) {
             continue;
         }
 
-        if ( (*subnet)->getInterfaceId() &&
-             ((*subnet)->getInterfaceId()->equal(iface_id_option))) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET6_IFACE_ID)
-                .arg((*subnet)->toText());
-            return (*subnet);
-        }
+        LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                  DHCPSRV_CFGMGR_SUBNET6_IFACE_ID)
+            .arg(subnet->toText());
+        return (subnet);
     }
     return (Subnet6Ptr());
 }
@@ -226,38 +339,42 @@ void CfgMgr::addSubnet6(const Subnet6Ptr& subnet) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_ADD_SUBNET6)
               .arg(subnet->toText());
     subnets6_.push_back(subnet);
+    resetIndex(subnets6_index_, subnets6_indexes_, subnets_index_mutex_);
 }
 
 Subnet4Ptr
 CfgMgr::getSubnet4(const bundy::asiolink::IOAddress& hint,
                    const bundy::dhcp::ClientClasses& classes,
                    bool relay) const {
-    // Iterate over existing subnets to find a suitable one for the
-    // given address.
-    for (Subnet4Collection::const_iterator subnet = subnets4_.begin();
-         subnet != subnets4_.end(); ++subnet) {
+    // Look up the subnets containing the given address (or relayed by
+    // it) to find a suitable one.  The index returns them in the order of
+    // the configuration.
+    const Subnet4Index& index = getSubnet4Index();
+    Subnet4Index::Positions positions;
+    index.getByAddress(hint, relay, positions);
+    for (Subnet4Index::Positions::const_iterator pos = positions.begin();
+         pos != positions.end(); ++pos) {
+        const Subnet4Ptr& subnet = index.getSubnet(*pos);
 
         // If client is rejected because of not meeting client class criteria...
-        if (!(*subnet)->clientSupported(classes)) {
+        if (!subnet->clientSupported(classes)) {
             continue;
         }
 
         // If the hint is a relay address, and there is relay info specified
         // for this subnet and those two match, then use this subnet.
-        if (relay && ((*subnet)->getRelayInfo().addr_ == hint) ) {
+        if (relay && (subnet->getRelayInfo().addr_ == hint) ) {
             LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
                       DHCPSRV_CFGMGR_SUBNET4_RELAY)
-                .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
+                .arg(subnet->toText()).arg(hint.toText());
+            return (subnet);
         }
 
-        // Let's check if the client belongs to the given subnet
-        if ((*subnet)->inRange(hint)) {
-            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
-                      DHCPSRV_CFGMGR_SUBNET4)
-                      .arg((*subnet)->toText()).arg(hint.toText());
-            return (*subnet);
-        }
+        // Otherwise the client belongs to the given subnet
+        LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                  DHCPSRV_CFGMGR_SUBNET4)
+                  .arg(subnet->toText()).arg(hint.toText());
+        return (subnet);
     }
 
     // sorry, we don't support that subnet
@@ -293,6 +410,7 @@ void CfgMgr::addSubnet4(const Subnet4Ptr& subnet) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_ADD_SUBNET4)
               .arg(subnet->toText());
     subnets4_.push_back(subnet);
+    resetIndex(subnets4_index_, subnets4_indexes_, subnets_index_mutex_);
 }
 
 void CfgMgr::deleteOptionDefs() {
@@ -302,11 +420,59 @@ void CfgMgr::deleteOptionDefs() {
 void CfgMgr::deleteSubnets4() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_DELETE_SUBNET4);
     subnets4_.clear();
+    resetIndex(subnets4_index_, subnets4_indexes_, subnets_index_mutex_);
+}
+
+void CfgMgr::commitSubnets4() {
+    const Subnet4Index& index = getSubnet4Index();
+    if (LeaseMgrFactory::haveInstance()) {
+        try {
+            const size_t count =
+                recordLeases(index, LeaseMgrFactory::instance().getLeases4());
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                      DHCPSRV_CFGMGR_LOAD_LEASES).arg(count);
+        } catch (const bundy::Exception& ex) {
+            LOG_WARN(dhcpsrv_logger, DHCPSRV_CFGMGR_LOAD_LEASES_FAIL)
+                .arg(ex.what());
+        }
+    }
+}
+
+void CfgMgr::setAddressFree(const Lease4& lease) const {
+    const FreeAddressMapPtr map = getFreeAddressMap(getSubnet4Index(),
+                                                    lease);
+    if (map) {
+        map->setFree(lease.addr_);
+    }
 }
 
 void CfgMgr::deleteSubnets6() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE, DHCPSRV_CFGMGR_DELETE_SUBNET6);
     subnets6_.clear();
+    resetIndex(subnets6_index_, subnets6_indexes_, subnets_index_mutex_);
+}
+
+void CfgMgr::commitSubnets6() {
+    const Subnet6Index& index = getSubnet6Index();
+    if (LeaseMgrFactory::haveInstance()) {
+        try {
+            const size_t count =
+                recordLeases(index, LeaseMgrFactory::instance().getLeases6());
+            LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE,
+                      DHCPSRV_CFGMGR_LOAD_LEASES).arg(count);
+        } catch (const bundy::Exception& ex) {
+            LOG_WARN(dhcpsrv_logger, DHCPSRV_CFGMGR_LOAD_LEASES_FAIL)
+                .arg(ex.what());
+        }
+    }
+}
+
+void CfgMgr::setAddressFree(const Lease6& lease) const {
+    const FreeAddressMapPtr map = getFreeAddressMap(getSubnet6Index(),
+                                                    lease);
+    if (map) {
+        map->setFree(lease.addr_);
+    }
 }
 
 
@@ -385,6 +551,18 @@ CfgMgr::isIfaceListedActive(const std::string& iface) const {
     return (false);
 }
 
+const Subnet4Index&
+CfgMgr::getSubnet4Index() const {
+    return (getIndex(subnets4_index_, subnets4_indexes_, subnets4_,
+                     subnets_index_mutex_));
+}
+
+const Subnet6Index&
+CfgMgr::getSubnet6Index() const {
+    return (getIndex(subnets6_index_, subnets6_indexes_, subnets6_,
+                     subnets_index_mutex_));
+}
+
 bool
 CfgMgr::isDuplicate(const Subnet4& subnet) const {
     for (Subnet4Collection::const_iterator subnet_it = subnets4_.begin();
@@ -440,7 +618,7 @@ CfgMgr::getD2ClientMgr() {
 CfgMgr::CfgMgr()
     : datadir_(DHCP_DATA_DIR),
       all_ifaces_active_(false), echo_v4_client_id_(true),
-      d2_client_mgr_() {
+      d2_client_mgr_(), subnets4_index_(NULL), subnets6_index_(NULL) {
     // DHCP_DATA_DIR must be set set with -DDHCP_DATA_DIR="..." in Makefile.am
     // Note: the definition of DHCP_DATA_DIR needs to include quotation marks
     // See AM_CPPFLAGS definition in Makefile.am
@@ -24,11 +24,14 @@
 #include <dhcpsrv/option_space_container.h>
 #include <dhcpsrv/pool.h>
 #include <dhcpsrv/subnet.h>
+#include <dhcpsrv/subnet_index.h>
 #include <util/buffer.h>
+#include <util/threads/sync.h>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <vector>
@@ -249,6 +252,19 @@ public:
     /// completely new?
     void deleteSubnets6();
 
+    /// @brief Builds the index of the IPv6 subnets
+    ///
+    /// See @ref commitSubnets4.
+    void commitSubnets6();
+
+    /// @brief Records that the address (or prefix) of an IPv6 lease is
+    /// free again
+    ///
+    /// See @ref setAddressFree(const Lease4&) const.
+    ///
+    /// @param lease The lease
+    void setAddressFree(const Lease6& lease) const;
+
     /// @brief returns const reference to all subnets6
     ///
     /// This is used in a hook (subnet4_select), where the hook is able
@@ -325,6 +341,32 @@ public:
     /// completely new?
     void deleteSubnets4();
 
+    /// @brief Builds the index of the IPv4 subnets
+    ///
+    /// This is called once all the subnets of a new configuration are
+    /// added, so the index is ready when the packets are processed again:
+    /// the subnet lookups then only read it, without any lock. (It's also
+    /// built by the first lookup if this isn't called.)
+    ///
+    /// The subnets must not be added or deleted during a lookup, so the
+    /// servers process no packet while they are configured.
+    ///
+    /// The leases of the lease database, if there is one, are then recorded
+    /// in the free address maps of their pools (see @ref FreeAddressMap),
+    /// which are new with the subnets. A failure to get them is logged: the
+    /// maps are only hints for the allocation engine.
+    void commitSubnets4();
+
+    /// @brief Records that the address of an IPv4 lease is free again
+    ///
+    /// The server calls this when it deletes a lease (e.g. the client
+    /// released it), so the allocation engine may propose the address
+    /// again. Nothing is done if the lease is in no pool with a free
+    /// address map.
+    ///
+    /// @param lease The lease
+    void setAddressFree(const Lease4& lease) const;
+
 
     /// @brief returns path do the data directory
     ///
@@ -435,22 +477,37 @@ protected:
 
     /// @brief a container for IPv6 subnets.
     ///
-    /// That is a simple vector of pointers. It does not make much sense to
-    /// optimize access time (e.g. using a map), because typical search
-    /// pattern will use calling inRange() method on each subnet until
-    /// a match is found.
+    /// That is a simple vector of pointers, in the order of the
+    /// configuration. The lookups use an index built from it
+    /// (see @ref getSubnet6Index).
     Subnet6Collection subnets6_;
 
     /// @brief a container for IPv4 subnets.
     ///
-    /// That is a simple vector of pointers. It does not make much sense to
-    /// optimize access time (e.g. using a map), because typical search
-    /// pattern will use calling inRange() method on each subnet until
-    /// a match is found.
+    /// That is a simple vector of pointers, in the order of the
+    /// configuration. The lookups use an index built from it
+    /// (see @ref getSubnet4Index).
     Subnet4Collection subnets4_;
 
 private:
 
+    /// @brief Returns the index of the IPv4 subnets
+    ///
+    /// The index is normally built by @ref commitSubnets4. If it's out of
+    /// date because the interface names or relay information of subnets
+    /// have changed since, it's rebuilt and replaced as a whole, so a
+    /// lookup in progress keeps using the old one.
+    ///
+    /// @return the index of @c subnets4_
+    const Subnet4Index& getSubnet4Index() const;
+
+    /// @brief Returns the index of the IPv6 subnets
+    ///
+    /// See @ref getSubnet4Index.
+    ///
+    /// @return the index of @c subnets6_
+    const Subnet6Index& getSubnet6Index() const;
+
     /// @brief Checks if the specified interface is listed as active.
     ///
     /// This function searches for the specified interface name on the list of
@@ -516,6 +573,22 @@ private:
 
     /// @brief Manages the DHCP-DDNS client and its configuration.
     D2ClientMgr d2_client_mgr_;
+
+    /// @name Indexes of the subnets
+    ///
+    /// The current index is published through an atomic pointer, NULL
+    /// when the subnets have changed, so the lookups take no lock. The
+    /// indexes are owned by the vectors, which keep the replaced ones
+    /// until the subnets are added or deleted again.
+    //@{
+    mutable std::atomic<const Subnet4Index*> subnets4_index_;
+    mutable std::vector<Subnet4IndexPtr> subnets4_indexes_;
+    mutable std::atomic<const Subnet6Index*> subnets6_index_;
+    mutable std::vector<Subnet6IndexPtr> subnets6_indexes_;
+    //@}
+
+    /// @brief Serializes the builds of the indexes of the subnets
+    mutable bundy::util::thread::Mutex subnets_index_mutex_;
 };
 
 } // namespace bundy::dhcp
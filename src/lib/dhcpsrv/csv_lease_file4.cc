@@ -27,6 +27,16 @@ CSVLeaseFile4::CSVLeaseFile4(const std::string& filename)
 
 void
 CSVLeaseFile4::append(const Lease4& lease) const {
+    CSVFile::append(makeRow(lease));
+}
+
+std::string
+CSVLeaseFile4::render(const Lease4& lease) const {
+    return (makeRow(lease).render());
+}
+
+CSVRow
+CSVLeaseFile4::makeRow(const Lease4& lease) const {
     CSVRow row(getColumnCount());
     row.writeAt(getColumnIndex("address"), lease.addr_.toText());
     HWAddr hwaddr(lease.hwaddr_, HTYPE_ETHER);
@@ -41,7 +51,7 @@ CSVLeaseFile4::append(const Lease4& lease) const {
     row.writeAt(getColumnIndex("fqdn_fwd"), lease.fqdn_fwd_);
     row.writeAt(getColumnIndex("fqdn_rev"), lease.fqdn_rev_);
     row.writeAt(getColumnIndex("hostname"), lease.hostname_);
-    CSVFile::append(row);
+    return (row);
 }
 
 bool
@@ -27,6 +27,16 @@ CSVLeaseFile6::CSVLeaseFile6(const std::string& filename)
 
 void
 CSVLeaseFile6::append(const Lease6& lease) const {
+    CSVFile::append(makeRow(lease));
+}
+
+std::string
+CSVLeaseFile6::render(const Lease6& lease) const {
+    return (makeRow(lease).render());
+}
+
+CSVRow
+CSVLeaseFile6::makeRow(const Lease6& lease) const {
     CSVRow row(getColumnCount());
     row.writeAt(getColumnIndex("address"), lease.addr_.toText());
     row.writeAt(getColumnIndex("duid"), lease.duid_->toText());
@@ -41,7 +51,7 @@ CSVLeaseFile6::append(const Lease6& lease) const {
     row.writeAt(getColumnIndex("fqdn_fwd"), lease.fqdn_fwd_);
     row.writeAt(getColumnIndex("fqdn_rev"), lease.fqdn_rev_);
     row.writeAt(getColumnIndex("hostname"), lease.hostname_);
-    CSVFile::append(row);
+    return (row);
 }
 
 bool
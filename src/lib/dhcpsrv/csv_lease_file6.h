@@ -57,6 +57,17 @@ public:
     /// @param lease Structure representing a DHCPv6 lease.
     void append(const Lease6& lease) const;
 
+    /// @brief Returns the text of the lease record.
+    ///
+    /// The text is the CSV row written by @c append for the lease, without
+    /// the line terminator. It is used to write the lease records to the
+    /// lease file by other means than this object.
+    ///
+    /// @param lease Structure representing a DHCPv6 lease.
+    ///
+    /// @return Text of the CSV row.
+    std::string render(const Lease6& lease) const;
+
     /// @brief Reads next lease from the CSV file.
     ///
     /// If this function hits an error during lease read, it sets the error
@@ -79,6 +90,11 @@ public:
 
 private:
 
+    /// @brief Creates the CSV row holding the lease.
+    ///
+    /// @param lease Structure representing a DHCPv6 lease.
+    bundy::util::CSVRow makeRow(const Lease6& lease) const;
+
     /// @brief Initializes columns of the CSV file holding leases.
     ///
     /// This function initializes the following columns:
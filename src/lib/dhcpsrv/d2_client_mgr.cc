@@ -273,6 +273,7 @@ D2ClientMgr::sendRequest(dhcp_ddns::NameChangeRequestPtr& ncr) {
         bundy_throw(D2ClientError, "D2ClientMgr::sendRequest not in send mode");
     }
 
+    bundy::util::thread::Mutex::Locker locker(mutex_);
     try {
         name_change_sender_->sendRequest(ncr);
     } catch (const std::exception& ex) {
@@ -367,6 +368,7 @@ D2ClientMgr::runReadyIO() {
                   " name_change_sender is null");
     }
 
+    bundy::util::thread::Mutex::Locker locker(mutex_);
     name_change_sender_->runReadyIO();
 }
 
@@ -23,6 +23,7 @@
 #include <dhcp_ddns/ncr_io.h>
 #include <dhcpsrv/d2_client_cfg.h>
 #include <exceptions/exceptions.h>
+#include <util/threads/sync.h>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
@@ -81,6 +82,11 @@ boost::function<void(const dhcp_ddns::NameChangeSender::Result result,
 /// into the sender.  Using a private service isolates the sender's IO from
 /// any other services.
 ///
+/// The servers' worker threads may send requests at the same time, while
+/// the sender's IO is processed by the thread monitoring the select-fd:
+/// sendRequest() and runReadyIO() are serialized by a mutex. The error
+/// handler is called with this mutex held, so it must not send requests.
+///
 class D2ClientMgr : public dhcp_ddns::NameChangeSender::RequestSendHandler,
                     boost::noncopyable {
 public:
@@ -425,6 +431,10 @@ private:
 
     /// @brief Remembers the select-fd registered with IfaceMgr.
     int registered_select_fd_;
+
+    /// @brief Serializes the use of the sender by sendRequest() and
+    /// runReadyIO().
+    bundy::util::thread::Mutex mutex_;
 };
 
 template <class T>
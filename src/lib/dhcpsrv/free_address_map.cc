@@ -0,0 +1,272 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/free_address_map.h>
+#include <exceptions/exceptions.h>
+
+#include <algorithm>
+#include <limits>
+
+using namespace bundy::asiolink;
+using bundy::util::thread::Mutex;
+
+namespace {
+
+/// @brief An address as a 128-bit unsigned number
+struct Number {
+    uint64_t hi_;
+    uint64_t lo_;
+};
+
+Number
+toNumber(const std::vector<uint8_t>& bytes) {
+    Number n = { 0, 0 };
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        n.hi_ = (n.hi_ << 8) | (n.lo_ >> 56);
+        n.lo_ = (n.lo_ << 8) | bytes[i];
+    }
+    return (n);
+}
+
+/// @brief Computes (a - b) >> shift
+///
+/// @return false if a < b or the result doesn't fit in 64 bits
+bool
+getDistance(const Number& a, const Number& b, unsigned int shift,
+            uint64_t& result)
+{
+    if (a.hi_ < b.hi_ || (a.hi_ == b.hi_ && a.lo_ < b.lo_)) {
+        return (false);
+    }
+    Number diff;
+    diff.lo_ = a.lo_ - b.lo_;
+    diff.hi_ = a.hi_ - b.hi_ - (a.lo_ < b.lo_ ? 1 : 0);
+    if (shift >= 64) {
+        result = diff.hi_ >> (shift - 64);
+        return (true);
+    }
+    if (shift > 0) {
+        if ((diff.hi_ >> shift) != 0) {
+            return (false);
+        }
+        result = (diff.lo_ >> shift) | (diff.hi_ << (64 - shift));
+        return (true);
+    }
+    if (diff.hi_ != 0) {
+        return (false);
+    }
+    result = diff.lo_;
+    return (true);
+}
+
+}
+
+namespace bundy {
+namespace dhcp {
+
+const uint64_t FreeAddressMap::MAX_SIZE;
+
+FreeAddressMap::FreeAddressMap(const IOAddress& first, const IOAddress& last,
+                               uint8_t prefix_len) :
+    first_(first.toBytes()),
+    shift_(first_.size() * 8 - prefix_len),
+    family_(first.getFamily()),
+    size_(getSize(first, last, prefix_len)),
+    leaves_(1)
+{
+    if (size_ == 0) {
+        bundy_throw(BadValue, "Unable to index the pool " << first << "-"
+                    << last << "/" << static_cast<int>(prefix_len));
+    }
+    while (leaves_ < size_) {
+        leaves_ *= 2;
+    }
+    // All the addresses are free, and the leaves past the pool never are.
+    tree_.resize(leaves_ * 2, 0);
+    for (uint64_t node = leaves_ + size_; node < leaves_ * 2; ++node) {
+        tree_[node] = std::numeric_limits<uint32_t>::max();
+    }
+    for (uint64_t node = leaves_ - 1; node > 0; --node) {
+        tree_[node] = std::min(tree_[node * 2], tree_[node * 2 + 1]);
+    }
+}
+
+uint64_t
+FreeAddressMap::getSize(const IOAddress& first, const IOAddress& last,
+                        uint8_t prefix_len)
+{
+    const std::vector<uint8_t> first_bytes(first.toBytes());
+    const std::vector<uint8_t> last_bytes(last.toBytes());
+    if (first_bytes.size() != last_bytes.size() || prefix_len == 0 ||
+        prefix_len > first_bytes.size() * 8) {
+        return (0);
+    }
+    uint64_t distance;
+    if (!getDistance(toNumber(last_bytes), toNumber(first_bytes),
+                     first_bytes.size() * 8 - prefix_len, distance) ||
+        distance >= MAX_SIZE) {
+        return (0);
+    }
+    return (distance + 1);
+}
+
+uint64_t
+FreeAddressMap::toIndex(const IOAddress& addr) const {
+    if (addr.getFamily() != family_) {
+        return (size_);
+    }
+    uint64_t index;
+    if (!getDistance(toNumber(addr.toBytes()), toNumber(first_), shift_,
+                     index) || index >= size_) {
+        return (size_);
+    }
+    return (index);
+}
+
+IOAddress
+FreeAddressMap::toAddress(uint64_t index) const {
+    // Add (index << shift_) to the first address, byte by byte from the
+    // least significant one.
+    std::vector<uint8_t> bytes(first_);
+    unsigned int carry = 0;
+    unsigned int bit = shift_;
+    for (int i = bytes.size() - 1; i >= 0; --i) {
+        const unsigned int byte_bit = (bytes.size() - 1 - i) * 8;
+        unsigned int add = 0;
+        // The bits of (index << shift_) in this byte
+        if (byte_bit + 8 > bit && byte_bit < bit + 64) {
+            if (byte_bit >= bit) {
+                add = (index >> (byte_bit - bit)) & 0xff;
+            } else {
+                add = (index << (bit - byte_bit)) & 0xff;
+            }
+        }
+        const unsigned int sum = bytes[i] + add + carry;
+        bytes[i] = sum & 0xff;
+        carry = sum >> 8;
+    }
+    return (IOAddress::fromBytes(family_, &bytes[0]));
+}
+
+void
+FreeAddressMap::setExpire(uint64_t index, uint32_t expire) {
+    uint64_t node = leaves_ + index;
+    tree_[node] = expire;
+    for (node /= 2; node > 0; node /= 2) {
+        const uint32_t earliest = std::min(tree_[node * 2],
+                                           tree_[node * 2 + 1]);
+        if (tree_[node] == earliest) {
+            break;
+        }
+        tree_[node] = earliest;
+    }
+}
+
+void
+FreeAddressMap::setUsed(const IOAddress& addr, time_t expire) {
+    const uint64_t index = toIndex(addr);
+    if (index < size_) {
+        if (expire <= 0) {
+            expire = 1;
+        } else if (static_cast<uint64_t>(expire) >
+                   std::numeric_limits<uint32_t>::max()) {
+            expire = std::numeric_limits<uint32_t>::max();
+        }
+        Mutex::Locker locker(mutex_);
+        setExpire(index, expire);
+    }
+}
+
+void
+FreeAddressMap::setFree(const IOAddress& addr) {
+    const uint64_t index = toIndex(addr);
+    if (index < size_) {
+        Mutex::Locker locker(mutex_);
+        setExpire(index, 0);
+    }
+}
+
+bool
+FreeAddressMap::isFree(const IOAddress& addr, time_t now) const {
+    const uint64_t index = toIndex(addr);
+    if (index >= size_) {
+        return (false);
+    }
+    Mutex::Locker locker(mutex_);
+    return (tree_[leaves_ + index] < now);
+}
+
+bool
+FreeAddressMap::findFree(const IOAddress& after, time_t now,
+                         IOAddress& found) const
+{
+    const uint64_t index = toIndex(after);
+    return (findFreeFrom(index < size_ ? index + 1 : 0, now, found));
+}
+
+bool
+FreeAddressMap::findFree(time_t now, IOAddress& found) const {
+    return (findFreeFrom(0, now, found));
+}
+
+bool
+FreeAddressMap::findFreeFrom(uint64_t index, time_t now,
+                             IOAddress& found) const
+{
+    if (index >= size_) {
+        return (false);
+    }
+    Mutex::Locker locker(mutex_);
+    uint64_t node = leaves_ + index;
+    if (tree_[node] >= now) {
+        // Go up until a subtree on the right of the leaf has a free entry.
+        do {
+            while (node % 2 == 1) {
+                node /= 2;
+            }
+            if (node == 0) {
+                // We were in the rightmost subtree at each level.
+                return (false);
+            }
+            ++node;
+        } while (tree_[node] >= now);
+        // Then down to its leftmost free entry.
+        while (node < leaves_) {
+            node *= 2;
+            if (tree_[node] >= now) {
+                ++node;
+            }
+        }
+    }
+    if (node - leaves_ >= size_) {
+        return (false);
+    }
+    found = toAddress(node - leaves_);
+    return (true);
+}
+
+uint64_t
+FreeAddressMap::getFreeCount(time_t now) const {
+    Mutex::Locker locker(mutex_);
+    uint64_t count = 0;
+    for (uint64_t node = leaves_; node < leaves_ + size_; ++node) {
+        if (tree_[node] < now) {
+            ++count;
+        }
+    }
+    return (count);
+}
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
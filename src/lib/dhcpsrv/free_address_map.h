@@ -0,0 +1,197 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef FREE_ADDRESS_MAP_H
+#define FREE_ADDRESS_MAP_H
+
+#include <asiolink/io_address.h>
+#include <util/threads/sync.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <time.h>
+#include <vector>
+#include <stdint.h>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief In-memory index of the free addresses (or prefixes) of a pool
+///
+/// The allocation engine confirms every candidate address with the lease
+/// database. Without an index, the iterative allocator proposes the
+/// addresses one after another, so on a nearly full pool most of the
+/// lookups hit an address that is in use. This map remembers, for every
+/// address of the pool, when its lease expires, so the allocator can skip
+/// the addresses known to be in use and propose one that should be free
+/// (never leased, released or expired) right away.
+///
+/// The map is only a hint: the engine still checks the candidate with the
+/// lease database, and records what it finds there. The configuration
+/// manager fills the maps with the leases of the database when the subnets
+/// are configured, and the servers mark the addresses free again when the
+/// leases are released. An address used by a lease the map doesn't know
+/// about is found by the first lookup and not proposed again until the
+/// lease expires.
+///
+/// The expiration times are the leaves of a complete binary tree whose
+/// inner nodes hold the earliest expiration time below them, so the next
+/// free address is found, and an entry updated, in logarithmic time. The
+/// tree takes 8 bytes per address, so the size of the indexed pools is
+/// limited to @c MAX_SIZE addresses (or prefixes). The allocator doesn't
+/// use an index for larger pools (typically IPv6 ones, which are rarely
+/// full).
+///
+/// The map can be used by several threads at once.
+class FreeAddressMap : public boost::noncopyable {
+public:
+    /// @brief Maximum number of addresses (or prefixes) in a map
+    static const uint64_t MAX_SIZE = 1 << 20;
+
+    /// @brief Constructor
+    ///
+    /// All the addresses are free initially.
+    ///
+    /// @param first The first address of the pool
+    /// @param last The last address of the pool
+    /// @param prefix_len The length of the prefixes the pool is split
+    ///        into (32 for IPv4 and 128 for IPv6 addresses)
+    ///
+    /// @throw BadValue if the pool is larger than @c MAX_SIZE, or the
+    ///        parameters are inconsistent
+    FreeAddressMap(const bundy::asiolink::IOAddress& first,
+                   const bundy::asiolink::IOAddress& last,
+                   uint8_t prefix_len);
+
+    /// @brief Returns the number of addresses of a pool
+    ///
+    /// @param first The first address of the pool
+    /// @param last The last address of the pool
+    /// @param prefix_len The length of the prefixes the pool is split into
+    ///
+    /// @return The number of addresses (or prefixes), or 0 if larger than
+    ///         @c MAX_SIZE
+    static uint64_t getSize(const bundy::asiolink::IOAddress& first,
+                            const bundy::asiolink::IOAddress& last,
+                            uint8_t prefix_len);
+
+    /// @brief Returns the number of addresses in the map
+    uint64_t getSize() const {
+        return (size_);
+    }
+
+    /// @brief Records that an address is used by a lease
+    ///
+    /// Addresses out of the pool are ignored.
+    ///
+    /// @param addr The address (or prefix)
+    /// @param expire When the lease expires
+    void setUsed(const bundy::asiolink::IOAddress& addr, time_t expire);
+
+    /// @brief Records that an address is free
+    ///
+    /// Addresses out of the pool are ignored.
+    ///
+    /// @param addr The address (or prefix)
+    void setFree(const bundy::asiolink::IOAddress& addr);
+
+    /// @brief Checks if an address is (known to be) free
+    ///
+    /// @param addr The address (or prefix)
+    /// @param now The current time
+    ///
+    /// @return false if the address is used by a lease that is valid at
+    ///         @c now, or out of the pool
+    bool isFree(const bundy::asiolink::IOAddress& addr, time_t now) const;
+
+    /// @brief Finds the next free address
+    ///
+    /// @param after The search starts at the address following this one,
+    ///        or at the first address of the pool if this one is not in it
+    /// @param now The current time
+    /// @param[out] found The free address, if any
+    ///
+    /// @return true if a free address was found before the end of the pool
+    bool findFree(const bundy::asiolink::IOAddress& after, time_t now,
+                  bundy::asiolink::IOAddress& found) const;
+
+    /// @brief Finds the first free address of the pool
+    ///
+    /// @param now The current time
+    /// @param[out] found The free address, if any
+    ///
+    /// @return true if a free address was found
+    bool findFree(time_t now, bundy::asiolink::IOAddress& found) const;
+
+    /// @brief Returns the number of free addresses
+    ///
+    /// @param now The current time
+    uint64_t getFreeCount(time_t now) const;
+
+private:
+    /// @brief Converts an address to the index of its entry
+    ///
+    /// @return The index, or @c getSize() if the address is not in the pool
+    uint64_t toIndex(const bundy::asiolink::IOAddress& addr) const;
+
+    /// @brief Converts the index of an entry to the address
+    bundy::asiolink::IOAddress toAddress(uint64_t index) const;
+
+    /// @brief Sets the expiration time of an entry
+    ///
+    /// Updates the earliest expiration times above it. The mutex must be
+    /// held.
+    void setExpire(uint64_t index, uint32_t expire);
+
+    /// @brief Finds the first free entry from an index on
+    ///
+    /// @return true if one was found
+    bool findFreeFrom(uint64_t index, time_t now,
+                      bundy::asiolink::IOAddress& found) const;
+
+    /// @brief The first address of the pool, in network byte order
+    std::vector<uint8_t> first_;
+
+    /// @brief The number of bits of the address below the prefix
+    const unsigned int shift_;
+
+    /// @brief The address family
+    const short family_;
+
+    /// @brief The number of addresses
+    const uint64_t size_;
+
+    /// @brief The number of leaves of the tree (a power of two)
+    uint64_t leaves_;
+
+    /// @brief The tree of the expiration times
+    ///
+    /// The node @c i has the children @c 2i and @c 2i+1, the root is the
+    /// node 1 and the expiration time of the lease of the address @c n
+    /// (0 if free) is the leaf @c leaves_+n. The leaves past the pool are
+    /// never free.
+    std::vector<uint32_t> tree_;
+
+    /// @brief Protects @c tree_
+    mutable bundy::util::thread::Mutex mutex_;
+};
+
+/// @brief A pointer to a FreeAddressMap
+typedef boost::shared_ptr<FreeAddressMap> FreeAddressMapPtr;
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
+
+#endif // FREE_ADDRESS_MAP_H
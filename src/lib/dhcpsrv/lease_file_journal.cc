@@ -0,0 +1,370 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/dhcpsrv_log.h>
+#include <dhcpsrv/lease_file_journal.h>
+#include <dhcpsrv/lease_mgr.h>
+#include <exceptions/exceptions.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace dhcp {
+
+namespace {
+
+int
+openFile(const std::string& filename) {
+    const int fd = open(filename.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0) {
+        bundy_throw(DbOperationError, "unable to open the lease file '"
+                    << filename << "': " << strerror(errno));
+    }
+    return (fd);
+}
+
+void
+writeAll(int fd, const std::string& data, const std::string& filename) {
+    const char* pos = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        const ssize_t written = write(fd, pos, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            bundy_throw(DbOperationError, "failed to write to the lease file '"
+                        << filename << "': " << strerror(errno));
+        }
+        pos += written;
+        left -= written;
+    }
+}
+
+void
+syncFile(int fd, const std::string& filename) {
+    if (fsync(fd) != 0) {
+        bundy_throw(DbOperationError, "failed to synchronize the lease file '"
+                    << filename << "': " << strerror(errno));
+    }
+}
+
+void
+syncDirectory(const std::string& filename) {
+    const size_t pos = filename.rfind('/');
+    const std::string dirname(pos == std::string::npos ? "." :
+                              (pos == 0 ? "/" : filename.substr(0, pos)));
+    const int fd = open(dirname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        bundy_throw(DbOperationError, "unable to open the directory '"
+                    << dirname << "': " << strerror(errno));
+    }
+    const int result = fsync(fd);
+    const int error = errno;
+    close(fd);
+    if (result != 0) {
+        bundy_throw(DbOperationError, "failed to synchronize the directory '"
+                    << dirname << "': " << strerror(error));
+    }
+}
+
+}
+
+LeaseFileJournal::LeaseFileJournal(const std::string& filename,
+                                   Durability durability,
+                                   unsigned int commit_interval) :
+    filename_(filename), durability_(durability),
+    commit_interval_(commit_interval), fd_(openFile(filename)),
+    appended_(0), written_(0), flushing_(0),
+    compacting_(false), stopping_(false)
+{
+    if (durability_ != WRITE) {
+        thread_.reset(new Thread(boost::bind(&LeaseFileJournal::run, this)));
+    }
+}
+
+LeaseFileJournal::~LeaseFileJournal() {
+    if (compaction_thread_) {
+        compaction_thread_->wait();
+    }
+    if (thread_) {
+        {
+            Mutex::Locker locker(mutex_);
+            stopping_ = true;
+            work_cond_.signal();
+        }
+        thread_->wait();
+    }
+    close(fd_);
+}
+
+LeaseFileJournal::Durability
+LeaseFileJournal::textToDurability(const std::string& text) {
+    if (text == "write") {
+        return (WRITE);
+    } else if (text == "sync") {
+        return (SYNC);
+    } else if (text == "batch") {
+        return (BATCH);
+    }
+    bundy_throw(BadValue, "invalid lease file durability '" << text << "'");
+}
+
+void
+LeaseFileJournal::append(const std::string& record) {
+    wait(enqueue(record));
+}
+
+uint64_t
+LeaseFileJournal::enqueue(const std::string& record) {
+    Mutex::Locker locker(mutex_);
+    if (durability_ == WRITE) {
+        const std::string line(record + "\n");
+        writeAll(fd_, line, filename_);
+        written_ = ++appended_;
+        if (compacting_) {
+            compaction_tail_ += line;
+        }
+        return (appended_);
+    }
+
+    if (queued_.empty()) {
+        work_cond_.signal();
+    }
+    queued_ += record;
+    queued_ += '\n';
+    if (compacting_) {
+        compaction_tail_ += record;
+        compaction_tail_ += '\n';
+    }
+    return (++appended_);
+}
+
+void
+LeaseFileJournal::wait(uint64_t seq) {
+    if (durability_ != SYNC) {
+        return;
+    }
+
+    // Wait for the background thread to write this record, along with the
+    // others appended in the meantime.
+    Mutex::Locker locker(mutex_);
+    while (written_ < seq) {
+        done_cond_.wait(mutex_);
+    }
+    if (failed_.empty()) {
+        return;
+    }
+    // Find the range starting at or before the record, if any
+    std::map<uint64_t, FailedRange>::iterator it = failed_.upper_bound(seq);
+    if (it == failed_.begin()) {
+        return;
+    }
+    --it;
+    if (seq <= it->second.last) {
+        if (--it->second.unwaited == 0) {
+            failed_.erase(it);
+        }
+        bundy_throw(DbOperationError, "failed to write the lease record to '"
+                    << filename_ << "'");
+    }
+}
+
+void
+LeaseFileJournal::flush() {
+    Mutex::Locker locker(mutex_);
+    const uint64_t target = appended_;
+    ++flushing_;
+    work_cond_.signal();
+    while (written_ < target || compacting_) {
+        done_cond_.wait(mutex_);
+    }
+    --flushing_;
+}
+
+bool
+LeaseFileJournal::compact(const SnapshotWriter& writer) {
+    Mutex::Locker locker(mutex_);
+    if (compacting_) {
+        return (false);
+    }
+    if (compaction_thread_) {
+        // The previous one is finished, or about to be
+        compaction_thread_->wait();
+    }
+    compacting_ = true;
+    compaction_tail_.clear();
+    compaction_thread_.reset(
+        new Thread(boost::bind(&LeaseFileJournal::writeSnapshot, this,
+                               writer)));
+    return (true);
+}
+
+void
+LeaseFileJournal::run() {
+    while (true) {
+        bool wait_interval;
+        {
+            Mutex::Locker locker(mutex_);
+            while (queued_.empty() && !stopping_) {
+                work_cond_.wait(mutex_);
+            }
+            if (queued_.empty()) {
+                break;
+            }
+            wait_interval = (durability_ == BATCH && flushing_ == 0 &&
+                             !stopping_);
+        }
+
+        // Let the records of the interval accumulate, so they are written
+        // and synchronized at once.
+        if (wait_interval && commit_interval_ > 0) {
+            usleep(commit_interval_ * 1000);
+        }
+        writeQueued();
+    }
+}
+
+void
+LeaseFileJournal::writeQueued() {
+    // The records are taken and written with fd_mutex_ held, so the
+    // compaction can't switch files in between: these records may precede
+    // those of its tail.  The callers of append() only need mutex_, so
+    // they aren't blocked while the file is synchronized.
+    bool failed = false;
+    uint64_t first;
+    uint64_t last;
+    {
+        Mutex::Locker fd_locker(fd_mutex_);
+        std::string data;
+        {
+            Mutex::Locker locker(mutex_);
+            data.swap(queued_);
+            // The previous batches are accounted for, so these are the
+            // records appended since.
+            first = written_ + 1;
+            last = appended_;
+        }
+        if (data.empty()) {
+            return;
+        }
+        try {
+            writeAll(fd_, data, filename_);
+            syncFile(fd_, filename_);
+        } catch (const std::exception& ex) {
+            LOG_ERROR(dhcpsrv_logger, DHCPSRV_MEMFILE_WRITE_FAILED)
+                .arg(filename_).arg(ex.what());
+            failed = true;
+        }
+    }
+
+    // A compaction may have completed in the meantime, and accounted for
+    // these records and more.
+    Mutex::Locker locker(mutex_);
+    if (failed && written_ < last) {
+        addFailed(first, last);
+    }
+    written_ = std::max(written_, last);
+    done_cond_.broadcast();
+}
+
+void
+LeaseFileJournal::addFailed(uint64_t first, uint64_t last) {
+    // Nobody waits for the records in the other modes
+    if (durability_ == SYNC) {
+        const FailedRange range = { last, last - first + 1 };
+        failed_[first] = range;
+    }
+}
+
+void
+LeaseFileJournal::writeSnapshot(const SnapshotWriter& writer) {
+    LOG_INFO(dhcpsrv_logger, DHCPSRV_MEMFILE_LFC_START).arg(filename_);
+
+    const std::string tmp_filename(filename_ + ".tmp");
+    int fd = -1;
+    try {
+        // This is the long part, done while the server appends the new
+        // records to the current file (and to compaction_tail_).
+        writer(tmp_filename);
+        fd = openFile(tmp_filename);
+
+        // Complete the new file and switch to it.  The records appended
+        // since the snapshot are in the tail, and the older ones in the
+        // snapshot, so those not written yet need not be written to the
+        // old file.
+        Mutex::Locker fd_locker(fd_mutex_);
+        Mutex::Locker locker(mutex_);
+        writeAll(fd, compaction_tail_, tmp_filename);
+        syncFile(fd, tmp_filename);
+        if (rename(tmp_filename.c_str(), filename_.c_str()) != 0) {
+            bundy_throw(DbOperationError, "failed to rename '" << tmp_filename
+                        << "' to '" << filename_ << "': " << strerror(errno));
+        }
+
+        // The records of the tail are only in the new file: until the
+        // rename is on the disk, a crash of the system would bring the old
+        // file back without those not written to it yet.  The file is
+        // switched anyway, since the old one is gone, but these records
+        // are reported as failed if the rename may not be on the disk.
+        bool synced = true;
+        try {
+            syncDirectory(filename_);
+        } catch (const std::exception& ex) {
+            LOG_ERROR(dhcpsrv_logger, DHCPSRV_MEMFILE_WRITE_FAILED)
+                .arg(filename_).arg(ex.what());
+            synced = false;
+        }
+        close(fd_);
+        fd_ = fd;
+        fd = -1;
+        queued_.clear();
+        if (!synced && written_ < appended_) {
+            addFailed(written_ + 1, appended_);
+        }
+        written_ = appended_;
+        compacting_ = false;
+        compaction_tail_.clear();
+        done_cond_.broadcast();
+
+    } catch (const std::exception& ex) {
+        LOG_ERROR(dhcpsrv_logger, DHCPSRV_MEMFILE_LFC_FAILED)
+            .arg(filename_).arg(ex.what());
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(tmp_filename.c_str());
+
+        Mutex::Locker locker(mutex_);
+        compacting_ = false;
+        compaction_tail_.clear();
+        done_cond_.broadcast();
+        return;
+    }
+
+    LOG_INFO(dhcpsrv_logger, DHCPSRV_MEMFILE_LFC_COMPLETE).arg(filename_);
+}
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
@@ -0,0 +1,253 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef LEASE_FILE_JOURNAL_H
+#define LEASE_FILE_JOURNAL_H
+
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <stdint.h>
+#include <string>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Appends the lease records to the lease file
+///
+/// The Memfile backend records each change of a lease by appending a line
+/// to the lease file. This class writes these lines, in one of the
+/// following modes (the "durability"):
+/// - @c WRITE: each record is written to the file before @c append returns,
+///   but the file is not synchronized to the disk. A crash of the server
+///   loses nothing, a crash of the system may lose the last records. This
+///   is the default.
+/// - @c SYNC: each record is written and synchronized to the disk (with
+///   @c fsync) before @c append returns. The records appended at the
+///   same time by different threads are written and synchronized together
+///   (group commit).
+/// - @c BATCH: @c append only queues the record. A background thread
+///   writes and synchronizes the queued records once per commit interval
+///   (in milliseconds), so the records of this interval may be lost by a
+///   crash. @c flush waits until they are on the disk.
+///
+/// The journal also compacts the lease file: @c compact is given a
+/// function writing the current leases (a snapshot taken by the caller)
+/// to a new file. Another background thread calls it, appends to the new
+/// file the records appended in the meantime and then replaces the lease
+/// file with it, synchronizing the directory so the replacement survives a
+/// crash of the system. The server keeps working while this happens and the
+/// file never misses a record.
+class LeaseFileJournal : public boost::noncopyable {
+public:
+    /// @brief The durability of the records
+    enum Durability {
+        WRITE,
+        SYNC,
+        BATCH
+    };
+
+    /// @brief Function writing a snapshot of the leases to a file
+    ///
+    /// It is called with the name of the file to be created.
+    typedef boost::function<void(const std::string&)> SnapshotWriter;
+
+    /// @brief Constructor
+    ///
+    /// The lease file must exist (with its header).
+    ///
+    /// @param filename Name of the lease file
+    /// @param durability The durability of the records
+    /// @param commit_interval The interval between two writes, in
+    ///        milliseconds (@c BATCH only)
+    ///
+    /// @throw DbOperationError if the file can't be opened
+    LeaseFileJournal(const std::string& filename, Durability durability,
+                     unsigned int commit_interval);
+
+    /// @brief Destructor
+    ///
+    /// Writes the queued records, waits for a compaction in progress to
+    /// finish, and closes the file.
+    ~LeaseFileJournal();
+
+    /// @brief Appends a record to the lease file
+    ///
+    /// @param record The record, without the line terminator
+    ///
+    /// @throw DbOperationError if the record can't be written (@c WRITE or
+    ///        @c SYNC only)
+    void append(const std::string& record);
+
+    /// @brief Appends a record, without waiting for it to be written
+    ///
+    /// This is the first half of @c append, for callers which must not
+    /// wait while holding a lock: the records are written in the order
+    /// of the calls, and @c wait completes the append.
+    ///
+    /// @param record The record, without the line terminator
+    ///
+    /// @return The sequence number of the record
+    /// @throw DbOperationError if the record can't be written (@c WRITE
+    ///        only)
+    uint64_t enqueue(const std::string& record);
+
+    /// @brief Waits until a record is written (@c SYNC only)
+    ///
+    /// It must be called once for each record enqueued with @c SYNC.
+    ///
+    /// @param seq The sequence number returned by @c enqueue
+    ///
+    /// @throw DbOperationError if the record couldn't be written
+    void wait(uint64_t seq);
+
+    /// @brief Waits until the records appended so far are written
+    ///
+    /// The records are synchronized to the disk, unless the durability is
+    /// @c WRITE. This also waits for a compaction in progress to finish.
+    void flush();
+
+    /// @brief Starts the compaction of the lease file
+    ///
+    /// The caller must take the snapshot written by @c writer before any
+    /// other record is appended: the records appended after this call are
+    /// added to the snapshot.
+    ///
+    /// @param writer Function writing the snapshot to a file
+    ///
+    /// @return false if a compaction is already in progress (and nothing
+    ///         was done)
+    bool compact(const SnapshotWriter& writer);
+
+    /// @brief Returns the name of the lease file
+    const std::string& getFilename() const {
+        return (filename_);
+    }
+
+    /// @brief Returns the durability of the records
+    Durability getDurability() const {
+        return (durability_);
+    }
+
+    /// @brief Converts the textual durability to the enumeration
+    ///
+    /// @param text "write", "sync" or "batch"
+    ///
+    /// @throw BadValue if the text is none of them
+    static Durability textToDurability(const std::string& text);
+
+private:
+    /// @brief Body of the thread writing the queued records
+    void run();
+
+    /// @brief Writes and synchronizes the queued records
+    void writeQueued();
+
+    /// @brief Body of the thread compacting the lease file
+    ///
+    /// @param writer The writer of the snapshot
+    void writeSnapshot(const SnapshotWriter& writer);
+
+    /// @brief Records that some records failed to be written (@c SYNC only)
+    ///
+    /// Called with @c mutex_ held.
+    ///
+    /// @param first The sequence number of the first failed record
+    /// @param last The sequence number of the last failed record
+    void addFailed(uint64_t first, uint64_t last);
+
+    /// @brief Name of the lease file
+    const std::string filename_;
+
+    /// @brief The durability of the records
+    const Durability durability_;
+
+    /// @brief Interval between two writes, in milliseconds
+    const unsigned int commit_interval_;
+
+    /// @brief Descriptor of the lease file
+    ///
+    /// Only changed by the compaction, with both locks held.
+    int fd_;
+
+    /// @brief Held while writing the queued records
+    ///
+    /// The compaction takes it, then @c mutex_, to switch to the new file.
+    bundy::util::thread::Mutex fd_mutex_;
+
+    /// @brief Protects the members below
+    bundy::util::thread::Mutex mutex_;
+
+    /// @brief Signaled when there are records to write
+    bundy::util::thread::CondVar work_cond_;
+
+    /// @brief Broadcast when records are written or compaction finishes
+    bundy::util::thread::CondVar done_cond_;
+
+    /// @brief The records queued (@c SYNC and @c BATCH only)
+    std::string queued_;
+
+    /// @brief Number of records appended
+    uint64_t appended_;
+
+    /// @brief Number of records written (or failed to be written)
+    uint64_t written_;
+
+    /// @brief A range of records failed to be written
+    struct FailedRange {
+        /// @brief The sequence number of the last record of the range
+        uint64_t last;
+        /// @brief The number of records of the range not waited for yet
+        uint64_t unwaited;
+    };
+
+    /// @brief The ranges of records failed to be written, by their first
+    ///        records (@c SYNC only)
+    ///
+    /// @c wait reports the failure to the callers, and a range is removed
+    /// once all its records have been waited for.
+    std::map<uint64_t, FailedRange> failed_;
+
+    /// @brief Number of threads waiting in @c flush
+    unsigned int flushing_;
+
+    /// @brief Set from @c compact until the compaction is finished
+    bool compacting_;
+
+    /// @brief Records appended while compacting
+    std::string compaction_tail_;
+
+    /// @brief Set when the thread must terminate
+    bool stopping_;
+
+    /// @brief The thread writing the queued records
+    boost::scoped_ptr<bundy::util::thread::Thread> thread_;
+
+    /// @brief The thread compacting the lease file
+    boost::scoped_ptr<bundy::util::thread::Thread> compaction_thread_;
+};
+
+/// @brief Pointer to a lease file journal
+typedef boost::shared_ptr<LeaseFileJournal> LeaseFileJournalPtr;
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
+
+#endif // LEASE_FILE_JOURNAL_H
@@ -120,6 +120,11 @@ public:
 /// As all methods are virtual, this class throws no exceptions.  However,
 /// methods in concrete implementations of this class may throw exceptions:
 /// see the documentation of those classes for details.
+///
+/// The servers' worker threads use the lease manager at the same time, so
+/// the backends must allow concurrent calls. The leases returned are the
+/// callers' own copies: changes are only made through @c updateLease4 and
+/// @c updateLease6.
 class LeaseMgr {
 public:
     /// Database configuration parameter map
@@ -229,6 +234,15 @@ public:
     virtual Lease4Ptr getLease4(const ClientId& clientid,
                                 SubnetID subnet_id) const = 0;
 
+    /// @brief Returns all IPv4 leases
+    ///
+    /// This is used to learn which addresses are in use when the subnets
+    /// are configured (see @ref FreeAddressMap), so the collection may be
+    /// large.
+    ///
+    /// @return lease collection (may be empty if there is no lease)
+    virtual Lease4Collection getLeases4() const = 0;
+
     /// @brief Returns existing IPv6 lease for a given IPv6 address.
     ///
     /// For a given address, we assume that there will be only one lease.
@@ -271,6 +285,14 @@ public:
     virtual Lease6Collection getLeases6(Lease::Type type, const DUID& duid,
                                         uint32_t iaid, SubnetID subnet_id) const = 0;
 
+    /// @brief Returns all IPv6 leases
+    ///
+    /// The leases of all types (NA, TA and PD) are returned. See
+    /// @ref getLeases4().
+    ///
+    /// @return lease collection (may be empty if there is no lease)
+    virtual Lease6Collection getLeases6() const = 0;
+
 
     /// @brief returns zero or one IPv6 lease for a given duid+iaid+subnet_id
     ///
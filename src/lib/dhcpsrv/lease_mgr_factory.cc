@@ -167,6 +167,11 @@ LeaseMgrFactory::instance() {
     return (*lmptr);
 }
 
+bool
+LeaseMgrFactory::haveInstance() {
+    return (getLeaseMgrPtr().get() != NULL);
+}
+
 
 }; // namespace dhcp
 }; // namespace bundy
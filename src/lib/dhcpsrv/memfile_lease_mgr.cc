@@ -17,12 +17,40 @@
 #include <dhcpsrv/memfile_lease_mgr.h>
 #include <exceptions/exceptions.h>
 
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ctime>
 #include <iostream>
 
 using namespace bundy::dhcp;
+using bundy::util::thread::Mutex;
+
+namespace {
+
+/// @brief Writes a snapshot of the leases to a new lease file.
+///
+/// This is the @c LeaseFileJournal::SnapshotWriter of the compaction.
+///
+/// @param leases Copy of the leases.
+/// @param filename Name of the file to be created.
+template<typename LeaseFileType, typename LeaseCollectionType>
+void
+writeLeaseFile(const boost::shared_ptr<LeaseCollectionType>& leases,
+               const std::string& filename) {
+    LeaseFileType lease_file(filename);
+    lease_file.recreate();
+    for (typename LeaseCollectionType::const_iterator lease = leases->begin();
+         lease != leases->end(); ++lease) {
+        lease_file.append(**lease);
+    }
+    lease_file.close();
+}
+
+}
 
 Memfile_LeaseMgr::Memfile_LeaseMgr(const ParameterMap& parameters)
-    : LeaseMgr(parameters) {
+    : LeaseMgr(parameters), lfc_interval_(0), next_lfc_(0) {
     // Check the universe and use v4 file or v6 file.
     std::string universe = getParameter("universe");
     if (universe == "4") {
@@ -31,6 +59,9 @@ Memfile_LeaseMgr::Memfile_LeaseMgr(const ParameterMap& parameters)
             lease_file4_.reset(new CSVLeaseFile4(file4));
             lease_file4_->open();
             load4();
+            // From now on, the records are appended by the journal.
+            lease_file4_->close();
+            journal4_ = initJournal(file4);
         }
     } else {
         std::string file6 = initLeaseFilePath(V6);
@@ -38,6 +69,8 @@ Memfile_LeaseMgr::Memfile_LeaseMgr(const ParameterMap& parameters)
             lease_file6_.reset(new CSVLeaseFile6(file6));
             lease_file6_->open();
             load6();
+            lease_file6_->close();
+            journal6_ = initJournal(file6);
         }
     }
 
@@ -51,6 +84,9 @@ Memfile_LeaseMgr::Memfile_LeaseMgr(const ParameterMap& parameters)
 }
 
 Memfile_LeaseMgr::~Memfile_LeaseMgr() {
+    // Write the records still queued.
+    journal4_.reset();
+    journal6_.reset();
     if (lease_file4_) {
         lease_file4_->close();
         lease_file4_.reset();
@@ -66,19 +102,25 @@ Memfile_LeaseMgr::addLease(const Lease4Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_ADD_ADDR4).arg(lease->addr_.toText());
 
-    if (getLease4(lease->addr_)) {
-        // there is a lease with specified address already
-        return (false);
-    }
+    uint64_t seq = 0;
+    {
+        Mutex::Locker locker(mutex_);
+        if (storage4_.find(lease->addr_) != storage4_.end()) {
+            // there is a lease with specified address already
+            return (false);
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V4)) {
-        lease_file4_->append(*lease);
-    }
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        if (persistLeases(V4)) {
+            seq = journal4_->enqueue(lease_file4_->render(*lease));
+        }
 
-    storage4_.insert(lease);
+        storage4_.insert(Lease4Ptr(new Lease4(*lease)));
+        checkCompaction();
+    }
+    waitForRecord(V4, seq);
     return (true);
 }
 
@@ -87,19 +129,25 @@ Memfile_LeaseMgr::addLease(const Lease6Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_ADD_ADDR6).arg(lease->addr_.toText());
 
-    if (getLease6(lease->type_, lease->addr_)) {
-        // there is a lease with specified address already
-        return (false);
-    }
+    uint64_t seq = 0;
+    {
+        Mutex::Locker locker(mutex_);
+        if (storage6_.find(lease->addr_) != storage6_.end()) {
+            // there is a lease with specified address already
+            return (false);
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V6)) {
-        lease_file6_->append(*lease);
-    }
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        if (persistLeases(V6)) {
+            seq = journal6_->enqueue(lease_file6_->render(*lease));
+        }
 
-    storage6_.insert(lease);
+        storage6_.insert(Lease6Ptr(new Lease6(*lease)));
+        checkCompaction();
+    }
+    waitForRecord(V6, seq);
     return (true);
 }
 
@@ -108,6 +156,7 @@ Memfile_LeaseMgr::getLease4(const bundy::asiolink::IOAddress& addr) const {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_GET_ADDR4).arg(addr.toText());
 
+    Mutex::Locker locker(mutex_);
     typedef Lease4Storage::nth_index<0>::type SearchIndex;
     const SearchIndex& idx = storage4_.get<0>();
     Lease4Storage::iterator l = idx.find(addr);
@@ -124,13 +173,14 @@ Memfile_LeaseMgr::getLease4(const HWAddr& hwaddr) const {
               DHCPSRV_MEMFILE_GET_HWADDR).arg(hwaddr.toText());
     typedef Lease4Storage::nth_index<0>::type SearchIndex;
     Lease4Collection collection;
+    Mutex::Locker locker(mutex_);
     const SearchIndex& idx = storage4_.get<0>();
     for(SearchIndex::const_iterator lease = idx.begin();
         lease != idx.end(); ++lease) {
 
         // Every Lease4 has a hardware address, so we can compare it
         if ((*lease)->hwaddr_ == hwaddr.hwaddr_) {
-            collection.push_back((*lease));
+            collection.push_back(Lease4Ptr(new Lease4(**lease)));
         }
     }
 
@@ -148,6 +198,7 @@ Memfile_LeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
     // currently only this function uses this index.
     typedef Lease4Storage::nth_index<1>::type SearchIndex;
     // Get the index.
+    Mutex::Locker locker(mutex_);
     const SearchIndex& idx = storage4_.get<1>();
     // Try to find the lease using HWAddr and subnet id.
     SearchIndex::const_iterator lease =
@@ -167,6 +218,7 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id) const {
               DHCPSRV_MEMFILE_GET_CLIENTID).arg(client_id.toText());
     typedef Memfile_LeaseMgr::Lease4Storage::nth_index<0>::type SearchIndex;
     Lease4Collection collection;
+    Mutex::Locker locker(mutex_);
     const SearchIndex& idx = storage4_.get<0>();
     for(SearchIndex::const_iterator lease = idx.begin();
         lease != idx.end(); ++ lease) {
@@ -174,7 +226,7 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id) const {
         // client-id is not mandatory in DHCPv4. There can be a lease that does
         // not have a client-id. Dereferencing null pointer would be a bad thing
         if((*lease)->client_id_ && *(*lease)->client_id_ == client_id) {
-            collection.push_back((*lease));
+            collection.push_back(Lease4Ptr(new Lease4(**lease)));
         }
     }
 
@@ -195,6 +247,7 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id,
     // currently only this function uses this index.
     typedef Lease4Storage::nth_index<3>::type SearchIndex;
     // Get the index.
+    Mutex::Locker locker(mutex_);
     const SearchIndex& idx = storage4_.get<3>();
     // Try to get the lease using client id, hardware address and subnet id.
     SearchIndex::const_iterator lease =
@@ -207,7 +260,7 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id,
     }
 
     // Lease was found. Return it to the caller.
-    return (*lease);
+    return (Lease4Ptr(new Lease4(**lease)));
 }
 
 Lease4Ptr
@@ -222,6 +275,7 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id,
     // currently only this function uses this index.
     typedef Lease4Storage::nth_index<2>::type SearchIndex;
     // Get the index.
+    Mutex::Locker locker(mutex_);
     const SearchIndex& idx = storage4_.get<2>();
     // Try to get the lease using client id and subnet id.
     SearchIndex::const_iterator lease =
@@ -234,12 +288,28 @@ Memfile_LeaseMgr::getLease4(const ClientId& client_id,
     return (Lease4Ptr(new Lease4(**lease)));
 }
 
+Lease4Collection
+Memfile_LeaseMgr::getLeases4() const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MEMFILE_GET4);
+
+    Lease4Collection collection;
+    Mutex::Locker locker(mutex_);
+    collection.reserve(storage4_.size());
+    for (Lease4Storage::const_iterator lease = storage4_.begin();
+         lease != storage4_.end(); ++lease) {
+        collection.push_back(Lease4Ptr(new Lease4(**lease)));
+    }
+    return (collection);
+}
+
 Lease6Ptr
 Memfile_LeaseMgr::getLease6(Lease::Type /* not used yet */,
                             const bundy::asiolink::IOAddress& addr) const {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_GET_ADDR6).arg(addr.toText());
 
+    Mutex::Locker locker(mutex_);
     Lease6Storage::iterator l = storage6_.find(addr);
     if (l == storage6_.end()) {
         return (Lease6Ptr());
@@ -272,6 +342,7 @@ Memfile_LeaseMgr::getLeases6(Lease::Type /* not used yet */,
     // currently only this function uses this index.
     typedef Lease6Storage::nth_index<1>::type SearchIndex;
     // Get the index.
+    Mutex::Locker locker(mutex_);
     const SearchIndex& idx = storage6_.get<1>();
     // Try to get the lease using the DUID, IAID and Subnet ID.
     SearchIndex::const_iterator lease =
@@ -288,25 +359,48 @@ Memfile_LeaseMgr::getLeases6(Lease::Type /* not used yet */,
     return (collection);
 }
 
+Lease6Collection
+Memfile_LeaseMgr::getLeases6() const {
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
+              DHCPSRV_MEMFILE_GET6);
+
+    Lease6Collection collection;
+    Mutex::Locker locker(mutex_);
+    collection.reserve(storage6_.size());
+    for (Lease6Storage::const_iterator lease = storage6_.begin();
+         lease != storage6_.end(); ++lease) {
+        collection.push_back(Lease6Ptr(new Lease6(**lease)));
+    }
+    return (collection);
+}
+
 void
 Memfile_LeaseMgr::updateLease4(const Lease4Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_UPDATE_ADDR4).arg(lease->addr_.toText());
 
-    Lease4Storage::iterator lease_it = storage4_.find(lease->addr_);
-    if (lease_it == storage4_.end()) {
-        bundy_throw(NoSuchLease, "failed to update the lease with address "
-                  << lease->addr_ << " - no such lease");
-    }
+    uint64_t seq = 0;
+    {
+        Mutex::Locker locker(mutex_);
+        Lease4Storage::iterator lease_it = storage4_.find(lease->addr_);
+        if (lease_it == storage4_.end()) {
+            bundy_throw(NoSuchLease, "failed to update the lease with address "
+                      << lease->addr_ << " - no such lease");
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V4)) {
-        lease_file4_->append(*lease);
-    }
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        if (persistLeases(V4)) {
+            seq = journal4_->enqueue(lease_file4_->render(*lease));
+        }
 
-    **lease_it = *lease;
+        // The stored lease is replaced rather than modified, as it may be
+        // in the snapshot of a compaction.
+        storage4_.replace(lease_it, Lease4Ptr(new Lease4(*lease)));
+        checkCompaction();
+    }
+    waitForRecord(V4, seq);
 }
 
 void
@@ -314,33 +408,43 @@ Memfile_LeaseMgr::updateLease6(const Lease6Ptr& lease) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_UPDATE_ADDR6).arg(lease->addr_.toText());
 
-    Lease6Storage::iterator lease_it = storage6_.find(lease->addr_);
-    if (lease_it == storage6_.end()) {
-        bundy_throw(NoSuchLease, "failed to update the lease with address "
-                  << lease->addr_ << " - no such lease");
-    }
+    uint64_t seq = 0;
+    {
+        Mutex::Locker locker(mutex_);
+        Lease6Storage::iterator lease_it = storage6_.find(lease->addr_);
+        if (lease_it == storage6_.end()) {
+            bundy_throw(NoSuchLease, "failed to update the lease with address "
+                      << lease->addr_ << " - no such lease");
+        }
 
-    // Try to write a lease to disk first. If this fails, the lease will
-    // not be inserted to the memory and the disk and in-memory data will
-    // remain consistent.
-    if (persistLeases(V6)) {
-        lease_file6_->append(*lease);
-    }
+        // Try to write a lease to disk first. If this fails, the lease will
+        // not be inserted to the memory and the disk and in-memory data will
+        // remain consistent.
+        if (persistLeases(V6)) {
+            seq = journal6_->enqueue(lease_file6_->render(*lease));
+        }
 
-    **lease_it = *lease;
+        storage6_.replace(lease_it, Lease6Ptr(new Lease6(*lease)));
+        checkCompaction();
+    }
+    waitForRecord(V6, seq);
 }
 
 bool
 Memfile_LeaseMgr::deleteLease(const bundy::asiolink::IOAddress& addr) {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_MEMFILE_DELETE_ADDR).arg(addr.toText());
-    if (addr.isV4()) {
-        // v4 lease
-        Lease4Storage::iterator l = storage4_.find(addr);
-        if (l == storage4_.end()) {
-            // No such lease
-            return (false);
-        } else {
+    const Universe u = addr.isV4() ? V4 : V6;
+    uint64_t seq = 0;
+    {
+        Mutex::Locker locker(mutex_);
+        if (u == V4) {
+            // v4 lease
+            Lease4Storage::iterator l = storage4_.find(addr);
+            if (l == storage4_.end()) {
+                // No such lease
+                return (false);
+            }
             if (persistLeases(V4)) {
                 // Copy the lease. The valid lifetime needs to be modified and
                 // we don't modify the original lease.
@@ -348,19 +452,17 @@ Memfile_LeaseMgr::deleteLease(const bundy::asiolink::IOAddress& addr) {
                 // Setting valid lifetime to 0 means that lease is being
                 // removed.
                 lease_copy.valid_lft_ = 0;
-                lease_file4_->append(lease_copy);
+                seq = journal4_->enqueue(lease_file4_->render(lease_copy));
             }
             storage4_.erase(l);
-            return (true);
-        }
 
-    } else {
-        // v6 lease
-        Lease6Storage::iterator l = storage6_.find(addr);
-        if (l == storage6_.end()) {
-            // No such lease
-            return (false);
         } else {
+            // v6 lease
+            Lease6Storage::iterator l = storage6_.find(addr);
+            if (l == storage6_.end()) {
+                // No such lease
+                return (false);
+            }
             if (persistLeases(V6)) {
                 // Copy the lease. The lifetimes need to be modified and we
                 // don't modify the original lease.
@@ -368,13 +470,14 @@ Memfile_LeaseMgr::deleteLease(const bundy::asiolink::IOAddress& addr) {
                 // Setting lifetimes to 0 means that lease is being removed.
                 lease_copy.valid_lft_ = 0;
                 lease_copy.preferred_lft_ = 0;
-                lease_file6_->append(lease_copy);
+                seq = journal6_->enqueue(lease_file6_->render(lease_copy));
             }
-
             storage6_.erase(l);
-            return (true);
         }
+        checkCompaction();
     }
+    waitForRecord(u, seq);
+    return (true);
 }
 
 std::string
@@ -387,6 +490,12 @@ Memfile_LeaseMgr::getDescription() const {
 void
 Memfile_LeaseMgr::commit() {
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_MEMFILE_COMMIT);
+    if (journal4_) {
+        journal4_->flush();
+    }
+    if (journal6_) {
+        journal6_->flush();
+    }
 }
 
 void
@@ -454,6 +563,111 @@ Memfile_LeaseMgr::initLeaseFilePath(Universe u) {
     return (lease_file);
 }
 
+namespace {
+
+/// @brief Returns the value of a parameter, or a default if not specified.
+///
+/// @param lease_mgr The lease manager holding the parameters.
+/// @param name Name of the parameter.
+/// @param default_val The default value.
+std::string
+getOptionalParameter(const LeaseMgr& lease_mgr, const std::string& name,
+                     const std::string& default_val) {
+    try {
+        return (lease_mgr.getParameter(name));
+    } catch (const bundy::Exception& ex) {
+        return (default_val);
+    }
+}
+
+/// @brief Converts the value of an interval parameter.
+///
+/// @param name Name of the parameter.
+/// @param value Value of the parameter.
+///
+/// @throw bundy::BadValue if the value is not a number.
+uint32_t
+getInterval(const std::string& name, const std::string& value) {
+    try {
+        return (boost::lexical_cast<uint32_t>(value));
+    } catch (const boost::bad_lexical_cast&) {
+        bundy_throw(bundy::BadValue, "invalid value '" << name << "="
+                    << value << "'");
+    }
+}
+
+}
+
+LeaseFileJournalPtr
+Memfile_LeaseMgr::initJournal(const std::string& filename) {
+    // If the parameters are not specified, the records are written
+    // immediately, without synchronization, and the lease file is not
+    // compacted.
+    const LeaseFileJournal::Durability durability =
+        LeaseFileJournal::textToDurability(
+            getOptionalParameter(*this, "durability", "write"));
+    const uint32_t commit_interval =
+        getInterval("commit-interval",
+                    getOptionalParameter(*this, "commit-interval", "1"));
+    lfc_interval_ = getInterval("lfc-interval",
+                                getOptionalParameter(*this, "lfc-interval",
+                                                     "0"));
+    next_lfc_ = time(NULL) + lfc_interval_;
+
+    return (LeaseFileJournalPtr(new LeaseFileJournal(filename, durability,
+                                                     commit_interval)));
+}
+
+void
+Memfile_LeaseMgr::waitForRecord(Universe u, uint64_t seq) {
+    if (!persistLeases(u)) {
+        return;
+    }
+    if (u == V4) {
+        journal4_->wait(seq);
+    } else {
+        journal6_->wait(seq);
+    }
+}
+
+void
+Memfile_LeaseMgr::checkCompaction() {
+    if (lfc_interval_ == 0) {
+        return;
+    }
+    const time_t now = time(NULL);
+    if (now >= next_lfc_) {
+        next_lfc_ = now + lfc_interval_;
+        startCompaction();
+    }
+}
+
+void
+Memfile_LeaseMgr::compactLeaseFile() {
+    Mutex::Locker locker(mutex_);
+    startCompaction();
+}
+
+void
+Memfile_LeaseMgr::startCompaction() {
+    // Only the pointers are copied: the stored leases are never modified,
+    // an update replaces the lease with a new one.
+    if (journal4_) {
+        boost::shared_ptr<Lease4Collection> leases(
+            new Lease4Collection(storage4_.begin(), storage4_.end()));
+        journal4_->compact(boost::bind(
+                               &writeLeaseFile<CSVLeaseFile4, Lease4Collection>,
+                               leases, _1));
+    }
+    if (journal6_) {
+        boost::shared_ptr<Lease6Collection> leases(
+            new Lease6Collection(storage6_.begin(), storage6_.end()));
+        journal6_->compact(boost::bind(
+                               &writeLeaseFile<CSVLeaseFile6, Lease6Collection>,
+                               leases, _1));
+    }
+}
+
 void
 Memfile_LeaseMgr::load4() {
     // If lease file hasn't been opened, we are working in non-persistent mode.
@@ -18,7 +18,9 @@
 #include <dhcp/hwaddr.h>
 #include <dhcpsrv/csv_lease_file4.h>
 #include <dhcpsrv/csv_lease_file6.h>
+#include <dhcpsrv/lease_file_journal.h>
 #include <dhcpsrv/lease_mgr.h>
+#include <util/threads/sync.h>
 
 #include <boost/multi_index/indexed_by.hpp>
 #include <boost/multi_index/member.hpp>
@@ -52,8 +54,25 @@ namespace dhcp {
 /// the container.
 ///
 /// After the container holding leases is initialized, each subsequent update,
-/// removal or addition of the lease is appended to the lease file
-/// synchronously.
+/// removal or addition of the lease is appended to the lease file by a
+/// @c LeaseFileJournal. The "durability=write|sync|batch" parameter selects
+/// whether the record is written before the operation returns (the
+/// default), also synchronized to the disk, or written and synchronized by
+/// a background thread once per "commit-interval" milliseconds (1 by
+/// default), together with the other records of the interval.
+///
+/// As the lease file holds every change, it grows without bound, and so
+/// does the time to load it. If the "lfc-interval" parameter is set to a
+/// number of seconds, the lease file is compacted at this interval: the
+/// current leases are written to a new file in the background, which then
+/// replaces the lease file (see @c compactLeaseFile).
+///
+/// The backend may be used by several threads at once: the leases are
+/// protected by a mutex, and the getters return copies. With the "sync"
+/// durability, a change is made in memory before its record is on the
+/// disk, as the callers wait for the record without holding the mutex (so
+/// their records are synchronized together). If the record can't be
+/// written, the change is reported as failed but remains in memory.
 ///
 /// Originally, the Memfile backend didn't write leases to disk. This was
 /// particularly useful for testing server performance in non-disk bound
@@ -178,6 +197,13 @@ public:
     virtual Lease4Ptr getLease4(const ClientId& clientid,
                                 SubnetID subnet_id) const;
 
+    /// @brief Returns all IPv4 leases
+    ///
+    /// This function returns copies of the leases.
+    ///
+    /// @return lease collection (may be empty if there is no lease)
+    virtual Lease4Collection getLeases4() const;
+
     /// @brief Returns existing IPv6 lease for a given IPv6 address.
     ///
     /// This function returns a copy of the lease. The modification in the
@@ -216,6 +242,13 @@ public:
     virtual Lease6Collection getLeases6(Lease::Type type, const DUID& duid,
                                         uint32_t iaid, SubnetID subnet_id) const;
 
+    /// @brief Returns all IPv6 leases
+    ///
+    /// This function returns copies of the leases.
+    ///
+    /// @return lease collection (may be empty if there is no lease)
+    virtual Lease6Collection getLeases6() const;
+
     /// @brief Updates IPv4 lease.
     ///
     /// @warning This function does not validate the pointer to the lease.
@@ -279,8 +312,10 @@ public:
 
     /// @brief Commit Transactions
     ///
-    /// Commits all pending database operations.  On databases that don't
-    /// support transactions, this is a no-op.
+    /// Commits all pending database operations.  For the memory file
+    /// database, this waits until the records of the lease changes are
+    /// written to the lease file (and a compaction in progress is
+    /// finished).
     virtual void commit();
 
     /// @brief Rollback Transactions
@@ -315,6 +350,18 @@ public:
     /// server shut down.
     bool persistLeases(Universe u) const;
 
+    /// @brief Compacts the lease file.
+    ///
+    /// Takes a copy of the leases held in memory and starts writing them
+    /// to a new lease file, in the background. The records of the changes
+    /// made in the meantime are added to the new file, which then replaces
+    /// the lease file. Nothing is done if the leases are not written to
+    /// disk or if a compaction is already in progress.
+    ///
+    /// This is called every "lfc-interval" seconds, if this parameter is
+    /// set.
+    void compactLeaseFile();
+
 protected:
 
     /// @brief Load all DHCPv4 leases from the file.
@@ -380,6 +427,37 @@ protected:
     /// argument to this function.
     std::string initLeaseFilePath(Universe u);
 
+    /// @brief Creates the journal appending the records to the lease file.
+    ///
+    /// Uses the "durability" and "commit-interval" parameters, and also
+    /// initializes the compaction interval from "lfc-interval".
+    ///
+    /// @param filename Name of the lease file.
+    ///
+    /// @return The journal.
+    /// @throw bundy::BadValue if one of the parameters is invalid.
+    LeaseFileJournalPtr initJournal(const std::string& filename);
+
+    /// @brief Compacts the lease file if the compaction interval elapsed.
+    ///
+    /// Called after each change of the leases, with @c mutex_ held.
+    void checkCompaction();
+
+    /// @brief Starts the compaction of the lease file.
+    ///
+    /// This is @c compactLeaseFile, called with @c mutex_ held.
+    void startCompaction();
+
+    /// @brief Waits until a lease record is written, if needed.
+    ///
+    /// Called after a change, with @c mutex_ released.
+    ///
+    /// @param u The universe of the lease.
+    /// @param seq The sequence number of the record in the journal.
+    ///
+    /// @throw DbOperationError if the record couldn't be written.
+    void waitForRecord(Universe u, uint64_t seq);
+
     // This is a multi-index container, which holds elements that can
     // be accessed using different search indexes.
     typedef boost::multi_index_container<
@@ -483,9 +561,12 @@ protected:
     > Lease4Storage; // Specify the type name for this container.
 
     /// @brief stores IPv4 leases
+    ///
+    /// The leases stored are never modified (an update replaces the lease),
+    /// so the snapshot of a compaction can share them.
     Lease4Storage storage4_;
 
-    /// @brief stores IPv6 leases
+    /// @brief stores IPv6 leases (never modified either)
     Lease6Storage storage6_;
 
     /// @brief Holds the pointer to the DHCPv4 lease file IO.
@@ -494,6 +575,22 @@ protected:
     /// @brief Holds the pointer to the DHCPv6 lease file IO.
     boost::shared_ptr<CSVLeaseFile6> lease_file6_;
 
+    /// @brief Writes the DHCPv4 lease records to the lease file.
+    LeaseFileJournalPtr journal4_;
+
+    /// @brief Writes the DHCPv6 lease records to the lease file.
+    LeaseFileJournalPtr journal6_;
+
+    /// @brief Interval between the compactions of the lease file, in
+    /// seconds (0 if disabled).
+    uint32_t lfc_interval_;
+
+    /// @brief Time of the next compaction of the lease file.
+    time_t next_lfc_;
+
+    /// @brief Protects the leases and @c next_lfc_.
+    mutable bundy::util::thread::Mutex mutex_;
+
 };
 
 }; // end of bundy::dhcp namespace
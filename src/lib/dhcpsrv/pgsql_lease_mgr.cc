@@ -31,6 +31,7 @@
 using namespace bundy;
 using namespace bundy::dhcp;
 using namespace std;
+using bundy::util::thread::Mutex;
 
 namespace {
 
@@ -71,6 +72,12 @@ TaggedStatement tagged_statements[] = {
         { 1043 },
         "delete_lease6",
      "DELETE FROM lease6 WHERE address = $1"},
+    {PgSqlLeaseMgr::GET_LEASE4, 0,
+        { 0 },
+        "get_lease4",
+     "SELECT address, hwaddr, client_id, "
+     "valid_lifetime, extract(epoch from expire)::bigint, subnet_id, fqdn_fwd, fqdn_rev, hostname "
+     "FROM lease4"},
     {PgSqlLeaseMgr::GET_LEASE4_ADDR, 1,
         { 20 },
         "get_lease4_addr",
@@ -106,6 +113,13 @@ TaggedStatement tagged_statements[] = {
      "valid_lifetime, extract(epoch from expire)::bigint, subnet_id, fqdn_fwd, fqdn_rev, hostname "
      "FROM lease4 "
      "WHERE hwaddr = $1 AND subnet_id = $2"},
+    {PgSqlLeaseMgr::GET_LEASE6, 0,
+        { 0 },
+        "get_lease6",
+     "SELECT address, duid, valid_lifetime, "
+     "extract(epoch from expire)::bigint, subnet_id, pref_lifetime, "
+     "lease_type, iaid, prefix_len, fqdn_fwd, fqdn_rev, hostname "
+     "FROM lease6"},
     {PgSqlLeaseMgr::GET_LEASE6_ADDR, 2,
         { 1043, 21 },
         "get_lease6_addr",
@@ -707,6 +721,7 @@ PgSqlLeaseMgr::addLeaseCommon(StatementIndex stindex,
 
 bool
 PgSqlLeaseMgr::addLease(const Lease4Ptr& lease) {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_ADD_ADDR4).arg(lease->addr_.toText());
     BindParams params = exchange4_->createBindForSend(lease);
@@ -716,6 +731,7 @@ PgSqlLeaseMgr::addLease(const Lease4Ptr& lease) {
 
 bool
 PgSqlLeaseMgr::addLease(const Lease6Ptr& lease) {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_ADD_ADDR6).arg(lease->addr_.toText());
     BindParams params = exchange6_->createBindForSend(lease);
@@ -737,9 +753,12 @@ void PgSqlLeaseMgr::getLeaseCollection(StatementIndex stindex,
     vector<int> out_formats;
     convertToQuery(params, out_values, out_lengths, out_formats);
 
+    // The statements getting all the leases have no parameter.
     PGresult* r = PQexecPrepared(conn_, statements_[stindex].stmt_name,
-                       statements_[stindex].stmt_nbparams, &out_values[0],
-                       &out_lengths[0], &out_formats[0], 0);
+                       statements_[stindex].stmt_nbparams,
+                       params.empty() ? NULL : &out_values[0],
+                       params.empty() ? NULL : &out_lengths[0],
+                       params.empty() ? NULL : &out_formats[0], 0);
 
     checkStatementError(r, stindex);
 
@@ -798,6 +817,7 @@ PgSqlLeaseMgr::getLease(StatementIndex stindex, BindParams & params,
 
 Lease4Ptr
 PgSqlLeaseMgr::getLease4(const bundy::asiolink::IOAddress& addr) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_ADDR4).arg(addr.toText());
 
@@ -817,6 +837,7 @@ PgSqlLeaseMgr::getLease4(const bundy::asiolink::IOAddress& addr) const {
 
 Lease4Collection
 PgSqlLeaseMgr::getLease4(const HWAddr& hwaddr) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_HWADDR).arg(hwaddr.toText());
 
@@ -838,6 +859,7 @@ PgSqlLeaseMgr::getLease4(const HWAddr& hwaddr) const {
 
 Lease4Ptr
 PgSqlLeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_SUBID_HWADDR)
               .arg(subnet_id).arg(hwaddr.toText());
@@ -864,6 +886,7 @@ PgSqlLeaseMgr::getLease4(const HWAddr& hwaddr, SubnetID subnet_id) const {
 
 Lease4Collection
 PgSqlLeaseMgr::getLease4(const ClientId& clientid) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_CLIENTID).arg(clientid.toText());
 
@@ -882,6 +905,7 @@ PgSqlLeaseMgr::getLease4(const ClientId& clientid) const {
 
 Lease4Ptr
 PgSqlLeaseMgr::getLease4(const ClientId& clientid, SubnetID subnet_id) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_SUBID_CLIENTID)
               .arg(subnet_id).arg(clientid.toText());
@@ -903,8 +927,24 @@ PgSqlLeaseMgr::getLease4(const ClientId& clientid, SubnetID subnet_id) const {
     return (result);
 }
 
+Lease4Collection
+PgSqlLeaseMgr::getLeases4() const {
+    Mutex::Locker locker(mutex_);
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_PGSQL_GET4);
+
+    // There is no WHERE clause
+    BindParams inparams;
+
+    // Get the data
+    Lease4Collection result;
+    getLeaseCollection(GET_LEASE4, inparams, result);
+
+    return (result);
+}
+
 Lease4Ptr
 PgSqlLeaseMgr::getLease4(const ClientId&, const HWAddr&, SubnetID) const {
+    Mutex::Locker locker(mutex_);
     /// This function is currently not implemented because allocation engine
     /// searches for the lease using HW address or client identifier.
     /// It never uses both parameters in the same time. We need to
@@ -916,6 +956,7 @@ PgSqlLeaseMgr::getLease4(const ClientId&, const HWAddr&, SubnetID) const {
 Lease6Ptr
 PgSqlLeaseMgr::getLease6(Lease::Type lease_type,
                          const bundy::asiolink::IOAddress& addr) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_PGSQL_GET_ADDR6)
               .arg(addr.toText()).arg(lease_type);
 
@@ -940,6 +981,7 @@ PgSqlLeaseMgr::getLease6(Lease::Type lease_type,
 Lease6Collection
 PgSqlLeaseMgr::getLeases6(Lease::Type type, const DUID& duid,
                           uint32_t iaid) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_IAID_DUID)
               .arg(iaid).arg(duid.toText()).arg(type);
@@ -971,6 +1013,7 @@ PgSqlLeaseMgr::getLeases6(Lease::Type type, const DUID& duid,
 Lease6Collection
 PgSqlLeaseMgr::getLeases6(Lease::Type lease_type, const DUID& duid,
                           uint32_t iaid, SubnetID subnet_id) const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_IAID_SUBID_DUID)
               .arg(iaid).arg(subnet_id).arg(duid.toText()).arg(lease_type);
@@ -1007,6 +1050,21 @@ PgSqlLeaseMgr::getLeases6(Lease::Type lease_type, const DUID& duid,
     return (result);
 }
 
+Lease6Collection
+PgSqlLeaseMgr::getLeases6() const {
+    Mutex::Locker locker(mutex_);
+    LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_PGSQL_GET6);
+
+    // There is no WHERE clause
+    BindParams inparams;
+
+    // ... and get the data
+    Lease6Collection result;
+    getLeaseCollection(GET_LEASE6, inparams, result);
+
+    return (result);
+}
+
 template <typename LeasePtr>
 void
 PgSqlLeaseMgr::updateLeaseCommon(StatementIndex stindex, BindParams & params,
@@ -1046,6 +1104,7 @@ PgSqlLeaseMgr::updateLeaseCommon(StatementIndex stindex, BindParams & params,
 
 void
 PgSqlLeaseMgr::updateLease4(const Lease4Ptr& lease) {
+    Mutex::Locker locker(mutex_);
     const StatementIndex stindex = UPDATE_LEASE4;
 
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
@@ -1065,6 +1124,7 @@ PgSqlLeaseMgr::updateLease4(const Lease4Ptr& lease) {
 
 void
 PgSqlLeaseMgr::updateLease6(const Lease6Ptr& lease) {
+    Mutex::Locker locker(mutex_);
     const StatementIndex stindex = UPDATE_LEASE6;
 
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
@@ -1099,6 +1159,7 @@ PgSqlLeaseMgr::deleteLeaseCommon(StatementIndex stindex, BindParams & params) {
 
 bool
 PgSqlLeaseMgr::deleteLease(const bundy::asiolink::IOAddress& addr) {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_DELETE_ADDR).arg(addr.toText());
 
@@ -1163,6 +1224,7 @@ PgSqlLeaseMgr::getDescription() const {
 
 pair<uint32_t, uint32_t>
 PgSqlLeaseMgr::getVersion() const {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL,
               DHCPSRV_PGSQL_GET_VERSION);
 
@@ -1187,6 +1249,7 @@ PgSqlLeaseMgr::getVersion() const {
 
 void
 PgSqlLeaseMgr::commit() {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_PGSQL_COMMIT);
     PGresult * r = PQexec(conn_, "COMMIT");
     if (PQresultStatus(r) != PGRES_COMMAND_OK) {
@@ -1198,6 +1261,7 @@ PgSqlLeaseMgr::commit() {
 
 void
 PgSqlLeaseMgr::rollback() {
+    Mutex::Locker locker(mutex_);
     LOG_DEBUG(dhcpsrv_logger, DHCPSRV_DBG_TRACE_DETAIL, DHCPSRV_PGSQL_ROLLBACK);
     PGresult * r = PQexec(conn_, "ROLLBACK");
     if (PQresultStatus(r) != PGRES_COMMAND_OK) {
@@ -31,6 +31,13 @@ bool Pool::inRange(const bundy::asiolink::IOAddress& addr) const {
     return (first_.smallerEqual(addr) && addr.smallerEqual(last_));
 }
 
+void
+Pool::initFreeAddressMap(uint8_t prefix_len) {
+    if (FreeAddressMap::getSize(first_, last_, prefix_len) > 0) {
+        free_map_.reset(new FreeAddressMap(first_, last_, prefix_len));
+    }
+}
+
 std::string
 Pool::toText() const {
     std::stringstream tmp;
@@ -50,6 +57,8 @@ Pool4::Pool4(const bundy::asiolink::IOAddress& first,
     if (last < first) {
         bundy_throw(BadValue, "Upper boundary is smaller than lower boundary.");
     }
+
+    initFreeAddressMap(32);
 }
 
 Pool4::Pool4( const bundy::asiolink::IOAddress& prefix, uint8_t prefix_len)
@@ -67,6 +76,8 @@ Pool4::Pool4( const bundy::asiolink::IOAddress& prefix, uint8_t prefix_len)
 
     // Let's now calculate the last address in defined pool
     last_ = lastAddrInPrefix(prefix, prefix_len);
+
+    initFreeAddressMap(32);
 }
 
 
@@ -105,6 +116,8 @@ Pool6::Pool6(Lease::Type type, const bundy::asiolink::IOAddress& first,
         bundy_throw(BadValue, "Invalid Pool6 type specified:"
                   << static_cast<int>(type));
     }
+
+    initFreeAddressMap(prefix_len_);
 }
 
 Pool6::Pool6(Lease::Type type, const bundy::asiolink::IOAddress& prefix,
@@ -138,6 +151,8 @@ Pool6::Pool6(Lease::Type type, const bundy::asiolink::IOAddress& prefix,
 
     // Let's now calculate the last address in defined pool
     last_ = lastAddrInPrefix(prefix, prefix_len);
+
+    initFreeAddressMap(prefix_len_);
 }
 
 std::string
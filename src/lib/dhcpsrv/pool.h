@@ -17,6 +17,7 @@
 
 #include <asiolink/io_address.h>
 #include <boost/shared_ptr.hpp>
+#include <dhcpsrv/free_address_map.h>
 #include <dhcpsrv/lease.h>
 
 #include <vector>
@@ -71,6 +72,16 @@ public:
     /// @return textual representation
     virtual std::string toText() const;
 
+    /// @brief Returns the index of the free addresses of the pool
+    ///
+    /// The allocation engine uses it to avoid proposing addresses
+    /// known to be in use.
+    ///
+    /// @return The map, or NULL if the pool is too large to be indexed
+    const FreeAddressMapPtr& getFreeAddressMap() const {
+        return (free_map_);
+    }
+
     /// @brief virtual destructor
     ///
     /// We need Pool to be a polymorphic class, so we could dynamic cast
@@ -94,6 +105,15 @@ protected:
          const bundy::asiolink::IOAddress& first,
          const bundy::asiolink::IOAddress& last);
 
+    /// @brief Creates the index of the free addresses
+    ///
+    /// Called by the constructors of the derived classes once the bounds
+    /// of the pool are known. No index is created if the pool is larger
+    /// than @c FreeAddressMap::MAX_SIZE.
+    ///
+    /// @param prefix_len length of the addresses or prefixes of the pool
+    void initFreeAddressMap(uint8_t prefix_len);
+
     /// @brief returns the next unique Pool-ID
     ///
     /// @return the next unique Pool-ID
@@ -120,6 +140,9 @@ protected:
 
     /// @brief defines a lease type that will be served from this pool
     Lease::Type type_;
+
+    /// @brief Index of the free addresses (may be NULL)
+    FreeAddressMapPtr free_map_;
 };
 
 /// @brief Pool information for IPv4 addresses
@@ -27,6 +27,8 @@ namespace dhcp {
 // This is an initial value of subnet-id. See comments in subnet.h for details.
 SubnetID Subnet::static_id_ = 1;
 
+std::atomic<uint64_t> Subnet::selectors_version_(0);
+
 Subnet::Subnet(const bundy::asiolink::IOAddress& prefix, uint8_t len,
                const Triplet<uint32_t>& t1,
                const Triplet<uint32_t>& t2,
@@ -75,6 +77,7 @@ Subnet::addOption(const OptionPtr& option, bool persistent,
 void
 Subnet::setRelayInfo(const bundy::dhcp::Subnet::RelayInfo& relay) {
     relay_ = relay;
+    ++selectors_version_;
 }
 
 bool
@@ -323,6 +326,7 @@ Subnet::delPools(Lease::Type type) {
 void
 Subnet::setIface(const std::string& iface_name) {
     iface_ = iface_name;
+    ++selectors_version_;
 }
 
 std::string
@@ -22,6 +22,8 @@
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include <atomic>
+
 #include <asiolink/io_address.h>
 #include <dhcp/option.h>
 #include <dhcp/classify.h>
@@ -417,6 +419,18 @@ public:
     /// @param relay structure that contains relay information
     void setRelayInfo(const bundy::dhcp::Subnet::RelayInfo& relay);
 
+    /// @brief Returns the version of the subnet selection parameters
+    ///
+    /// The value changes every time the interface name, the relay
+    /// information or the interface-id of any subnet is set. The
+    /// configuration manager uses it to find out when its index of the
+    /// subnets (see @ref SubnetIndex) is out of date.
+    ///
+    /// @return the current version
+    static uint64_t getSelectorsVersion() {
+        return (selectors_version_.load());
+    }
+
 
     /// @brief Returns const reference to relay information
     ///
@@ -516,6 +530,14 @@ protected:
         return (static_id_++);
     }
 
+    /// @brief Version of the subnet selection parameters
+    ///
+    /// Incremented by the methods setting the interface name, relay
+    /// information and interface-id (see @ref getSelectorsVersion).
+    ///
+    /// Static value initialized in subnet.cc.
+    static std::atomic<uint64_t> selectors_version_;
+
     /// @brief Checks if used pool type is valid
     ///
     /// Allowed type for Subnet4 is Pool::TYPE_V4.
@@ -731,6 +753,7 @@ public:
     /// @param ifaceid pointer to interface-id option
     void setInterfaceId(const OptionPtr& ifaceid) {
         interface_id_ = ifaceid;
+        ++selectors_version_;
     }
 
     /// @brief returns interface-id value (if specified)
@@ -0,0 +1,233 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SUBNET_INDEX_H
+#define SUBNET_INDEX_H
+
+#include <asiolink/io_address.h>
+#include <dhcp/option.h>
+#include <dhcpsrv/addr_utilities.h>
+#include <dhcpsrv/subnet.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Index of a collection of subnets
+///
+/// The configuration manager looks up the subnet of every packet, by the
+/// address of the relay or of the interface the packet was received on,
+/// by interface name or by interface-id. Walking over the whole collection
+/// for each packet gets expensive with thousands of (relayed) subnets, so
+/// this class indexes the subnets by each of these criteria.
+///
+/// The lookups return the positions of the matching subnets in the
+/// collection, in increasing order, so the caller can apply the remaining
+/// criteria (the client classes) and return the first subnet that fits,
+/// exactly as a linear search would.
+///
+/// The index is a snapshot: it keeps a copy of the collection and is never
+/// modified afterwards, so it can be used while the configuration manager
+/// replaces it with a new one when the collection (or the interface name,
+/// relay or interface-id of one of the subnets, see @c isCurrent) changes.
+///
+/// @tparam SubnetPtrType Subnet4Ptr or Subnet6Ptr
+template<typename SubnetPtrType>
+class SubnetIndex : public boost::noncopyable {
+public:
+    /// @brief Positions of subnets in the collection
+    typedef std::vector<size_t> Positions;
+
+    /// @brief Constructor
+    ///
+    /// @param subnets The collection of subnets to be indexed
+    SubnetIndex(const std::vector<SubnetPtrType>& subnets) :
+        version_(Subnet::getSelectorsVersion()), subnets_(subnets)
+    {
+        for (size_t pos = 0; pos < subnets.size(); ++pos) {
+            const SubnetPtrType& subnet = subnets[pos];
+            const std::pair<bundy::asiolink::IOAddress, uint8_t> prefix =
+                subnet->get();
+            prefixes_[prefix.second][firstAddrInPrefix(prefix.first,
+                                                       prefix.second)].
+                push_back(pos);
+            relays_[subnet->getRelayInfo().addr_].push_back(pos);
+            const std::string iface = subnet->getIface();
+            if (!iface.empty()) {
+                ifaces_[iface].push_back(pos);
+            }
+            addInterfaceId(subnet, pos);
+            ids_[subnet->getID()] = pos;
+        }
+    }
+
+    /// @brief Checks if the index is up to date
+    ///
+    /// @return false if the interface name, relay information or
+    ///         interface-id of a subnet (any subnet) were set since the
+    ///         index was built
+    bool isCurrent() const {
+        return (version_ == Subnet::getSelectorsVersion());
+    }
+
+    /// @brief Returns the number of subnets indexed
+    size_t getSize() const {
+        return (subnets_.size());
+    }
+
+    /// @brief Returns a subnet
+    ///
+    /// @param pos The position of the subnet, as returned by the lookups
+    const SubnetPtrType& getSubnet(size_t pos) const {
+        return (subnets_[pos]);
+    }
+
+    /// @brief Finds a subnet by identifier
+    ///
+    /// @param id The identifier of the subnet
+    /// @return The subnet, or NULL if none has this identifier
+    SubnetPtrType getById(SubnetID id) const {
+        const IdMap::const_iterator match = ids_.find(id);
+        return (match != ids_.end() ? subnets_[match->second] :
+                SubnetPtrType());
+    }
+
+    /// @brief Finds the subnets by address
+    ///
+    /// @param addr The address
+    /// @param relay If true, the subnets whose relay address is @c addr
+    ///        match too
+    /// @param[out] positions The positions of the subnets which contain
+    ///        the address (or have it as relay address), sorted
+    void getByAddress(const bundy::asiolink::IOAddress& addr, bool relay,
+                      Positions& positions) const {
+        positions.clear();
+        const uint8_t max_len = addr.isV4() ? 32 : 128;
+        for (typename PrefixMap::const_iterator it = prefixes_.begin();
+             it != prefixes_.end() && it->first <= max_len; ++it) {
+            const AddressMap::const_iterator match =
+                it->second.find(firstAddrInPrefix(addr, it->first));
+            if (match != it->second.end()) {
+                positions.insert(positions.end(), match->second.begin(),
+                                 match->second.end());
+            }
+        }
+        if (relay) {
+            const AddressMap::const_iterator match = relays_.find(addr);
+            if (match != relays_.end()) {
+                positions.insert(positions.end(), match->second.begin(),
+                                 match->second.end());
+            }
+        }
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()),
+                        positions.end());
+    }
+
+    /// @brief Finds the subnets by interface name
+    ///
+    /// @param iface The name of the interface
+    /// @return The positions of the subnets, sorted
+    const Positions& getByIface(const std::string& iface) const {
+        const IfaceMap::const_iterator match = ifaces_.find(iface);
+        return (match != ifaces_.end() ? match->second : empty_);
+    }
+
+    /// @brief Finds the subnets by interface-id
+    ///
+    /// @param interface_id The interface-id option
+    /// @return The positions of the subnets whose interface-id is equal
+    ///         to @c interface_id (see @c Option::equal), sorted
+    const Positions& getByInterfaceId(const OptionPtr& interface_id) const {
+        const InterfaceIdMap::const_iterator match =
+            interface_ids_.find(InterfaceIdKey(interface_id->getType(),
+                                               interface_id->getData()));
+        return (match != interface_ids_.end() ? match->second : empty_);
+    }
+
+private:
+    /// @brief Indexes the interface-id of a subnet, if it has one
+    ///
+    /// Only the IPv6 subnets have an interface-id.
+    void addInterfaceId(const Subnet4Ptr&, size_t) {
+    }
+
+    /// @brief Indexes the interface-id of a subnet, if it has one
+    void addInterfaceId(const Subnet6Ptr& subnet, size_t pos) {
+        const OptionPtr& interface_id = subnet->getInterfaceId();
+        if (interface_id) {
+            interface_ids_[InterfaceIdKey(interface_id->getType(),
+                                          interface_id->getData())].
+                push_back(pos);
+        }
+    }
+
+    typedef std::map<bundy::asiolink::IOAddress, Positions> AddressMap;
+    typedef std::map<uint8_t, AddressMap> PrefixMap;
+    typedef std::map<std::string, Positions> IfaceMap;
+    typedef std::pair<uint16_t, OptionBuffer> InterfaceIdKey;
+    typedef std::map<InterfaceIdKey, Positions> InterfaceIdMap;
+    typedef std::map<SubnetID, size_t> IdMap;
+
+    /// @brief The version of the selection parameters of the subnets
+    /// (read before the subnets, so a change during the build is not
+    /// missed)
+    const uint64_t version_;
+
+    /// @brief The subnets indexed
+    const std::vector<SubnetPtrType> subnets_;
+
+    /// @brief Subnets by prefix length, then by first address
+    PrefixMap prefixes_;
+
+    /// @brief Subnets by relay address
+    AddressMap relays_;
+
+    /// @brief Subnets by interface name
+    IfaceMap ifaces_;
+
+    /// @brief Subnets by interface-id (option type and data)
+    InterfaceIdMap interface_ids_;
+
+    /// @brief Subnets by identifier
+    IdMap ids_;
+
+    /// @brief Returned when nothing matches
+    const Positions empty_;
+};
+
+/// @brief Index of the IPv4 subnets
+typedef SubnetIndex<Subnet4Ptr> Subnet4Index;
+
+/// @brief Pointer to an index of the IPv4 subnets
+typedef boost::shared_ptr<const Subnet4Index> Subnet4IndexPtr;
+
+/// @brief Index of the IPv6 subnets
+typedef SubnetIndex<Subnet6Ptr> Subnet6Index;
+
+/// @brief Pointer to an index of the IPv6 subnets
+typedef boost::shared_ptr<const Subnet6Index> Subnet6IndexPtr;
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
+
+#endif // SUBNET_INDEX_H
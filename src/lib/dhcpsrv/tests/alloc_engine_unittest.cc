@@ -28,7 +28,10 @@
 #include <hooks/server_hooks.h>
 #include <hooks/callout_manager.h>
 #include <hooks/hooks_manager.h>
+#include <util/threads/thread.h>
 
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <gtest/gtest.h>
@@ -1310,6 +1313,76 @@ TEST_F(AllocEngine4Test, IterativeAllocator_manyPools4) {
 }
 
 
+// This test checks that the iterative allocator skips the addresses marked
+// as used in the free address map of the pool.
+TEST_F(AllocEngine4Test, IterativeAllocatorFreeAddressMap) {
+    NakedAllocEngine::IterativeAllocator alloc(Lease::TYPE_V4);
+    const FreeAddressMapPtr& map = pool_->getFreeAddressMap();
+    ASSERT_TRUE(map);
+    const time_t now = time(NULL);
+
+    map->setUsed(IOAddress("192.0.2.101"), now + 100);
+    map->setUsed(IOAddress("192.0.2.102"), now + 100);
+    // This lease has expired
+    map->setUsed(IOAddress("192.0.2.104"), now - 100);
+    map->setUsed(IOAddress("192.0.2.109"), now + 100);
+
+    EXPECT_EQ("192.0.2.100", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+    EXPECT_EQ("192.0.2.103", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+    EXPECT_EQ("192.0.2.104", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+
+    // The search wraps around at the end of the pool
+    map->setUsed(IOAddress("192.0.2.100"), now + 100);
+    for (int i = 105; i <= 108; ++i) {
+        EXPECT_EQ("192.0.2." + boost::lexical_cast<string>(i),
+                  alloc.pickAddress(subnet_, clientid_,
+                                    IOAddress("0.0.0.0")).toText());
+    }
+    EXPECT_EQ("192.0.2.103", alloc.pickAddress(subnet_, clientid_,
+                                               IOAddress("0.0.0.0")).toText());
+}
+
+// This test checks that the engine records the leases it allocates and the
+// ones it finds in use in the free address map.
+TEST_F(AllocEngine4Test, freeAddressMapUpdate) {
+    boost::scoped_ptr<AllocEngine> engine;
+    ASSERT_NO_THROW(engine.reset(new AllocEngine(AllocEngine::ALLOC_ITERATIVE,
+                                                 100, false)));
+    const FreeAddressMapPtr& map = pool_->getFreeAddressMap();
+    ASSERT_TRUE(map);
+
+    // Give the first address of the pool to another client
+    uint8_t hwaddr2[] = { 0, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe};
+    uint8_t clientid2[] = { 8, 7, 6, 5, 4, 3, 2, 1 };
+    Lease4Ptr used(new Lease4(IOAddress("192.0.2.100"), hwaddr2,
+                              sizeof(hwaddr2), clientid2, sizeof(clientid2),
+                              501, 502, 503, time(NULL), subnet_->getID()));
+    ASSERT_TRUE(LeaseMgrFactory::instance().addLease(used));
+    EXPECT_EQ(10, map->getFreeCount(time(NULL)));
+
+    // A fake allocation doesn't change anything
+    Lease4Ptr lease = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                             IOAddress("0.0.0.0"), false,
+                                             false, "", true,
+                                             CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_EQ("192.0.2.101", lease->addr_.toText());
+    EXPECT_TRUE(map->isFree(lease->addr_, time(NULL)));
+
+    // The used address was found on the way, though
+    EXPECT_FALSE(map->isFree(IOAddress("192.0.2.100"), time(NULL)));
+
+    lease = engine->allocateLease4(subnet_, clientid_, hwaddr_,
+                                   IOAddress("0.0.0.0"), false, false, "",
+                                   false, CalloutHandlePtr(), old_lease_);
+    ASSERT_TRUE(lease);
+    EXPECT_FALSE(map->isFree(lease->addr_, time(NULL)));
+    EXPECT_EQ(8, map->getFreeCount(time(NULL)));
+}
+
 // This test checks if really small pools are working
 TEST_F(AllocEngine4Test, smallPool4) {
     boost::scoped_ptr<AllocEngine> engine;
@@ -1556,6 +1629,198 @@ TEST_F(AllocEngine4Test, renewLease4) {
     detailCompareLease(lease, from_mgr);
 }
 
+/// @brief Allocates IPv4 leases for several clients
+///
+/// @param engine The allocation engine
+/// @param subnet The subnet
+/// @param first The last byte of the MAC address of the first client
+/// @param count Number of clients
+/// @param[out] leases The leases allocated (or null pointers)
+void
+allocateLeases4(AllocEngine* engine, Subnet4Ptr subnet, uint8_t first,
+                int count, vector<Lease4Ptr>* leases) {
+    CalloutHandlePtr callout_handle = HooksManager::createCalloutHandle();
+    for (int i = 0; i < count; ++i) {
+        const uint8_t mac[] = { 0, 2, 3, 4, 5, static_cast<uint8_t>(first + i) };
+        HWAddrPtr hwaddr(new HWAddr(mac, sizeof(mac), HTYPE_ETHER));
+        Lease4Ptr old_lease;
+        leases->push_back(engine->allocateLease4(subnet, ClientIdPtr(),
+                                                 hwaddr, IOAddress("0.0.0.0"),
+                                                 false, false, "", false,
+                                                 callout_handle, old_lease));
+    }
+}
+
+// This test checks that the leases allocated by several threads at once,
+// either free or expired, are all different.
+TEST_F(AllocEngine4Test, concurrentAllocations) {
+    AllocEngine engine(AllocEngine::ALLOC_ITERATIVE, 100, false);
+
+    // Half of the pool has expired leases.
+    for (int i = 0; i < 5; ++i) {
+        const uint8_t old_mac[] = { 0, 9, 9, 9, 9, static_cast<uint8_t>(i) };
+        IOAddress addr(static_cast<uint32_t>(IOAddress("192.0.2.100")) + i);
+        Lease4Ptr lease(new Lease4(addr, old_mac, sizeof(old_mac), 0, 0,
+                                   100, 50, 75, time(NULL) - 500,
+                                   subnet_->getID()));
+        ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+    }
+
+    const int threads = 4;
+    const int clients = 2;
+    vector<vector<Lease4Ptr> > leases(threads);
+    vector<boost::shared_ptr<bundy::util::thread::Thread> > allocators;
+    for (int i = 0; i < threads; ++i) {
+        allocators.push_back(boost::shared_ptr<bundy::util::thread::Thread>(
+            new bundy::util::thread::Thread(
+                boost::bind(&allocateLeases4, &engine, subnet_,
+                            i * clients, clients, &leases[i]))));
+    }
+    for (int i = 0; i < threads; ++i) {
+        allocators[i]->wait();
+    }
+
+    // A client may have lost a race (and would retry), but no address
+    // was given twice, and the lease database agrees.
+    set<IOAddress> addresses;
+    for (int i = 0; i < threads; ++i) {
+        for (int j = 0; j < clients; ++j) {
+            const Lease4Ptr& lease = leases[i][j];
+            if (!lease) {
+                continue;
+            }
+            EXPECT_TRUE(addresses.insert(lease->addr_).second)
+                << lease->addr_ << " allocated twice";
+            Lease4Ptr from_mgr =
+                LeaseMgrFactory::instance().getLease4(lease->addr_);
+            ASSERT_TRUE(from_mgr);
+            EXPECT_TRUE(from_mgr->hwaddr_ == lease->hwaddr_);
+        }
+    }
+    EXPECT_FALSE(addresses.empty());
+}
+
+/// @brief Allocates IPv6 leases for several clients
+///
+/// @param engine The allocation engine
+/// @param subnet The subnet
+/// @param type The type of the leases
+/// @param first The last byte of the DUID of the first client
+/// @param count Number of clients
+/// @param[out] leases The leases allocated (or null pointers)
+void
+allocateLeases6(AllocEngine* engine, Subnet6Ptr subnet, Lease::Type type,
+                uint8_t first, int count, vector<Lease6Ptr>* leases) {
+    CalloutHandlePtr callout_handle = HooksManager::createCalloutHandle();
+    for (int i = 0; i < count; ++i) {
+        vector<uint8_t> duid(8, 0x42);
+        duid[7] = first + i;
+        Lease6Collection old_leases;
+        Lease6Collection allocated =
+            engine->allocateLeases6(subnet, DuidPtr(new DUID(duid)), 42,
+                                    IOAddress("::"), type, false, false, "",
+                                    false, callout_handle, old_leases);
+        leases->push_back(allocated.empty() ? Lease6Ptr() : allocated[0]);
+    }
+}
+
+// This test checks that the addresses and prefixes allocated by several
+// threads at once, either free or expired, are all different.
+TEST_F(AllocEngine6Test, concurrentAllocations) {
+    AllocEngine engine(AllocEngine::ALLOC_ITERATIVE, 100);
+
+    // About half of the address pool has expired leases.
+    for (int i = 0; i < 8; ++i) {
+        vector<uint8_t> old_duid(8, 0x99);
+        old_duid[7] = i;
+        vector<uint8_t> bytes = IOAddress("2001:db8:1::10").toBytes();
+        bytes[15] += i;
+        Lease6Ptr lease(new Lease6(Lease::TYPE_NA,
+                                   IOAddress::fromBytes(AF_INET6, &bytes[0]),
+                                   DuidPtr(new DUID(old_duid)), 1,
+                                   501, 502, 503, 504, subnet_->getID(), 0));
+        lease->cltt_ = time(NULL) - 500;
+        lease->valid_lft_ = 495;
+        ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+    }
+
+    const int threads = 4;
+    const int clients = 3;
+    const Lease::Type types[] = { Lease::TYPE_NA, Lease::TYPE_PD };
+    for (int t = 0; t < 2; ++t) {
+        SCOPED_TRACE(Lease::typeToText(types[t]));
+        vector<Lease6Ptr> leases[threads];
+        vector<boost::shared_ptr<bundy::util::thread::Thread> > allocators;
+        for (int i = 0; i < threads; ++i) {
+            allocators.push_back(boost::shared_ptr<bundy::util::thread::Thread>(
+                new bundy::util::thread::Thread(
+                    boost::bind(&allocateLeases6, &engine, subnet_, types[t],
+                                i * clients, clients, &leases[i]))));
+        }
+        for (int i = 0; i < threads; ++i) {
+            allocators[i]->wait();
+        }
+
+        // Some clients may have lost a race and got nothing, but no address
+        // or prefix was given twice, and the lease database agrees.
+        set<IOAddress> addresses;
+        for (int i = 0; i < threads; ++i) {
+            for (int j = 0; j < clients; ++j) {
+                const Lease6Ptr& lease = leases[i][j];
+                if (!lease) {
+                    continue;
+                }
+                EXPECT_TRUE(addresses.insert(lease->addr_).second)
+                    << lease->addr_ << " allocated twice";
+                Lease6Ptr from_mgr =
+                    LeaseMgrFactory::instance().getLease6(types[t],
+                                                          lease->addr_);
+                ASSERT_TRUE(from_mgr);
+                EXPECT_TRUE(*from_mgr->duid_ == *lease->duid_);
+            }
+        }
+        EXPECT_FALSE(addresses.empty());
+    }
+}
+
+/// @brief Releases a lease and gets it back, as a client would
+///
+/// @param lease The lease
+/// @param count Number of times
+void
+releaseLease6(Lease6Ptr lease, int count) {
+    for (int i = 0; i < count; ++i) {
+        LeaseMgrFactory::instance().deleteLease(lease->addr_);
+        LeaseMgrFactory::instance().addLease(lease);
+    }
+}
+
+// This test checks that a lease released while it is updated is left
+// alone, rather than reported as an error.
+TEST_F(AllocEngine6Test, updateReleasedLease6) {
+    AllocEngine engine(AllocEngine::ALLOC_ITERATIVE, 100);
+    Lease6Ptr lease(new Lease6(Lease::TYPE_NA, IOAddress("2001:db8:1::10"),
+                               duid_, iaid_, 501, 502, 503, 504,
+                               subnet_->getID(), 0));
+    ASSERT_TRUE(LeaseMgrFactory::instance().addLease(lease));
+
+    const int count = 20000;
+    bundy::util::thread::Thread releaser(boost::bind(&releaseLease6,
+                                                     lease, count));
+    for (int i = 0; i < count; ++i) {
+        Lease6Ptr current =
+            LeaseMgrFactory::instance().getLease6(Lease::TYPE_NA,
+                                                  lease->addr_);
+        if (!current) {
+            continue;
+        }
+        Lease6Ptr updated(new Lease6(*current));
+        updated->cltt_ = time(NULL);
+        EXPECT_NO_THROW(engine.updateLease6IfUnchanged(updated, *current));
+    }
+    releaser.wait();
+}
+
 /// @brief helper class used in Hooks testing in AllocEngine6
 ///
 /// It features a couple of callout functions and buffers to store
@@ -16,6 +16,7 @@
 
 #include <dhcpsrv/cfgmgr.h>
 #include <dhcpsrv/dhcp_parsers.h>
+#include <dhcpsrv/lease_mgr_factory.h>
 #include <exceptions/exceptions.h>
 #include <dhcp/dhcp6.h>
 #include <dhcp/tests/iface_mgr_test_config.h>
@@ -508,6 +509,77 @@ TEST_F(CfgMgrTest, subnet4RelayOverride) {
     EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress("10.0.0.3"), classify_, false));
 }
 
+// This test verifies that when several subnets match, the one configured
+// first is returned, as with a linear search over the subnets.
+TEST_F(CfgMgrTest, subnet4Overlapping) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    Subnet4Ptr subnet1(new Subnet4(IOAddress("192.0.2.64"), 26, 1, 2, 3));
+    Subnet4Ptr subnet2(new Subnet4(IOAddress("192.0.2.0"), 24, 1, 2, 3));
+    Subnet4Ptr subnet3(new Subnet4(IOAddress("192.0.2.0"), 26, 1, 2, 3));
+    subnet2->setRelayInfo(IOAddress("192.0.2.70"));
+
+    cfg_mgr.addSubnet4(subnet1);
+    cfg_mgr.addSubnet4(subnet2);
+    cfg_mgr.addSubnet4(subnet3);
+
+    EXPECT_EQ(subnet1, cfg_mgr.getSubnet4(IOAddress("192.0.2.70"), classify_));
+    EXPECT_EQ(subnet1, cfg_mgr.getSubnet4(IOAddress("192.0.2.70"), classify_,
+                                          true));
+    EXPECT_EQ(subnet2, cfg_mgr.getSubnet4(IOAddress("192.0.2.5"), classify_));
+    EXPECT_EQ(subnet2, cfg_mgr.getSubnet4(IOAddress("192.0.2.200"),
+                                          classify_));
+
+    // The subnets the client is not allowed in are skipped
+    subnet1->allowClientClass("foo");
+    subnet2->allowClientClass("foo");
+    EXPECT_EQ(subnet3, cfg_mgr.getSubnet4(IOAddress("192.0.2.5"), classify_));
+    EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress("192.0.2.70"), classify_, true));
+    classify_.insert("foo");
+    EXPECT_EQ(subnet1, cfg_mgr.getSubnet4(IOAddress("192.0.2.70"), classify_,
+                                          true));
+}
+
+// This test verifies the selection among many relayed subnets, and that
+// the changes of the configuration are taken into account.
+TEST_F(CfgMgrTest, subnet4Many) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+
+    std::vector<Subnet4Ptr> subnets;
+    for (int i = 0; i < 1000; ++i) {
+        const uint32_t prefix = (10 << 24) + (i << 8);
+        subnets.push_back(Subnet4Ptr(new Subnet4(IOAddress(prefix), 24,
+                                                 1, 2, 3)));
+        subnets.back()->setRelayInfo(IOAddress((172 << 24) + i));
+        cfg_mgr.addSubnet4(subnets.back());
+    }
+    cfg_mgr.commitSubnets4();
+
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(subnets[i], cfg_mgr.getSubnet4(
+                      IOAddress((10 << 24) + (i << 8) + 1), classify_));
+        ASSERT_EQ(subnets[i], cfg_mgr.getSubnet4(
+                      IOAddress((172 << 24) + i), classify_, true));
+    }
+    EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress((10 << 24) + (1000 << 8)),
+                                    classify_));
+
+    // Move a subnet to another relay
+    subnets[5]->setRelayInfo(IOAddress("192.0.2.1"));
+    EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress((172 << 24) + 5), classify_,
+                                    true));
+    EXPECT_EQ(subnets[5], cfg_mgr.getSubnet4(IOAddress("192.0.2.1"),
+                                             classify_, true));
+
+    // And add one more subnet
+    Subnet4Ptr subnet(new Subnet4(IOAddress("192.0.2.0"), 24, 1, 2, 3));
+    cfg_mgr.addSubnet4(subnet);
+    EXPECT_EQ(subnet, cfg_mgr.getSubnet4(IOAddress("192.0.2.1"), classify_));
+
+    cfg_mgr.deleteSubnets4();
+    EXPECT_FALSE(cfg_mgr.getSubnet4(IOAddress("10.0.0.1"), classify_));
+}
+
 // This test verifies if the configuration manager is able to hold v6 subnets
 // with their relay address information and return proper subnets, based on
 // those addresses.
@@ -1088,6 +1160,77 @@ TEST_F(CfgMgrTest, subnet6Duplication) {
     EXPECT_THROW(cfg_mgr.addSubnet6(subnet3), bundy::dhcp::DuplicateSubnetID);
 }
 
+// Checks that the leases in the lease database are recorded in the free
+// address maps of the IPv4 pools when the subnets are committed, and that
+// released addresses are free again.
+TEST_F(CfgMgrTest, freeAddressMap4) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+    LeaseMgrFactory::create("type=memfile universe=4 persist=false");
+
+    const time_t now = time(NULL);
+    const uint8_t hwaddr[] = { 0, 1, 2, 3, 4, 5 };
+    // The second lease has a stale subnet ID, its pool is found by address.
+    Lease4 lease1(IOAddress("192.0.2.10"), hwaddr, sizeof(hwaddr), NULL, 0,
+                  3600, 1800, 2700, now, 1);
+    Lease4 lease2(IOAddress("192.0.2.200"), hwaddr, sizeof(hwaddr), NULL, 0,
+                  3600, 1800, 2700, now, 99);
+    EXPECT_TRUE(LeaseMgrFactory::instance().addLease(
+                    Lease4Ptr(new Lease4(lease1))));
+    EXPECT_TRUE(LeaseMgrFactory::instance().addLease(
+                    Lease4Ptr(new Lease4(lease2))));
+
+    Subnet4Ptr subnet(new Subnet4(IOAddress("192.0.2.0"), 24, 1, 2, 3, 1));
+    Pool4Ptr pool(new Pool4(IOAddress("192.0.2.0"), 24));
+    subnet->addPool(pool);
+    cfg_mgr.addSubnet4(subnet);
+    cfg_mgr.commitSubnets4();
+
+    const FreeAddressMapPtr& map = pool->getFreeAddressMap();
+    EXPECT_EQ(254, map->getFreeCount(now));
+    EXPECT_FALSE(map->isFree(IOAddress("192.0.2.10"), now));
+    EXPECT_FALSE(map->isFree(IOAddress("192.0.2.200"), now));
+    EXPECT_TRUE(map->isFree(IOAddress("192.0.2.11"), now));
+
+    cfg_mgr.setAddressFree(lease1);
+    EXPECT_TRUE(map->isFree(IOAddress("192.0.2.10"), now));
+    EXPECT_EQ(255, map->getFreeCount(now));
+
+    LeaseMgrFactory::destroy();
+}
+
+// Checks that the leases in the lease database are recorded in the free
+// address maps of the IPv6 pools when the subnets are committed, and that
+// released addresses are free again.
+TEST_F(CfgMgrTest, freeAddressMap6) {
+    CfgMgr& cfg_mgr = CfgMgr::instance();
+    LeaseMgrFactory::create("type=memfile universe=6 persist=false");
+
+    const time_t now = time(NULL);
+    DuidPtr duid(new DUID(vector<uint8_t>(8, 0x42)));
+    Lease6 lease(Lease::TYPE_NA, IOAddress("2001:db8:1::10"), duid, 1, 1800,
+                 3600, 900, 1350, 1);
+    EXPECT_TRUE(LeaseMgrFactory::instance().addLease(
+                    Lease6Ptr(new Lease6(lease))));
+
+    Subnet6Ptr subnet(new Subnet6(IOAddress("2001:db8:1::"), 64, 1, 2, 3, 4,
+                                  1));
+    Pool6Ptr pool(new Pool6(Lease::TYPE_NA, IOAddress("2001:db8:1::"),
+                            IOAddress("2001:db8:1::ff")));
+    subnet->addPool(pool);
+    cfg_mgr.addSubnet6(subnet);
+    cfg_mgr.commitSubnets6();
+
+    const FreeAddressMapPtr& map = pool->getFreeAddressMap();
+    EXPECT_EQ(255, map->getFreeCount(now));
+    EXPECT_FALSE(map->isFree(IOAddress("2001:db8:1::10"), now));
+
+    cfg_mgr.setAddressFree(lease);
+    EXPECT_TRUE(map->isFree(IOAddress("2001:db8:1::10"), now));
+    EXPECT_EQ(256, map->getFreeCount(now));
+
+    LeaseMgrFactory::destroy();
+}
+
 
 /// @todo Add unit-tests for testing:
 /// - addActiveIface() with invalid interface name
@@ -87,10 +87,12 @@ public:
             }
 
             // Add the keyword and value - make sure that they are quoted.
-            // The only parameter which is not quoted is persist as it
-            // is a boolean value.
+            // The only parameters which are not quoted are persist as it
+            // is a boolean value, and the intervals as they are integers.
             result += quote + keyval[i] + quote + colon + space;
-            if (std::string(keyval[i]) != "persist") {
+            const std::string keyword(keyval[i]);
+            if ((keyword != "persist") && (keyword != "commit-interval") &&
+                (keyword != "lfc-interval")) {
                 result += quote + keyval[i + 1] + quote;
             } else {
                 result += keyval[i + 1];
@@ -281,6 +283,27 @@ TEST_F(DbAccessParserTest, persistV6Memfile) {
                       config, Option::V6);
 }
 
+// Check that the parser accepts the parameters of the writes to the
+// Memfile lease file, including the integer ones.
+TEST_F(DbAccessParserTest, journalMemfile) {
+    const char* config[] = {"type", "memfile",
+                            "name", "/opt/bundy/var/kea-leases4.csv",
+                            "durability", "batch",
+                            "commit-interval", "5",
+                            "lfc-interval", "3600",
+                            NULL};
+
+    string json_config = toJson(config);
+    ConstElementPtr json_elements = Element::fromJSON(json_config);
+    EXPECT_TRUE(json_elements);
+
+    TestDbAccessParser parser("lease-database", ParserContext(Option::V4));
+    EXPECT_NO_THROW(parser.build(json_elements));
+
+    checkAccessString("Valid memfile", parser.getDbAccessParameters(),
+                      config);
+}
+
 // Check that the parser works with a valid MySQL configuration
 TEST_F(DbAccessParserTest, validTypeMysql) {
     const char* config[] = {"type",     "mysql",
@@ -0,0 +1,213 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <asiolink/io_address.h>
+#include <dhcpsrv/free_address_map.h>
+#include <exceptions/exceptions.h>
+
+#include <gtest/gtest.h>
+
+#include <time.h>
+#include <vector>
+
+using namespace bundy;
+using namespace bundy::dhcp;
+using namespace bundy::asiolink;
+
+namespace {
+
+// Checks the computation of the size of the pools.
+TEST(FreeAddressMapTest, getSize) {
+    EXPECT_EQ(1, FreeAddressMap::getSize(IOAddress("192.0.2.1"),
+                                         IOAddress("192.0.2.1"), 32));
+    EXPECT_EQ(256, FreeAddressMap::getSize(IOAddress("192.0.2.0"),
+                                           IOAddress("192.0.2.255"), 32));
+    EXPECT_EQ(FreeAddressMap::MAX_SIZE,
+              FreeAddressMap::getSize(IOAddress("10.0.0.0"),
+                                      IOAddress("10.15.255.255"), 32));
+    EXPECT_EQ(0, FreeAddressMap::getSize(IOAddress("10.0.0.0"),
+                                         IOAddress("10.16.0.0"), 32));
+    EXPECT_EQ(0, FreeAddressMap::getSize(IOAddress("192.0.2.2"),
+                                         IOAddress("192.0.2.1"), 32));
+
+    EXPECT_EQ(16, FreeAddressMap::getSize(IOAddress("2001:db8::10"),
+                                          IOAddress("2001:db8::1f"), 128));
+    EXPECT_EQ(0, FreeAddressMap::getSize(IOAddress("2001:db8::"),
+                                         IOAddress("2001:db8::ffff:ffff"),
+                                         128));
+    EXPECT_EQ(0, FreeAddressMap::getSize(IOAddress("2001:db8::"),
+                                         IOAddress("2001:db9::"), 128));
+    // 2001:db8::/32 split into /48 prefixes
+    EXPECT_EQ(65536, FreeAddressMap::getSize(
+                  IOAddress("2001:db8::"),
+                  IOAddress("2001:db8:ffff:ffff:ffff:ffff:ffff:ffff"), 48));
+
+    // Mixed families
+    EXPECT_EQ(0, FreeAddressMap::getSize(IOAddress("192.0.2.1"),
+                                         IOAddress("2001:db8::1"), 32));
+
+    EXPECT_THROW(FreeAddressMap(IOAddress("10.0.0.0"),
+                                IOAddress("10.255.255.255"), 32), BadValue);
+}
+
+// Checks the tracking of the addresses in use, for IPv4.
+TEST(FreeAddressMapTest, addresses4) {
+    FreeAddressMap map(IOAddress("192.0.2.10"), IOAddress("192.0.2.19"), 32);
+    const time_t now = time(NULL);
+    EXPECT_EQ(10, map.getSize());
+    EXPECT_EQ(10, map.getFreeCount(now));
+
+    map.setUsed(IOAddress("192.0.2.10"), now + 100);
+    map.setUsed(IOAddress("192.0.2.11"), now + 100);
+    map.setUsed(IOAddress("192.0.2.13"), now - 100);
+    // Out of the pool, ignored
+    map.setUsed(IOAddress("192.0.2.20"), now + 100);
+    EXPECT_EQ(8, map.getFreeCount(now));
+
+    EXPECT_FALSE(map.isFree(IOAddress("192.0.2.10"), now));
+    EXPECT_FALSE(map.isFree(IOAddress("192.0.2.11"), now));
+    EXPECT_TRUE(map.isFree(IOAddress("192.0.2.12"), now));
+    // The lease has expired
+    EXPECT_TRUE(map.isFree(IOAddress("192.0.2.13"), now));
+    // Unless we go back in time
+    EXPECT_FALSE(map.isFree(IOAddress("192.0.2.13"), now - 200));
+    EXPECT_FALSE(map.isFree(IOAddress("192.0.2.20"), now));
+
+    IOAddress found("0.0.0.0");
+    ASSERT_TRUE(map.findFree(now, found));
+    EXPECT_EQ("192.0.2.12", found.toText());
+    ASSERT_TRUE(map.findFree(IOAddress("192.0.2.12"), now, found));
+    EXPECT_EQ("192.0.2.13", found.toText());
+    // Starts from the beginning if the address is not in the pool
+    ASSERT_TRUE(map.findFree(IOAddress("192.0.2.1"), now, found));
+    EXPECT_EQ("192.0.2.12", found.toText());
+
+    map.setUsed(IOAddress("192.0.2.19"), now + 100);
+    ASSERT_TRUE(map.findFree(IOAddress("192.0.2.17"), now, found));
+    EXPECT_EQ("192.0.2.18", found.toText());
+    EXPECT_FALSE(map.findFree(IOAddress("192.0.2.18"), now, found));
+
+    map.setFree(IOAddress("192.0.2.10"));
+    EXPECT_TRUE(map.isFree(IOAddress("192.0.2.10"), now));
+    ASSERT_TRUE(map.findFree(now, found));
+    EXPECT_EQ("192.0.2.10", found.toText());
+}
+
+// Checks the tracking of IPv6 addresses, across a byte boundary.
+TEST(FreeAddressMapTest, addresses6) {
+    FreeAddressMap map(IOAddress("2001:db8::fff0"),
+                       IOAddress("2001:db8::1:000f"), 128);
+    const time_t now = time(NULL);
+    EXPECT_EQ(32, map.getSize());
+
+    map.setUsed(IOAddress("2001:db8::fff0"), now + 100);
+    map.setUsed(IOAddress("2001:db8::ffff"), now + 100);
+    map.setUsed(IOAddress("2001:db8::1:f"), now + 100);
+    EXPECT_EQ(29, map.getFreeCount(now));
+
+    IOAddress found("::");
+    ASSERT_TRUE(map.findFree(IOAddress("2001:db8::ffff"), now, found));
+    EXPECT_EQ("2001:db8::1:0", found.toText());
+    map.setUsed(IOAddress("2001:db8::1:0"), now + 100);
+    ASSERT_TRUE(map.findFree(IOAddress("2001:db8::ffff"), now, found));
+    EXPECT_EQ("2001:db8::1:1", found.toText());
+    EXPECT_FALSE(map.isFree(IOAddress("2001:db8::1:0"), now));
+    EXPECT_FALSE(map.isFree(IOAddress("2001:db8::1:10"), now));
+    EXPECT_FALSE(map.isFree(IOAddress("192.0.2.1"), now));
+}
+
+// Checks the tracking of delegated prefixes.
+TEST(FreeAddressMapTest, prefixes) {
+    // 2001:db8::/48 split into /64 prefixes
+    FreeAddressMap map(IOAddress("2001:db8::"),
+                       IOAddress("2001:db8:0:ffff:ffff:ffff:ffff:ffff"), 64);
+    const time_t now = time(NULL);
+    EXPECT_EQ(65536, map.getSize());
+
+    map.setUsed(IOAddress("2001:db8::"), now + 100);
+    map.setUsed(IOAddress("2001:db8:0:1::"), now + 100);
+    EXPECT_FALSE(map.isFree(IOAddress("2001:db8:0:1::"), now));
+
+    IOAddress found("::");
+    ASSERT_TRUE(map.findFree(now, found));
+    EXPECT_EQ("2001:db8:0:2::", found.toText());
+    ASSERT_TRUE(map.findFree(IOAddress("2001:db8:0:ff::"), now, found));
+    EXPECT_EQ("2001:db8:0:100::", found.toText());
+    EXPECT_FALSE(map.findFree(IOAddress("2001:db8:0:ffff::"), now, found));
+}
+
+// Checks the search on a larger pool (whose size is not a power of two)
+// against a plain scan of the expiration times.
+TEST(FreeAddressMapTest, search) {
+    FreeAddressMap map(IOAddress("10.0.0.0"), IOAddress("10.0.3.231"), 32);
+    const time_t now = time(NULL);
+    ASSERT_EQ(1000, map.getSize());
+
+    // 10.0.0.0
+    const uint32_t base = 0x0a000000;
+    std::vector<time_t> expire(1000, 0);
+    unsigned int seed = 1;
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 500; ++i) {
+            seed = seed * 1103515245 + 12345;
+            const size_t pos = (seed >> 8) % expire.size();
+            // Mostly used, so the free ones are sparse.
+            expire[pos] = (seed >> 4) % 8 == 0 ? 0 :
+                now + static_cast<int>((seed >> 12) % 200) - 20;
+            const IOAddress addr(base + pos);
+            if (expire[pos] == 0) {
+                map.setFree(addr);
+            } else {
+                map.setUsed(addr, expire[pos]);
+            }
+        }
+
+        uint64_t free_count = 0;
+        for (size_t pos = 0; pos < expire.size(); ++pos) {
+            if (expire[pos] < now) {
+                ++free_count;
+            }
+        }
+        EXPECT_EQ(free_count, map.getFreeCount(now));
+
+        // Search from every address.
+        for (size_t pos = 0; pos < expire.size(); ++pos) {
+            size_t next = pos + 1;
+            while (next < expire.size() && expire[next] >= now) {
+                ++next;
+            }
+            IOAddress found("0.0.0.0");
+            const IOAddress after(base + pos);
+            if (next < expire.size()) {
+                ASSERT_TRUE(map.findFree(after, now, found));
+                EXPECT_EQ(base + next, static_cast<uint32_t>(found));
+            } else {
+                EXPECT_FALSE(map.findFree(after, now, found));
+            }
+        }
+    }
+
+    // Nothing free at all
+    for (size_t pos = 0; pos < expire.size(); ++pos) {
+        map.setUsed(IOAddress(base + pos),
+                    now + 100);
+    }
+    IOAddress found("0.0.0.0");
+    EXPECT_FALSE(map.findFree(now, found));
+    EXPECT_EQ(0, map.getFreeCount(now));
+}
+
+}
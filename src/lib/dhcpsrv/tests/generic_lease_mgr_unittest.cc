@@ -1506,6 +1506,73 @@ GenericLeaseMgrTest::testRecreateLease6() {
     detailCompareLease(lease, l_returned);
 }
 
+void
+GenericLeaseMgrTest::testGetLeases4() {
+    // Nothing in the database yet.
+    EXPECT_TRUE(lmptr_->getLeases4().empty());
+
+    vector<Lease4Ptr> leases = createLeases4();
+    for (int i = 0; i < leases.size(); ++i) {
+        EXPECT_TRUE(lmptr_->addLease(leases[i]));
+    }
+
+    // All of them are returned, in no particular order.
+    Lease4Collection returned = lmptr_->getLeases4();
+    ASSERT_EQ(leases.size(), returned.size());
+    for (int i = 0; i < leases.size(); ++i) {
+        Lease4Ptr match;
+        for (int j = 0; j < returned.size(); ++j) {
+            if (returned[j]->addr_ == leases[i]->addr_) {
+                match = returned[j];
+            }
+        }
+        ASSERT_TRUE(match) << leases[i]->addr_;
+        detailCompareLease(leases[i], match);
+    }
+
+    // The deleted leases are not.
+    EXPECT_TRUE(lmptr_->deleteLease(ioaddress4_[2]));
+    returned = lmptr_->getLeases4();
+    EXPECT_EQ(leases.size() - 1, returned.size());
+    for (int j = 0; j < returned.size(); ++j) {
+        EXPECT_FALSE(returned[j]->addr_ == ioaddress4_[2]);
+    }
+}
+
+void
+GenericLeaseMgrTest::testGetLeases6() {
+    // Nothing in the database yet.
+    EXPECT_TRUE(lmptr_->getLeases6().empty());
+
+    vector<Lease6Ptr> leases = createLeases6();
+    for (int i = 0; i < leases.size(); ++i) {
+        EXPECT_TRUE(lmptr_->addLease(leases[i]));
+    }
+
+    // All of them are returned, whatever their type, in no particular
+    // order.
+    Lease6Collection returned = lmptr_->getLeases6();
+    ASSERT_EQ(leases.size(), returned.size());
+    for (int i = 0; i < leases.size(); ++i) {
+        Lease6Ptr match;
+        for (int j = 0; j < returned.size(); ++j) {
+            if (returned[j]->addr_ == leases[i]->addr_) {
+                match = returned[j];
+            }
+        }
+        ASSERT_TRUE(match) << leases[i]->addr_;
+        detailCompareLease(leases[i], match);
+    }
+
+    // The deleted leases are not.
+    EXPECT_TRUE(lmptr_->deleteLease(ioaddress6_[2]));
+    returned = lmptr_->getLeases6();
+    EXPECT_EQ(leases.size() - 1, returned.size());
+    for (int j = 0; j < returned.size(); ++j) {
+        EXPECT_FALSE(returned[j]->addr_ == ioaddress6_[2]);
+    }
+}
+
 
 }; // namespace test
 }; // namespace dhcp
@@ -245,6 +245,12 @@ public:
     /// persistent storage has been updated as expected.
     void testRecreateLease6();
 
+    /// @brief Checks that all the IPv4 leases can be retrieved
+    void testGetLeases4();
+
+    /// @brief Checks that all the IPv6 leases can be retrieved
+    void testGetLeases6();
+
     /// @brief String forms of IPv4 addresses
     std::vector<std::string>  straddress4_;
 
@@ -0,0 +1,258 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcpsrv/lease_file_journal.h>
+#include <dhcpsrv/lease_mgr.h>
+#include <dhcpsrv/tests/lease_file_io.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+using namespace bundy;
+using namespace bundy::dhcp;
+using namespace bundy::dhcp::test;
+using bundy::util::thread::Thread;
+
+namespace {
+
+/// @brief Test fixture class for the lease file journal
+class LeaseFileJournalTest : public ::testing::Test {
+public:
+    /// @brief Constructor
+    ///
+    /// Creates the lease file with a header. The files are removed when
+    /// the test finishes.
+    LeaseFileJournalTest() :
+        io_(absolutePath("journal.csv")),
+        tmp_io_(absolutePath("journal.csv.tmp")) {
+        io_.writeFile("header\n");
+    }
+
+    /// @brief Returns the absolute path to a file used by the tests.
+    ///
+    /// @param filename Name of the file.
+    static std::string absolutePath(const std::string& filename) {
+        std::ostringstream s;
+        s << TEST_DATA_BUILDDIR << "/" << filename;
+        return (s.str());
+    }
+
+    /// @brief Appends records from several threads
+    ///
+    /// @param journal The journal.
+    /// @param threads Number of threads.
+    /// @param records Number of records appended by each thread.
+    static void appendFromThreads(LeaseFileJournal& journal, int threads,
+                                  int records) {
+        std::vector<boost::shared_ptr<Thread> > appenders;
+        for (int i = 0; i < threads; ++i) {
+            appenders.push_back(boost::shared_ptr<Thread>(
+                new Thread(boost::bind(&appendRecords, &journal, i,
+                                       records))));
+        }
+        for (int i = 0; i < threads; ++i) {
+            appenders[i]->wait();
+        }
+    }
+
+    /// @brief Appends records "<id>-0" to "<id>-<records - 1>".
+    static void appendRecords(LeaseFileJournal* journal, int id,
+                              int records) {
+        for (int i = 0; i < records; ++i) {
+            journal->append(boost::lexical_cast<std::string>(id) + "-" +
+                            boost::lexical_cast<std::string>(i));
+        }
+    }
+
+    /// @brief Snapshot writer creating a file with the given contents.
+    static void writeSnapshot(const std::string& contents,
+                              const std::string& filename) {
+        std::ofstream fs(filename.c_str());
+        fs << contents;
+    }
+
+    /// @brief Snapshot writer failing.
+    static void failSnapshot(const std::string&) {
+        bundy_throw(DbOperationError, "snapshot failed");
+    }
+
+    /// @brief Counts the lines of a text.
+    static size_t countLines(const std::string& text) {
+        size_t count = 0;
+        for (size_t pos = text.find('\n'); pos != std::string::npos;
+             pos = text.find('\n', pos + 1)) {
+            ++count;
+        }
+        return (count);
+    }
+
+    /// @brief The lease file
+    LeaseFileIO io_;
+
+    /// @brief The temporary file of the compaction
+    LeaseFileIO tmp_io_;
+};
+
+// Checks the conversion of the durability names.
+TEST_F(LeaseFileJournalTest, textToDurability) {
+    EXPECT_EQ(LeaseFileJournal::WRITE,
+              LeaseFileJournal::textToDurability("write"));
+    EXPECT_EQ(LeaseFileJournal::SYNC,
+              LeaseFileJournal::textToDurability("sync"));
+    EXPECT_EQ(LeaseFileJournal::BATCH,
+              LeaseFileJournal::textToDurability("batch"));
+    EXPECT_THROW(LeaseFileJournal::textToDurability("fast"), BadValue);
+}
+
+// Checks that the lease file must exist.
+TEST_F(LeaseFileJournalTest, noFile) {
+    EXPECT_THROW(LeaseFileJournal(absolutePath("nonexistent/journal.csv"),
+                                  LeaseFileJournal::WRITE, 1),
+                 DbOperationError);
+}
+
+// Checks that the records are written immediately by default.
+TEST_F(LeaseFileJournalTest, write) {
+    LeaseFileJournal journal(io_.testfile_, LeaseFileJournal::WRITE, 1);
+    journal.append("a,b");
+    EXPECT_EQ("header\na,b\n", io_.readFile());
+    journal.append("c,d");
+    EXPECT_EQ("header\na,b\nc,d\n", io_.readFile());
+}
+
+// Checks that the records are on disk when append returns, even when
+// appended by several threads at once.
+TEST_F(LeaseFileJournalTest, sync) {
+    LeaseFileJournal journal(io_.testfile_, LeaseFileJournal::SYNC, 1);
+    journal.append("a,b");
+    EXPECT_EQ("header\na,b\n", io_.readFile());
+
+    appendFromThreads(journal, 4, 50);
+    const std::string contents = io_.readFile();
+    EXPECT_EQ(202, countLines(contents));
+    // The records of each thread are in order.
+    EXPECT_LT(contents.find("\n2-0\n"), contents.find("\n2-49\n"));
+}
+
+// Checks that a failed write is reported only for the records it failed
+// to write, even to a waiter woken after another batch has failed.
+TEST_F(LeaseFileJournalTest, syncFailed) {
+    LeaseFileJournal journal(io_.testfile_, LeaseFileJournal::SYNC, 1);
+    const uint64_t seq1 = journal.enqueue("a");
+    journal.flush();
+
+    // Make the next write fail by limiting the size of the files to the
+    // current one.
+    struct stat st;
+    ASSERT_EQ(0, stat(io_.testfile_.c_str(), &st));
+    struct rlimit old_limit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &old_limit));
+    void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    struct rlimit limit = old_limit;
+    limit.rlim_cur = st.st_size;
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+    const uint64_t seq2 = journal.enqueue("b");
+    journal.flush();
+    setrlimit(RLIMIT_FSIZE, &old_limit);
+    signal(SIGXFSZ, old_handler);
+
+    EXPECT_NO_THROW(journal.wait(seq1));
+    EXPECT_THROW(journal.wait(seq2), DbOperationError);
+
+    // The next ones are written again.
+    EXPECT_NO_THROW(journal.append("c"));
+    EXPECT_EQ("header\na\nc\n", io_.readFile());
+}
+
+// Checks that the queued records are written by flush and when the journal
+// is destroyed.
+TEST_F(LeaseFileJournalTest, batch) {
+    {
+        LeaseFileJournal journal(io_.testfile_, LeaseFileJournal::BATCH, 5);
+        journal.append("a,b");
+        journal.append("c,d");
+        journal.flush();
+        EXPECT_EQ("header\na,b\nc,d\n", io_.readFile());
+
+        appendFromThreads(journal, 4, 50);
+        journal.append("e,f");
+    }
+    const std::string contents = io_.readFile();
+    EXPECT_EQ(204, countLines(contents));
+    EXPECT_EQ("e,f\n", contents.substr(contents.size() - 4));
+}
+
+// Checks that the compaction replaces the file with the snapshot, followed
+// by the records appended meanwhile.
+TEST_F(LeaseFileJournalTest, compact) {
+    const LeaseFileJournal::Durability durabilities[] = {
+        LeaseFileJournal::WRITE, LeaseFileJournal::SYNC,
+        LeaseFileJournal::BATCH
+    };
+    for (int i = 0; i < 3; ++i) {
+        SCOPED_TRACE(i);
+        io_.writeFile("header\n");
+        LeaseFileJournal journal(io_.testfile_, durabilities[i], 1);
+        journal.append("a,1");
+        journal.append("b,1");
+        journal.append("a,2");
+        ASSERT_TRUE(journal.compact(boost::bind(&writeSnapshot,
+                                                "header\nb,1\na,2\n", _1)));
+        journal.append("b,2");
+        journal.flush();
+        EXPECT_EQ("header\nb,1\na,2\nb,2\n", io_.readFile());
+        EXPECT_FALSE(tmp_io_.exists());
+
+        // The records go to the new file
+        journal.append("c,1");
+        journal.flush();
+        EXPECT_EQ("header\nb,1\na,2\nb,2\nc,1\n", io_.readFile());
+
+        // And it can be compacted again
+        ASSERT_TRUE(journal.compact(boost::bind(&writeSnapshot,
+                                                "header\n", _1)));
+        journal.flush();
+        EXPECT_EQ("header\n", io_.readFile());
+    }
+}
+
+// Checks that the lease file is left alone if the compaction fails.
+TEST_F(LeaseFileJournalTest, compactFailed) {
+    LeaseFileJournal journal(io_.testfile_, LeaseFileJournal::SYNC, 1);
+    journal.append("a,1");
+    ASSERT_TRUE(journal.compact(&failSnapshot));
+    journal.append("a,2");
+    journal.flush();
+    EXPECT_EQ("header\na,1\na,2\n", io_.readFile());
+    EXPECT_FALSE(tmp_io_.exists());
+
+    journal.append("a,3");
+    EXPECT_EQ("header\na,1\na,2\na,3\n", io_.readFile());
+}
+
+}
@@ -140,6 +140,13 @@ public:
         return (Lease4Ptr());
     }
 
+    /// @brief Returns all IPv4 leases
+    ///
+    /// @return empty collection
+    virtual Lease4Collection getLeases4() const {
+        return (Lease4Collection());
+    }
+
     /// @brief Returns existing IPv6 lease for a given IPv6 address.
     ///
     /// @param addr address of the searched lease
@@ -173,6 +180,13 @@ public:
         return (leases6_);
     }
 
+    /// @brief Returns all IPv6 leases
+    ///
+    /// @return whatever is set in leases6_ field
+    virtual Lease6Collection getLeases6() const {
+        return (leases6_);
+    }
+
     /// @brief Updates IPv4 lease.
     ///
     /// @param lease4 The lease to be updated.
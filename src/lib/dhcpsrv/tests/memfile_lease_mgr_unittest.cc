@@ -25,6 +25,7 @@
 #include <dhcpsrv/tests/generic_lease_mgr_unittest.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -203,6 +204,103 @@ TEST_F(MemfileLeaseMgrTest, persistLeases) {
     EXPECT_FALSE(lease_mgr->persistLeases(Memfile_LeaseMgr::V6));
 }
 
+// Checks that the parameters of the writes to the lease file are checked.
+TEST_F(MemfileLeaseMgrTest, journalParameters) {
+    LeaseFileIO io4(getLeaseFilePath("leasefile4_1.csv"));
+
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["name"] = getLeaseFilePath("leasefile4_1.csv");
+    pmap["durability"] = "batch";
+    pmap["commit-interval"] = "10";
+    pmap["lfc-interval"] = "3600";
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr;
+    EXPECT_NO_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)));
+    lease_mgr.reset();
+
+    pmap["durability"] = "bogus";
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)),
+                 bundy::BadValue);
+
+    pmap["durability"] = "sync";
+    pmap["commit-interval"] = "bogus";
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)),
+                 bundy::BadValue);
+
+    pmap["commit-interval"] = "10";
+    pmap["lfc-interval"] = "1h";
+    EXPECT_THROW(lease_mgr.reset(new Memfile_LeaseMgr(pmap)),
+                 bundy::BadValue);
+}
+
+// Checks that the DHCPv4 lease file is compacted, and that the leases
+// changed meanwhile are not lost.
+TEST_F(MemfileLeaseMgrTest, compactLeaseFile4) {
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "4";
+    pmap["name"] = getLeaseFilePath("leasefile4_0.csv");
+    pmap["durability"] = "batch";
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr(new Memfile_LeaseMgr(pmap));
+
+    std::vector<Lease4Ptr> leases = createLeases4();
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(lease_mgr->addLease(leases[i]));
+    }
+    leases[1]->valid_lft_ += 100;
+    lease_mgr->updateLease4(leases[1]);
+    ASSERT_TRUE(lease_mgr->deleteLease(leases[0]->addr_));
+    lease_mgr->commit();
+    std::string contents = io4_.readFile();
+    // The header and 5 records
+    EXPECT_EQ(6, std::count(contents.begin(), contents.end(), '\n'));
+
+    lease_mgr->compactLeaseFile();
+    leases[2]->valid_lft_ += 100;
+    lease_mgr->updateLease4(leases[2]);
+    lease_mgr->commit();
+    contents = io4_.readFile();
+    // The header, the 2 leases and the last update
+    EXPECT_EQ(4, std::count(contents.begin(), contents.end(), '\n'));
+
+    // Check that the leases are read back from the new file.
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    EXPECT_FALSE(lease_mgr->getLease4(leases[0]->addr_));
+    for (int i = 1; i < 3; ++i) {
+        Lease4Ptr lease = lease_mgr->getLease4(leases[i]->addr_);
+        ASSERT_TRUE(lease);
+        detailCompareLease(leases[i], lease);
+    }
+}
+
+// Checks that the DHCPv6 lease file is compacted.
+TEST_F(MemfileLeaseMgrTest, compactLeaseFile6) {
+    LeaseMgr::ParameterMap pmap;
+    pmap["universe"] = "6";
+    pmap["name"] = getLeaseFilePath("leasefile6_0.csv");
+    pmap["durability"] = "sync";
+    boost::scoped_ptr<Memfile_LeaseMgr> lease_mgr(new Memfile_LeaseMgr(pmap));
+
+    std::vector<Lease6Ptr> leases = createLeases6();
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(lease_mgr->addLease(leases[i]));
+    }
+    ASSERT_TRUE(lease_mgr->deleteLease(leases[0]->addr_));
+
+    lease_mgr->compactLeaseFile();
+    lease_mgr->commit();
+    const std::string contents = io6_.readFile();
+    EXPECT_EQ(3, std::count(contents.begin(), contents.end(), '\n'));
+
+    lease_mgr.reset(new Memfile_LeaseMgr(pmap));
+    EXPECT_FALSE(lease_mgr->getLease6(leases[0]->type_, leases[0]->addr_));
+    for (int i = 1; i < 3; ++i) {
+        Lease6Ptr lease = lease_mgr->getLease6(leases[i]->type_,
+                                               leases[i]->addr_);
+        ASSERT_TRUE(lease);
+        detailCompareLease(leases[i], lease);
+    }
+}
+
 
 // Checks that adding/getting/deleting a Lease6 object works.
 TEST_F(MemfileLeaseMgrTest, addGetDelete6) {
@@ -404,6 +502,18 @@ TEST_F(MemfileLeaseMgrTest, testRecreateLease6) {
     testRecreateLease6();
 }
 
+/// @brief Checks that all the IPv4 leases can be retrieved.
+TEST_F(MemfileLeaseMgrTest, getLeases4) {
+    startBackend(V4);
+    testGetLeases4();
+}
+
+/// @brief Checks that all the IPv6 leases can be retrieved.
+TEST_F(MemfileLeaseMgrTest, getLeases6) {
+    startBackend(V6);
+    testGetLeases6();
+}
+
 // The following tests are not applicable for memfile. When adding
 // new tests to the list here, make sure to provide brief explanation
 // why they are not applicable:
@@ -456,4 +456,14 @@ TEST_F(PgSqlLeaseMgrTest, updateLease6) {
     testUpdateLease6();
 }
 
+/// @brief Checks that all the IPv4 leases can be retrieved.
+TEST_F(PgSqlLeaseMgrTest, getLeases4) {
+    testGetLeases4();
+}
+
+/// @brief Checks that all the IPv6 leases can be retrieved.
+TEST_F(PgSqlLeaseMgrTest, getLeases6) {
+    testGetLeases6();
+}
+
 };
@@ -251,6 +251,30 @@ TEST(Pool6Test, unique_id) {
 
 }
 
+// Checks that the pools small enough get a free address map
+TEST(Pool6Test, freeAddressMap) {
+    Pool4 pool1(IOAddress("192.0.2.0"), 24);
+    ASSERT_TRUE(pool1.getFreeAddressMap());
+    EXPECT_EQ(256, pool1.getFreeAddressMap()->getSize());
+
+    // 2^24 addresses is too many
+    Pool4 pool2(IOAddress("10.0.0.0"), 8);
+    EXPECT_FALSE(pool2.getFreeAddressMap());
+
+    Pool6 pool3(Lease::TYPE_NA, IOAddress("2001:db8::1"),
+                IOAddress("2001:db8::ff"));
+    ASSERT_TRUE(pool3.getFreeAddressMap());
+    EXPECT_EQ(255, pool3.getFreeAddressMap()->getSize());
+
+    Pool6 pool4(Lease::TYPE_NA, IOAddress("2001:db8::"), 64);
+    EXPECT_FALSE(pool4.getFreeAddressMap());
+
+    // The prefix pools are indexed by delegated prefix
+    Pool6 pool5(Lease::TYPE_PD, IOAddress("2001:db8:1::"), 48, 64);
+    ASSERT_TRUE(pool5.getFreeAddressMap());
+    EXPECT_EQ(65536, pool5.getFreeAddressMap()->getSize());
+}
+
 // Simple check if toText returns reasonable values
 TEST(Poo6Test,toText) {
     Pool6 pool1(Lease::TYPE_NA, IOAddress("2001:db8::1"),
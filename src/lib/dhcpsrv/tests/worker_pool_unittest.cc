@@ -0,0 +1,160 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+
+#include <dhcpsrv/worker_pool.h>
+#include <exceptions/exceptions.h>
+#include <util/threads/sync.h>
+
+#include <boost/bind.hpp>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <vector>
+
+using namespace bundy;
+using namespace bundy::dhcp;
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+
+namespace {
+
+/// @brief Test fixture class for the worker pool
+class WorkerPoolTest : public ::testing::Test {
+public:
+    /// @brief Constructor
+    WorkerPoolTest() : blocked_(false), started_(false) {
+    }
+
+    /// @brief Records that the work of a key was done
+    ///
+    /// @param key The key
+    /// @param value The number of the work for this key
+    void record(size_t key, int value) {
+        Mutex::Locker locker(mutex_);
+        done_[key].push_back(value);
+    }
+
+    /// @brief Waits until @c unblock is called
+    void block() {
+        Mutex::Locker locker(mutex_);
+        started_ = true;
+        cond_.broadcast();
+        while (blocked_) {
+            cond_.wait(mutex_);
+        }
+    }
+
+    /// @brief Lets the blocked works complete
+    void unblock() {
+        Mutex::Locker locker(mutex_);
+        blocked_ = false;
+        cond_.broadcast();
+    }
+
+    /// @brief Waits until a work calls @c block
+    void waitStarted() {
+        Mutex::Locker locker(mutex_);
+        while (!started_) {
+            cond_.wait(mutex_);
+        }
+    }
+
+    /// @brief Throws
+    static void fail() {
+        bundy_throw(Unexpected, "the work failed");
+    }
+
+    /// @brief Protects the members below
+    Mutex mutex_;
+
+    /// @brief Signaled when a work blocks or the works are unblocked
+    CondVar cond_;
+
+    /// @brief Set while the works must block
+    bool blocked_;
+
+    /// @brief Set when a work blocks
+    bool started_;
+
+    /// @brief The works done, by key
+    std::map<size_t, std::vector<int> > done_;
+};
+
+// Checks that the pool needs a thread.
+TEST_F(WorkerPoolTest, noThread) {
+    EXPECT_THROW(WorkerPool(0, 0), BadValue);
+}
+
+// Checks that the works of each key are done in order, and all are done
+// by drain.
+TEST_F(WorkerPoolTest, order) {
+    WorkerPool pool(4, 0);
+    EXPECT_EQ(4, pool.getSize());
+    for (int i = 0; i < 100; ++i) {
+        for (size_t key = 0; key < 10; ++key) {
+            ASSERT_TRUE(pool.dispatch(key, boost::bind(&WorkerPoolTest::record,
+                                                       this, key, i)));
+        }
+    }
+    pool.drain();
+
+    Mutex::Locker locker(mutex_);
+    ASSERT_EQ(10, done_.size());
+    for (size_t key = 0; key < 10; ++key) {
+        ASSERT_EQ(100, done_[key].size());
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(i, done_[key][i]);
+        }
+    }
+}
+
+// Checks that a full queue rejects the works.
+TEST_F(WorkerPoolTest, full) {
+    WorkerPool pool(1, 2);
+    blocked_ = true;
+    // The thread takes the first one and blocks, then two may wait.
+    ASSERT_TRUE(pool.dispatch(0, boost::bind(&WorkerPoolTest::block, this)));
+    waitStarted();
+    EXPECT_TRUE(pool.dispatch(0, boost::bind(&WorkerPoolTest::record, this,
+                                             0, 1)));
+    EXPECT_TRUE(pool.dispatch(1, boost::bind(&WorkerPoolTest::record, this,
+                                             1, 1)));
+    EXPECT_FALSE(pool.dispatch(0, boost::bind(&WorkerPoolTest::record, this,
+                                              0, 2)));
+    unblock();
+    pool.drain();
+
+    Mutex::Locker locker(mutex_);
+    EXPECT_EQ(1, done_[0].size());
+    EXPECT_EQ(1, done_[1].size());
+}
+
+// Checks that the pool goes on after a failed work, and that the
+// destructor completes the works queued.
+TEST_F(WorkerPoolTest, failAndDestroy) {
+    {
+        WorkerPool pool(2, 0);
+        ASSERT_TRUE(pool.dispatch(0, &WorkerPoolTest::fail));
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(pool.dispatch(0, boost::bind(&WorkerPoolTest::record,
+                                                     this, 0, i)));
+        }
+    }
+    Mutex::Locker locker(mutex_);
+    EXPECT_EQ(10, done_[0].size());
+}
+
+}
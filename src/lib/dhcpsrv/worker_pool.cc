@@ -0,0 +1,141 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dhcpsrv/dhcpsrv_log.h>
+#include <dhcpsrv/worker_pool.h>
+#include <exceptions/exceptions.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <deque>
+
+using bundy::util::thread::CondVar;
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace dhcp {
+
+struct WorkerPool::Worker {
+    Worker() : busy(false), stopping(false) {
+    }
+
+    /// @brief Protects the members below
+    Mutex mutex;
+
+    /// @brief Signaled when a work is queued or the thread must stop
+    CondVar work_cond;
+
+    /// @brief Broadcast when the queue is empty and the thread idle
+    CondVar idle_cond;
+
+    /// @brief The works queued
+    std::deque<Work> queue;
+
+    /// @brief Set while a work is done
+    bool busy;
+
+    /// @brief Set when the thread must terminate
+    bool stopping;
+
+    /// @brief The thread
+    boost::scoped_ptr<Thread> thread;
+};
+
+WorkerPool::WorkerPool(size_t size, size_t max_queued) :
+    max_queued_(max_queued)
+{
+    if (size == 0) {
+        bundy_throw(BadValue, "a worker pool needs at least one thread");
+    }
+    for (size_t i = 0; i < size; ++i) {
+        workers_.push_back(boost::shared_ptr<Worker>(new Worker()));
+        workers_.back()->thread.reset(
+            new Thread(boost::bind(&WorkerPool::run, workers_.back().get())));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Mutex::Locker locker(workers_[i]->mutex);
+        workers_[i]->stopping = true;
+        workers_[i]->work_cond.signal();
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread->wait();
+    }
+}
+
+bool
+WorkerPool::dispatch(size_t key, const Work& work) {
+    Worker& worker = *workers_[key % workers_.size()];
+    Mutex::Locker locker(worker.mutex);
+    if (max_queued_ > 0 && worker.queue.size() >= max_queued_) {
+        return (false);
+    }
+    worker.queue.push_back(work);
+    worker.work_cond.signal();
+    return (true);
+}
+
+void
+WorkerPool::drain() {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker& worker = *workers_[i];
+        Mutex::Locker locker(worker.mutex);
+        while (worker.busy || !worker.queue.empty()) {
+            worker.idle_cond.wait(worker.mutex);
+        }
+    }
+}
+
+void
+WorkerPool::run(Worker* worker) {
+    while (true) {
+        Work work;
+        {
+            Mutex::Locker locker(worker->mutex);
+            while (worker->queue.empty() && !worker->stopping) {
+                worker->work_cond.wait(worker->mutex);
+            }
+            if (worker->queue.empty()) {
+                return;
+            }
+            work.swap(worker->queue.front());
+            worker->queue.pop_front();
+            worker->busy = true;
+        }
+
+        try {
+            work();
+        } catch (const std::exception& ex) {
+            LOG_ERROR(dhcpsrv_logger, DHCPSRV_WORKER_ERROR).arg(ex.what());
+        } catch (...) {
+            LOG_ERROR(dhcpsrv_logger, DHCPSRV_WORKER_ERROR)
+                .arg("unknown exception");
+        }
+
+        Mutex::Locker locker(worker->mutex);
+        worker->busy = false;
+        if (worker->queue.empty()) {
+            worker->idle_cond.broadcast();
+        }
+    }
+}
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
@@ -0,0 +1,98 @@
+// Copyright (C) 2014 Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace bundy {
+namespace dhcp {
+
+/// @brief Threads processing the packets of a server
+///
+/// The server's receiving thread hands each packet over to the pool, with
+/// a key identifying the client. Each thread of the pool has its own queue
+/// and the key selects it, so the packets of a client are processed one
+/// at a time and in the order they were received, while those of other
+/// clients are processed in parallel.
+///
+/// An exception thrown by the work is logged, and the thread goes on with
+/// the next one.
+class WorkerPool : public boost::noncopyable {
+public:
+    /// @brief The processing of a packet
+    typedef boost::function<void()> Work;
+
+    /// @brief Constructor
+    ///
+    /// Starts the threads.
+    ///
+    /// @param size Number of threads (at least 1)
+    /// @param max_queued Maximum number of works waiting in the queue of a
+    ///        thread (0 for unlimited)
+    ///
+    /// @throw BadValue if @c size is 0
+    WorkerPool(size_t size, size_t max_queued);
+
+    /// @brief Destructor
+    ///
+    /// Completes the works queued and stops the threads.
+    ~WorkerPool();
+
+    /// @brief Queues a work
+    ///
+    /// @param key The works with the same key are done in order, by the
+    ///        same thread
+    /// @param work The work
+    ///
+    /// @return false if the queue of the thread is full (and the work was
+    ///         discarded)
+    bool dispatch(size_t key, const Work& work);
+
+    /// @brief Waits until all the works queued are done
+    void drain();
+
+    /// @brief Returns the number of threads
+    size_t getSize() const {
+        return (workers_.size());
+    }
+
+private:
+    /// @brief A thread and its queue (defined in the implementation)
+    struct Worker;
+
+    /// @brief Body of a thread
+    ///
+    /// @param worker The thread's worker
+    static void run(Worker* worker);
+
+    /// @brief The threads
+    std::vector<boost::shared_ptr<Worker> > workers_;
+
+    /// @brief Maximum number of works in a queue (0 for unlimited)
+    const size_t max_queued_;
+};
+
+/// @brief Pointer to a worker pool
+typedef boost::shared_ptr<WorkerPool> WorkerPoolPtr;
+
+} // end of bundy::dhcp namespace
+} // end of bundy namespace
+
+#endif // WORKER_POOL_H
@@ -88,6 +88,24 @@ const char* const root_to_com_names[] = {
     NULL
 };
 
+// Names contained in a typical positive response from an authoritative
+// server: the question, a CNAME and its target in the answer section, NS
+// names in the authority section and their addresses (A and AAAA) in the
+// additional section.
+const char* const example_positive_names[] = {
+    // question section
+    "www.example.com",
+    // answer section
+    "www.example.com", "www.cdn.example.com", "www.cdn.example.com",
+    // authority section
+    "example.com", "ns1.example.com", "example.com", "ns2.example.com",
+    "example.com", "ns.example.net",
+    // additional section
+    "ns1.example.com", "ns1.example.com", "ns2.example.com",
+    "ns2.example.com", "ns.example.net", "ns.example.net",
+    NULL
+};
+
 // Names contained a typical "NXDOMAIN" response: the question, the owner
 // name of SOA, and its MNAME and RNAME.
 const char* const example_nxdomain_names[] = {
@@ -154,7 +172,9 @@ main(int argc, char* argv[]) {
 
     typedef pair<const char* const*, string> DataSpec;
     vector<DataSpec> spec_list;
-    spec_list.push_back(DataSpec(root_to_com_names, "(positive response)"));
+    spec_list.push_back(DataSpec(root_to_com_names, "(referral response)"));
+    spec_list.push_back(DataSpec(example_positive_names,
+                                 "(positive response)"));
     spec_list.push_back(DataSpec(example_nxdomain_names,
                                  "(NXDOMAIN response)"));
     spec_list.push_back(DataSpec(example_servfail_names,
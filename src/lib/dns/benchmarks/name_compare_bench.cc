@@ -0,0 +1,309 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <bench/benchmark.h>
+
+#include <dns/name.h>
+#include <dns/name_internal.h>
+#include <dns/labelsequence.h>
+
+#include <boost/functional/hash.hpp>
+
+#include <cctype>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace bundy::bench;
+using namespace bundy::dns;
+using bundy::dns::name::internal::maptolower;
+
+namespace {
+// The names to be compared, with the offsets of their labels (as those
+// LabelSequence internally has) so the old implementation below doesn't
+// have to calculate them for each comparison.
+struct NameData {
+    NameData(const Name& name_param) : name(name_param) {
+        size_t len;
+        const uint8_t* data = LabelSequence(name).getData(&len);
+        for (size_t pos = 0; pos < len; pos += data[pos] + 1) {
+            offsets.push_back(pos);
+        }
+    }
+    Name name;
+    vector<size_t> offsets;
+};
+typedef pair<NameData, NameData> NamePair;
+
+// The original implementations of case-insensitive comparison and
+// hashing, which handle one character at a time using the maptolower
+// table.  They are kept here to measure the improvement.
+struct OldImpl {
+    static bool equals(const NamePair& names) {
+        size_t len1, len2;
+        const uint8_t* data1 = LabelSequence(names.first.name).getData(&len1);
+        const uint8_t* data2 =
+            LabelSequence(names.second.name).getData(&len2);
+        if (len1 != len2) {
+            return (false);
+        }
+        for (size_t i = 0; i < len1; ++i) {
+            if (maptolower[data1[i]] != maptolower[data2[i]]) {
+                return (false);
+            }
+        }
+        return (true);
+    }
+    static int compare(const NamePair& names) {
+        size_t len;
+        const uint8_t* data1 = LabelSequence(names.first.name).getData(&len);
+        const uint8_t* data2 = LabelSequence(names.second.name).getData(&len);
+        int l1 = names.first.offsets.size();
+        int l2 = names.second.offsets.size();
+        const int ldiff = l1 - l2;
+        unsigned int l = (ldiff < 0) ? l1 : l2;
+        while (l > 0) {
+            --l;
+            --l1;
+            --l2;
+            size_t pos1 = names.first.offsets[l1];
+            size_t pos2 = names.second.offsets[l2];
+            const unsigned int count1 = data1[pos1++];
+            const unsigned int count2 = data2[pos2++];
+            const int cdiff =
+                static_cast<int>(count1) - static_cast<int>(count2);
+            unsigned int count = (cdiff < 0) ? count1 : count2;
+            while (count > 0) {
+                const int chdiff =
+                    static_cast<int>(maptolower[data1[pos1]]) -
+                    static_cast<int>(maptolower[data2[pos2]]);
+                if (chdiff != 0) {
+                    return (chdiff);
+                }
+                --count;
+                ++pos1;
+                ++pos2;
+            }
+            if (cdiff != 0) {
+                return (cdiff);
+            }
+        }
+        return (ldiff);
+    }
+    static size_t hash(const NamePair& names) {
+        size_t len;
+        const uint8_t* data = LabelSequence(names.first.name).getData(&len);
+        size_t hash_val = 0;
+        for (size_t i = 0; i < len; ++i) {
+            boost::hash_combine(hash_val, maptolower[data[i]]);
+        }
+        return (hash_val);
+    }
+};
+
+// The current implementation of the library.
+struct NewImpl {
+    static bool equals(const NamePair& names) {
+        return (LabelSequence(names.first.name).equals(
+                    LabelSequence(names.second.name)));
+    }
+    static int compare(const NamePair& names) {
+        return (LabelSequence(names.first.name).compare(
+                    LabelSequence(names.second.name)).getOrder());
+    }
+    static size_t hash(const NamePair& names) {
+        return (LabelSequence(names.first.name).getFullHash(false, 0));
+    }
+};
+
+enum Operation { EQUALS, COMPARE, HASH };
+
+// This templated test performs the given operation for all pairs of names
+// using a given (templated) implementation.
+template <typename T>
+class NameCompareBenchMark {
+public:
+    NameCompareBenchMark(const vector<NamePair>& names, Operation op) :
+        names_(names), op_(op), result_(0)
+    {}
+    unsigned int run() {
+        vector<NamePair>::const_iterator it = names_.begin();
+        const vector<NamePair>::const_iterator it_end = names_.end();
+        for (; it != it_end; ++it) {
+            switch (op_) {
+            case EQUALS:
+                result_ += T::equals(*it);
+                break;
+            case COMPARE:
+                result_ += T::compare(*it);
+                break;
+            case HASH:
+                result_ += T::hash(*it);
+                break;
+            }
+        }
+        return (names_.size());
+    }
+    // Keep the result visible so the compiler can't omit the calculation.
+    size_t getResult() const { return (result_); }
+private:
+    const vector<NamePair>& names_;
+    const Operation op_;
+    size_t result_;
+};
+
+//
+// Builtin benchmark data.
+//
+// Names of a typical delegation response from a root server, as used in
+// message_renderer_bench.  Short labels only.
+const char* const root_to_com_names[] = {
+    "www.example.com", "com", "a.gtld-servers.net", "b.gtld-servers.net",
+    "c.gtld-servers.net", "d.gtld-servers.net", "e.gtld-servers.net",
+    "f.gtld-servers.net", "g.gtld-servers.net", "h.gtld-servers.net",
+    "i.gtld-servers.net", "j.gtld-servers.net", "k.gtld-servers.net",
+    "l.gtld-servers.net", "m.gtld-servers.net",
+    NULL
+};
+
+// NSEC3 owner names, which have a 32-character label.
+const char* const nsec3_names[] = {
+    "0p9mhaveqvm6t7vbl5lop2u3t2rp3tom.example.com",
+    "2t7b4g4vsa5smi47k61mv5bv1a22bojr.example.com",
+    "2vptu5timamqttgl4luu9kg21e0aor3s.example.com",
+    "35mthgpgcu1qg68fab165klnsnk3dpvl.example.com",
+    "b4um86eghhds6nea196smvmlo4ors995.example.com",
+    "gjeqe526plbf1g8mklp59enfd789njgi.example.com",
+    "ji6neoaepv8b5o6k4ev33abha8ht9fgc.example.com",
+    "k8udemvp1j2f7eg6jebps17vp3n8i58h.example.com",
+    "q04jkcevqvmu85r014c7dkba38o0ji5r.example.com",
+    "r53bq7cc2uvmubfu5ocmm6pers9tk9en.example.com",
+    NULL
+};
+
+// Names with long labels, e.g., for DKIM and other TXT based records.
+const char* const long_label_names[] = {
+    "selector1-example-com-0123456789abcdefghijklmnopqrstuvwxyzabcde"
+    "._domainkey.example.com",
+    "selector2-example-com-0123456789abcdefghijklmnopqrstuvwxyzabcde"
+    "._domainkey.example.com",
+    "a-rather-long-host-name-for-a-web-server-in-the-content-network"
+    ".cdn.example.net",
+    NULL
+};
+
+// Build the pairs of names to be compared: each name with its copy of
+// randomized case (like a query name using "DNS 0x20"), so they are
+// all compared to the end.  If 'modify_last' is true, the last character
+// of the first label is changed in the copy, i.e., they differ only there.
+vector<NamePair>
+buildPairs(const char* const* names, bool modify_last) {
+    vector<NamePair> pairs;
+    for (size_t i = 0; names[i] != NULL; ++i) {
+        string copy(names[i]);
+        for (size_t j = 0; j < copy.size(); ++j) {
+            if ((random() & 1) != 0) {
+                copy[j] = toupper(copy[j]);
+            }
+        }
+        if (modify_last) {
+            size_t dot = copy.find('.');
+            if (dot == string::npos) {
+                dot = copy.size();
+            }
+            copy[dot - 1] = (copy[dot - 1] == '0') ? '1' : '0';
+        }
+        pairs.push_back(NamePair(NameData(Name(names[i])),
+                                 NameData(Name(copy))));
+    }
+    return (pairs);
+}
+
+void
+usage() {
+    cerr << "Usage: name_compare_bench [-n iterations]" << endl;
+    exit (1);
+}
+}
+
+int
+main(int argc, char* argv[]) {
+    int ch;
+    int iteration = 1000000;
+    while ((ch = getopt(argc, argv, "n:")) != -1) {
+        switch (ch) {
+        case 'n':
+            iteration = atoi(optarg);
+            break;
+        case '?':
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    if (argc != 0) {
+        usage();
+    }
+
+    cout << "Parameters:" << endl;
+    cout << "  Iterations: " << iteration << endl;
+    cout << "  Compare implementation: "
+         << bundy::dns::name::internal::getMismatchImplName() << endl;
+
+    typedef pair<const char* const*, string> DataSpec;
+    vector<DataSpec> spec_list;
+    spec_list.push_back(DataSpec(root_to_com_names, "(short labels)"));
+    spec_list.push_back(DataSpec(nsec3_names, "(NSEC3 names)"));
+    spec_list.push_back(DataSpec(long_label_names, "(long labels)"));
+
+    const char* const op_names[] = { "equals", "compare", "hash" };
+    size_t result = 0;
+    for (vector<DataSpec>::const_iterator it = spec_list.begin();
+         it != spec_list.end();
+         ++it) {
+        const vector<NamePair> same_pairs = buildPairs(it->first, false);
+        const vector<NamePair> diff_pairs = buildPairs(it->first, true);
+        for (int op = EQUALS; op <= HASH; ++op) {
+            // Equal names make the most sense for equals and hash; for
+            // compare we use names that differ at the last character to be
+            // compared.
+            const vector<NamePair>& pairs =
+                (op == COMPARE) ? diff_pairs : same_pairs;
+
+            typedef NameCompareBenchMark<OldImpl> OldBenchMark;
+            cout << "Benchmark for old " << op_names[op] << " "
+                 << it->second << endl;
+            OldBenchMark old_bench(pairs, static_cast<Operation>(op));
+            BenchMark<OldBenchMark> old_bm(iteration, old_bench, true);
+            result += old_bench.getResult();
+
+            typedef NameCompareBenchMark<NewImpl> NewBenchMark;
+            cout << "Benchmark for new " << op_names[op] << " "
+                 << it->second << endl;
+            NewBenchMark new_bench(pairs, static_cast<Operation>(op));
+            BenchMark<NewBenchMark> new_bm(iteration, new_bench, true);
+            result += new_bench.getResult();
+        }
+    }
+    // Not very useful, but ensures the results are used.
+    cout << "(checksum: " << result << ")" << endl;
+
+    return (0);
+}
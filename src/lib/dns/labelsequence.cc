@@ -18,8 +18,6 @@
 #include <dns/name_internal.h>
 #include <exceptions/exceptions.h>
 
-#include <boost/functional/hash.hpp>
-
 #include <cstring>
 
 namespace bundy {
@@ -161,15 +159,8 @@ LabelSequence::equals(const LabelSequence& other, bool case_sensitive) const {
     // As long as the data was originally validated as (part of) a name,
     // label length must never be a capital ascii character, so we can
     // simply compare them after converting to lower characters.
-    for (size_t i = 0; i < len; ++i) {
-        const uint8_t ch = data[i];
-        const uint8_t other_ch = other_data[i];
-        if (bundy::dns::name::internal::maptolower[ch] !=
-            bundy::dns::name::internal::maptolower[other_ch]) {
-            return (false);
-        }
-    }
-    return (true);
+    return (bundy::dns::name::internal::findMismatch(data, other_data, len,
+                                                     false) == len);
 }
 
 NameComparisonResult
@@ -202,9 +193,11 @@ LabelSequence::compare(const LabelSequence& other,
         const int cdiff = static_cast<int>(count1) - static_cast<int>(count2);
         unsigned int count = (cdiff < 0) ? count1 : count2;
 
-        while (count > 0) {
-            const uint8_t label1 = data_[pos1];
-            const uint8_t label2 = other.data_[pos2];
+        const unsigned int i = bundy::dns::name::internal::findMismatch(
+            &data_[pos1], &other.data_[pos2], count, case_sensitive);
+        if (i < count) {
+            const uint8_t label1 = data_[pos1 + i];
+            const uint8_t label2 = other.data_[pos2 + i];
             int chdiff;
 
             if (case_sensitive) {
@@ -215,16 +208,10 @@ LabelSequence::compare(const LabelSequence& other,
                     static_cast<int>(
                         bundy::dns::name::internal::maptolower[label2]);
             }
-
-            if (chdiff != 0) {
-                return (NameComparisonResult(
-                            chdiff, nlabels,
-                            nlabels == 0 ? NameComparisonResult::NONE :
-                            NameComparisonResult::COMMONANCESTOR));
-            }
-            --count;
-            ++pos1;
-            ++pos2;
+            return (NameComparisonResult(
+                        chdiff, nlabels,
+                        nlabels == 0 ? NameComparisonResult::NONE :
+                        NameComparisonResult::COMMONANCESTOR));
         }
         if (cdiff != 0) {
             return (NameComparisonResult(
@@ -279,14 +266,8 @@ LabelSequence::getHashHelper(bool case_sensitive,
         length = max_length;
     }
 
-    size_t hash_val = seed;
-    while (length > 0) {
-        const uint8_t c = *s++;
-        boost::hash_combine(hash_val, case_sensitive ? c :
-                            bundy::dns::name::internal::maptolower[c]);
-        --length;
-    }
-    return (hash_val);
+    return (bundy::dns::name::internal::hashData(s, length, case_sensitive,
+                                                 seed));
 }
 
 std::string
@@ -24,11 +24,11 @@
 
 #include <limits>
 #include <cassert>
+#include <cstring>
 #include <vector>
 
 using namespace std;
 using namespace bundy::util;
-using bundy::dns::name::internal::maptolower;
 
 namespace bundy {
 namespace dns {
@@ -43,13 +43,17 @@ namespace {     // hide internal-only names from the public namespaces
 /// longest match (ancestor) name against each new name to be rendered into
 /// the buffer.
 struct OffsetItem {
-    OffsetItem(size_t hash, size_t pos, size_t len) :
-        hash_(hash), pos_(pos), len_(len)
-    {}
+    OffsetItem() : generation_(0), hash_(0), pos_(0), len_(0) {}
+
+    /// The generation of the renderer when this item was stored.  The item
+    /// is valid only if it's equal to the current generation of the
+    /// renderer; otherwise this slot of the table is considered empty.
+    uint32_t generation_;
 
-    /// The hash value for the stored name calculated by LabelSequence.getHash.
-    /// This will help make name comparison in \c NameCompare more efficient.
-    size_t hash_;
+    /// The hash value for the stored name calculated by \c getNameHash()
+    /// (for the uncompressed form of the name).  This will help make name
+    /// comparison in \c matchName() more efficient.
+    uint32_t hash_;
 
     /// The position (offset from the beginning) in the buffer where the
     /// name starts.
@@ -59,93 +63,77 @@ struct OffsetItem {
     uint16_t len_;
 };
 
-/// \brief The \c NameCompare class is a functor that checks equality
-/// between the name corresponding to an \c OffsetItem object and the name
-/// consists of labels represented by a \c LabelSequence object.
+/// \brief Calculate the hash value of a name for the offset table.
 ///
-/// Template parameter CASE_SENSITIVE determines whether to ignore the case
-/// of the names.  This policy doesn't change throughout the lifetime of
-/// this object, so we separate these using template to avoid unnecessary
-/// condition check.
-template <bool CASE_SENSITIVE>
-struct NameCompare {
-    /// \brief Constructor
-    ///
-    /// \param buffer The buffer for rendering used in the caller renderer
-    /// \param name_buf An input buffer storing the wire-format data of the
-    /// name to be newly rendered (and only that data).
-    /// \param hash The hash value for the name.
-    NameCompare(const OutputBuffer& buffer, InputBuffer& name_buf,
-                size_t hash) :
-        buffer_(&buffer), name_buf_(&name_buf), hash_(hash)
-    {}
+/// This only uses the first and last 8 bytes and the length of the
+/// wire-format data.  The names rendered in a single message are normally
+/// different in these parts (note that the data of different suffixes of a
+/// name have different length and different first label), and in case of a
+/// collision it only costs an extra comparison, so this is a good tradeoff
+/// compared to hashing the entire name.
+inline uint32_t
+getNameHash(const uint8_t* name_data, size_t name_len, bool case_sensitive) {
+    uint64_t first = 0;
+    uint64_t last = 0;
+    if (name_len >= sizeof(first)) {
+        std::memcpy(&first, name_data, sizeof(first));
+        std::memcpy(&last, name_data + name_len - sizeof(last), sizeof(last));
+    } else {
+        std::memcpy(&first, name_data, name_len);
+    }
+    if (!case_sensitive) {
+        first = name::internal::lowerWord(first);
+        last = name::internal::lowerWord(last);
+    }
+    const uint64_t hash = (first ^ (last * 0x9e3779b97f4a7c15ULL) ^ name_len) *
+        0xff51afd7ed558ccdULL;
+    return (static_cast<uint32_t>(hash >> 32)); // higher bits are better mixed
+}
 
-    bool operator()(const OffsetItem& item) const {
-        // Trivial inequality check.  If either the hash or the total length
-        // doesn't match, the names are obviously different.
-        if (item.hash_  != hash_ || item.len_ != name_buf_->getLength()) {
-            return (false);
+/// \brief Check if the name rendered at the given position of the buffer
+/// is equal to the given name.
+///
+/// The rendered name can be compressed, so we compare the names label by
+/// label, following compression pointers in the buffer.  \c name_data must
+/// be the wire-format data of a (possibly relative) name, and \c name_len
+/// must be the length of the rendered name (so we don't have to check the
+/// end of the names).
+bool
+matchName(const uint8_t* buffer, uint16_t pos, const uint8_t* name_data,
+          size_t name_len, bool case_sensitive)
+{
+    size_t i = 0;
+    while (i < name_len) {
+        size_t nptrs = 0;
+        while ((buffer[pos] & Name::COMPRESS_POINTER_MARK8) ==
+               Name::COMPRESS_POINTER_MARK8) {
+            pos = (buffer[pos] & ~Name::COMPRESS_POINTER_MARK8) * 256 +
+                buffer[pos + 1];
+
+            // This loop should stop as long as the buffer has been
+            // constructed validly and the search/insert argument is based
+            // on a valid name, which is an assumption for this function.
+            // But we'll abort if a bug could cause an infinite loop.
+            nptrs += 2;
+            assert(nptrs < Name::MAX_WIRE);
         }
 
-        // Compare the name data, character-by-character.
-        // item_pos keeps track of the position in the buffer corresponding to
-        // the character to compare.  item_label_len is the number of
-        // characters in the labels where the character pointed by item_pos
-        // belongs.  When it reaches zero, nextPosition() identifies the
-        // position for the subsequent label, taking into account name
-        // compression, and resets item_label_len to the length of the new
-        // label.
-        name_buf_->setPosition(0); // buffer can be reused, so reset position
-        uint16_t item_pos = item.pos_;
-        uint16_t item_label_len = 0;
-        for (size_t i = 0; i < item.len_; ++i, ++item_pos) {
-            item_pos = nextPosition(*buffer_, item_pos, item_label_len);
-            const uint8_t ch1 = (*buffer_)[item_pos];
-            const uint8_t ch2 = name_buf_->readUint8();
-            if (CASE_SENSITIVE) {
-                if (ch1 != ch2) {
-                    return (false);
-                }
-            } else {
-                if (maptolower[ch1] != maptolower[ch2]) {
-                    return (false);
-                }
-            }
+        // Label lengths are never converted by the case-insensitive
+        // comparison, so we can compare them first.
+        const uint8_t label_len = buffer[pos];
+        if (label_len != name_data[i]) {
+            return (false);
         }
-
-        return (true);
-    }
-
-private:
-    uint16_t nextPosition(const OutputBuffer& buffer,
-                          uint16_t pos, uint16_t& llen) const
-    {
-        if (llen == 0) {
-            size_t i = 0;
-
-            while ((buffer[pos] & Name::COMPRESS_POINTER_MARK8) ==
-                   Name::COMPRESS_POINTER_MARK8) {
-                pos = (buffer[pos] & ~Name::COMPRESS_POINTER_MARK8) *
-                    256 + buffer[pos + 1];
-
-                // This loop should stop as long as the buffer has been
-                // constructed validly and the search/insert argument is based
-                // on a valid name, which is an assumption for this class.
-                // But we'll abort if a bug could cause an infinite loop.
-                i += 2;
-                assert(i < Name::MAX_WIRE);
-            }
-            llen = buffer[pos];
-        } else {
-            --llen;
+        if (name::internal::findMismatch(&buffer[pos + 1], &name_data[i + 1],
+                                         label_len, case_sensitive) !=
+            label_len) {
+            return (false);
         }
-        return (pos);
+        pos += label_len + 1;
+        i += label_len + 1;
     }
-
-    const OutputBuffer* buffer_;
-    InputBuffer* name_buf_;
-    const size_t hash_;
-};
+    return (true);
+}
 }
 
 ///
@@ -158,57 +146,98 @@ private:
 /// It internally holds a hash table for OffsetItem objects corresponding
 /// to portions of names rendered in this renderer.  The offset information
 /// is used to compress subsequent names to be rendered.
+///
+/// The table is a flat array of \c OffsetItem using open addressing (with
+/// linear probing), so a lookup usually touches only one or two cache lines
+/// and adding an item doesn't involve memory allocation.  Each item
+/// records the "generation" of the renderer when it was stored, and the
+/// renderer increments the generation in \c clear(), so all items are
+/// invalidated at once instead of clearing the entire table for every
+/// message.  The table grows when it becomes half full, which should be
+/// rare as the initial size is sufficient for common responses.
 struct MessageRenderer::MessageRendererImpl {
-    // The size of hash buckets and number of hash entries per bucket for
-    // which space is preallocated and kept reserved for subsequent rendering
-    // to provide better performance.  These values are derived from the
-    // BIND 9 implementation that uses a similar hash table.
-    static const size_t BUCKETS = 64;
-    static const size_t RESERVED_ITEMS = 16;
+    // The initial number of slots in the hash table.  This can hold 128
+    // items before growing, i.e., about 40 names (with 3 labels on average)
+    // in a message.  A larger table is reset to this size in clear().
+    static const size_t INITIAL_TABLE_SIZE = 256;
     static const uint16_t NO_OFFSET = 65535; // used as a marker of 'not found'
 
     /// \brief Constructor
     MessageRendererImpl() :
         msglength_limit_(512), truncated_(false),
-        compress_mode_(MessageRenderer::CASE_INSENSITIVE)
-    {
-        // Reserve some spaces for hash table items.
-        for (size_t i = 0; i < BUCKETS; ++i) {
-            table_[i].reserve(RESERVED_ITEMS);
+        compress_mode_(MessageRenderer::CASE_INSENSITIVE),
+        table_(INITIAL_TABLE_SIZE), mask_(INITIAL_TABLE_SIZE - 1),
+        generation_(1), nitems_(0)
+    {}
+
+    /// \brief Invalidate all items of the hash table.
+    void clearTable() {
+        ++generation_;
+        nitems_ = 0;
+        if (generation_ == 0 || table_.size() > INITIAL_TABLE_SIZE) {
+            // The generation wrapped around (after 2^32 messages), so some
+            // items could look valid again, or the table has grown for a
+            // large message.  Simply (re)initialize the table.
+            vector<OffsetItem>(INITIAL_TABLE_SIZE).swap(table_);
+            mask_ = INITIAL_TABLE_SIZE - 1;
+            generation_ = 1;
         }
     }
 
-    uint16_t findOffset(const OutputBuffer& buffer, InputBuffer& name_buf,
-                        size_t hash, bool case_sensitive) const
+    uint16_t findOffset(const OutputBuffer& buffer, const uint8_t* name_data,
+                        size_t name_len, uint32_t hash,
+                        bool case_sensitive) const
     {
-        // Find a matching entry, if any.  We use some heuristics here: often
-        // the same name appears consecutively (like repeating the same owner
-        // name for a single RRset), so in case there's a collision in the
-        // bucket it will be more likely to find it in the tail side of the
-        // bucket.
-        const size_t bucket_id = hash % BUCKETS;
-        vector<OffsetItem>::const_reverse_iterator found;
-        if (case_sensitive) {
-            found = find_if(table_[bucket_id].rbegin(),
-                            table_[bucket_id].rend(),
-                            NameCompare<true>(buffer, name_buf, hash));
-        } else {
-            found = find_if(table_[bucket_id].rbegin(),
-                            table_[bucket_id].rend(),
-                            NameCompare<false>(buffer, name_buf, hash));
-        }
-        if (found != table_[bucket_id].rend()) {
-            return (found->pos_);
+        const uint8_t* const base =
+            static_cast<const uint8_t*>(buffer.getData());
+        for (size_t i = hash & mask_;
+             table_[i].generation_ == generation_;
+             i = (i + 1) & mask_)
+        {
+            const OffsetItem& item = table_[i];
+            if (item.hash_ == hash && item.len_ == name_len &&
+                matchName(base, item.pos_, name_data, name_len,
+                          case_sensitive)) {
+                return (item.pos_);
+            }
         }
         return (NO_OFFSET);
     }
 
-    void addOffset(size_t hash, size_t offset, size_t len) {
-        table_[hash % BUCKETS].push_back(OffsetItem(hash, offset, len));
+    void addOffset(uint32_t hash, size_t offset, size_t len) {
+        if ((nitems_ + 1) * 2 > table_.size()) {
+            growTable();
+        }
+        insertItem(hash, offset, len);
+        ++nitems_;
+    }
+
+    void insertItem(uint32_t hash, size_t offset, size_t len) {
+        size_t i = hash & mask_;
+        while (table_[i].generation_ == generation_) {
+            i = (i + 1) & mask_;
+        }
+        OffsetItem& item = table_[i];
+        item.generation_ = generation_;
+        item.hash_ = hash;
+        item.pos_ = offset;
+        item.len_ = len;
+    }
+
+    // Double the size of the table, moving the valid items to the new one.
+    void growTable() {
+        vector<OffsetItem> old_table(table_.size() * 2);
+        old_table.swap(table_);
+        mask_ = table_.size() - 1;
+        for (vector<OffsetItem>::const_iterator it = old_table.begin();
+             it != old_table.end();
+             ++it) {
+            if (it->generation_ == generation_) {
+                insertItem(it->hash_, it->pos_, it->len_);
+            }
+        }
     }
 
-    // The hash table for the (offset + position in the buffer) entries
-    vector<OffsetItem> table_[BUCKETS];
     /// The maximum length of rendered data that can fit without
     /// truncation.
     uint16_t msglength_limit_;
@@ -218,10 +247,17 @@ struct MessageRenderer::MessageRendererImpl {
     /// The name compression mode.
     CompressMode compress_mode_;
 
+    // The hash table for the (offset + position in the buffer) entries.
+    // Its size is always a power of 2.
+    vector<OffsetItem> table_;
+    size_t mask_;
+    // The current generation; only items of this generation are valid.
+    uint32_t generation_;
+    // The number of valid items in the table.
+    size_t nitems_;
+
     // Placeholder for hash values as they are calculated in writeName().
-    // Note: we may want to make it a local variable of writeName() if it
-    // works more efficiently.
-    boost::array<size_t, Name::MAX_LABELS> seq_hashes_;
+    boost::array<uint32_t, Name::MAX_LABELS> seq_hashes_;
 };
 
 MessageRenderer::MessageRenderer() :
@@ -240,18 +276,7 @@ MessageRenderer::clear() {
     impl_->truncated_ = false;
     impl_->compress_mode_ = CASE_INSENSITIVE;
 
-    // Clear the hash table.  We reserve the minimum space for possible
-    // subsequent use of the renderer.
-    for (size_t i = 0; i < MessageRendererImpl::BUCKETS; ++i) {
-        if (impl_->table_[i].size() > MessageRendererImpl::RESERVED_ITEMS) {
-            // Trim excessive capacity: swap ensures the new capacity is only
-            // reasonably large for the reserved space.
-            vector<OffsetItem> new_table;
-            new_table.reserve(MessageRendererImpl::RESERVED_ITEMS);
-            new_table.swap(impl_->table_[i]);
-        }
-        impl_->table_[i].clear();
-    }
+    impl_->clearTable();
 }
 
 size_t
@@ -290,32 +315,30 @@ MessageRenderer::setCompressMode(const CompressMode mode) {
 
 void
 MessageRenderer::writeName(const LabelSequence& ls, const bool compress) {
-    LabelSequence sequence(ls);
-    const size_t nlabels = sequence.getLabelCount();
+    const size_t nlabels = ls.getLabelCount();
     size_t data_len;
-    const uint8_t* data;
+    const uint8_t* data = ls.getData(&data_len);
+    const bool case_sensitive = (impl_->compress_mode_ ==
+                                 MessageRenderer::CASE_SENSITIVE);
 
     // Find the offset in the offset table whose name gives the longest
     // match against the name to be rendered.
     size_t nlabels_uncomp;
+    size_t pos = 0;
     uint16_t ptr_offset = MessageRendererImpl::NO_OFFSET;
-    const bool case_sensitive = (impl_->compress_mode_ ==
-                                 MessageRenderer::CASE_SENSITIVE);
     for (nlabels_uncomp = 0; nlabels_uncomp < nlabels; ++nlabels_uncomp) {
         if (nlabels_uncomp > 0) {
-            sequence.stripLeft(1);
+            pos += data[pos] + 1;
         }
-
-        data = sequence.getData(&data_len);
-        if (data_len == 1) { // trailing dot.
+        if (pos + 1 == data_len) { // trailing dot.
             ++nlabels_uncomp;
             break;
         }
         // write with range check for safety
         impl_->seq_hashes_.at(nlabels_uncomp) =
-            sequence.getHash(impl_->compress_mode_);
-        InputBuffer name_buf(data, data_len);
-        ptr_offset = impl_->findOffset(getBuffer(), name_buf,
+            getNameHash(&data[pos], data_len - pos, case_sensitive);
+        ptr_offset = impl_->findOffset(getBuffer(), &data[pos],
+                                       data_len - pos,
                                        impl_->seq_hashes_[nlabels_uncomp],
                                        case_sensitive);
         if (ptr_offset != MessageRendererImpl::NO_OFFSET) {
@@ -0,0 +1,257 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dns/name_internal.h>
+
+#include <cstring>
+
+// SIMD versions are only available for x86 with GCC compatible compilers.
+// SSE2 is part of the base x86-64 architecture, so it's used whenever
+// enabled at compile time; AVX2 code is compiled with a function-specific
+// target attribute and used only if the running CPU supports it.
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define NAME_INTERNAL_USE_SSE2 1
+#include <emmintrin.h>
+#if defined(__clang__) || (__GNUC__ > 4) || \
+    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define NAME_INTERNAL_USE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace bundy {
+namespace dns {
+namespace name {
+namespace internal {
+
+namespace {
+inline uint64_t
+loadWord(const uint8_t* p) {
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    return (w);
+}
+
+// Compare the data from \c pos a word at a time, then byte by byte for the
+// rest (or the word that differs).
+size_t
+findMismatchScalar(const uint8_t* data1, const uint8_t* data2, size_t pos,
+                   size_t len, bool case_sensitive)
+{
+    for (; pos + 8 <= len; pos += 8) {
+        uint64_t w1 = loadWord(data1 + pos);
+        uint64_t w2 = loadWord(data2 + pos);
+        if (!case_sensitive) {
+            w1 = lowerWord(w1);
+            w2 = lowerWord(w2);
+        }
+        if (w1 != w2) {
+            break;
+        }
+    }
+    for (; pos < len; ++pos) {
+        if (case_sensitive ? (data1[pos] != data2[pos]) :
+            (maptolower[data1[pos]] != maptolower[data2[pos]])) {
+            break;
+        }
+    }
+    return (pos);
+}
+
+#ifndef NAME_INTERNAL_USE_SSE2
+size_t
+findMismatchWords(const uint8_t* data1, const uint8_t* data2, size_t len,
+                  bool case_sensitive)
+{
+    return (findMismatchScalar(data1, data2, 0, len, case_sensitive));
+}
+#else
+// Convert upper case ASCII letters in the 16 bytes to lower case.  Adding
+// 0x80 - 'A' maps 'A'..'Z' to the 26 smallest signed values (-128..-103),
+// and no other byte falls in that range.
+inline __m128i
+lower128(__m128i v) {
+    const __m128i shifted =
+        _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - 'A')));
+    const __m128i upper =
+        _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+    return (_mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+}
+
+size_t
+findMismatchSSE2(const uint8_t* data1, const uint8_t* data2, size_t len,
+                 bool case_sensitive)
+{
+    size_t pos = 0;
+    for (; pos + 16 <= len; pos += 16) {
+        __m128i v1 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data1 + pos));
+        __m128i v2 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data2 + pos));
+        if (!case_sensitive) {
+            v1 = lower128(v1);
+            v2 = lower128(v2);
+        }
+        const unsigned int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2));
+        if (eq != 0xffff) {
+            return (pos + __builtin_ctz(~eq));
+        }
+    }
+    return (findMismatchScalar(data1, data2, pos, len, case_sensitive));
+}
+#endif
+
+#ifdef NAME_INTERNAL_USE_AVX2
+// Same as lower128(), for 32 bytes.
+__attribute__((target("avx2"))) inline __m256i
+lower256(__m256i v) {
+    const __m256i shifted =
+        _mm256_add_epi8(v, _mm256_set1_epi8(static_cast<char>(0x80 - 'A')));
+    const __m256i upper =
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)),
+                          shifted);
+    return (_mm256_or_si256(v, _mm256_and_si256(upper,
+                                                _mm256_set1_epi8(0x20))));
+}
+
+__attribute__((target("avx2"))) size_t
+findMismatchAVX2(const uint8_t* data1, const uint8_t* data2, size_t len,
+                 bool case_sensitive)
+{
+    if (len < 32) {
+        return (findMismatchSSE2(data1, data2, len, case_sensitive));
+    }
+    size_t pos = 0;
+    for (; pos + 32 <= len; pos += 32) {
+        __m256i v1 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data1 + pos));
+        __m256i v2 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data2 + pos));
+        if (!case_sensitive) {
+            v1 = lower256(v1);
+            v2 = lower256(v2);
+        }
+        const unsigned int eq =
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2));
+        if (eq != 0xffffffffU) {
+            return (pos + __builtin_ctz(~eq));
+        }
+    }
+    // Avoid the penalty of switching to the non-VEX SSE2 or scalar code
+    // below with the upper halves of the registers in use.
+    _mm256_zeroupper();
+
+    // The rest is shorter than 32 bytes; SSE2 is always available if AVX2
+    // is.
+    if (pos + 16 <= len) {
+        return (pos + findMismatchSSE2(data1 + pos, data2 + pos, len - pos,
+                                       case_sensitive));
+    }
+    return (findMismatchScalar(data1, data2, pos, len, case_sensitive));
+}
+#endif
+
+typedef size_t (*FindMismatchFn)(const uint8_t*, const uint8_t*, size_t,
+                                 bool);
+
+struct MismatchImpl {
+    FindMismatchFn fn;
+    const char* name;
+};
+
+MismatchImpl
+selectImpl() {
+#ifdef NAME_INTERNAL_USE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        const MismatchImpl impl = { findMismatchAVX2, "avx2" };
+        return (impl);
+    }
+#endif
+#ifdef NAME_INTERNAL_USE_SSE2
+    const MismatchImpl impl = { findMismatchSSE2, "sse2" };
+#else
+    const MismatchImpl impl = { findMismatchWords, "scalar" };
+#endif
+    return (impl);
+}
+
+const MismatchImpl&
+getImpl() {
+    // Initialized on first use to avoid the static initialization order
+    // fiasco (Name objects are often defined statically).
+    static const MismatchImpl impl = selectImpl();
+    return (impl);
+}
+
+// The mixing steps of MurmurHash3 (public domain) for 64-bit words.
+inline uint64_t
+rotl64(uint64_t x, int r) {
+    return ((x << r) | (x >> (64 - r)));
+}
+
+inline uint64_t
+mixWord(uint64_t h, uint64_t w) {
+    w *= 0x87c37b91114253d5ULL;
+    w = rotl64(w, 31);
+    w *= 0x4cf5ad432745937fULL;
+    h ^= w;
+    h = rotl64(h, 27);
+    return (h * 5 + 0x52dce729);
+}
+
+inline uint64_t
+finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (h);
+}
+}
+
+size_t
+findMismatchLong(const uint8_t* data1, const uint8_t* data2, size_t len,
+                 bool case_sensitive)
+{
+    return (getImpl().fn(data1, data2, len, case_sensitive));
+}
+
+const char*
+getMismatchImplName() {
+    return (getImpl().name);
+}
+
+size_t
+hashData(const uint8_t* data, size_t len, bool case_sensitive, size_t seed) {
+    uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+    size_t pos = 0;
+    for (; pos + 8 <= len; pos += 8) {
+        const uint64_t w = loadWord(data + pos);
+        h = mixWord(h, case_sensitive ? w : lowerWord(w));
+    }
+    if (pos < len) {
+        uint64_t w = 0;
+        std::memcpy(&w, data + pos, len - pos);
+        h = mixWord(h, case_sensitive ? w : lowerWord(w));
+    }
+    return (static_cast<size_t>(finalize(h)));
+}
+
+} // end of internal
+} // end of name
+} // end of dns
+} // end of bundy
@@ -15,6 +15,11 @@
 #ifndef NAME_INTERNAL_H
 #define NAME_INTERNAL_H 1
 
+#include <cstddef>
+#include <cstring>
+
+#include <stdint.h>
+
 // This is effectively a "private" namespace for the Name class implementation,
 // but exposed publicly so the definitions in it can be shared with other
 // modules of the library (as of its introduction, used by LabelSequence and
@@ -32,6 +37,87 @@ namespace dns {
 namespace name {
 namespace internal {
 extern const uint8_t maptolower[];
+
+/// \brief Convert upper case ASCII letters in a 64-bit word to lower case.
+///
+/// This is the word-at-a-time (SWAR) version of \c maptolower: each of
+/// the 8 bytes in \c w is converted independently, and any byte other
+/// than 'A' to 'Z' is kept intact.
+inline uint64_t
+lowerWord(uint64_t w) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t high_bits = 0x8080808080808080ULL;
+    // For each byte whose highest bit is 0, the highest bit of ge_a
+    // (gt_z) is set iff the byte is 'A' (resp. 'Z' + 1) or larger.  The
+    // additions never carry over to the next byte.
+    const uint64_t heptets = w & ~high_bits;
+    const uint64_t ge_a = heptets + (0x80 - 'A') * ones;
+    const uint64_t gt_z = heptets + (0x80 - 'Z' - 1) * ones;
+    const uint64_t upper = ~w & (ge_a ^ gt_z) & high_bits;
+    return (w | (upper >> 2));  // 0x80 >> 2 = 0x20, i.e., 'A' - 'a'
+}
+
+/// \brief Find the first byte that differs in the given data.
+///
+/// This is the out-of-line part of \c findMismatch(), used for longer
+/// data.  It uses SIMD instructions when they are available, selecting
+/// the best implementation supported by the running CPU on the first call.
+size_t findMismatchLong(const uint8_t* data1, const uint8_t* data2,
+                        size_t len, bool case_sensitive);
+
+/// \brief Return the name of the implementation used in
+/// \c findMismatchLong(), such as "avx2", "sse2" or "scalar".
+///
+/// This is mainly for benchmarks and diagnostics.
+const char* getMismatchImplName();
+
+/// \brief Find the first byte that differs in the given data.
+///
+/// This function compares \c len bytes of \c data1 and \c data2, and
+/// returns the index of the first byte that is different.  Unless
+/// \c case_sensitive is true, upper and lower case ASCII letters are
+/// considered to be the same, just like when they are converted by
+/// \c maptolower.  If all bytes are the same, it returns \c len.
+///
+/// Most labels are short, so they are compared here a word at a time
+/// without the overhead of a function call.
+inline size_t
+findMismatch(const uint8_t* data1, const uint8_t* data2, size_t len,
+             bool case_sensitive)
+{
+    if (len >= 16) {
+        return (findMismatchLong(data1, data2, len, case_sensitive));
+    }
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w1, w2;
+        std::memcpy(&w1, data1 + i, sizeof(w1));
+        std::memcpy(&w2, data2 + i, sizeof(w2));
+        if (!case_sensitive) {
+            w1 = lowerWord(w1);
+            w2 = lowerWord(w2);
+        }
+        if (w1 != w2) {
+            break;
+        }
+    }
+    for (; i < len; ++i) {
+        if (case_sensitive ? (data1[i] != data2[i]) :
+            (maptolower[data1[i]] != maptolower[data2[i]])) {
+            break;
+        }
+    }
+    return (i);
+}
+
+/// \brief Calculate a hash value of the given data.
+///
+/// Unless \c case_sensitive is true, upper and lower case ASCII letters
+/// result in the same hash value.  The data are processed a word at a
+/// time, and the result depends on the CPU byte order, so it's not
+/// expected to be stored or exchanged with other systems.
+size_t hashData(const uint8_t* data, size_t len, bool case_sensitive,
+                size_t seed);
 } // end of internal
 } // end of name
 } // end of dns
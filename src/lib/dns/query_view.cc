@@ -0,0 +1,213 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <dns/query_view.h>
+#include <dns/name.h>
+
+#include <exceptions/exceptions.h>
+
+#include <cstring>
+
+using namespace std;
+
+namespace bundy {
+namespace dns {
+
+namespace {
+// These must be the same as the corresponding definitions in message.cc
+// and edns.cc.
+const uint16_t HEADERFLAG_MASK = 0x87b0;
+const uint16_t OPCODE_MASK = 0x7800;
+const unsigned int OPCODE_SHIFT = 11;
+const size_t HEADERLEN = 12;
+
+const uint32_t EDNS_VERSION_MASK = 0x00ff0000;
+const unsigned int EDNS_VERSION_SHIFT = 16;
+const uint32_t EDNS_EXTFLAG_DO = 0x00008000;
+
+// The fixed part of an RR following the owner name: type, class, TTL and
+// RDLENGTH.
+const size_t RR_FIXED_LEN = 10;
+
+inline uint16_t
+readUint16(const uint8_t* p) {
+    return ((static_cast<uint16_t>(p[0]) << 8) | p[1]);
+}
+
+inline uint32_t
+readUint32(const uint8_t* p) {
+    return ((static_cast<uint32_t>(p[0]) << 24) |
+            (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | p[3]);
+}
+}
+
+QueryView::QueryView() :
+    qid_(0), flags_(0), opcode_(0), qtype_(0), qclass_(0), has_edns_(false),
+    udp_size_(0), dnssec_aware_(false)
+{
+    // Make it a valid (root) name even before the first parse.
+    qname_buf_[0] = 1;          // number of labels
+    qname_buf_[1] = 0;          // offset of the root label
+    qname_buf_[2] = 0;          // the root label
+}
+
+bool
+QueryView::fromWire(const void* data, size_t len) {
+    const uint8_t* const wire = static_cast<const uint8_t*>(data);
+    if (len < HEADERLEN) {
+        return (false);
+    }
+
+    const uint16_t codes_and_flags = readUint16(wire + 2);
+    // Ignore responses and non-simple messages.
+    if ((codes_and_flags & Message::HEADERFLAG_QR) != 0 ||
+        readUint16(wire + 4) != 1 || readUint16(wire + 6) != 0 ||
+        readUint16(wire + 8) != 0) {
+        return (false);
+    }
+    const uint16_t arcount = readUint16(wire + 10);
+    if (arcount > 1) {
+        return (false);
+    }
+
+    size_t pos = HEADERLEN;
+    if (!parseQName(wire, len, pos) || len - pos < 2 * sizeof(uint16_t)) {
+        return (false);
+    }
+    qtype_ = readUint16(wire + pos);
+    qclass_ = readUint16(wire + pos + 2);
+    pos += 2 * sizeof(uint16_t);
+
+    has_edns_ = false;
+    dnssec_aware_ = false;
+    if (arcount == 1 && !parseOPT(wire, len, pos)) {
+        return (false);
+    }
+
+    qid_ = readUint16(wire);
+    flags_ = codes_and_flags & HEADERFLAG_MASK;
+    opcode_ = (codes_and_flags & OPCODE_MASK) >> OPCODE_SHIFT;
+    return (true);
+}
+
+// Copy the query name at 'pos' to qname_buf_ in the serialized form of
+// LabelSequence.  Compressed names are not supported; a query name can only
+// be compressed with a pointer to the header, which is not a valid name
+// anyway.
+bool
+QueryView::parseQName(const uint8_t* wire, size_t len, size_t& pos) {
+    uint8_t offsets[Name::MAX_LABELS];
+    unsigned int nlabels = 0;
+    const size_t start = pos;
+    while (true) {
+        if (pos >= len) {
+            return (false);
+        }
+        const unsigned int count = wire[pos];
+        if (count > Name::MAX_LABELLEN) {
+            // compression pointer or unsupported label type
+            return (false);
+        }
+        if (pos - start + count + 1 > Name::MAX_WIRE) {
+            return (false);
+        }
+        offsets[nlabels++] = pos - start;
+        pos += count + 1;
+        if (count == 0) {
+            break;
+        }
+    }
+    if (pos > len) {
+        return (false);
+    }
+
+    qname_buf_[0] = nlabels;
+    memcpy(qname_buf_ + 1, offsets, nlabels);
+    memcpy(qname_buf_ + 1 + nlabels, wire + start, pos - start);
+    return (true);
+}
+
+// Parse the only additional record, which must be a valid OPT RR.  The
+// checks correspond to those of Message::fromWire() and the EDNS and
+// generic::OPT constructors.  A TSIG RR or anything else is left to
+// the full parser.
+bool
+QueryView::parseOPT(const uint8_t* wire, size_t len, size_t& pos) {
+    // The owner name must be the root name (in the uncompressed form).
+    if (pos >= len || wire[pos] != 0) {
+        return (false);
+    }
+    ++pos;
+    if (len - pos < RR_FIXED_LEN) {
+        return (false);
+    }
+    const uint16_t rrtype = readUint16(wire + pos);
+    const uint16_t rrclass = readUint16(wire + pos + 2);
+    const uint32_t ttl = readUint32(wire + pos + 4);
+    size_t rdlen = readUint16(wire + pos + 8);
+    pos += RR_FIXED_LEN;
+    if (rrtype != RRType::OPT().getCode() ||
+        ((ttl & EDNS_VERSION_MASK) >> EDNS_VERSION_SHIFT) != 0 ||
+        len - pos < rdlen) {
+        return (false);
+    }
+    // With these classes an empty RDATA is handled specially (as in
+    // dynamic updates); leave it to the full parser.
+    if (rdlen == 0 && (rrclass == RRClass::ANY().getCode() ||
+                       rrclass == RRClass::NONE().getCode())) {
+        return (false);
+    }
+
+    // The options must fit in the RDATA.
+    size_t opt_pos = pos;
+    pos += rdlen;
+    while (rdlen > 0) {
+        if (rdlen < 2 * sizeof(uint16_t)) {
+            return (false);
+        }
+        const size_t opt_len = readUint16(wire + opt_pos + 2);
+        rdlen -= 2 * sizeof(uint16_t);
+        if (rdlen < opt_len) {
+            return (false);
+        }
+        rdlen -= opt_len;
+        opt_pos += 2 * sizeof(uint16_t) + opt_len;
+    }
+
+    has_edns_ = true;
+    udp_size_ = rrclass;
+    dnssec_aware_ = ((ttl & EDNS_EXTFLAG_DO) != 0);
+    return (true);
+}
+
+bool
+QueryView::getHeaderFlag(Message::HeaderFlag flag) const {
+    if (flag == 0 || (flag & ~HEADERFLAG_MASK) != 0) {
+        bundy_throw(InvalidParameter,
+                    "QueryView::getHeaderFlag:: Invalid flag is specified: " <<
+                    flag);
+    }
+    return ((flags_ & flag) != 0);
+}
+
+ostream&
+operator<<(ostream& os, const QueryView& view) {
+    os << view.getQName().toText() << " " << view.getQClass() << " "
+       << view.getQType();
+    return (os);
+}
+
+} // end of namespace dns
+} // end of namespace bundy
@@ -0,0 +1,148 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef DNS_QUERY_VIEW_H
+#define DNS_QUERY_VIEW_H 1
+
+#include <dns/labelsequence.h>
+#include <dns/message.h>
+#include <dns/opcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <ostream>
+
+#include <stdint.h>
+
+namespace bundy {
+namespace dns {
+
+/// \brief A lightweight, read-only view of a simple DNS query.
+///
+/// Parsing a request with \c Message::fromWire() builds a \c Question
+/// object, and \c RRset and \c Rdata objects for the records in the
+/// message, each of which involves memory allocation.  But a server often
+/// only needs the header, the question and the EDNS parameters of a query.
+/// This class decodes only these parts of a query in place, without any
+/// memory allocation, so the server can examine them (and possibly answer
+/// the query, e.g., from a cache of responses) before building a
+/// \c Message object.
+///
+/// Only "simple" queries are supported: the message must not be a
+/// response.  It must have exactly one question, no answer or authority
+/// records, and at most one additional record, which must be an EDNS OPT RR
+/// of a supported version.  \c fromWire() returns false for any other
+/// message, including messages signed with TSIG and broken ones.  The
+/// caller is expected to fall back to \c Message::fromWire() for such
+/// messages, which also detects any errors in them.  In other words, if
+/// \c fromWire() returns true, \c Message::fromWire() would successfully
+/// parse the same data, and the results are consistent.
+///
+/// The object can be reused for multiple queries; each \c fromWire() call
+/// overrides the result of the previous one.  The other methods must only
+/// be called after a successful \c fromWire() call.
+class QueryView : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \throw none
+    QueryView();
+
+    /// \brief Parse a query in wire format.
+    ///
+    /// The query name is copied, so the data don't have to be kept valid
+    /// after the call.
+    ///
+    /// \throw none
+    ///
+    /// \param data The wire-format data of the message.
+    /// \param len The length of \c data.
+    /// \return true if \c data is a valid simple query; false otherwise.
+    bool fromWire(const void* data, size_t len);
+
+    /// \brief Return the query ID.
+    qid_t getQid() const { return (qid_); }
+
+    /// \brief Return whether the specified header flag bit is set.
+    ///
+    /// \throw InvalidParameter The specified flag is not valid (see
+    /// \c Message::getHeaderFlag()).
+    bool getHeaderFlag(Message::HeaderFlag flag) const;
+
+    /// \brief Return the opcode of the query.
+    Opcode getOpcode() const { return (Opcode(opcode_)); }
+
+    /// \brief Return the query name.
+    ///
+    /// The returned \c LabelSequence refers to the storage of this object,
+    /// and is only valid until the next \c fromWire() call or the
+    /// destruction of this object.
+    LabelSequence getQName() const { return (LabelSequence(qname_buf_)); }
+
+    /// \brief Return the query type.
+    RRType getQType() const { return (RRType(qtype_)); }
+
+    /// \brief Return the query class.
+    RRClass getQClass() const { return (RRClass(qclass_)); }
+
+    /// \brief Return whether the query has an EDNS OPT RR.
+    bool hasEDNS() const { return (has_edns_); }
+
+    /// \brief Return the UDP payload size of EDNS.
+    ///
+    /// This is only meaningful if \c hasEDNS() is true.
+    uint16_t getUDPSize() const { return (udp_size_); }
+
+    /// \brief Return whether the DO bit of EDNS is set.
+    ///
+    /// This is false if the query doesn't have EDNS.
+    bool getDNSSECAwareness() const { return (dnssec_aware_); }
+
+private:
+    bool parseQName(const uint8_t* data, size_t len, size_t& pos);
+    bool parseOPT(const uint8_t* data, size_t len, size_t& pos);
+
+    qid_t qid_;
+    uint16_t flags_;
+    uint8_t opcode_;
+    uint16_t qtype_;
+    uint16_t qclass_;
+    bool has_edns_;
+    uint16_t udp_size_;
+    bool dnssec_aware_;
+
+    // The query name, in the serialized form of LabelSequence.
+    uint8_t qname_buf_[LabelSequence::MAX_SERIALIZED_LENGTH];
+};
+
+/// \brief Insert the question of the query as a string into stream, in
+/// the same form as \c Question::toText().
+///
+/// \param os A \c std::ostream object on which the insertion operation is
+/// performed.
+/// \param view The \c QueryView object output by the operation.
+/// \return A reference to the same \c std::ostream object referenced by
+/// parameter \c os after the insertion operation.
+std::ostream& operator<<(std::ostream& os, const QueryView& view);
+
+} // namespace dns
+} // namespace bundy
+
+#endif // DNS_QUERY_VIEW_H
+
+// Local Variables:
+// mode: c++
+// End:
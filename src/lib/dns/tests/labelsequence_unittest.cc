@@ -23,6 +23,7 @@
 #include <gtest/gtest.h>
 
 #include <boost/functional/hash.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <string>
 #include <vector>
@@ -416,6 +417,52 @@ TEST_F(LabelSequenceTest, compare) {
     EXPECT_EQ(1, result.getCommonLabels());
 }
 
+// Labels are internally compared in chunks of several bytes (the size
+// depends on the CPU), so check the result for differences at every
+// position of the longest labels, including characters next to the upper
+// case letters and non-ASCII ones, which shouldn't be converted.
+TEST_F(LabelSequenceTest, compareLongLabels) {
+    const string base(Name::MAX_LABELLEN, 'a');
+    const Name name1(base + "." + base + ".example");
+    const LabelSequence ls1(name1);
+    for (size_t i = 0; i < base.size(); ++i) {
+        SCOPED_TRACE("position " + boost::lexical_cast<string>(i));
+        const string prefix(base.substr(0, i));
+        const string suffix(base.substr(i + 1) + "." + base + ".example");
+
+        // Only the case is different.
+        const Name name2(prefix + "A" + suffix);
+        const LabelSequence ls2(name2);
+        EXPECT_TRUE(ls1.equals(ls2));
+        EXPECT_FALSE(ls1.equals(ls2, true));
+        EXPECT_TRUE(name1 == name2);
+        check_equal(ls1, ls2);
+        EXPECT_LT(0, ls1.compare(ls2, true).getOrder());
+        EXPECT_EQ(ls1.getFullHash(false, 1), ls2.getFullHash(false, 1));
+
+        // A different letter.
+        const Name name3(prefix + "B" + suffix);
+        const LabelSequence ls3(name3);
+        EXPECT_FALSE(ls1.equals(ls3));
+        EXPECT_FALSE(name1 == name3);
+        check_compare(ls1, ls3, NameComparisonResult::COMMONANCESTOR, 3,
+                      true, 'a' - 'b');
+
+        // Characters next to 'A' and 'Z', and non-ASCII characters that
+        // would be converted if the highest bit were ignored.
+        const char* const others[] = { "@", "[", "\\193", "\\218", NULL };
+        const int orders[] = { 'a' - '@', 'a' - '[', 'a' - 193, 'a' - 218 };
+        for (size_t j = 0; others[j] != NULL; ++j) {
+            const Name name4(prefix + others[j] + suffix);
+            const LabelSequence ls4(name4);
+            EXPECT_FALSE(ls1.equals(ls4));
+            EXPECT_FALSE(name1 == name4);
+            check_compare(ls1, ls4, NameComparisonResult::COMMONANCESTOR, 3,
+                          true, orders[j]);
+        }
+    }
+}
+
 void
 getDataCheck(const uint8_t* expected_data, size_t expected_len,
              const LabelSequence& ls)
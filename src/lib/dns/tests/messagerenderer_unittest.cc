@@ -295,4 +295,37 @@ TEST_F(MessageRendererTest, manyRRs) {
     // any disruption.
     EXPECT_NO_THROW(renderer.clear());
 }
+
+TEST_F(MessageRendererTest, clearCompressionTable) {
+    // Names rendered before clear() must not be used for compression of
+    // subsequent names.
+    UnitTestUtil::readWireData("name_toWire1", data);
+    for (size_t i = 0; i < 3; ++i) {
+        renderer.writeName(Name("example.com"));
+        renderer.writeName(Name("a.example.org"));
+        renderer.clear();
+    }
+    renderer.writeName(Name("a.example.com."));
+    renderer.writeName(Name("b.example.com."));
+    renderer.writeName(Name("a.example.org."));
+    matchWireData(&data[0], data.size(),
+                  renderer.getData(), renderer.getLength());
+
+    // Same for the case the internal table has grown for many names.
+    renderer.clear();
+    for (size_t i = 0; i < 1000; ++i) {
+        renderer.writeName(Name(lexical_cast<std::string>(i) + ".example"));
+    }
+    // The names are still compressed; 2 bytes for the first label and 2
+    // for the pointer.
+    const size_t len = renderer.getLength();
+    renderer.writeName(Name("500.example"));
+    EXPECT_EQ(len + 2, renderer.getLength());
+    renderer.clear();
+    renderer.writeName(Name("a.example.com."));
+    renderer.writeName(Name("b.example.com."));
+    renderer.writeName(Name("a.example.org."));
+    matchWireData(&data[0], data.size(),
+                  renderer.getData(), renderer.getLength());
+}
 }
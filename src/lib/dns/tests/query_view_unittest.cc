@@ -0,0 +1,272 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <exceptions/exceptions.h>
+
+#include <util/buffer.h>
+#include <dns/edns.h>
+#include <dns/message.h>
+#include <dns/messagerenderer.h>
+#include <dns/name.h>
+#include <dns/opcode.h>
+#include <dns/query_view.h>
+#include <dns/question.h>
+#include <dns/rcode.h>
+#include <dns/rrclass.h>
+#include <dns/rrtype.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace bundy::dns;
+using namespace bundy::util;
+
+namespace {
+class QueryViewTest : public ::testing::Test {
+protected:
+    QueryViewTest() : message_(Message::RENDER) {
+        message_.setQid(0x1035);
+        message_.setOpcode(Opcode::QUERY());
+        message_.setRcode(Rcode::NOERROR());
+        message_.setHeaderFlag(Message::HEADERFLAG_RD);
+        message_.addQuestion(Question(Name("wWw.Example.COM"), RRClass::IN(),
+                                      RRType::AAAA()));
+    }
+
+    // Render message_ into data_.
+    void render() {
+        MessageRenderer renderer;
+        message_.toWire(renderer);
+        data_.assign(static_cast<const uint8_t*>(renderer.getData()),
+                     static_cast<const uint8_t*>(renderer.getData()) +
+                     renderer.getLength());
+    }
+
+    // Check the data can be parsed by the view, and the result is
+    // consistent with Message::fromWire().
+    void checkConsistent() {
+        ASSERT_TRUE(view_.fromWire(&data_[0], data_.size()));
+
+        Message parsed(Message::PARSE);
+        InputBuffer buffer(&data_[0], data_.size());
+        parsed.fromWire(buffer);
+        EXPECT_EQ(parsed.getQid(), view_.getQid());
+        EXPECT_EQ(parsed.getOpcode(), view_.getOpcode());
+        EXPECT_EQ(parsed.getHeaderFlag(Message::HEADERFLAG_RD),
+                  view_.getHeaderFlag(Message::HEADERFLAG_RD));
+        EXPECT_EQ(parsed.getHeaderFlag(Message::HEADERFLAG_CD),
+                  view_.getHeaderFlag(Message::HEADERFLAG_CD));
+        const ConstQuestionPtr question = *parsed.beginQuestion();
+        EXPECT_TRUE(LabelSequence(question->getName()).equals(
+                        view_.getQName(), true));
+        EXPECT_EQ(question->getType(), view_.getQType());
+        EXPECT_EQ(question->getClass(), view_.getQClass());
+        ASSERT_EQ(parsed.getEDNS() != NULL, view_.hasEDNS());
+        if (view_.hasEDNS()) {
+            EXPECT_EQ(parsed.getEDNS()->getUDPSize(), view_.getUDPSize());
+            EXPECT_EQ(parsed.getEDNS()->getDNSSECAwareness(),
+                      view_.getDNSSECAwareness());
+        } else {
+            EXPECT_FALSE(view_.getDNSSECAwareness());
+        }
+
+        ostringstream oss1, oss2;
+        oss1 << view_;
+        oss2 << question->toText();
+        EXPECT_EQ(oss2.str(), oss1.str());
+    }
+
+    Message message_;
+    vector<uint8_t> data_;
+    QueryView view_;
+};
+
+TEST_F(QueryViewTest, construct) {
+    // The query name is valid even before parsing.
+    EXPECT_EQ(".", view_.getQName().toText());
+    EXPECT_FALSE(view_.hasEDNS());
+}
+
+TEST_F(QueryViewTest, fromWire) {
+    render();
+    checkConsistent();
+    EXPECT_EQ(0x1035, view_.getQid());
+    EXPECT_EQ(Opcode::QUERY(), view_.getOpcode());
+    EXPECT_TRUE(view_.getHeaderFlag(Message::HEADERFLAG_RD));
+    EXPECT_FALSE(view_.getHeaderFlag(Message::HEADERFLAG_CD));
+    // The case of the query name is preserved.
+    EXPECT_EQ("wWw.Example.COM.", view_.getQName().toText());
+    EXPECT_EQ(RRType::AAAA(), view_.getQType());
+    EXPECT_EQ(RRClass::IN(), view_.getQClass());
+    EXPECT_FALSE(view_.hasEDNS());
+
+    ostringstream oss;
+    oss << view_;
+    EXPECT_EQ("wWw.Example.COM. IN AAAA", oss.str());
+
+    EXPECT_THROW(view_.getHeaderFlag(static_cast<Message::HeaderFlag>(0)),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(view_.getHeaderFlag(static_cast<Message::HeaderFlag>(0x7000)),
+                 bundy::InvalidParameter);
+}
+
+TEST_F(QueryViewTest, fromWireWithEDNS) {
+    EDNSPtr edns(new EDNS);
+    edns->setUDPSize(4096);
+    edns->setDNSSECAwareness(true);
+    message_.setEDNS(edns);
+    message_.setHeaderFlag(Message::HEADERFLAG_CD);
+    render();
+    checkConsistent();
+    EXPECT_TRUE(view_.hasEDNS());
+    EXPECT_EQ(4096, view_.getUDPSize());
+    EXPECT_TRUE(view_.getDNSSECAwareness());
+    EXPECT_TRUE(view_.getHeaderFlag(Message::HEADERFLAG_CD));
+
+    // Options in the OPT RDATA are just skipped.
+    data_.push_back(0);         // option code
+    data_.push_back(10);
+    data_.push_back(0);         // option length
+    data_.push_back(2);
+    data_.push_back(0xab);
+    data_.push_back(0xcd);
+    data_[data_.size() - 7] = 6; // RDLENGTH
+    checkConsistent();
+
+    // Reused for a query without EDNS.
+    message_.setEDNS(EDNSPtr());
+    render();
+    checkConsistent();
+    EXPECT_FALSE(view_.getDNSSECAwareness());
+}
+
+TEST_F(QueryViewTest, fromWireMaxName) {
+    // The longest possible name, with the maximum number of labels.
+    string name;
+    for (int i = 0; i < Name::MAX_LABELS - 1; ++i) {
+        name += "a.";
+    }
+    name.resize(Name::MAX_WIRE - 2);
+    message_.clearSection(Message::SECTION_QUESTION);
+    message_.addQuestion(Question(Name(name), RRClass::CH(), RRType::TXT()));
+    render();
+    checkConsistent();
+    EXPECT_EQ(Name::MAX_LABELS, view_.getQName().getLabelCount());
+}
+
+TEST_F(QueryViewTest, unsupported) {
+    // Messages that are valid but not handled by the view.
+    EDNSPtr edns(new EDNS);
+    message_.setEDNS(edns);
+    render();
+    const vector<uint8_t> orig_data = data_;
+
+    // Response
+    data_[2] |= 0x80;
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // No question, or multiple questions, or RRs in the answer or
+    // authority sections.
+    for (size_t offset = 4; offset < 10; offset += 2) {
+        data_ = orig_data;
+        data_[offset + 1] = (offset == 4) ? 0 : 1;
+        EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+        data_[offset + 1] = 2;
+        EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+    }
+
+    // Multiple additional RRs
+    data_ = orig_data;
+    data_[11] = 2;
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // Compressed query name (pointing to itself, which the view doesn't
+    // try to examine).
+    data_ = orig_data;
+    data_[12] = 0xc0;
+    data_[13] = 12;
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // The additional RR is not OPT (e.g. TSIG).
+    data_ = orig_data;
+    const size_t opt_pos = data_.size() - 11;
+    data_[opt_pos + 2] = RRType::TSIG().getCode();
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // Unsupported EDNS version
+    data_ = orig_data;
+    data_[opt_pos + 6] = 1;
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // Empty RDATA of class ANY
+    data_ = orig_data;
+    data_[opt_pos + 3] = 0;
+    data_[opt_pos + 4] = 0xff;
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // Sanity check: the original data are accepted.
+    EXPECT_TRUE(view_.fromWire(&orig_data[0], orig_data.size()));
+}
+
+TEST_F(QueryViewTest, broken) {
+    EDNSPtr edns(new EDNS);
+    message_.setEDNS(edns);
+    render();
+    const vector<uint8_t> orig_data = data_;
+
+    // Any truncated data are rejected.
+    for (size_t len = 0; len < orig_data.size(); ++len) {
+        EXPECT_FALSE(view_.fromWire(&orig_data[0], len)) << len;
+    }
+
+    // Bad label type
+    data_ = orig_data;
+    data_[12] = 0x40;
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // Non-root owner name of OPT.
+    data_ = orig_data;
+    const size_t opt_pos = data_.size() - 11;
+    data_[opt_pos] = 1;
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // Broken options in the OPT RDATA.
+    data_ = orig_data;
+    data_.push_back(0);
+    data_.push_back(10);
+    data_.push_back(0);
+    data_[data_.size() - 4] = 3; // RDLENGTH is too short for option header
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+    data_ = orig_data;
+    const uint8_t opt[] = { 0, 10, 0, 3, 0xab, 0xcd };
+    data_.insert(data_.end(), opt, opt + sizeof(opt));
+    data_[data_.size() - 7] = 6; // option is longer than RDATA
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+
+    // A name longer than the max.  We construct it manually.
+    data_.assign(orig_data.begin(), orig_data.begin() + 12);
+    data_[11] = 0;              // ARCOUNT
+    for (int i = 0; i < 4; ++i) {
+        data_.push_back(Name::MAX_LABELLEN);
+        data_.insert(data_.end(), Name::MAX_LABELLEN, 'a');
+    }
+    data_.push_back(0);
+    data_.insert(data_.end(), 4, 1); // type and class
+    EXPECT_FALSE(view_.fromWire(&data_[0], data_.size()));
+}
+
+}
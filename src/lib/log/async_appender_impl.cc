@@ -0,0 +1,187 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <log/async_appender_impl.h>
+#include <log/interprocess/interprocess_sync_file.h>
+#include <log/log_formatter.h>
+#include <log/logger_name.h>
+#include <log/logimpl_messages.h>
+#include <log/message_dictionary.h>
+
+#include <log4cplus/loglevel.h>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+
+using bundy::util::thread::Mutex;
+using bundy::util::thread::Thread;
+
+namespace bundy {
+namespace log {
+namespace internal {
+
+namespace {
+
+size_t
+roundUpCapacity(size_t capacity) {
+    size_t result = 1;
+    while (result < capacity) {
+        result <<= 1;
+    }
+    return (result);
+}
+
+}
+
+AsyncAppender::AsyncAppender(const log4cplus::SharedAppenderPtr& target,
+                             size_t capacity,
+                             interprocess::InterprocessSync* sync) :
+    target_(target),
+    sync_(sync != NULL ? sync :
+          new interprocess::InterprocessSyncFile("logger")),
+    ring_(roundUpCapacity(capacity), static_cast<Event*>(NULL)),
+    mask_(ring_.size() - 1),
+    head_(0), tail_(0), dropped_(0),
+    waiting_(false), stopping_(false)
+{
+    thread_.reset(new Thread(boost::bind(&AsyncAppender::run, this)));
+}
+
+AsyncAppender::~AsyncAppender() {
+    try {
+        destructorImpl();
+    } catch (...) {
+        // Nothing more we can do about it
+    }
+}
+
+void
+AsyncAppender::close() {
+    if (!thread_) {
+        return;
+    }
+    stopping_.store(true);
+    {
+        Mutex::Locker locker(mutex_);
+        waiting_.store(false);
+        cond_.signal();
+    }
+    thread_->wait();
+    thread_.reset();
+    target_->close();
+    closed = true;
+}
+
+void
+AsyncAppender::append(const log4cplus::spi::InternalLoggingEvent& event) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+        // Full; don't make the caller wait for the output
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring_[tail & mask_] = event.clone().release();
+    tail_.store(tail + 1);
+
+    // The store above and this load are sequentially consistent, as are
+    // the ones in waitForEvents(), so either the background thread sees
+    // the new event or we see it waiting.
+    if (waiting_.load()) {
+        Mutex::Locker locker(mutex_);
+        waiting_.store(false);
+        cond_.signal();
+    }
+}
+
+void
+AsyncAppender::waitForEvents() {
+    Mutex::Locker locker(mutex_);
+    waiting_.store(true);
+    if (tail_.load() == head_.load(std::memory_order_relaxed) &&
+        !stopping_.load()) {
+        while (waiting_.load()) {
+            cond_.wait(mutex_);
+        }
+    }
+    waiting_.store(false);
+}
+
+void
+AsyncAppender::run() {
+    std::vector<Event*> batch;
+    batch.reserve(ring_.size());
+    while (true) {
+        // Check this first, so anything appended before close() is still
+        // taken out below.
+        const bool stopping = stopping_.load();
+
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        for (size_t i = head; i != tail; ++i) {
+            batch.push_back(ring_[i & mask_]);
+        }
+        head_.store(tail, std::memory_order_release);
+
+        if (!batch.empty() || dropped_.load(std::memory_order_relaxed) > 0) {
+            writeBatch(batch);
+        } else if (stopping) {
+            break;
+        } else {
+            waitForEvents();
+        }
+    }
+}
+
+void
+AsyncAppender::writeBatch(std::vector<Event*>& batch) {
+    // Use an interprocess sync locker for mutual exclusion from other
+    // processes to avoid log messages getting interspersed.  If it fails,
+    // write anyway; the messages are more important than their order.
+    // The lock is released when the locker goes away.
+    interprocess::InterprocessSyncLocker locker(*sync_);
+    static_cast<void>(locker.lock());
+
+    const size_t dropped = dropped_.exchange(0);
+    if (dropped > 0) {
+        std::string message(
+            MessageDictionary::globalDictionary().getText(
+                LOGIMPL_ASYNC_DROPPED));
+        replacePlaceholder(&message, boost::lexical_cast<std::string>(dropped),
+                           1);
+        const Event notice(getRootLoggerName(), log4cplus::WARN_LOG_LEVEL,
+                           std::string(LOGIMPL_ASYNC_DROPPED) + " " + message,
+                           __FILE__, __LINE__);
+        try {
+            target_->doAppend(notice);
+        } catch (...) {
+            // Ignore, as below
+        }
+    }
+
+    for (std::vector<Event*>::iterator it = batch.begin();
+         it != batch.end(); ++it) {
+        try {
+            target_->doAppend(**it);
+        } catch (...) {
+            // The message is lost, but keep the others.
+        }
+        delete *it;
+    }
+    batch.clear();
+}
+
+} // end namespace internal
+} // end namespace log
+} // end namespace bundy
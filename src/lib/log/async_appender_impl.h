@@ -0,0 +1,139 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef LOG_ASYNC_APPENDER_H
+#define LOG_ASYNC_APPENDER_H
+
+#include <log/interprocess/interprocess_sync.h>
+#include <util/threads/sync.h>
+#include <util/threads/thread.h>
+
+#include <log4cplus/appender.h>
+#include <log4cplus/spi/loggingevent.h>
+#include <boost/scoped_ptr.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace bundy {
+namespace log {
+namespace internal {
+
+/// \brief Asynchronous Logger Appender
+///
+/// This class wraps another log4cplus appender (the "target", e.g. a file
+/// or syslog appender) and moves the actual output off the logging thread.
+/// \c append() only copies the event into a bounded ring buffer; a
+/// background thread takes the events out in batches and passes them to
+/// the target.  The interprocess lock that keeps the output of several
+/// processes from being interspersed is also taken by that thread, once
+/// per batch rather than once per message.
+///
+/// If the ring buffer is full (the target can't keep up), the event is
+/// dropped and counted.  The next time the background thread writes, it
+/// first logs a LOGIMPL_ASYNC_DROPPED message with the number of dropped
+/// events.
+///
+/// The ring buffer is single-producer, single-consumer and needs no lock:
+/// log4cplus serializes the calls to \c append() of an appender, and the
+/// background thread is the only consumer.  The producer only takes a lock
+/// to wake the background thread up when it is idle.
+///
+/// Closing the appender (which happens at the latest when it is destroyed,
+/// e.g. when the logging is reconfigured) writes out all the events still
+/// in the buffer, then closes the target.
+class AsyncAppender : public log4cplus::Appender {
+public:
+    /// \brief Default size of the ring buffer, in events
+    static const size_t DEFAULT_CAPACITY = 8192;
+
+    /// \brief Constructor
+    ///
+    /// Starts the background thread.
+    ///
+    /// \param target The appender the events are eventually written to.
+    /// \param capacity The maximum number of events waiting to be written;
+    ///     it is rounded up to a power of two.
+    /// \param sync The interprocess synchronization object held while a
+    ///     batch is written.  The appender takes the ownership.  If NULL,
+    ///     the "logger" lock file is used, like for the synchronous output.
+    AsyncAppender(const log4cplus::SharedAppenderPtr& target,
+                  size_t capacity = DEFAULT_CAPACITY,
+                  interprocess::InterprocessSync* sync = NULL);
+
+    /// \brief Destructor
+    ///
+    /// Closes the appender if it was not yet closed.
+    virtual ~AsyncAppender();
+
+    /// \brief Close the appender
+    ///
+    /// Stops the background thread after it has written all the events
+    /// in the buffer, and closes the target.
+    virtual void close();
+
+    /// \brief Return the appender the events are written to
+    const log4cplus::SharedAppenderPtr& getTarget() const {
+        return (target_);
+    }
+
+    /// \brief Return the number of events dropped because the buffer was
+    ///     full and not yet reported.
+    ///
+    /// Mainly useful for testing.
+    size_t getDropped() const {
+        return (dropped_.load());
+    }
+
+protected:
+    virtual void append(const log4cplus::spi::InternalLoggingEvent& event);
+
+private:
+    typedef log4cplus::spi::InternalLoggingEvent Event;
+
+    /// \brief Main function of the background thread
+    void run();
+
+    /// \brief Block the background thread until there's something to do
+    void waitForEvents();
+
+    /// \brief Write the events out to the target, and delete them
+    void writeBatch(std::vector<Event*>& batch);
+
+    const log4cplus::SharedAppenderPtr target_;
+    boost::scoped_ptr<interprocess::InterprocessSync> sync_;
+
+    // The ring buffer.  The producer owns the slots from tail_ to head_ +
+    // capacity, the consumer those from head_ to tail_.  Both indices only
+    // grow; the slot is the index modulo the capacity.
+    std::vector<Event*> ring_;
+    const size_t mask_;
+    std::atomic<size_t> head_;
+    std::atomic<size_t> tail_;
+    std::atomic<size_t> dropped_;
+
+    // Waking the background thread up
+    bundy::util::thread::Mutex mutex_;
+    bundy::util::thread::CondVar cond_;
+    std::atomic<bool> waiting_;
+    std::atomic<bool> stopping_;
+
+    boost::scoped_ptr<bundy::util::thread::Thread> thread_;
+};
+
+} // end namespace internal
+} // end namespace log
+} // end namespace bundy
+
+#endif // LOG_ASYNC_APPENDER_H
@@ -23,6 +23,7 @@
 #include <log/message_types.h>
 
 #include <util/strutil.h>
+#include <util/threads/sync.h>
 
 using namespace std;
 
@@ -30,9 +31,19 @@ namespace bundy {
 namespace log {
 
 // Initialize underlying logger, but only if logging has been initialized.
-void Logger::initLoggerImpl() {
+LoggerImpl* Logger::initLoggerImpl() {
     if (isLoggingInitialized()) {
-        loggerptr_ = new LoggerImpl(name_);
+        // Several threads may use the logger for the first time at once.
+        // The pointer is published (with release ordering) only after the
+        // implementation is constructed, for getLoggerPtr().
+        static util::thread::Mutex mutex;
+        util::thread::Mutex::Locker locker(mutex);
+        LoggerImpl* loggerptr = loggerptr_.load(std::memory_order_relaxed);
+        if (!loggerptr) {
+            loggerptr = new LoggerImpl(name_);
+            loggerptr_.store(loggerptr, std::memory_order_release);
+        }
+        return (loggerptr);
     } else {
         bundy_throw(LoggingNotInitialized, "attempt to access logging function "
                   "before logging has been initialized");
@@ -42,7 +53,7 @@ void Logger::initLoggerImpl() {
 // Destructor.
 
 Logger::~Logger() {
-    delete loggerptr_;
+    delete loggerptr_.load(std::memory_order_relaxed);
 
     // The next statement is required for the BUNDY hooks framework, where
     // a statically-linked BUNDY loads and unloads multiple libraries. See
@@ -15,6 +15,7 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <atomic>
 #include <cassert>
 #include <cstdlib>
 #include <string>
@@ -309,18 +310,25 @@ private:
     /// regardless of whether is is statically or automatically declared -  will
     /// cause a "LoggingNotInitialized" exception to be thrown.
     ///
+    /// The pointer is set once, possibly while other threads read it, so
+    /// it's read with acquire ordering: the implementation it points to is
+    /// fully constructed (see \c initLoggerImpl()).
+    ///
     /// \return Returns pointer to implementation
     LoggerImpl* getLoggerPtr() {
-        if (!loggerptr_) {
-            initLoggerImpl();
+        LoggerImpl* loggerptr = loggerptr_.load(std::memory_order_acquire);
+        if (!loggerptr) {
+            loggerptr = initLoggerImpl();
         }
-        return (loggerptr_);
+        return (loggerptr);
     }
 
     /// \brief Initialize Underlying Implementation and Set loggerptr_
-    void initLoggerImpl();
+    ///
+    /// \return The pointer set
+    LoggerImpl* initLoggerImpl();
 
-    LoggerImpl* loggerptr_;                  ///< Pointer to underlying logger
+    std::atomic<LoggerImpl*> loggerptr_;     ///< Pointer to underlying logger
     char        name_[MAX_LOGGER_NAME_SIZE + 1]; ///< Copy of the logger name
 };
 
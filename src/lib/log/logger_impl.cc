@@ -30,6 +30,7 @@
 #include <log/logger_level_impl.h>
 #include <log/logger_name.h>
 #include <log/logger_manager.h>
+#include <log/logger_manager_impl.h>
 #include <log/message_dictionary.h>
 #include <log/message_types.h>
 #include <log/interprocess/interprocess_sync_file.h>
@@ -129,10 +130,13 @@ LoggerImpl::outputRaw(const Severity& severity, const string& message) {
     bundy::util::thread::Mutex::Locker mutex_locker(LoggerManager::getMutex());
 
     // Use an interprocess sync locker for mutual exclusion from other
-    // processes to avoid log messages getting interspersed.
+    // processes to avoid log messages getting interspersed.  If all the
+    // output is asynchronous, the background threads writing it take the
+    // lock instead (once per batch of messages).
     interprocess::InterprocessSyncLocker locker(*sync_);
+    const bool need_lock = !LoggerManagerImpl::isOutputAsync();
 
-    if (!locker.lock()) {
+    if (need_lock && !locker.lock()) {
         LOG4CPLUS_ERROR(logger_, "Unable to lock logger lockfile");
     }
 
@@ -166,7 +170,7 @@ LoggerImpl::outputRaw(const Severity& severity, const string& message) {
                             << severity);
     }
 
-    if (!locker.unlock()) {
+    if (need_lock && !locker.unlock()) {
         LOG4CPLUS_ERROR(logger_, "Unable to unlock logger lockfile");
     }
 }
@@ -34,6 +34,7 @@
 #include <log/logger_name.h>
 #include <log/logger_specification.h>
 #include <log/buffer_appender_impl.h>
+#include <log/async_appender_impl.h>
 
 #include <boost/lexical_cast.hpp>
 
@@ -43,6 +44,14 @@ using boost::lexical_cast;
 namespace bundy {
 namespace log {
 
+namespace {
+
+// Whether all the appenders are asynchronous; see isOutputAsync().  Protected
+// by the LoggerManager mutex.
+bool output_async = false;
+
+}
+
 // Reset hierarchy of loggers back to default settings.  This removes all
 // appenders from loggers, sets their severity to NOT_SET (so that events are
 // passed back to the parent) and resets the root logger to logging
@@ -60,6 +69,7 @@ LoggerManagerImpl::processInit() {
 void
 LoggerManagerImpl::processEnd() {
     flushBufferAppenders();
+    updateOutputAsync();
 }
 
 // Process logging specification.  Set up the common states then dispatch to
@@ -119,7 +129,7 @@ LoggerManagerImpl::createConsoleAppender(log4cplus::Logger& logger,
         new log4cplus::ConsoleAppender(
             (opt.stream == OutputOption::STR_STDERR), opt.flush));
     setConsoleAppenderLayout(console);
-    logger.addAppender(console);
+    addAppender(logger, console, opt);
 }
 
 // File appender.  Depending on whether a maximum size is given, either
@@ -155,7 +165,7 @@ LoggerManagerImpl::createFileAppender(log4cplus::Logger& logger,
 
     // use the same console layout for the files.
     setConsoleAppenderLayout(fileapp);
-    logger.addAppender(fileapp);
+    addAppender(logger, fileapp, opt);
 }
 
 void
@@ -176,7 +186,20 @@ LoggerManagerImpl::createSyslogAppender(log4cplus::Logger& logger,
     log4cplus::SharedAppenderPtr syslogapp(
         new log4cplus::SysLogAppender(opt.facility));
     setSyslogAppenderLayout(syslogapp);
-    logger.addAppender(syslogapp);
+    addAppender(logger, syslogapp, opt);
+}
+
+void
+LoggerManagerImpl::addAppender(log4cplus::Logger& logger,
+                               const log4cplus::SharedAppenderPtr& appender,
+                               const OutputOption& opt)
+{
+    if (opt.async) {
+        logger.addAppender(log4cplus::SharedAppenderPtr(
+                               new internal::AsyncAppender(appender)));
+    } else {
+        logger.addAppender(appender);
+    }
 }
 
 
@@ -238,6 +261,7 @@ void LoggerManagerImpl::initRootLogger(bundy::log::Severity severity,
         OutputOption opt;
         createConsoleAppender(b10root, opt);
     }
+    updateOutputAsync();
 }
 
 void LoggerManagerImpl::setConsoleAppenderLayout(
@@ -292,5 +316,36 @@ void LoggerManagerImpl::flushBufferAppenders() {
     }
 }
 
+bool
+LoggerManagerImpl::isOutputAsync() {
+    return (output_async);
+}
+
+void
+LoggerManagerImpl::updateOutputAsync() {
+    // Walk through all loggers; a single synchronous appender is enough to
+    // need the lock in the logging thread.
+    size_t async_count = 0;
+    bool sync_found = false;
+    log4cplus::LoggerList loggers = log4cplus::Logger::getCurrentLoggers();
+    loggers.push_back(log4cplus::Logger::getRoot());
+    for (log4cplus::LoggerList::iterator it = loggers.begin();
+         it != loggers.end() && !sync_found; ++it) {
+        const log4cplus::SharedAppenderPtrList appenders =
+            it->getAllAppenders();
+        for (log4cplus::SharedAppenderPtrList::const_iterator ait =
+                 appenders.begin(); ait != appenders.end(); ++ait) {
+            if (dynamic_cast<internal::AsyncAppender*>(ait->get()) == NULL) {
+                sync_found = true;
+                break;
+            }
+            ++async_count;
+        }
+    }
+
+    bundy::util::thread::Mutex::Locker locker(LoggerManager::getMutex());
+    output_async = !sync_found && async_count > 0;
+}
+
 } // namespace log
 } // namespace bundy
@@ -101,7 +101,33 @@ public:
     static void reset(bundy::log::Severity severity = bundy::log::INFO,
                       int dbglevel = 0);
 
+    /// \brief Whether all the output is asynchronous
+    ///
+    /// Returns true if every appender of every logger writes from a
+    /// background thread (see \c internal::AsyncAppender), which then takes
+    /// the interprocess lock itself; so the logging thread doesn't need to.
+    /// It is updated at the end of processing a specification, and must be
+    /// called with the \c LoggerManager mutex held.
+    static bool isOutputAsync();
+
 private:
+    /// \brief Add an appender to a logger
+    ///
+    /// If the output option asks for asynchronous output, the appender is
+    /// wrapped in an \c internal::AsyncAppender first.
+    ///
+    /// \param logger Log4cplus logger to which the appender must be attached.
+    /// \param appender The appender, with its layout already set.
+    /// \param opt Output options for this appender.
+    static void addAppender(log4cplus::Logger& logger,
+                            const log4cplus::SharedAppenderPtr& appender,
+                            const OutputOption& opt);
+
+    /// \brief Update the result of \c isOutputAsync()
+    ///
+    /// Walks through all the loggers and checks their appenders.
+    static void updateOutputAsync();
+
     /// \brief Create console appender
     ///
     /// Creates an object that, when attached to a logger, will log to one
@@ -8,6 +8,7 @@ namespace bundy {
 namespace log {
 
 extern const bundy::log::MessageID LOGIMPL_ABOVE_MAX_DEBUG = "LOGIMPL_ABOVE_MAX_DEBUG";
+extern const bundy::log::MessageID LOGIMPL_ASYNC_DROPPED = "LOGIMPL_ASYNC_DROPPED";
 extern const bundy::log::MessageID LOGIMPL_BAD_DEBUG_STRING = "LOGIMPL_BAD_DEBUG_STRING";
 extern const bundy::log::MessageID LOGIMPL_BELOW_MIN_DEBUG = "LOGIMPL_BELOW_MIN_DEBUG";
 
@@ -18,6 +19,7 @@ namespace {
 
 const char* values[] = {
     "LOGIMPL_ABOVE_MAX_DEBUG", "debug level of %1 is too high and will be set to the maximum of %2",
+    "LOGIMPL_ASYNC_DROPPED", "%1 log messages were dropped as the output could not keep up",
     "LOGIMPL_BAD_DEBUG_STRING", "debug string '%1' has invalid format",
     "LOGIMPL_BELOW_MIN_DEBUG", "debug level of %1 is too low and will be set to the minimum of %2",
     NULL
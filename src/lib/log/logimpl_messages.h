@@ -9,6 +9,7 @@ namespace bundy {
 namespace log {
 
 extern const bundy::log::MessageID LOGIMPL_ABOVE_MAX_DEBUG;
+extern const bundy::log::MessageID LOGIMPL_ASYNC_DROPPED;
 extern const bundy::log::MessageID LOGIMPL_BAD_DEBUG_STRING;
 extern const bundy::log::MessageID LOGIMPL_BELOW_MIN_DEBUG;
 
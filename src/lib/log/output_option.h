@@ -61,7 +61,7 @@ struct OutputOption {
     /// \brief Constructor
     OutputOption() : destination(DEST_CONSOLE), stream(STR_STDERR),
                      flush(true), facility("LOCAL0"), filename(""),
-                     maxsize(0), maxver(0)
+                     maxsize(0), maxver(0), async(false)
     {}
 
     /// Members. 
@@ -73,6 +73,8 @@ struct OutputOption {
     std::string     filename;           ///< Filename if file output
     size_t          maxsize;            ///< 0 if no maximum size
     unsigned int    maxver;             ///< Maximum versions (none if <= 0)
+    bool            async;              ///< true to write from a background
+                                        ///< thread
 };
 
 OutputOption::Destination getDestination(const std::string& dest_str);
@@ -0,0 +1,158 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "config.h"
+#include <gtest/gtest.h>
+
+#include <log/async_appender_impl.h>
+#include <log/logimpl_messages.h>
+#include <log/interprocess/interprocess_sync_null.h>
+#include <util/threads/sync.h>
+
+#include <log4cplus/loggingmacros.h>
+#include <log4cplus/logger.h>
+#include <log4cplus/spi/loggingevent.h>
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace bundy::log;
+using namespace bundy::log::internal;
+using bundy::util::thread::Mutex;
+using boost::lexical_cast;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The appender the events end up in.  It stores the messages, and can be
+// blocked to simulate a slow output.
+class TestTarget : public log4cplus::Appender {
+public:
+    TestTarget() : closed_count_(0) {}
+    virtual ~TestTarget() {
+        destructorImpl();
+    }
+    virtual void close() {
+        ++closed_count_;
+        closed = true;
+    }
+
+    // Only read once the AsyncAppender is closed, so the background thread
+    // is gone.
+    vector<string> messages_;
+    int closed_count_;
+    Mutex gate_;
+
+protected:
+    virtual void append(const log4cplus::spi::InternalLoggingEvent& event) {
+        Mutex::Locker locker(gate_);
+        messages_.push_back(event.getMessage());
+    }
+};
+
+class AsyncAppenderTest : public ::testing::Test {
+protected:
+    AsyncAppenderTest() :
+        target_(new TestTarget),
+        target_ptr_(target_),
+        logger_(log4cplus::Logger::getInstance("async"))
+    {
+        logger_.setLogLevel(log4cplus::TRACE_LOG_LEVEL);
+        logger_.setAdditivity(false);
+    }
+
+    ~AsyncAppenderTest() {
+        logger_.removeAllAppenders();
+    }
+
+    // Create the appender and attach it to the logger
+    AsyncAppender* createAppender(size_t capacity) {
+        AsyncAppender* appender =
+            new AsyncAppender(target_ptr_, capacity,
+                              new interprocess::InterprocessSyncNull("test"));
+        logger_.addAppender(log4cplus::SharedAppenderPtr(appender));
+        return (appender);
+    }
+
+    TestTarget* target_;
+    log4cplus::SharedAppenderPtr target_ptr_;
+    log4cplus::Logger logger_;
+};
+
+// The events get to the target, in order, at the latest when the appender
+// is closed.
+TEST_F(AsyncAppenderTest, write) {
+    AsyncAppender* appender = createAppender(16);
+    EXPECT_EQ(target_, appender->getTarget().get());
+    for (int i = 0; i < 10; ++i) {
+        LOG4CPLUS_INFO(logger_, lexical_cast<string>(i));
+    }
+    appender->close();
+
+    ASSERT_EQ(10, target_->messages_.size());
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(lexical_cast<string>(i), target_->messages_[i]);
+    }
+    EXPECT_EQ(0, appender->getDropped());
+    EXPECT_EQ(1, target_->closed_count_);
+
+    // Closing again does nothing
+    appender->close();
+    EXPECT_EQ(1, target_->closed_count_);
+}
+
+// If the target can't keep up, the events that don't fit are dropped, and
+// the number reported.
+TEST_F(AsyncAppenderTest, dropWhenFull) {
+    AsyncAppender* appender = createAppender(4);
+    {
+        // Block the target.  The background thread may take some of the
+        // events out of the buffer before it blocks, but no more than
+        // the first buffer full.
+        Mutex::Locker locker(target_->gate_);
+        for (int i = 0; i < 20; ++i) {
+            LOG4CPLUS_INFO(logger_, lexical_cast<string>(i));
+        }
+    }
+    appender->close();
+
+    // The events that got through are in order; the others are counted
+    // in the notices.
+    const string prefix = string(LOGIMPL_ASYNC_DROPPED) + " ";
+    size_t written = 0;
+    size_t dropped = 0;
+    int last = -1;
+    for (vector<string>::const_iterator it = target_->messages_.begin();
+         it != target_->messages_.end(); ++it) {
+        if (it->compare(0, prefix.size(), prefix) == 0) {
+            const string count = it->substr(prefix.size(),
+                                            it->find(' ', prefix.size()) -
+                                            prefix.size());
+            dropped += lexical_cast<size_t>(count);
+        } else {
+            const int value = lexical_cast<int>(*it);
+            EXPECT_LT(last, value);
+            last = value;
+            ++written;
+        }
+    }
+    EXPECT_LE(4, written);
+    EXPECT_GE(8, written);
+    EXPECT_EQ(20, written + dropped);
+    EXPECT_EQ(0, appender->getDropped());
+}
+
+}
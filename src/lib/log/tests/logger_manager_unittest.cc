@@ -246,6 +246,34 @@ TEST_F(LoggerManagerTest, FileLogger) {
     checkFileContents(file_spec.getFileName(), ids.begin(), ids.end());
 }
 
+// Check that asynchronous output eventually gets to the file.
+TEST_F(LoggerManagerTest, AsyncFileLogger) {
+    SpecificationForFileLogger file_spec;
+    LoggerSpecification& spec = file_spec.getSpecification();
+    LoggerSpecification::iterator opt = spec.begin();
+    ASSERT_TRUE(opt != spec.end());
+    opt->async = true;
+
+    LoggerManager manager;
+    manager.process(spec);
+
+    vector<MessageID> ids;
+    {
+        Logger logger(file_spec.getLoggerName().c_str());
+
+        LOG_FATAL(logger, LOG_DUPLICATE_MESSAGE_ID).arg("test");
+        ids.push_back(LOG_DUPLICATE_MESSAGE_ID);
+
+        LOG_FATAL(logger, LOG_DUPLICATE_NAMESPACE).arg("test");
+        ids.push_back(LOG_DUPLICATE_NAMESPACE);
+    }
+
+    // Resetting destroys the appenders, which writes out anything still
+    // waiting, in order.
+    LoggerManager::reset();
+    checkFileContents(file_spec.getFileName(), ids.begin(), ids.end());
+}
+
 // Check if the file rolls over when it gets above a certain size.
 TEST_F(LoggerManagerTest, FileSizeRollover) {
     // Set to a suitable minimum that log4cplus can copy with
@@ -34,6 +34,7 @@ TEST(OutputOptionTest, Initialization) {
     EXPECT_EQ(string(""), option.filename);
     EXPECT_EQ(0, option.maxsize);
     EXPECT_EQ(0, option.maxver);
+    EXPECT_FALSE(option.async);
 }
 
 TEST(OutputOption, getDestination) {
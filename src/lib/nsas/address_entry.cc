@@ -14,8 +14,8 @@
 
 /// \file address_entry.cc
 ///
-/// This file exists to define the single constant \c AddressEntry::UNREACHABLE,
-/// equal to the value \c UINT32_MAX.
+/// This file defines the constant \c AddressEntry::UNREACHABLE, equal to the
+/// value \c UINT32_MAX, and the RTT calculations of \c AddressEntry.
 ///
 /// Ideally we could use \c UINT32_MAX directly in the header file, but this
 /// constant is defined in \c stdint.h only if the macro \c __STDC_LIMIT_MACROS
@@ -37,8 +37,94 @@
 
 #include "address_entry.h"
 
+#include <algorithm>
+
 namespace bundy {
 namespace nsas {
 const uint32_t AddressEntry::UNREACHABLE = UINT32_MAX;
+const uint32_t AddressEntry::TIMEOUT_PENALTY = 200;
+const uint32_t AddressEntry::MAX_TIMEOUT_RTT = 10000;
+const uint32_t AddressEntry::MAX_TIMEOUTS = 3;
+const uint32_t AddressEntry::HOLD_DOWN_TIME = 30;
+const uint32_t AddressEntry::MIN_RETRANSMIT_TIMEOUT = 100;
+
+namespace {
+// The weight of the old value when smoothing in a new RTT sample; the same
+// as BIND uses.
+const double RTT_ALPHA = 0.7;
+// The weight of the old value when smoothing in the deviation of a sample
+// (RFC 6298 uses 1 - 1/4).
+const double RTTVAR_BETA = 0.75;
+// The factor an unselected address's RTT is aged by
+const double RTT_DECAY = 0.98;
+// The longest hold down, from RFC 2308 section 7.2
+const uint32_t MAX_HOLD_DOWN_TIME = 5 * 60;
+}
+
+void
+AddressEntry::addRTTSample(uint32_t rtt) {
+    const uint32_t old_rtt = getRTT();
+    if (!sampled_ || old_rtt == UNREACHABLE) {
+        rttvar_ = rtt / 2;
+    } else {
+        const uint32_t deviation = (rtt > old_rtt) ? (rtt - old_rtt) :
+            (old_rtt - rtt);
+        rttvar_ = static_cast<uint32_t>(rttvar_ * RTTVAR_BETA +
+                                        deviation * (1 - RTTVAR_BETA));
+    }
+    if (old_rtt == UNREACHABLE) {
+        // A (late) answer from an address held down, nothing to smooth
+        rtt_ = rtt;
+    } else {
+        rtt_ = static_cast<uint32_t>(old_rtt * RTT_ALPHA +
+                                     rtt * (1 - RTT_ALPHA));
+    }
+    if (rtt_ == 0) {
+        rtt_ = 1;
+    }
+    sampled_ = true;
+    timeouts_ = 0;
+    dead_until_ = 0;
+}
+
+void
+AddressEntry::addTimeout() {
+    const uint32_t old_rtt = getRTT();
+    ++timeouts_;
+    if (timeouts_ >= MAX_TIMEOUTS) {
+        const uint32_t shift = std::min(timeouts_ - MAX_TIMEOUTS, 4u);
+        dead_until_ = time(NULL) +
+            std::min(HOLD_DOWN_TIME << shift, MAX_HOLD_DOWN_TIME);
+        rtt_ = UNREACHABLE;
+    } else if (old_rtt < MAX_TIMEOUT_RTT) {
+        rtt_ = std::min(old_rtt + TIMEOUT_PENALTY, MAX_TIMEOUT_RTT);
+    }
 }
+
+void
+AddressEntry::decayRTT() {
+    const uint32_t old_rtt = getRTT();
+    // Rounded, so RTTs of a few milliseconds (where the difference between
+    // the addresses doesn't matter much) stay as they are.
+    if (old_rtt != UNREACHABLE) {
+        rtt_ = static_cast<uint32_t>(old_rtt * RTT_DECAY + 0.5);
+    }
 }
+
+uint32_t
+AddressEntry::getRetransmitTimeout(uint32_t max_timeout) const {
+    if (!sampled_ || rtt_ == UNREACHABLE) {
+        return (max_timeout);
+    }
+    uint64_t timeout = std::max(static_cast<uint64_t>(rtt_) + 4 * rttvar_,
+                                static_cast<uint64_t>(MIN_RETRANSMIT_TIMEOUT));
+    // Back off exponentially while the address keeps timing out
+    for (uint32_t i = 0; i < timeouts_ && timeout < max_timeout; ++i) {
+        timeout *= 2;
+    }
+    return (static_cast<uint32_t>(std::min(timeout,
+                                           static_cast<uint64_t>(max_timeout))));
+}
+
+} // namespace nsas
+} // namespace bundy
@@ -19,8 +19,16 @@
 ///
 /// Lightweight class that couples an address with a RTT and provides some
 /// convenience methods for accessing and updating the information.
+///
+/// The RTT is a smoothed RTT (SRTT), updated from each measured sample in
+/// the way BIND does.  Along with it, the variance of the samples and the
+/// number of consecutive timeouts are kept; they're used to compute the
+/// retransmission timeout for queries sent to the address.  An address
+/// that keeps timing out is held down (considered unreachable) for a
+/// period that doubles with each further timeout.
 
 #include <stdint.h>
+#include <time.h>
 #include <asiolink/io_address.h>
 
 namespace bundy {
@@ -35,7 +43,8 @@ public:
     /// \param address Address object representing this address
     /// \param rtt Initial round-trip time
     AddressEntry(const asiolink::IOAddress& address, uint32_t rtt = 0) :
-        address_(address), rtt_(rtt), dead_until_(0)
+        address_(address), rtt_(rtt), rttvar_(0), sampled_(false),
+        timeouts_(0), dead_until_(0)
     {}
 
     /// \return Address object
@@ -55,6 +64,9 @@ public:
 
     /// Set current RTT
     ///
+    /// This replaces the smoothed RTT and forgets the history of the
+    /// address.
+    ///
     /// \param rtt New RTT to be associated with this address
     void setRTT(uint32_t rtt) {
         if(rtt == UNREACHABLE){
@@ -62,6 +74,48 @@ public:
         }
 
         rtt_ = rtt;
+        rttvar_ = 0;
+        sampled_ = false;
+        timeouts_ = 0;
+    }
+
+    /// \brief Update the RTT with a measured sample
+    ///
+    /// The sample is smoothed into the RTT (old * 0.7 + sample * 0.3) and
+    /// into the variance.  A response means the address is reachable, so
+    /// the count of consecutive timeouts is reset.
+    ///
+    /// \param rtt The measured round-trip time in milliseconds
+    void addRTTSample(uint32_t rtt);
+
+    /// \brief Record a query to the address timed out
+    ///
+    /// The RTT is penalized by \c TIMEOUT_PENALTY (up to
+    /// \c MAX_TIMEOUT_RTT), so the address is less likely to be selected.
+    /// After \c MAX_TIMEOUTS consecutive timeouts it is held down: it's
+    /// considered unreachable for \c HOLD_DOWN_TIME seconds, doubled for
+    /// each further timeout up to 5 minutes.
+    void addTimeout();
+
+    /// \brief Age the RTT of an address that wasn't selected
+    ///
+    /// The RTT is decreased by a small factor, so addresses which once
+    /// were slow get selected (and measured) again eventually.
+    void decayRTT();
+
+    /// \brief Return the retransmission timeout for a query to the address
+    ///
+    /// This is SRTT + 4 * RTTVAR (as in RFC 6298), at least
+    /// \c MIN_RETRANSMIT_TIMEOUT, and doubled for each consecutive timeout.
+    /// If there's no measured RTT yet, \c max_timeout is used.
+    ///
+    /// \param max_timeout The maximum timeout in milliseconds
+    /// \return The timeout in milliseconds
+    uint32_t getRetransmitTimeout(uint32_t max_timeout) const;
+
+    /// \return The number of consecutive timeouts
+    uint32_t getTimeouts() const {
+        return (timeouts_);
     }
 
     /// Mark address as unreachable.
@@ -86,12 +140,20 @@ public:
         return (address_.getFamily() == AF_INET6);
     }
 
-    // Next element is defined public for testing
+    // Next elements are defined public for testing
     static const uint32_t UNREACHABLE;  ///< RTT indicating unreachable address
+    static const uint32_t TIMEOUT_PENALTY;        ///< RTT added on timeout
+    static const uint32_t MAX_TIMEOUT_RTT;        ///< Max RTT after timeouts
+    static const uint32_t MAX_TIMEOUTS;           ///< Timeouts to hold down
+    static const uint32_t HOLD_DOWN_TIME;         ///< Initial hold down time
+    static const uint32_t MIN_RETRANSMIT_TIMEOUT; ///< Minimum timeout
 
 private:
     asiolink::IOAddress address_;       ///< Address
-    uint32_t        rtt_;               ///< Round-trip time
+    uint32_t        rtt_;               ///< Smoothed round-trip time
+    uint32_t        rttvar_;            ///< Round-trip time variance
+    bool            sampled_;           ///< Whether any RTT was measured
+    uint32_t        timeouts_;          ///< Consecutive timeouts
     time_t  dead_until_;                ///< Dead time for unreachable server
 };
 
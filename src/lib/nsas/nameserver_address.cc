@@ -28,5 +28,12 @@ NameserverAddress::updateRTT(uint32_t rtt) const {
     }
 }
 
+void
+NameserverAddress::decayRTT() const {
+    if (ns_) {
+        ns_->decayAddressRTT(address_.getAddress(), family_);
+    }
+}
+
 } // namespace nsas
 } // namespace bundy
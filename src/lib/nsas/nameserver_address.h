@@ -85,10 +85,17 @@ public:
     /// \brief Update Round-trip Time
     ///
     /// When the user get one request back from the name server, it should
-    /// update the address's RTT.
+    /// update the address's RTT.  If the request timed out, it should be
+    /// updated with \c AddressEntry::UNREACHABLE.
     /// \param rtt The new Round-Trip Time
     void updateRTT(uint32_t rtt) const;
 
+    /// \brief Age the Round-trip Time
+    ///
+    /// Called when another address was selected instead of this one, so
+    /// that this one gets another chance eventually.
+    void decayRTT() const;
+
     /// Short access to the AddressEntry inside.
     //@{
     const AddressEntry& getAddressEntry() const {
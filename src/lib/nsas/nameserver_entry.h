@@ -158,7 +158,8 @@ public:
     ///
     /// Shouldn't probably be used directly. Use corresponding
     /// NameserverAddress.
-    /// \param rtt Round-Trip Time
+    /// \param rtt Round-Trip Time.  \c AddressEntry::UNREACHABLE means the
+    /// query to the address timed out (see \c AddressEntry::addTimeout()).
     /// \param index The address's index in address vector
     /// \param family The address family, V4_ONLY or V6_ONLY
     void updateAddressRTTAtIndex(uint32_t rtt, size_t index,
@@ -177,6 +178,16 @@ public:
     void updateAddressRTT(uint32_t rtt, const asiolink::IOAddress& address,
         AddressFamily family);
 
+    /// \brief Age the RTT of an address
+    ///
+    /// Called for the addresses that weren't selected for a query.  See
+    /// \c AddressEntry::decayRTT().
+    ///
+    /// \param address The address whose RTT should be aged.
+    /// \param family The address family, V4_ONLY or V6_ONLY
+    void decayAddressRTT(const asiolink::IOAddress& address,
+        AddressFamily family);
+
     /// \brief Set Address Unreachable
     ///
     /// Sets the specified address to be unreachable
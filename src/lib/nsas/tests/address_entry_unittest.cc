@@ -103,6 +103,81 @@ TEST_F(AddressEntryTest, RTT) {
     EXPECT_EQ(AddressEntry::UNREACHABLE, alpha.getRTT());
 }
 
+/// Smoothing of measured RTTs and the retransmission timeout.
+TEST_F(AddressEntryTest, RTTSample) {
+
+    AddressEntry alpha(v4a_, 10);
+    // Nothing measured yet, so the maximum timeout is used
+    EXPECT_EQ(2000, alpha.getRetransmitTimeout(2000));
+
+    alpha.addRTTSample(100);
+    EXPECT_EQ(37, alpha.getRTT());      // 10 * 0.7 + 100 * 0.3
+    EXPECT_EQ(237, alpha.getRetransmitTimeout(2000)); // 37 + 4 * 100 / 2
+    EXPECT_EQ(200, alpha.getRetransmitTimeout(200));
+
+    // The timeout has a lower limit
+    AddressEntry beta(v4b_, 1);
+    beta.addRTTSample(2);
+    EXPECT_EQ(AddressEntry::MIN_RETRANSMIT_TIMEOUT,
+              beta.getRetransmitTimeout(2000));
+
+    // A sample of 0 is stored as 1
+    beta.addRTTSample(0);
+    EXPECT_EQ(1, beta.getRTT());
+}
+
+/// Timeouts increase the RTT and back off the retransmission timeout, and
+/// consecutive ones hold the address down.
+TEST_F(AddressEntryTest, Timeout) {
+
+    AddressEntry alpha(v4a_, 10);
+    alpha.addRTTSample(100);
+    ASSERT_EQ(37, alpha.getRTT());
+
+    alpha.addTimeout();
+    EXPECT_EQ(1, alpha.getTimeouts());
+    EXPECT_EQ(37 + AddressEntry::TIMEOUT_PENALTY, alpha.getRTT());
+    EXPECT_EQ((237 + 200) * 2, alpha.getRetransmitTimeout(2000));
+    EXPECT_FALSE(alpha.isUnreachable());
+
+    alpha.addTimeout();
+    EXPECT_EQ(2000, alpha.getRetransmitTimeout(2000));
+    EXPECT_FALSE(alpha.isUnreachable());
+
+    alpha.addTimeout();
+    EXPECT_EQ(AddressEntry::MAX_TIMEOUTS, alpha.getTimeouts());
+    EXPECT_TRUE(alpha.isUnreachable());
+
+    // An answer brings it back
+    alpha.addRTTSample(50);
+    EXPECT_FALSE(alpha.isUnreachable());
+    EXPECT_EQ(0, alpha.getTimeouts());
+    EXPECT_EQ(50, alpha.getRTT());
+
+    // The penalty is limited
+    AddressEntry beta(v4b_, AddressEntry::MAX_TIMEOUT_RTT - 1);
+    beta.addTimeout();
+    EXPECT_EQ(AddressEntry::MAX_TIMEOUT_RTT, beta.getRTT());
+}
+
+/// Aging of the RTT.
+TEST_F(AddressEntryTest, DecayRTT) {
+
+    AddressEntry alpha(v4a_, 100);
+    alpha.decayRTT();
+    EXPECT_EQ(98, alpha.getRTT());
+
+    // It doesn't go to 0
+    AddressEntry beta(v4b_, 1);
+    beta.decayRTT();
+    EXPECT_EQ(1, beta.getRTT());
+
+    // And unreachable addresses stay unreachable
+    beta.setUnreachable();
+    beta.decayRTT();
+    EXPECT_TRUE(beta.isUnreachable());
+}
+
 /// Checking the address type.
 TEST_F(AddressEntryTest, AddressType) {
 
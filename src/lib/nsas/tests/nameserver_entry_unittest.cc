@@ -520,4 +520,37 @@ TEST_F(NameserverEntryTest, UpdateRTT) {
 
 }
 
+// Test timeouts reported through updateRTT() and the aging of the RTT
+TEST_F(NameserverEntryTest, UpdateRTTTimeout) {
+    boost::shared_ptr<NameserverEntry> ns(new NameserverEntry(EXAMPLE_CO_UK,
+        RRClass::IN()));
+    fillNSEntry(ns, rrv4_, rrv6_);
+    NameserverEntry::AddressVector vec;
+    ns->getAddresses(vec);
+    ns->setAddressRTT(vec[0].getAddress(), 100);
+
+    // A timeout penalizes the address
+    vec[0].updateRTT(AddressEntry::UNREACHABLE);
+    NameserverEntry::AddressVector newvec;
+    ns->getAddresses(newvec);
+    EXPECT_EQ(100 + AddressEntry::TIMEOUT_PENALTY,
+              newvec[0].getAddressEntry().getRTT());
+    EXPECT_EQ(1, newvec[0].getAddressEntry().getTimeouts());
+
+    // Several in a row make it unreachable
+    for (uint32_t i = 1; i < AddressEntry::MAX_TIMEOUTS; ++i) {
+        vec[0].updateRTT(AddressEntry::UNREACHABLE);
+    }
+    newvec.clear();
+    ns->getAddresses(newvec);
+    EXPECT_TRUE(newvec[0].getAddressEntry().isUnreachable());
+
+    // Aging decreases the RTT of an address a bit
+    ns->setAddressRTT(vec[1].getAddress(), 1000);
+    vec[1].decayRTT();
+    newvec.clear();
+    ns->getAddresses(newvec);
+    EXPECT_EQ(980, newvec[1].getAddressEntry().getRTT());
+}
+
 }   // namespace
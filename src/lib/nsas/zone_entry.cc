@@ -317,7 +317,8 @@ updateAddressSelector(std::vector<NameserverAddress>& addresses,
         if(rtt == AddressEntry::UNREACHABLE) {
             probabilities.push_back(0);
         } else {
-            probabilities.push_back(1.0/(rtt*rtt));
+            // Calculated as double, the square doesn't fit in 32 bits
+            probabilities.push_back(1.0/(static_cast<double>(rtt)*rtt));
         }
     }
     // Calculate the sum
@@ -539,9 +540,16 @@ ZoneEntry::process(AddressFamily family,
                     // any callbacks upon exception
                     to_execute.swap(callbacks_[family]);
 
-                    // Run the callbacks
+                    // Run the callbacks.  The addresses not selected are
+                    // aged, so the slower ones get probed from time to time.
                     BOOST_FOREACH(const CallbackPtr& callback, to_execute) {
-                        callback->success(addresses[address_selector()]);
+                        const size_t selected = address_selector();
+                        for (size_t i = 0; i < addresses.size(); ++i) {
+                            if (i != selected) {
+                                addresses[i].decayRTT();
+                            }
+                        }
+                        callback->success(addresses[selected]);
                     }
                     return;
                 } else if (!pending) {
@@ -53,15 +53,17 @@ class Socket:
     collector. In short, do not make reference cycles with this and generally
     leave this class alone to live peacefully.
     """
-    def __init__(self, protocol, address, port, fileno):
+    def __init__(self, protocol, address, port, fileno, instance=0):
         """
         Creates the socket.
 
-        The protocol, address and port are preserved for the information.
+        The protocol, address, port and instance are preserved for the
+        information.
         """
         self.protocol = protocol
         self.address = address
         self.port = port
+        self.instance = instance
         self.fileno = fileno
         # Mapping from token -> application
         self.active_tokens = {}
@@ -140,13 +142,14 @@ class Cache:
         # application, for the sockets already picked up by an application
         self._active_apps = {}
         # The sockets live here to be indexed by protocol, address and
-        # subsequently by port
+        # subsequently by the (port, instance) pair
         self._sockets = {}
         # These are just the tokens actually in use, so we don't generate
         # dupes. If one is dropped, it can be potentially reclaimed.
         self._live_tokens = set()
 
-    def get_token(self, protocol, address, port, share_mode, share_name):
+    def get_token(self, protocol, address, port, share_mode, share_name,
+                  instance=0):
         """
         This requests a token representing a socket. The socket is either
         found in the cache already or requested from the creator at this time
@@ -161,6 +164,12 @@ class Cache:
           for details.
         - share_name: the name of application, in case of 'SAMEAPP' share
           mode. Only requests with the same name can share the socket.
+        - instance: non-negative integer. Requests with different instances
+          get different sockets, bound to the same address and port. This
+          is how an application gets a UDP socket for each of its threads:
+          the socket creator sets SO_REUSEPORT on the UDP sockets, so it can
+          bind them all (with its privileges) and the kernel distributes the
+          packets among them.
 
         If the call is successful, it returns a string token which can be
         used to pick up the socket later. The socket is created with reference
@@ -183,7 +192,7 @@ class Cache:
         """
         addr_str = str(address)
         try:
-            socket = self._sockets[protocol][addr_str][port]
+            socket = self._sockets[protocol][addr_str][(port, instance)]
         except KeyError:
             # Something in the dicts is not there, so socket is to be
             # created
@@ -194,13 +203,13 @@ class Cache:
                     raise
                 else:
                     raise SocketError(str(ce), ce.errno)
-            socket = Socket(protocol, address, port, fileno)
+            socket = Socket(protocol, address, port, fileno, instance)
             # And cache it
             if protocol not in self._sockets:
                 self._sockets[protocol] = {}
             if addr_str not in self._sockets[protocol]:
                 self._sockets[protocol][addr_str] = {}
-            self._sockets[protocol][addr_str][port] = socket
+            self._sockets[protocol][addr_str][(port, instance)] = socket
         # Now we get the token, check it is compatible
         if not socket.share_compatible(share_mode, share_name):
             raise ShareError("Cached socket not compatible with mode " +
@@ -271,9 +280,9 @@ class Cache:
         # The socket is not used by anything now, so remove it
         if len(socket.active_tokens) == 0 and len(socket.waiting_tokens) == 0:
             addr = str(socket.address)
-            port = socket.port
+            key = (socket.port, socket.instance)
             proto = socket.protocol
-            del self._sockets[proto][addr][port]
+            del self._sockets[proto][addr][key]
             # Clean up empty branches of the structure
             if len(self._sockets[proto][addr]) == 0:
                 del self._sockets[proto][addr]
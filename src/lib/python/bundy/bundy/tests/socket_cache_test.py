@@ -63,6 +63,7 @@ class SocketTest(Test):
         self.assertEqual('UDP', self.__socket.protocol)
         self.assertEqual(self.__address, self.__socket.address)
         self.assertEqual(1024, self.__socket.port)
+        self.assertEqual(0, self.__socket.instance)
         self.assertEqual(42, self.__socket.fileno)
         self.assertEqual({}, self.__socket.active_tokens)
         self.assertEqual({}, self.__socket.shares)
@@ -176,7 +177,7 @@ class SocketCacheTest(Test):
         cached inside.
         """
         self.__cache._sockets = {
-            'UDP': {'192.0.2.1': {1024: self.__socket}}
+            'UDP': {'192.0.2.1': {(1024, 0): self.__socket}}
         }
         token = self.__cache.get_token('UDP', self.__address, 1024, 'ANY',
                                        'test')
@@ -220,7 +221,7 @@ class SocketCacheTest(Test):
         self.assertEqual('UDP', socket.protocol)
         # The socket is properly cached
         self.assertEqual({
-            'UDP': {'192.0.2.1': {1024: socket}}
+            'UDP': {'192.0.2.1': {(1024, 0): socket}}
         }, self.__cache._sockets)
         # The token is both in the waiting sockets and the live tokens
         self.assertEqual({token: socket}, self.__cache._waiting_tokens)
@@ -230,6 +231,32 @@ class SocketCacheTest(Test):
         # The socket knows the token is waiting in it
         self.assertEqual(set([token]), socket.waiting_tokens)
 
+    def test_get_token_instances(self):
+        """
+        Check each instance gets its own socket for the same address and port.
+        """
+        token0 = self.__cache.get_token('UDP', self.__address, 1024,
+                                        'SAMEAPP', 'test')
+        self.assertTrue(self.__get_socket_called)
+        self.__get_socket_called = False
+        token1 = self.__cache.get_token('UDP', self.__address, 1024,
+                                        'SAMEAPP', 'test', 1)
+        # Another socket was created for the other instance
+        self.assertTrue(self.__get_socket_called)
+        socket0 = self.__cache._waiting_tokens[token0]
+        socket1 = self.__cache._waiting_tokens[token1]
+        self.assertEqual(0, socket0.instance)
+        self.assertEqual(1, socket1.instance)
+        self.assertEqual({
+            'UDP': {'192.0.2.1': {(1024, 0): socket0, (1024, 1): socket1}}
+        }, self.__cache._sockets)
+        # But the same instance is shared
+        self.__get_socket_called = False
+        token = self.__cache.get_token('UDP', self.__address, 1024,
+                                       'SAMEAPP', 'test', 1)
+        self.assertFalse(self.__get_socket_called)
+        self.assertEqual(socket1, self.__cache._waiting_tokens[token])
+
     def test_get_token_excs(self):
         """
         Test that it is handled properly if the socket creator raises
@@ -265,7 +292,9 @@ class SocketCacheTest(Test):
         self.__socket.waiting_tokens = set([token])
         self.__socket.shares = {token: ('ANY', 'app')}
         self.__cache._waiting_tokens = {token: self.__socket}
-        self.__cache._sockets = {'UDP': {'192.0.2.1': {1024: self.__socket}}}
+        self.__cache._sockets = {
+            'UDP': {'192.0.2.1': {(1024, 0): self.__socket}}
+        }
         self.__cache._live_tokens = set([token])
         socket = self.__cache.get_socket(token, app)
         # Received the fileno
@@ -319,7 +348,9 @@ class SocketCacheTest(Test):
         self.__socket.shares = {'t1': ('ANY', 'app1'), 't2': ('ANY', 'app2')}
         self.__cache._waiting_tokens = {'t2': self.__socket}
         self.__cache._active_tokens = {'t1': self.__socket}
-        self.__cache._sockets = {'UDP': {'192.0.2.1': {1024: self.__socket}}}
+        self.__cache._sockets = {
+            'UDP': {'192.0.2.1': {(1024, 0): self.__socket}}
+        }
         self.__cache._live_tokens = set(['t1', 't2'])
         self.__cache._active_apps = {1: set(['t1'])}
         # We can't drop what wasn't picket up yet
@@ -330,7 +361,7 @@ class SocketCacheTest(Test):
                          self.__socket.shares)
         self.assertEqual({'t2': self.__socket}, self.__cache._waiting_tokens)
         self.assertEqual({'t1': self.__socket}, self.__cache._active_tokens)
-        self.assertEqual({'UDP': {'192.0.2.1': {1024: self.__socket}}},
+        self.assertEqual({'UDP': {'192.0.2.1': {(1024, 0): self.__socket}}},
                          self.__cache._sockets)
         self.assertEqual(set(['t1', 't2']), self.__cache._live_tokens)
         self.assertEqual({1: set(['t1'])}, self.__cache._active_apps)
@@ -341,7 +372,7 @@ class SocketCacheTest(Test):
         self.assertEqual(set(['t2']), self.__socket.waiting_tokens)
         self.assertEqual({'t2': ('ANY', 'app2')}, self.__socket.shares)
         self.assertEqual({}, self.__cache._active_tokens)
-        self.assertEqual({'UDP': {'192.0.2.1': {1024: self.__socket}}},
+        self.assertEqual({'UDP': {'192.0.2.1': {(1024, 0): self.__socket}}},
                          self.__cache._sockets)
         self.assertEqual(set(['t2']), self.__cache._live_tokens)
         self.assertEqual({}, self.__cache._active_apps)
@@ -368,7 +399,7 @@ class SocketCacheTest(Test):
         self.assertEqual({'t2': ('ANY', 'app2')}, self.__socket.shares)
         self.assertEqual({}, self.__cache._waiting_tokens)
         self.assertEqual({'t2': self.__socket}, self.__cache._active_tokens)
-        self.assertEqual({'UDP': {'192.0.2.1': {1024: self.__socket}}},
+        self.assertEqual({'UDP': {'192.0.2.1': {(1024, 0): self.__socket}}},
                          self.__cache._sockets)
         self.assertEqual(set(['t3', 't2']), self.__cache._live_tokens)
         self.assertEqual({1: set(['t3']), 2: set(['t2'])},
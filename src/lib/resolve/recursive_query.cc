@@ -18,7 +18,10 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>             // for some IPC/network system calls
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
@@ -38,6 +41,7 @@
 #include <asio.hpp>
 #include <asiodns/dns_service.h>
 #include <asiodns/io_fetch.h>
+#include <asiodns/upstream_socket_pool.h>
 #include <asiolink/io_service.h>
 #include <resolve/response_classifier.h>
 #include <resolve/recursive_query.h>
@@ -47,6 +51,8 @@ using namespace bundy::nsas;
 using namespace bundy::util;
 using namespace bundy::asiolink;
 using namespace bundy::resolve;
+using bundy::statistics::Counter;
+using bundy::statistics::Histogram;
 
 namespace bundy {
 namespace asiodns {
@@ -78,8 +84,29 @@ questionText(const bundy::dns::Question& question) {
     return (text);
 }
 
+// The key of a question in the tables of the queries in progress.  Names
+// are case insensitive, so it's made of the downcased name.
+std::string
+questionKey(const bundy::dns::Question& question) {
+    return (Question(Name(question.getName()).downcase(),
+                     question.getClass(), question.getType()).toText());
+}
+
 } // anonymous namespace
 
+// The clients waiting for the questions being resolved, keyed by
+// questionKey().  The first client asking a question starts the
+// RunningQuery and isn't stored here; the ones asking the same question
+// while it's running get its result through InFlightCallback.
+class InFlightTable {
+public:
+    typedef std::pair<MessagePtr, ResolverInterface::CallbackPtr> Waiter;
+    typedef std::vector<Waiter> Waiters;
+    typedef std::map<std::string, Waiters> Table;
+
+    Table table_;
+};
+
 /// \brief Find deepest usable delegation in the cache
 ///
 /// This finds the deepest delegation we have in cache and is safe to use.
@@ -139,9 +166,15 @@ RecursiveQuery::RecursiveQuery(DNSServiceBase& dns_service,
     nsas_(nsas), cache_(cache),
     upstream_(new AddressVector(upstream)),
     upstream_root_(new AddressVector(upstream_root)),
-    test_server_("", 0),
+    test_server_("", 0), nameserver_port_(53),
     query_timeout_(query_timeout), client_timeout_(client_timeout),
-    lookup_timeout_(lookup_timeout), retries_(retries), rtt_recorder_()
+    lookup_timeout_(lookup_timeout), retries_(retries), rtt_recorder_(),
+    prefetch_threshold_(0), serve_stale_(false),
+    counters_(new Counter(COUNTER_TYPES)),
+    latency_(new Histogram()),
+    prefetching_(new std::set<std::string>()),
+    in_flight_(new InFlightTable()),
+    socket_pool_(new UpstreamSocketPool(dns_service.getIOService()))
 {
 }
 
@@ -153,12 +186,42 @@ RecursiveQuery::setTestServer(const std::string& address, uint16_t port) {
     test_server_.second = port;
 }
 
+void
+RecursiveQuery::setNameserverPort(uint16_t port) {
+    nameserver_port_ = port;
+}
+
 // Set the RTT recorder - only used for testing
 void
 RecursiveQuery::setRttRecorder(boost::shared_ptr<RttRecorder>& recorder) {
     rtt_recorder_ = recorder;
 }
 
+void
+RecursiveQuery::setPrefetchThreshold(unsigned int percent) {
+    if (percent > 100) {
+        bundy_throw(InvalidParameter, "prefetch threshold is larger than "
+                    "100%: " << percent);
+    }
+    prefetch_threshold_ = percent;
+}
+
+void
+RecursiveQuery::setServeStaleWindow(uint32_t seconds) {
+    cache_.setStaleWindow(seconds);
+    serve_stale_ = (seconds > 0);
+}
+
+Counter::Value
+RecursiveQuery::getCounter(CounterType type) const {
+    return (counters_->get(type));
+}
+
+const Histogram&
+RecursiveQuery::getLatency() const {
+    return (*latency_);
+}
+
 namespace {
 typedef std::pair<std::string, uint16_t> addr_t;
 
@@ -184,10 +247,10 @@ public:
     }
 
     void unreachable() {
-        // Nameservers unreachable: drop query or send servfail?
+        // Nameservers unreachable: answer with stale data or servfail
         LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CB, RESLIB_RUNQ_FAIL);
         rq_->nsasCallbackCalled();
-        rq_->makeSERVFAIL();
+        rq_->makeFailureAnswer();
         rq_->callCallback(true);
         rq_->stop();
     }
@@ -214,6 +277,9 @@ private:
     // other servers if the port is non-zero.
     std::pair<std::string, uint16_t> test_server_;
 
+    // Port the nameservers are queried on (53 except in tests).
+    const uint16_t nameserver_port_;
+
     // Buffer to store the intermediate results.
     OutputBufferPtr buffer_;
 
@@ -305,6 +371,20 @@ private:
     // sent to this object as well as being used to update the NSAS.
     boost::shared_ptr<RttRecorder> rtt_recorder_;
 
+    // If true, the first lookup skips the cache.  This is for refreshing
+    // cached data in advance (prefetch).
+    bool bypass_cache_;
+
+    // If true, we answer with stale data from the cache (if any) instead
+    // of SERVFAIL when we give up.
+    const bool serve_stale_;
+
+    // Counters of the RecursiveQuery that created us.
+    boost::shared_ptr<Counter> counters_;
+
+    // Sockets for the queries, shared with the other running queries.
+    boost::shared_ptr<UpstreamSocketPool> socket_pool_;
+
     // perform a single lookup; first we check the cache to see
     // if we have a response for our query stored already. if
     // so, call handlerecursiveresponse(), if not, we call send()
@@ -314,7 +394,10 @@ private:
 
         Message cached_message(Message::RENDER);
         bundy::resolve::initResponseMessage(question_, cached_message);
-        if (cache_.lookup(question_.getName(), question_.getType(),
+        const bool bypass_cache = bypass_cache_;
+        bypass_cache_ = false;
+        if (!bypass_cache &&
+            cache_.lookup(question_.getName(), question_.getType(),
                           question_.getClass(), cached_message)) {
 
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE, RESLIB_RUNQ_CACHE_FIND)
@@ -349,16 +432,31 @@ private:
                 test_server_.first,
                 test_server_.second, buffer_, this,
                 query_timeout_, edns_);
+            query.setSocketPool(socket_pool_);
             io_.get_io_service().post(query);
         } else {
             IOFetch query(protocol_, io_, question_,
                 current_ns_address.getAddress(),
-                53, buffer_, this,
-                query_timeout_, edns_);
+                nameserver_port_, buffer_, this,
+                getQueryTimeout(current_ns_address), edns_);
+            query.setSocketPool(socket_pool_);
             io_.get_io_service().post(query);
         }
     }
 
+    // The timeout for a query to the given nameserver address.  Rather than
+    // waiting query_timeout_ for every server, it's the retransmission
+    // timeout estimated from the RTTs measured for the address, so a lost
+    // query to a fast server is retried soon.  query_timeout_ is the upper
+    // limit (and is used for addresses never queried before).
+    int getQueryTimeout(const bundy::nsas::NameserverAddress& address) const {
+        if (query_timeout_ <= 0) {
+            return (query_timeout_);
+        }
+        return (address.getAddressEntry().getRetransmitTimeout(
+                    query_timeout_));
+    }
+
     // 'general' send, ask the NSAS to give us an address.
     void send(IOFetch::Protocol protocol = IOFetch::UDP, bool edns = true) {
         protocol_ = protocol;   // Store protocol being used for this
@@ -374,6 +472,7 @@ private:
                 test_server_.first,
                 test_server_.second, buffer_, this,
                 query_timeout_, edns_);
+            query.setSocketPool(socket_pool_);
             io_.get_io_service().post(query);
 
         } else {
@@ -440,7 +539,9 @@ private:
             // target, then start over at the beginning (for now, that
             // is, we reset our 'current servers' to the root servers).
             if (cname_count_ >= RESOLVER_MAX_CNAME_CHAIN) {
-                // CNAME chain too long - just give up
+                // CNAME chain too long - just give up.  This is a problem
+                // of the data, not of reaching the servers, so no stale
+                // answer.
                 LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_RESULTS, RESLIB_LONG_CHAIN)
                           .arg(questionText(question_));
                 makeSERVFAIL();
@@ -566,11 +667,11 @@ private:
         default:
 SERVFAIL:
             // Some error in received packet it.  Report it and return SERVFAIL
-            // to the caller.
+            // (or stale data) to the caller.
             if (logger.isDebugEnabled()) {
                 reportResponseClassifierError(category, incoming.getRcode());
             }
-            makeSERVFAIL();
+            makeFailureAnswer();
             return (true);
         }
 
@@ -670,19 +771,24 @@ public:
         const Question& question,
         MessagePtr answer_message,
         std::pair<std::string, uint16_t>& test_server,
+        uint16_t nameserver_port,
         OutputBufferPtr buffer,
         bundy::resolve::ResolverInterface::CallbackPtr cb,
         int query_timeout, int client_timeout, int lookup_timeout,
         unsigned retries,
         bundy::nsas::NameserverAddressStore& nsas,
         bundy::cache::ResolverCache& cache,
-        boost::shared_ptr<RttRecorder>& recorder)
+        boost::shared_ptr<RttRecorder>& recorder,
+        bool bypass_cache, bool serve_stale,
+        const boost::shared_ptr<Counter>& counters,
+        const boost::shared_ptr<UpstreamSocketPool>& socket_pool)
         :
         io_(io),
         question_(question),
         query_message_(),
         answer_message_(answer_message),
         test_server_(test_server),
+        nameserver_port_(nameserver_port),
         buffer_(buffer),
         resolvercallback_(cb),
         protocol_(IOFetch::UDP),
@@ -699,7 +805,11 @@ public:
         nsas_callback_(),
         nsas_callback_out_(false),
         outstanding_events_(0),
-        rtt_recorder_(recorder)
+        rtt_recorder_(recorder),
+        bypass_cache_(bypass_cache),
+        serve_stale_(serve_stale),
+        counters_(counters),
+        socket_pool_(socket_pool)
     {
         // Set here to avoid using "this" in initializer list.
         nsas_callback_.reset(new ResolverNSASCallback(this));
@@ -729,7 +839,7 @@ public:
     // not been called, call it now. Then stop.
     void lookupTimeout() {
         if (!callback_called_) {
-            makeSERVFAIL();
+            makeFailureAnswer();
             callCallback(true);
         }
         assert(outstanding_events_ > 0);
@@ -741,7 +851,7 @@ public:
     // not been called, call it now. But do not stop.
     void clientTimeout() {
         if (!callback_called_) {
-            makeSERVFAIL();
+            makeFailureAnswer();
             callCallback(true);
         }
         assert(outstanding_events_ > 0);
@@ -857,7 +967,7 @@ public:
                               RESLIB_PROTOCOL)
                               .arg(questionText(question_)).arg(dpe.what());
                     if (!callback_called_) {
-                        makeSERVFAIL();
+                        makeFailureAnswer();
                         callCallback(true);
                     }
                     stop();
@@ -879,7 +989,7 @@ public:
                 current_ns_address.updateRTT(bundy::nsas::AddressEntry::UNREACHABLE);
             }
             if (!callback_called_) {
-                makeSERVFAIL();
+                makeFailureAnswer();
                 callCallback(true);
             }
             stop();
@@ -893,6 +1003,30 @@ public:
             bundy::resolve::makeErrorMessage(answer_message_, Rcode::SERVFAIL());
         }
     }
+
+    // We are giving up.  If serving stale data is enabled and the cache
+    // still has (expired) data for the current question, answer with it
+    // (following any CNAMEs already in the answer section); otherwise
+    // answer with SERVFAIL.
+    void makeFailureAnswer() {
+        if (serve_stale_ && answer_message_) {
+            const RRsetPtr stale_rrset =
+                cache_.lookupStale(question_.getName(), question_.getType(),
+                                   question_.getClass());
+            if (stale_rrset) {
+                LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE,
+                          RESLIB_STALE_ANSWER).arg(questionText(question_));
+                answer_message_->clearSection(Message::SECTION_AUTHORITY);
+                answer_message_->clearSection(Message::SECTION_ADDITIONAL);
+                answer_message_->addRRset(Message::SECTION_ANSWER,
+                                          stale_rrset);
+                answer_message_->setRcode(Rcode::NOERROR());
+                counters_->inc(RecursiveQuery::COUNTER_STALE_ANSWER);
+                return;
+            }
+        }
+        makeSERVFAIL();
+    }
 };
 
 class ForwardQuery : public IOFetch::Callback, public AbstractRunningQuery {
@@ -935,6 +1069,9 @@ private:
     // don't call back a second time later
     bool callback_called_;
 
+    // Sockets for the queries, shared with the other running queries.
+    boost::shared_ptr<UpstreamSocketPool> socket_pool_;
+
     // send the query to the server.
     void send(IOFetch::Protocol protocol = IOFetch::UDP) {
         const int uc = upstream_->size();
@@ -953,6 +1090,7 @@ private:
             upstream_->at(serverIndex).first,
             upstream_->at(serverIndex).second,
             buffer_, this, query_timeout_);
+        query.setSocketPool(socket_pool_);
 
         io_.get_io_service().post(query);
     }
@@ -964,7 +1102,8 @@ public:
         boost::shared_ptr<AddressVector> upstream,
         OutputBufferPtr buffer,
         bundy::resolve::ResolverInterface::CallbackPtr cb,
-        int query_timeout, int client_timeout, int lookup_timeout) :
+        int query_timeout, int client_timeout, int lookup_timeout,
+        const boost::shared_ptr<UpstreamSocketPool>& socket_pool) :
         io_(io),
         query_message_(query_message),
         answer_message_(answer_message),
@@ -975,7 +1114,8 @@ public:
         client_timer(io.get_io_service()),
         lookup_timer(io.get_io_service()),
         outstanding_events_(0),
-        callback_called_(false)
+        callback_called_(false),
+        socket_pool_(socket_pool)
     {
         // Setup the timer to stop trying (lookup_timeout)
         if (lookup_timeout >= 0) {
@@ -1073,6 +1213,137 @@ public:
     }
 };
 
+// Callback for the RunningQuery started by the first client asking a
+// question.  It passes the result to that client's callback, and copies
+// it to the answers of the other clients that asked the same question in
+// the meantime (see InFlightTable).  Then the question is no longer in
+// progress, so the next client asking it starts a new query.
+class InFlightCallback : public ResolverInterface::Callback {
+public:
+    InFlightCallback(const ResolverInterface::CallbackPtr& callback,
+                     const boost::shared_ptr<InFlightTable>& in_flight,
+                     const std::string& key) :
+        callback_(callback), in_flight_(in_flight), key_(key)
+    {}
+
+    virtual void success(const MessagePtr response) {
+        const InFlightTable::Waiters waiters = takeWaiters();
+        callback_->success(response);
+        for (InFlightTable::Waiters::const_iterator it = waiters.begin();
+             it != waiters.end(); ++it) {
+            bundy::resolve::copyResponseMessage(*response, it->first);
+            it->second->success(it->first);
+        }
+    }
+
+    virtual void failure() {
+        const InFlightTable::Waiters waiters = takeWaiters();
+        callback_->failure();
+        for (InFlightTable::Waiters::const_iterator it = waiters.begin();
+             it != waiters.end(); ++it) {
+            it->second->failure();
+        }
+    }
+
+private:
+    InFlightTable::Waiters takeWaiters() {
+        InFlightTable::Waiters waiters;
+        const InFlightTable::Table::iterator it =
+            in_flight_->table_.find(key_);
+        if (it != in_flight_->table_.end()) {
+            waiters.swap(it->second);
+            in_flight_->table_.erase(it);
+        }
+        return (waiters);
+    }
+
+    const ResolverInterface::CallbackPtr callback_;
+    const boost::shared_ptr<InFlightTable> in_flight_;
+    const std::string key_;
+};
+
+// Callback for a background refresh (prefetch) query.  Nobody is waiting
+// for the answer (the RunningQuery updates the cache itself), so it only
+// counts the result and forgets the question, so it can be refreshed again
+// later.
+class PrefetchCallback : public bundy::resolve::ResolverInterface::Callback {
+public:
+    PrefetchCallback(const boost::shared_ptr<Counter>& counters,
+                     const boost::shared_ptr<std::set<std::string> >&
+                     prefetching,
+                     const std::string& key) :
+        counters_(counters), prefetching_(prefetching), key_(key)
+    {}
+
+    virtual void success(const MessagePtr response) {
+        done(response->getRcode() != Rcode::SERVFAIL());
+    }
+
+    virtual void failure() {
+        done(false);
+    }
+
+private:
+    void done(bool succeeded) {
+        counters_->inc(succeeded ? RecursiveQuery::COUNTER_PREFETCH_SUCCEEDED :
+                       RecursiveQuery::COUNTER_PREFETCH_FAILED);
+        prefetching_->erase(key_);
+    }
+
+    const boost::shared_ptr<Counter> counters_;
+    const boost::shared_ptr<std::set<std::string> > prefetching_;
+    const std::string key_;
+};
+
+}
+
+void
+RecursiveQuery::prefetchIfDue(const Question& question) {
+    if (prefetch_threshold_ == 0 ||
+        !cache_.isRefreshDue(question.getName(), question.getType(),
+                             question.getClass(), prefetch_threshold_)) {
+        return;
+    }
+    // Only one refresh for the same question at a time.
+    const std::string key = questionKey(question);
+    if (!prefetching_->insert(key).second) {
+        return;
+    }
+    LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_CACHE, RESLIB_PREFETCH)
+              .arg(questionText(question));
+    counters_->inc(COUNTER_PREFETCH_STARTED);
+
+    MessagePtr answer_message(new Message(Message::RENDER));
+    bundy::resolve::initResponseMessage(question, *answer_message);
+    OutputBufferPtr buffer(new OutputBuffer(0));
+    bundy::resolve::ResolverInterface::CallbackPtr callback(
+        new PrefetchCallback(counters_, prefetching_, key));
+    // It will delete itself when it is done.  There's no client waiting
+    // for it, so there's no client timeout either.
+    new RunningQuery(dns_service_.getIOService(), question, answer_message,
+                     test_server_, nameserver_port_, buffer, callback,
+                     query_timeout_, -1, lookup_timeout_, retries_, nsas_,
+                     cache_, rtt_recorder_,
+                     true, false, counters_, socket_pool_);
+}
+
+bool
+RecursiveQuery::joinInFlight(const Question& question,
+                             MessagePtr answer_message,
+                             ResolverInterface::CallbackPtr& callback)
+{
+    const std::string key = questionKey(question);
+    const InFlightTable::Table::iterator it = in_flight_->table_.find(key);
+    if (it != in_flight_->table_.end()) {
+        LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE,
+                  RESLIB_RECQ_COALESCED).arg(questionText(question));
+        it->second.push_back(InFlightTable::Waiter(answer_message, callback));
+        counters_->inc(COUNTER_COALESCED);
+        return (true);
+    }
+    in_flight_->table_.insert(std::make_pair(key, InFlightTable::Waiters()));
+    callback.reset(new InFlightCallback(callback, in_flight_, key));
+    return (false);
 }
 
 AbstractRunningQuery*
@@ -1098,7 +1369,9 @@ RecursiveQuery::resolve(const QuestionPtr& question,
 
         // TODO: err, should cache set rcode as well?
         answer_message->setRcode(Rcode::NOERROR());
+        counters_->inc(COUNTER_CACHE_HIT);
         callback->success(answer_message);
+        prefetchIfDue(*question);
     } else {
         // Perhaps we only have the one RRset?
         // TODO: can we do this? should we check for specific types only?
@@ -1112,17 +1385,26 @@ RecursiveQuery::resolve(const QuestionPtr& question,
             answer_message->addRRset(Message::SECTION_ANSWER,
                                      cached_rrset);
             answer_message->setRcode(Rcode::NOERROR());
+            counters_->inc(COUNTER_CACHE_HIT);
             callback->success(answer_message);
+            prefetchIfDue(*question);
         } else {
             // Message not found in cache, start recursive query.  It will
             // delete itself when it is done
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE, RESLIB_RECQ_CACHE_NO_FIND)
                       .arg(questionText(*question)).arg(1);
+            bundy::resolve::ResolverInterface::CallbackPtr query_callback(
+                callback);
+            if (joinInFlight(*question, answer_message, query_callback)) {
+                return (NULL);
+            }
             return (new RunningQuery(io, *question, answer_message,
-                                     test_server_, buffer, callback,
+                                     test_server_, nameserver_port_,
+                                     buffer, query_callback,
                                      query_timeout_, client_timeout_,
                                      lookup_timeout_, retries_, nsas_,
-                                     cache_, rtt_recorder_));
+                                     cache_, rtt_recorder_, false,
+                                     serve_stale_, counters_, socket_pool_));
         }
     }
     return (NULL);
@@ -1141,7 +1423,7 @@ RecursiveQuery::resolve(const Question& question,
     IOService& io = dns_service_.getIOService();
 
     bundy::resolve::ResolverInterface::CallbackPtr crs(
-        new bundy::resolve::ResolverCallbackServer(server));
+        new bundy::resolve::ResolverCallbackServer(server, latency_));
 
     // TODO: general 'prepareinitialanswer'
     answer_message->setOpcode(bundy::dns::Opcode::QUERY());
@@ -1160,7 +1442,9 @@ RecursiveQuery::resolve(const Question& question,
                   .arg(questionText(question)).arg(2);
         // TODO: err, should cache set rcode as well?
         answer_message->setRcode(Rcode::NOERROR());
+        counters_->inc(COUNTER_CACHE_HIT);
         crs->success(answer_message);
+        prefetchIfDue(question);
     } else {
         // Perhaps we only have the one RRset?
         // TODO: can we do this? should we check for specific types only?
@@ -1174,17 +1458,24 @@ RecursiveQuery::resolve(const Question& question,
             answer_message->addRRset(Message::SECTION_ANSWER,
                                      cached_rrset);
             answer_message->setRcode(Rcode::NOERROR());
+            counters_->inc(COUNTER_CACHE_HIT);
             crs->success(answer_message);
+            prefetchIfDue(question);
 
         } else {
             // Message not found in cache, start recursive query.  It will
             // delete itself when it is done
             LOG_DEBUG(bundy::resolve::logger, RESLIB_DBG_TRACE, RESLIB_RECQ_CACHE_NO_FIND)
                       .arg(questionText(question)).arg(2);
+            if (joinInFlight(question, answer_message, crs)) {
+                return (NULL);
+            }
             return (new RunningQuery(io, question, answer_message,
-                                     test_server_, buffer, crs, query_timeout_,
+                                     test_server_, nameserver_port_,
+                                     buffer, crs, query_timeout_,
                                      client_timeout_, lookup_timeout_, retries_,
-                                     nsas_, cache_, rtt_recorder_));
+                                     nsas_, cache_, rtt_recorder_, false,
+                                     serve_stale_, counters_, socket_pool_));
         }
     }
     return (NULL);
@@ -1204,7 +1495,8 @@ RecursiveQuery::forward(ConstMessagePtr query_message,
     IOService& io = dns_service_.getIOService();
 
     if (!callback) {
-        callback.reset(new bundy::resolve::ResolverCallbackServer(server));
+        callback.reset(new bundy::resolve::ResolverCallbackServer(server,
+                                                                  latency_));
     }
 
     // TODO: general 'prepareinitialanswer'
@@ -1218,7 +1510,8 @@ RecursiveQuery::forward(ConstMessagePtr query_message,
     // It will delete itself when it is done
     return (new ForwardQuery(io, query_message, answer_message,
                              upstream_, buffer, callback, query_timeout_,
-                             client_timeout_, lookup_timeout_));
+                             client_timeout_, lookup_timeout_,
+                             socket_pool_));
 }
 
 } // namespace asiodns
@@ -20,6 +20,11 @@
 #include <asiodns/dns_server.h>
 #include <nsas/nameserver_address_store.h>
 #include <cache/resolver_cache.h>
+#include <statistics/counter.h>
+#include <statistics/histogram.h>
+
+#include <set>
+#include <string>
 
 namespace bundy {
 namespace asiodns {
@@ -54,6 +59,13 @@ private:
 
 typedef std::vector<std::pair<std::string, uint16_t> > AddressVector;
 
+/// \brief Clients waiting for resolutions in progress
+///
+/// This is an internal class of \c RecursiveQuery, defined in the .cc file.
+class InFlightTable;
+
+class UpstreamSocketPool;
+
 /// \brief A Running query
 ///
 /// This base class represents an active running query object;
@@ -79,6 +91,23 @@ public:
 /// the ASIO code that carries out an upstream query.
 
 class RecursiveQuery {
+public:
+    /// \brief Types of the counters maintained by \c RecursiveQuery.
+    ///
+    /// The counters can be used for seeing how effective the prefetch and
+    /// serve-stale features are.  For example, the ratio of
+    /// \c COUNTER_PREFETCH_SUCCEEDED to \c COUNTER_CACHE_HIT shows how many
+    /// cache hits were accompanied by a successful background refresh.
+    enum CounterType {
+        COUNTER_CACHE_HIT = 0,      ///< Queries answered from the cache
+        COUNTER_PREFETCH_STARTED,   ///< Background refreshes started
+        COUNTER_PREFETCH_SUCCEEDED, ///< Background refreshes that got an answer
+        COUNTER_PREFETCH_FAILED,    ///< Background refreshes that failed
+        COUNTER_STALE_ANSWER,       ///< Queries answered with stale data
+        COUNTER_COALESCED,          ///< Queries joined to one in progress
+        COUNTER_TYPES               ///< The number of counter types
+    };
+
     ///
     /// \name Constructors
     ///
@@ -101,7 +130,9 @@ public:
     ///        to forward queries to.
     /// \param upstream_root Addresses and ports of the root servers
     ///        to use when resolving.
-    /// \param query_timeout Timeout value for queries we sent, in ms
+    /// \param query_timeout Timeout value for queries we sent, in ms.
+    ///        When resolving, the timeout for a query to a nameserver is
+    ///        adapted to the RTTs measured for it, and this is the maximum.
     /// \param client_timeout Timeout value for when we send back an
     ///        error, in ms
     /// \param lookup_timeout Timeout value for when we give up, in ms
@@ -128,12 +159,59 @@ public:
     /// \param recorder Pointer to the RTT recorder object used to hold RTTs.
     void setRttRecorder(boost::shared_ptr<RttRecorder>& recorder);
 
+    /// \brief Set the prefetch threshold
+    ///
+    /// If it's non 0, an answer found in the cache (see \c resolve())
+    /// whose remaining TTL is this percentage of the original TTL or less
+    /// triggers a background query for the same question, so the cache
+    /// is refreshed before the data expires.  Only one such query is
+    /// running for the same question at a time.  It's 0 (disabled) by
+    /// default.
+    ///
+    /// \throw bundy::InvalidParameter percent is larger than 100
+    ///
+    /// \param percent The threshold in percent of the original TTL.
+    void setPrefetchThreshold(unsigned int percent);
+
+    /// \brief Set the window for serving stale data
+    ///
+    /// If it's non 0, when a recursive query fails (e.g., the upstream
+    /// servers time out, are all considered unreachable, or answer with an
+    /// error) the cache is searched for the data that expired no longer
+    /// than \c seconds ago, and if it's found it's returned instead of
+    /// SERVFAIL, with a short TTL (RFC 8767).  It's 0 (disabled) by
+    /// default.
+    ///
+    /// This also sets the stale window of the cache, see
+    /// \c bundy::cache::ResolverCache::setStaleWindow().
+    ///
+    /// \param seconds The stale window in seconds.
+    void setServeStaleWindow(uint32_t seconds);
+
+    /// \brief Return the value of a counter
+    ///
+    /// \throw bundy::OutOfRange \c type is invalid
+    ///
+    /// \param type The counter to return.
+    bundy::statistics::Counter::Value getCounter(CounterType type) const;
+
+    /// \brief Return the histogram of the latencies of the answers
+    ///
+    /// It holds the time, in microseconds, from receiving each query from
+    /// a client (through the \c resolve() or \c forward() variants taking
+    /// a \c DNSServer) to answering it, whether from the cache or not.
+    const bundy::statistics::Histogram& getLatency() const;
+
     /// \brief Initiate resolving
     ///
     /// When sendQuery() is called, a (set of) message(s) is sent
     /// asynchronously. If upstream servers are set, one is chosen
     /// and the response (if any) from that server will be returned.
     ///
+    /// If the same question is already being resolved (for another
+    /// client), no new query is started; the callback is called with the
+    /// result of the one in progress instead.
+    ///
     /// If not upstream is set, a root server is chosen from the
     /// root_servers, and the RunningQuery shall do a full resolve
     /// (i.e. if the answer is a delegation, it will be followed, etc.)
@@ -168,7 +246,9 @@ public:
     ///         by the caller, but a pointer is returned for use-cases
     ///         such as unit tests.
     ///         Returns NULL if the data was found internally and no actual
-    ///         query was sent.
+    ///         query was sent, or the same question was already being
+    ///         resolved (in which case the answer will be copied from that
+    ///         one).
     AbstractRunningQuery* resolve(const bundy::dns::Question& question,
                           bundy::dns::MessagePtr answer_message,
                           bundy::util::OutputBufferPtr buffer,
@@ -208,7 +288,32 @@ public:
     /// \param port Port number of the test server
     void setTestServer(const std::string& address, uint16_t port);
 
+    /// \brief Set the port of the nameservers
+    ///
+    /// This method is only for testing and benchmarking, where the
+    /// nameservers of a fake hierarchy can't listen on the standard port.
+    /// Unlike \c setTestServer(), the queries are still sent to the
+    /// nameservers found through the NSAS; only the port is changed.  It
+    /// applies to the queries started afterwards.
+    ///
+    /// \param port Port number of the nameservers (53 by default).
+    void setNameserverPort(uint16_t port);
+
 private:
+    /// \brief Start a background refresh of the question if it's due
+    void prefetchIfDue(const bundy::dns::Question& question);
+
+    /// \brief Join the resolution of the same question in progress
+    ///
+    /// \return true if the question is being resolved; \c callback will be
+    /// called with the result, which is copied to \c answer_message.
+    /// false if it isn't; the question is registered as in progress, and
+    /// \c callback is replaced with one that also answers the clients
+    /// joining later.  It should be passed to the new \c RunningQuery.
+    bool joinInFlight(const bundy::dns::Question& question,
+                      bundy::dns::MessagePtr answer_message,
+                      bundy::resolve::ResolverInterface::CallbackPtr& callback);
+
     DNSServiceBase& dns_service_;
     bundy::nsas::NameserverAddressStore& nsas_;
     bundy::cache::ResolverCache& cache_;
@@ -217,11 +322,24 @@ private:
     boost::shared_ptr<std::vector<std::pair<std::string, uint16_t> > >
         upstream_root_;
     std::pair<std::string, uint16_t> test_server_;
+    uint16_t nameserver_port_;
     int query_timeout_;
     int client_timeout_;
     int lookup_timeout_;
     unsigned retries_;
     boost::shared_ptr<RttRecorder>  rtt_recorder_;  ///< Round-trip time recorder
+    unsigned int prefetch_threshold_;  ///< In percent of TTL, 0 if disabled
+    bool serve_stale_;                 ///< Whether stale data can be served
+    /// Counters, shared with running queries that may outlive this object
+    boost::shared_ptr<bundy::statistics::Counter> counters_;
+    /// Latencies of the answers to the clients, likewise shared
+    boost::shared_ptr<bundy::statistics::Histogram> latency_;
+    /// Questions being refreshed in the background
+    boost::shared_ptr<std::set<std::string> > prefetching_;
+    /// Clients waiting for the questions being resolved
+    boost::shared_ptr<InFlightTable> in_flight_;
+    /// Sockets shared by the queries to the upstream servers
+    boost::shared_ptr<UpstreamSocketPool> socket_pool_;
 };
 
 }      // namespace asiodns
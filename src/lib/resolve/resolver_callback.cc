@@ -22,7 +22,10 @@ ResolverCallbackServer::success(const bundy::dns::MessagePtr response)
 {
     // ignore our response here
     (void)response;
-    
+
+    if (latency_) {
+        latency_->record(statistics::getMicroseconds() - start_);
+    }
     server_->resume(true);
 }
 
@@ -20,6 +20,12 @@
 
 #include <resolve/resolver_interface.h>
 
+#include <statistics/histogram.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+
 namespace bundy {
 namespace resolve {
 
@@ -31,10 +37,18 @@ namespace resolve {
 ///
 /// This class will ignore the response MessagePtr in the callback,
 /// as the server itself should also have a reference.
+///
+/// If a histogram is given, the time from the creation of the callback to
+/// the answer (in microseconds) is recorded in it.
 class ResolverCallbackServer : public ResolverInterface::Callback {
 public:
-    ResolverCallbackServer(asiodns::DNSServer* server) :
-        server_(server->clone()) {}
+    ResolverCallbackServer(asiodns::DNSServer* server,
+                           const boost::shared_ptr<statistics::Histogram>&
+                           latency =
+                           boost::shared_ptr<statistics::Histogram>()) :
+        server_(server->clone()), latency_(latency),
+        start_(latency ? statistics::getMicroseconds() : 0)
+    {}
     ~ResolverCallbackServer() { delete server_; };
     
     void success(const bundy::dns::MessagePtr response);
@@ -42,6 +56,8 @@ public:
 
 private:
     asiodns::DNSServer* server_;
+    const boost::shared_ptr<statistics::Histogram> latency_;
+    const uint64_t start_;
 };
 
 } //namespace resolve
@@ -1000,6 +1000,163 @@ TEST_F(RecursiveQueryTest, CachedNS) {
         "It does not ask NSAS anything, how does it know where to send?";
 }
 
+// Test the cache hit counter, and that a cache hit starts a background
+// refresh only when it's due, and only one for the same question.
+TEST_F(RecursiveQueryTest, prefetch) {
+    setDNSService(true, true);
+    vector<pair<string, uint16_t> > roots;
+    roots.push_back(pair<string, uint16_t>("192.0.2.2", 53));
+    vector<pair<string, uint16_t> > upstream;
+    RecursiveQuery rq(*dns_service_, *nsas_, cache_, upstream, roots);
+    EXPECT_THROW(rq.setPrefetchThreshold(101), bundy::InvalidParameter);
+
+    // Prefill the cache with the answer.
+    const Question q(Name("www.example.org"), RRClass::IN(), RRType::A());
+    RRsetPtr answer_rrset(new RRset(q.getName(), q.getClass(), q.getType(),
+                                    RRTTL(300)));
+    answer_rrset->addRdata(rdata::in::A("192.0.2.1"));
+    ASSERT_TRUE(cache_.update(answer_rrset));
+
+    MockServer server(io_service_);
+    OutputBufferPtr buffer(new OutputBuffer(0));
+
+    // It's answered from the cache.  Prefetch is disabled by default.
+    EXPECT_EQ(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q, MessagePtr(new Message(Message::RENDER)), buffer,
+                         &server));
+    EXPECT_EQ(1, rq.getCounter(RecursiveQuery::COUNTER_CACHE_HIT));
+    EXPECT_EQ(0, rq.getCounter(RecursiveQuery::COUNTER_PREFETCH_STARTED));
+    // The answers from the cache count in the latency too
+    EXPECT_EQ(1, rq.getLatency().getSummary().count);
+
+    // The answer isn't in the last 10% of its TTL yet.
+    rq.setPrefetchThreshold(10);
+    rq.resolve(q, MessagePtr(new Message(Message::RENDER)), buffer, &server);
+    EXPECT_EQ(2, rq.getCounter(RecursiveQuery::COUNTER_CACHE_HIT));
+    EXPECT_EQ(0, rq.getCounter(RecursiveQuery::COUNTER_PREFETCH_STARTED));
+
+    // With a 100% threshold any hit is due for refresh.  The refreshing
+    // query asks NSAS for the root servers, which in turn asks the
+    // resolver.  While it's running another hit doesn't start a new one.
+    rq.setPrefetchThreshold(100);
+    EXPECT_EQ(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q, MessagePtr(new Message(Message::RENDER)), buffer,
+                         &server));
+    EXPECT_EQ(3, rq.getCounter(RecursiveQuery::COUNTER_CACHE_HIT));
+    EXPECT_EQ(1, rq.getCounter(RecursiveQuery::COUNTER_PREFETCH_STARTED));
+    EXPECT_NO_THROW(EXPECT_EQ(Name("."), (*resolver_)[0]->getName()));
+    rq.resolve(q, MessagePtr(new Message(Message::RENDER)), buffer, &server);
+    EXPECT_EQ(4, rq.getCounter(RecursiveQuery::COUNTER_CACHE_HIT));
+    EXPECT_EQ(1, rq.getCounter(RecursiveQuery::COUNTER_PREFETCH_STARTED));
+    EXPECT_EQ(0, rq.getCounter(RecursiveQuery::COUNTER_PREFETCH_SUCCEEDED));
+    EXPECT_EQ(0, rq.getCounter(RecursiveQuery::COUNTER_STALE_ANSWER));
+}
+
+// Callback recording the result of a resolution.
+class RecordingCallback : public bundy::resolve::ResolverInterface::Callback {
+public:
+    RecordingCallback() : failed_(false) {}
+    void success(const MessagePtr response) { response_ = response; }
+    void failure() { failed_ = true; }
+    MessagePtr response_;
+    bool failed_;
+};
+
+// Test that resolving the same question while it's being resolved joins
+// the resolution in progress instead of starting another one.
+TEST_F(RecursiveQueryTest, coalesce) {
+    setDNSService(true, true);
+    vector<pair<string, uint16_t> > roots;
+    roots.push_back(pair<string, uint16_t>("192.0.2.2", 53));
+    vector<pair<string, uint16_t> > upstream;
+    RecursiveQuery rq(*dns_service_, *nsas_, cache_, upstream, roots);
+
+    const QuestionPtr q(new Question(Name("www.example.org"), RRClass::IN(),
+                                      RRType::A()));
+    boost::shared_ptr<RecordingCallback> callback1(new RecordingCallback);
+    running_query_ = rq.resolve(q, callback1);
+    ASSERT_NE(static_cast<AbstractRunningQuery*>(NULL), running_query_);
+    // It asks NSAS for the root servers, which in turn asks the resolver.
+    EXPECT_EQ(1, resolver_->requests.size());
+
+    // The same question (names are case insensitive) joins it.
+    const QuestionPtr q2(new Question(Name("WWW.example.org"), RRClass::IN(),
+                                      RRType::A()));
+    boost::shared_ptr<RecordingCallback> callback2(new RecordingCallback);
+    EXPECT_EQ(static_cast<AbstractRunningQuery*>(NULL),
+              rq.resolve(q2, callback2));
+    EXPECT_EQ(1, rq.getCounter(RecursiveQuery::COUNTER_COALESCED));
+    EXPECT_EQ(1, resolver_->requests.size());
+
+    // A different one doesn't.
+    const QuestionPtr q3(new Question(Name("www.example.org"), RRClass::IN(),
+                                      RRType::AAAA()));
+    boost::shared_ptr<RecordingCallback> callback3(new RecordingCallback);
+    AbstractRunningQuery* running_query3 = rq.resolve(q3, callback3);
+    EXPECT_NE(static_cast<AbstractRunningQuery*>(NULL), running_query3);
+    EXPECT_EQ(1, rq.getCounter(RecursiveQuery::COUNTER_COALESCED));
+
+    // The root servers can't be found, so the first resolution is answered
+    // with SERVFAIL, and both of its clients get the answer.
+    resolver_->requests[0].second->failure();
+    ASSERT_TRUE(callback1->response_);
+    ASSERT_TRUE(callback2->response_);
+    EXPECT_NE(callback1->response_, callback2->response_);
+    EXPECT_EQ(Rcode::SERVFAIL(), callback1->response_->getRcode());
+    EXPECT_EQ(Rcode::SERVFAIL(), callback2->response_->getRcode());
+    EXPECT_FALSE(callback1->failed_);
+    EXPECT_FALSE(callback2->failed_);
+
+    // It's no longer in progress, so the next one starts a new resolution.
+    boost::shared_ptr<RecordingCallback> callback4(new RecordingCallback);
+    AbstractRunningQuery* running_query4 = rq.resolve(q, callback4);
+    EXPECT_NE(static_cast<AbstractRunningQuery*>(NULL), running_query4);
+    EXPECT_EQ(1, rq.getCounter(RecursiveQuery::COUNTER_COALESCED));
+    delete running_query3;
+    delete running_query4;
+}
+
+// Test that when the nameservers are all unreachable, stale data in the
+// cache is served (if enabled) instead of SERVFAIL.
+TEST_F(RecursiveQueryTest, staleAnswerOnUnreachable) {
+    setDNSService(true, true);
+    vector<pair<string, uint16_t> > roots;
+    roots.push_back(pair<string, uint16_t>("192.0.2.2", 53));
+    vector<pair<string, uint16_t> > upstream;
+    RecursiveQuery rq(*dns_service_, *nsas_, cache_, upstream, roots);
+    rq.setServeStaleWindow(60);
+
+    // The cached answer has already expired (TTL 0), so it's resolved
+    // again.
+    const QuestionPtr q(new Question(Name("www.example.org"), RRClass::IN(),
+                                     RRType::A()));
+    RRsetPtr answer_rrset(new RRset(q->getName(), q->getClass(),
+                                    q->getType(), RRTTL(0)));
+    answer_rrset->addRdata(rdata::in::A("192.0.2.1"));
+    Message cached_message(Message::RENDER);
+    bundy::resolve::initResponseMessage(*q, cached_message);
+    cached_message.setRcode(Rcode::NOERROR());
+    cached_message.addRRset(Message::SECTION_ANSWER, answer_rrset);
+    ASSERT_TRUE(cache_.update(cached_message));
+    boost::shared_ptr<RecordingCallback> callback(new RecordingCallback);
+    running_query_ = rq.resolve(q, callback);
+    ASSERT_NE(static_cast<AbstractRunningQuery*>(NULL), running_query_);
+    EXPECT_EQ(1, resolver_->requests.size());
+
+    // The root servers can't be found, so NSAS reports them unreachable,
+    // and the expired answer is used.
+    resolver_->requests[0].second->failure();
+    ASSERT_TRUE(callback->response_);
+    EXPECT_FALSE(callback->failed_);
+    EXPECT_EQ(Rcode::NOERROR(), callback->response_->getRcode());
+    ASSERT_EQ(1, callback->response_->getRRCount(Message::SECTION_ANSWER));
+    const ConstRRsetPtr stale_rrset =
+        *callback->response_->beginSection(Message::SECTION_ANSWER);
+    EXPECT_EQ(q->getName(), stale_rrset->getName());
+    EXPECT_EQ(RRTTL(STALE_RRSET_TTL), stale_rrset->getTTL());
+    EXPECT_EQ(1, rq.getCounter(RecursiveQuery::COUNTER_STALE_ANSWER));
+}
+
 // TODO: add tests that check whether the cache is updated on succesfull
 // responses, and not updated on failures.
 
@@ -17,6 +17,7 @@
 #include <resolve/resolver_callback.h>
 
 using namespace bundy::resolve;
+using bundy::statistics::Histogram;
 
 // Dummy subclass for DNSServer*
 // We want to check if resume is called
@@ -88,3 +89,18 @@ TEST_F(ResolverCallbackServerTest, testFailure) {
     EXPECT_TRUE(getResumeCalled());
     EXPECT_FALSE(getResumeValue());
 }
+
+TEST_F(ResolverCallbackServerTest, latency) {
+    const boost::shared_ptr<Histogram> latency(new Histogram());
+    bool resume_called = false;
+    bool resume_value = false;
+    DummyServer server(&resume_called, &resume_value);
+
+    // Only the answers are recorded
+    ResolverCallbackServer(&server, latency).failure();
+    EXPECT_EQ(0, latency->getSummary().count);
+    ResolverCallbackServer(&server, latency).success(
+        bundy::dns::MessagePtr());
+    EXPECT_TRUE(resume_value);
+    EXPECT_EQ(1, latency->getSummary().count);
+}
@@ -89,7 +89,8 @@ bundy::data::ConstElementPtr
 createRequestSocketMessage(SocketRequestor::Protocol protocol,
                            const std::string& address, uint16_t port,
                            SocketRequestor::ShareMode share_mode,
-                           const std::string& share_name)
+                           const std::string& share_name,
+                           unsigned int instance)
 {
     const bundy::data::ElementPtr request = bundy::data::Element::createMap();
     request->set("address", bundy::data::Element::create(address));
@@ -113,6 +114,15 @@ createRequestSocketMessage(SocketRequestor::Protocol protocol,
         bundy_throw(InvalidParameter, "invalid share mode: " << share_mode);
     }
     request->set("share_name", bundy::data::Element::create(share_name));
+    // Only sent when needed, the default is 0
+    if (instance != 0) {
+        if (protocol != SocketRequestor::UDP) {
+            bundy_throw(InvalidParameter,
+                        "only UDP sockets can have multiple instances");
+        }
+        request->set("instance", bundy::data::Element::create(
+                         static_cast<long int>(instance)));
+    }
 
     return (bundy::config::createCommand(REQUEST_SOCKET_COMMAND(), request));
 }
@@ -292,13 +302,14 @@ public:
     virtual SocketID requestSocket(Protocol protocol,
                                    const std::string& address,
                                    uint16_t port, ShareMode share_mode,
-                                   const std::string& share_name)
+                                   const std::string& share_name,
+                                   unsigned int instance)
     {
         const bundy::data::ConstElementPtr request_msg =
             createRequestSocketMessage(protocol, address, port,
                                        share_mode,
                                        share_name.empty() ? app_name_ :
-                                       share_name);
+                                       share_name, instance);
 
         // Send it to bundy-init
         const int seq = session_.group_sendmsg(request_msg, "Init");
@@ -172,6 +172,13 @@ public:
     ///     debugging) and you need to provide one with SHARE_SAME (to know
     ///     what is same) and SHARE_ANY (someone else might want SHARE_SAME,
     ///     so it would check against this)
+    /// \param instance requests for different instances get different
+    ///     sockets, all bound to the given address and port, so an
+    ///     application can have a socket for each of its threads and let
+    ///     the kernel distribute the packets among them.  The sockets are
+    ///     still created by the privileged socket creator.  Only UDP sockets
+    ///     can have another instance than 0, and only on systems supporting
+    ///     SO_REUSEPORT.
     /// \return the socket, as a file descriptor and token representing it on
     ///     the socket creator side.
     ///
@@ -186,7 +193,8 @@ public:
     ///   applications who provided SHARE_SAME also provided the same
     ///   share_name as this process did.
     ///
-    /// \throw InvalidParameter protocol or share_mode is invalid
+    /// \throw InvalidParameter protocol or share_mode is invalid, or a TCP
+    ///     socket is requested with another instance than 0
     /// \throw CCSessionError when we have a problem talking over the CC
     ///     session.
     /// \throw SocketError in case we have some other problems receiving the
@@ -199,7 +207,8 @@ public:
     virtual SocketID requestSocket(Protocol protocol,
                                    const std::string& address,
                                    uint16_t port, ShareMode share_mode,
-                                   const std::string& share_name = "") = 0;
+                                   const std::string& share_name = "",
+                                   unsigned int instance = 0) = 0;
 
     /// \brief Tell the socket creator we no longer need the socket
     ///
@@ -59,7 +59,8 @@ TEST(SocketRequestorAccess, initialized) {
         DummyRequestor() : SocketRequestor() {}
         virtual void releaseSocket(const std::string&) {}
         virtual SocketID requestSocket(Protocol, const std::string&, uint16_t,
-                                       ShareMode, const std::string&)
+                                       ShareMode, const std::string&,
+                                       unsigned int)
         {
             return (SocketID(0, "")); // Just to silence warnings
         }
@@ -130,7 +131,8 @@ createExpectedRequest(const std::string& address,
                       int port,
                       const std::string& protocol,
                       const std::string& share_mode,
-                      const std::string& share_name)
+                      const std::string& share_name,
+                      unsigned int instance = 0)
 {
     // create command arguments
     const ElementPtr command_args = Element::createMap();
@@ -139,6 +141,10 @@ createExpectedRequest(const std::string& address,
     command_args->set("protocol", Element::create(protocol));
     command_args->set("share_mode", Element::create(share_mode));
     command_args->set("share_name", Element::create(share_name));
+    if (instance != 0) {
+        command_args->set("instance",
+                          Element::create(static_cast<long int>(instance)));
+    }
 
     // create the envelope
     const ElementPtr packet = Element::createList();
@@ -190,6 +196,18 @@ TEST_F(SocketRequestorTest, testSocketRequestMessages) {
     ASSERT_EQ(1, session.getMsgQueue()->size());
     EXPECT_EQ(*expected_request, *(session.getMsgQueue()->get(0)));
 
+    // Another instance of the socket
+    clearMsgQueue();
+    expected_request = createExpectedRequest("::1", 2, "UDP",
+                                             "SAMEAPP", "test3", 2);
+    EXPECT_THROW(socketRequestor().requestSocket(SocketRequestor::UDP,
+                                                 "::1", 2,
+                                                 SocketRequestor::SHARE_SAME,
+                                                 "test3", 2),
+                 CCSessionError);
+    ASSERT_EQ(1, session.getMsgQueue()->size());
+    EXPECT_EQ(*expected_request, *(session.getMsgQueue()->get(0)));
+
     // A default share name equal to the app name passed on construction
     clearMsgQueue();
     expected_request = createExpectedRequest("::1", 2, "UDP",
@@ -218,6 +236,14 @@ TEST_F(SocketRequestorTest, invalidParameterForSocketRequest) {
                                static_cast<SocketRequestor::ShareMode>(3),
                                "test"),
                  InvalidParameter);
+
+    // Only UDP sockets can have multiple instances
+    EXPECT_THROW(socketRequestor().
+                 requestSocket(SocketRequestor::TCP,
+                               "192.0.2.1", 12345,
+                               SocketRequestor::SHARE_SAME,
+                               "test", 1),
+                 InvalidParameter);
 }
 
 TEST_F(SocketRequestorTest, testBadRequestAnswers) {
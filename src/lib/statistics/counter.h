@@ -20,20 +20,172 @@
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <atomic>
+#include <new>
 #include <vector>
 
+#include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 namespace bundy {
 namespace statistics {
 
+namespace detail {
+
+/// \brief The number of threads that get their own slot in each counter.
+///
+/// Any further threads share one slot, protected by a mutex.
+const size_t COUNTER_THREAD_SLOTS = 64;
+
+/// \brief The size (and alignment) of the blocks the slots are made of.
+///
+/// It's the cache line size of the common platforms, so the slots of two
+/// threads never share a line.
+const size_t COUNTER_CACHE_LINE = 64;
+
+// Guards the table of the thread indices in use.
+inline pthread_mutex_t&
+getCounterIndexMutex() {
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    return (mutex);
+}
+
+inline bool*
+getCounterIndexTable() {
+    static bool used[COUNTER_THREAD_SLOTS];
+    return (used);
+}
+
+// Called when a thread exits; the index can be given to a new thread.  The
+// slots of the index keep their values, so nothing counted is lost.
+extern "C" inline void
+releaseCounterThreadIndex(void* value) {
+    const size_t index = reinterpret_cast<uintptr_t>(value) - 1;
+    if (index < COUNTER_THREAD_SLOTS) {
+        pthread_mutex_lock(&getCounterIndexMutex());
+        getCounterIndexTable()[index] = false;
+        pthread_mutex_unlock(&getCounterIndexMutex());
+    }
+}
+
+inline pthread_key_t&
+getCounterThreadKey() {
+    static pthread_key_t key;
+    return (key);
+}
+
+extern "C" inline void
+createCounterThreadKey() {
+    if (pthread_key_create(&getCounterThreadKey(),
+                           releaseCounterThreadIndex) != 0) {
+        // Without the key the indices couldn't be released, so every
+        // thread uses the shared slot (see getCounterThreadIndex()).
+        getCounterThreadKey() = static_cast<pthread_key_t>(-1);
+    }
+}
+
+// The index + 1 of the slots of the calling thread, 0 until assigned.
+// The key is only used to release the index when the thread exits; this
+// is what's read on each increment.
+inline size_t&
+getCounterThreadIndexCache() {
+    static thread_local size_t thread_index = 0;
+    return (thread_index);
+}
+
+// Assign an index to the calling thread; see getCounterThreadIndex().
+inline size_t
+assignCounterThreadIndex() {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, createCounterThreadKey);
+    const pthread_key_t key = getCounterThreadKey();
+    size_t index = COUNTER_THREAD_SLOTS;
+    if (key != static_cast<pthread_key_t>(-1)) {
+        pthread_mutex_lock(&getCounterIndexMutex());
+        bool* used = getCounterIndexTable();
+        for (size_t i = 0; i < COUNTER_THREAD_SLOTS; ++i) {
+            if (!used[i]) {
+                used[i] = true;
+                index = i;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&getCounterIndexMutex());
+        if (index < COUNTER_THREAD_SLOTS &&
+            pthread_setspecific(key, reinterpret_cast<void*>(index + 1)) !=
+            0) {
+            releaseCounterThreadIndex(reinterpret_cast<void*>(index + 1));
+            index = COUNTER_THREAD_SLOTS;
+        }
+    }
+    getCounterThreadIndexCache() = index + 1;
+    return (index);
+}
+
+/// \brief Return the index of the slots of the calling thread.
+///
+/// The index is assigned on the first call from each thread, and it is
+/// less than \c COUNTER_THREAD_SLOTS unless there are more threads than
+/// that (then it's \c COUNTER_THREAD_SLOTS).  No two running threads have
+/// the same index (except the overflowing ones), and a thread has the same
+/// index in all the counters.
+inline size_t
+getCounterThreadIndex() {
+    const size_t thread_index = getCounterThreadIndexCache();
+    if (thread_index != 0) {
+        return (thread_index - 1);
+    }
+    return (assignCounterThreadIndex());
+}
+
+// Holds a mutex for the duration of a scope.
+class CounterLocker : boost::noncopyable {
+public:
+    explicit CounterLocker(pthread_mutex_t& mutex) : mutex_(mutex) {
+        pthread_mutex_lock(&mutex_);
+    }
+    ~CounterLocker() {
+        pthread_mutex_unlock(&mutex_);
+    }
+private:
+    pthread_mutex_t& mutex_;
+};
+
+} // namespace detail
+
+/// \brief A set of counters which can be incremented from multiple threads.
+///
+/// Each thread increments its own copy of the counters (a slot), so
+/// \c inc() takes no lock and uses no atomic read-modify-write operation.
+/// The values are atomic, read and written with relaxed ordering, so
+/// \c get() and \c snapshot() can read them while they're incremented;
+/// on the common platforms these are plain loads and stores.  The slots are
+/// allocated on the first increment from each thread and padded to whole
+/// cache lines, so threads don't slow each other down by writing to the
+/// same line (false sharing).  \c get() and \c snapshot() sum the slots
+/// when the values are read, which is assumed to be much less frequent.
+///
+/// The values read while other threads are incrementing may miss the
+/// increments in progress, but each of them is never lower than a value
+/// read before.
 class Counter : boost::noncopyable {
 public:
     typedef unsigned int Type;
     typedef uint64_t Value;
 
 private:
-    std::vector<Counter::Value> counters_;
+    typedef std::atomic<Value> AtomicValue;
+
+    const size_t items_;
+    // The number of values in each slot, rounded up to whole cache lines
+    const size_t stride_;
+    // The slots of the threads, by the thread index; NULL until used
+    AtomicValue* slots_[detail::COUNTER_THREAD_SLOTS];
+    // The slot shared by the threads not having their own, under mutex_
+    std::vector<Counter::Value> overflow_;
+    // Protects slots_ (but not the values in them) and overflow_
+    mutable pthread_mutex_t mutex_;
 
 public:
     /// The constructor.
@@ -45,36 +197,120 @@ public:
     ///
     /// \throw bundy::InvalidParameter \a items is 0
     explicit Counter(const size_t items) :
-        counters_(items, 0)
+        items_(items),
+        stride_((items * sizeof(AtomicValue) +
+                 detail::COUNTER_CACHE_LINE - 1) /
+                detail::COUNTER_CACHE_LINE * detail::COUNTER_CACHE_LINE /
+                sizeof(AtomicValue)),
+        overflow_(items, 0)
     {
         if (items == 0) {
             bundy_throw(bundy::InvalidParameter, "Items must not be 0");
         }
+        for (size_t i = 0; i < detail::COUNTER_THREAD_SLOTS; ++i) {
+            slots_[i] = NULL;
+        }
+        pthread_mutex_init(&mutex_, NULL);
+    }
+
+    /// The destructor.
+    ~Counter() {
+        for (size_t i = 0; i < detail::COUNTER_THREAD_SLOTS; ++i) {
+            free(slots_[i]);
+        }
+        pthread_mutex_destroy(&mutex_);
     }
 
     /// \brief Increment a counter item specified with \a type.
     ///
+    /// This may be called from any thread.
+    ///
     /// \param type %Counter item to increment
     ///
     /// \throw bundy::OutOfRange \a type is invalid
+    /// \throw std::bad_alloc the slot of the calling thread can't be
+    ///     allocated (on its first increment)
     void inc(const Counter::Type& type) {
-        if (type >= counters_.size()) {
+        if (type >= items_) {
             bundy_throw(bundy::OutOfRange, "Counter type is out of range");
         }
-        ++counters_.at(type);
+        const size_t index = detail::getCounterThreadIndex();
+        if (index < detail::COUNTER_THREAD_SLOTS) {
+            // Only this thread sets its own slot, so no lock to read it
+            AtomicValue* slot = slots_[index];
+            if (slot == NULL) {
+                slot = allocateSlot(index);
+            }
+            // ... and only this thread writes the values in it, so no
+            // read-modify-write is needed
+            slot[type].store(slot[type].load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+        } else {
+            detail::CounterLocker locker(mutex_);
+            ++overflow_[type];
+        }
         return;
     }
 
     /// \brief Get the value of a counter item specified with \a type.
     ///
+    /// The value is the sum over all the threads.
+    ///
     /// \param type %Counter item to get the value of
     ///
     /// \throw bundy::OutOfRange \a type is invalid
-    const Counter::Value& get(const Counter::Type& type) const {
-        if (type >= counters_.size()) {
+    Counter::Value get(const Counter::Type& type) const {
+        if (type >= items_) {
             bundy_throw(bundy::OutOfRange, "Counter type is out of range");
         }
-        return (counters_.at(type));
+        detail::CounterLocker locker(mutex_);
+        Value value = overflow_[type];
+        for (size_t i = 0; i < detail::COUNTER_THREAD_SLOTS; ++i) {
+            if (slots_[i] != NULL) {
+                value += slots_[i][type].load(std::memory_order_relaxed);
+            }
+        }
+        return (value);
+    }
+
+    /// \brief Get the values of all the counter items at once.
+    ///
+    /// This sums the slots in a single pass, so the values are taken at
+    /// (nearly) the same time.  Use this rather than a series of \c get()
+    /// calls when the values are reported together and should be coherent
+    /// with each other.
+    ///
+    /// \return The values, indexed by the counter item.
+    std::vector<Counter::Value> snapshot() const {
+        detail::CounterLocker locker(mutex_);
+        std::vector<Value> values(overflow_);
+        for (size_t i = 0; i < detail::COUNTER_THREAD_SLOTS; ++i) {
+            if (slots_[i] != NULL) {
+                const AtomicValue* slot = slots_[i];
+                for (size_t j = 0; j < items_; ++j) {
+                    values[j] += slot[j].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        return (values);
+    }
+
+private:
+    AtomicValue* allocateSlot(size_t index) {
+        void* memory = NULL;
+        if (posix_memalign(&memory, detail::COUNTER_CACHE_LINE,
+                           stride_ * sizeof(AtomicValue)) != 0) {
+            throw std::bad_alloc();
+        }
+        // The values are trivially destructible, so free() is enough to
+        // release them
+        AtomicValue* slot = static_cast<AtomicValue*>(memory);
+        for (size_t i = 0; i < stride_; ++i) {
+            new(&slot[i]) AtomicValue(0);
+        }
+        detail::CounterLocker locker(mutex_);
+        slots_[index] = slot;
+        return (slot);
     }
 };
 
@@ -0,0 +1,198 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H 1
+
+#include <statistics/counter.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+
+#include <stdint.h>
+#include <time.h>
+
+namespace bundy {
+namespace statistics {
+
+/// \brief Return the current time in microseconds.
+///
+/// This is the clock the latencies recorded in a \c Histogram are expected
+/// to be measured with; only the differences are meaningful.  It's the
+/// monotonic clock, so setting the system time doesn't distort them.
+inline uint64_t
+getMicroseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+}
+
+/// \brief The number of buckets of a \c Histogram.
+const size_t HISTOGRAM_BUCKETS = 125;
+
+/// \brief A histogram of values on a logarithmic scale.
+///
+/// This is meant for latencies (typically in microseconds), for which the
+/// percentiles tell much more than an average: a few slow responses can
+/// matter while hardly changing the average.
+///
+/// The buckets are fixed.  Each power of two is split into 4 buckets of
+/// equal width, so a value is known within 25% of its magnitude over the
+/// whole range, with a small, constant number of buckets.  The values 0 to
+/// 3 have a bucket each, and all the values from 2^32 up share the last
+/// one.
+///
+/// The buckets are a \c Counter, so the values may be recorded from
+/// multiple threads without a lock, and read at any time.
+class Histogram : boost::noncopyable {
+public:
+    typedef Counter::Value Value;
+
+    /// \brief The percentiles of the recorded values.
+    ///
+    /// Each percentile is the largest value of the bucket where it falls,
+    /// so the real percentile isn't higher.  They are all 0 if nothing
+    /// was recorded.
+    struct Summary {
+        Value count;   ///< The number of recorded values
+        uint64_t p50;  ///< The median
+        uint64_t p90;  ///< The 90th percentile
+        uint64_t p99;  ///< The 99th percentile
+        uint64_t p999; ///< The 99.9th percentile
+    };
+
+    /// \brief The constructor.
+    ///
+    /// All the buckets are empty.
+    Histogram() : buckets_(HISTOGRAM_BUCKETS) {}
+
+    /// \brief Record a value.
+    ///
+    /// This may be called from any thread.
+    ///
+    /// \throw std::bad_alloc on the first call from a thread, see
+    ///     \c Counter::inc().
+    void record(uint64_t value) {
+        buckets_.inc(getBucket(value));
+    }
+
+    /// \brief Get the number of values in each bucket.
+    ///
+    /// \return The numbers, indexed by the bucket.
+    std::vector<Value> snapshot() const {
+        return (buckets_.snapshot());
+    }
+
+    /// \brief Get the summary of the recorded values.
+    ///
+    /// All the percentiles are computed from the same snapshot.
+    Summary getSummary() const {
+        const std::vector<Value> buckets = snapshot();
+        Summary summary;
+        summary.count = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            summary.count += buckets[i];
+        }
+        summary.p50 = getPercentile(buckets, 50);
+        summary.p90 = getPercentile(buckets, 90);
+        summary.p99 = getPercentile(buckets, 99);
+        summary.p999 = getPercentile(buckets, 99.9);
+        return (summary);
+    }
+
+    /// \brief Return the bucket of a value.
+    static size_t getBucket(uint64_t value) {
+        if (value < 4) {
+            return (value);
+        }
+        if ((value >> 32) != 0) {
+            return (HISTOGRAM_BUCKETS - 1);
+        }
+        // The position of the highest bit set, then the next two bits
+        size_t high = 2;
+        while ((value >> (high + 1)) != 0) {
+            ++high;
+        }
+        return ((high - 1) * 4 + ((value >> (high - 2)) & 3));
+    }
+
+    /// \brief Return the smallest value in a bucket.
+    ///
+    /// \throw bundy::OutOfRange \a bucket is invalid
+    static uint64_t getBucketMin(size_t bucket) {
+        if (bucket >= HISTOGRAM_BUCKETS) {
+            bundy_throw(bundy::OutOfRange, "Histogram bucket is out of range");
+        }
+        if (bucket < 4) {
+            return (bucket);
+        }
+        if (bucket == HISTOGRAM_BUCKETS - 1) {
+            return (static_cast<uint64_t>(1) << 32);
+        }
+        return (static_cast<uint64_t>(4 + bucket % 4) << (bucket / 4 - 1));
+    }
+
+    /// \brief Return the largest value in a bucket.
+    ///
+    /// For the last bucket, which is open ended, this is its smallest
+    /// value.
+    ///
+    /// \throw bundy::OutOfRange \a bucket is invalid
+    static uint64_t getBucketMax(size_t bucket) {
+        if (bucket >= HISTOGRAM_BUCKETS - 1) {
+            return (getBucketMin(bucket));
+        }
+        return (getBucketMin(bucket + 1) - 1);
+    }
+
+    /// \brief Compute a percentile from the numbers in the buckets.
+    ///
+    /// \param buckets The numbers, as returned by \c snapshot().
+    /// \param percentile The percentile, from 0 to 100.
+    /// \return The largest value in the bucket where the percentile falls,
+    ///     or 0 if the buckets are all empty.
+    static uint64_t getPercentile(const std::vector<Value>& buckets,
+                                  double percentile)
+    {
+        Value count = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            count += buckets[i];
+        }
+        if (count == 0) {
+            return (0);
+        }
+        // The rank of the value, from 1 to count
+        Value rank = static_cast<Value>(percentile * count / 100);
+        if (rank * 100 < percentile * count || rank == 0) {
+            ++rank;
+        }
+        Value seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return (getBucketMax(i));
+            }
+        }
+        return (getBucketMax(buckets.size() - 1));
+    }
+
+private:
+    Counter buckets_;
+};
+
+}   // namespace statistics
+}   // namespace bundy
+
+#endif // HISTOGRAM_H
@@ -16,6 +16,12 @@
 #include <gtest/gtest.h>
 
 #include <statistics/counter.h>
+#include <util/threads/thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
 
 namespace {
 enum CounterItems {
@@ -27,6 +33,7 @@ enum CounterItems {
 }
 
 using namespace bundy::statistics;
+using bundy::util::thread::Thread;
 
 TEST(CounterCreateTest, invalidCounterSize) {
     // Creating counter with 0 elements will cause an bundy::InvalidParameter
@@ -88,3 +95,55 @@ TEST_F(CounterTest, invalidCounterItem) {
     // exception
     EXPECT_THROW(counter.get(NUMBER_OF_ITEMS), bundy::OutOfRange);
 }
+
+TEST_F(CounterTest, snapshot) {
+    counter.inc(ITEM1);
+    counter.inc(ITEM3);
+    counter.inc(ITEM3);
+    const std::vector<Counter::Value> values = counter.snapshot();
+    ASSERT_EQ(NUMBER_OF_ITEMS, values.size());
+    EXPECT_EQ(1, values[ITEM1]);
+    EXPECT_EQ(0, values[ITEM2]);
+    EXPECT_EQ(2, values[ITEM3]);
+}
+
+namespace {
+void
+incrementMany(Counter* counter, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        counter->inc(ITEM1);
+        counter->inc(ITEM3);
+    }
+}
+}
+
+TEST_F(CounterTest, incrementFromThreads) {
+    // More threads than the slots, so some of them share the overflow one
+    const size_t thread_count = 80;
+    const size_t count = 10000;
+    counter.inc(ITEM2);
+
+    std::vector<boost::shared_ptr<Thread> > threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.push_back(boost::shared_ptr<Thread>(
+            new Thread(boost::bind(incrementMany, &counter, count))));
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        // Reading while the others increment works, and the values don't
+        // go backwards
+        const std::vector<Counter::Value> values = counter.snapshot();
+        threads[i]->wait();
+        EXPECT_LE(values[ITEM1], counter.get(ITEM1));
+    }
+
+    // Nothing is lost, even from the threads that exited
+    EXPECT_EQ(thread_count * count, counter.get(ITEM1));
+    EXPECT_EQ(1, counter.get(ITEM2));
+    EXPECT_EQ(thread_count * count, counter.get(ITEM3));
+
+    // The indices of the exited threads are reused
+    threads.clear();
+    Thread thread(boost::bind(incrementMany, &counter, count));
+    thread.wait();
+    EXPECT_EQ((thread_count + 1) * count, counter.snapshot()[ITEM1]);
+}
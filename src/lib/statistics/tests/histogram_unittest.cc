@@ -0,0 +1,110 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <config.h>
+#include <gtest/gtest.h>
+
+#include <statistics/histogram.h>
+
+#include <vector>
+
+using namespace bundy::statistics;
+
+namespace {
+
+TEST(HistogramTest, buckets) {
+    // The small values are exact
+    for (uint64_t value = 0; value < 4; ++value) {
+        EXPECT_EQ(value, Histogram::getBucket(value));
+        EXPECT_EQ(value, Histogram::getBucketMin(value));
+        EXPECT_EQ(value, Histogram::getBucketMax(value));
+    }
+    // Then 4 buckets per power of two
+    EXPECT_EQ(4, Histogram::getBucket(4));
+    EXPECT_EQ(7, Histogram::getBucket(7));
+    EXPECT_EQ(8, Histogram::getBucket(8));
+    EXPECT_EQ(8, Histogram::getBucket(9));
+    EXPECT_EQ(9, Histogram::getBucket(10));
+    EXPECT_EQ(11, Histogram::getBucket(15));
+    EXPECT_EQ(12, Histogram::getBucket(16));
+    EXPECT_EQ(HISTOGRAM_BUCKETS - 2, Histogram::getBucket(0xffffffff));
+    // Anything larger goes to the last one
+    EXPECT_EQ(HISTOGRAM_BUCKETS - 1, Histogram::getBucket(0x100000000ULL));
+    EXPECT_EQ(HISTOGRAM_BUCKETS - 1,
+              Histogram::getBucket(0xffffffffffffffffULL));
+    EXPECT_EQ(0x100000000ULL, Histogram::getBucketMax(HISTOGRAM_BUCKETS - 1));
+
+    // The buckets are contiguous, and each value falls in its bucket
+    for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS - 1; ++bucket) {
+        const uint64_t min = Histogram::getBucketMin(bucket);
+        const uint64_t max = Histogram::getBucketMax(bucket);
+        EXPECT_LE(min, max);
+        EXPECT_EQ(max + 1, Histogram::getBucketMin(bucket + 1));
+        EXPECT_EQ(bucket, Histogram::getBucket(min));
+        EXPECT_EQ(bucket, Histogram::getBucket(max));
+        // The width is at most a quarter of the values
+        EXPECT_LE((max - min) * 4, min);
+    }
+
+    EXPECT_THROW(Histogram::getBucketMin(HISTOGRAM_BUCKETS),
+                 bundy::OutOfRange);
+}
+
+TEST(HistogramTest, emptySummary) {
+    Histogram histogram;
+    const Histogram::Summary summary = histogram.getSummary();
+    EXPECT_EQ(0, summary.count);
+    EXPECT_EQ(0, summary.p50);
+    EXPECT_EQ(0, summary.p90);
+    EXPECT_EQ(0, summary.p99);
+    EXPECT_EQ(0, summary.p999);
+}
+
+TEST(HistogramTest, percentiles) {
+    Histogram histogram;
+    // 1000 values: 899 of 2, 90 of 100, 10 of 1000 and 1 of 100000
+    for (size_t i = 0; i < 899; ++i) {
+        histogram.record(2);
+    }
+    for (size_t i = 0; i < 90; ++i) {
+        histogram.record(100);
+    }
+    for (size_t i = 0; i < 10; ++i) {
+        histogram.record(1000);
+    }
+    histogram.record(100000);
+
+    const std::vector<Histogram::Value> buckets = histogram.snapshot();
+    ASSERT_EQ(HISTOGRAM_BUCKETS, buckets.size());
+    EXPECT_EQ(899, buckets[Histogram::getBucket(2)]);
+    EXPECT_EQ(90, buckets[Histogram::getBucket(100)]);
+
+    const Histogram::Summary summary = histogram.getSummary();
+    EXPECT_EQ(1000, summary.count);
+    EXPECT_EQ(2, summary.p50);
+    // The 900th value is the first 100
+    EXPECT_EQ(Histogram::getBucketMax(Histogram::getBucket(100)),
+              summary.p90);
+    // The 990th is the first 1000, the 999th the last one
+    EXPECT_EQ(Histogram::getBucketMax(Histogram::getBucket(1000)),
+              summary.p99);
+    EXPECT_EQ(Histogram::getBucketMax(Histogram::getBucket(1000)),
+              summary.p999);
+
+    EXPECT_EQ(Histogram::getBucketMax(Histogram::getBucket(100000)),
+              Histogram::getPercentile(buckets, 100));
+    EXPECT_EQ(2, Histogram::getPercentile(buckets, 0));
+}
+
+}
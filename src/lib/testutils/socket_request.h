@@ -95,6 +95,9 @@ public:
     ///
     /// They are stored here by this class and you can examine them.
     std::vector<std::string> given_tokens_;
+
+    /// \brief Instances requested by requestSocket, in the same order
+    std::vector<unsigned int> given_instances_;
 private:
     // Last token number and fd given out
     size_t last_token_;
@@ -147,13 +150,14 @@ public:
     ///      on the fallback (wants to use the app_name instead of providing
     ///      its own share name), you need to create this class with empty
     ///      expected_app.
+    /// \param instance recorded in given_instances_
     /// \return The token and FD
     /// \throw SocketAllocateError as described above, to test error handling
     /// \throw ShareError as described above, to test error handling
     /// \throw SocketError as described above, to test error handling
     SocketID requestSocket(Protocol protocol, const std::string& address,
                            uint16_t port, ShareMode mode,
-                           const std::string& name)
+                           const std::string& name, unsigned int instance)
     {
         if (address == "192.0.2.2") {
             bundy_throw(SocketAllocateError, "This address is not allowed");
@@ -179,6 +183,7 @@ public:
                                 boost::lexical_cast<std::string>(port) + ":" +
                                 boost::lexical_cast<std::string>(number));
         given_tokens_.push_back(token);
+        given_instances_.push_back(instance);
         return (SocketID(number, token));
     }
 
@@ -0,0 +1,134 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/arena.h>
+
+#include <cassert>
+
+namespace bundy {
+namespace util {
+
+namespace {
+// Allocations are aligned to this (which is enough for any fundamental
+// type on the supported platforms).  The chunks themselves come from
+// operator new, which returns memory aligned at least this strictly.
+const size_t ALIGNMENT = 16;
+
+// The arena of each thread, set by Arena::Scope.
+thread_local Arena* current_arena = NULL;
+}
+
+const size_t Arena::DEFAULT_CHUNK_SIZE;
+
+Arena::Arena(size_t chunk_size) :
+    chunk_size_(chunk_size), current_(0), used_(0), live_count_(0),
+    destroyed_(false)
+{}
+
+Arena::~Arena() {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        delete[] chunks_[i];
+    }
+    releaseLargeChunks();
+}
+
+void
+Arena::releaseLargeChunks() {
+    for (size_t i = 0; i < large_chunks_.size(); ++i) {
+        delete[] large_chunks_[i];
+    }
+    large_chunks_.clear();
+}
+
+Arena*
+Arena::create(size_t chunk_size) {
+    return (new Arena(chunk_size));
+}
+
+void
+Arena::destroy(Arena* arena) {
+    assert(current_arena != arena);
+    if (arena->live_count_ == 0) {
+        delete arena;
+    } else {
+        arena->destroyed_ = true;
+    }
+}
+
+void*
+Arena::allocate(size_t size) {
+    assert(!destroyed_);
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    // Larger allocations get a dedicated chunk.
+    if (size > chunk_size_) {
+        large_chunks_.reserve(large_chunks_.size() + 1);
+        large_chunks_.push_back(new char[size]);
+        ++live_count_;
+        return (large_chunks_.back());
+    }
+
+    // Move to the next chunk if the current one is full, allocating it if
+    // necessary.
+    if (current_ < chunks_.size() && used_ + size > chunk_size_) {
+        ++current_;
+        used_ = 0;
+    }
+    if (current_ == chunks_.size()) {
+        chunks_.reserve(chunks_.size() + 1);
+        chunks_.push_back(new char[chunk_size_]);
+        used_ = 0;
+    }
+    void* p = chunks_[current_] + used_;
+    used_ += size;
+    ++live_count_;
+    return (p);
+}
+
+void
+Arena::deallocate(void*, size_t) {
+    assert(live_count_ > 0);
+    if (--live_count_ == 0 && destroyed_) {
+        delete this;
+    }
+}
+
+bool
+Arena::reset() {
+    if (live_count_ != 0) {
+        return (false);
+    }
+    // Dedicated chunks are released, so a single large request doesn't
+    // keep the memory forever.
+    releaseLargeChunks();
+    current_ = 0;
+    used_ = 0;
+    return (true);
+}
+
+Arena*
+Arena::getCurrent() {
+    return (current_arena);
+}
+
+Arena::Scope::Scope(Arena* arena) : prev_(current_arena) {
+    current_arena = arena;
+}
+
+Arena::Scope::~Scope() {
+    current_arena = prev_;
+}
+
+} // namespace util
+} // namespace bundy
@@ -0,0 +1,225 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef UTIL_ARENA_H
+#define UTIL_ARENA_H 1
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace bundy {
+namespace util {
+
+/// \brief A bump allocator for short-lived objects.
+///
+/// An \c Arena allocates memory from large chunks by simply advancing a
+/// pointer, and reclaims all of it at once with \c reset().  It's intended
+/// for objects that only live while a single request is processed, e.g.,
+/// RRsets created for a DNS query, so that the general-purpose allocator is
+/// not involved in the steady state of the processing: once the arena has
+/// grown large enough for the largest request, the chunks are reused.
+///
+/// Individual deallocation doesn't free memory; it only decrements the
+/// number of live allocations, so that \c reset() can tell whether it's
+/// safe to rewind.  If any object from the arena is still alive, \c reset()
+/// does nothing and the arena keeps growing until a later call succeeds.
+/// Likewise, \c destroy() defers the release of the memory until the last
+/// live object is deallocated.
+///
+/// The arena is not thread-safe.  An arena and all objects allocated from
+/// it are expected to be used (and released) in a single thread.
+///
+/// Code that creates such objects doesn't have to know the arena: the
+/// arena of the thread is set by an \c Arena::Scope object, and
+/// \c createShared() uses it if it's set (and the normal \c new otherwise).
+class Arena : boost::noncopyable {
+public:
+    /// \brief The default size of chunks.
+    static const size_t DEFAULT_CHUNK_SIZE = 16384;
+
+    /// \brief Create an arena.
+    ///
+    /// No memory is allocated for the chunks until the first allocation.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param chunk_size The size of each chunk.  Larger allocations use
+    ///     dedicated chunks.
+    static Arena* create(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    /// \brief Destroy an arena.
+    ///
+    /// If there are still live allocations, the memory is released when
+    /// the last one is deallocated.  The arena must not be used for new
+    /// allocations after this call.
+    ///
+    /// \throw none
+    static void destroy(Arena* arena);
+
+    /// \brief Allocate memory.
+    ///
+    /// The returned memory is aligned for any fundamental type.
+    ///
+    /// \throw std::bad_alloc Memory allocation fails.
+    void* allocate(size_t size);
+
+    /// \brief Deallocate memory returned by \c allocate().
+    ///
+    /// \throw none
+    void deallocate(void* ptr, size_t size);
+
+    /// \brief Reclaim all memory if nothing in the arena is alive.
+    ///
+    /// The chunks are kept for later allocations.
+    ///
+    /// \throw none
+    /// \return true if the memory is reclaimed; false if there are live
+    ///     allocations.
+    bool reset();
+
+    /// \brief Return the number of allocations that are not deallocated.
+    size_t getLiveCount() const { return (live_count_); }
+
+    /// \brief Return the number of chunks held by the arena.
+    size_t getChunkCount() const {
+        return (chunks_.size() + large_chunks_.size());
+    }
+
+    /// \brief Return the arena set for the calling thread, or NULL.
+    static Arena* getCurrent();
+
+    /// \brief Set the arena for the calling thread while the object
+    /// exists.
+    ///
+    /// Scopes can be nested; the previous arena is restored on
+    /// destruction.
+    class Scope : boost::noncopyable {
+    public:
+        explicit Scope(Arena* arena);
+        ~Scope();
+    private:
+        Arena* const prev_;
+    };
+
+private:
+    explicit Arena(size_t chunk_size);
+    ~Arena();
+
+    void releaseLargeChunks();
+
+    const size_t chunk_size_;
+    std::vector<char*> chunks_;
+    std::vector<char*> large_chunks_; // dedicated to larger allocations
+    size_t current_;            // index of the chunk in use
+    size_t used_;               // bytes used in the current chunk
+    size_t live_count_;
+    bool destroyed_;
+};
+
+/// \brief An allocator using an \c Arena, for use with the standard
+/// containers and \c boost::allocate_shared().
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) :
+        arena_(other.getArena())
+    {}
+
+    T* allocate(size_t n, const void* = NULL) {
+        return (static_cast<T*>(arena_->allocate(n * sizeof(T))));
+    }
+
+    void deallocate(T* p, size_t n) {
+        arena_->deallocate(p, n * sizeof(T));
+    }
+
+    size_t max_size() const { return (static_cast<size_t>(-1) / sizeof(T)); }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        new(p) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        p->~U();
+    }
+
+    Arena* getArena() const { return (arena_); }
+
+private:
+    Arena* arena_;
+};
+
+template <typename T, typename U>
+bool
+operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return (a.getArena() == b.getArena());
+}
+
+template <typename T, typename U>
+bool
+operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return (a.getArena() != b.getArena());
+}
+
+/// \brief Create an object managed by \c boost::shared_ptr, in the arena of
+/// the calling thread if it's set.
+///
+/// The object and the reference counter are placed in the arena set by
+/// \c Arena::Scope if any; otherwise the object is allocated with \c new
+/// as usual.  In either case the returned pointer can be used like any
+/// other \c shared_ptr; in the former case the arena can't be reset
+/// while it's alive.
+template <typename T, typename... Args>
+boost::shared_ptr<T>
+createShared(Args&&... args) {
+    Arena* const arena = Arena::getCurrent();
+    if (arena == NULL) {
+        return (boost::shared_ptr<T>(new T(std::forward<Args>(args)...)));
+    }
+    return (boost::allocate_shared<T>(ArenaAllocator<T>(*arena),
+                                      std::forward<Args>(args)...));
+}
+
+} // namespace util
+} // namespace bundy
+
+#endif // UTIL_ARENA_H
+
+// Local Variables:
+// mode: c++
+// End:
@@ -25,6 +25,7 @@
 #include <boost/interprocess/sync/file_lock.hpp>
 
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <new>
 
@@ -52,6 +53,42 @@ namespace { // unnamed namespace
 const char* const RESERVED_NAMED_ADDRESS_STORAGE_NAME =
     "_RESERVED_NAMED_ADDRESS_STORAGE";
 
+// Calculate the digest of [base, base + size), handling the 64-bit integer
+// at exclude (if non NULL) as 0.  It's 64-bit FNV-1a, applied to each 64-bit
+// word rather than each byte (the remaining bytes at the end, if any, are
+// processed bytewise).
+uint64_t
+calculateDigest(const void* base, size_t size, const void* exclude) {
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    const uint8_t* const cp_begin = static_cast<const uint8_t*>(base);
+    const uint8_t* const cp_exclude = static_cast<const uint8_t*>(exclude);
+    if (cp_exclude &&
+        (cp_exclude < cp_begin ||
+         cp_exclude + sizeof(uint64_t) > cp_begin + size ||
+         (cp_exclude - cp_begin) % sizeof(uint64_t) != 0)) {
+        bundy_throw(InvalidParameter,
+                    "Invalid address to be excluded from digest: "
+                    << exclude);
+    }
+
+    uint64_t digest = FNV_OFFSET_BASIS;
+    size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        if (cp_begin + offset != cp_exclude) {
+            std::memcpy(&word, cp_begin + offset, sizeof(word));
+        }
+        digest = (digest ^ word) * FNV_PRIME;
+    }
+    for (; offset < size; ++offset) {
+        digest = (digest ^ cp_begin[offset]) * FNV_PRIME;
+    }
+
+    return (digest);
+}
+
 } // end of unnamed namespace
 
 
@@ -228,6 +265,9 @@ struct MemorySegmentMapped::Impl {
     // actual Boost implementation of mapped segment.
     boost::scoped_ptr<BaseSegment> base_sgmt_;
 
+    // If non empty, the named address to store the digest on close.
+    std::string digest_name_;
+
 private:
     // helper methods and member to detect any reader-writer conflict at
     // the time of construction using an advisory file lock.  The lock will
@@ -294,6 +334,18 @@ MemorySegmentMapped::MemorySegmentMapped(const std::string& filename,
 MemorySegmentMapped::~MemorySegmentMapped() {
     if (impl_->base_sgmt_ && !impl_->read_only_) {
         impl_->freeReservedMemory();
+        if (!impl_->digest_name_.empty()) {
+            // This must be the last modification to the segment.
+            const offset_ptr<void>* storage =
+                impl_->base_sgmt_->find<offset_ptr<void> >(
+                    impl_->digest_name_.c_str()).first;
+            if (storage && *storage) {
+                uint64_t* digest = static_cast<uint64_t*>(storage->get());
+                *digest = calculateDigest(impl_->base_sgmt_->get_address(),
+                                          impl_->base_sgmt_->get_size(),
+                                          digest);
+            }
+        }
     }
     delete impl_;
 }
@@ -483,5 +535,19 @@ MemorySegmentMapped::getCheckSum() const {
     return (sum);
 }
 
+uint64_t
+MemorySegmentMapped::getDigest(const void* exclude) const {
+    return (calculateDigest(impl_->base_sgmt_->get_address(),
+                            impl_->base_sgmt_->get_size(), exclude));
+}
+
+void
+MemorySegmentMapped::setDigestName(const std::string& name) {
+    if (impl_->read_only_) {
+        bundy_throw(MemorySegmentError, "setDigestName on read-only segment");
+    }
+    impl_->digest_name_ = name;
+}
+
 } // namespace util
 } // namespace bundy
@@ -261,6 +261,49 @@ public:
     /// \throw None
     size_t getCheckSum() const;
 
+    /// \brief Calculate a digest of the entire memory segment.
+    ///
+    /// Unlike \c getCheckSum(), this method goes over every byte of the
+    /// underlying mapped memory segment, so it's much more expensive but
+    /// detects any accidental change to the file contents.  It can be used
+    /// for segments opened in the read-only mode.
+    ///
+    /// Since the digest is normally stored in the segment itself, the
+    /// caller can specify the location of a 64-bit integer in the segment
+    /// that should be excluded from the calculation (it's handled as if it
+    /// were 0).  It must be aligned to the size of the integer.
+    ///
+    /// \throw bundy::InvalidParameter \c exclude is not aligned or not in
+    /// the segment.
+    ///
+    /// \param exclude The location of a 64-bit integer to be excluded from
+    /// the calculation, or NULL.
+    uint64_t getDigest(const void* exclude = NULL) const;
+
+    /// \brief Store the digest of the segment when it's closed.
+    ///
+    /// If this method is called, the destructor of a segment opened in
+    /// the read-write mode calculates the digest of the segment (see
+    /// \c getDigest()) after completing all other modifications, and stores
+    /// it in a 64-bit integer at the named address of \c name.  The digest
+    /// itself is excluded from the calculation, so a reader can verify the
+    /// segment as follows:
+    ///
+    /// \code
+    /// const uint64_t* digest = static_cast<const uint64_t*>(
+    ///     segment.getNamedAddress(name).second);
+    /// const bool valid = (*digest == segment.getDigest(digest));
+    /// \endcode
+    ///
+    /// The named address should have been set by the time of destruction;
+    /// otherwise the digest is silently not stored.
+    ///
+    /// \throw MemorySegmentError The segment is opened read-only.
+    /// \throw std::bad_alloc Memory allocation fails.
+    ///
+    /// \param name The name of the address to store the digest.
+    void setDigestName(const std::string& name);
+
 private:
     struct Impl;
     Impl* impl_;
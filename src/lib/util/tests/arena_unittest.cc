@@ -0,0 +1,177 @@
+// Copyright (C) 2014  Internet Systems Consortium, Inc. ("ISC")
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS.  IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+// OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <util/arena.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+using namespace bundy::util;
+
+namespace {
+
+// A class to check construction and destruction of objects.
+class Counted {
+public:
+    Counted(int& count, const std::string& name) :
+        count_(count), name_(name)
+    {
+        ++count_;
+    }
+    ~Counted() {
+        --count_;
+    }
+    const std::string& getName() const { return (name_); }
+private:
+    int& count_;
+    const std::string name_;
+};
+
+class ArenaTest : public ::testing::Test {
+protected:
+    ArenaTest() : arena_(Arena::create(256)) {}
+    ~ArenaTest() {
+        Arena::destroy(arena_);
+    }
+    Arena* arena_;
+};
+
+TEST_F(ArenaTest, allocate) {
+    EXPECT_EQ(0, arena_->getChunkCount());
+    void* p1 = arena_->allocate(1);
+    void* p2 = arena_->allocate(8);
+    void* p3 = arena_->allocate(16);
+    EXPECT_EQ(3, arena_->getLiveCount());
+    EXPECT_EQ(1, arena_->getChunkCount());
+
+    // Allocations are aligned and don't overlap.
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p1) % 16);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p2) % 16);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p3) % 16);
+    EXPECT_LE(static_cast<char*>(p1) + 1, static_cast<char*>(p2));
+    EXPECT_LE(static_cast<char*>(p2) + 8, static_cast<char*>(p3));
+
+    // When a chunk is full, a new one is used.
+    void* p4 = arena_->allocate(256);
+    EXPECT_EQ(2, arena_->getChunkCount());
+    // Larger ones get a dedicated chunk.
+    void* p5 = arena_->allocate(1000);
+    EXPECT_EQ(3, arena_->getChunkCount());
+
+    arena_->deallocate(p1, 1);
+    arena_->deallocate(p2, 8);
+    arena_->deallocate(p3, 16);
+    arena_->deallocate(p4, 256);
+    arena_->deallocate(p5, 1000);
+    EXPECT_EQ(0, arena_->getLiveCount());
+}
+
+TEST_F(ArenaTest, reset) {
+    void* p1 = arena_->allocate(100);
+    void* p2 = arena_->allocate(1000);
+
+    // Not reset while something is alive.
+    arena_->deallocate(p2, 1000);
+    EXPECT_FALSE(arena_->reset());
+    void* p3 = arena_->allocate(100);
+    EXPECT_NE(p1, p3);
+
+    // Once everything is released, the memory is reused from the
+    // beginning, and the chunk for the large allocation is released.
+    arena_->deallocate(p1, 100);
+    arena_->deallocate(p3, 100);
+    EXPECT_TRUE(arena_->reset());
+    EXPECT_EQ(1, arena_->getChunkCount());
+    void* p4 = arena_->allocate(100);
+    EXPECT_EQ(p1, p4);
+    arena_->deallocate(p4, 100);
+}
+
+TEST_F(ArenaTest, scope) {
+    EXPECT_EQ(static_cast<Arena*>(NULL), Arena::getCurrent());
+    {
+        const Arena::Scope scope(arena_);
+        EXPECT_EQ(arena_, Arena::getCurrent());
+        {
+            const Arena::Scope scope2(NULL);
+            EXPECT_EQ(static_cast<Arena*>(NULL), Arena::getCurrent());
+        }
+        EXPECT_EQ(arena_, Arena::getCurrent());
+    }
+    EXPECT_EQ(static_cast<Arena*>(NULL), Arena::getCurrent());
+}
+
+TEST_F(ArenaTest, createShared) {
+    int count = 0;
+
+    // Without an arena, the object is created normally.
+    boost::shared_ptr<Counted> obj1 =
+        createShared<Counted>(count, std::string("obj1"));
+    EXPECT_EQ(1, count);
+    EXPECT_EQ("obj1", obj1->getName());
+    EXPECT_EQ(0, arena_->getLiveCount());
+
+    // Within a scope, it's created in the arena.
+    boost::shared_ptr<Counted> obj2;
+    {
+        const Arena::Scope scope(arena_);
+        obj2 = createShared<Counted>(count, std::string("obj2"));
+    }
+    EXPECT_EQ(2, count);
+    EXPECT_EQ("obj2", obj2->getName());
+    EXPECT_EQ(1, arena_->getLiveCount());
+    EXPECT_FALSE(arena_->reset());
+
+    // It's destroyed as usual when the last reference is gone.
+    boost::shared_ptr<Counted> obj2_copy = obj2;
+    obj2.reset();
+    EXPECT_EQ(2, count);
+    obj2_copy.reset();
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(0, arena_->getLiveCount());
+    EXPECT_TRUE(arena_->reset());
+}
+
+TEST_F(ArenaTest, destroyWithLiveObjects) {
+    int count = 0;
+    Arena* arena = Arena::create();
+    boost::shared_ptr<Counted> obj;
+    {
+        const Arena::Scope scope(arena);
+        obj = createShared<Counted>(count, std::string("obj"));
+    }
+    // The arena is actually released when the object is destroyed.  A
+    // memory checker would detect any problem.
+    Arena::destroy(arena);
+    EXPECT_EQ("obj", obj->getName());
+    obj.reset();
+    EXPECT_EQ(0, count);
+}
+
+TEST_F(ArenaTest, container) {
+    std::vector<int, ArenaAllocator<int> > v((ArenaAllocator<int>(*arena_)));
+    for (int i = 0; i < 100; ++i) {
+        v.push_back(i);
+    }
+    EXPECT_EQ(99, v.back());
+    EXPECT_LT(0, arena_->getLiveCount());
+}
+
+}
@@ -562,6 +562,48 @@ TEST_F(MemorySegmentMappedTest, getCheckSum) {
     EXPECT_EQ(old_cksum + 1, segment_->getCheckSum());
 }
 
+TEST_F(MemorySegmentMappedTest, getDigest) {
+    uint64_t* data = static_cast<uint64_t*>(
+        segment_->allocate(sizeof(uint64_t) * 2));
+    EXPECT_FALSE(segment_->setNamedAddress("digest", data));
+    data[0] = 0;
+    data[1] = 0;
+    const uint64_t old_digest = segment_->getDigest();
+
+    // Any change to the data changes the digest (not only the first byte
+    // of a page as in the case of getCheckSum()).
+    data[1] = 42;
+    const uint64_t new_digest = segment_->getDigest();
+    EXPECT_NE(old_digest, new_digest);
+
+    // The excluded word is handled as 0.
+    data[0] = 0x1234;
+    EXPECT_NE(new_digest, segment_->getDigest());
+    EXPECT_EQ(new_digest, segment_->getDigest(&data[0]));
+    data[0] = new_digest;
+    EXPECT_EQ(new_digest, segment_->getDigest(&data[0]));
+
+    // If requested, the digest is stored on close, and can be verified in
+    // the read-only mode.
+    segment_->setDigestName("digest");
+    segment_.reset();
+    segment_.reset(new MemorySegmentMapped(mapped_file));
+    const MemorySegment::NamedAddressResult result =
+        segment_->getNamedAddress("digest");
+    ASSERT_TRUE(result.first);
+    const uint64_t* ro_data = static_cast<const uint64_t*>(result.second);
+    EXPECT_NE(new_digest, ro_data[0]);
+    EXPECT_EQ(ro_data[0], segment_->getDigest(ro_data));
+    EXPECT_EQ(42, ro_data[1]);
+    EXPECT_THROW(segment_->setDigestName("digest"), MemorySegmentError);
+
+    // Unaligned or out-of-segment address isn't accepted.
+    EXPECT_THROW(segment_->getDigest(
+                     reinterpret_cast<const uint8_t*>(ro_data) + 1),
+                 bundy::InvalidParameter);
+    EXPECT_THROW(segment_->getDigest(&old_digest), bundy::InvalidParameter);
+}
+
 // Mode of opening segments in the tests below.
 enum TestOpenMode {
     READER = 0,
@@ -199,6 +199,63 @@ Mutex::unlock() {
     assert(result == 0); // This should never be possible
 }
 
+class RWMutex::Impl {
+public:
+    pthread_rwlock_t rwlock;
+};
+
+RWMutex::RWMutex() :
+    impl_(NULL)
+{
+    unique_ptr<Impl> impl(new Impl);
+    const int result = pthread_rwlock_init(&impl->rwlock, NULL);
+    switch (result) {
+        case 0: // All 0K
+            impl_ = impl.release();
+            break;
+        case ENOMEM:
+        case EAGAIN:
+            throw std::bad_alloc();
+        default:
+            bundy_throw(bundy::InvalidOperation, std::strerror(result));
+    }
+}
+
+RWMutex::~RWMutex() {
+    if (impl_ != NULL) {
+        const int result = pthread_rwlock_destroy(&impl_->rwlock);
+        delete impl_;
+        // As with Mutex, we don't want to throw from the destructor, and
+        // a failure means the lock is still held or broken.
+        assert(result == 0);
+    }
+}
+
+void
+RWMutex::readLock() {
+    assert(impl_ != NULL);
+    const int result = pthread_rwlock_rdlock(&impl_->rwlock);
+    if (result != 0) {
+        bundy_throw(bundy::InvalidOperation, std::strerror(result));
+    }
+}
+
+void
+RWMutex::writeLock() {
+    assert(impl_ != NULL);
+    const int result = pthread_rwlock_wrlock(&impl_->rwlock);
+    if (result != 0) {
+        bundy_throw(bundy::InvalidOperation, std::strerror(result));
+    }
+}
+
+void
+RWMutex::unlock() {
+    assert(impl_ != NULL);
+    const int result = pthread_rwlock_unlock(&impl_->rwlock);
+    assert(result == 0); // This should never be possible
+}
+
 class CondVar::Impl {
 public:
     Impl() {
@@ -255,6 +312,14 @@ CondVar::signal() {
     assert(result == 0);
 }
 
+void
+CondVar::broadcast() {
+    const int result = pthread_cond_broadcast(&impl_->cond_);
+
+    // Same as for signal(), this cannot fail for a valid CondVar object.
+    assert(result == 0);
+}
+
 }
 }
 }
@@ -170,6 +170,92 @@ private:
     Impl* impl_;
 };
 
+/// \brief Reader-writer lock with an interface similar to \c Mutex
+///
+/// Any number of threads can hold the lock for reading at the same time
+/// (via \c RWMutex::ReadLocker), while at most one thread can hold it for
+/// writing (via \c RWMutex::Locker), excluding all readers.
+///
+/// The exclusive locker is named \c Locker so that this class can be used
+/// in templated code written for \c Mutex where only exclusive locking is
+/// needed.  It's non-recursive in both modes; acquiring the lock again from
+/// a thread that already holds it results in undefined behavior.
+///
+/// This class is intended for data that is read very frequently from
+/// multiple threads and updated only rarely, such as the data source client
+/// lists looked up by query processing threads.  As with \c Mutex, errors
+/// from the OS are converted to \c bundy::InvalidOperation or
+/// \c std::bad_alloc.
+class RWMutex : boost::noncopyable {
+public:
+    /// \brief Constructor.
+    ///
+    /// \throw std::bad_alloc In case allocation of something (memory, the
+    ///     OS lock) fails.
+    /// \throw bundy::InvalidOperation Other unspecified errors around the
+    ///     lock.  This should be rare.
+    RWMutex();
+
+    /// \brief Destructor.
+    ///
+    /// It is not allowed to destroy a lock which is currently held in
+    /// either mode.
+    ~RWMutex();
+
+    /// \brief This holds an exclusive (writer) lock on an RWMutex.
+    class Locker : boost::noncopyable {
+    public:
+        /// \brief Constructor.
+        ///
+        /// Blocks until all other holders (readers or a writer) release
+        /// the lock.
+        ///
+        /// \throw bundy::InvalidOperation when OS reports error.
+        Locker(RWMutex& mutex) : mutex_(mutex) {
+            mutex.writeLock();
+        }
+
+        /// \brief Destructor.
+        ///
+        /// Releases the lock.
+        ~Locker() {
+            mutex_.unlock();
+        }
+    private:
+        RWMutex& mutex_;
+    };
+
+    /// \brief This holds a shared (reader) lock on an RWMutex.
+    class ReadLocker : boost::noncopyable {
+    public:
+        /// \brief Constructor.
+        ///
+        /// Blocks only while some other thread holds the lock exclusively.
+        ///
+        /// \throw bundy::InvalidOperation when OS reports error.
+        ReadLocker(RWMutex& mutex) : mutex_(mutex) {
+            mutex.readLock();
+        }
+
+        /// \brief Destructor.
+        ///
+        /// Releases the lock.
+        ~ReadLocker() {
+            mutex_.unlock();
+        }
+    private:
+        RWMutex& mutex_;
+    };
+
+private:
+    void readLock();
+    void writeLock();
+    void unlock();
+
+    class Impl;
+    Impl* impl_;
+};
+
 /// \brief Encapsulation for a condition variable.
 ///
 /// This class provides a simple encapsulation of condition variable for
@@ -248,6 +334,12 @@ public:
     /// This method never throws; if some unexpected low level error happens
     /// it terminates the program.
     void signal();
+
+    /// \brief Unblock all threads waiting for the condition variable.
+    ///
+    /// This method works like \c signal(), except that it wakes all the
+    /// threads waiting on this object (it's \c pthread_cond_broadcast()).
+    void broadcast();
 private:
     class Impl;
     Impl* impl_;
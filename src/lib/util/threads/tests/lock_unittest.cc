@@ -168,4 +168,65 @@ TEST(MutexTest, swarm) {
     }
 }
 
+void
+readLockThread(RWMutex* mutex, volatile bool* done) {
+    RWMutex::ReadLocker lock(*mutex);
+    *done = true;
+}
+
+// Shared locks don't exclude each other: a second thread can acquire the
+// lock for reading while we hold it.  If it couldn't, the thread would
+// block forever and the alarm below would terminate the test.
+TEST(RWMutexTest, sharedReaders) {
+    struct sigaction ignored, original;
+    memset(&ignored, 0, sizeof(ignored));
+    ignored.sa_handler = noHandler;
+    if (sigaction(SIGALRM, &ignored, &original)) {
+        FAIL() << "Couldn't set alarm";
+    }
+    alarm(10);
+    RWMutex mutex;
+    bool done = false;
+    {
+        RWMutex::ReadLocker lock(mutex);
+        Thread thread(boost::bind(&readLockThread, &mutex, &done));
+        thread.wait();
+    }
+    EXPECT_TRUE(done);
+    alarm(0);
+    if (sigaction(SIGALRM, &original, NULL)) {
+        FAIL() << "Couldn't restore alarm";
+    }
+}
+
+void
+performRWIncrement(volatile double* canary, volatile bool* ready_me,
+                   volatile bool* ready_other, RWMutex* mutex)
+{
+    *ready_me = true;
+    while (!*ready_other) {}
+
+    for (size_t i = 0; i < iterations; ++i) {
+        RWMutex::Locker lock(*mutex);
+        *canary += 1;
+    }
+}
+
+// Same as MutexTest.swarm, for the exclusive lock of RWMutex.
+TEST(RWMutexTest, swarm) {
+    if (!bundy::util::unittests::runningOnValgrind()) {
+        double canary = 0;
+        RWMutex mutex;
+        bool ready1 = false;
+        bool ready2 = false;
+        Thread t1(boost::bind(&performRWIncrement, &canary, &ready1, &ready2,
+                              &mutex));
+        Thread t2(boost::bind(&performRWIncrement, &canary, &ready2, &ready1,
+                              &mutex));
+        t1.wait();
+        t2.wait();
+        EXPECT_EQ(iterations * 2, canary) << "Threads are badly synchronized";
+    }
+}
+
 }